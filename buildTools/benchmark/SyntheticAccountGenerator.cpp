@@ -0,0 +1,377 @@
+#include "buildTools/benchmark/SyntheticAccountGenerator.h"
+
+#include <QFile>
+#include <QSet>
+
+#include <algorithm>
+
+#include "sodium.h"
+
+#include "src/backup/ContactBackupObject.h"
+#include "src/backup/ContactMediaItemBackupObject.h"
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/CsvRecordWriter.h"
+#include "src/backup/GroupBackupObject.h"
+#include "src/backup/GroupMediaItemBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/backup/IdentityBackup.h"
+#include "src/crypto/PublicKey.h"
+#include "src/dataproviders/messages/ContactMessageType.h"
+#include "src/dataproviders/messages/GroupMessageType.h"
+#include "src/dataproviders/messages/UserMessageState.h"
+#include "src/exceptions/IllegalArgumentException.h"
+#include "src/exceptions/InternalErrorException.h"
+#include "src/protocol/ContactIdVerificationStatus.h"
+#include "src/protocol/MessageId.h"
+#include "src/protocol/MessageTime.h"
+
+namespace openmittsu {
+	namespace benchmark {
+
+		using namespace openmittsu::dataproviders::messages;
+
+		namespace {
+			qint64 const firstMessageTime = 1400000000000LL;
+		}
+
+		SyntheticAccountGenerator::SyntheticAccountGenerator(Settings const& settings) : m_settings(settings), m_random(settings.seed), m_statistics(), m_selfContactId(QStringLiteral("SYNTHSLF")), m_selfKeyPair(), m_contacts(), m_groups(), m_groupSenders(),
+			m_mediaInterval(0), m_writtenMessages(0) {
+			QByteArray const secretKey = createBytes(crypto_scalarmult_SCALARBYTES);
+			QByteArray publicKey(crypto_scalarmult_BYTES, '\0');
+			crypto_scalarmult_base(reinterpret_cast<unsigned char*>(publicKey.data()), reinterpret_cast<unsigned char const*>(secretKey.constData()));
+			m_selfKeyPair = openmittsu::crypto::KeyPair::fromArrays(reinterpret_cast<unsigned char const*>(publicKey.constData()), reinterpret_cast<unsigned char const*>(secretKey.constData()));
+
+			createConversations();
+		}
+
+		SyntheticAccountGenerator::SyntheticAccountGenerator(Settings const& settings, openmittsu::protocol::ContactId const& selfContactId, openmittsu::crypto::KeyPair const& selfKeyPair) : m_settings(settings), m_random(settings.seed), m_statistics(), m_selfContactId(selfContactId),
+			m_selfKeyPair(selfKeyPair), m_contacts(), m_groups(), m_groupSenders(), m_mediaInterval(0), m_writtenMessages(0) {
+			createConversations();
+		}
+
+		SyntheticAccountGenerator::~SyntheticAccountGenerator() {
+			//
+		}
+
+		SyntheticAccountGenerator::Settings SyntheticAccountGenerator::getDefaultSettings() {
+			// Roughly a heavily used phone: a few hundred chats with a long tail, a million messages and some photos.
+			Settings const settings = { 300, 60, 1000000, Distribution::ZIPF, 2000, 200 * 1024, 10, 10, 4711 };
+			return settings;
+		}
+
+		QString SyntheticAccountGenerator::toString(Distribution distribution) {
+			switch (distribution) {
+				case Distribution::UNIFORM:
+					return QStringLiteral("uniform");
+				case Distribution::ZIPF:
+					return QStringLiteral("zipf");
+				default:
+					throw openmittsu::exceptions::InternalErrorException() << "Unhandled message distribution, this should never happen!";
+			}
+		}
+
+		SyntheticAccountGenerator::Statistics const& SyntheticAccountGenerator::getStatistics() const {
+			return m_statistics;
+		}
+
+		openmittsu::protocol::ContactId const& SyntheticAccountGenerator::getSelfContactId() const {
+			return m_selfContactId;
+		}
+
+		openmittsu::crypto::KeyPair const& SyntheticAccountGenerator::getSelfKeyPair() const {
+			return m_selfKeyPair;
+		}
+
+		QList<openmittsu::protocol::ContactId> const& SyntheticAccountGenerator::getContacts() const {
+			return m_contacts;
+		}
+
+		QList<openmittsu::protocol::GroupId> const& SyntheticAccountGenerator::getGroups() const {
+			return m_groups;
+		}
+
+		void SyntheticAccountGenerator::createConversations() {
+			if ((m_settings.contactCount < 1) || (m_settings.groupCount < 0) || (m_settings.messageCount < 0) || (m_settings.mediaCount < 0) || (m_settings.mediaSize < 1)) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "A synthetic account needs at least one contact and non-negative counts and sizes.";
+			}
+
+			for (int i = 0; i < m_settings.contactCount; ++i) {
+				m_contacts.append(openmittsu::protocol::ContactId(QStringLiteral("C%1").arg(i, 7, 36, QChar('0')).toUpper()));
+			}
+
+			// Every fourth group is our own, the others belong to the contacts in turn. Besides us and the owner, groups have two to six more members.
+			for (int i = 0; i < m_settings.groupCount; ++i) {
+				openmittsu::protocol::ContactId const owner = ((i % 4) == 0) ? m_selfContactId : m_contacts.at(i % m_contacts.size());
+				m_groups.append(openmittsu::protocol::GroupId(owner, static_cast<quint64>(i + 1)));
+
+				QList<openmittsu::protocol::ContactId> senders;
+				if (owner != m_selfContactId) {
+					senders.append(owner);
+				}
+				int const memberCount = randomInt(2, 6);
+				for (int j = 0; j < memberCount; ++j) {
+					openmittsu::protocol::ContactId const member = m_contacts.at(randomInt(0, m_contacts.size() - 1));
+					if (!senders.contains(member)) {
+						senders.append(member);
+					}
+				}
+				m_groupSenders.append(senders);
+			}
+		}
+
+		void SyntheticAccountGenerator::writeBackup(QDir const& path, QString const& backupPassword) {
+			if (!path.exists() && !path.mkpath(QStringLiteral("."))) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "Could not create the backup directory \"" << path.absolutePath().toStdString() << "\".";
+			} else if (!path.entryList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot).isEmpty()) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "The backup directory \"" << path.absolutePath().toStdString() << "\" is not empty.";
+			}
+
+			m_statistics = Statistics();
+			m_writtenMessages = 0;
+			m_mediaInterval = (m_settings.mediaCount > 0) ? std::max(qint64(1), m_settings.messageCount / m_settings.mediaCount) : 0;
+
+			writeIdentity(path, backupPassword);
+			writeContacts(path);
+			writeGroups(path);
+
+			// The counts are handed out largest first, alternating between contacts and groups, so both kinds have large and small conversations.
+			std::vector<qint64> const messageCounts = getMessageCounts(m_contacts.size() + m_groups.size());
+			int contactIndex = 0;
+			int groupIndex = 0;
+			for (std::size_t i = 0; i < messageCounts.size(); ++i) {
+				bool const isContact = (groupIndex >= m_groups.size()) || ((contactIndex <= groupIndex) && (contactIndex < m_contacts.size()));
+				if (isContact) {
+					writeContactMessages(path, m_contacts.at(contactIndex), static_cast<int>(i), messageCounts.at(i));
+					++contactIndex;
+				} else {
+					writeGroupMessages(path, m_groups.at(groupIndex), static_cast<int>(i), messageCounts.at(i));
+					++groupIndex;
+				}
+			}
+		}
+
+		void SyntheticAccountGenerator::writeIdentity(QDir const& path, QString const& backupPassword) {
+			QByteArray const data = openmittsu::backup::IdentityBackup(m_selfContactId, m_selfKeyPair).toBackupString(backupPassword).toUtf8();
+			QFile file(path.filePath(QStringLiteral("identity")));
+			if (!file.open(QFile::WriteOnly) || (file.write(data) != data.size())) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write the identity backup file: " << file.errorString().toStdString();
+			}
+			++m_statistics.files;
+			m_statistics.totalBytes += data.size();
+		}
+
+		void SyntheticAccountGenerator::writeContacts(QDir const& path) {
+			QFile file(path.filePath(QStringLiteral("contacts.csv")));
+			if (!file.open(QFile::WriteOnly)) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write the contacts file: " << file.errorString().toStdString();
+			}
+
+			openmittsu::backup::CsvRecordWriter writer(&file);
+			writer.writeRecord(openmittsu::backup::ContactBackupObject::getBackupHeader());
+			for (int i = 0; i < m_contacts.size(); ++i) {
+				openmittsu::crypto::PublicKey const publicKey = openmittsu::crypto::PublicKey::fromHexString(QString(createBytes(crypto_scalarmult_BYTES).toHex()));
+				openmittsu::protocol::ContactIdVerificationStatus const verificationStatus = ((i % 3) == 0) ? openmittsu::protocol::ContactIdVerificationStatus::VERIFICATION_STATUS_FULLY_VERIFIED : openmittsu::protocol::ContactIdVerificationStatus::VERIFICATION_STATUS_UNVERIFIED;
+				QString const firstName = ((i % 5) == 0) ? QString::fromUtf8("J\xC3\xBCrgen") : QStringLiteral("First%1").arg(i);
+				openmittsu::backup::ContactBackupObject const contact(m_contacts.at(i), publicKey, verificationStatus, firstName, QStringLiteral("Last%1").arg(i), QStringLiteral("nick%1").arg(i), randomInt(0, 0xFFFFFF));
+				writer.writeRecord(contact.toBackupRecord());
+			}
+			writer.flush();
+
+			m_statistics.contacts = m_contacts.size();
+			++m_statistics.files;
+			m_statistics.totalBytes += writer.getBytesWritten();
+		}
+
+		void SyntheticAccountGenerator::writeGroups(QDir const& path) {
+			QFile file(path.filePath(QStringLiteral("groups.csv")));
+			if (!file.open(QFile::WriteOnly)) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write the groups file: " << file.errorString().toStdString();
+			}
+
+			openmittsu::backup::CsvRecordWriter writer(&file);
+			writer.writeRecord(openmittsu::backup::GroupBackupObject::getBackupHeader());
+			for (int i = 0; i < m_groups.size(); ++i) {
+				QSet<openmittsu::protocol::ContactId> members = m_groupSenders.at(i).toSet();
+				members.insert(m_selfContactId);
+				openmittsu::backup::GroupBackupObject const group(m_groups.at(i), QStringLiteral("Group %1").arg(i), openmittsu::protocol::MessageTime::fromDatabase(firstMessageTime + i), members, false);
+				writer.writeRecord(group.toBackupRecord());
+			}
+			writer.flush();
+
+			m_statistics.groups = m_groups.size();
+			++m_statistics.files;
+			m_statistics.totalBytes += writer.getBytesWritten();
+		}
+
+		void SyntheticAccountGenerator::writeContactMessages(QDir const& path, openmittsu::protocol::ContactId const& contact, int conversationIndex, qint64 messageCount) {
+			if (messageCount < 1) {
+				return;
+			}
+
+			QFile file(path.filePath(openmittsu::backup::ContactMessageBackupObject::getContactMessageFileName(contact)));
+			if (!file.open(QFile::WriteOnly)) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write message file \"" << file.fileName().toStdString() << "\": " << file.errorString().toStdString();
+			}
+
+			openmittsu::backup::CsvRecordWriter writer(&file);
+			writer.writeRecord(openmittsu::backup::ContactMessageBackupObject::getBackupHeader());
+			qint64 time = firstMessageTime;
+			for (qint64 i = 0; i < messageCount; ++i) {
+				time += randomInt(1000, 600000);
+				QString const uuid = createUuid();
+				bool const isOutbox = randomInt(0, 1) == 1;
+				bool const isMedia = isMediaMessage();
+				openmittsu::protocol::MessageTime const createdAt = openmittsu::protocol::MessageTime::fromDatabase(time);
+				openmittsu::protocol::MessageTime const receivedAt = openmittsu::protocol::MessageTime::fromDatabase(time + randomInt(100, 5000));
+				UserMessageState const messageState = (isOutbox && (randomInt(0, 1) == 1)) ? UserMessageState::DELIVERED : UserMessageState::READ;
+				openmittsu::protocol::MessageId const apiId((static_cast<quint64>(conversationIndex + 1) << 40) | static_cast<quint64>(i));
+
+				openmittsu::backup::ContactMessageBackupObject const message(contact, apiId, uuid, isOutbox, true, false, messageState, createdAt, isOutbox ? receivedAt : createdAt, receivedAt, receivedAt,
+					isMedia ? ContactMessageType::IMAGE : ContactMessageType::TEXT, isMedia ? QString() : createBody(), false, false, (isMedia && (randomInt(0, 1) == 1)) ? createBody() : QString());
+				writer.writeRecord(message.toBackupRecord());
+
+				if (isMedia) {
+					writeMediaFile(path, openmittsu::backup::ContactMediaItemBackupObject::getContactMediaFileName(uuid));
+					++m_statistics.contactMediaItems;
+				}
+			}
+			writer.flush();
+
+			m_statistics.contactMessages += messageCount;
+			++m_statistics.files;
+			m_statistics.totalBytes += writer.getBytesWritten();
+		}
+
+		void SyntheticAccountGenerator::writeGroupMessages(QDir const& path, openmittsu::protocol::GroupId const& group, int conversationIndex, qint64 messageCount) {
+			if (messageCount < 1) {
+				return;
+			}
+
+			QFile file(path.filePath(openmittsu::backup::GroupMessageBackupObject::getGroupMessageFileName(group)));
+			if (!file.open(QFile::WriteOnly)) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write message file \"" << file.fileName().toStdString() << "\": " << file.errorString().toStdString();
+			}
+
+			QList<openmittsu::protocol::ContactId> const& senders = m_groupSenders.at(m_groups.indexOf(group));
+			openmittsu::backup::CsvRecordWriter writer(&file);
+			writer.writeRecord(openmittsu::backup::GroupMessageBackupObject::getBackupHeader());
+			qint64 time = firstMessageTime;
+			for (qint64 i = 0; i < messageCount; ++i) {
+				time += randomInt(1000, 600000);
+				QString const uuid = createUuid();
+				bool const isOutbox = senders.isEmpty() || (randomInt(0, 3) == 0);
+				openmittsu::protocol::ContactId const sender = isOutbox ? m_selfContactId : senders.at(randomInt(0, senders.size() - 1));
+				bool const isMedia = isMediaMessage();
+				openmittsu::protocol::MessageTime const createdAt = openmittsu::protocol::MessageTime::fromDatabase(time);
+				openmittsu::protocol::MessageTime const receivedAt = openmittsu::protocol::MessageTime::fromDatabase(time + randomInt(100, 5000));
+				UserMessageState const messageState = (isOutbox && (randomInt(0, 1) == 1)) ? UserMessageState::DELIVERED : UserMessageState::READ;
+				openmittsu::protocol::MessageId const apiId((static_cast<quint64>(conversationIndex + 1) << 40) | static_cast<quint64>(i));
+
+				openmittsu::backup::GroupMessageBackupObject const message(group, sender, apiId, uuid, isOutbox, true, false, messageState, createdAt, isOutbox ? receivedAt : createdAt, receivedAt, receivedAt,
+					isMedia ? GroupMessageType::IMAGE : GroupMessageType::TEXT, isMedia ? QString() : createBody(), false, false, (isMedia && (randomInt(0, 1) == 1)) ? createBody() : QString());
+				writer.writeRecord(message.toBackupRecord());
+
+				if (isMedia) {
+					writeMediaFile(path, openmittsu::backup::GroupMediaItemBackupObject::getGroupMediaFileName(uuid));
+					++m_statistics.groupMediaItems;
+				}
+			}
+			writer.flush();
+
+			m_statistics.groupMessages += messageCount;
+			++m_statistics.files;
+			m_statistics.totalBytes += writer.getBytesWritten();
+		}
+
+		void SyntheticAccountGenerator::writeMediaFile(QDir const& path, QString const& fileName) {
+			// Sizes vary between half and one and a half times the configured size.
+			QByteArray const data = createBytes(randomInt(std::max(1, m_settings.mediaSize / 2), m_settings.mediaSize + m_settings.mediaSize / 2));
+			QFile file(path.filePath(fileName));
+			if (!file.open(QFile::WriteOnly) || (file.write(data) != data.size())) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write media file \"" << fileName.toStdString() << "\": " << file.errorString().toStdString();
+			}
+
+			++m_statistics.files;
+			m_statistics.totalBytes += data.size();
+		}
+
+		std::vector<qint64> SyntheticAccountGenerator::getMessageCounts(int conversationCount) {
+			std::vector<double> weights;
+			double weightSum = 0.0;
+			for (int i = 0; i < conversationCount; ++i) {
+				double const weight = (m_settings.distribution == Distribution::ZIPF) ? (1.0 / (i + 1)) : 1.0;
+				weights.push_back(weight);
+				weightSum += weight;
+			}
+
+			std::vector<qint64> result;
+			qint64 assigned = 0;
+			for (int i = 0; i < conversationCount; ++i) {
+				qint64 const count = static_cast<qint64>((m_settings.messageCount * weights.at(i)) / weightSum);
+				result.push_back(count);
+				assigned += count;
+			}
+			// The rounding remainder goes to the largest conversations, which keeps the counts in descending order.
+			for (int i = 0; (assigned < m_settings.messageCount) && (conversationCount > 0); i = (i + 1) % conversationCount) {
+				++result[i];
+				++assigned;
+			}
+			return result;
+		}
+
+		bool SyntheticAccountGenerator::isMediaMessage() {
+			++m_writtenMessages;
+			return (m_mediaInterval > 0) && ((m_writtenMessages % m_mediaInterval) == 0) && ((m_statistics.contactMediaItems + m_statistics.groupMediaItems) < m_settings.mediaCount);
+		}
+
+		QString SyntheticAccountGenerator::createBody() {
+			static QStringList const unicodeSnippets = { QString::fromUtf8("Gr\xC3\xBC\xC3\x9F" "e aus K\xC3\xB6ln"), QString::fromUtf8("\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82"), QString::fromUtf8("\xE4\xBD\xA0\xE5\xA5\xBD"),
+				QString::fromUtf8("\xF0\x9F\x98\x80\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD"), QString::fromUtf8("\xD9\x85\xD8\xB1\xD8\xAD\xD8\xA8\xD8\xA7") };
+
+			static QStringList const dictionary = { QStringLiteral("the"), QStringLiteral("meeting"), QStringLiteral("is"), QStringLiteral("moved"), QStringLiteral("to"), QStringLiteral("tomorrow"), QStringLiteral("at"), QStringLiteral("noon"), QStringLiteral("please"), QStringLiteral("bring"),
+				QStringLiteral("the"), QStringLiteral("documents"), QStringLiteral("and"), QStringLiteral("a"), QStringLiteral("laptop"), QStringLiteral("thanks"), QStringLiteral("see"), QStringLiteral("you"), QStringLiteral("there"), QStringLiteral("ok"),
+				QStringLiteral("did"), QStringLiteral("anyone"), QStringLiteral("check"), QStringLiteral("the"), QStringLiteral("train"), QStringLiteral("schedule"), QStringLiteral("for"), QStringLiteral("Saturday"), QStringLiteral("\"quoted\""), QStringLiteral("word,") };
+
+			int const lineCount = (randomInt(1, 100) <= m_settings.multiLinePercent) ? randomInt(2, 6) : 1;
+			QStringList lines;
+			for (int i = 0; i < lineCount; ++i) {
+				int const wordCount = randomInt(1, 25);
+				QStringList words;
+				for (int j = 0; j < wordCount; ++j) {
+					words.append(dictionary.at(randomInt(0, dictionary.size() - 1)));
+				}
+				lines.append(words.join(QChar(' ')));
+			}
+			if (randomInt(1, 100) <= m_settings.unicodePercent) {
+				lines.last().append(QChar(' ')).append(unicodeSnippets.at(randomInt(0, unicodeSnippets.size() - 1)));
+			}
+			return lines.join(QChar('\n'));
+		}
+
+		QString SyntheticAccountGenerator::createUuid() {
+			QByteArray bytes = createBytes(16);
+			bytes[6] = static_cast<char>((bytes.at(6) & 0x0F) | 0x40);
+			bytes[8] = static_cast<char>((bytes.at(8) & 0x3F) | 0x80);
+			QString const hex = QString(bytes.toHex());
+			return QStringLiteral("%1-%2-%3-%4-%5").arg(hex.mid(0, 8)).arg(hex.mid(8, 4)).arg(hex.mid(12, 4)).arg(hex.mid(16, 4)).arg(hex.mid(20, 12));
+		}
+
+		QByteArray SyntheticAccountGenerator::createBytes(int size) {
+			QByteArray result(size, '\0');
+			for (int i = 0; i < size; i += 8) {
+				quint64 const value = m_random();
+				for (int j = 0; (j < 8) && ((i + j) < size); ++j) {
+					result[i + j] = static_cast<char>((value >> (8 * j)) & 0xFF);
+				}
+			}
+			return result;
+		}
+
+		int SyntheticAccountGenerator::randomInt(int min, int max) {
+			// Not std::uniform_int_distribution, whose results differ between standard libraries.
+			quint64 const range = static_cast<quint64>(static_cast<qint64>(max) - min) + 1;
+			return static_cast<int>(min + static_cast<qint64>(m_random() % range));
+		}
+
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef OPENMITTSU_BUILDTOOLS_BENCHMARK_SYNTHETICACCOUNTGENERATOR_H_
+#define OPENMITTSU_BUILDTOOLS_BENCHMARK_SYNTHETICACCOUNTGENERATOR_H_
+
+#include <QByteArray>
+#include <QDir>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <random>
+#include <vector>
+
+#include "src/crypto/KeyPair.h"
+#include "src/protocol/ContactId.h"
+#include "src/protocol/GroupId.h"
+
+namespace openmittsu {
+	namespace benchmark {
+
+		/**
+		 * Writes a data backup of a synthetic account in the layout read by BackupImporter, used by the benchmark and the tests.
+		 * Everything is derived from the seed, so the same settings always yield the same contacts, groups, messages and media. Only the identity
+		 * backup differs between runs, as its encryption uses a random salt.
+		 */
+		class SyntheticAccountGenerator {
+		public:
+			enum class Distribution {
+				/** Every conversation gets about the same number of messages. */
+				UNIFORM,
+				/** The conversation of rank r gets a share proportional to 1/r, like real accounts with a few very active chats. */
+				ZIPF
+			};
+
+			struct Settings {
+				int contactCount;
+				int groupCount;
+				/** The number of messages over all conversations. */
+				qint64 messageCount;
+				Distribution distribution;
+				int mediaCount;
+				int mediaSize;
+				/** Shares of the text messages with several lines and with non-Latin characters and emoji. */
+				int multiLinePercent;
+				int unicodePercent;
+				quint64 seed;
+			};
+
+			struct Statistics {
+				int contacts;
+				int groups;
+				qint64 contactMessages;
+				qint64 groupMessages;
+				int contactMediaItems;
+				int groupMediaItems;
+				int files;
+				qint64 totalBytes;
+			};
+
+			explicit SyntheticAccountGenerator(Settings const& settings);
+			/** Uses the given identity instead of deriving one from the seed, so the backup can be imported into an existing database of that identity. */
+			SyntheticAccountGenerator(Settings const& settings, openmittsu::protocol::ContactId const& selfContactId, openmittsu::crypto::KeyPair const& selfKeyPair);
+			virtual ~SyntheticAccountGenerator();
+
+			/** Writes the backup into the empty directory path, the identity backup is encrypted with backupPassword. */
+			void writeBackup(QDir const& path, QString const& backupPassword);
+
+			Statistics const& getStatistics() const;
+			openmittsu::protocol::ContactId const& getSelfContactId() const;
+			openmittsu::crypto::KeyPair const& getSelfKeyPair() const;
+
+			/** The conversations ordered by the number of their messages, largest first. */
+			QList<openmittsu::protocol::ContactId> const& getContacts() const;
+			QList<openmittsu::protocol::GroupId> const& getGroups() const;
+
+			static Settings getDefaultSettings();
+			static QString toString(Distribution distribution);
+		private:
+			Settings const m_settings;
+			std::mt19937_64 m_random;
+			Statistics m_statistics;
+			openmittsu::protocol::ContactId m_selfContactId;
+			openmittsu::crypto::KeyPair m_selfKeyPair;
+			QList<openmittsu::protocol::ContactId> m_contacts;
+			QList<openmittsu::protocol::GroupId> m_groups;
+			QList<QList<openmittsu::protocol::ContactId>> m_groupSenders;
+
+			/** Every mediaInterval-th message carries a media item. */
+			qint64 m_mediaInterval;
+			qint64 m_writtenMessages;
+
+			void createConversations();
+			void writeIdentity(QDir const& path, QString const& backupPassword);
+			void writeContacts(QDir const& path);
+			void writeGroups(QDir const& path);
+			void writeContactMessages(QDir const& path, openmittsu::protocol::ContactId const& contact, int conversationIndex, qint64 messageCount);
+			void writeGroupMessages(QDir const& path, openmittsu::protocol::GroupId const& group, int conversationIndex, qint64 messageCount);
+			void writeMediaFile(QDir const& path, QString const& fileName);
+
+			std::vector<qint64> getMessageCounts(int conversationCount);
+			bool isMediaMessage();
+			QString createBody();
+			QString createUuid();
+			QByteArray createBytes(int size);
+			int randomInt(int min, int max);
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_BUILDTOOLS_BENCHMARK_SYNTHETICACCOUNTGENERATOR_H_
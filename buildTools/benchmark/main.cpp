@@ -0,0 +1,354 @@
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#define OPENMITTSU_TESTS
+#include "Init.h"
+
+#include "buildTools/benchmark/SyntheticAccountGenerator.h"
+#include "src/backup/BackupImporter.h"
+#include "src/backup/IdentityBackup.h"
+#include "src/backup/IdentityBackupObject.h"
+#include "src/database/SimpleDatabase.h"
+#include "src/database/internal/DatabaseContactMessageCursor.h"
+#include "src/database/internal/DatabaseGroupMessageCursor.h"
+#include "src/utility/MakeUnique.h"
+
+using openmittsu::benchmark::SyntheticAccountGenerator;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double secondsSince(Clock::time_point const& start) {
+		std::chrono::duration<double> const duration = Clock::now() - start;
+		return duration.count();
+	}
+
+	/** Reads a value in kB from /proc/self/status, as the peak resident set size is not available through a portable API. */
+	qint64 readProcStatusKilobytes(QString const& key) {
+		QFile file(QStringLiteral("/proc/self/status"));
+		if (!file.open(QFile::ReadOnly | QFile::Text)) {
+			return -1;
+		}
+		QString const prefix = key + QChar(':');
+		for (QByteArray const& line : file.readAll().split('\n')) {
+			QString const text = QString::fromLatin1(line);
+			if (text.startsWith(prefix)) {
+				return text.mid(prefix.size()).trimmed().section(QChar(' '), 0, 0).toLongLong();
+			}
+		}
+		return -1;
+	}
+
+	QJsonObject getMemoryUsage() {
+		qint64 currentKilobytes = readProcStatusKilobytes(QStringLiteral("VmRSS"));
+		qint64 peakKilobytes = readProcStatusKilobytes(QStringLiteral("VmHWM"));
+#if defined(Q_OS_UNIX)
+		if (peakKilobytes < 0) {
+			struct rusage usage;
+			if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(Q_OS_MACOS)
+				peakKilobytes = usage.ru_maxrss / 1024;
+#else
+				peakKilobytes = usage.ru_maxrss;
+#endif
+			}
+		}
+#endif
+		QJsonObject result;
+		result.insert(QStringLiteral("currentResidentBytes"), (currentKilobytes < 0) ? -1.0 : currentKilobytes * 1024.0);
+		result.insert(QStringLiteral("peakResidentBytes"), (peakKilobytes < 0) ? -1.0 : peakKilobytes * 1024.0);
+		return result;
+	}
+
+	QJsonObject toJson(SyntheticAccountGenerator::Settings const& settings) {
+		QJsonObject result;
+		result.insert(QStringLiteral("contacts"), settings.contactCount);
+		result.insert(QStringLiteral("groups"), settings.groupCount);
+		result.insert(QStringLiteral("messages"), static_cast<double>(settings.messageCount));
+		result.insert(QStringLiteral("distribution"), SyntheticAccountGenerator::toString(settings.distribution));
+		result.insert(QStringLiteral("mediaItems"), settings.mediaCount);
+		result.insert(QStringLiteral("mediaSize"), settings.mediaSize);
+		result.insert(QStringLiteral("multiLinePercent"), settings.multiLinePercent);
+		result.insert(QStringLiteral("unicodePercent"), settings.unicodePercent);
+		result.insert(QStringLiteral("seed"), QString::number(settings.seed));
+		return result;
+	}
+
+	/** Pages backwards through a conversation with pageCount pages of pageSize messages, the way the chat window loads history while scrolling up. */
+	template<typename Cursor>
+	QJsonObject measurePaging(Cursor& cursor, QString const& conversation, int pageSize, int pageCount) {
+		Clock::time_point const start = Clock::now();
+		int pages = 0;
+		qint64 messages = 0;
+		double firstPageSeconds = 0.0;
+		if (cursor.seekToLast()) {
+			bool hasMore = true;
+			while (hasMore && (pages < pageCount)) {
+				messages += cursor.getLastMessages(pageSize).size();
+				for (int i = 0; hasMore && (i < pageSize); ++i) {
+					hasMore = cursor.previous();
+				}
+				++pages;
+				if (pages == 1) {
+					firstPageSeconds = secondsSince(start);
+				}
+			}
+		}
+		double const seconds = secondsSince(start);
+
+		QJsonObject result;
+		result.insert(QStringLiteral("conversation"), conversation);
+		result.insert(QStringLiteral("pages"), pages);
+		result.insert(QStringLiteral("messages"), static_cast<double>(messages));
+		result.insert(QStringLiteral("firstPageSeconds"), firstPageSeconds);
+		result.insert(QStringLiteral("seconds"), seconds);
+		result.insert(QStringLiteral("secondsPerPage"), (pages > 0) ? (seconds / pages) : 0.0);
+		return result;
+	}
+
+	bool parsePositive(QCommandLineParser const& parser, QCommandLineOption const& option, qint64 minimum, qint64& value) {
+		if (!parser.isSet(option)) {
+			return true;
+		}
+		bool ok = false;
+		value = parser.value(option).toLongLong(&ok);
+		if (!ok || (value < minimum)) {
+			std::cerr << "Invalid value \"" << parser.value(option).toStdString() << "\" for option --" << option.names().first().toStdString() << "." << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (!initializeLogging(OPENMITTSU_LOGGING_MAX_FILESIZE, OPENMITTSU_LOGGING_MAX_FILECOUNT)) {
+		return -2;
+	}
+
+	OPENMITTSU_REGISTER_TYPES();
+	QCoreApplication application(argc, argv);
+	QCoreApplication::setApplicationName(QStringLiteral("openMittsuBenchmark"));
+	if (!initializeLibSodium()) {
+		return -3;
+	}
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QStringLiteral("Generates a synthetic large account and measures backup import, database unlock and history paging on it."));
+	parser.addHelpOption();
+	QCommandLineOption const outputOption(QStringLiteral("output"), QStringLiteral("Empty working directory for the backup and the database."), QStringLiteral("directory"));
+	QCommandLineOption const contactsOption(QStringLiteral("contacts"), QStringLiteral("Number of contacts."), QStringLiteral("count"));
+	QCommandLineOption const groupsOption(QStringLiteral("groups"), QStringLiteral("Number of groups."), QStringLiteral("count"));
+	QCommandLineOption const messagesOption(QStringLiteral("messages"), QStringLiteral("Number of messages over all conversations."), QStringLiteral("count"));
+	QCommandLineOption const distributionOption(QStringLiteral("distribution"), QStringLiteral("Distribution of messages over conversations, zipf or uniform."), QStringLiteral("name"));
+	QCommandLineOption const mediaOption(QStringLiteral("media"), QStringLiteral("Number of media items."), QStringLiteral("count"));
+	QCommandLineOption const mediaSizeOption(QStringLiteral("media-size"), QStringLiteral("Average size of a media item in bytes."), QStringLiteral("bytes"));
+	QCommandLineOption const multiLineOption(QStringLiteral("multiline"), QStringLiteral("Percentage of messages with several lines."), QStringLiteral("percent"));
+	QCommandLineOption const unicodeOption(QStringLiteral("unicode"), QStringLiteral("Percentage of messages with non-Latin text and emoji."), QStringLiteral("percent"));
+	QCommandLineOption const seedOption(QStringLiteral("seed"), QStringLiteral("Seed of the generator."), QStringLiteral("seed"));
+	QCommandLineOption const passwordOption(QStringLiteral("password"), QStringLiteral("Password of the identity backup and the database."), QStringLiteral("password"), QStringLiteral("benchmark-password"));
+	QCommandLineOption const pageSizeOption(QStringLiteral("page-size"), QStringLiteral("Messages per history page."), QStringLiteral("count"));
+	QCommandLineOption const pagesOption(QStringLiteral("pages"), QStringLiteral("History pages loaded per conversation."), QStringLiteral("count"));
+	QCommandLineOption const openRunsOption(QStringLiteral("open-runs"), QStringLiteral("How often the database is opened and unlocked."), QStringLiteral("count"));
+	QCommandLineOption const reportOption(QStringLiteral("report"), QStringLiteral("File for the JSON report, defaults to report.json in the output directory."), QStringLiteral("file"));
+	parser.addOptions({ outputOption, contactsOption, groupsOption, messagesOption, distributionOption, mediaOption, mediaSizeOption, multiLineOption, unicodeOption, seedOption, passwordOption, pageSizeOption, pagesOption, openRunsOption, reportOption });
+	parser.process(application);
+
+	if (!parser.isSet(outputOption)) {
+		std::cerr << "The option --output is required." << std::endl;
+		return 1;
+	}
+
+	SyntheticAccountGenerator::Settings settings = SyntheticAccountGenerator::getDefaultSettings();
+	qint64 contacts = settings.contactCount;
+	qint64 groups = settings.groupCount;
+	qint64 media = settings.mediaCount;
+	qint64 mediaSize = settings.mediaSize;
+	qint64 multiLine = settings.multiLinePercent;
+	qint64 unicode = settings.unicodePercent;
+	qint64 seed = static_cast<qint64>(settings.seed);
+	qint64 pageSize = 50;
+	qint64 pageCount = 20;
+	qint64 openRuns = 3;
+	if (!parsePositive(parser, contactsOption, 1, contacts) || !parsePositive(parser, groupsOption, 0, groups) || !parsePositive(parser, messagesOption, 0, settings.messageCount) || !parsePositive(parser, mediaOption, 0, media)
+		|| !parsePositive(parser, mediaSizeOption, 1, mediaSize) || !parsePositive(parser, multiLineOption, 0, multiLine) || !parsePositive(parser, unicodeOption, 0, unicode) || !parsePositive(parser, seedOption, 0, seed)
+		|| !parsePositive(parser, pageSizeOption, 1, pageSize) || !parsePositive(parser, pagesOption, 1, pageCount) || !parsePositive(parser, openRunsOption, 1, openRuns)) {
+		return 1;
+	}
+	settings.contactCount = static_cast<int>(contacts);
+	settings.groupCount = static_cast<int>(groups);
+	settings.mediaCount = static_cast<int>(media);
+	settings.mediaSize = static_cast<int>(mediaSize);
+	settings.multiLinePercent = static_cast<int>(multiLine);
+	settings.unicodePercent = static_cast<int>(unicode);
+	settings.seed = static_cast<quint64>(seed);
+	if (parser.isSet(distributionOption)) {
+		QString const distribution = parser.value(distributionOption).toLower();
+		if (distribution == SyntheticAccountGenerator::toString(SyntheticAccountGenerator::Distribution::ZIPF)) {
+			settings.distribution = SyntheticAccountGenerator::Distribution::ZIPF;
+		} else if (distribution == SyntheticAccountGenerator::toString(SyntheticAccountGenerator::Distribution::UNIFORM)) {
+			settings.distribution = SyntheticAccountGenerator::Distribution::UNIFORM;
+		} else {
+			std::cerr << "Unknown distribution \"" << distribution.toStdString() << "\", use zipf or uniform." << std::endl;
+			return 1;
+		}
+	}
+
+	QDir const outputPath(parser.value(outputOption));
+	QDir const backupPath(outputPath.filePath(QStringLiteral("backup")));
+	QDir const mediaPath(outputPath.filePath(QStringLiteral("media")));
+	QString const databaseFilename = outputPath.filePath(QStringLiteral("openmittsu.sqlite"));
+	QString const reportFilename = parser.isSet(reportOption) ? parser.value(reportOption) : outputPath.filePath(QStringLiteral("report.json"));
+	QString const password = parser.value(passwordOption);
+
+	QJsonObject report;
+	report.insert(QStringLiteral("settings"), toJson(settings));
+	try {
+		if (!outputPath.exists() && !outputPath.mkpath(QStringLiteral("."))) {
+			std::cerr << "Could not create the output directory." << std::endl;
+			return 1;
+		} else if (!outputPath.entryList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot).isEmpty()) {
+			std::cerr << "The output directory is not empty." << std::endl;
+			return 1;
+		}
+
+		std::cout << "Generating the synthetic account..." << std::endl;
+		SyntheticAccountGenerator generator(settings);
+		{
+			Clock::time_point const start = Clock::now();
+			generator.writeBackup(backupPath, password);
+			SyntheticAccountGenerator::Statistics const& statistics = generator.getStatistics();
+
+			QJsonObject generation;
+			generation.insert(QStringLiteral("seconds"), secondsSince(start));
+			generation.insert(QStringLiteral("contacts"), statistics.contacts);
+			generation.insert(QStringLiteral("groups"), statistics.groups);
+			generation.insert(QStringLiteral("contactMessages"), static_cast<double>(statistics.contactMessages));
+			generation.insert(QStringLiteral("groupMessages"), static_cast<double>(statistics.groupMessages));
+			generation.insert(QStringLiteral("mediaItems"), statistics.contactMediaItems + statistics.groupMediaItems);
+			generation.insert(QStringLiteral("files"), statistics.files);
+			generation.insert(QStringLiteral("bytes"), static_cast<double>(statistics.totalBytes));
+			report.insert(QStringLiteral("generation"), generation);
+		}
+
+		// Decrypting the identity backup is dominated by the key derivation, the same work as entering the backup password in the wizard.
+		std::cout << "Unlocking the identity backup..." << std::endl;
+		{
+			Clock::time_point const start = Clock::now();
+			openmittsu::backup::IdentityBackup const identityBackup = openmittsu::backup::IdentityBackup::fromBackupString(openmittsu::backup::IdentityBackupObject::fromFile(backupPath).getBackupString(), password);
+			QJsonObject identity;
+			identity.insert(QStringLiteral("seconds"), secondsSince(start));
+			identity.insert(QStringLiteral("contactId"), identityBackup.getClientContactId().toQString());
+			report.insert(QStringLiteral("identityUnlock"), identity);
+		}
+
+		std::cout << "Importing the backup..." << std::endl;
+		{
+			if (!mediaPath.mkpath(QStringLiteral("."))) {
+				std::cerr << "Could not create the media directory." << std::endl;
+				return 1;
+			}
+			openmittsu::database::SimpleDatabase database(databaseFilename, generator.getSelfContactId(), generator.getSelfKeyPair(), password, mediaPath);
+			openmittsu::backup::BackupImporter importer(database, backupPath);
+
+			Clock::time_point const start = Clock::now();
+			importer.run();
+			double const seconds = secondsSince(start);
+			openmittsu::backup::BackupImporter::Statistics const& statistics = importer.getStatistics();
+			qint64 const messages = static_cast<qint64>(statistics.contactMessages) + statistics.groupMessages;
+
+			QJsonObject import;
+			import.insert(QStringLiteral("seconds"), seconds);
+			import.insert(QStringLiteral("messages"), static_cast<double>(messages));
+			import.insert(QStringLiteral("messagesPerSecond"), (seconds > 0.0) ? (messages / seconds) : 0.0);
+			import.insert(QStringLiteral("mediaItems"), statistics.contactMediaItems + statistics.groupMediaItems);
+			import.insert(QStringLiteral("bytes"), static_cast<double>(statistics.totalBytes));
+			import.insert(QStringLiteral("bytesPerSecond"), (seconds > 0.0) ? (statistics.totalBytes / seconds) : 0.0);
+			import.insert(QStringLiteral("peakBatchBytes"), static_cast<double>(statistics.peakBatchBytes));
+			import.insert(QStringLiteral("memory"), getMemoryUsage());
+			report.insert(QStringLiteral("import"), import);
+		}
+		report.insert(QStringLiteral("databaseBytes"), static_cast<double>(QFileInfo(databaseFilename).size()));
+
+		// Opening includes the SQLCipher key derivation and the schema checks done on every start.
+		std::cout << "Opening the database..." << std::endl;
+		std::unique_ptr<openmittsu::database::SimpleDatabase> database;
+		{
+			QJsonArray runs;
+			double totalSeconds = 0.0;
+			for (int i = 0; i < openRuns; ++i) {
+				database = nullptr;
+				Clock::time_point const start = Clock::now();
+				database = std::make_unique<openmittsu::database::SimpleDatabase>(databaseFilename, password, mediaPath);
+				double const seconds = secondsSince(start);
+				runs.append(seconds);
+				totalSeconds += seconds;
+			}
+
+			QJsonObject open;
+			open.insert(QStringLiteral("runs"), runs);
+			open.insert(QStringLiteral("averageSeconds"), totalSeconds / openRuns);
+			open.insert(QStringLiteral("contactMessages"), database->getContactMessageCount());
+			open.insert(QStringLiteral("groupMessages"), database->getGroupMessageCount());
+			open.insert(QStringLiteral("mediaItems"), database->getMediaItemCount());
+			report.insert(QStringLiteral("open"), open);
+		}
+
+		// The largest conversations are the worst case for scrolling, the smallest show the fixed overhead.
+		std::cout << "Paging through the message history..." << std::endl;
+		{
+			QJsonArray paging;
+			QList<openmittsu::protocol::ContactId> const& contactList = generator.getContacts();
+			for (int i : { 0, contactList.size() - 1 }) {
+				openmittsu::database::internal::DatabaseContactMessageCursor cursor = database->getMessageCursor(contactList.at(i));
+				paging.append(measurePaging(cursor, contactList.at(i).toQString(), static_cast<int>(pageSize), static_cast<int>(pageCount)));
+			}
+			QList<openmittsu::protocol::GroupId> const& groupList = generator.getGroups();
+			if (!groupList.isEmpty()) {
+				openmittsu::database::internal::DatabaseGroupMessageCursor cursor = database->getMessageCursor(groupList.first());
+				paging.append(measurePaging(cursor, groupList.first().toQString(), static_cast<int>(pageSize), static_cast<int>(pageCount)));
+			}
+
+			Clock::time_point const start = Clock::now();
+			int const uuidCount = database->getLastMessageUuids(contactList.first(), static_cast<std::size_t>(pageSize)).size();
+			QJsonObject lastMessages;
+			lastMessages.insert(QStringLiteral("messages"), uuidCount);
+			lastMessages.insert(QStringLiteral("seconds"), secondsSince(start));
+
+			QJsonObject history;
+			history.insert(QStringLiteral("pageSize"), static_cast<double>(pageSize));
+			history.insert(QStringLiteral("conversations"), paging);
+			history.insert(QStringLiteral("lastMessageUuids"), lastMessages);
+			report.insert(QStringLiteral("history"), history);
+		}
+		report.insert(QStringLiteral("memory"), getMemoryUsage());
+	} catch (std::exception& e) {
+		std::cerr << "The benchmark failed: " << e.what() << std::endl;
+		return 2;
+	}
+
+	QFile reportFile(reportFilename);
+	QByteArray const json = QJsonDocument(report).toJson();
+	if (!reportFile.open(QFile::WriteOnly | QFile::Truncate) || (reportFile.write(json) != json.size())) {
+		std::cerr << "Could not write the report to \"" << reportFilename.toStdString() << "\"." << std::endl;
+		return 1;
+	}
+	std::cout << json.toStdString();
+	return 0;
+}
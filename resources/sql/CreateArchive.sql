@@ -0,0 +1,65 @@
+CREATE TABLE IF NOT EXISTS `archive`.`table_versions` (
+	`table_name`	TEXT NOT NULL UNIQUE,
+	`version`	INTEGER NOT NULL,
+	PRIMARY KEY(table_name)
+);
+__OPENMITTSU_QUERY_SEP__
+CREATE TABLE IF NOT EXISTS `archive`.`contact_messages` (
+	`identity`				TEXT,
+	`apiid`					TEXT,
+	`uid`					TEXT UNIQUE,
+	`is_outbox`				INTEGER NOT NULL DEFAULT 0 CHECK(is_outbox IN (0, 1)),
+	`is_read`				INTEGER NOT NULL DEFAULT 0 CHECK(is_read IN (0, 1)),
+	`is_saved`				INTEGER NOT NULL DEFAULT 0 CHECK(is_saved IN (0, 1)),
+	`messagestate`			TEXT,
+	`sort_by`				INTEGER,
+	`created_at`			INTEGER,
+	`sent_at`				INTEGER,
+	`received_at`			INTEGER,
+	`seen_at`				INTEGER,
+	`modified_at`			INTEGER,
+	`contact_message_type`	TEXT,
+	`body`					TEXT,
+	`is_statusmessage`		INTEGER NOT NULL DEFAULT 0 CHECK(is_statusmessage IN (0, 1)),
+	`is_queued`				INTEGER NOT NULL DEFAULT 0 CHECK(is_queued IN (0, 1)),
+	`is_sent`				INTEGER NOT NULL DEFAULT 0 CHECK(is_sent IN (0, 1)),
+	`caption`				TEXT,
+	PRIMARY KEY(`uid`)
+);
+__OPENMITTSU_QUERY_SEP__
+CREATE TABLE IF NOT EXISTS `archive`.`group_messages` (
+	`group_id`				TEXT,
+	`group_creator`			TEXT,
+	`apiid`					TEXT,
+	`uid`					TEXT UNIQUE,
+	`identity`				TEXT,
+	`is_outbox`				INTEGER NOT NULL DEFAULT 0 CHECK(is_outbox IN (0, 1)),
+	`is_read`				INTEGER NOT NULL DEFAULT 0 CHECK(is_read IN (0, 1)),
+	`is_saved`				INTEGER NOT NULL DEFAULT 0 CHECK(is_saved IN (0, 1)),
+	`messagestate`			TEXT,
+	`sort_by`				INTEGER,
+	`created_at`			INTEGER,
+	`sent_at`				INTEGER,
+	`received_at`			INTEGER,
+	`seen_at`				INTEGER,
+	`modified_at`			INTEGER,
+	`group_message_type`	TEXT,
+	`body`					TEXT,
+	`is_statusmessage`		INTEGER NOT NULL DEFAULT 0 CHECK(is_statusmessage IN (0, 1)),
+	`is_queued`				INTEGER NOT NULL DEFAULT 0 CHECK(is_queued IN (0, 1)),
+	`is_sent`				INTEGER NOT NULL DEFAULT 0 CHECK(is_sent IN (0, 1)),
+	`caption`			TEXT,
+	PRIMARY KEY(`uid`)
+);
+__OPENMITTSU_QUERY_SEP__
+CREATE TABLE IF NOT EXISTS `archive`.`media` (
+	`uid`	TEXT,
+	`type`	INTEGER DEFAULT 1,
+	`size`	INTEGER NOT NULL,
+	`checksum`	INTEGER NOT NULL,
+	`nonce`	TEXT NOT NULL,
+	`key`	TEXT NOT NULL,
+	`format`	INTEGER NOT NULL DEFAULT 1,
+	`content_id`	TEXT,
+	PRIMARY KEY(`uid`,`type`)
+);
@@ -0,0 +1,7 @@
+CREATE TABLE `backup_import_journal` (
+	`file_name`		TEXT NOT NULL,
+	`offset`		INTEGER NOT NULL DEFAULT 0,
+	`is_complete`	INTEGER NOT NULL DEFAULT 0 CHECK(is_complete IN (0, 1)),
+	`fingerprint`	TEXT NOT NULL DEFAULT '',
+	PRIMARY KEY(`file_name`)
+);
\ No newline at end of file
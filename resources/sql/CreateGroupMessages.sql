@@ -21,4 +21,6 @@ CREATE TABLE `group_messages` (
 	`is_sent`				INTEGER NOT NULL DEFAULT 0 CHECK(is_sent IN (0, 1)),
 	`caption`			TEXT,
 	PRIMARY KEY(`uid`)
-);
\ No newline at end of file
+);
+__OPENMITTSU_QUERY_SEP__
+CREATE INDEX `group_messages_sort_by` ON `group_messages` (`sort_by`, `uid`);
\ No newline at end of file
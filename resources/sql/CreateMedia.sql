@@ -5,5 +5,9 @@ CREATE TABLE `media` (
 	`checksum`	INTEGER NOT NULL,
 	`nonce`		TEXT NOT NULL,
 	`key`		TEXT NOT NULL,
+	`format`	INTEGER NOT NULL DEFAULT 1,
+	`content_id`	TEXT,
 	PRIMARY KEY(uid)
-);
\ No newline at end of file
+);
+__OPENMITTSU_QUERY_SEP__
+CREATE INDEX `media_type_size` ON `media` (`type`, `size`, `uid`);
\ No newline at end of file
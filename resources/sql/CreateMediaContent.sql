@@ -0,0 +1,9 @@
+CREATE TABLE `media_content` (
+	`content_id`	TEXT NOT NULL,
+	`size`			INTEGER NOT NULL,
+	`checksum`		INTEGER NOT NULL,
+	`nonce`			TEXT NOT NULL,
+	`key`			TEXT NOT NULL,
+	`refcount`		INTEGER NOT NULL DEFAULT 0,
+	PRIMARY KEY(`content_id`)
+);
\ No newline at end of file
@@ -0,0 +1,7 @@
+CREATE TABLE `media_damage` (
+	`uid`			TEXT NOT NULL,
+	`type`			INTEGER NOT NULL,
+	`status`		INTEGER NOT NULL,
+	`detected_at`	INTEGER NOT NULL,
+	PRIMARY KEY(`uid`, `type`)
+);
\ No newline at end of file
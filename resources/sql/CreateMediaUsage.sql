@@ -0,0 +1,6 @@
+CREATE TABLE `media_usage` (
+	`type`			INTEGER NOT NULL,
+	`is_evicted`	INTEGER NOT NULL CHECK(is_evicted IN (0, 1)),
+	`bytes`			INTEGER NOT NULL DEFAULT 0,
+	PRIMARY KEY(`type`, `is_evicted`)
+);
\ No newline at end of file
@@ -0,0 +1 @@
+CREATE INDEX IF NOT EXISTS `archive`.`contact_messages_sort_by` ON `contact_messages` (`sort_by`, `uid`);
\ No newline at end of file
@@ -0,0 +1 @@
+CREATE INDEX IF NOT EXISTS `archive`.`media_type_size` ON `media` (`type`, `size`, `uid`);
\ No newline at end of file
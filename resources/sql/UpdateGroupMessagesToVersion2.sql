@@ -0,0 +1 @@
+CREATE INDEX IF NOT EXISTS `group_messages_sort_by` ON `group_messages` (`sort_by`, `uid`);
\ No newline at end of file
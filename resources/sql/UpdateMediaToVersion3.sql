@@ -0,0 +1 @@
+ALTER TABLE `media` ADD COLUMN `format` INTEGER NOT NULL DEFAULT 1;
@@ -27,6 +27,7 @@
 #include "src/dialogs/ContactEditDialog.h"
 #include "src/dialogs/FingerprintDialog.h"
 #include "src/dialogs/LicenseDialog.h"
+#include "src/dialogs/MediaIntegrityDialog.h"
 #include "src/dialogs/OptionsDialog.h"
 #include "src/dialogs/ShowIdentityAndPublicKeyDialog.h"
 #include "src/dialogs/UpdaterDialog.h"
@@ -84,7 +85,8 @@ Client::Client(QWidget* parent) : QMainWindow(parent),
 	m_databaseThread(),
 	m_databasePointerAuthority(),
 	m_databaseWrapper(&m_databasePointerAuthority),
-	m_audioNotifier(std::make_shared<openmittsu::utility::AudioNotification>()) 
+	m_audioNotifier(std::make_shared<openmittsu::utility::AudioNotification>()),
+	m_dataBackupExportProgressDialog(nullptr)
 
 {
 	m_ui->setupUi(this);
@@ -107,6 +109,8 @@ Client::Client(QWidget* parent) : QMainWindow(parent),
 	OPENMITTSU_CONNECT(&m_databaseWrapper, groupChanged(openmittsu::protocol::GroupId const&), this, onDatabaseGroupChanged(openmittsu::protocol::GroupId const&));
 	OPENMITTSU_CONNECT(&m_databaseWrapper, receivedNewContactMessage(openmittsu::protocol::ContactId const&), this, onDatabaseReceivedNewContactMessage(openmittsu::protocol::ContactId const&));
 	OPENMITTSU_CONNECT(&m_databaseWrapper, receivedNewGroupMessage(openmittsu::protocol::GroupId const&), this, onDatabaseReceivedNewGroupMessage(openmittsu::protocol::GroupId const&));
+	OPENMITTSU_CONNECT(&m_databaseWrapper, dataBackupExportProgressUpdated(int), this, onDatabaseDataBackupExportProgressUpdated(int));
+	OPENMITTSU_CONNECT(&m_databaseWrapper, dataBackupExportFinished(bool, QString const&), this, onDatabaseDataBackupExportFinished(bool, QString const&));
 
 	// Check whether QSqlCipher is available
 	if (!QSqlDatabase::isDriverAvailable(QStringLiteral("QSQLCIPHER"))) {
@@ -177,6 +181,10 @@ Client::Client(QWidget* parent) : QMainWindow(parent),
 	OPENMITTSU_CONNECT(m_ui->actionShow_Fingerprint, triggered(), this, menuIdentityShowFingerprintOnClick());
 	OPENMITTSU_CONNECT(m_ui->actionShow_Public_Key, triggered(), this, menuIdentityShowPublicKeyOnClick());
 	OPENMITTSU_CONNECT(m_ui->actionImport_legacy_contacts_and_groups, triggered(), this, menuDatabaseImportLegacyContactsAndGroupsOnClick());
+	OPENMITTSU_CONNECT(m_ui->actionCompact_Database, triggered(), this, menuDatabaseCompactOnClick());
+	OPENMITTSU_CONNECT(m_ui->actionCheck_Media_Files, triggered(), this, menuDatabaseCheckMediaFilesOnClick());
+	OPENMITTSU_CONNECT(m_ui->actionRun_Maintenance, triggered(), this, menuDatabaseRunMaintenanceOnClick());
+	OPENMITTSU_CONNECT(m_ui->actionExport_Data_Backup, triggered(), this, menuDatabaseExportDataBackupOnClick());
 	OPENMITTSU_CONNECT(m_ui->actionStatistics, triggered(), this, menuAboutStatisticsOnClick());
 	OPENMITTSU_CONNECT(m_ui->actionOptions, triggered(), this, menuFileOptionsOnClick());
 	OPENMITTSU_CONNECT(m_ui->actionShow_First_Use_Wizard, triggered(), this, menuFileShowFirstUseWizardOnClick());
@@ -927,13 +935,26 @@ void Client::menuGroupAddOnClick() {
 }
 
 void Client::menuAboutStatisticsOnClick() {
-	if ((m_protocolClient == nullptr) || (!m_protocolClient->getIsConnected())) {
+	bool const isConnected = (m_protocolClient != nullptr) && m_protocolClient->getIsConnected();
+	if ((!isConnected) && (!m_databaseWrapper.hasDatabase())) {
 		QMessageBox::warning(this, "OpenMittsu - Statistics", "Not connected, can not show session statistics.");
-	} else {
+		return;
+	}
+
+	QString statistics;
+	if (isConnected) {
 		QDateTime now = QDateTime::currentDateTime();
 		quint64 seconds = m_protocolClient->getConnectedSince().secsTo(now);
-		QMessageBox::information(this, "OpenMittsu - Statistics", QString("Current session:\n\nTime connected: %1\nSend: %2 Bytes\nReceived: %3 Bytes\nMessages send: %4\nMessages received: %5").arg(formatDuration(seconds)).arg(QString::number(m_protocolClient->getSendBytesCount(), 10)).arg(QString::number(m_protocolClient->getReceivedBytesCount(), 10)).arg(QString::number(m_protocolClient->getSendMessagesCount(), 10)).arg(QString::number(m_protocolClient->getReceivedMessagesCount(), 10)));
+		statistics.append(QString("Current session:\n\nTime connected: %1\nSend: %2 Bytes\nReceived: %3 Bytes\nMessages send: %4\nMessages received: %5").arg(formatDuration(seconds)).arg(QString::number(m_protocolClient->getSendBytesCount(), 10)).arg(QString::number(m_protocolClient->getReceivedBytesCount(), 10)).arg(QString::number(m_protocolClient->getSendMessagesCount(), 10)).arg(QString::number(m_protocolClient->getReceivedMessagesCount(), 10)));
+	} else {
+		statistics.append(QString("Not connected, no session statistics available."));
+	}
+
+	if (m_databaseWrapper.hasDatabase()) {
+		openmittsu::database::MediaCacheStatistics const cacheStatistics = m_databaseWrapper.getMediaCacheStatistics();
+		statistics.append(QString("\n\nMedia cache:\n\nHits: %1\nMisses: %2\nEvictions: %3\nThumbnails: %4 Bytes\nImages and media: %5 Bytes").arg(cacheStatistics.hits).arg(cacheStatistics.misses).arg(cacheStatistics.evictions).arg(cacheStatistics.thumbnailBytes).arg(cacheStatistics.standardBytes));
 	}
+	QMessageBox::information(this, "OpenMittsu - Statistics", statistics);
 }
 
 void Client::menuGroupEditOnClick() {
@@ -1103,6 +1124,115 @@ void Client::menuDatabaseImportLegacyContactsAndGroupsOnClick(QString const& leg
 	}
 }
 
+void Client::menuDatabaseCompactOnClick() {
+	if (!m_databaseWrapper.hasDatabase()) {
+		QMessageBox::warning(this, "No database loaded", "Before you can use this feature you need to load a database from file (see main screen) or create one using a backup of your existing ID (see Identity -> Load Backup).");
+	} else if (m_databaseWrapper.isIncrementalVacuumEnabled()) {
+		QMessageBox::information(this, tr("Compact Database"), tr("This database is already compacted step by step while openMittsu is idle."));
+	} else {
+		auto const resultButton = QMessageBox::question(this, tr("Compact Database"), tr("This database was created by an older version of openMittsu and never gives space freed by deleted messages back to the file system.\nCompacting rewrites the database file once, which can take several minutes for a large database. openMittsu does not respond meanwhile. Afterwards, the database is compacted step by step while openMittsu is idle.\nCompact the database now?"));
+		if (resultButton != QMessageBox::StandardButton::Yes) {
+			return;
+		}
+
+		QApplication::setOverrideCursor(Qt::WaitCursor);
+		bool const isCompacted = m_databaseWrapper.enableIncrementalVacuum();
+		QApplication::restoreOverrideCursor();
+
+		if (isCompacted) {
+			QMessageBox::information(this, tr("Compact Database"), tr("The database was compacted successfully."));
+		} else {
+			QMessageBox::warning(this, tr("Compact Database"), tr("The database could not be compacted, it was left unchanged. See the log for details."));
+		}
+	}
+}
+
+void Client::menuDatabaseCheckMediaFilesOnClick() {
+	if (!m_databaseWrapper.hasDatabase()) {
+		QMessageBox::warning(this, "No database loaded", "Before you can use this feature you need to load a database from file (see main screen) or create one using a backup of your existing ID (see Identity -> Load Backup).");
+	} else {
+		openmittsu::dialogs::MediaIntegrityDialog mediaIntegrityDialog(m_databaseWrapper, this);
+		mediaIntegrityDialog.exec();
+	}
+}
+
+void Client::menuDatabaseRunMaintenanceOnClick() {
+	if (!m_databaseWrapper.hasDatabase()) {
+		QMessageBox::warning(this, "No database loaded", "Before you can use this feature you need to load a database from file (see main screen) or create one using a backup of your existing ID (see Identity -> Load Backup).");
+		return;
+	}
+
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	bool const isCompleted = m_databaseWrapper.runMaintenance();
+	QApplication::restoreOverrideCursor();
+
+	if (isCompleted) {
+		openmittsu::database::MaintenanceStatistics const statistics = m_databaseWrapper.getMaintenanceStatistics();
+		QMessageBox::information(this, tr("Run Maintenance"), tr("The maintenance run is complete.\n\nIn all %1 runs so far:\nMessages archived: %2\nMedia entries without messages removed: %3\nMedia files converted: %4\nUnreferenced media files removed: %5\nMedia removed to stay within the disk space for media: %6\nDatabase pages given back: %7").arg(statistics.runsCompleted).arg(statistics.messagesArchived).arg(statistics.mediaRowsRemoved).arg(statistics.mediaFilesMigrated).arg(statistics.mediaFilesRemoved).arg(statistics.mediaItemsEvicted).arg(statistics.pagesFreed));
+	} else {
+		QMessageBox::warning(this, tr("Run Maintenance"), tr("The maintenance run failed, it resumes where it stopped the next time openMittsu is idle. See the log for details."));
+	}
+}
+
+void Client::menuDatabaseExportDataBackupOnClick() {
+	if (!m_databaseWrapper.hasDatabase()) {
+		QMessageBox::warning(this, "No database loaded", "Before you can use this feature you need to load a database from file (see main screen) or create one using a backup of your existing ID (see Identity -> Load Backup).");
+		return;
+	} else if (m_dataBackupExportProgressDialog) {
+		QMessageBox::information(this, tr("Export Data Backup"), tr("A data backup is already being exported."));
+		return;
+	}
+
+	QString const backupPath = QFileDialog::getExistingDirectory(this, tr("Select an empty folder for the data backup"));
+	if (backupPath.isEmpty()) {
+		return;
+	} else if (!QDir(backupPath).entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot).isEmpty()) {
+		QMessageBox::warning(this, tr("Export Data Backup"), tr("The selected folder is not empty. Please select an empty folder for the data backup."));
+		return;
+	}
+
+	bool ok = false;
+	QString const backupPassword = QInputDialog::getText(this, tr("Export Data Backup"), tr("Please enter a password for the data backup. It is needed to import the backup again:"), QLineEdit::Password, QString(), &ok);
+	if (!ok) {
+		return;
+	} else if (backupPassword.isEmpty()) {
+		QMessageBox::warning(this, tr("Export Data Backup"), tr("The password of a data backup can not be empty."));
+		return;
+	}
+	QString const repeatedPassword = QInputDialog::getText(this, tr("Export Data Backup"), tr("Please repeat the password:"), QLineEdit::Password, QString(), &ok);
+	if (!ok) {
+		return;
+	} else if (repeatedPassword != backupPassword) {
+		QMessageBox::warning(this, tr("Export Data Backup"), tr("The passwords do not match."));
+		return;
+	}
+
+	// The backup is written on the database thread, which answers other requests only once it is done.
+	m_dataBackupExportProgressDialog = std::make_unique<QProgressDialog>(tr("Exporting the data backup to %1...\nopenMittsu may not respond until it is done.").arg(backupPath), QString(), 0, 100, this);
+	m_dataBackupExportProgressDialog->setWindowTitle(tr("Export Data Backup"));
+	m_dataBackupExportProgressDialog->setWindowModality(Qt::WindowModal);
+	m_dataBackupExportProgressDialog->setMinimumDuration(0);
+	m_dataBackupExportProgressDialog->setValue(0);
+
+	m_databaseWrapper.exportDataBackup(backupPath, backupPassword);
+}
+
+void Client::onDatabaseDataBackupExportProgressUpdated(int percentComplete) {
+	if (m_dataBackupExportProgressDialog) {
+		m_dataBackupExportProgressDialog->setValue(percentComplete);
+	}
+}
+
+void Client::onDatabaseDataBackupExportFinished(bool hadError, QString const& errorMessage) {
+	m_dataBackupExportProgressDialog = nullptr;
+
+	if (hadError) {
+		QMessageBox::warning(this, tr("Export Data Backup"), errorMessage);
+	} else {
+		QMessageBox::information(this, tr("Export Data Backup"), tr("The data backup was exported successfully. It can be imported again with Identity -> Load Backup."));
+	}
+}
+
 QString Client::formatDuration(quint64 duration) const {
 	QString const result(QStringLiteral("%1 days, %2:%3:%4"));
 	quint64 seconds = duration;
@@ -7,6 +7,7 @@
 #include <QHash>
 #include <QListWidgetItem>
 #include <QMainWindow>
+#include <QProgressDialog>
 #include <QSettings>
 #include <QString>
 #include <QThread>
@@ -73,6 +74,10 @@ private slots:
 	void menuIdentityCreateBackupOnClick();
 	void menuIdentityLoadBackupOnClick(QString const& legacyClientConfigurationFileName = "");
 	void menuDatabaseImportLegacyContactsAndGroupsOnClick(QString const& legacyContactsFileName = "");
+	void menuDatabaseCompactOnClick();
+	void menuDatabaseCheckMediaFilesOnClick();
+	void menuDatabaseRunMaintenanceOnClick();
+	void menuDatabaseExportDataBackupOnClick();
 
 	// Updater
 	void updaterFoundNewVersion(int versionMajor, int versionMinor, int versionPatch, int commitsSinceTag, QString gitHash, QString channel, QString link);
@@ -85,6 +90,8 @@ public slots:
 	void onDatabaseGroupChanged(openmittsu::protocol::GroupId const& group);
 	void onDatabaseReceivedNewContactMessage(openmittsu::protocol::ContactId const& contact);
 	void onDatabaseReceivedNewGroupMessage(openmittsu::protocol::GroupId const& group);
+	void onDatabaseDataBackupExportProgressUpdated(int percentComplete);
+	void onDatabaseDataBackupExportFinished(bool hadError, QString const& errorMessage);
 	
 	void onMessageCenterHasUnreadMessageContact(openmittsu::protocol::ContactId const& contact);
 	void onMessageCenterHasUnreadMessageGroup(openmittsu::protocol::GroupId const& group);
@@ -133,6 +140,7 @@ private:
 	openmittsu::database::DatabaseWrapper m_databaseWrapper;
 
 	std::shared_ptr<openmittsu::utility::AudioNotification> m_audioNotifier;
+	std::unique_ptr<QProgressDialog> m_dataBackupExportProgressDialog;
 
 	void openDatabaseFile(QString const& fileName);
 	bool validateDatabaseFile(QString const& databaseFileName, QString const& password, bool quiet = false);
@@ -27,10 +27,14 @@
 // For Type registration
 #include "src/crypto/PublicKey.h"
 #include "src/database/ContactData.h"
+#include "src/database/DamagedMediaItem.h"
 #include "src/database/DatabaseSeekResult.h"
 #include "src/database/DatabaseThreadWorker.h"
 #include "src/database/DatabaseWrapperFactory.h"
 #include "src/database/GroupData.h"
+#include "src/database/MaintenanceStatistics.h"
+#include "src/database/MediaCacheStatistics.h"
+#include "src/database/MediaIntegrityReport.h"
 #include "src/database/NewContactData.h"
 #include "src/database/NewGroupData.h"
 #include "src/dataproviders/NetworkSentMessageAcceptor.h"
@@ -57,6 +61,8 @@
 	qRegisterMetaType<openmittsu::crypto::PublicKey>(); \
 	qRegisterMetaType<openmittsu::database::ContactData>("ContactData"); \
 	qRegisterMetaType<openmittsu::database::ContactData>("openmittsu::database::ContactData"); \
+	qRegisterMetaType<openmittsu::database::DamagedMediaItem>("DamagedMediaItem"); \
+	qRegisterMetaType<openmittsu::database::DamagedMediaItem>("openmittsu::database::DamagedMediaItem"); \
 	qRegisterMetaType<openmittsu::database::DatabaseSeekResult>("DatabaseSeekResult"); \
 	qRegisterMetaType<openmittsu::database::DatabaseSeekResult>("openmittsu::database::DatabaseSeekResult"); \
 	qRegisterMetaType<openmittsu::database::DatabaseOpenResult>("DatabaseOpenResult"); \
@@ -65,6 +71,12 @@
 	qRegisterMetaType<openmittsu::database::DatabaseWrapperFactory>("openmittsu::database::DatabaseWrapperFactory"); \
 	qRegisterMetaType<openmittsu::database::GroupData>("GroupData"); \
 	qRegisterMetaType<openmittsu::database::GroupData>("openmittsu::database::GroupData"); \
+	qRegisterMetaType<openmittsu::database::MaintenanceStatistics>("MaintenanceStatistics"); \
+	qRegisterMetaType<openmittsu::database::MaintenanceStatistics>("openmittsu::database::MaintenanceStatistics"); \
+	qRegisterMetaType<openmittsu::database::MediaCacheStatistics>("MediaCacheStatistics"); \
+	qRegisterMetaType<openmittsu::database::MediaCacheStatistics>("openmittsu::database::MediaCacheStatistics"); \
+	qRegisterMetaType<openmittsu::database::MediaIntegrityReport>("MediaIntegrityReport"); \
+	qRegisterMetaType<openmittsu::database::MediaIntegrityReport>("openmittsu::database::MediaIntegrityReport"); \
 	qRegisterMetaType<openmittsu::database::NewContactData>("NewContactData"); \
 	qRegisterMetaType<openmittsu::database::NewContactData>("openmittsu::database::NewContactData"); \
 	qRegisterMetaType<openmittsu::database::NewGroupData>("NewGroupData"); \
@@ -101,6 +113,8 @@
 	qRegisterMetaType<openmittsu::database::ContactToAccountStatusMap>("ContactToAccountStatusMap"); \
 	qRegisterMetaType<openmittsu::database::ContactToFeatureLevelMap>("openmittsu::database::ContactToFeatureLevelMap"); \
 	qRegisterMetaType<openmittsu::database::ContactToFeatureLevelMap>("ContactToFeatureLevelMap"); \
+	qRegisterMetaType<openmittsu::database::DamagedMediaItemList>("openmittsu::database::DamagedMediaItemList"); \
+	qRegisterMetaType<openmittsu::database::DamagedMediaItemList>("DamagedMediaItemList"); \
 	qRegisterMetaType<std::shared_ptr<openmittsu::dataproviders::NetworkSentMessageAcceptor>>("std::shared_ptr<openmittsu::dataproviders::NetworkSentMessageAcceptor>"); \
 	qRegisterMetaType<std::shared_ptr<openmittsu::dataproviders::NetworkSentMessageAcceptor>>("std::shared_ptr<NetworkSentMessageAcceptor>"); \
 	qRegisterMetaType<std::shared_ptr<openmittsu::dataproviders::SentMessageAcceptor>>("std::shared_ptr<openmittsu::dataproviders::SentMessageAcceptor>"); \
@@ -0,0 +1,184 @@
+#include "src/backup/BackupBatchQueue.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <utility>
+
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/backup/ContactMediaItemBackupObject.h"
+#include "src/backup/GroupMediaItemBackupObject.h"
+
+namespace openmittsu {
+	namespace backup {
+
+		template<typename T>
+		BackupBatchQueue<T>::BackupBatchQueue(int maxBatchItems, qint64 maxBatchBytes, int maxQueuedBatches) : m_maxBatchItems(std::max(1, maxBatchItems)), m_maxBatchBytes(std::max(qint64(1), maxBatchBytes)), m_maxQueuedBatches(std::max(1, maxQueuedBatches)),
+			m_mutex(), m_notFull(), m_notEmpty(), m_queuedBatches(), m_queuedBytes(0), m_consumerBytes(0), m_peakBytes(0), m_isClosed(false), m_isCancelled(false), m_error() {
+			//
+		}
+
+		template<typename T>
+		BackupBatchQueue<T>::~BackupBatchQueue() {
+			//
+		}
+
+		template<typename T>
+		bool BackupBatchQueue<T>::isBatchComplete(int items, qint64 bytes) const {
+			return (items >= m_maxBatchItems) || (bytes >= m_maxBatchBytes);
+		}
+
+		template<typename T>
+		bool BackupBatchQueue<T>::push(BackupBatch<T>&& batch, qint64 bytes) {
+			QMutexLocker lock(&m_mutex);
+			m_peakBytes = std::max(m_peakBytes, m_queuedBytes + m_consumerBytes + bytes);
+			while ((static_cast<int>(m_queuedBatches.size()) >= m_maxQueuedBatches) && (!m_isCancelled) && (!m_error)) {
+				m_notFull.wait(&m_mutex);
+			}
+			if (m_isCancelled || m_error) {
+				return false;
+			}
+
+			Batch queuedBatch;
+			queuedBatch.batch = std::move(batch);
+			queuedBatch.bytes = bytes;
+			m_queuedBatches.push_back(std::move(queuedBatch));
+			m_queuedBytes += bytes;
+			m_notEmpty.wakeOne();
+			return true;
+		}
+
+		template<typename T>
+		void BackupBatchQueue<T>::close() {
+			QMutexLocker lock(&m_mutex);
+			m_isClosed = true;
+			m_notEmpty.wakeAll();
+		}
+
+		template<typename T>
+		void BackupBatchQueue<T>::fail(std::exception_ptr const& error) {
+			QMutexLocker lock(&m_mutex);
+			if (!m_error) {
+				m_error = error;
+			}
+			m_isClosed = true;
+			m_notFull.wakeAll();
+			m_notEmpty.wakeAll();
+		}
+
+		template<typename T>
+		bool BackupBatchQueue<T>::pop(BackupBatch<T>& batch) {
+			QMutexLocker lock(&m_mutex);
+			// The previous batch was handed out by value, the consumer is done with it once it asks for the next one.
+			m_consumerBytes = 0;
+			while (m_queuedBatches.empty() && (!m_isClosed) && (!m_isCancelled)) {
+				m_notEmpty.wait(&m_mutex);
+			}
+			if (m_queuedBatches.empty() || m_isCancelled) {
+				return false;
+			}
+
+			Batch& front = m_queuedBatches.front();
+			batch = std::move(front.batch);
+			m_queuedBytes -= front.bytes;
+			m_consumerBytes = front.bytes;
+			m_queuedBatches.pop_front();
+			m_notFull.wakeOne();
+			return true;
+		}
+
+		template<typename T>
+		void BackupBatchQueue<T>::cancel() {
+			QMutexLocker lock(&m_mutex);
+			m_isCancelled = true;
+			m_queuedBatches.clear();
+			m_queuedBytes = 0;
+			m_notFull.wakeAll();
+			m_notEmpty.wakeAll();
+		}
+
+		template<typename T>
+		bool BackupBatchQueue<T>::isStopped() const {
+			QMutexLocker lock(&m_mutex);
+			return m_isCancelled || m_error;
+		}
+
+		template<typename T>
+		void BackupBatchQueue<T>::rethrowIfFailed() const {
+			std::exception_ptr error;
+			{
+				QMutexLocker lock(&m_mutex);
+				error = m_error;
+			}
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		template<typename T>
+		qint64 BackupBatchQueue<T>::getPeakBytes() const {
+			QMutexLocker lock(&m_mutex);
+			return m_peakBytes;
+		}
+
+		template<typename T>
+		BackupBatchProducer<T>::BackupBatchProducer(BackupBatchQueue<T>& queue) : m_queue(queue), m_batch(), m_batchBytes(0) {
+			//
+		}
+
+		template<typename T>
+		BackupBatchProducer<T>::~BackupBatchProducer() {
+			//
+		}
+
+		template<typename T>
+		bool BackupBatchProducer<T>::push(T const& item, qint64 sizeInBytes) {
+			m_batch.items.append(item);
+			m_batchBytes += sizeInBytes;
+			if (m_queue.isBatchComplete(m_batch.items.size(), m_batchBytes)) {
+				return flush();
+			}
+			return true;
+		}
+
+		template<typename T>
+		bool BackupBatchProducer<T>::push(T const& item, qint64 sizeInBytes, openmittsu::database::BackupImportCheckpoint const& checkpoint) {
+			setCheckpoint(checkpoint);
+			return push(item, sizeInBytes);
+		}
+
+		template<typename T>
+		void BackupBatchProducer<T>::setCheckpoint(openmittsu::database::BackupImportCheckpoint const& checkpoint) {
+			for (openmittsu::database::BackupImportCheckpoint& existing : m_batch.checkpoints) {
+				if (existing.fileName == checkpoint.fileName) {
+					existing = checkpoint;
+					return;
+				}
+			}
+			m_batch.checkpoints.append(checkpoint);
+		}
+
+		template<typename T>
+		bool BackupBatchProducer<T>::flush() {
+			if (m_batch.items.isEmpty() && m_batch.checkpoints.isEmpty()) {
+				return true;
+			}
+
+			bool const isQueued = m_queue.push(std::move(m_batch), m_batchBytes);
+			m_batch = BackupBatch<T>();
+			m_batchBytes = 0;
+			return isQueued;
+		}
+
+		template class BackupBatchQueue<ContactMessageBackupObject>;
+		template class BackupBatchQueue<GroupMessageBackupObject>;
+		template class BackupBatchQueue<ContactMediaItemBackupObject>;
+		template class BackupBatchQueue<GroupMediaItemBackupObject>;
+
+		template class BackupBatchProducer<ContactMessageBackupObject>;
+		template class BackupBatchProducer<GroupMessageBackupObject>;
+		template class BackupBatchProducer<ContactMediaItemBackupObject>;
+		template class BackupBatchProducer<GroupMediaItemBackupObject>;
+	}
+}
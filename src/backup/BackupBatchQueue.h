@@ -0,0 +1,114 @@
+#ifndef OPENMITTSU_BACKUP_BACKUPBATCHQUEUE_H_
+#define OPENMITTSU_BACKUP_BACKUPBATCHQUEUE_H_
+
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtGlobal>
+
+#include <deque>
+#include <exception>
+
+#include "src/database/BackupImportCheckpoint.h"
+
+namespace openmittsu {
+	namespace backup {
+
+		/** A batch of records, with the checkpoints of the files they were read from that become valid once the batch is stored. */
+		template<typename T>
+		struct BackupBatch {
+			QList<T> items;
+			QList<openmittsu::database::BackupImportCheckpoint> checkpoints;
+		};
+
+		/**
+		 * Hands parsed backup records from producer threads to one consumer thread in batches.
+		 * A batch is complete once it holds maxBatchItems records or maxBatchBytes bytes. At most maxQueuedBatches complete batches wait in the queue,
+		 * a producer handing in another one blocks until the consumer took one. Together with the batches being filled by the producers and the one
+		 * being stored, this bounds the memory held by an import independently of the size of the backup.
+		 */
+		template<typename T>
+		class BackupBatchQueue {
+		public:
+			BackupBatchQueue(int maxBatchItems, qint64 maxBatchBytes, int maxQueuedBatches);
+			virtual ~BackupBatchQueue();
+
+			bool isBatchComplete(int items, qint64 bytes) const;
+
+			/** Queues a batch holding bytes bytes. Blocks while the queue is full, returns false if the consumer cancelled or a producer failed. */
+			bool push(BackupBatch<T>&& batch, qint64 bytes);
+
+			/** Marks the end of the input, after all producers handed in their last batch. */
+			void close();
+
+			/** Ends the input with error, which the consumer rethrows once it took all queued batches. Only the first error is kept. */
+			void fail(std::exception_ptr const& error);
+
+			/** Blocks until a batch is available. Returns false once the input ended and all batches were taken. */
+			bool pop(BackupBatch<T>& batch);
+
+			/** Called by the consumer if it stops early, drops all batches and wakes blocked producers. */
+			void cancel();
+
+			/** True once the consumer cancelled or a producer failed, producers starting late can skip their work. */
+			bool isStopped() const;
+
+			/** Rethrows the error passed to fail(), if any. */
+			void rethrowIfFailed() const;
+
+			/** The largest number of bytes held at any time by complete batches, counting the queued ones, the one handed in and the one taken last by the consumer. */
+			qint64 getPeakBytes() const;
+		private:
+			struct Batch {
+				BackupBatch<T> batch;
+				qint64 bytes;
+			};
+
+			int const m_maxBatchItems;
+			qint64 const m_maxBatchBytes;
+			int const m_maxQueuedBatches;
+
+			mutable QMutex m_mutex;
+			QWaitCondition m_notFull;
+			QWaitCondition m_notEmpty;
+
+			std::deque<Batch> m_queuedBatches;
+			qint64 m_queuedBytes;
+			qint64 m_consumerBytes;
+			qint64 m_peakBytes;
+
+			bool m_isClosed;
+			bool m_isCancelled;
+			std::exception_ptr m_error;
+		};
+
+		/**
+		 * Fills batches for a BackupBatchQueue on one producer thread, several producers can feed the same queue.
+		 */
+		template<typename T>
+		class BackupBatchProducer {
+		public:
+			explicit BackupBatchProducer(BackupBatchQueue<T>& queue);
+			virtual ~BackupBatchProducer();
+
+			/** Adds item, whose size in memory is estimated as sizeInBytes. Returns false if the queue no longer accepts batches. */
+			bool push(T const& item, qint64 sizeInBytes);
+
+			/** Like push(), with the checkpoint of the file of item right after it, which is stored in the same transaction as item. */
+			bool push(T const& item, qint64 sizeInBytes, openmittsu::database::BackupImportCheckpoint const& checkpoint);
+
+			/** Adds a checkpoint without a record, e.g. for the end of a file. It replaces an earlier one of the same file in the partial batch. */
+			void setCheckpoint(openmittsu::database::BackupImportCheckpoint const& checkpoint);
+
+			/** Hands in the partial batch. */
+			bool flush();
+		private:
+			BackupBatchQueue<T>& m_queue;
+			BackupBatch<T> m_batch;
+			qint64 m_batchBytes;
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_BACKUP_BACKUPBATCHQUEUE_H_
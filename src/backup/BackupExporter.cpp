@@ -0,0 +1,396 @@
+#include "src/backup/BackupExporter.h"
+
+#include <QFile>
+#include <QHash>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "src/backup/BackupBatchQueue.h"
+#include "src/backup/CsvRecordWriter.h"
+
+#include "src/backup/ContactBackupObject.h"
+#include "src/backup/GroupBackupObject.h"
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/backup/ContactMediaItemBackupObject.h"
+#include "src/backup/GroupMediaItemBackupObject.h"
+#include "src/backup/IdentityBackup.h"
+
+#include "src/database/SimpleDatabase.h"
+#include "src/database/internal/ChunkedMediaFileReader.h"
+#include "src/database/internal/MediaIoPool.h"
+#include "src/exceptions/IllegalArgumentException.h"
+#include "src/exceptions/InternalErrorException.h"
+#include "src/utility/Logging.h"
+#include "src/utility/MakeUnique.h"
+
+namespace openmittsu {
+	namespace backup {
+
+		namespace {
+			class BackupWriteJob : public QRunnable {
+			public:
+				explicit BackupWriteJob(std::function<void()> const& job) : QRunnable(), m_job(job) {
+					setAutoDelete(true);
+				}
+
+				virtual ~BackupWriteJob() {
+					//
+				}
+
+				virtual void run() override {
+					m_job();
+				}
+			private:
+				std::function<void()> const m_job;
+			};
+
+			/** Appends records to a file, starting it with the header if it is new. Returns the number of bytes written. */
+			qint64 appendRecords(QString const& filePath, QStringList const& header, QList<QStringList> const& records) {
+				QFile file(filePath);
+				if (!file.open(QFile::WriteOnly | QFile::Append)) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not open backup file \"" << filePath.toStdString() << "\" for writing: " << file.errorString().toStdString();
+				}
+
+				CsvRecordWriter writer(&file);
+				if (file.size() == 0) {
+					writer.writeRecord(header);
+				}
+				for (QStringList const& record : records) {
+					writer.writeRecord(record);
+				}
+				writer.flush();
+				file.close();
+				return writer.getBytesWritten();
+			}
+
+			template<typename T>
+			qint64 estimateSize(T const& message) {
+				// Fixed fields and object overhead, plus the UTF-16 text.
+				return 256 + 2 * (message.getUuid().size() + message.getBody().size() + message.getCaption().size());
+			}
+		}
+
+		BackupExporter::BackupExporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath, QString const& backupPassword) : BackupExporter(database, backupPath, backupPassword, getDefaultSettings()) {
+			//
+		}
+
+		BackupExporter::BackupExporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath, QString const& backupPassword, Settings const& settings) : m_database(database), m_backupPath(backupPath.absolutePath()), m_backupPassword(backupPassword), m_settings(settings),
+			m_progressCallback(), m_statistics(), m_totalItems(0), m_processedItems(0), m_writtenBytes(0), m_reportedProgress(-1) {
+			//
+		}
+
+		BackupExporter::~BackupExporter() {
+			//
+		}
+
+		BackupExporter::Settings BackupExporter::getDefaultSettings() {
+			// Each writer has at most two batches queued, one being filled and one being written. Message batches rarely reach their limit in bytes.
+			Settings const settings = { 2000, 4 * 1024 * 1024, 2, 0 };
+			return settings;
+		}
+
+		void BackupExporter::setProgressCallback(ProgressCallback const& progressCallback) {
+			m_progressCallback = progressCallback;
+		}
+
+		BackupExporter::Statistics const& BackupExporter::getStatistics() const {
+			return m_statistics;
+		}
+
+		void BackupExporter::reportProgress() {
+			qint64 const processedItems = m_processedItems.load();
+			int const progress = (m_totalItems > 0) ? static_cast<int>(std::min(qint64(100), (processedItems * 100) / m_totalItems)) : 100;
+			if ((progress != m_reportedProgress) && m_progressCallback) {
+				m_progressCallback(progress);
+			}
+			m_reportedProgress = progress;
+		}
+
+		void BackupExporter::run() {
+			QDir const backupPath(m_backupPath);
+			if (!backupPath.exists() && !backupPath.mkpath(QStringLiteral("."))) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "Could not create the backup directory \"" << m_backupPath.toStdString() << "\".";
+			} else if (!backupPath.entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot).isEmpty()) {
+				// Message files are appended to batch by batch, files left over from an earlier backup would end up mixed into this one.
+				throw openmittsu::exceptions::IllegalArgumentException() << "The backup directory \"" << m_backupPath.toStdString() << "\" is not empty.";
+			}
+
+			m_statistics = Statistics();
+			m_processedItems = 0;
+			m_writtenBytes = 0;
+			m_reportedProgress = -1;
+
+			// Items still written on the media I/O pool would be missing from the backup otherwise.
+			m_database.waitForMediaWrites();
+
+			// Only an estimate, the counts include thumbnails which are not exported.
+			m_totalItems = qint64(m_database.getContactMessageCount()) + m_database.getGroupMessageCount() + m_database.getMediaItemCount();
+			LOGGER()->info("Exporting a backup of up to {} messages and media items to {}.", m_totalItems, m_backupPath.toStdString());
+			reportProgress();
+
+			exportIdentity();
+			exportContacts();
+			exportGroups();
+			exportContactMessages();
+			exportGroupMessages();
+			m_statistics.contactMediaItems = exportMediaItems(false);
+			m_statistics.groupMediaItems = exportMediaItems(true);
+
+			m_statistics.totalBytes = m_writtenBytes.load();
+			m_processedItems = m_totalItems;
+			reportProgress();
+			LOGGER()->info("Exported backup of {} bytes, {} media items were missing or damaged and left out.", m_statistics.totalBytes, m_statistics.skippedMediaItems);
+		}
+
+		void BackupExporter::exportIdentity() {
+			std::shared_ptr<IdentityBackup> const identityBackup = m_database.getBackup();
+			QByteArray const data = identityBackup->toBackupString(m_backupPassword).toUtf8();
+
+			QFile file(QDir(m_backupPath).filePath(QStringLiteral("identity")));
+			if (!file.open(QFile::WriteOnly) || (file.write(data) != data.size())) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write the identity backup file: " << file.errorString().toStdString();
+			}
+			file.close();
+			m_writtenBytes += data.size();
+		}
+
+		void BackupExporter::exportContacts() {
+			QList<ContactBackupObject> const contacts = m_database.getContactsForBackup();
+			QList<QStringList> records;
+			records.reserve(contacts.size());
+			for (ContactBackupObject const& contact : contacts) {
+				records.append(contact.toBackupRecord());
+			}
+			m_writtenBytes += appendRecords(QDir(m_backupPath).filePath(QStringLiteral("contacts.csv")), ContactBackupObject::getBackupHeader(), records);
+			m_statistics.contacts = contacts.size();
+
+			LOGGER()->info("Exported {} contacts.", m_statistics.contacts);
+		}
+
+		void BackupExporter::exportGroups() {
+			QList<GroupBackupObject> const groups = m_database.getGroupsForBackup();
+			QList<QStringList> records;
+			records.reserve(groups.size());
+			for (GroupBackupObject const& group : groups) {
+				records.append(group.toBackupRecord());
+			}
+			m_writtenBytes += appendRecords(QDir(m_backupPath).filePath(QStringLiteral("groups.csv")), GroupBackupObject::getBackupHeader(), records);
+			m_statistics.groups = groups.size();
+
+			LOGGER()->info("Exported {} groups.", m_statistics.groups);
+		}
+
+		void BackupExporter::exportContactMessages() {
+			int const pageSize = m_settings.maxBatchItems;
+			m_statistics.contactMessages = exportInShards<ContactMessageBackupObject>([this, pageSize](QString const& schema, qint64& startAfterRowId) {
+				return m_database.getContactMessagesForBackup(schema, startAfterRowId, pageSize);
+			}, [](ContactMessageBackupObject const& message) {
+				return ContactMessageBackupObject::getContactMessageFileName(message.getContactId());
+			});
+
+			LOGGER()->info("Exported {} contact messages.", m_statistics.contactMessages);
+		}
+
+		void BackupExporter::exportGroupMessages() {
+			int const pageSize = m_settings.maxBatchItems;
+			m_statistics.groupMessages = exportInShards<GroupMessageBackupObject>([this, pageSize](QString const& schema, qint64& startAfterRowId) {
+				return m_database.getGroupMessagesForBackup(schema, startAfterRowId, pageSize);
+			}, [](GroupMessageBackupObject const& message) {
+				return GroupMessageBackupObject::getGroupMessageFileName(message.getGroupId());
+			});
+
+			LOGGER()->info("Exported {} group messages.", m_statistics.groupMessages);
+		}
+
+		template<typename T>
+		int BackupExporter::exportInShards(std::function<QList<T>(QString const& schema, qint64& startAfterRowId)> const& readPage, std::function<QString(T const&)> const& getFileName) {
+			int const threadCount = (m_settings.maxParallelFiles > 0) ? m_settings.maxParallelFiles : QThread::idealThreadCount();
+			int const writerCount = std::max(1, threadCount);
+
+			// One queue per writer, so the files of a conversation are only ever appended to by one thread.
+			std::vector<std::unique_ptr<BackupBatchQueue<T>>> queues;
+			std::vector<std::unique_ptr<BackupBatchProducer<T>>> producers;
+			for (int i = 0; i < writerCount; ++i) {
+				queues.push_back(std::make_unique<BackupBatchQueue<T>>(m_settings.maxBatchItems, m_settings.maxBatchBytes, m_settings.maxQueuedBatches));
+				producers.push_back(std::make_unique<BackupBatchProducer<T>>(*queues.back()));
+			}
+
+			QString const backupPath = m_backupPath;
+			QThreadPool writerPool;
+			writerPool.setMaxThreadCount(writerCount);
+			for (std::unique_ptr<BackupBatchQueue<T>> const& writerQueue : queues) {
+				BackupBatchQueue<T>* const queue = writerQueue.get();
+				writerPool.start(new BackupWriteJob([this, queue, backupPath, &getFileName]() {
+					QDir const backupDir(backupPath);
+					QStringList const header = T::getBackupHeader();
+					try {
+						BackupBatch<T> batch;
+						while (queue->pop(batch)) {
+							QHash<QString, QList<QStringList>> recordsByFile;
+							for (T const& item : batch.items) {
+								recordsByFile[getFileName(item)].append(item.toBackupRecord());
+							}
+							for (auto it = recordsByFile.constBegin(); it != recordsByFile.constEnd(); ++it) {
+								m_writtenBytes += appendRecords(backupDir.filePath(it.key()), header, it.value());
+							}
+							m_processedItems += batch.items.size();
+							batch = BackupBatch<T>();
+						}
+					} catch (...) {
+						// Kept in the queue, which also makes the next batch handed to this writer fail.
+						queue->fail(std::current_exception());
+					}
+				}));
+			}
+
+			int exportedItems = 0;
+			try {
+				bool isStopped = false;
+				for (QString const& schema : m_database.getMessageStorageSchemas()) {
+					qint64 cursor = 0;
+					while (!isStopped) {
+						QList<T> const page = readPage(schema, cursor);
+						if (page.isEmpty()) {
+							break;
+						}
+
+						for (T const& item : page) {
+							uint const writer = qHash(getFileName(item)) % static_cast<uint>(writerCount);
+							if (!producers.at(writer)->push(item, estimateSize(item))) {
+								isStopped = true;
+								break;
+							}
+							++exportedItems;
+						}
+						reportProgress();
+					}
+				}
+
+				for (std::unique_ptr<BackupBatchProducer<T>> const& producer : producers) {
+					producer->flush();
+				}
+			} catch (...) {
+				for (std::unique_ptr<BackupBatchQueue<T>> const& queue : queues) {
+					queue->cancel();
+				}
+				writerPool.waitForDone();
+				throw;
+			}
+
+			for (std::unique_ptr<BackupBatchQueue<T>> const& queue : queues) {
+				queue->close();
+			}
+			writerPool.waitForDone();
+			for (std::unique_ptr<BackupBatchQueue<T>> const& queue : queues) {
+				queue->rethrowIfFailed();
+			}
+
+			reportProgress();
+			return exportedItems;
+		}
+
+		int BackupExporter::exportMediaItems(bool isGroupMedia) {
+			QDir const backupPath(m_backupPath);
+			std::atomic<int> writtenItems(0);
+			std::atomic<int> skippedItems(0);
+			std::deque<std::shared_future<void>> pendingCopies;
+
+			// Declared last, so leaving early waits for the running copies before the counters they use are gone.
+			openmittsu::database::internal::MediaIoPool mediaPool;
+			std::size_t const maxPendingCopies = static_cast<std::size_t>(2 * mediaPool.getMaxThreadCount());
+
+			QString cursor;
+			while (true) {
+				QStringList const uuids = m_database.getMediaItemUuidsForBackup(isGroupMedia, cursor, m_settings.maxBatchItems);
+				if (uuids.isEmpty()) {
+					break;
+				}
+				cursor = uuids.last();
+
+				for (QString const& uuid : uuids) {
+					// Opened on this thread as it looks up the key, only the reading and decrypting of the chunks happens on the pool.
+					std::shared_ptr<openmittsu::database::internal::ChunkedMediaFileReader> const reader(m_database.openMediaItem(uuid, openmittsu::database::MediaFileType::TYPE_STANDARD));
+
+					if (pendingCopies.size() >= maxPendingCopies) {
+						pendingCopies.front().get();
+						pendingCopies.pop_front();
+						reportProgress();
+					}
+
+					QString const filePath = backupPath.filePath(isGroupMedia ? GroupMediaItemBackupObject::getGroupMediaFileName(uuid) : ContactMediaItemBackupObject::getContactMediaFileName(uuid));
+					if (!reader) {
+						// Items not yet migrated to the chunked format are a single blob, which is loaded as a whole. A handle also tells missing items apart.
+						openmittsu::database::MediaItemHandle const handle = m_database.getMediaItemHandle(uuid, openmittsu::database::MediaFileType::TYPE_STANDARD);
+						pendingCopies.push_back(mediaPool.submitTask([this, handle, uuid, filePath, &writtenItems, &skippedItems]() {
+							openmittsu::database::MediaFileItem const item = handle.get();
+							if (!item.isAvailable()) {
+								LOGGER()->warn("Media item {} is missing or damaged, it is left out of the backup.", uuid.toStdString());
+								++skippedItems;
+								++m_processedItems;
+								return;
+							}
+
+							QFile file(filePath);
+							if (!file.open(QFile::WriteOnly | QFile::Truncate) || (file.write(item.getData()) != item.getData().size())) {
+								throw openmittsu::exceptions::InternalErrorException() << "Could not write backup file \"" << filePath.toStdString() << "\": " << file.errorString().toStdString();
+							}
+							file.close();
+							m_writtenBytes += item.getData().size();
+							++writtenItems;
+							++m_processedItems;
+						}));
+						continue;
+					}
+
+					pendingCopies.push_back(mediaPool.submitTask([this, reader, uuid, filePath, &writtenItems, &skippedItems]() {
+						QFile file(filePath);
+						if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+							throw openmittsu::exceptions::InternalErrorException() << "Could not open backup file \"" << filePath.toStdString() << "\" for writing: " << file.errorString().toStdString();
+						}
+
+						for (qint64 i = 0; i < reader->getChunkCount(); ++i) {
+							QByteArray chunk;
+							try {
+								chunk = reader->readChunk(i);
+							} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+								LOGGER()->warn("Media item {} is damaged, it is left out of the backup: {}", uuid.toStdString(), iee.what());
+								file.remove();
+								++skippedItems;
+								++m_processedItems;
+								return;
+							}
+
+							if (file.write(chunk) != chunk.size()) {
+								throw openmittsu::exceptions::InternalErrorException() << "Could not write backup file \"" << filePath.toStdString() << "\": " << file.errorString().toStdString();
+							}
+						}
+						file.close();
+						m_writtenBytes += reader->getSize();
+						++writtenItems;
+						++m_processedItems;
+					}));
+				}
+			}
+
+			while (!pendingCopies.empty()) {
+				pendingCopies.front().get();
+				pendingCopies.pop_front();
+				reportProgress();
+			}
+
+			m_statistics.skippedMediaItems += skippedItems.load();
+			LOGGER()->info("Exported {} {} media items.", writtenItems.load(), isGroupMedia ? "group" : "contact");
+			return writtenItems.load();
+		}
+
+	}
+}
@@ -0,0 +1,92 @@
+#ifndef OPENMITTSU_BACKUP_BACKUPEXPORTER_H_
+#define OPENMITTSU_BACKUP_BACKUPEXPORTER_H_
+
+#include <QDir>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <atomic>
+#include <functional>
+
+namespace openmittsu {
+	namespace database {
+		class SimpleDatabase;
+	}
+
+	namespace backup {
+
+		/**
+		 * Writes the identity, contacts, groups, messages and media items of a database as an unpacked data backup, in the layout read by BackupReader and BackupImporter.
+		 * Messages are read in pages on the thread owning the database and written by a pool of writer threads, each owning the files of a share of the conversations.
+		 * Media items are copied chunk by chunk on a media I/O pool. The memory needed does not grow with the size of the database, run() must be called on the thread owning it.
+		 */
+		class BackupExporter {
+		public:
+			struct Settings {
+				int maxBatchItems;
+				qint64 maxBatchBytes;
+				int maxQueuedBatches;
+				/** The number of writer threads for message files, zero uses one per core. */
+				int maxParallelFiles;
+			};
+
+			struct Statistics {
+				int contacts;
+				int groups;
+				int contactMessages;
+				int groupMessages;
+				int contactMediaItems;
+				int groupMediaItems;
+				/** Media items that are missing or damaged in the media storage and were left out of the backup. */
+				int skippedMediaItems;
+				qint64 totalBytes;
+			};
+
+			typedef std::function<void(int percentComplete)> ProgressCallback;
+
+			BackupExporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath, QString const& backupPassword);
+			BackupExporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath, QString const& backupPassword, Settings const& settings);
+			virtual ~BackupExporter();
+
+			/** Progress is the share of the contacts, groups, messages and media items written so far. The callback is invoked on the thread calling run(). */
+			void setProgressCallback(ProgressCallback const& progressCallback);
+
+			/** Throws if the backup directory is not empty, or a file can not be written. */
+			void run();
+			Statistics const& getStatistics() const;
+
+			static Settings getDefaultSettings();
+		private:
+			openmittsu::database::SimpleDatabase& m_database;
+			QString const m_backupPath;
+			QString const m_backupPassword;
+			Settings const m_settings;
+			ProgressCallback m_progressCallback;
+			Statistics m_statistics;
+			qint64 m_totalItems;
+			std::atomic<qint64> m_processedItems;
+			std::atomic<qint64> m_writtenBytes;
+			int m_reportedProgress;
+
+			void exportIdentity();
+			void exportContacts();
+			void exportGroups();
+			void exportContactMessages();
+			void exportGroupMessages();
+			int exportMediaItems(bool isGroupMedia);
+
+			/**
+			 * Reads all pages of messages with readPage on this thread and writes them on up to maxParallelFiles writer threads.
+			 * All messages of a file go to the same writer, which appends them in the order they were read. Returns the number of messages written.
+			 */
+			template<typename T>
+			int exportInShards(std::function<QList<T>(QString const& schema, qint64& startAfterRowId)> const& readPage, std::function<QString(T const&)> const& getFileName);
+
+			void reportProgress();
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_BACKUP_BACKUPEXPORTER_H_
@@ -0,0 +1,530 @@
+#include "src/backup/BackupImporter.h"
+
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "src/backup/BackupBatchQueue.h"
+#include "src/backup/BackupMergeIndex.h"
+#include "src/backup/FileReader.h"
+
+#include "src/backup/ContactBackupObject.h"
+#include "src/backup/GroupBackupObject.h"
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/backup/ContactMediaItemBackupObject.h"
+#include "src/backup/GroupMediaItemBackupObject.h"
+
+#include "src/database/SimpleDatabase.h"
+#include "src/exceptions/IllegalArgumentException.h"
+#include "src/utility/Logging.h"
+#include "src/utility/MakeUnique.h"
+
+namespace openmittsu {
+	namespace backup {
+
+		namespace {
+			int const mediaReaderCount = 2;
+
+			class BackupParseJob : public QRunnable {
+			public:
+				explicit BackupParseJob(std::function<void()> const& job) : QRunnable(), m_job(job) {
+					setAutoDelete(true);
+				}
+
+				virtual ~BackupParseJob() {
+					//
+				}
+
+				virtual void run() override {
+					m_job();
+				}
+			private:
+				std::function<void()> const m_job;
+			};
+		}
+
+		BackupImporter::BackupImporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath) : BackupImporter(database, backupPath, getDefaultSettings()) {
+			//
+		}
+
+		BackupImporter::BackupImporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath, Settings const& settings) : m_database(database), m_backupPath(backupPath.absolutePath()), m_settings(settings), m_progressCallback(), m_statistics(), m_processedBytes(0), m_reportedProgress(-1), m_checkpoints(), m_isResuming(false), m_mergeIndex(), m_skippedMessages(0) {
+			//
+		}
+
+		BackupImporter::~BackupImporter() {
+			//
+		}
+
+		BackupImporter::Settings BackupImporter::getDefaultSettings() {
+			// Batches of at most 16 MiB, with one waiting while another is stored. Message batches rarely reach their limit in bytes and media is read by two readers only, which keeps an import well below 100 MiB.
+			Settings const settings = { 5000, 16 * 1024 * 1024, 1, 0, false };
+			return settings;
+		}
+
+		QString BackupImporter::getFingerprint(QDir const& backupPath, openmittsu::protocol::ContactId const& identity) {
+			QStringList fileNames({ QStringLiteral("contacts.csv"), QStringLiteral("groups.csv") });
+			fileNames.append(ContactMessageBackupObject::getContactMessageFiles(backupPath).values());
+			fileNames.append(GroupMessageBackupObject::getGroupMessageFiles(backupPath).values());
+			fileNames.append(ContactMediaItemBackupObject::getContactMediaFiles(backupPath).values());
+			fileNames.append(GroupMediaItemBackupObject::getGroupMediaFiles(backupPath).values());
+			std::sort(fileNames.begin(), fileNames.end());
+
+			QCryptographicHash hash(QCryptographicHash::Sha256);
+			hash.addData(identity.toQString().toUtf8());
+			for (QString const& fileName : fileNames) {
+				hash.addData(QStringLiteral("\n%1:%2").arg(fileName).arg(QFileInfo(backupPath.filePath(fileName)).size()).toUtf8());
+			}
+			return QString::fromLatin1(hash.result().toHex());
+		}
+
+		void BackupImporter::setProgressCallback(ProgressCallback const& progressCallback) {
+			m_progressCallback = progressCallback;
+		}
+
+		BackupImporter::Statistics const& BackupImporter::getStatistics() const {
+			return m_statistics;
+		}
+
+		void BackupImporter::reportProgress() {
+			qint64 const processedBytes = m_processedBytes.load();
+			int const progress = (m_statistics.totalBytes > 0) ? static_cast<int>(std::min(qint64(100), (processedBytes * 100) / m_statistics.totalBytes)) : 100;
+			if ((progress != m_reportedProgress) && m_progressCallback) {
+				m_progressCallback(progress);
+			}
+			m_reportedProgress = progress;
+		}
+
+		QStringList BackupImporter::sortBySize(QStringList const& fileNames) {
+			QDir const backupPath(m_backupPath);
+			QVector<QPair<qint64, QString>> sizes;
+			sizes.reserve(fileNames.size());
+			for (QString const& fileName : fileNames) {
+				qint64 const size = QFileInfo(backupPath.filePath(fileName)).size();
+				sizes.append(qMakePair(size, fileName));
+				m_statistics.totalBytes += size;
+			}
+			std::sort(sizes.begin(), sizes.end(), [](QPair<qint64, QString> const& a, QPair<qint64, QString> const& b) { return a.first > b.first; });
+
+			QStringList result;
+			result.reserve(sizes.size());
+			for (QPair<qint64, QString> const& entry : sizes) {
+				result.append(entry.second);
+			}
+			return result;
+		}
+
+		void BackupImporter::run() {
+			QDir const backupPath(m_backupPath);
+			m_statistics = Statistics();
+			m_processedBytes = 0;
+			m_reportedProgress = -1;
+			m_skippedMessages = 0;
+
+			QStringList const tableFiles = sortBySize({ QStringLiteral("contacts.csv"), QStringLiteral("groups.csv") });
+			QStringList const contactMessageFiles = sortBySize(ContactMessageBackupObject::getContactMessageFiles(backupPath).values());
+			QStringList const groupMessageFiles = sortBySize(GroupMessageBackupObject::getGroupMessageFiles(backupPath).values());
+			QStringList const contactMediaFiles = sortBySize(ContactMediaItemBackupObject::getContactMediaFiles(backupPath).values());
+			QStringList const groupMediaFiles = sortBySize(GroupMediaItemBackupObject::getGroupMediaFiles(backupPath).values());
+			LOGGER()->info("Importing {} bytes from {} message files and {} media files.", m_statistics.totalBytes, contactMessageFiles.size() + groupMessageFiles.size(), contactMediaFiles.size() + groupMediaFiles.size());
+
+			// A journal left in the database belongs to an interrupted import. Otherwise every file gets an entry, so an interruption before the first batch is stored can be resumed too.
+			QString const fingerprint = getFingerprint(backupPath, m_database.getSelfContact());
+			m_checkpoints = m_database.getBackupImportCheckpoints();
+			m_isResuming = !m_checkpoints.isEmpty();
+			if (m_isResuming) {
+				if (m_database.getBackupImportFingerprint() != fingerprint) {
+					throw openmittsu::exceptions::IllegalArgumentException() << "The database holds an interrupted import of a different data backup.";
+				}
+				LOGGER()->info("Resuming an interrupted import, {} of {} files of the journal are complete.", std::count_if(m_checkpoints.constBegin(), m_checkpoints.constEnd(), [](openmittsu::database::BackupImportCheckpoint const& checkpoint) { return checkpoint.isComplete; }), m_checkpoints.size());
+			} else {
+				m_database.startBackupImportJournal(fingerprint, tableFiles + contactMessageFiles + groupMessageFiles);
+			}
+			reportProgress();
+
+			importContacts();
+			importGroups();
+
+			// Loaded after contacts and groups, but before any message of this run is stored, so the messages of the backup itself are never skipped.
+			if (m_settings.mergeIntoExisting) {
+				m_mergeIndex = std::make_unique<BackupMergeIndex>();
+				m_mergeIndex->load(m_database);
+				LOGGER()->info("Merging into a database with {} stored messages.", m_mergeIndex->getMessageCount());
+			}
+			importContactMessages(contactMessageFiles);
+			importGroupMessages(groupMessageFiles);
+			m_mergeIndex.reset();
+			m_statistics.skippedMessages = m_skippedMessages.load();
+
+			importContactMediaItems(contactMediaFiles);
+			importGroupMediaItems(groupMediaFiles);
+
+			m_database.clearBackupImportCheckpoints();
+			m_checkpoints.clear();
+
+			m_processedBytes = m_statistics.totalBytes;
+			reportProgress();
+			LOGGER()->info("Imported backup, at most {} bytes of records were held in complete batches at once.", m_statistics.peakBatchBytes);
+			if (m_settings.mergeIntoExisting) {
+				LOGGER()->info("Merged backup, skipped {} stored messages and {} stored media items, updated {} contacts and {} groups.", m_statistics.skippedMessages, m_statistics.skippedMediaItems, m_statistics.updatedContacts, m_statistics.updatedGroups);
+			}
+		}
+
+		void BackupImporter::importContacts() {
+			QString const fileName = QStringLiteral("contacts.csv");
+			if (isCompleted(fileName)) {
+				m_processedBytes += getFileSize(fileName);
+				reportProgress();
+				return;
+			}
+
+			FileReader<ContactBackupObject> fileReader(QDir(m_backupPath), fileName);
+			QSet<openmittsu::protocol::ContactId> knownContacts;
+			QVector<openmittsu::database::NewContactData> newContacts;
+
+			// All stored contacts are read in one query, instead of one per contact of the backup.
+			QHash<openmittsu::protocol::ContactId, ContactBackupObject> storedContacts;
+			if (m_settings.mergeIntoExisting) {
+				for (ContactBackupObject const& stored : m_database.getContactsForBackup()) {
+					storedContacts.insert(stored.getContactId(), stored);
+				}
+			}
+
+			while (fileReader.hasNext()) {
+				ContactBackupObject const cbo = fileReader.getNext();
+				auto const stored = storedContacts.constFind(cbo.getContactId());
+				if (stored != storedContacts.constEnd()) {
+					if (!knownContacts.contains(cbo.getContactId()) && mergeContact(*stored, cbo)) {
+						++m_statistics.updatedContacts;
+					}
+					knownContacts.insert(cbo.getContactId());
+				} else if (m_isResuming && m_database.hasContact(cbo.getContactId())) {
+					// Stored before the interruption, but the journal entry was not.
+					knownContacts.insert(cbo.getContactId());
+				} else if (!knownContacts.contains(cbo.getContactId())) {
+					knownContacts.insert(cbo.getContactId());
+					openmittsu::database::NewContactData newContact(cbo.getContactId(), cbo.getPublicKey(), cbo.getVerificationStatus(), cbo.getFirstName(), cbo.getLastName(), cbo.getNickName(), cbo.getColor());
+					newContacts.append(newContact);
+				} else {
+					LOGGER()->warn("Contact {} is already in database, this should not happen!", cbo.getContactId().toString());
+				}
+				++m_statistics.contacts;
+			}
+			m_database.storeNewContact(newContacts);
+			openmittsu::database::BackupImportCheckpoint const checkpoint = { fileName, fileReader.getCheckpointOffset(), true };
+			m_database.storeBackupImportCheckpoints({ checkpoint });
+			m_processedBytes += fileReader.getBytesRead();
+			reportProgress();
+
+			LOGGER()->info("Parsed {} contacts from file.", m_statistics.contacts);
+		}
+
+		void BackupImporter::importGroups() {
+			QString const fileName = QStringLiteral("groups.csv");
+			if (isCompleted(fileName)) {
+				m_processedBytes += getFileSize(fileName);
+				reportProgress();
+				return;
+			}
+
+			FileReader<GroupBackupObject> fileReader(QDir(m_backupPath), fileName);
+			QSet<openmittsu::protocol::GroupId> knownGroups;
+			QVector<openmittsu::database::NewGroupData> newGroups;
+
+			QHash<openmittsu::protocol::GroupId, GroupBackupObject> storedGroups;
+			if (m_settings.mergeIntoExisting) {
+				for (GroupBackupObject const& stored : m_database.getGroupsForBackup()) {
+					storedGroups.insert(stored.getGroupId(), stored);
+				}
+			}
+
+			while (fileReader.hasNext()) {
+				GroupBackupObject const gbo = fileReader.getNext();
+				auto const stored = storedGroups.constFind(gbo.getGroupId());
+				if (stored != storedGroups.constEnd()) {
+					// Storing an existing group updates it. Whether it waits for a sync is local state and kept.
+					if (!knownGroups.contains(gbo.getGroupId()) && ((stored->getName() != gbo.getName()) || (stored->getMembers() != gbo.getMembers()) || (stored->getIsDeleted() != gbo.getIsDeleted()))) {
+						bool const isAwaitingSync = m_database.getGroupData(gbo.getGroupId(), false).isAwaitingSync;
+						openmittsu::database::NewGroupData updatedGroup(gbo.getGroupId(), gbo.getName(), stored->getCreatedAt(), gbo.getMembers(), gbo.getIsDeleted(), isAwaitingSync);
+						newGroups.append(updatedGroup);
+						++m_statistics.updatedGroups;
+					}
+					knownGroups.insert(gbo.getGroupId());
+				} else if (m_isResuming && m_database.hasGroup(gbo.getGroupId())) {
+					knownGroups.insert(gbo.getGroupId());
+				} else if (!knownGroups.contains(gbo.getGroupId())) {
+					knownGroups.insert(gbo.getGroupId());
+					openmittsu::database::NewGroupData newGroup(gbo.getGroupId(), gbo.getName(), gbo.getCreatedAt(), gbo.getMembers(), gbo.getIsDeleted(), false);
+					newGroups.append(newGroup);
+				} else {
+					LOGGER()->warn("Group {} is already in database, this should not happen!", gbo.getGroupId().toString());
+				}
+				++m_statistics.groups;
+			}
+			m_database.storeNewGroup(newGroups);
+			openmittsu::database::BackupImportCheckpoint const checkpoint = { fileName, fileReader.getCheckpointOffset(), true };
+			m_database.storeBackupImportCheckpoints({ checkpoint });
+			m_processedBytes += fileReader.getBytesRead();
+			reportProgress();
+
+			LOGGER()->info("Parsed {} groups from file.", m_statistics.groups);
+		}
+
+		bool BackupImporter::mergeContact(ContactBackupObject const& stored, ContactBackupObject const& update) {
+			openmittsu::protocol::ContactId const& contact = stored.getContactId();
+			bool hasChanged = false;
+			if (stored.getFirstName() != update.getFirstName()) {
+				m_database.setContactFirstName(contact, update.getFirstName());
+				hasChanged = true;
+			}
+			if (stored.getLastName() != update.getLastName()) {
+				m_database.setContactLastName(contact, update.getLastName());
+				hasChanged = true;
+			}
+			if (stored.getNickName() != update.getNickName()) {
+				m_database.setContactNickName(contact, update.getNickName());
+				hasChanged = true;
+			}
+			if (stored.getColor() != update.getColor()) {
+				m_database.setContactColor(contact, update.getColor());
+				hasChanged = true;
+			}
+
+			// A verification done on either side is kept, and a key is never replaced by a backup.
+			if (stored.getVerificationStatus() < update.getVerificationStatus()) {
+				m_database.setContactVerificationStatus(contact, update.getVerificationStatus());
+				hasChanged = true;
+			}
+			if (stored.getPublicKey() != update.getPublicKey()) {
+				LOGGER()->warn("Contact {} has a different public key in the backup, keeping the stored one.", contact.toString());
+			}
+			return hasChanged;
+		}
+
+		void BackupImporter::importContactMessages(QStringList const& fileNames) {
+			LOGGER()->info("Found {} contacts message files.", fileNames.size());
+
+			QStringList const remainingFiles = skipCompletedFiles(fileNames);
+			m_statistics.contactMessages = importInBatches<ContactMessageBackupObject>(splitIntoGroups(remainingFiles, remainingFiles.size()), m_settings.maxParallelFiles, [this](QString const& fileName, BackupBatchProducer<ContactMessageBackupObject>& producer) {
+				parseMessageFile(fileName, producer);
+			}, [this](BackupBatch<ContactMessageBackupObject> const& batch) {
+				m_database.storeContactMessagesFromBackup(batch.items, batch.checkpoints);
+			});
+
+			LOGGER()->info("Imported {} contact messages, database now contains {} contact messages.", m_statistics.contactMessages, m_database.getContactMessageCount());
+		}
+
+		void BackupImporter::importGroupMessages(QStringList const& fileNames) {
+			LOGGER()->info("Found {} group message files.", fileNames.size());
+
+			QStringList const remainingFiles = skipCompletedFiles(fileNames);
+			m_statistics.groupMessages = importInBatches<GroupMessageBackupObject>(splitIntoGroups(remainingFiles, remainingFiles.size()), m_settings.maxParallelFiles, [this](QString const& fileName, BackupBatchProducer<GroupMessageBackupObject>& producer) {
+				parseMessageFile(fileName, producer);
+			}, [this](BackupBatch<GroupMessageBackupObject> const& batch) {
+				m_database.storeGroupMessagesFromBackup(batch.items, batch.checkpoints);
+			});
+
+			LOGGER()->info("Imported {} group messages, database now contains {} group messages.", m_statistics.groupMessages, m_database.getGroupMessageCount());
+		}
+
+		void BackupImporter::importContactMediaItems(QStringList const& fileNames) {
+			LOGGER()->info("Found {} contact media files.", fileNames.size());
+
+			// Few readers suffice, as the database encrypts the items of each batch on its media I/O pool. Each reader fills batches from its share of the files.
+			QString const backupPath = m_backupPath;
+			QStringList const remainingFiles = skipStoredMediaFiles(fileNames);
+			m_statistics.contactMediaItems = importInBatches<ContactMediaItemBackupObject>(splitIntoGroups(remainingFiles, mediaReaderCount), mediaReaderCount, [this, backupPath](QString const& fileName, BackupBatchProducer<ContactMediaItemBackupObject>& producer) {
+				ContactMediaItemBackupObject const cmibo = ContactMediaItemBackupObject::fromFile(QDir(backupPath), fileName);
+				m_processedBytes += cmibo.getData().size();
+				producer.push(cmibo, cmibo.getData().size());
+			}, [this](BackupBatch<ContactMediaItemBackupObject> const& batch) {
+				m_database.storeContactMediaItemsFromBackup(batch.items);
+			});
+
+			// The last batch is still encrypted on the media I/O pool, and the journal has to outlive it.
+			m_database.waitForMediaWrites();
+
+			LOGGER()->info("Imported {} contact media items, database now contains {} media items.", m_statistics.contactMediaItems, m_database.getMediaItemCount());
+		}
+
+		void BackupImporter::importGroupMediaItems(QStringList const& fileNames) {
+			LOGGER()->info("Found {} group media files.", fileNames.size());
+
+			QString const backupPath = m_backupPath;
+			QStringList const remainingFiles = skipStoredMediaFiles(fileNames);
+			m_statistics.groupMediaItems = importInBatches<GroupMediaItemBackupObject>(splitIntoGroups(remainingFiles, mediaReaderCount), mediaReaderCount, [this, backupPath](QString const& fileName, BackupBatchProducer<GroupMediaItemBackupObject>& producer) {
+				GroupMediaItemBackupObject const gmibo = GroupMediaItemBackupObject::fromFile(QDir(backupPath), fileName);
+				m_processedBytes += gmibo.getData().size();
+				producer.push(gmibo, gmibo.getData().size());
+			}, [this](BackupBatch<GroupMediaItemBackupObject> const& batch) {
+				m_database.storeGroupMediaItemsFromBackup(batch.items);
+			});
+			m_database.waitForMediaWrites();
+
+			LOGGER()->info("Imported {} group media items, database now contains {} media items.", m_statistics.groupMediaItems, m_database.getMediaItemCount());
+		}
+
+		template<typename T>
+		void BackupImporter::parseMessageFile(QString const& fileName, BackupBatchProducer<T>& producer) {
+			// Every reader thread uses its own QDir, instances are not safe to share between threads. The part of the file stored before an interruption is skipped, but counts as processed.
+			auto const it = m_checkpoints.constFind(fileName);
+			qint64 const resumeOffset = (it != m_checkpoints.constEnd()) ? it->offset : 0;
+			FileReader<T> fileReader(QDir(m_backupPath), fileName, resumeOffset);
+			qint64 countedBytes = 0;
+			while (fileReader.hasNext()) {
+				T const message = fileReader.getNext();
+				if (isStored(message)) {
+					++m_skippedMessages;
+				} else {
+					openmittsu::database::BackupImportCheckpoint const checkpoint = { fileName, fileReader.getCheckpointOffset(), false };
+					if (!producer.push(message, estimateSize(message), checkpoint)) {
+						return;
+					}
+				}
+
+				qint64 const bytesRead = fileReader.getBytesRead();
+				m_processedBytes += bytesRead - countedBytes;
+				countedBytes = bytesRead;
+			}
+			m_processedBytes += fileReader.getBytesRead() - countedBytes;
+
+			openmittsu::database::BackupImportCheckpoint const checkpoint = { fileName, fileReader.getCheckpointOffset(), true };
+			producer.setCheckpoint(checkpoint);
+		}
+
+		template<typename T>
+		bool BackupImporter::isStored(T const& message) const {
+			return (m_mergeIndex != nullptr) && m_mergeIndex->contains(message);
+		}
+
+		QList<QStringList> BackupImporter::splitIntoGroups(QStringList const& fileNames, int groupCount) {
+			// Dealt out in turn, so groups of files sorted by size end up with similar sizes.
+			QList<QStringList> result;
+			int const count = std::max(1, std::min(groupCount, fileNames.size()));
+			for (int i = 0; i < count; ++i) {
+				result.append(QStringList());
+			}
+			for (int i = 0; i < fileNames.size(); ++i) {
+				result[i % count].append(fileNames.at(i));
+			}
+			return result;
+		}
+
+		bool BackupImporter::isCompleted(QString const& fileName) const {
+			auto const it = m_checkpoints.constFind(fileName);
+			return (it != m_checkpoints.constEnd()) && it->isComplete;
+		}
+
+		qint64 BackupImporter::getFileSize(QString const& fileName) const {
+			return QFileInfo(QDir(m_backupPath).filePath(fileName)).size();
+		}
+
+		QStringList BackupImporter::skipCompletedFiles(QStringList const& fileNames) {
+			QStringList result;
+			for (QString const& fileName : fileNames) {
+				if (isCompleted(fileName)) {
+					m_processedBytes += getFileSize(fileName);
+				} else {
+					result.append(fileName);
+				}
+			}
+			return result;
+		}
+
+		QStringList BackupImporter::skipStoredMediaFiles(QStringList const& fileNames) {
+			if (!m_isResuming && !m_settings.mergeIntoExisting) {
+				return fileNames;
+			}
+
+			// Media items are stored in one transaction per batch, so an item is either stored completely or not at all. The lookup is cheap next to reading the file.
+			QStringList result;
+			for (QString const& fileName : fileNames) {
+				QString const uuid = fileName.right(36); // Length of the UUID
+				if (m_database.hasMediaItem(uuid, openmittsu::database::MediaFileType::TYPE_STANDARD)) {
+					m_processedBytes += getFileSize(fileName);
+					++m_statistics.skippedMediaItems;
+				} else {
+					result.append(fileName);
+				}
+			}
+			return result;
+		}
+
+		template<typename T>
+		int BackupImporter::importInBatches(QList<QStringList> const& fileGroups, int maxParallelFiles, std::function<void(QString const&, BackupBatchProducer<T>&)> const& parseFile, std::function<void(BackupBatch<T> const&)> const& storeBatch) {
+			if (fileGroups.isEmpty() || fileGroups.first().isEmpty()) {
+				return 0;
+			}
+
+			BackupBatchQueue<T> queue(m_settings.maxBatchItems, m_settings.maxBatchBytes, m_settings.maxQueuedBatches);
+			QAtomicInt remainingGroups(fileGroups.size());
+
+			QThreadPool readerPool;
+			int const threadCount = (maxParallelFiles > 0) ? maxParallelFiles : QThread::idealThreadCount();
+			readerPool.setMaxThreadCount(std::max(1, std::min(threadCount, fileGroups.size())));
+			for (QStringList const& fileNames : fileGroups) {
+				readerPool.start(new BackupParseJob([&queue, &remainingGroups, &parseFile, fileNames]() {
+					try {
+						BackupBatchProducer<T> producer(queue);
+						for (QString const& fileName : fileNames) {
+							if (queue.isStopped()) {
+								break;
+							}
+							parseFile(fileName, producer);
+						}
+						producer.flush();
+					} catch (...) {
+						queue.fail(std::current_exception());
+					}
+
+					// The last group to finish ends the input.
+					if (!remainingGroups.deref()) {
+						queue.close();
+					}
+				}));
+			}
+
+			int importedItems = 0;
+			try {
+				BackupBatch<T> batch;
+				while (queue.pop(batch)) {
+					storeBatch(batch);
+					importedItems += batch.items.size();
+					batch = BackupBatch<T>();
+					reportProgress();
+				}
+			} catch (...) {
+				queue.cancel();
+				readerPool.clear();
+				readerPool.waitForDone();
+				throw;
+			}
+
+			readerPool.waitForDone();
+			queue.rethrowIfFailed();
+
+			m_statistics.peakBatchBytes = std::max(m_statistics.peakBatchBytes, queue.getPeakBytes());
+			reportProgress();
+			return importedItems;
+		}
+
+		qint64 BackupImporter::estimateSize(ContactMessageBackupObject const& message) {
+			// Fixed fields and object overhead, plus the UTF-16 text.
+			return 256 + 2 * (message.getUuid().size() + message.getBody().size() + message.getCaption().size());
+		}
+
+		qint64 BackupImporter::estimateSize(GroupMessageBackupObject const& message) {
+			return 256 + 2 * (message.getUuid().size() + message.getBody().size() + message.getCaption().size());
+		}
+
+	}
+}
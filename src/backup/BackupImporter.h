@@ -0,0 +1,145 @@
+#ifndef OPENMITTSU_BACKUP_BACKUPIMPORTER_H_
+#define OPENMITTSU_BACKUP_BACKUPIMPORTER_H_
+
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "src/database/BackupImportCheckpoint.h"
+#include "src/protocol/ContactId.h"
+
+namespace openmittsu {
+	namespace database {
+		class SimpleDatabase;
+	}
+
+	namespace backup {
+
+		class BackupMergeIndex;
+		class ContactBackupObject;
+		class ContactMessageBackupObject;
+		class GroupMessageBackupObject;
+		template<typename T> class BackupBatchProducer;
+		template<typename T> struct BackupBatch;
+
+		/**
+		 * Imports the contacts, groups, messages and media items of an unpacked data backup into a database.
+		 * Message files are parsed in parallel on a pool of reader threads, media files are read by two reader threads and encrypted in parallel by the database.
+		 * All records reach the database in bounded batches through one writer, run() must be called on the thread owning the database.
+		 * The memory needed does not grow with the size of the backup.
+		 *
+		 * Progress is kept in a journal in the database, written in the same transaction as the records it covers. If an import is interrupted,
+		 * running it again on the same database and backup continues after the last stored batch, and ends with the same database as an uninterrupted import.
+		 *
+		 * In merge mode a newer backup is imported into a database holding an older one. Messages and media items already stored are skipped, changed contacts
+		 * and groups are updated and nothing is removed, so data only known locally survives. Only new and changed records are written.
+		 */
+		class BackupImporter {
+		public:
+			struct Settings {
+				int maxBatchItems;
+				qint64 maxBatchBytes;
+				int maxQueuedBatches;
+				/** The number of message files parsed at the same time, zero uses one per core. */
+				int maxParallelFiles;
+				/** Merge into a database that already holds data, instead of filling an empty one. */
+				bool mergeIntoExisting;
+			};
+
+			struct Statistics {
+				int contacts;
+				int groups;
+				int contactMessages;
+				int groupMessages;
+				int contactMediaItems;
+				int groupMediaItems;
+				qint64 totalBytes;
+				qint64 peakBatchBytes;
+				/** Messages and media items of the backup that were already stored, when merging or resuming. */
+				int skippedMessages;
+				int skippedMediaItems;
+				/** Stored contacts and groups changed by merging. */
+				int updatedContacts;
+				int updatedGroups;
+			};
+
+			typedef std::function<void(int percentComplete)> ProgressCallback;
+
+			BackupImporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath);
+			BackupImporter(openmittsu::database::SimpleDatabase& database, QDir const& backupPath, Settings const& settings);
+			virtual ~BackupImporter();
+
+			/** Progress is the share of the bytes of all backup files processed so far. The callback is invoked on the thread calling run(). */
+			void setProgressCallback(ProgressCallback const& progressCallback);
+
+			/** Throws if a file of the backup can not be parsed or the database rejects its data. Resumes an interrupted import of the same backup, and refuses to resume with another one. */
+			void run();
+			Statistics const& getStatistics() const;
+
+			static Settings getDefaultSettings();
+			/** Identifies a backup by the identity and the names and sizes of its files, stored with the journal of an import. */
+			static QString getFingerprint(QDir const& backupPath, openmittsu::protocol::ContactId const& identity);
+		private:
+			openmittsu::database::SimpleDatabase& m_database;
+			QString const m_backupPath;
+			Settings const m_settings;
+			ProgressCallback m_progressCallback;
+			Statistics m_statistics;
+			std::atomic<qint64> m_processedBytes;
+			int m_reportedProgress;
+			/** The journal found when run() started, only read while files are parsed. */
+			QHash<QString, openmittsu::database::BackupImportCheckpoint> m_checkpoints;
+			bool m_isResuming;
+			/** The messages stored before a merge, only read while files are parsed. */
+			std::unique_ptr<BackupMergeIndex> m_mergeIndex;
+			std::atomic<int> m_skippedMessages;
+
+			void importContacts();
+			void importGroups();
+			/** Updates the stored contact to the state of the backup. Returns false if nothing changed. */
+			bool mergeContact(ContactBackupObject const& stored, ContactBackupObject const& update);
+			void importContactMessages(QStringList const& fileNames);
+			void importGroupMessages(QStringList const& fileNames);
+			void importContactMediaItems(QStringList const& fileNames);
+			void importGroupMediaItems(QStringList const& fileNames);
+
+			/**
+			 * Parses the groups of files with parseFile on up to maxParallelFiles reader threads and stores every batch they complete with storeBatch on this thread.
+			 * The files of a group are parsed in order on one thread, filling the same batches. Returns the number of records stored.
+			 */
+			template<typename T>
+			int importInBatches(QList<QStringList> const& fileGroups, int maxParallelFiles, std::function<void(QString const&, BackupBatchProducer<T>&)> const& parseFile, std::function<void(BackupBatch<T> const&)> const& storeBatch);
+
+			template<typename T>
+			void parseMessageFile(QString const& fileName, BackupBatchProducer<T>& producer);
+
+			/** Sorts the files by size, largest first so parallel parsing does not end waiting for one large file, and adds their size to the total. */
+			QStringList sortBySize(QStringList const& fileNames);
+			static QList<QStringList> splitIntoGroups(QStringList const& fileNames, int groupCount);
+
+			/** Drops the files the journal marks as completely imported and counts them as processed. */
+			QStringList skipCompletedFiles(QStringList const& fileNames);
+			/** When resuming or merging, drops the media files whose item is already stored and counts them as processed. */
+			QStringList skipStoredMediaFiles(QStringList const& fileNames);
+			bool isCompleted(QString const& fileName) const;
+			qint64 getFileSize(QString const& fileName) const;
+			void reportProgress();
+
+			template<typename T>
+			bool isStored(T const& message) const;
+
+			static qint64 estimateSize(ContactMessageBackupObject const& message);
+			static qint64 estimateSize(GroupMessageBackupObject const& message);
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_BACKUP_BACKUPIMPORTER_H_
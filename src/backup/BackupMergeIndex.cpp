@@ -0,0 +1,88 @@
+#include "src/backup/BackupMergeIndex.h"
+
+#include <algorithm>
+
+#include <sodium.h>
+
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/database/SimpleDatabase.h"
+#include "src/protocol/ContactId.h"
+#include "src/protocol/GroupId.h"
+#include "src/protocol/MessageId.h"
+
+namespace openmittsu {
+	namespace backup {
+
+		BackupMergeIndex::BackupMergeIndex() : m_keys(), m_messageCount(0) {
+			//
+		}
+
+		BackupMergeIndex::~BackupMergeIndex() {
+			//
+		}
+
+		void BackupMergeIndex::load(openmittsu::database::SimpleDatabase const& database) {
+			m_keys.clear();
+			m_messageCount = 0;
+
+			openmittsu::database::internal::DatabaseUserMessage::MessageKeyCallback const callback = [this](QString const& uuid, QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox) {
+				add(uuid, conversation, sender, apiId, isOutbox);
+			};
+			database.readMessageKeysForMerge(false, callback);
+			database.readMessageKeysForMerge(true, callback);
+
+			std::sort(m_keys.begin(), m_keys.end());
+			m_keys.erase(std::unique(m_keys.begin(), m_keys.end()), m_keys.end());
+			m_keys.shrink_to_fit();
+		}
+
+		bool BackupMergeIndex::contains(ContactMessageBackupObject const& message) const {
+			// Stored with the identity of the contact as sender in both directions, the direction tells them apart.
+			QString const identity = message.getContactId().toQString();
+			return contains(message.getUuid(), identity, identity, message.getApiId().toQString(), message.getIsOutbox());
+		}
+
+		bool BackupMergeIndex::contains(GroupMessageBackupObject const& message) const {
+			openmittsu::protocol::GroupId const& group = message.getGroupId();
+			QString const conversation = QStringLiteral("%1:%2").arg(group.getOwner().toQString()).arg(group.groupIdWithoutOwnerToQString());
+			return contains(message.getUuid(), conversation, message.getContactId().toQString(), message.getApiId().toQString(), message.getIsOutbox());
+		}
+
+		int BackupMergeIndex::getMessageCount() const {
+			return m_messageCount;
+		}
+
+		void BackupMergeIndex::add(QString const& uuid, QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox) {
+			m_keys.push_back(getUuidKey(uuid));
+			m_keys.push_back(getMessageKey(conversation, sender, apiId, isOutbox));
+			++m_messageCount;
+		}
+
+		bool BackupMergeIndex::contains(QString const& uuid, QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox) const {
+			return containsKey(getUuidKey(uuid)) || containsKey(getMessageKey(conversation, sender, apiId, isOutbox));
+		}
+
+		bool BackupMergeIndex::containsKey(Key const& key) const {
+			return std::binary_search(m_keys.cbegin(), m_keys.cend(), key);
+		}
+
+		BackupMergeIndex::Key BackupMergeIndex::getUuidKey(QString const& uuid) {
+			return hash(QStringLiteral("uid:") + uuid);
+		}
+
+		BackupMergeIndex::Key BackupMergeIndex::getMessageKey(QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox) {
+			// Outgoing API ids are all chosen by us, the sender stored with them does not matter.
+			return hash(QStringLiteral("msg:") + conversation + QChar(';') + (isOutbox ? QStringLiteral(">") : sender) + QChar(';') + apiId);
+		}
+
+		BackupMergeIndex::Key BackupMergeIndex::hash(QString const& text) {
+			static_assert(sizeof(Key) >= crypto_generichash_BYTES_MIN, "The merge index keys are shorter than the shortest BLAKE2b output.");
+			QByteArray const utf8 = text.toUtf8();
+			Key result;
+			crypto_generichash(reinterpret_cast<unsigned char*>(result.data()), sizeof(result), reinterpret_cast<unsigned char const*>(utf8.constData()), static_cast<unsigned long long>(utf8.size()), nullptr, 0);
+			return result;
+		}
+
+	}
+}
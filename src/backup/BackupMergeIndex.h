@@ -0,0 +1,55 @@
+#ifndef OPENMITTSU_BACKUP_BACKUPMERGEINDEX_H_
+#define OPENMITTSU_BACKUP_BACKUPMERGEINDEX_H_
+
+#include <QString>
+#include <QtGlobal>
+
+#include <array>
+#include <vector>
+
+namespace openmittsu {
+	namespace database {
+		class SimpleDatabase;
+	}
+
+	namespace backup {
+
+		class ContactMessageBackupObject;
+		class GroupMessageBackupObject;
+
+		/**
+		 * The messages stored in a database, for skipping those of a backup that were imported before.
+		 * A message counts as stored if its uuid is, or a message with the same API id from the same sender in the same conversation.
+		 * Both keys are kept as 128 bit BLAKE2b hashes in one sorted vector, 32 bytes per stored message. Even among billions of keys, a collision that makes
+		 * a new message look stored is far less likely than a hardware fault. Lookups are safe from several threads once load() returned.
+		 */
+		class BackupMergeIndex {
+		public:
+			BackupMergeIndex();
+			virtual ~BackupMergeIndex();
+
+			/** Reads the keys of all contact and group messages of the database, replacing those loaded before. */
+			void load(openmittsu::database::SimpleDatabase const& database);
+
+			bool contains(ContactMessageBackupObject const& message) const;
+			bool contains(GroupMessageBackupObject const& message) const;
+			int getMessageCount() const;
+		private:
+			typedef std::array<quint64, 2> Key;
+
+			std::vector<Key> m_keys;
+			int m_messageCount;
+
+			void add(QString const& uuid, QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox);
+			bool contains(QString const& uuid, QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox) const;
+			bool containsKey(Key const& key) const;
+
+			static Key getUuidKey(QString const& uuid);
+			static Key getMessageKey(QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox);
+			static Key hash(QString const& text);
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_BACKUP_BACKUPMERGEINDEX_H_
@@ -37,6 +37,14 @@ namespace openmittsu {
 			return true;
 		}
 
+		QString BackupObject::toBackupColumn(bool value) {
+			return value ? QStringLiteral("1") : QStringLiteral("0");
+		}
+
+		QString BackupObject::toBackupColumn(openmittsu::protocol::MessageTime const& time) {
+			return time.isNull() ? QString() : QString::number(time.getMessageTimeMSecs());
+		}
+
 		void BackupObject::checkAndOpenFile(QFile& file) {
 			if (!file.exists()) {
 				throw openmittsu::exceptions::IllegalArgumentException() << "Could not parse file \"" << file.fileName().toStdString() << "\", it is not readable.";
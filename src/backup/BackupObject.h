@@ -6,6 +6,8 @@
 #include <QSet>
 #include <QString>
 
+#include "src/protocol/MessageTime.h"
+
 namespace openmittsu {
 	namespace backup {
 
@@ -16,6 +18,10 @@ namespace openmittsu {
 		protected:
 			static void checkAndOpenFile(QFile& file);
 			static bool hasRequiredFields(QSet<QString> const& requiredFields, QHash<QString, int> const& headerOffsets);
+
+			/** Column values as written to backup files, the inverse of the parsing in fromBackupMatch(). A null time is written as an empty column. */
+			static QString toBackupColumn(bool value);
+			static QString toBackupColumn(openmittsu::protocol::MessageTime const& time);
 		};
 
 	}
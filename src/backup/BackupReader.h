@@ -21,10 +21,14 @@ namespace openmittsu {
 		class BackupReader : public QThread {
 			Q_OBJECT
 		public:
-			BackupReader(QDir const& backupFilePath, QString const& backupPassword, QString const& databaseFilename, QDir const& mediaStorageLocation, QString const& databasePassword);
+			/** With mergeIntoExisting, an existing database of the same identity is updated with the backup, otherwise the database must not exist yet or hold an interrupted import of the backup. */
+			BackupReader(QDir const& backupFilePath, QString const& backupPassword, QString const& databaseFilename, QDir const& mediaStorageLocation, QString const& databasePassword, bool mergeIntoExisting);
 			virtual ~BackupReader();
 
 			virtual void run() override;
+
+			/** Checks without writing to it whether the backup may be imported into an existing database. Returns why not, or an empty string. Throws if the database can not be opened. */
+			static QString checkExistingDatabase(QString const& databaseFilename, QString const& databasePassword, QDir const& backupFilePath, openmittsu::protocol::ContactId const& backupIdentity, bool mergeIntoExisting);
 		signals:
 			void progressUpdated(int percentComplete);
 			void finished(bool hadError, QString const& errorMessage);
@@ -34,6 +38,7 @@ namespace openmittsu {
 			QString const m_databaseFilename;
 			QDir const m_mediaStorageLocation;
 			QString const m_databasePassword;
+			bool const m_mergeIntoExisting;
 		};
 
 	}
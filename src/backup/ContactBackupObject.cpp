@@ -42,6 +42,14 @@ namespace openmittsu {
 			return m_color;
 		}
 
+		QStringList ContactBackupObject::toBackupRecord() const {
+			return { m_id.toQString(), QString(m_publicKey.getPublicKey().toHex()), openmittsu::protocol::ContactIdVerificationStatusHelper::toQString(m_verificationStatus), m_firstName, m_lastName, m_nickName, QString::number(m_color) };
+		}
+
+		QStringList ContactBackupObject::getBackupHeader() {
+			return { QStringLiteral("identity"), QStringLiteral("publickey"), QStringLiteral("verification"), QStringLiteral("firstname"), QStringLiteral("lastname"), QStringLiteral("nick_name"), QStringLiteral("color") };
+		}
+
 		ContactBackupObject ContactBackupObject::fromBackupMatch(QString const&, QHash<QString, int> const& headerOffsets, SimpleCsvLineSplitter const& splittedLines) {
 			QSet<QString> const requiredFields = { QStringLiteral("identity"), QStringLiteral("publickey"), QStringLiteral("verification"), QStringLiteral("firstname"), QStringLiteral("lastname"), QStringLiteral("nick_name"), QStringLiteral("color") };
 			if (!hasRequiredFields(requiredFields, headerOffsets)) {
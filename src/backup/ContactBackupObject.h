@@ -8,6 +8,8 @@
 #include "src/crypto/PublicKey.h"
 #include "src/protocol/ContactIdVerificationStatus.h"
 
+#include <QStringList>
+
 namespace openmittsu {
 	namespace backup {
 
@@ -25,6 +27,10 @@ namespace openmittsu {
 			int getColor() const;
 
 			static ContactBackupObject fromBackupMatch(QString const& filename, QHash<QString, int> const& headerOffsets, SimpleCsvLineSplitter const& splittedLines);
+
+			/** The columns of this contact in contacts.csv, in the order of getBackupHeader(). */
+			QStringList toBackupRecord() const;
+			static QStringList getBackupHeader();
 		private:
 			openmittsu::protocol::ContactId m_id;
 			openmittsu::crypto::PublicKey m_publicKey;
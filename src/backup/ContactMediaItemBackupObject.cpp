@@ -32,6 +32,10 @@ namespace openmittsu {
 			return ContactMediaItemBackupObject(data, uuid);
 		}
 
+		QString ContactMediaItemBackupObject::getContactMediaFileName(QString const& uuid) {
+			return QStringLiteral("message_media_%1").arg(uuid);
+		}
+
 		QHash<QString, QString> ContactMediaItemBackupObject::getContactMediaFiles(QDir const& path) {
 			QHash<QString, QString> result;
 
@@ -19,6 +19,7 @@ namespace openmittsu {
 
 			static ContactMediaItemBackupObject fromFile(QDir const& path, QString const& filename);
 			static QHash<QString, QString> getContactMediaFiles(QDir const& path);
+			static QString getContactMediaFileName(QString const& uuid);
 		};
 
 	}
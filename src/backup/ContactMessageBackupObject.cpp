@@ -118,6 +118,21 @@ namespace openmittsu {
 			}
 		}
 
+		QString ContactMessageBackupObject::getContactMessageFileName(openmittsu::protocol::ContactId const& contact) {
+			return QStringLiteral("message_%1.csv").arg(contact.toQString());
+		}
+
+		QStringList ContactMessageBackupObject::toBackupRecord() const {
+			// "created_at" holds the time the message was sent for outgoing and received for incoming messages, see fromBackupMatch().
+			openmittsu::protocol::MessageTime const& createdAt = m_isOutbox ? m_sentAt : m_receivedAt;
+			return { m_apiId.toQString(), m_uuid, toBackupColumn(m_isOutbox), toBackupColumn(m_isRead), toBackupColumn(m_isSaved), openmittsu::dataproviders::messages::UserMessageStateHelper::toString(m_messageState), toBackupColumn(m_createdAt), toBackupColumn(createdAt),
+				toBackupColumn(m_modifiedAt), openmittsu::dataproviders::messages::ContactMessageTypeHelper::toQString(m_messageType), m_body, toBackupColumn(m_isStatusMessage), toBackupColumn(m_isQueued), m_caption };
+		}
+
+		QStringList ContactMessageBackupObject::getBackupHeader() {
+			return { QStringLiteral("apiid"), QStringLiteral("uid"), QStringLiteral("isoutbox"), QStringLiteral("isread"), QStringLiteral("issaved"), QStringLiteral("messagestae"), QStringLiteral("posted_at"), QStringLiteral("created_at"), QStringLiteral("modified_at"), QStringLiteral("type"), QStringLiteral("body"), QStringLiteral("isstatusmessage"), QStringLiteral("isqueued"), QStringLiteral("caption") };
+		}
+
 		QHash<openmittsu::protocol::ContactId, QString> ContactMessageBackupObject::getContactMessageFiles(QDir const& path) {
 			QHash<openmittsu::protocol::ContactId, QString> result;
 
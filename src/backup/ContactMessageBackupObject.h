@@ -13,6 +13,7 @@
 #include <QDir>
 #include <QHash>
 #include <QString>
+#include <QStringList>
 
 namespace openmittsu {
 	namespace backup {
@@ -45,6 +46,11 @@ namespace openmittsu {
 			static ContactMessageBackupObject fromBackupMatch(openmittsu::protocol::ContactId const& contact, QHash<QString, int> const& headerOffsets, SimpleCsvLineSplitter const& splittedLines);
 
 			static QHash<openmittsu::protocol::ContactId, QString> getContactMessageFiles(QDir const& path);
+			static QString getContactMessageFileName(openmittsu::protocol::ContactId const& contact);
+
+			/** The columns of this message in its message file, in the order of getBackupHeader(). Parsing them yields an equal message. */
+			QStringList toBackupRecord() const;
+			static QStringList getBackupHeader();
 		private:
 			// "apiid","uid","isoutbox","isread","issaved","messagestae","posted_at","created_at","modified_at","type","body","isstatusmessage","isqueued","caption"
 			openmittsu::protocol::ContactId m_contact;
@@ -0,0 +1,190 @@
+#include "src/backup/CsvRecordReader.h"
+
+#include <cstring>
+
+#include "src/exceptions/IllegalArgumentException.h"
+#include "src/exceptions/InsufficientInputException.h"
+#include "src/exceptions/InvalidInputException.h"
+
+namespace openmittsu {
+	namespace backup {
+
+		CsvRecordReader::CsvRecordReader(QIODevice* device, int bufferSize) : m_device(device), m_bufferSize(bufferSize), m_buffer(), m_position(0), m_isAtStartOfInput(true), m_isAtEndOfInput(false), m_state(State::RECORD_START), m_recordData(), m_columnEnds(), m_recordNumber(0) {
+			if (m_device == nullptr) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "Can not read CSV records without a device.";
+			} else if (m_bufferSize < 1) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "The buffer size must be one or larger.";
+			}
+		}
+
+		CsvRecordReader::~CsvRecordReader() {
+			//
+		}
+
+		bool CsvRecordReader::fillBuffer() {
+			if (m_isAtEndOfInput) {
+				return false;
+			}
+
+			if (m_isAtStartOfInput) {
+				m_isAtStartOfInput = false;
+				if (m_device->peek(3) == QByteArray("\xEF\xBB\xBF")) {
+					m_device->read(3);
+				}
+			}
+
+			m_buffer.resize(m_bufferSize);
+			qint64 const bytesRead = m_device->read(m_buffer.data(), m_bufferSize);
+			if (bytesRead <= 0) {
+				m_buffer.resize(0);
+				m_isAtEndOfInput = true;
+				return false;
+			}
+			m_buffer.resize(static_cast<int>(bytesRead));
+			m_position = 0;
+			return true;
+		}
+
+		bool CsvRecordReader::readRecord() {
+			m_recordData.resize(0);
+			m_columnEnds.resize(0);
+			m_state = State::RECORD_START;
+
+			while (true) {
+				if ((m_position >= m_buffer.size()) && (!fillBuffer())) {
+					switch (m_state) {
+						case State::RECORD_START:
+							return false;
+						case State::AFTER_CARRIAGE_RETURN:
+							++m_recordNumber;
+							return true;
+						case State::QUOTE_IN_QUOTED_FIELD:
+							// The last record is not followed by a line break.
+							endField();
+							++m_recordNumber;
+							return true;
+						case State::FIELD_START:
+							throw openmittsu::exceptions::InsufficientInputException() << "Unexpected end of input after a separator in record " << (m_recordNumber + 1) << ".";
+						case State::IN_QUOTED_FIELD:
+						default:
+							throw openmittsu::exceptions::InsufficientInputException() << "Unexpected end of input inside a quoted field in record " << (m_recordNumber + 1) << ".";
+					}
+				}
+
+				char const* const bufferStart = m_buffer.constData();
+				char const* const bufferEnd = bufferStart + m_buffer.size();
+				char const* const current = bufferStart + m_position;
+
+				switch (m_state) {
+					case State::RECORD_START:
+						if ((*current == '\n') || (*current == '\r')) {
+							++m_position;
+						} else {
+							m_state = State::FIELD_START;
+						}
+						break;
+					case State::FIELD_START:
+						if (*current != '"') {
+							throw openmittsu::exceptions::InvalidInputException() << "Expected a \" at the start of column " << (m_columnEnds.size() + 1) << " in record " << (m_recordNumber + 1) << ", but found byte " << static_cast<int>(static_cast<unsigned char>(*current)) << " instead.";
+						}
+						++m_position;
+						m_state = State::IN_QUOTED_FIELD;
+						break;
+					case State::IN_QUOTED_FIELD:
+					{
+						// Everything up to the next quote, including line breaks, belongs to the field and is copied in one go.
+						char const* const quote = static_cast<char const*>(std::memchr(current, '"', static_cast<size_t>(bufferEnd - current)));
+						if (quote == nullptr) {
+							m_recordData.append(current, static_cast<int>(bufferEnd - current));
+							m_position = m_buffer.size();
+						} else {
+							m_recordData.append(current, static_cast<int>(quote - current));
+							m_position = static_cast<int>(quote - bufferStart) + 1;
+							m_state = State::QUOTE_IN_QUOTED_FIELD;
+						}
+						break;
+					}
+					case State::QUOTE_IN_QUOTED_FIELD:
+						++m_position;
+						if (*current == '"') {
+							m_recordData.append('"');
+							m_state = State::IN_QUOTED_FIELD;
+						} else if (*current == ',') {
+							endField();
+							m_state = State::FIELD_START;
+						} else if (*current == '\n') {
+							endField();
+							++m_recordNumber;
+							return true;
+						} else if (*current == '\r') {
+							endField();
+							m_state = State::AFTER_CARRIAGE_RETURN;
+						} else {
+							throw openmittsu::exceptions::InvalidInputException() << "Expected a \",\" or a line break after column " << (m_columnEnds.size() + 1) << " in record " << (m_recordNumber + 1) << ", but found byte " << static_cast<int>(static_cast<unsigned char>(*current)) << " instead.";
+						}
+						break;
+					case State::AFTER_CARRIAGE_RETURN:
+						if (*current == '\n') {
+							++m_position;
+						}
+						++m_recordNumber;
+						return true;
+				}
+			}
+		}
+
+		void CsvRecordReader::endField() {
+			m_columnEnds.append(m_recordData.size());
+		}
+
+		int CsvRecordReader::getColumnStart(int column) const {
+			return (column == 0) ? 0 : m_columnEnds.at(column - 1);
+		}
+
+		int CsvRecordReader::getColumnCount() const {
+			return m_columnEnds.size();
+		}
+
+		char const* CsvRecordReader::getColumnData(int column) const {
+			return m_recordData.constData() + getColumnStart(column);
+		}
+
+		int CsvRecordReader::getColumnSize(int column) const {
+			return m_columnEnds.at(column) - getColumnStart(column);
+		}
+
+		QString CsvRecordReader::getColumn(int column) const {
+			return QString::fromUtf8(getColumnData(column), getColumnSize(column));
+		}
+
+		QStringList CsvRecordReader::getColumns() const {
+			QStringList result;
+			result.reserve(m_columnEnds.size());
+			for (int i = 0; i < m_columnEnds.size(); ++i) {
+				result.append(getColumn(i));
+			}
+			return result;
+		}
+
+		qint64 CsvRecordReader::getRecordNumber() const {
+			return m_recordNumber;
+		}
+
+		qint64 CsvRecordReader::getRecordEndOffset() const {
+			return m_device->pos() - (m_buffer.size() - m_position);
+		}
+
+		bool CsvRecordReader::seek(qint64 offset) {
+			if (!m_device->seek(offset)) {
+				return false;
+			}
+
+			m_buffer.resize(0);
+			m_position = 0;
+			m_isAtStartOfInput = (offset == 0);
+			m_isAtEndOfInput = false;
+			return true;
+		}
+
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef OPENMITTSU_BACKUP_CSVRECORDREADER_H_
+#define OPENMITTSU_BACKUP_CSVRECORDREADER_H_
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace backup {
+
+		/**
+		 * Reads records of the CSV dialect used in data backups from a device, in one pass over a buffered byte stream.
+		 * Every field is enclosed in double quotes, a double quote inside a field is escaped by doubling it and fields may span several lines.
+		 * Records end with LF or CRLF, empty lines are skipped and a leading UTF-8 byte order mark is ignored.
+		 * The fields of the current record are stored unescaped in one buffer, which is reused for the next record.
+		 */
+		class CsvRecordReader {
+		public:
+			CsvRecordReader(QIODevice* device, int bufferSize = 64 * 1024);
+			virtual ~CsvRecordReader();
+
+			/**
+			 * Reads the next record, returns false at the end of the input.
+			 * Throws an InvalidInputException for malformed input and an InsufficientInputException if the input ends inside a field.
+			 */
+			bool readRecord();
+
+			int getColumnCount() const;
+
+			/** The raw UTF-8 bytes of a column, valid until the next call of readRecord(). */
+			char const* getColumnData(int column) const;
+			int getColumnSize(int column) const;
+
+			QString getColumn(int column) const;
+			QStringList getColumns() const;
+
+			/** The number of records read so far, counting from one. */
+			qint64 getRecordNumber() const;
+
+			/** The offset in the device right after the last record read. */
+			qint64 getRecordEndOffset() const;
+
+			/** Continues reading at offset, which has to be the start of a record, e.g. one returned by getRecordEndOffset(). Record numbers continue from the current one. */
+			bool seek(qint64 offset);
+		private:
+			enum class State {
+				RECORD_START,
+				FIELD_START,
+				IN_QUOTED_FIELD,
+				QUOTE_IN_QUOTED_FIELD,
+				AFTER_CARRIAGE_RETURN
+			};
+
+			QIODevice* const m_device;
+			int const m_bufferSize;
+			QByteArray m_buffer;
+			int m_position;
+			bool m_isAtStartOfInput;
+			bool m_isAtEndOfInput;
+
+			State m_state;
+			QByteArray m_recordData;
+			QVector<int> m_columnEnds;
+			qint64 m_recordNumber;
+
+			bool fillBuffer();
+			void endField();
+			int getColumnStart(int column) const;
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_BACKUP_CSVRECORDREADER_H_
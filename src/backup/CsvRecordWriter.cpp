@@ -0,0 +1,62 @@
+#include "src/backup/CsvRecordWriter.h"
+
+#include "src/exceptions/IllegalArgumentException.h"
+#include "src/exceptions/InternalErrorException.h"
+
+namespace openmittsu {
+	namespace backup {
+
+		CsvRecordWriter::CsvRecordWriter(QIODevice* device, int bufferSize) : m_device(device), m_bufferSize(bufferSize), m_buffer(), m_bytesWritten(0) {
+			if (m_device == nullptr) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "Can not write CSV records without a device.";
+			} else if (m_bufferSize < 1) {
+				throw openmittsu::exceptions::IllegalArgumentException() << "The buffer size must be one or larger.";
+			}
+			m_buffer.reserve(m_bufferSize);
+		}
+
+		CsvRecordWriter::~CsvRecordWriter() {
+			//
+		}
+
+		void CsvRecordWriter::writeRecord(QStringList const& columns) {
+			int const sizeBefore = m_buffer.size();
+			for (int i = 0; i < columns.size(); ++i) {
+				if (i > 0) {
+					m_buffer.append(',');
+				}
+				m_buffer.append('"');
+				QByteArray const data = columns.at(i).toUtf8();
+				if (data.contains('"')) {
+					QByteArray escaped(data);
+					m_buffer.append(escaped.replace("\"", "\"\""));
+				} else {
+					m_buffer.append(data);
+				}
+				m_buffer.append('"');
+			}
+			m_buffer.append('\n');
+			m_bytesWritten += m_buffer.size() - sizeBefore;
+
+			if (m_buffer.size() >= m_bufferSize) {
+				flush();
+			}
+		}
+
+		void CsvRecordWriter::flush() {
+			if (m_buffer.isEmpty()) {
+				return;
+			}
+
+			if (m_device->write(m_buffer) != m_buffer.size()) {
+				throw openmittsu::exceptions::InternalErrorException() << "Could not write CSV records: " << m_device->errorString().toStdString();
+			}
+			m_buffer.resize(0);
+		}
+
+		qint64 CsvRecordWriter::getBytesWritten() const {
+			return m_bytesWritten;
+		}
+
+	}
+}
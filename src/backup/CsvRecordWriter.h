@@ -0,0 +1,38 @@
+#ifndef OPENMITTSU_BACKUP_CSVRECORDWRITER_H_
+#define OPENMITTSU_BACKUP_CSVRECORDWRITER_H_
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace backup {
+
+		/**
+		 * Writes records in the CSV dialect read by CsvRecordReader: every field is enclosed in double quotes, double quotes inside are doubled and records end with LF.
+		 * Records are encoded as UTF-8 into a buffer, which is written to the device once it holds bufferSize bytes and by flush().
+		 */
+		class CsvRecordWriter {
+		public:
+			CsvRecordWriter(QIODevice* device, int bufferSize = 64 * 1024);
+			virtual ~CsvRecordWriter();
+
+			/** Throws an InternalErrorException if the device does not accept the data. */
+			void writeRecord(QStringList const& columns);
+			void flush();
+
+			/** The number of bytes handed to the writer so far, including those still buffered. */
+			qint64 getBytesWritten() const;
+		private:
+			QIODevice* const m_device;
+			int const m_bufferSize;
+			QByteArray m_buffer;
+			qint64 m_bytesWritten;
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_BACKUP_CSVRECORDWRITER_H_
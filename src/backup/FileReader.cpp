@@ -1,14 +1,12 @@
 #include "src/backup/FileReader.h"
 
 #include <QFile>
-#include <QTextStream>
 #include <QString>
 
 #include "src/utility/Logging.h"
 #include "src/exceptions/IllegalArgumentException.h"
 #include "src/exceptions/InternalErrorException.h"
 #include "src/exceptions/InvalidInputException.h"
-#include "src/exceptions/InsufficientInputException.h"
 
 #include "src/backup/SimpleCsvLineSplitter.h"
 
@@ -21,16 +19,30 @@ namespace openmittsu {
 	namespace backup {
 
 		template<typename T>
-		FileReader<T>::FileReader(QDir const& path, QString const& filename) : m_path(path), m_filename(filename), m_inputFile(m_path.filePath(m_filename)), m_inputStream() {
+		FileReader<T>::FileReader(QDir const& path, QString const& filename) : FileReader(path, filename, 0) {
+			//
+		}
+
+		template<typename T>
+		FileReader<T>::FileReader(QDir const& path, QString const& filename, qint64 resumeOffset) : m_path(path), m_filename(filename), m_inputFile(m_path.filePath(m_filename)), m_csvReader(&m_inputFile), m_hasPendingRecord(false), m_pendingRecordEndOffset(0), m_checkpointOffset(0), m_headerOffsets() {
 			if (!requireFileReadable()) {
 				throw openmittsu::exceptions::IllegalArgumentException() << "Could not parse file \"" << m_filename.toStdString() << "\", it is not readable.";
 			}
 
-			m_inputStream.setDevice(&m_inputFile);
-			m_inputStream.setCodec("UTF-8");
-
 			// parse header
-			m_headerOffsets = parseOffsets(m_inputStream.readLine());
+			if (m_csvReader.readRecord()) {
+				for (int i = 0; i < m_csvReader.getColumnCount(); ++i) {
+					m_headerOffsets.insert(m_csvReader.getColumn(i), i);
+				}
+			}
+			m_checkpointOffset = m_csvReader.getRecordEndOffset();
+
+			if (resumeOffset > m_checkpointOffset) {
+				if ((resumeOffset > m_inputFile.size()) || (!m_csvReader.seek(resumeOffset))) {
+					throw openmittsu::exceptions::IllegalArgumentException() << "Could not resume parsing file \"" << m_filename.toStdString() << "\" at offset " << resumeOffset << ", the file changed since.";
+				}
+				m_checkpointOffset = resumeOffset;
+			}
 		}
 
 		template<typename T>
@@ -40,26 +52,37 @@ namespace openmittsu {
 
 		template<typename T>
 		bool FileReader<T>::hasNext() {
-			return !m_inputStream.atEnd();
+			if (!m_hasPendingRecord) {
+				m_hasPendingRecord = m_csvReader.readRecord();
+				m_pendingRecordEndOffset = m_csvReader.getRecordEndOffset();
+			}
+			return m_hasPendingRecord;
 		}
 
 		template<typename T>
 		T FileReader<T>::getNext() {
-			QString line;
-			while (true) {
-				if (!m_inputStream.atEnd()) {
-					line.append(m_inputStream.readLine());
-
-					try {
-						SimpleCsvLineSplitter const splittedLines = SimpleCsvLineSplitter::split(m_headerOffsets.size(), line);
-						return T::fromBackupMatch(m_filename, m_headerOffsets, splittedLines);
-					} catch (openmittsu::exceptions::InsufficientInputExceptionImpl&) {
-						continue;
-					}
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "There is no next, yet getNext() was called!";
-				}
+			if (!hasNext()) {
+				throw openmittsu::exceptions::InternalErrorException() << "There is no next, yet getNext() was called!";
+			}
+			m_hasPendingRecord = false;
+			m_checkpointOffset = m_pendingRecordEndOffset;
+
+			if (m_csvReader.getColumnCount() < m_headerOffsets.size()) {
+				throw openmittsu::exceptions::InvalidInputException() << "Record " << m_csvReader.getRecordNumber() << " in file \"" << m_filename.toStdString() << "\" has " << m_csvReader.getColumnCount() << " columns, but the header names " << m_headerOffsets.size() << ".";
 			}
+
+			SimpleCsvLineSplitter const splittedLines(m_csvReader.getColumns());
+			return T::fromBackupMatch(m_filename, m_headerOffsets, splittedLines);
+		}
+
+		template<typename T>
+		qint64 FileReader<T>::getBytesRead() const {
+			return m_inputFile.pos();
+		}
+
+		template<typename T>
+		qint64 FileReader<T>::getCheckpointOffset() const {
+			return m_checkpointOffset;
 		}
 
 		template<typename T>
@@ -78,18 +101,6 @@ namespace openmittsu {
 			return true;
 		}
 
-		template<typename T>
-		QHash<QString, int> FileReader<T>::parseOffsets(QString const& header) const {
-			QHash<QString, int> result;
-			QStringList const parts = header.split(',', QString::SkipEmptyParts);
-			for (int i = 0; i < parts.size(); ++i) {
-				int const size = parts.at(i).size();
-				result.insert(parts.at(i).mid(1, size - 2), i);
-			}
-			return result;
-		}
-
-
 		template class FileReader<ContactBackupObject>;
 		template class FileReader<GroupBackupObject>;
 		template class FileReader<ContactMessageBackupObject>;
@@ -5,10 +5,11 @@
 #include <QFile>
 #include <QHash>
 #include <QString>
-#include <QTextStream>
 #include <QVector>
 #include <cstdint>
 
+#include "src/backup/CsvRecordReader.h"
+
 namespace openmittsu {
 	namespace backup {
 
@@ -16,18 +17,29 @@ namespace openmittsu {
 		class FileReader {
 		public:
 			FileReader(QDir const& path, QString const& filename);
+
+			/** Continues reading at resumeOffset, which was returned by getCheckpointOffset() for the same file before. */
+			FileReader(QDir const& path, QString const& filename, qint64 resumeOffset);
 			virtual ~FileReader();
 
 			bool hasNext();
 			T getNext();
+
+			/** The number of bytes of the file consumed so far. */
+			qint64 getBytesRead() const;
+
+			/** The offset right after the record last returned by getNext(), where reading resumes after an interruption. */
+			qint64 getCheckpointOffset() const;
 		private:
 			bool requireFileReadable();
-			QHash<QString, int> parseOffsets(QString const& header) const;
 
 			QDir const m_path;
 			QString const m_filename;
 			QFile m_inputFile;
-			QTextStream m_inputStream;
+			CsvRecordReader m_csvReader;
+			bool m_hasPendingRecord;
+			qint64 m_pendingRecordEndOffset;
+			qint64 m_checkpointOffset;
 			QHash<QString, int> m_headerOffsets;
 		};
 
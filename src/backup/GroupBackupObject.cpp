@@ -1,6 +1,7 @@
 #include "src/backup/GroupBackupObject.h"
 
 #include "src/exceptions/IllegalArgumentException.h"
+#include "src/protocol/ContactIdList.h"
 
 #include "src/utility/Logging.h"
 
@@ -36,6 +37,14 @@ namespace openmittsu {
 			return m_isDeleted;
 		}
 
+		QStringList GroupBackupObject::toBackupRecord() const {
+			return { m_id.groupIdWithoutOwnerToQString(), m_id.getOwner().toQString(), m_name, toBackupColumn(m_createdAt), openmittsu::protocol::ContactIdList(m_members).toString(QChar(';')), toBackupColumn(m_isDeleted) };
+		}
+
+		QStringList GroupBackupObject::getBackupHeader() {
+			return { QStringLiteral("id"), QStringLiteral("creator"), QStringLiteral("groupname"), QStringLiteral("created_at"), QStringLiteral("members"), QStringLiteral("deleted") };
+		}
+
 		GroupBackupObject GroupBackupObject::fromBackupMatch(QString const&, QHash<QString, int> const& headerOffsets, SimpleCsvLineSplitter const& splittedLines) {
 			QSet<QString> const requiredFields = { QStringLiteral("id"), QStringLiteral("creator"), QStringLiteral("groupname"), QStringLiteral("created_at"), QStringLiteral("members"), QStringLiteral("deleted") };
 			if (!hasRequiredFields(requiredFields, headerOffsets)) {
@@ -10,6 +10,8 @@
 #include "src/crypto/PublicKey.h"
 #include "src/protocol/ContactIdVerificationStatus.h"
 
+#include <QStringList>
+
 namespace openmittsu {
 	namespace backup {
 
@@ -25,6 +27,10 @@ namespace openmittsu {
 			bool getIsDeleted() const;
 
 			static GroupBackupObject fromBackupMatch(QString const& filename, QHash<QString, int> const& headerOffsets, SimpleCsvLineSplitter const& splittedLines);
+
+			/** The columns of this group in groups.csv, in the order of getBackupHeader(). */
+			QStringList toBackupRecord() const;
+			static QStringList getBackupHeader();
 		private:
 			openmittsu::protocol::GroupId m_id;
 			QString m_name;
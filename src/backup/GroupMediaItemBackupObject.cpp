@@ -32,6 +32,10 @@ namespace openmittsu {
 			return GroupMediaItemBackupObject(data, uuid);
 		}
 
+		QString GroupMediaItemBackupObject::getGroupMediaFileName(QString const& uuid) {
+			return QStringLiteral("group_message_media_%1").arg(uuid);
+		}
+
 		QHash<QString, QString> GroupMediaItemBackupObject::getGroupMediaFiles(QDir const& path) {
 			QHash<QString, QString> result;
 
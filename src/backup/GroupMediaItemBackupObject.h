@@ -19,6 +19,7 @@ namespace openmittsu {
 
 			static GroupMediaItemBackupObject fromFile(QDir const& path, QString const& filename);
 			static QHash<QString, QString> getGroupMediaFiles(QDir const& path);
+			static QString getGroupMediaFileName(QString const& uuid);
 		};
 
 	}
@@ -128,6 +128,20 @@ namespace openmittsu {
 			}
 		}
 
+		QString GroupMessageBackupObject::getGroupMessageFileName(openmittsu::protocol::GroupId const& group) {
+			return QStringLiteral("group_message_%1-%2.csv").arg(group.groupIdWithoutOwnerToQString()).arg(group.getOwner().toQString());
+		}
+
+		QStringList GroupMessageBackupObject::toBackupRecord() const {
+			openmittsu::protocol::MessageTime const& createdAt = m_isOutbox ? m_sentAt : m_receivedAt;
+			return { m_apiId.toQString(), m_uuid, m_contact.toQString(), toBackupColumn(m_isOutbox), toBackupColumn(m_isRead), toBackupColumn(m_isSaved), openmittsu::dataproviders::messages::UserMessageStateHelper::toString(m_messageState), toBackupColumn(m_createdAt), toBackupColumn(createdAt),
+				toBackupColumn(m_modifiedAt), openmittsu::dataproviders::messages::GroupMessageTypeHelper::toQString(m_messageType), m_body, toBackupColumn(m_isStatusMessage), toBackupColumn(m_isQueued), m_caption };
+		}
+
+		QStringList GroupMessageBackupObject::getBackupHeader() {
+			return { QStringLiteral("apiid"), QStringLiteral("uid"), QStringLiteral("identity"), QStringLiteral("isoutbox"), QStringLiteral("isread"), QStringLiteral("issaved"), QStringLiteral("messagestae"), QStringLiteral("posted_at"), QStringLiteral("created_at"), QStringLiteral("modified_at"), QStringLiteral("type"), QStringLiteral("body"), QStringLiteral("isstatusmessage"), QStringLiteral("isqueued"), QStringLiteral("caption") };
+		}
+
 		QHash<openmittsu::protocol::GroupId, QString> GroupMessageBackupObject::getGroupMessageFiles(QDir const& path) {
 			QHash<openmittsu::protocol::GroupId, QString> result;
 
@@ -14,6 +14,7 @@
 #include <QDir>
 #include <QHash>
 #include <QString>
+#include <QStringList>
 
 namespace openmittsu {
 	namespace backup {
@@ -45,6 +46,11 @@ namespace openmittsu {
 
 			static GroupMessageBackupObject fromBackupMatch(QString const& filename, QHash<QString, int> const& headerOffsets, SimpleCsvLineSplitter const& splittedLines);
 			static QHash<openmittsu::protocol::GroupId, QString> getGroupMessageFiles(QDir const& path);
+			static QString getGroupMessageFileName(openmittsu::protocol::GroupId const& group);
+
+			/** The columns of this message in its message file, in the order of getBackupHeader(). Parsing them yields an equal message. */
+			QStringList toBackupRecord() const;
+			static QStringList getBackupHeader();
 		private:
 			// "apiid","uid","identity","isoutbox","isread","issaved","messagestae","posted_at","created_at","modified_at","type","body","isstatusmessage","isqueued","caption"
 			openmittsu::protocol::GroupId m_group;
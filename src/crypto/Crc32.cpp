@@ -1,8 +1,38 @@
 /* Crc - 32 BIT ANSI X3.66 CRC checksum files */
 #include "src/crypto/Crc32.h"
 
+#include "src/exceptions/InternalErrorException.h"
+
 #include <QString>
 
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define OPENMITTSU_CRC32_HAVE_PCLMUL
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define OPENMITTSU_CRC32_TARGET_PCLMUL
+#else
+#include <cpuid.h>
+#define OPENMITTSU_CRC32_TARGET_PCLMUL __attribute__((target("sse4.1,pclmul")))
+#endif
+#endif
+
+#if defined(__aarch64__) && !defined(__AARCH64EB__) && defined(__linux__) && (defined(__GNUC__) || defined(__clang__))
+#define OPENMITTSU_CRC32_HAVE_ARMV8
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#if defined(__clang__)
+#define OPENMITTSU_CRC32_TARGET_ARMV8 __attribute__((target("crc")))
+#else
+#define OPENMITTSU_CRC32_TARGET_ARMV8 __attribute__((target("+crc")))
+#endif
+#endif
+
 namespace openmittsu {
 	namespace crypto {
 
@@ -115,17 +145,233 @@ static UNS_32_BITS crc_32_tab[] = { /* CRC polynomial 0xedb88320 */
 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-		uint32_t Crc32::crc32buf(char const* buf, size_t len) {
-			uint32_t oldcrc32 = 0xFFFFFFFF;
-			for ( ; len > 0; --len, ++buf) {
-				oldcrc32 = UPDC32(*buf, oldcrc32);
+		namespace {
+			/** The implementations work on the inverted register value, so calls can be chained without inverting in between. */
+			typedef uint32_t (*UpdateFunction)(uint32_t crc, unsigned char const* buf, size_t len);
+
+			uint32_t updateBytewise(uint32_t crc, unsigned char const* buf, size_t len) {
+				for (; len > 0; --len, ++buf) {
+					crc = UPDC32(*buf, crc);
+				}
+				return crc;
+			}
+
+			struct SlicingTables {
+				uint32_t table[8][256];
+
+				SlicingTables() {
+					for (int i = 0; i < 256; ++i) {
+						table[0][i] = crc_32_tab[i];
+					}
+					for (int k = 1; k < 8; ++k) {
+						for (int i = 0; i < 256; ++i) {
+							table[k][i] = (table[k - 1][i] >> 8) ^ crc_32_tab[table[k - 1][i] & 0xff];
+						}
+					}
+				}
+			};
+
+			SlicingTables const& getSlicingTables() {
+				static SlicingTables const tables;
+				return tables;
+			}
+
+			inline uint32_t loadLittleEndian32(unsigned char const* buf) {
+				return static_cast<uint32_t>(buf[0]) | (static_cast<uint32_t>(buf[1]) << 8) | (static_cast<uint32_t>(buf[2]) << 16) | (static_cast<uint32_t>(buf[3]) << 24);
+			}
+
+			uint32_t updateSlicingBy8(uint32_t crc, unsigned char const* buf, size_t len) {
+				uint32_t const (&t)[8][256] = getSlicingTables().table;
+				while (len >= 8) {
+					uint32_t const one = crc ^ loadLittleEndian32(buf);
+					uint32_t const two = loadLittleEndian32(buf + 4);
+					crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^ t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+					buf += 8;
+					len -= 8;
+				}
+				return updateBytewise(crc, buf, len);
+			}
+
+#ifdef OPENMITTSU_CRC32_HAVE_PCLMUL
+			bool isPclmulSupported() {
+				// CPUID leaf 1, ECX: bit 1 is PCLMULQDQ, bit 19 is SSE4.1.
+				unsigned int ecx = 0;
+#if defined(_MSC_VER) && !defined(__clang__)
+				int registers[4] = { 0, 0, 0, 0 };
+				__cpuid(registers, 1);
+				ecx = static_cast<unsigned int>(registers[2]);
+#else
+				unsigned int eax = 0, ebx = 0, edx = 0;
+				if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+					return false;
+				}
+#endif
+				return ((ecx & (1u << 1)) != 0) && ((ecx & (1u << 19)) != 0);
+			}
+
+			/**
+			 * Folds 64 byte blocks with carry-less multiplication and reduces the remainder with Barrett reduction, following
+			 * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Gopal et al., Intel 2009).
+			 * The constants are those for the bit-reflected polynomial 0xEDB88320. Requires len >= 64 and a multiple of 16.
+			 */
+			OPENMITTSU_CRC32_TARGET_PCLMUL uint32_t foldPclmul(uint32_t crc, unsigned char const* buf, size_t len) {
+				__m128i const k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+				__m128i const k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+				__m128i const k5k0 = _mm_set_epi64x(0x0000000000LL, 0x0163cd6124LL);
+				__m128i const poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+				__m128i const mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+				__m128i x1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x00));
+				__m128i x2 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x10));
+				__m128i x3 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x20));
+				__m128i x4 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x30));
+				x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+				buf += 64;
+				len -= 64;
+
+				// Four independent folds per round keep the multiplier busy.
+				while (len >= 64) {
+					__m128i const x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+					__m128i const x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+					__m128i const x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+					__m128i const x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+					x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+					x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+					x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+					x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+					x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x00)));
+					x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x10)));
+					x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x20)));
+					x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf + 0x30)));
+					buf += 64;
+					len -= 64;
+				}
+
+				// Fold the four lanes into one.
+				__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+				x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+				x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+				x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+				x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+				x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+
+				while (len >= 16) {
+					x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+					x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_loadu_si128(reinterpret_cast<__m128i const*>(buf))), x5);
+					buf += 16;
+					len -= 16;
+				}
+
+				// Fold 128 to 64 bits.
+				x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+				x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+				x2 = _mm_srli_si128(x1, 4);
+				x1 = _mm_and_si128(x1, mask32);
+				x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+				// Barrett reduction to 32 bits.
+				x2 = _mm_and_si128(x1, mask32);
+				x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+				x2 = _mm_and_si128(x2, mask32);
+				x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+				x1 = _mm_xor_si128(x1, x2);
+
+				return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+			}
+
+			uint32_t updatePclmul(uint32_t crc, unsigned char const* buf, size_t len) {
+				if (len >= 64) {
+					size_t const foldedLength = len & ~static_cast<size_t>(15);
+					crc = foldPclmul(crc, buf, foldedLength);
+					buf += foldedLength;
+					len -= foldedLength;
+				}
+				return updateSlicingBy8(crc, buf, len);
+			}
+#endif
+
+#ifdef OPENMITTSU_CRC32_HAVE_ARMV8
+			bool isArmv8CrcSupported() {
+				return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+			}
+
+			OPENMITTSU_CRC32_TARGET_ARMV8 uint32_t updateArmv8(uint32_t crc, unsigned char const* buf, size_t len) {
+				for (; (len > 0) && ((reinterpret_cast<uintptr_t>(buf) & 7) != 0); --len, ++buf) {
+					crc = __crc32b(crc, *buf);
+				}
+				for (; len >= 8; len -= 8, buf += 8) {
+					uint64_t value;
+					memcpy(&value, buf, sizeof(value));
+					crc = __crc32d(crc, value);
+				}
+				for (; len > 0; --len, ++buf) {
+					crc = __crc32b(crc, *buf);
+				}
+				return crc;
+			}
+#endif
+
+			UpdateFunction getUpdateFunction(Crc32::Implementation implementation) {
+				switch (implementation) {
+					case Crc32::Implementation::BYTEWISE:
+						return &updateBytewise;
+					case Crc32::Implementation::SLICING_BY_8:
+						return &updateSlicingBy8;
+#ifdef OPENMITTSU_CRC32_HAVE_PCLMUL
+					case Crc32::Implementation::PCLMUL:
+						return isPclmulSupported() ? &updatePclmul : nullptr;
+#endif
+#ifdef OPENMITTSU_CRC32_HAVE_ARMV8
+					case Crc32::Implementation::ARMV8:
+						return isArmv8CrcSupported() ? &updateArmv8 : nullptr;
+#endif
+					default:
+						return nullptr;
+				}
 			}
 
-			return ~oldcrc32;
+			Crc32::Implementation selectImplementation() {
+				if (getUpdateFunction(Crc32::Implementation::PCLMUL) != nullptr) {
+					return Crc32::Implementation::PCLMUL;
+				} else if (getUpdateFunction(Crc32::Implementation::ARMV8) != nullptr) {
+					return Crc32::Implementation::ARMV8;
+				}
+				return Crc32::Implementation::SLICING_BY_8;
+			}
+
+			UpdateFunction getSelectedUpdateFunction() {
+				static UpdateFunction const selectedFunction = getUpdateFunction(Crc32::getSelectedImplementation());
+				return selectedFunction;
+			}
+		}
+
+		uint32_t Crc32::crc32buf(uint32_t crc, char const* buf, size_t len) {
+			return ~getSelectedUpdateFunction()(~crc, reinterpret_cast<unsigned char const*>(buf), len);
 		}
 
 		uint32_t Crc32::checksum(QByteArray const& data) {
-			return crc32buf(data.data(), data.size());
+			return crc32buf(0, data.data(), data.size());
+		}
+
+		uint32_t Crc32::update(uint32_t checksum, char const* data, size_t len) {
+			return crc32buf(checksum, data, len);
+		}
+
+		uint32_t Crc32::update(Implementation implementation, uint32_t checksum, char const* data, size_t len) {
+			UpdateFunction const function = getUpdateFunction(implementation);
+			if (function == nullptr) {
+				throw openmittsu::exceptions::InternalErrorException() << "The CRC32 implementation " << static_cast<int>(implementation) << " is not available on this system.";
+			}
+			return ~function(~checksum, reinterpret_cast<unsigned char const*>(data), len);
+		}
+
+		bool Crc32::isAvailable(Implementation implementation) {
+			return getUpdateFunction(implementation) != nullptr;
+		}
+
+		Crc32::Implementation Crc32::getSelectedImplementation() {
+			static Implementation const selectedImplementation = selectImplementation();
+			return selectedImplementation;
 		}
 
 		QString Crc32::toString(uint32_t checksum) {
@@ -8,12 +8,31 @@
 namespace openmittsu {
 	namespace crypto {
 
+		/**
+		 * CRC-32 as used by zlib and PNG (reflected polynomial 0xEDB88320).
+		 * The fastest implementation supported by the CPU is selected on first use, all of them compute the same checksum.
+		 */
 		class Crc32 {
 		public:
+			enum class Implementation {
+				BYTEWISE,
+				SLICING_BY_8,
+				PCLMUL,
+				ARMV8
+			};
+
 			static uint32_t checksum(QByteArray const& data);
+
+			/** Continues a checksum over further data, update(checksum(a), b) equals checksum(a + b). Start with zero for an empty prefix. */
+			static uint32_t update(uint32_t checksum, char const* data, size_t len);
 			static QString toString(uint32_t checksum);
+
+			/** Computes the checksum with a specific implementation, which has to be available. Meant for tests and benchmarks. */
+			static uint32_t update(Implementation implementation, uint32_t checksum, char const* data, size_t len);
+			static bool isAvailable(Implementation implementation);
+			static Implementation getSelectedImplementation();
 		private:
-			static uint32_t crc32buf(char const* buf, size_t len);
+			static uint32_t crc32buf(uint32_t crc, char const* buf, size_t len);
 		};
 
 	}
@@ -31,10 +31,13 @@
 /*
  * Modifications to this file and header: 
  * - 2017.11: On Debian, this file clashes with linking OpenSSL and leads to segfaults. Renamed functions to resolve.
+ * - PBKDF2 precomputes the HMAC pad states and compresses each iteration directly, the block function works on 32 bit words.
  */
 
 #include "src/crypto/pbkdf2-sha256.h"
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -98,10 +101,11 @@ void openmittsu_sha2_starts( openmittsu_sha2_context *ctx, int is224 )
     ctx->is224 = is224;
 }
 
-static void openmittsu_sha2_process( openmittsu_sha2_context *ctx, const unsigned char data[64] )
+static void openmittsu_sha2_process( unsigned long state[8], const unsigned char data[64] )
 {
-    unsigned long temp1, temp2, W[64];
-    unsigned long A, B, C, D, E, F, G, H;
+    /* 32 bit words, so the rotations need no masking where unsigned long is wider */
+    uint32_t temp1, temp2, W[64];
+    uint32_t A, B, C, D, E, F, G, H;
 
     GET_ULONG_BE( W[ 0], data,  0 );
     GET_ULONG_BE( W[ 1], data,  4 );
@@ -145,14 +149,14 @@ static void openmittsu_sha2_process( openmittsu_sha2_context *ctx, const unsigne
     d += temp1; h = temp1 + temp2;              \
 }
 
-	A = ctx->state[0];
-	B = ctx->state[1];
-	C = ctx->state[2];
-	D = ctx->state[3];
-	E = ctx->state[4];
-	F = ctx->state[5];
-	G = ctx->state[6];
-	H = ctx->state[7];
+	A = state[0];
+	B = state[1];
+	C = state[2];
+	D = state[3];
+	E = state[4];
+	F = state[5];
+	G = state[6];
+	H = state[7];
 
     P( A, B, C, D, E, F, G, H, W[ 0], 0x428A2F98 );
     P( H, A, B, C, D, E, F, G, W[ 1], 0x71374491 );
@@ -219,14 +223,14 @@ static void openmittsu_sha2_process( openmittsu_sha2_context *ctx, const unsigne
     P( C, D, E, F, G, H, A, B, R(62), 0xBEF9A3F7 );
     P( B, C, D, E, F, G, H, A, R(63), 0xC67178F2 );
 
-    ctx->state[0] += A;
-    ctx->state[1] += B;
-    ctx->state[2] += C;
-    ctx->state[3] += D;
-    ctx->state[4] += E;
-    ctx->state[5] += F;
-    ctx->state[6] += G;
-    ctx->state[7] += H;
+    state[0] += A;
+    state[1] += B;
+    state[2] += C;
+    state[3] += D;
+    state[4] += E;
+    state[5] += F;
+    state[6] += G;
+    state[7] += H;
 }
 
 /*
@@ -253,7 +257,7 @@ void openmittsu_sha2_update( openmittsu_sha2_context *ctx, const unsigned char *
     {
         memcpy( (void *) (ctx->buffer + left),
                 (void *) input, fill );
-		openmittsu_sha2_process( ctx, ctx->buffer );
+		openmittsu_sha2_process( ctx->state, ctx->buffer );
         input += fill;
         ilen  -= fill;
         left = 0;
@@ -261,7 +265,7 @@ void openmittsu_sha2_update( openmittsu_sha2_context *ctx, const unsigned char *
 
     while( ilen >= 64 )
     {
-		openmittsu_sha2_process( ctx, input );
+		openmittsu_sha2_process( ctx->state, input );
         input += 64;
         ilen  -= 64;
     }
@@ -416,41 +420,82 @@ void openmittsu_sha2_hmac(unsigned char const* key, size_t keylen, unsigned char
 #define min( a, b ) ( ((a) < (b)) ? (a) : (b) )
 #endif
 
+/*
+ * PBKDF2-HMAC-SHA-256 (RFC 8018)
+ *
+ * Every iteration hashes a single 32 byte digest, so instead of setting up a full HMAC context each time, the states after
+ * absorbing the inner and outer padded key are computed once per call. An iteration then is exactly two compressions on a
+ * block holding the digest followed by its fixed padding. All working state lives on the stack, so concurrent calls are safe.
+ */
 void openmittsu_PKCS5_PBKDF2_HMAC(unsigned char const* password, size_t plen, unsigned char const* salt, size_t slen, const unsigned long iteration_count, const unsigned long key_length, unsigned char* output) {
+	openmittsu_sha2_context hmacCtx;
 	openmittsu_sha2_context ctx;
-	openmittsu_sha2_starts(&ctx, 0);
 
 	// Size of the generated digest
-	unsigned char md_size = 32;
-	unsigned char md1[32];
+	unsigned char const md_size = 32;
 	unsigned char work[32];
 
+	unsigned long innerState[8];
+	unsigned long outerState[8];
+	unsigned long state[8];
+
+	// The digest, the 0x80 terminator and the message length of 64 + 32 bytes, i.e. 768 bits, in the last two bytes.
+	unsigned char block[64];
+	memset(block, 0, sizeof(block));
+	block[32] = 0x80;
+	block[62] = 0x03;
+
+	openmittsu_sha2_hmac_starts(&hmacCtx, password, plen, 0);
+	memcpy(innerState, hmacCtx.state, sizeof(innerState));
+	openmittsu_sha2_starts(&ctx, 0);
+	openmittsu_sha2_update(&ctx, hmacCtx.opad, 64);
+	memcpy(outerState, ctx.state, sizeof(outerState));
+
 	unsigned long counter = 1;
 	unsigned long generated_key_length = 0;
 	while (generated_key_length < key_length) {
-		// U1 ends up in md1 and work
+		// U1 ends up in block and work
 		unsigned char c[4];
 		c[0] = (counter >> 24) & 0xff;
 		c[1] = (counter >> 16) & 0xff;
 		c[2] = (counter >> 8) & 0xff;
 		c[3] = (counter >> 0) & 0xff;
 
-		openmittsu_sha2_hmac_starts(&ctx, password, plen, 0);
+		memcpy(&ctx, &hmacCtx, sizeof(ctx));
 		openmittsu_sha2_hmac_update(&ctx, salt, slen);
 		openmittsu_sha2_hmac_update(&ctx, c, 4);
-		openmittsu_sha2_hmac_finish(&ctx, md1);
-		memcpy(work, md1, md_size);
+		openmittsu_sha2_hmac_finish(&ctx, block);
+		memcpy(work, block, md_size);
 
 		unsigned long ic = 1;
 		for (ic = 1; ic < iteration_count; ic++) {
-			// U2 ends up in md1
-			openmittsu_sha2_hmac_starts(&ctx, password, plen, 0);
-			openmittsu_sha2_hmac_update(&ctx, md1, md_size);
-			openmittsu_sha2_hmac_finish(&ctx, md1);
+			// U2 = HMAC(password, U1) ends up in block
+			memcpy(state, innerState, sizeof(state));
+			openmittsu_sha2_process(state, block);
+			PUT_ULONG_BE(state[0], block, 0);
+			PUT_ULONG_BE(state[1], block, 4);
+			PUT_ULONG_BE(state[2], block, 8);
+			PUT_ULONG_BE(state[3], block, 12);
+			PUT_ULONG_BE(state[4], block, 16);
+			PUT_ULONG_BE(state[5], block, 20);
+			PUT_ULONG_BE(state[6], block, 24);
+			PUT_ULONG_BE(state[7], block, 28);
+
+			memcpy(state, outerState, sizeof(state));
+			openmittsu_sha2_process(state, block);
+			PUT_ULONG_BE(state[0], block, 0);
+			PUT_ULONG_BE(state[1], block, 4);
+			PUT_ULONG_BE(state[2], block, 8);
+			PUT_ULONG_BE(state[3], block, 12);
+			PUT_ULONG_BE(state[4], block, 16);
+			PUT_ULONG_BE(state[5], block, 20);
+			PUT_ULONG_BE(state[6], block, 24);
+			PUT_ULONG_BE(state[7], block, 28);
+
 			// U1 xor U2
 			unsigned long i = 0;
 			for (i = 0; i < md_size; i++) {
-				work[i] ^= md1[i];
+				work[i] ^= block[i];
 			}
 			// and so on until iteration_count
 		}
@@ -461,8 +506,15 @@ void openmittsu_PKCS5_PBKDF2_HMAC(unsigned char const* password, size_t plen, un
 		generated_key_length += bytes_to_write;
 		++counter;
 	}
-}
 
+	memset(&hmacCtx, 0, sizeof(hmacCtx));
+	memset(&ctx, 0, sizeof(ctx));
+	memset(innerState, 0, sizeof(innerState));
+	memset(outerState, 0, sizeof(outerState));
+	memset(state, 0, sizeof(state));
+	memset(block, 0, sizeof(block));
+	memset(work, 0, sizeof(work));
+}
 
 #ifdef __cplusplus
 }
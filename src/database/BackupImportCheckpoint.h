@@ -0,0 +1,19 @@
+#ifndef OPENMITTSU_DATABASE_BACKUPIMPORTCHECKPOINT_H_
+#define OPENMITTSU_DATABASE_BACKUPIMPORTCHECKPOINT_H_
+
+#include <QString>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace database {
+		/** How far a file of a data backup was imported. Stored together with the records it covers, so an interrupted import resumes right after them. */
+		struct BackupImportCheckpoint {
+			QString fileName;
+			/** The byte offset in the file right after the last record stored. */
+			qint64 offset;
+			bool isComplete;
+		};
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_BACKUPIMPORTCHECKPOINT_H_
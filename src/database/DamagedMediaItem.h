@@ -0,0 +1,26 @@
+#ifndef OPENMITTSU_DATABASE_DAMAGEDMEDIAITEM_H_
+#define OPENMITTSU_DATABASE_DAMAGEDMEDIAITEM_H_
+
+#include "src/database/MediaFileItem.h"
+#include "src/database/MediaFileType.h"
+
+#include <QList>
+#include <QMetaType>
+#include <QString>
+
+namespace openmittsu {
+	namespace database {
+		struct DamagedMediaItem {
+			QString uuid;
+			MediaFileType fileType;
+			MediaFileItem::ItemStatus status;
+		};
+
+		typedef QList<DamagedMediaItem> DamagedMediaItemList;
+	}
+}
+
+Q_DECLARE_METATYPE(openmittsu::database::DamagedMediaItem)
+Q_DECLARE_METATYPE(openmittsu::database::DamagedMediaItemList)
+
+#endif // OPENMITTSU_DATABASE_DAMAGEDMEDIAITEM_H_
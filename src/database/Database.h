@@ -11,7 +11,11 @@
 #include "src/backup/IdentityBackup.h"
 #include "src/database/DatabaseSeekResult.h"
 #include "src/database/ContactData.h"
+#include "src/database/DamagedMediaItem.h"
 #include "src/database/GroupData.h"
+#include "src/database/MaintenanceStatistics.h"
+#include "src/database/MediaCacheStatistics.h"
+#include "src/database/MediaIntegrityReport.h"
 #include "src/database/NewContactData.h"
 #include "src/database/NewGroupData.h"
 #include "src/dataproviders/SentMessageAcceptor.h"
@@ -144,6 +148,7 @@ namespace openmittsu {
 			// Contact Data
 			virtual ContactData getContactData(openmittsu::protocol::ContactId const& contact, bool fetchMessageCount) const = 0;
 			virtual ContactToContactDataMap getContactDataAll(bool fetchMessageCount) const = 0;
+			virtual ContactToContactDataMap getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const = 0;
 			virtual openmittsu::crypto::PublicKey getContactPublicKey(openmittsu::protocol::ContactId const& identity) const = 0;
 			virtual int getContactCount() const = 0;
 
@@ -161,6 +166,7 @@ namespace openmittsu {
 			// Group Data
 			virtual GroupData getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const = 0;
 			virtual GroupToGroupDataMap getGroupDataAll(bool withDescription) const = 0;
+			virtual GroupToGroupDataMap getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const = 0;
 			virtual int getGroupCount() const = 0;
 			virtual QSet<openmittsu::protocol::ContactId> getGroupMembers(openmittsu::protocol::GroupId const& group, bool excludeSelfContact) const = 0;
 
@@ -186,6 +192,31 @@ namespace openmittsu {
 			// Options
 			virtual openmittsu::database::OptionNameToValueMap getOptions() = 0;
 			virtual void setOptions(openmittsu::database::OptionNameToValueMap const& options) = 0;
+
+			// Maintenance
+			virtual bool isIncrementalVacuumEnabled() const = 0;
+			/** Rewrites a database created before incremental vacuuming once, so maintenance runs can give free pages back. Blocks until done, returns false if it failed. */
+			virtual bool enableIncrementalVacuum() = 0;
+			/** Runs a full maintenance right away, without waiting for openMittsu to be idle. Blocks until done, returns false if it failed. */
+			virtual bool runMaintenance() = 0;
+			virtual openmittsu::database::MaintenanceStatistics getMaintenanceStatistics() = 0;
+			virtual openmittsu::database::MediaCacheStatistics getMediaCacheStatistics() const = 0;
+
+			// Media integrity
+			/** Checks all media files in short slices on the database thread, replacing a scan still in progress. With repair, broken items are marked and unreferenced files removed. */
+			virtual void startMediaIntegrityScan(bool repair) = 0;
+			virtual void cancelMediaIntegrityScan() = 0;
+			virtual bool isMediaIntegrityScanRunning() const = 0;
+			virtual openmittsu::database::MediaIntegrityReport getMediaIntegrityScanReport() const = 0;
+			/** Returns the items marked as damaged by repairing scans. */
+			virtual openmittsu::database::DamagedMediaItemList getDamagedMediaItems() const = 0;
+
+			// Data backup
+			/**
+			 * Writes a data backup into the empty directory backupPath on the database thread, other calls wait until it is done.
+			 * Progress and the result are reported by dataBackupExportProgressUpdated() and dataBackupExportFinished().
+			 */
+			virtual void exportDataBackup(QString const& backupPath, QString const& backupPassword) = 0;
 		signals:
 			void contactChanged(openmittsu::protocol::ContactId const& identity);
 			void groupChanged(openmittsu::protocol::GroupId const& changedGroupId);
@@ -199,6 +230,8 @@ namespace openmittsu {
 			void contactStartedTyping(openmittsu::protocol::ContactId const& identity);
 			void contactStoppedTyping(openmittsu::protocol::ContactId const& identity);
 			void optionsChanged();
+			void dataBackupExportProgressUpdated(int percentComplete);
+			void dataBackupExportFinished(bool hadError, QString const& errorMessage);
 		};
 	}
 }
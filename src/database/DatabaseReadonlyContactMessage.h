@@ -4,6 +4,7 @@
 #include <QList>
 #include <QString>
 
+#include "src/database/MediaItemHandle.h"
 #include "src/dataproviders/messages/ReadonlyContactMessage.h"
 #include "src/dataproviders/messages/ContactMessageType.h"
 
@@ -15,7 +16,7 @@ namespace openmittsu {
 	namespace database {
 		class DatabaseReadonlyContactMessage : public virtual openmittsu::dataproviders::messages::ReadonlyContactMessage {
 		public:
-			DatabaseReadonlyContactMessage(openmittsu::protocol::ContactId const& sender, openmittsu::protocol::MessageId const& messageId, bool isMessageFromUs, openmittsu::protocol::MessageTime const& createdAt, openmittsu::protocol::MessageTime const& sentAt, openmittsu::protocol::MessageTime const& modifiedAt, bool isQueued, bool isSent, QString const& uuid, bool isRead, bool isSaved, openmittsu::dataproviders::messages::UserMessageState const& messageState, openmittsu::protocol::MessageTime const& receivedAt, openmittsu::protocol::MessageTime const& seenAt, bool isStatusMessage, QString const& caption, openmittsu::dataproviders::messages::ContactMessageType const& contactMessageType, QString const& body, MediaFileItem const& mediaItem);
+			DatabaseReadonlyContactMessage(openmittsu::protocol::ContactId const& sender, openmittsu::protocol::MessageId const& messageId, bool isMessageFromUs, openmittsu::protocol::MessageTime const& createdAt, openmittsu::protocol::MessageTime const& sentAt, openmittsu::protocol::MessageTime const& modifiedAt, bool isQueued, bool isSent, QString const& uuid, bool isRead, bool isSaved, openmittsu::dataproviders::messages::UserMessageState const& messageState, openmittsu::protocol::MessageTime const& receivedAt, openmittsu::protocol::MessageTime const& seenAt, bool isStatusMessage, QString const& caption, openmittsu::dataproviders::messages::ContactMessageType const& contactMessageType, QString const& body, MediaItemHandle const& mediaItem);
 			virtual ~DatabaseReadonlyContactMessage();
 
 			virtual openmittsu::protocol::ContactId const& getSender() const override;
@@ -54,6 +55,7 @@ namespace openmittsu {
 			virtual QString const& getContentAsText() const override;
 			virtual openmittsu::utility::Location getContentAsLocation() const override;
 			virtual MediaFileItem getContentAsMediaFile() const override;
+			virtual std::unique_ptr<QIODevice> getContentAsMediaDevice() const override;
 		private:
 			openmittsu::protocol::ContactId m_sender;
 			openmittsu::protocol::MessageId m_messageId;
@@ -73,7 +75,8 @@ namespace openmittsu {
 			QString m_caption;
 			openmittsu::dataproviders::messages::ContactMessageType m_contactMessageType;
 			QString m_body;
-			MediaFileItem m_mediaItem;
+			/** Media content is read and decrypted on first access. */
+			MediaItemHandle m_mediaItem;
 		};
 
 	}
@@ -45,6 +45,8 @@ namespace openmittsu {
 				OPENMITTSU_CONNECT_QUEUED(ptr.get(), contactStartedTyping(openmittsu::protocol::ContactId const&), this, onDatabaseContactStartedTyping(openmittsu::protocol::ContactId const&));
 				OPENMITTSU_CONNECT_QUEUED(ptr.get(), contactStoppedTyping(openmittsu::protocol::ContactId const&), this, onDatabaseContactStoppedTyping(openmittsu::protocol::ContactId const&));
 				OPENMITTSU_CONNECT_QUEUED(ptr.get(), optionsChanged(), this, onDatabaseOptionsChanged());
+				OPENMITTSU_CONNECT_QUEUED(ptr.get(), dataBackupExportProgressUpdated(int), this, onDatabaseDataBackupExportProgressUpdated(int));
+				OPENMITTSU_CONNECT_QUEUED(ptr.get(), dataBackupExportFinished(bool, QString const&), this, onDatabaseDataBackupExportFinished(bool, QString const&));
 
 				emit gotDatabase();
 			} else {
@@ -105,6 +107,14 @@ namespace openmittsu {
 			emit optionsChanged();
 		}
 
+		void DatabaseWrapper::onDatabaseDataBackupExportProgressUpdated(int percentComplete) {
+			emit dataBackupExportProgressUpdated(percentComplete);
+		}
+
+		void DatabaseWrapper::onDatabaseDataBackupExportFinished(bool hadError, QString const& errorMessage) {
+			emit dataBackupExportFinished(hadError, errorMessage);
+		}
+
 		void DatabaseWrapper::enableTimers() {
 			OPENMITTSU_DATABASEWRAPPER_WRAP_VOID_NOARGS(enableTimers);
 		}
@@ -345,6 +355,10 @@ namespace openmittsu {
 			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN(getContactDataAll, ContactToContactDataMap, Q_ARG(bool, fetchMessageCount));
 		}
 
+		ContactToContactDataMap DatabaseWrapper::getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN(getContactDataSnapshot, ContactToContactDataMap, Q_ARG(QSet<openmittsu::protocol::ContactId> const&, contacts), Q_ARG(bool, fetchMessageCount));
+		}
+
 		openmittsu::crypto::PublicKey DatabaseWrapper::getContactPublicKey(openmittsu::protocol::ContactId const& identity) const {
 			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN(getContactPublicKey, openmittsu::crypto::PublicKey, Q_ARG(openmittsu::protocol::ContactId const&, identity));
 		}
@@ -397,6 +411,10 @@ namespace openmittsu {
 			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN(getGroupDataAll, GroupToGroupDataMap, Q_ARG(bool, withDescription));
 		}
 
+		GroupToGroupDataMap DatabaseWrapper::getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN(getGroupDataSnapshot, GroupToGroupDataMap, Q_ARG(QSet<openmittsu::protocol::GroupId> const&, groups), Q_ARG(bool, withDescription));
+		}
+
 		int DatabaseWrapper::getGroupCount() const {
 			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(getGroupCount, int);
 		}
@@ -469,5 +487,49 @@ namespace openmittsu {
 			OPENMITTSU_DATABASEWRAPPER_WRAP_VOID(setOptions, Q_ARG(openmittsu::database::OptionNameToValueMap const&, options));
 		}
 
+		bool DatabaseWrapper::isIncrementalVacuumEnabled() const {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(isIncrementalVacuumEnabled, bool);
+		}
+
+		bool DatabaseWrapper::enableIncrementalVacuum() {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(enableIncrementalVacuum, bool);
+		}
+
+		bool DatabaseWrapper::runMaintenance() {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(runMaintenance, bool);
+		}
+
+		openmittsu::database::MaintenanceStatistics DatabaseWrapper::getMaintenanceStatistics() {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(getMaintenanceStatistics, openmittsu::database::MaintenanceStatistics);
+		}
+
+		openmittsu::database::MediaCacheStatistics DatabaseWrapper::getMediaCacheStatistics() const {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(getMediaCacheStatistics, openmittsu::database::MediaCacheStatistics);
+		}
+
+		void DatabaseWrapper::startMediaIntegrityScan(bool repair) {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_VOID(startMediaIntegrityScan, Q_ARG(bool, repair));
+		}
+
+		void DatabaseWrapper::cancelMediaIntegrityScan() {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_VOID_NOARGS(cancelMediaIntegrityScan);
+		}
+
+		bool DatabaseWrapper::isMediaIntegrityScanRunning() const {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(isMediaIntegrityScanRunning, bool);
+		}
+
+		openmittsu::database::MediaIntegrityReport DatabaseWrapper::getMediaIntegrityScanReport() const {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(getMediaIntegrityScanReport, openmittsu::database::MediaIntegrityReport);
+		}
+
+		openmittsu::database::DamagedMediaItemList DatabaseWrapper::getDamagedMediaItems() const {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_RETURN_NOARGS(getDamagedMediaItems, openmittsu::database::DamagedMediaItemList);
+		}
+
+		void DatabaseWrapper::exportDataBackup(QString const& backupPath, QString const& backupPassword) {
+			OPENMITTSU_DATABASEWRAPPER_WRAP_VOID(exportDataBackup, Q_ARG(QString const&, backupPath), Q_ARG(QString const&, backupPassword));
+		}
+
 	}
 }
@@ -34,6 +34,8 @@ namespace openmittsu {
 			void onDatabaseContactStartedTyping(openmittsu::protocol::ContactId const& identity);
 			void onDatabaseContactStoppedTyping(openmittsu::protocol::ContactId const& identity);
 			void onDatabaseOptionsChanged();
+			void onDatabaseDataBackupExportProgressUpdated(int percentComplete);
+			void onDatabaseDataBackupExportFinished(bool hadError, QString const& errorMessage);
 		protected:
 			DatabasePointerAuthority const* m_databasePointerAuthority;
 			std::weak_ptr<Database> m_database;
@@ -108,6 +110,7 @@ namespace openmittsu {
 			// Contact Data
 			virtual ContactData getContactData(openmittsu::protocol::ContactId const& contact, bool fetchMessageCount) const override;
 			virtual ContactToContactDataMap getContactDataAll(bool fetchMessageCount) const override;
+			virtual ContactToContactDataMap getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const override;
 			virtual openmittsu::crypto::PublicKey getContactPublicKey(openmittsu::protocol::ContactId const& identity) const override;
 			virtual int getContactCount() const override;
 			virtual QVector<QString> getLastMessageUuids(openmittsu::protocol::ContactId const& contact, std::size_t n) override;
@@ -122,6 +125,7 @@ namespace openmittsu {
 			// Group Data
 			virtual GroupData getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const override;
 			virtual GroupToGroupDataMap getGroupDataAll(bool withDescription) const override;
+			virtual GroupToGroupDataMap getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const override;
 			virtual int getGroupCount() const override;
 			virtual QSet<openmittsu::protocol::ContactId> getGroupMembers(openmittsu::protocol::GroupId const& group, bool excludeSelfContact) const override;
 			virtual QVector<QString> getLastMessageUuids(openmittsu::protocol::GroupId const& group, std::size_t n) override;
@@ -143,6 +147,20 @@ namespace openmittsu {
 			// Options
 			virtual openmittsu::database::OptionNameToValueMap getOptions() override;
 			virtual void setOptions(openmittsu::database::OptionNameToValueMap const& options) override;
+			// Maintenance
+			virtual bool isIncrementalVacuumEnabled() const override;
+			virtual bool enableIncrementalVacuum() override;
+			virtual bool runMaintenance() override;
+			virtual openmittsu::database::MaintenanceStatistics getMaintenanceStatistics() override;
+			virtual openmittsu::database::MediaCacheStatistics getMediaCacheStatistics() const override;
+
+			virtual void startMediaIntegrityScan(bool repair) override;
+			virtual void cancelMediaIntegrityScan() override;
+			virtual bool isMediaIntegrityScanRunning() const override;
+			virtual openmittsu::database::MediaIntegrityReport getMediaIntegrityScanReport() const override;
+			virtual openmittsu::database::DamagedMediaItemList getDamagedMediaItems() const override;
+
+			virtual void exportDataBackup(QString const& backupPath, QString const& backupPassword) override;
 		};
 
 	}
@@ -1,7 +1,7 @@
 #ifndef OPENMITTSU_DATABASE_GROUPDATA_H_
 #define OPENMITTSU_DATABASE_GROUPDATA_H_
 
-#include "src/database/MediaFileItem.h"
+#include "src/database/MediaItemHandle.h"
 #include "src/protocol/ContactId.h"
 
 #include <QMetaType>
@@ -15,7 +15,8 @@ namespace openmittsu {
 			QString description;
 			QSet<openmittsu::protocol::ContactId> members;
 			bool hasImage;
-			openmittsu::database::MediaFileItem image;
+			/** Read only once accessed, off the database thread. */
+			openmittsu::database::MediaItemHandle image;
 			bool isAwaitingSync;
 			int messageCount;
 		};
@@ -0,0 +1,25 @@
+#ifndef OPENMITTSU_DATABASE_MAINTENANCESTATISTICS_H_
+#define OPENMITTSU_DATABASE_MAINTENANCESTATISTICS_H_
+
+#include <QMetaType>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace database {
+		/** Totals over all maintenance runs of a database. */
+		struct MaintenanceStatistics {
+			qint64 lastCompletedAt;
+			qint64 runsCompleted;
+			qint64 messagesArchived;
+			qint64 mediaRowsRemoved;
+			qint64 mediaFilesMigrated;
+			qint64 mediaFilesRemoved;
+			qint64 mediaItemsEvicted;
+			qint64 pagesFreed;
+		};
+	}
+}
+
+Q_DECLARE_METATYPE(openmittsu::database::MaintenanceStatistics)
+
+#endif // OPENMITTSU_DATABASE_MAINTENANCESTATISTICS_H_
@@ -0,0 +1,22 @@
+#ifndef OPENMITTSU_DATABASE_MEDIACACHESTATISTICS_H_
+#define OPENMITTSU_DATABASE_MEDIACACHESTATISTICS_H_
+
+#include <QMetaType>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace database {
+		/** Counters of the in-memory media cache since the database was opened, and the bytes it currently holds. */
+		struct MediaCacheStatistics {
+			quint64 hits;
+			quint64 misses;
+			quint64 evictions;
+			qint64 thumbnailBytes;
+			qint64 standardBytes;
+		};
+	}
+}
+
+Q_DECLARE_METATYPE(openmittsu::database::MediaCacheStatistics)
+
+#endif // OPENMITTSU_DATABASE_MEDIACACHESTATISTICS_H_
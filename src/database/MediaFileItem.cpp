@@ -31,6 +31,10 @@ namespace openmittsu {
 			return m_status == ItemStatus::AVAILABLE;
 		}
 
+		MediaFileItem::ItemStatus MediaFileItem::getStatus() const {
+			return m_status;
+		}
+
 		MediaFileType MediaFileItem::getFileType() const {
 			return m_type;
 		}
@@ -63,6 +67,9 @@ namespace openmittsu {
 					case ItemStatus::UNAVAILABLE_CRYPTO_ERROR:
 						painter.drawText(result.rect(), Qt::AlignCenter, "Error: Cryptographic error while fetching referenced media item.");
 						break;
+					case ItemStatus::UNAVAILABLE_EVICTED:
+						painter.drawText(result.rect(), Qt::AlignCenter, "Media item was removed to stay within the storage quota.");
+						break;
 					default:
 						painter.drawText(result.rect(), Qt::AlignCenter, "An unexpected error occurred.");
 						break;
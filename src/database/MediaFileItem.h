@@ -17,7 +17,8 @@ namespace openmittsu {
 				UNAVAILABLE_EXTERNAL_FILE_DELETED,
 				UNAVAILABLE_FILE_CORRUPTED,
 				UNAVAILABLE_DECRYPTION_FAILED,
-				UNAVAILABLE_CRYPTO_ERROR
+				UNAVAILABLE_CRYPTO_ERROR,
+				UNAVAILABLE_EVICTED
 			};
 
 			MediaFileItem() = default;
@@ -29,6 +30,7 @@ namespace openmittsu {
 			MediaFileType getFileType() const;
 			QByteArray const& getData() const;
 			bool isAvailable() const;
+			ItemStatus getStatus() const;
 			QPixmap getPixmapWithErrorMessage(int width, int height) const;
 		private:
 			QByteArray m_data;
@@ -0,0 +1,23 @@
+#ifndef OPENMITTSU_DATABASE_MEDIAINTEGRITYREPORT_H_
+#define OPENMITTSU_DATABASE_MEDIAINTEGRITYREPORT_H_
+
+#include <QMetaType>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace database {
+		struct MediaIntegrityReport {
+			qint64 checkedItems;
+			qint64 missingItems;
+			qint64 corruptedItems;
+			qint64 orphanedFiles;
+			qint64 markedItems;
+			qint64 removedFiles;
+			bool isComplete;
+		};
+	}
+}
+
+Q_DECLARE_METATYPE(openmittsu::database::MediaIntegrityReport)
+
+#endif // OPENMITTSU_DATABASE_MEDIAINTEGRITYREPORT_H_
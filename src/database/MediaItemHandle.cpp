@@ -0,0 +1,83 @@
+#include "src/database/MediaItemHandle.h"
+
+#include <QBuffer>
+#include <QMutexLocker>
+
+#include "src/utility/MakeUnique.h"
+
+namespace openmittsu {
+	namespace database {
+
+		MediaItemHandle::MediaItemHandle() : MediaItemHandle(MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, MediaFileType::TYPE_STANDARD)) {
+			//
+		}
+
+		MediaItemHandle::MediaItemHandle(MediaFileItem const& item) : m_state(std::make_shared<State>()) {
+			m_state->result = makeReadyFuture(item);
+		}
+
+		MediaItemHandle::MediaItemHandle(Loader const& loader) : m_state(std::make_shared<State>()) {
+			m_state->loader = loader;
+		}
+
+		MediaItemHandle::MediaItemHandle(Loader const& loader, DeviceOpener const& deviceOpener) : m_state(std::make_shared<State>()) {
+			m_state->loader = loader;
+			m_state->deviceOpener = deviceOpener;
+		}
+
+		MediaItemHandle::~MediaItemHandle() {
+			//
+		}
+
+		std::shared_future<MediaFileItem> MediaItemHandle::load() const {
+			QMutexLocker lock(&m_state->mutex);
+			if (!m_state->result.valid()) {
+				m_state->result = m_state->loader();
+				// The loader holds references to the media storage, which are not needed anymore.
+				m_state->loader = nullptr;
+			}
+			return m_state->result;
+		}
+
+		MediaFileItem MediaItemHandle::get() const {
+			return load().get();
+		}
+
+		bool MediaItemHandle::isLoadStarted() const {
+			QMutexLocker lock(&m_state->mutex);
+			return m_state->result.valid();
+		}
+
+		std::unique_ptr<QIODevice> MediaItemHandle::openDevice() const {
+			DeviceOpener deviceOpener;
+			{
+				QMutexLocker lock(&m_state->mutex);
+				deviceOpener = m_state->deviceOpener;
+			}
+
+			if (deviceOpener) {
+				std::unique_ptr<QIODevice> device = deviceOpener();
+				if (device != nullptr) {
+					return device;
+				}
+			}
+
+			MediaFileItem const item = get();
+			if (!item.isAvailable()) {
+				return nullptr;
+			}
+
+			std::unique_ptr<QBuffer> buffer = std::make_unique<QBuffer>();
+			buffer->setData(item.getData());
+			buffer->open(QIODevice::ReadOnly);
+			return std::move(buffer);
+		}
+
+		std::shared_future<MediaFileItem> MediaItemHandle::makeReadyFuture(MediaFileItem const& item) {
+			std::promise<MediaFileItem> promise;
+			promise.set_value(item);
+			return promise.get_future().share();
+		}
+
+	}
+}
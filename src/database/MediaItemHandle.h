@@ -0,0 +1,62 @@
+#ifndef OPENMITTSU_DATABASE_MEDIAITEMHANDLE_H_
+#define OPENMITTSU_DATABASE_MEDIAITEMHANDLE_H_
+
+#include <QIODevice>
+#include <QMutex>
+
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "src/database/MediaFileItem.h"
+
+namespace openmittsu {
+	namespace database {
+
+		/**
+		 * Refers to the content of a media item without reading it.
+		 * The loader runs on the first call of load() or get(), later calls and all copies of the handle share its result.
+		 * Loaders must not use the database connection, so a handle may be resolved on any thread.
+		 * The same holds for the optional device opener, which streams the item instead of loading all of it.
+		 */
+		class MediaItemHandle {
+		public:
+			typedef std::function<std::shared_future<MediaFileItem>()> Loader;
+			typedef std::function<std::unique_ptr<QIODevice>()> DeviceOpener;
+
+			/** A handle to an item that does not exist. */
+			MediaItemHandle();
+			explicit MediaItemHandle(MediaFileItem const& item);
+			explicit MediaItemHandle(Loader const& loader);
+			MediaItemHandle(Loader const& loader, DeviceOpener const& deviceOpener);
+			virtual ~MediaItemHandle();
+
+			/** Starts loading the item if that has not happened yet, and returns a future for the result. */
+			std::shared_future<MediaFileItem> load() const;
+
+			/** Loads the item if required and waits for it. */
+			MediaFileItem get() const;
+			bool isLoadStarted() const;
+
+			/**
+			 * Opens the item as a seekable, read-only device that decrypts on demand.
+			 * Items that can not be streamed are loaded and served from memory. Returns nullptr if the item is not available.
+			 */
+			std::unique_ptr<QIODevice> openDevice() const;
+		private:
+			struct State {
+				QMutex mutex;
+				Loader loader;
+				DeviceOpener deviceOpener;
+				std::shared_future<MediaFileItem> result;
+			};
+
+			std::shared_ptr<State> m_state;
+
+			static std::shared_future<MediaFileItem> makeReadyFuture(MediaFileItem const& item);
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_MEDIAITEMHANDLE_H_
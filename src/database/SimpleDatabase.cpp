@@ -10,10 +10,20 @@
 
 #include <QUuid>
 #include <QSet>
+#include <QElapsedTimer>
 
+#include <exception>
 #include <iostream>
+#include <limits>
 #include "src/crypto/Crc32.h"
+#include "src/backup/BackupExporter.h"
+#include "src/backup/ContactBackupObject.h"
+#include "src/backup/GroupBackupObject.h"
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/database/internal/DatabaseBackupExport.h"
 #include "src/database/internal/DatabaseContactMessageCursor.h"
+#include "src/exceptions/BaseException.h"
 #include "src/exceptions/InternalErrorException.h"
 #include "src/exceptions/InvalidPasswordOrDatabaseException.h"
 #include "src/exceptions/MissingQSqlCipherException.h"
@@ -28,7 +38,7 @@ namespace openmittsu {
 
 		using namespace openmittsu::dataproviders::messages;
 
-		SimpleDatabase::SimpleDatabase(QString const& filename, QString const& password, QDir const& mediaStorageLocation) : Database(), database(), m_driverNameCrypto("QSQLCIPHER"), m_driverNameStandard("QSQLITE"), m_connectionName("openMittsuDatabaseConnection"), m_password(password), m_selfContact(0), m_selfLongTermKeyPair(), m_identityBackup(), m_contactAndGroupDataProvider(this, this), m_mediaFileStorage(mediaStorageLocation, this) {
+		SimpleDatabase::SimpleDatabase(QString const& filename, QString const& password, QDir const& mediaStorageLocation) : Database(), database(), m_driverNameCrypto("QSQLCIPHER"), m_driverNameStandard("QSQLITE"), m_connectionName("openMittsuDatabaseConnection"), m_password(password), m_selfContact(0), m_selfLongTermKeyPair(), m_identityBackup(), m_contactAndGroupDataProvider(this, this), m_mediaFileStorage(mediaStorageLocation, this), m_messageIdAllocator(), m_archive(this, internal::DatabaseArchive::getArchiveFileName(filename)), m_mediaQuota(&m_mediaFileStorage), m_maintenance(this, &m_mediaFileStorage, &m_archive, &m_mediaQuota), m_mediaIntegrityScanner(), m_isMediaQuotaCheckPending(false), m_mediaQuotaPass(internal::MediaQuota::startPass()), m_isMediaQuotaPassInProgress(false) {
 			if (!(QSqlDatabase::isDriverAvailable(m_driverNameCrypto) || QSqlDatabase::isDriverAvailable(m_driverNameStandard))) {
 				throw openmittsu::exceptions::InternalErrorException() << "Neither the SQL driver " << m_driverNameCrypto.toStdString() << " nor the driver " << m_driverNameStandard.toStdString() << " are available. Available are: " << QSqlDatabase::drivers().join(", ").toStdString();
 			}
@@ -69,6 +79,10 @@ namespace openmittsu {
 			}
 
 			createOrUpdateTables();
+			m_archive.attachIfPresent();
+			applyMediaCacheOptions();
+			applyMediaQuotaOptions();
+			applyArchiveOptions();
 
 			updateCachedIdentityBackup();
 			m_selfContact = m_identityBackup->getClientContactId();
@@ -78,10 +92,12 @@ namespace openmittsu {
 				storeNewContact(m_selfContact, m_selfLongTermKeyPair);
 			}
 
+			reserveMessageIdEpoch();
 			setupQueueTimer();
+			setupMaintenanceTimer();
 		}
 
-		SimpleDatabase::SimpleDatabase(QString const& filename, openmittsu::protocol::ContactId const& selfContact, openmittsu::crypto::KeyPair const& selfLongTermKeyPair, QString const& password, QDir const& mediaStorageLocation) : Database(), database(), m_driverNameCrypto("QSQLCIPHER"), m_driverNameStandard("QSQLITE"), m_connectionName("openMittsuDatabaseConnection"), m_password(password), m_selfContact(selfContact), m_selfLongTermKeyPair(selfLongTermKeyPair), m_identityBackup(std::make_unique<openmittsu::backup::IdentityBackup>(selfContact, selfLongTermKeyPair)), m_contactAndGroupDataProvider(this, this), m_mediaFileStorage(mediaStorageLocation, this) {
+		SimpleDatabase::SimpleDatabase(QString const& filename, openmittsu::protocol::ContactId const& selfContact, openmittsu::crypto::KeyPair const& selfLongTermKeyPair, QString const& password, QDir const& mediaStorageLocation) : Database(), database(), m_driverNameCrypto("QSQLCIPHER"), m_driverNameStandard("QSQLITE"), m_connectionName("openMittsuDatabaseConnection"), m_password(password), m_selfContact(selfContact), m_selfLongTermKeyPair(selfLongTermKeyPair), m_identityBackup(std::make_unique<openmittsu::backup::IdentityBackup>(selfContact, selfLongTermKeyPair)), m_contactAndGroupDataProvider(this, this), m_mediaFileStorage(mediaStorageLocation, this), m_messageIdAllocator(), m_archive(this, internal::DatabaseArchive::getArchiveFileName(filename)), m_mediaQuota(&m_mediaFileStorage), m_maintenance(this, &m_mediaFileStorage, &m_archive, &m_mediaQuota), m_mediaIntegrityScanner(), m_isMediaQuotaCheckPending(false), m_mediaQuotaPass(internal::MediaQuota::startPass()), m_isMediaQuotaPassInProgress(false) {
 			if (!(QSqlDatabase::isDriverAvailable(m_driverNameCrypto) || QSqlDatabase::isDriverAvailable(m_driverNameStandard))) {
 				throw openmittsu::exceptions::InternalErrorException() << "Neither the SQL driver " << m_driverNameCrypto.toStdString() << " nor the driver " << m_driverNameStandard.toStdString() << " are available. Available are: " << QSqlDatabase::drivers().join(", ").toStdString();
 			}
@@ -117,6 +133,10 @@ namespace openmittsu {
 			}
 
 			createOrUpdateTables();
+			m_archive.attachIfPresent();
+			applyMediaCacheOptions();
+			applyMediaQuotaOptions();
+			applyArchiveOptions();
 
 			setBackup(selfContact, selfLongTermKeyPair);
 			if (!hasContact(selfContact)) {
@@ -129,10 +149,21 @@ namespace openmittsu {
 					// TODO
 				}
 			}
+			reserveMessageIdEpoch();
 			setupQueueTimer();
+			setupMaintenanceTimer();
 		}
 
 		SimpleDatabase::~SimpleDatabase() {
+			// Media items still written on the pool are stored while the database is open, they would be lost otherwise.
+			try {
+				waitForMediaWrites();
+			} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+				LOGGER()->warn("Could not store pending media items before closing the database: {}", iee.what());
+			} catch (std::exception& e) {
+				LOGGER()->warn("Could not store pending media items before closing the database: {}", e.what());
+			}
+
 			if (database.isOpen()) {
 				database.close();
 				database.removeDatabase(m_connectionName);
@@ -140,8 +171,12 @@ namespace openmittsu {
 		}
 
 		void SimpleDatabase::setKey(QString const& password) {
-			if (m_usingCryptoDb) {
-				QSqlQuery query(database);
+			setKey(database, m_usingCryptoDb, password);
+		}
+
+		void SimpleDatabase::setKey(QSqlDatabase& keyedDatabase, bool usingCryptoDb, QString const& password) {
+			if (usingCryptoDb) {
+				QSqlQuery query(keyedDatabase);
 				bool needsEncoding = false;
 				for (int i = 0; i < password.size(); ++i) {
 					ushort const unicodeCodepoint = password.at(i).unicode();
@@ -163,8 +198,69 @@ namespace openmittsu {
 			}
 		}
 
+		SimpleDatabase::BackupImportTarget SimpleDatabase::probeBackupImportTarget(QString const& filename, QString const& password) {
+			QString const connectionName(QStringLiteral("openMittsuDatabaseProbeConnection"));
+			QString const driverNameCrypto(QStringLiteral("QSQLCIPHER"));
+			bool const usingCryptoDb = QSqlDatabase::isDriverAvailable(driverNameCrypto);
+			if (!usingCryptoDb) {
+#ifdef OPENMITTSU_CONFIG_ALLOW_MISSING_QSQLCIPHER
+				if (!QSqlDatabase::isDriverAvailable(QStringLiteral("QSQLITE"))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Neither the SQL driver QSQLCIPHER nor the driver QSQLITE are available.";
+				}
+#else
+				throw openmittsu::exceptions::MissingQSqlCipherException() << "QSqlCipher is not available, no encryption available!";
+#endif
+			}
+
+			BackupImportTarget result = { openmittsu::protocol::ContactId(0), false, QString() };
+			{
+				QSqlDatabase probe = QSqlDatabase::addDatabase(usingCryptoDb ? driverNameCrypto : QStringLiteral("QSQLITE"), connectionName);
+				probe.setDatabaseName(filename);
+				probe.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+				try {
+					if (!QFile::exists(filename) || !probe.open()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not open database file for reading.";
+					}
+					setKey(probe, usingCryptoDb, password);
+
+					QSqlQuery query(probe);
+					if (!query.exec(QStringLiteral("SELECT `type`, `name`, `sql`, `tbl_name` FROM `sqlite_master`"))) {
+						throw openmittsu::exceptions::InvalidPasswordOrDatabaseException() << "SQLITE master table not readable, invalid database or incorrect password.";
+					}
+
+					query.prepare(QStringLiteral("SELECT `value` FROM `settings` WHERE `is_internal` = 1 AND `name` = :name"));
+					query.bindValue(QStringLiteral(":name"), QStringLiteral("identity"));
+					if (!query.exec() || !query.isSelect() || !query.next()) {
+						throw openmittsu::exceptions::InvalidPasswordOrDatabaseException() << "The database holds no identity.";
+					}
+					result.selfContact = openmittsu::backup::IdentityBackup::fromBackupString(query.value(QStringLiteral("value")).toString(), password).getClientContactId();
+
+					if (probe.tables().contains(QStringLiteral("backup_import_journal"))) {
+						if (!query.exec(QStringLiteral("SELECT DISTINCT `fingerprint` FROM `backup_import_journal`;"))) {
+							throw openmittsu::exceptions::InternalErrorException() << "Could not query the backup import journal. Query error: " << query.lastError().text().toStdString();
+						}
+						while (query.next()) {
+							// Rows of different backups match none of them.
+							result.pendingImportFingerprint = (result.hasPendingImport) ? QString() : query.value(QStringLiteral("fingerprint")).toString();
+							result.hasPendingImport = true;
+						}
+					}
+				} catch (...) {
+					probe.close();
+					probe = QSqlDatabase();
+					QSqlDatabase::removeDatabase(connectionName);
+					throw;
+				}
+				probe.close();
+			}
+			QSqlDatabase::removeDatabase(connectionName);
+
+			return result;
+		}
+
 		void SimpleDatabase::enableTimers() {
 			queueTimeoutTimer.start();
+			maintenanceTimer.start();
 
 			QTimer::singleShot(500, this, SLOT(onQueueTimeoutTimerFire()));
 		}
@@ -187,11 +283,282 @@ namespace openmittsu {
 			}
 		}
 
+		void SimpleDatabase::applyMediaCacheOptions() {
+			// The budgets are user options in MiB, registered by the OptionReader. Until it has written them, the defaults of the cache apply.
+			QList<std::pair<QString, MediaFileType>> const budgetOptions({ std::make_pair(QStringLiteral("options/mediaCache/thumbnailBudgetMiB"), MediaFileType::TYPE_THUMBNAIL), std::make_pair(QStringLiteral("options/mediaCache/mediaBudgetMiB"), MediaFileType::TYPE_STANDARD) });
+			auto it = budgetOptions.constBegin();
+			auto const end = budgetOptions.constEnd();
+			for (; it != end; ++it) {
+				qint64 budget = internal::MediaItemCache::getDefaultBudget(it->second);
+				if (hasOptionInternal(it->first, false)) {
+					bool ok = false;
+					int const budgetInMiB = getOptionValueInternal(it->first, false).toInt(&ok);
+					if (ok && (budgetInMiB >= 0)) {
+						budget = static_cast<qint64>(budgetInMiB) * 1024 * 1024;
+					} else {
+						LOGGER()->warn("Ignoring invalid media cache budget \"{}\" in option {}.", getOptionValueInternal(it->first, false).toStdString(), it->first.toStdString());
+					}
+				}
+				m_mediaFileStorage.getCache().setBudget(it->second, budget);
+			}
+		}
+
+		void SimpleDatabase::applyMediaQuotaOptions() {
+			internal::MediaQuota::Settings settings = internal::MediaQuota::getDefaultSettings();
+			QString const budgetOptionName = QStringLiteral("options/mediaQuota/mediaBudgetMiB");
+			if (hasOptionInternal(budgetOptionName, false)) {
+				settings.budgetInBytes = static_cast<qint64>(getOptionValueInternal(budgetOptionName, false).toInt()) * 1024 * 1024;
+			}
+			QString const ageOptionName = QStringLiteral("options/mediaQuota/maxAgeDays");
+			if (hasOptionInternal(ageOptionName, false)) {
+				settings.maxAgeInDays = getOptionValueInternal(ageOptionName, false).toInt();
+			}
+			QString const orderOptionName = QStringLiteral("options/mediaQuota/evictLargestFirst");
+			if (hasOptionInternal(orderOptionName, false) && getOptionValueAsBool(orderOptionName)) {
+				settings.evictionOrder = internal::MediaFileStorage::EvictionOrder::LARGEST_FIRST;
+			}
+			setMediaQuotaSettings(settings);
+		}
+
+		void SimpleDatabase::applyArchiveOptions() {
+			int days = internal::DatabaseArchive::getDefaultArchiveAgeInDays();
+			QString const ageOptionName = QStringLiteral("options/messageArchive/ageDays");
+			if (hasOptionInternal(ageOptionName, false)) {
+				bool ok = false;
+				int const optionDays = getOptionValueInternal(ageOptionName, false).toInt(&ok);
+				if (ok) {
+					days = optionDays;
+				} else {
+					LOGGER()->warn("Ignoring invalid message archive age \"{}\" in option {}.", getOptionValueInternal(ageOptionName, false).toStdString(), ageOptionName.toStdString());
+				}
+			}
+			m_archive.setArchiveAgeInDays(days);
+		}
+
+		int SimpleDatabase::enforceMediaQuota() {
+			mediaQuotaTimer.stop();
+			m_isMediaQuotaPassInProgress = false;
+
+			bool isPassCompleted = false;
+			return runMediaQuotaSlice(std::numeric_limits<qint64>::max(), isPassCompleted);
+		}
+
+		int SimpleDatabase::runMediaQuotaSlice(qint64 timeBudgetInMs, bool& isPassCompleted) {
+			isPassCompleted = false;
+			if (!m_isMediaQuotaPassInProgress) {
+				// Items stored since the last pass may sort before its cursors, so every pass starts over. Items stored during this pass request another one.
+				m_mediaQuotaPass = internal::MediaQuota::startPass();
+				m_isMediaQuotaPassInProgress = true;
+				m_isMediaQuotaCheckPending = false;
+			}
+
+			if (!m_mediaQuota.isEnabled()) {
+				m_isMediaQuotaPassInProgress = false;
+				isPassCompleted = true;
+				return 0;
+			}
+
+			int const itemsPerBatch = 16;
+			int evictedItems = 0;
+			qint64 freedBytes = 0;
+			QElapsedTimer timer;
+			timer.start();
+			try {
+				do {
+					int const evictedInBatch = m_mediaQuota.enforce(m_mediaQuotaPass, itemsPerBatch, freedBytes);
+					evictedItems += evictedInBatch;
+					if (evictedInBatch < itemsPerBatch) {
+						isPassCompleted = true;
+						m_isMediaQuotaPassInProgress = false;
+					}
+				} while ((!isPassCompleted) && (timer.elapsed() < timeBudgetInMs));
+			} catch (...) {
+				m_isMediaQuotaPassInProgress = false;
+				throw;
+			}
+
+			if (evictedItems > 0) {
+				LOGGER()->info("Evicted {} media items ({} bytes freed on disk) to stay within the media quota.", evictedItems, freedBytes);
+			}
+			return evictedItems;
+		}
+
+		internal::MediaQuota::Settings SimpleDatabase::getMediaQuotaSettings() const {
+			return m_mediaQuota.getSettings();
+		}
+
+		void SimpleDatabase::setMediaQuotaSettings(internal::MediaQuota::Settings const& settings) {
+			m_mediaQuota.setSettings(settings);
+			m_isMediaQuotaCheckPending = m_mediaQuota.isEnabled();
+			m_isMediaQuotaPassInProgress = false;
+		}
+
+		internal::MediaFileStorage::MediaUsage SimpleDatabase::getMediaUsage() const {
+			return m_mediaFileStorage.getMediaUsage();
+		}
+
+		internal::ExternalMediaFileStorage::ConversationMediaUsage SimpleDatabase::getConversationMediaUsage() const {
+			return m_mediaFileStorage.getConversationMediaUsage();
+		}
+
+		openmittsu::database::MediaCacheStatistics SimpleDatabase::getMediaCacheStatistics() const {
+			return m_mediaFileStorage.getCache().getStatistics();
+		}
+
+		void SimpleDatabase::setupMaintenanceTimer() {
+			OPENMITTSU_CONNECT_QUEUED(&maintenanceTimer, timeout(), this, onMaintenanceTimerFire());
+			maintenanceTimer.setInterval(15 * 1000);
+
+			// A background integrity scan uses about a fifth of the database thread, its file checks run on idle priority threads.
+			OPENMITTSU_CONNECT_QUEUED(&mediaIntegrityScanTimer, timeout(), this, onMediaIntegrityScanTimerFire());
+			mediaIntegrityScanTimer.setInterval(250);
+
+			// Like the integrity scan, a quota check evicting many items only uses a part of the database thread.
+			OPENMITTSU_CONNECT_QUEUED(&mediaQuotaTimer, timeout(), this, onMediaQuotaTimerFire());
+			mediaQuotaTimer.setInterval(250);
+		}
+
+		void SimpleDatabase::onMaintenanceTimerFire() {
+			// New media is checked against the quota right away, as waiting for the next idle maintenance run would let the storage grow unbounded.
+			if (m_isMediaQuotaCheckPending && (!mediaQuotaTimer.isActive())) {
+				mediaQuotaTimer.start();
+			}
+
+			if (!m_maintenance.isIdle() || !m_maintenance.isDue()) {
+				return;
+			}
+
+			LOGGER_DEBUG("Database maintenance timer fired, running a maintenance slice...");
+			try {
+				m_maintenance.runSlice(200);
+			} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+				LOGGER()->warn("Database maintenance failed: {}", iee.what());
+				// Do not retry right away, wait for the next idle period.
+				m_maintenance.notifyActivity();
+			}
+		}
+
+		bool SimpleDatabase::runMaintenance() {
+			try {
+				m_maintenance.runToCompletion();
+			} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+				LOGGER()->warn("Database maintenance failed: {}", iee.what());
+				return false;
+			}
+			return true;
+		}
+
+		openmittsu::database::MaintenanceStatistics SimpleDatabase::getMaintenanceStatistics() {
+			return m_maintenance.getStatistics();
+		}
+
+		bool SimpleDatabase::isIncrementalVacuumEnabled() const {
+			return m_maintenance.isIncrementalVacuumEnabled();
+		}
+
+		bool SimpleDatabase::enableIncrementalVacuum() {
+			try {
+				m_maintenance.enableIncrementalVacuum();
+			} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+				LOGGER()->warn("Compacting the database failed: {}", iee.what());
+				return false;
+			}
+			return true;
+		}
+
+		internal::MediaIntegrityScanner::Report SimpleDatabase::runMediaIntegrityScan(bool repair, internal::MediaIntegrityScanner::ProgressCallback const& progressCallback) {
+			mediaIntegrityScanTimer.stop();
+			m_mediaIntegrityScanner = std::make_unique<internal::MediaIntegrityScanner>(&m_mediaFileStorage, repair);
+			m_mediaIntegrityScanner->setProgressCallback(progressCallback);
+			return m_mediaIntegrityScanner->runToCompletion();
+		}
+
+		void SimpleDatabase::startMediaIntegrityScan(bool repair) {
+			m_mediaIntegrityScanner = std::make_unique<internal::MediaIntegrityScanner>(&m_mediaFileStorage, repair);
+			mediaIntegrityScanTimer.start();
+		}
+
+		void SimpleDatabase::cancelMediaIntegrityScan() {
+			mediaIntegrityScanTimer.stop();
+			if (m_mediaIntegrityScanner) {
+				m_mediaIntegrityScanner->cancel();
+			}
+		}
+
+		bool SimpleDatabase::isMediaIntegrityScanRunning() const {
+			return mediaIntegrityScanTimer.isActive();
+		}
+
+		openmittsu::database::MediaIntegrityReport SimpleDatabase::getMediaIntegrityScanReport() const {
+			if (!m_mediaIntegrityScanner) {
+				return openmittsu::database::MediaIntegrityReport({ 0, 0, 0, 0, 0, 0, false });
+			}
+			return m_mediaIntegrityScanner->getReport();
+		}
+
+		openmittsu::database::DamagedMediaItemList SimpleDatabase::getDamagedMediaItems() const {
+			return m_mediaFileStorage.getDamagedMediaItems();
+		}
+
+		void SimpleDatabase::exportDataBackup(QString const& backupPath, QString const& backupPassword) {
+			emit dataBackupExportProgressUpdated(0);
+
+			try {
+				openmittsu::backup::BackupExporter exporter(*this, QDir(backupPath), backupPassword);
+				exporter.setProgressCallback([this](int percentComplete) {
+					emit dataBackupExportProgressUpdated(percentComplete);
+				});
+				exporter.run();
+
+				emit dataBackupExportFinished(false, QString());
+			} catch (openmittsu::exceptions::BaseException& be) {
+				LOGGER()->warn("Exporting a data backup to {} failed: {}", backupPath.toStdString(), be.what());
+				emit dataBackupExportFinished(true, tr("An error occured while exporting the data backup.\nProblem: %1").arg(be.what()));
+			} catch (...) {
+				LOGGER()->warn("Exporting a data backup to {} failed with an unknown error.", backupPath.toStdString());
+				emit dataBackupExportFinished(true, tr("An unexpected error occured while exporting the data backup.\nUnknown Problem."));
+			}
+		}
+
+		void SimpleDatabase::onMediaIntegrityScanTimerFire() {
+			if (!m_mediaIntegrityScanner || m_mediaIntegrityScanner->isCancelled()) {
+				mediaIntegrityScanTimer.stop();
+				return;
+			}
+
+			try {
+				if (m_mediaIntegrityScanner->runSlice(50)) {
+					mediaIntegrityScanTimer.stop();
+				}
+			} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+				LOGGER()->warn("Media integrity scan failed: {}", iee.what());
+				mediaIntegrityScanTimer.stop();
+			}
+		}
+
+		void SimpleDatabase::onMediaQuotaTimerFire() {
+			// Items still written on the pool are not counted yet, so the check waits until they are stored.
+			if (m_mediaFileStorage.getPendingWriteCount() > 0) {
+				return;
+			}
+
+			try {
+				bool isPassCompleted = false;
+				runMediaQuotaSlice(50, isPassCompleted);
+				if (isPassCompleted) {
+					mediaQuotaTimer.stop();
+				}
+			} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+				LOGGER()->warn("Enforcing the media quota failed: {}", iee.what());
+				mediaQuotaTimer.stop();
+			}
+		}
+
 		QString SimpleDatabase::getDefaultDatabaseFileName() {
 			return QStringLiteral("openmittsu.sqlite");
 		}
 
-		QString SimpleDatabase::getCreateStatementForTable(Tables const& table) {
+		QStringList SimpleDatabase::getCreateStatementForTable(Tables const& table) {
 			QFile sqlFile;
 			switch (table) {
 				case Tables::ContactMessages:
@@ -215,6 +582,18 @@ namespace openmittsu {
 				case Tables::Media:
 					sqlFile.setFileName(QStringLiteral(":/sql/CreateMedia.sql"));
 					break;
+				case Tables::MediaContent:
+					sqlFile.setFileName(QStringLiteral(":/sql/CreateMediaContent.sql"));
+					break;
+				case Tables::MediaDamage:
+					sqlFile.setFileName(QStringLiteral(":/sql/CreateMediaDamage.sql"));
+					break;
+				case Tables::MediaUsage:
+					sqlFile.setFileName(QStringLiteral(":/sql/CreateMediaUsage.sql"));
+					break;
+				case Tables::BackupImportJournal:
+					sqlFile.setFileName(QStringLiteral(":/sql/CreateBackupImportJournal.sql"));
+					break;
 				case Tables::Settings:
 					sqlFile.setFileName(QStringLiteral(":/sql/CreateSettings.sql"));
 					break;
@@ -233,7 +612,7 @@ namespace openmittsu {
 				QString result = fileStream.readAll();
 				sqlFile.close();
 
-				return result;
+				return result.split(QStringLiteral("__OPENMITTSU_QUERY_SEP__"), QString::SplitBehavior::SkipEmptyParts);
 			}
 		}
 
@@ -261,6 +640,18 @@ namespace openmittsu {
 				case Tables::Media:
 					sqlFile.setFileName(QStringLiteral(":/sql/UpdateMediaToVersion%1.sql").arg(toVersion));
 					break;
+				case Tables::MediaContent:
+					sqlFile.setFileName(QStringLiteral(":/sql/UpdateMediaContentToVersion%1.sql").arg(toVersion));
+					break;
+				case Tables::MediaDamage:
+					sqlFile.setFileName(QStringLiteral(":/sql/UpdateMediaDamageToVersion%1.sql").arg(toVersion));
+					break;
+				case Tables::MediaUsage:
+					sqlFile.setFileName(QStringLiteral(":/sql/UpdateMediaUsageToVersion%1.sql").arg(toVersion));
+					break;
+				case Tables::BackupImportJournal:
+					sqlFile.setFileName(QStringLiteral(":/sql/UpdateBackupImportJournalToVersion%1.sql").arg(toVersion));
+					break;
 				case Tables::Settings:
 					sqlFile.setFileName(QStringLiteral(":/sql/UpdateSettingsToVersion%1.sql").arg(toVersion));
 					break;
@@ -306,6 +697,18 @@ namespace openmittsu {
 				case Tables::Media:
 					return QStringLiteral("media");
 					break;
+				case Tables::MediaContent:
+					return QStringLiteral("media_content");
+					break;
+				case Tables::MediaDamage:
+					return QStringLiteral("media_damage");
+					break;
+				case Tables::MediaUsage:
+					return QStringLiteral("media_usage");
+					break;
+				case Tables::BackupImportJournal:
+					return QStringLiteral("backup_import_journal");
+					break;
 				case Tables::Settings:
 					return QStringLiteral("settings");
 					break;
@@ -384,8 +787,11 @@ namespace openmittsu {
 		int SimpleDatabase::createTableIfMissingAndGetVersion(Tables const& table, int createStatementVersion) {
 			if (!doesTableExist(table)) {
 				QSqlQuery query(database);
-				if (!query.exec(getCreateStatementForTable(table))) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not create required table '" << getTableName(table).toStdString() << "'. Query error: " << query.lastError().text().toStdString();
+				QStringList const createQueries = getCreateStatementForTable(table);
+				for (QString const& createQuery : createQueries) {
+					if (!query.exec(createQuery)) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not create required table '" << getTableName(table).toStdString() << "'. Query error: " << query.lastError().text().toStdString();
+					}
 				}
 
 				setTableVersion(table, createStatementVersion);
@@ -396,14 +802,28 @@ namespace openmittsu {
 		}
 
 		void SimpleDatabase::createOrUpdateTables() {
+			if (!doesTableExist(Tables::TableVersions)) {
+				// The auto vacuum mode can only be changed cheaply before the first table is created.
+				QSqlQuery query(database);
+				if (!query.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL;"))) {
+					LOGGER()->warn("Could not enable incremental auto vacuum on new database. Query error: {}", query.lastError().text().toStdString());
+				}
+			} else if (!m_maintenance.isIncrementalVacuumEnabled()) {
+				LOGGER()->info("This database does not give free pages back to the file system. It can be converted once using Database -> Compact Database.");
+			}
+
 			int versionTableVersions = createTableIfMissingAndGetVersion(Tables::TableVersions, 1);
 			int versionTableContacts = createTableIfMissingAndGetVersion(Tables::Contacts, 1);
-			int versionTableContactMessages = createTableIfMissingAndGetVersion(Tables::ContactMessages, 1);
+			int versionTableContactMessages = createTableIfMissingAndGetVersion(Tables::ContactMessages, 2);
 			int versionTableControlMessages = createTableIfMissingAndGetVersion(Tables::ControlMessages, 1);
 			int versionTableFeatureLevels = createTableIfMissingAndGetVersion(Tables::FeatureLevels, 1);
 			int versionTableGroups = createTableIfMissingAndGetVersion(Tables::Groups, 1);
-			int versionTableGroupMessages = createTableIfMissingAndGetVersion(Tables::GroupMessages, 1);
-			int versionTableMedia = createTableIfMissingAndGetVersion(Tables::Media, 2);
+			int versionTableGroupMessages = createTableIfMissingAndGetVersion(Tables::GroupMessages, 2);
+			int versionTableMedia = createTableIfMissingAndGetVersion(Tables::Media, 5);
+			int versionTableMediaContent = createTableIfMissingAndGetVersion(Tables::MediaContent, 1);
+			int versionTableMediaDamage = createTableIfMissingAndGetVersion(Tables::MediaDamage, 1);
+			int versionTableMediaUsage = createTableIfMissingAndGetVersion(Tables::MediaUsage, 1);
+			int versionTableBackupImportJournal = createTableIfMissingAndGetVersion(Tables::BackupImportJournal, 1);
 			int versionTableSettings = createTableIfMissingAndGetVersion(Tables::Settings, 1);
 
 			if (versionTableVersions != 1) {
@@ -412,8 +832,14 @@ namespace openmittsu {
 			if (versionTableContacts != 1) {
 				LOGGER()->warn("Table Contacts has version {} instead of {}.", versionTableContacts, 1);
 			}
-			if (versionTableContactMessages != 1) {
-				LOGGER()->warn("Table ContactMessages has version {} instead of {}.", versionTableContactMessages, 1);
+			if (versionTableContactMessages != 2) {
+				LOGGER()->warn("Table ContactMessages has version {} instead of {}.", versionTableContactMessages, 2);
+
+				if (versionTableContactMessages == 1) {
+					// Update 2: Added an index on `sort_by`, `uid` to contact messages table.
+					LOGGER()->info("Upgrading contact messages table to version 2...");
+					updateTable(Tables::ContactMessages, versionTableContactMessages, 2);
+				}
 			}
 			if (versionTableControlMessages != 1) {
 				LOGGER()->warn("Table ControlMessages has version {} instead of {}.", versionTableControlMessages, 1);
@@ -424,38 +850,80 @@ namespace openmittsu {
 			if (versionTableGroups != 1) {
 				LOGGER()->warn("Table Groups has version {} instead of {}.", versionTableGroups, 1);
 			}
-			if (versionTableGroupMessages != 1) {
-				LOGGER()->warn("Table GroupMessages has version {} instead of {}.", versionTableGroupMessages, 1);
+			if (versionTableGroupMessages != 2) {
+				LOGGER()->warn("Table GroupMessages has version {} instead of {}.", versionTableGroupMessages, 2);
+
+				if (versionTableGroupMessages == 1) {
+					// Update 2: Added an index on `sort_by`, `uid` to group messages table.
+					LOGGER()->info("Upgrading group messages table to version 2...");
+					updateTable(Tables::GroupMessages, versionTableGroupMessages, 2);
+				}
 			}
-			if (versionTableMedia != 2) {
-				LOGGER()->warn("Table Media has version {} instead of {}.", versionTableMedia, 2);
+			if (versionTableMedia != 5) {
+				LOGGER()->warn("Table Media has version {} instead of {}.", versionTableMedia, 5);
 
-				if (versionTableMedia == 1) {
+				if ((versionTableMedia >= 1) && (versionTableMedia <= 4)) {
 					// Update 1: Added `type` field to media table.
-					LOGGER()->info("Upgrading media database to file schema version 2...");
-					this->transactionStart();
-					QSqlQuery query(database);
-					QStringList updateQueries = getUpdateStatementForTable(Tables::Media, 2);
+					// Update 2: Added `format` field to media table.
+					// Update 3: Added `content_id` field to media table.
+					// Update 4: Added an index on `type`, `size`, `uid` to media table.
+					LOGGER()->info("Upgrading media database to file schema version 5...");
+					updateTable(Tables::Media, versionTableMedia, 5);
+					m_mediaFileStorage.upgradeMediaDatabase(versionTableMedia);
+					LOGGER()->info("Upgrading media database to file schema version 5... Done.");
+				}
+			}
+			if (versionTableMediaContent != 1) {
+				LOGGER()->warn("Table MediaContent has version {} instead of {}.", versionTableMediaContent, 1);
+			}
+			if (versionTableMediaDamage != 1) {
+				LOGGER()->warn("Table MediaDamage has version {} instead of {}.", versionTableMediaDamage, 1);
+			}
+			if (versionTableMediaUsage != 1) {
+				LOGGER()->warn("Table MediaUsage has version {} instead of {}.", versionTableMediaUsage, 1);
+			}
+			if (versionTableBackupImportJournal != 1) {
+				LOGGER()->warn("Table BackupImportJournal has version {} instead of {}.", versionTableBackupImportJournal, 1);
+			}
+			if (versionTableSettings != 1) {
+				LOGGER()->warn("Table Settings has version {} instead of {}.", versionTableSettings, 1);
+			}
+
+			// Updates:
+			// Update 1: Added `type` field to media table.
+			// Update 2: Added `format` field to media table.
+			// Update 3: Added `content_id` field to media table.
+			// Update 4: Added an index on `type`, `size`, `uid` to media table.
+		}
+
+		void SimpleDatabase::updateTable(Tables const& table, int fromVersion, int toVersion) {
+			if (!this->transactionStart()) {
+				LOGGER()->warn("SimpleDatabase: Could NOT start transaction!");
+			}
+
+			try {
+				QSqlQuery query(database);
+				for (int version = fromVersion + 1; version <= toVersion; ++version) {
+					QStringList const updateQueries = getUpdateStatementForTable(table, version);
 					auto it = updateQueries.constBegin();
 					auto const end = updateQueries.constEnd();
 					for (; it != end; ++it) {
 						LOGGER_DEBUG("Running part of update query: {}", it->toStdString());
 						if (!query.exec(*it)) {
-							throw openmittsu::exceptions::InternalErrorException() << "Could not update table 'media' to version 2. Query error: " << query.lastError().text().toStdString();
+							throw openmittsu::exceptions::InternalErrorException() << "Could not update table '" << getTableName(table).toStdString() << "' to version " << version << ". Query error: " << query.lastError().text().toStdString();
 						}
 					}
-					setTableVersion(Tables::Media, 2);
-					m_mediaFileStorage.upgradeMediaDatabase(1);
-					this->transactionCommit();
-					LOGGER()->info("Upgrading media database to file schema version 2... Done.");
 				}
-			}
-			if (versionTableSettings != 1) {
-				LOGGER()->warn("Table Settings has version {} instead of {}.", versionTableSettings, 1);
+				setTableVersion(table, toVersion);
+			} catch (...) {
+				this->transactionRollback();
+				throw;
 			}
 
-			// Updates:
-			// Update 1: Added `type` field to media table.
+			if (!this->transactionCommit()) {
+				this->transactionRollback();
+				throw openmittsu::exceptions::InternalErrorException() << "Could not commit the update of table '" << getTableName(table).toStdString() << "' to version " << toVersion << ".";
+			}
 		}
 
 		QString SimpleDatabase::generateUuid() const {
@@ -469,32 +937,54 @@ namespace openmittsu {
 			return uuidString;
 		}
 
-		openmittsu::protocol::MessageId SimpleDatabase::getNextMessageId(openmittsu::protocol::ContactId const& contact) {
-			openmittsu::protocol::MessageId id(openmittsu::protocol::MessageId::random());
+		void SimpleDatabase::reserveMessageIdEpoch() {
+			QString const keyOptionName(QStringLiteral("message_id_key"));
+			QString const epochOptionName(QStringLiteral("message_id_epoch"));
 
-			while (true) {
-				if (!internal::DatabaseContactMessage::exists(this, contact, id) && !internal::DatabaseControlMessage::exists(this, contact, id)) {
-					break;
+			QByteArray key;
+			quint32 epoch = 0;
+			if (hasOptionInternal(keyOptionName, true) && hasOptionInternal(epochOptionName, true)) {
+				key = QByteArray::fromHex(getOptionValueInternal(keyOptionName, true).toUtf8());
+				bool ok = false;
+				quint64 const lastEpoch = getOptionValueInternal(epochOptionName, true).toULongLong(&ok);
+				if (!ok || (key.size() != internal::DatabaseMessageIdAllocator::getKeySizeInBytes())) {
+					throw openmittsu::exceptions::InternalErrorException() << "The stored message ID allocator state is corrupted.";
 				}
 
-				id = openmittsu::protocol::MessageId::random();
+				if (lastEpoch >= Q_UINT64_C(0xFFFFFFFF)) {
+					// All epochs of this key are used up, continue with a fresh permutation.
+					LOGGER()->info("All message ID epochs have been used, generating a new message ID key.");
+					key = internal::DatabaseMessageIdAllocator::generateKey();
+					epoch = 0;
+					setOptionInternal(keyOptionName, QString(key.toHex()), true);
+				} else {
+					epoch = static_cast<quint32>(lastEpoch + 1);
+				}
+			} else {
+				key = internal::DatabaseMessageIdAllocator::generateKey();
+				epoch = 0;
+				setOptionInternal(keyOptionName, QString(key.toHex()), true);
 			}
 
-			return id;
+			// Persist the epoch before handing out any ID from it, so that a crash can never lead to an epoch being used twice.
+			setOptionInternal(epochOptionName, QString::number(epoch), true);
+			m_messageIdAllocator.initialize(key, epoch);
 		}
 
-		openmittsu::protocol::MessageId SimpleDatabase::getNextMessageId(openmittsu::protocol::GroupId const& group) {
-			openmittsu::protocol::MessageId id(openmittsu::protocol::MessageId::random());
+		openmittsu::protocol::MessageId SimpleDatabase::getNextMessageId(openmittsu::protocol::ContactId const&) {
+			if (m_messageIdAllocator.isExhausted()) {
+				reserveMessageIdEpoch();
+			}
 
-			while (true) {
-				if (!internal::DatabaseGroupMessage::exists(this, group, id)) {
-					break;
-				}
+			return m_messageIdAllocator.getNextMessageId();
+		}
 
-				id = openmittsu::protocol::MessageId::random();
+		openmittsu::protocol::MessageId SimpleDatabase::getNextMessageId(openmittsu::protocol::GroupId const&) {
+			if (m_messageIdAllocator.isExhausted()) {
+				reserveMessageIdEpoch();
 			}
 
-			return id;
+			return m_messageIdAllocator.getNextMessageId();
 		}
 
 		openmittsu::protocol::MessageId SimpleDatabase::storeSentContactMessageAudio(openmittsu::protocol::ContactId const& receiver, openmittsu::protocol::MessageTime const& timeCreated, bool isQueued, QByteArray const& audio, quint16 lengthInSeconds) {
@@ -816,12 +1306,12 @@ namespace openmittsu {
 			message.setMessageState(UserMessageState::SENT, openmittsu::protocol::MessageTime::now());
 		}
 
-		void SimpleDatabase::storeContactMessagesFromBackup(QList<openmittsu::backup::ContactMessageBackupObject> const& messages) {
-			internal::DatabaseContactMessage::insertContactMessagesFromBackup(this, messages);
+		void SimpleDatabase::storeContactMessagesFromBackup(QList<openmittsu::backup::ContactMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints) {
+			internal::DatabaseContactMessage::insertContactMessagesFromBackup(this, messages, checkpoints);
 		}
 
-		void SimpleDatabase::storeGroupMessagesFromBackup(QList<openmittsu::backup::GroupMessageBackupObject> const& messages) {
-			internal::DatabaseGroupMessage::insertGroupMessagesFromBackup(this, messages);
+		void SimpleDatabase::storeGroupMessagesFromBackup(QList<openmittsu::backup::GroupMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints) {
+			internal::DatabaseGroupMessage::insertGroupMessagesFromBackup(this, messages, checkpoints);
 		}
 
 		void SimpleDatabase::storeContactMediaItemsFromBackup(QList<openmittsu::backup::ContactMediaItemBackupObject> const& items) {
@@ -832,6 +1322,66 @@ namespace openmittsu {
 			m_mediaFileStorage.insertMediaItemsFromBackup(items);
 		}
 
+		QHash<QString, BackupImportCheckpoint> SimpleDatabase::getBackupImportCheckpoints() const {
+			return internal::DatabaseBackupImportJournal::getCheckpoints(this);
+		}
+
+		QString SimpleDatabase::getBackupImportFingerprint() const {
+			return internal::DatabaseBackupImportJournal::getFingerprint(this);
+		}
+
+		void SimpleDatabase::startBackupImportJournal(QString const& fingerprint, QStringList const& fileNames) {
+			if (!transactionStart()) {
+				LOGGER()->warn("Could NOT start transaction!");
+			}
+			internal::DatabaseBackupImportJournal::start(this, fingerprint, fileNames);
+			if (!transactionCommit()) {
+				LOGGER()->warn("Could NOT commit transaction!");
+			}
+		}
+
+		void SimpleDatabase::storeBackupImportCheckpoints(QList<BackupImportCheckpoint> const& checkpoints) {
+			if (!transactionStart()) {
+				LOGGER()->warn("Could NOT start transaction!");
+			}
+			internal::DatabaseBackupImportJournal::storeCheckpoints(this, checkpoints);
+			if (!transactionCommit()) {
+				LOGGER()->warn("Could NOT commit transaction!");
+			}
+		}
+
+		void SimpleDatabase::clearBackupImportCheckpoints() {
+			internal::DatabaseBackupImportJournal::clear(this);
+		}
+
+		void SimpleDatabase::readMessageKeysForMerge(bool isGroupMessages, internal::DatabaseUserMessage::MessageKeyCallback const& callback) const {
+			if (isGroupMessages) {
+				internal::DatabaseGroupMessage::readMessageKeysForMerge(this, callback);
+			} else {
+				internal::DatabaseContactMessage::readMessageKeysForMerge(this, callback);
+			}
+		}
+
+		QList<openmittsu::backup::ContactBackupObject> SimpleDatabase::getContactsForBackup() const {
+			return internal::DatabaseBackupExport::getContacts(this, getSelfContact());
+		}
+
+		QList<openmittsu::backup::GroupBackupObject> SimpleDatabase::getGroupsForBackup() const {
+			return internal::DatabaseBackupExport::getGroups(this);
+		}
+
+		QList<openmittsu::backup::ContactMessageBackupObject> SimpleDatabase::getContactMessagesForBackup(QString const& schema, qint64& startAfterRowId, int maxCount) const {
+			return internal::DatabaseBackupExport::getContactMessages(this, schema, startAfterRowId, maxCount, startAfterRowId);
+		}
+
+		QList<openmittsu::backup::GroupMessageBackupObject> SimpleDatabase::getGroupMessagesForBackup(QString const& schema, qint64& startAfterRowId, int maxCount) const {
+			return internal::DatabaseBackupExport::getGroupMessages(this, schema, startAfterRowId, maxCount, startAfterRowId);
+		}
+
+		QStringList SimpleDatabase::getMediaItemUuidsForBackup(bool isGroupMedia, QString const& startAfterUuid, int maxCount) const {
+			return internal::DatabaseBackupExport::getMediaItemUuids(this, isGroupMedia, startAfterUuid, maxCount);
+		}
+
 		void SimpleDatabase::storeNewContact(QVector<NewContactData> const& newContactData) {
 			m_contactAndGroupDataProvider.addContact(newContactData);
 		}
@@ -1065,6 +1615,9 @@ namespace openmittsu {
 				setOptionInternal(it.key(), it.value(), false);
 			}
 
+			applyMediaCacheOptions();
+			applyMediaQuotaOptions();
+			applyArchiveOptions();
 			emit optionsChanged();
 		}
 
@@ -1111,11 +1664,21 @@ namespace openmittsu {
 		}
 
 		MediaFileItem SimpleDatabase::getMediaItem(QString const& uuid, MediaFileType const& fileType) const {
-			return m_mediaFileStorage.getMediaItem(uuid, fileType);
+			return m_mediaFileStorage.getMediaItemHandle(uuid, fileType).get();
+		}
+
+		std::shared_future<MediaFileItem> SimpleDatabase::getMediaItemAsync(QString const& uuid, MediaFileType const& fileType) const {
+			return m_mediaFileStorage.getMediaItemAsync(uuid, fileType);
+		}
+
+		MediaItemHandle SimpleDatabase::getMediaItemHandle(QString const& uuid, MediaFileType const& fileType) const {
+			return m_mediaFileStorage.getMediaItemHandle(uuid, fileType);
 		}
 
 		void SimpleDatabase::insertMediaItem(QString const& uuid, QByteArray const& data, MediaFileType const& fileType) {
+			m_maintenance.notifyActivity();
 			m_mediaFileStorage.insertMediaItem(uuid, data, fileType);
+			m_isMediaQuotaCheckPending = m_mediaQuota.isEnabled();
 		}
 
 		void SimpleDatabase::removeMediaItem(QString const& uuid, MediaFileType const& fileType) {
@@ -1126,6 +1689,18 @@ namespace openmittsu {
 			m_mediaFileStorage.removeAllMediaItems(uuid);
 		}
 
+		bool SimpleDatabase::hasInternalOption(QString const& optionName) {
+			return hasOptionInternal(optionName, true);
+		}
+
+		QString SimpleDatabase::getInternalOptionValue(QString const& optionName) {
+			return getOptionValueInternal(optionName, true);
+		}
+
+		void SimpleDatabase::setInternalOptionValue(QString const& optionName, QString const& optionValue) {
+			setOptionInternal(optionName, optionValue, true);
+		}
+
 		std::shared_ptr<openmittsu::backup::IdentityBackup> SimpleDatabase::getBackup() const {
 			return std::make_shared<openmittsu::backup::IdentityBackup>(*m_identityBackup);
 		}
@@ -1168,6 +1743,18 @@ namespace openmittsu {
 			return m_mediaFileStorage.getMediaItemCount();
 		}
 
+		bool SimpleDatabase::hasMediaItem(QString const& uuid, MediaFileType const& fileType) const {
+			return m_mediaFileStorage.hasMediaItem(uuid, fileType);
+		}
+
+		std::unique_ptr<internal::ChunkedMediaFileReader> SimpleDatabase::openMediaItem(QString const& uuid, MediaFileType const& fileType) {
+			return m_mediaFileStorage.openMediaItem(uuid, fileType);
+		}
+
+		void SimpleDatabase::waitForMediaWrites() {
+			m_mediaFileStorage.completePendingWrites();
+		}
+
 		void SimpleDatabase::setContactFirstName(openmittsu::protocol::ContactId const& identity, QString const& firstName) {
 			if (!hasContact(identity)) {
 				throw openmittsu::exceptions::InternalErrorException() << "The given identity " << identity.toString() << " is unknown!";
@@ -1314,11 +1901,13 @@ namespace openmittsu {
 		}
 
 		void SimpleDatabase::announceMessageChanged(QString const& uuid) {
+			m_maintenance.notifyActivity();
 			LOGGER_DEBUG("Database: Announcing messageChanged() for UUID {}.", uuid.toStdString());
 			emit messageChanged(uuid);
 		}
 
 		void SimpleDatabase::announceMessageDeleted(QString const& uuid) {
+			m_maintenance.notifyActivity();
 			LOGGER_DEBUG("Database: Announcing messageDeleted() for UUID {}.", uuid.toStdString());
 			emit messageDeleted(uuid);
 		}
@@ -1332,18 +1921,22 @@ namespace openmittsu {
 		}
 
 		void SimpleDatabase::announceNewMessage(openmittsu::protocol::ContactId const& contact, QString const& messageUuid) {
+			m_maintenance.notifyActivity();
 			emit contactHasNewMessage(contact, messageUuid);
 		}
 
 		void SimpleDatabase::announceNewMessage(openmittsu::protocol::GroupId const& group, QString const& messageUuid) {
+			m_maintenance.notifyActivity();
 			emit groupHasNewMessage(group, messageUuid);
 		}
 
 		void SimpleDatabase::announceReceivedNewMessage(openmittsu::protocol::ContactId const& contact) {
+			m_maintenance.notifyActivity();
 			emit receivedNewContactMessage(contact);
 		}
 
 		void SimpleDatabase::announceReceivedNewMessage(openmittsu::protocol::GroupId const& group) {
+			m_maintenance.notifyActivity();
 			emit receivedNewGroupMessage(group);
 		}
 
@@ -1556,6 +2149,14 @@ namespace openmittsu {
 			return database.commit();
 		}
 
+		bool SimpleDatabase::transactionRollback() {
+			return database.rollback();
+		}
+
+		QStringList SimpleDatabase::getMessageStorageSchemas() const {
+			return m_archive.getSchemas();
+		}
+
 		std::shared_ptr<DatabaseReadonlyContactMessage> SimpleDatabase::getContactMessage(openmittsu::protocol::ContactId const& contact, QString const& uuid) {
 			internal::DatabaseContactMessageCursor cursor(this, contact, uuid);
 			return cursor.getReadonlyMessage();
@@ -1573,6 +2174,10 @@ namespace openmittsu {
 		ContactToContactDataMap SimpleDatabase::getContactDataAll(bool fetchMessageCount) const {
 			return m_contactAndGroupDataProvider.getContactDataAll(fetchMessageCount);
 		}
+
+		ContactToContactDataMap SimpleDatabase::getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const {
+			return m_contactAndGroupDataProvider.getContactDataSnapshot(contacts, fetchMessageCount);
+		}
 		
 		GroupData SimpleDatabase::getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const {
 			return m_contactAndGroupDataProvider.getGroupData(group, withDescription);
@@ -1582,6 +2187,10 @@ namespace openmittsu {
 			return m_contactAndGroupDataProvider.getGroupDataAll(withDescription);
 		}
 
+		GroupToGroupDataMap SimpleDatabase::getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const {
+			return m_contactAndGroupDataProvider.getGroupDataSnapshot(groups, withDescription);
+		}
+
 		QVector<QString> SimpleDatabase::getLastMessageUuids(openmittsu::protocol::ContactId const& contact, std::size_t n) {
 			internal::DatabaseContactMessageCursor cursor(this, contact);
 			return cursor.getLastMessages(n);
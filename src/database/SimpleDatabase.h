@@ -22,6 +22,9 @@
 #include "src/crypto/PublicKey.h"
 #include "src/crypto/KeyPair.h"
 
+#include "src/database/BackupImportCheckpoint.h"
+#include "src/database/internal/DatabaseBackupExport.h"
+#include "src/database/internal/DatabaseBackupImportJournal.h"
 #include "src/database/internal/DatabaseContactAndGroupDataProvider.h"
 #include "src/database/internal/DatabaseMessageCursor.h"
 #include "src/database/internal/DatabaseContactMessage.h"
@@ -29,9 +32,15 @@
 #include "src/database/internal/DatabaseControlMessage.h"
 #include "src/database/internal/DatabaseGroupMessage.h"
 #include "src/database/internal/DatabaseGroupMessageCursor.h"
+#include "src/database/internal/ChunkedMediaFileReader.h"
+#include "src/database/internal/DatabaseArchive.h"
+#include "src/database/internal/DatabaseMaintenance.h"
 #include "src/database/internal/DatabaseMessage.h"
+#include "src/database/internal/DatabaseMessageIdAllocator.h"
 #include "src/database/internal/ExternalMediaFileStorage.h"
 #include "src/database/internal/InternalDatabaseInterface.h"
+#include "src/database/internal/MediaIntegrityScanner.h"
+#include "src/database/internal/MediaQuota.h"
 #include "src/database/DatabaseReadonlyContactMessage.h"
 #include "src/dataproviders/messages/ContactMessageType.h"
 #include "src/dataproviders/messages/ControlMessageType.h"
@@ -44,6 +53,8 @@
 
 namespace openmittsu {
 	namespace backup {
+		class ContactBackupObject;
+		class GroupBackupObject;
 		class ContactMessageBackupObject;
 		class GroupMessageBackupObject;
 		class ContactMediaItemBackupObject;
@@ -62,12 +73,42 @@ namespace openmittsu {
 
 			static QString getDefaultDatabaseFileName();
 
+			/** What an existing database holds that decides whether a data backup may be imported into it. */
+			struct BackupImportTarget {
+				openmittsu::protocol::ContactId selfContact;
+				/** Whether an interrupted import left a journal, and the fingerprint of the backup it belongs to. */
+				bool hasPendingImport;
+				QString pendingImportFingerprint;
+			};
+			/** Reads the database file without writing to it. Throws if it can not be opened with the password. */
+			static BackupImportTarget probeBackupImportTarget(QString const& filename, QString const& password);
+
 			// Backup access
-			void storeContactMessagesFromBackup(QList<openmittsu::backup::ContactMessageBackupObject> const& messages);
-			void storeGroupMessagesFromBackup(QList<openmittsu::backup::GroupMessageBackupObject> const& messages);
+			/** Stores the messages and the checkpoints covering them in one transaction. Messages whose uuid is already stored are skipped. */
+			void storeContactMessagesFromBackup(QList<openmittsu::backup::ContactMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints);
+			void storeGroupMessagesFromBackup(QList<openmittsu::backup::GroupMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints);
 			void storeContactMediaItemsFromBackup(QList<openmittsu::backup::ContactMediaItemBackupObject> const& items);
 			void storeGroupMediaItemsFromBackup(QList<openmittsu::backup::GroupMediaItemBackupObject> const& items);
 
+			/** The checkpoints of a backup import that did not finish yet, by file name. Empty if no import is in progress. */
+			QHash<QString, BackupImportCheckpoint> getBackupImportCheckpoints() const;
+			/** The fingerprint of the backup whose import did not finish yet, empty if no import is in progress. */
+			QString getBackupImportFingerprint() const;
+			/** Starts the journal of a new import of the backup with the given fingerprint, with a checkpoint at the start of each file. */
+			void startBackupImportJournal(QString const& fingerprint, QStringList const& fileNames);
+			void storeBackupImportCheckpoints(QList<BackupImportCheckpoint> const& checkpoints);
+			void clearBackupImportCheckpoints();
+			/** Reads the uuid, conversation, sender and API id of every stored contact or group message, for merging a backup into this database. */
+			void readMessageKeysForMerge(bool isGroupMessages, internal::DatabaseUserMessage::MessageKeyCallback const& callback) const;
+
+			// Backup export
+			QList<openmittsu::backup::ContactBackupObject> getContactsForBackup() const;
+			QList<openmittsu::backup::GroupBackupObject> getGroupsForBackup() const;
+			/** At most maxCount messages of the given storage schema following the row startAfterRowId, which is advanced to the last one returned. */
+			QList<openmittsu::backup::ContactMessageBackupObject> getContactMessagesForBackup(QString const& schema, qint64& startAfterRowId, int maxCount) const;
+			QList<openmittsu::backup::GroupMessageBackupObject> getGroupMessagesForBackup(QString const& schema, qint64& startAfterRowId, int maxCount) const;
+			QStringList getMediaItemUuidsForBackup(bool isGroupMedia, QString const& startAfterUuid, int maxCount) const;
+
 			bool hasOption(QString const& optionName);
 			QString getOptionValueAsString(QString const& optionName);
 			bool getOptionValueAsBool(QString const& optionName);
@@ -77,6 +118,26 @@ namespace openmittsu {
 			void setOptionValue(QString const& optionName, bool const& optionValue);
 			void setOptionValue(QString const& optionName, QByteArray const& optionValue);
 
+			// Media cache
+			/** Waits for the item, which is read and decrypted on the media I/O pool. */
+			MediaFileItem getMediaItem(QString const& uuid, MediaFileType const& fileType) const;
+
+			// Media quota
+			/**
+			 * Evicts media items until the quota is met, in one go. Shortly after media was stored, the same check runs in short slices on the database thread,
+			 * and the maintenance runs it as well. Returns the number of evicted items.
+			 */
+			int enforceMediaQuota();
+			internal::MediaQuota::Settings getMediaQuotaSettings() const;
+			/** Overrides the quota options until they are changed again. */
+			void setMediaQuotaSettings(internal::MediaQuota::Settings const& settings);
+			internal::MediaFileStorage::MediaUsage getMediaUsage() const;
+			internal::ExternalMediaFileStorage::ConversationMediaUsage getConversationMediaUsage() const;
+
+			// Media integrity
+			/** Runs the scan to completion on the calling thread, replacing a scan still in progress. */
+			internal::MediaIntegrityScanner::Report runMediaIntegrityScan(bool repair, internal::MediaIntegrityScanner::ProgressCallback const& progressCallback = nullptr);
+
 			QSet<openmittsu::protocol::ContactId> getKnownContacts() const;
 			QHash<openmittsu::protocol::ContactId, openmittsu::crypto::PublicKey> getKnownContactsWithPublicKeys() const;
 			//virtual QHash<openmittsu::protocol::ContactId, QString> getKnownContactsWithNicknames(bool withSelfContactId = true) const override;
@@ -92,6 +153,16 @@ namespace openmittsu {
 			int getContactMessageCount() const;
 			int getGroupMessageCount() const;
 			int getMediaItemCount() const;
+			bool hasMediaItem(QString const& uuid, MediaFileType const& fileType) const;
+
+			/**
+			 * Opens a media item for random access reads with memory use bounded by the chunk size. Returns nullptr if the item is not available,
+			 * or still stored in a per-item format. Such items are migrated in the background and can be read through getMediaItemHandle() meanwhile.
+			 */
+			std::unique_ptr<internal::ChunkedMediaFileReader> openMediaItem(QString const& uuid, MediaFileType const& fileType);
+
+			/** Blocks until all media items written on the media I/O pool are stored. Used before backups and by threads without an event loop. */
+			void waitForMediaWrites();
 
 			internal::DatabaseContactMessageCursor getMessageCursor(openmittsu::protocol::ContactId const& contact);
 			internal::DatabaseGroupMessageCursor getMessageCursor(openmittsu::protocol::GroupId const& group);
@@ -113,6 +184,20 @@ namespace openmittsu {
 			virtual OptionNameToValueMap getOptions() override;
 			virtual void setOptions(OptionNameToValueMap const& options) override;
 
+			virtual bool isIncrementalVacuumEnabled() const override;
+			virtual bool enableIncrementalVacuum() override;
+			virtual bool runMaintenance() override;
+			virtual openmittsu::database::MaintenanceStatistics getMaintenanceStatistics() override;
+			virtual openmittsu::database::MediaCacheStatistics getMediaCacheStatistics() const override;
+
+			virtual void startMediaIntegrityScan(bool repair) override;
+			virtual void cancelMediaIntegrityScan() override;
+			virtual bool isMediaIntegrityScanRunning() const override;
+			virtual openmittsu::database::MediaIntegrityReport getMediaIntegrityScanReport() const override;
+			virtual openmittsu::database::DamagedMediaItemList getDamagedMediaItems() const override;
+
+			virtual void exportDataBackup(QString const& backupPath, QString const& backupPassword) override;
+
 			virtual openmittsu::protocol::GroupStatus getGroupStatus(openmittsu::protocol::GroupId const& group) const override;
 			virtual openmittsu::protocol::ContactStatus getContactStatus(openmittsu::protocol::ContactId const& contact) const override;
 			virtual openmittsu::protocol::ContactId getSelfContact() const override;
@@ -122,8 +207,10 @@ namespace openmittsu {
 
 			virtual ContactData getContactData(openmittsu::protocol::ContactId const& contact, bool fetchMessageCount) const override;
 			virtual ContactToContactDataMap getContactDataAll(bool fetchMessageCount) const override;
+			virtual ContactToContactDataMap getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const override;
 			virtual GroupData getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const override;
 			virtual GroupToGroupDataMap getGroupDataAll(bool withDescription) const override;
+			virtual GroupToGroupDataMap getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const override;
 
 			virtual QVector<QString> getLastMessageUuids(openmittsu::protocol::ContactId const& contact, std::size_t n) override;
 			virtual QVector<QString> getLastMessageUuids(openmittsu::protocol::GroupId const& group, std::size_t n) override;
@@ -242,10 +329,16 @@ namespace openmittsu {
 			virtual QSqlQuery getQueryObject() const override;
 			virtual bool transactionStart() override;
 			virtual bool transactionCommit() override;
-			virtual MediaFileItem getMediaItem(QString const& uuid, MediaFileType const& fileType) const override;
+			virtual bool transactionRollback() override;
+			virtual QStringList getMessageStorageSchemas() const override;
+			virtual std::shared_future<MediaFileItem> getMediaItemAsync(QString const& uuid, MediaFileType const& fileType) const override;
+			virtual MediaItemHandle getMediaItemHandle(QString const& uuid, MediaFileType const& fileType) const override;
 			virtual void insertMediaItem(QString const& uuid, QByteArray const& data, MediaFileType const& fileType) override;
 			virtual void removeMediaItem(QString const& uuid, MediaFileType const& fileType) override;
 			virtual void removeAllMediaItems(QString const& uuid) override;
+			virtual bool hasInternalOption(QString const& optionName) override;
+			virtual QString getInternalOptionValue(QString const& optionName) override;
+			virtual void setInternalOptionValue(QString const& optionName, QString const& optionValue) override;
 		private:
 			QSqlDatabase database;
 			QString const m_driverNameCrypto;
@@ -261,8 +354,20 @@ namespace openmittsu {
 
 			internal::DatabaseContactAndGroupDataProvider m_contactAndGroupDataProvider;
 			internal::ExternalMediaFileStorage m_mediaFileStorage;
+			internal::DatabaseMessageIdAllocator m_messageIdAllocator;
+			internal::DatabaseArchive m_archive;
+			internal::MediaQuota m_mediaQuota;
+			internal::DatabaseMaintenance m_maintenance;
+			std::unique_ptr<internal::MediaIntegrityScanner> m_mediaIntegrityScanner;
 
 			QTimer queueTimeoutTimer;
+			QTimer maintenanceTimer;
+			QTimer mediaIntegrityScanTimer;
+			QTimer mediaQuotaTimer;
+			bool m_isMediaQuotaCheckPending;
+			/** The pass of the sliced quota check started by new media, see runMediaQuotaSlice(). */
+			internal::MediaQuota::Pass m_mediaQuotaPass;
+			bool m_isMediaQuotaPassInProgress;
 
 			enum class Tables {
 				Contacts,
@@ -272,6 +377,10 @@ namespace openmittsu {
 				Groups,
 				GroupMessages,
 				Media,
+				MediaContent,
+				MediaDamage,
+				MediaUsage,
+				BackupImportJournal,
 				Settings,
 				TableVersions,
 				SqliteMaster,
@@ -281,20 +390,33 @@ namespace openmittsu {
 			int getTableVersion(Tables const& table);
 			QString getTableName(Tables const& table);
 			virtual QString generateUuid() const override;
-			QString getCreateStatementForTable(Tables const& table);
+			QStringList getCreateStatementForTable(Tables const& table);
 			QStringList getUpdateStatementForTable(Tables const& table, int toVersion);
 			int createTableIfMissingAndGetVersion(Tables const& table, int createStatementVersion);
 			void setTableVersion(Tables const& table, int tableVersion);
 			void createOrUpdateTables();
+			/** Runs the update statements of all versions after fromVersion up to toVersion in one transaction. */
+			void updateTable(Tables const& table, int fromVersion, int toVersion);
 			QString getOptionValueInternal(QString const& optionName, bool isInternalOption = false);
 			bool hasOptionInternal(QString const& optionName, bool isInternalOption = false);
 			void setOptionInternal(QString const& optionName, QString const& optionValue, bool isInternalOption = false);
 			void setBackup(openmittsu::protocol::ContactId selfId, openmittsu::crypto::KeyPair key);
 			void setupQueueTimer();
+			void setupMaintenanceTimer();
+			void applyMediaCacheOptions();
+			void applyMediaQuotaOptions();
+			void applyArchiveOptions();
+			/** Continues the current quota pass, or starts a new one, until the time budget is used up. Returns the number of evicted items. */
+			int runMediaQuotaSlice(qint64 timeBudgetInMs, bool& isPassCompleted);
+			void reserveMessageIdEpoch();
 			void setKey(QString const& password);
+			static void setKey(QSqlDatabase& keyedDatabase, bool usingCryptoDb, QString const& password);
 			void updateCachedIdentityBackup();
 		private slots:
 			void onQueueTimeoutTimerFire();
+			void onMaintenanceTimerFire();
+			void onMediaIntegrityScanTimerFire();
+			void onMediaQuotaTimerFire();
 		};
 
 	}
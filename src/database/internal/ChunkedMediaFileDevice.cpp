@@ -0,0 +1,53 @@
+#include "src/database/internal/ChunkedMediaFileDevice.h"
+
+#include <QByteArray>
+
+#include <cstring>
+
+#include "src/exceptions/InternalErrorException.h"
+#include "src/utility/Logging.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			ChunkedMediaFileDevice::ChunkedMediaFileDevice(std::unique_ptr<ChunkedMediaFileReader>&& reader, QObject* parent) : QIODevice(parent), m_reader(std::move(reader)) {
+				if (m_reader == nullptr) {
+					throw openmittsu::exceptions::InternalErrorException() << "Can not create a media file device without a reader.";
+				}
+				// Unbuffered, so reads only decrypt what the caller asked for instead of filling QIODevice's read-ahead buffer.
+				open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+			}
+
+			ChunkedMediaFileDevice::~ChunkedMediaFileDevice() {
+				close();
+			}
+
+			bool ChunkedMediaFileDevice::isSequential() const {
+				return false;
+			}
+
+			qint64 ChunkedMediaFileDevice::size() const {
+				return m_reader->getSize();
+			}
+
+			qint64 ChunkedMediaFileDevice::readData(char* data, qint64 maxSize) {
+				try {
+					QByteArray const plaintext = m_reader->read(pos(), maxSize);
+					std::memcpy(data, plaintext.constData(), static_cast<size_t>(plaintext.size()));
+					return plaintext.size();
+				} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+					LOGGER()->warn("Could not read from media file device: {}", iee.what());
+					setErrorString(QString::fromUtf8(iee.what()));
+					return -1;
+				}
+			}
+
+			qint64 ChunkedMediaFileDevice::writeData(char const*, qint64) {
+				setErrorString(QStringLiteral("Media file devices are read-only."));
+				return -1;
+			}
+
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEDEVICE_H_
+#define OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEDEVICE_H_
+
+#include <QIODevice>
+#include <QtGlobal>
+
+#include <memory>
+
+#include "src/database/internal/ChunkedMediaFileReader.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * A read-only, seekable QIODevice over an encrypted chunked media file.
+			 * Reads decrypt only the chunks they touch, so media can be handed to a player without writing its plaintext to disk.
+			 * A chunk that fails authentication makes the read fail and sets the error string.
+			 */
+			class ChunkedMediaFileDevice : public QIODevice {
+				Q_OBJECT
+			public:
+				/** Takes an already opened reader. The device is opened for reading right away. */
+				explicit ChunkedMediaFileDevice(std::unique_ptr<ChunkedMediaFileReader>&& reader, QObject* parent = nullptr);
+				virtual ~ChunkedMediaFileDevice();
+
+				virtual bool isSequential() const override;
+				virtual qint64 size() const override;
+			protected:
+				virtual qint64 readData(char* data, qint64 maxSize) override;
+				virtual qint64 writeData(char const* data, qint64 maxSize) override;
+			private:
+				std::unique_ptr<ChunkedMediaFileReader> const m_reader;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEDEVICE_H_
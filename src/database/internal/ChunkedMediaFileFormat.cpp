@@ -0,0 +1,138 @@
+#include "src/database/internal/ChunkedMediaFileFormat.h"
+
+#include "src/exceptions/InternalErrorException.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+#include <sodium.h>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			namespace {
+				char const fileMagic[4] = { 'O', 'M', 'M', 'F' };
+			}
+
+			int ChunkedMediaFileFormat::getFormatVersion() {
+				return 2;
+			}
+
+			int ChunkedMediaFileFormat::getDefaultChunkSize() {
+				return 64 * 1024;
+			}
+
+			int ChunkedMediaFileFormat::getHeaderSize() {
+				return 12;
+			}
+
+			int ChunkedMediaFileFormat::getTagSize() {
+				return crypto_aead_xchacha20poly1305_ietf_ABYTES;
+			}
+
+			int ChunkedMediaFileFormat::getKeySize() {
+				return crypto_aead_xchacha20poly1305_ietf_KEYBYTES;
+			}
+
+			int ChunkedMediaFileFormat::getNonceSize() {
+				return crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+			}
+
+			QByteArray ChunkedMediaFileFormat::buildHeader(int chunkSize) {
+				QByteArray header(getHeaderSize(), '\0');
+				uchar* const data = reinterpret_cast<uchar*>(header.data());
+				memcpy(data, fileMagic, sizeof(fileMagic));
+				qToBigEndian<quint32>(static_cast<quint32>(getFormatVersion()), data + 4);
+				qToBigEndian<quint32>(static_cast<quint32>(chunkSize), data + 8);
+				return header;
+			}
+
+			int ChunkedMediaFileFormat::parseHeader(QByteArray const& header) {
+				if ((header.size() != getHeaderSize()) || (memcmp(header.constData(), fileMagic, sizeof(fileMagic)) != 0)) {
+					return 0;
+				}
+
+				uchar const* const data = reinterpret_cast<uchar const*>(header.constData());
+				quint32 const version = qFromBigEndian<quint32>(data + 4);
+				quint32 const chunkSize = qFromBigEndian<quint32>(data + 8);
+				if ((version != static_cast<quint32>(getFormatVersion())) || (chunkSize == 0) || (chunkSize > (64 * 1024 * 1024))) {
+					return 0;
+				}
+
+				return static_cast<int>(chunkSize);
+			}
+
+			bool ChunkedMediaFileFormat::computeLayout(qint64 fileSize, int chunkSize, qint64& chunkCount, qint64& plaintextSize) {
+				qint64 const bodySize = fileSize - getHeaderSize();
+				if ((chunkSize <= 0) || (bodySize < getTagSize())) {
+					return false;
+				}
+
+				qint64 const encryptedChunkSize = chunkSize + getTagSize();
+				chunkCount = (bodySize + encryptedChunkSize - 1) / encryptedChunkSize;
+				qint64 const lastChunkSize = bodySize - ((chunkCount - 1) * encryptedChunkSize);
+				if (lastChunkSize < getTagSize()) {
+					return false;
+				}
+
+				plaintextSize = bodySize - (chunkCount * getTagSize());
+				return true;
+			}
+
+			QByteArray ChunkedMediaFileFormat::buildChunkNonce(QByteArray const& nonce, qint64 chunkIndex) {
+				QByteArray chunkNonce(nonce);
+				uchar* const data = reinterpret_cast<uchar*>(chunkNonce.data()) + (chunkNonce.size() - 8);
+				quint64 const counter = qFromBigEndian<quint64>(data) ^ static_cast<quint64>(chunkIndex);
+				qToBigEndian<quint64>(counter, data);
+				return chunkNonce;
+			}
+
+			QByteArray ChunkedMediaFileFormat::buildAdditionalData(QByteArray const& header, bool isFinalChunk) {
+				QByteArray additionalData(header);
+				additionalData.append(isFinalChunk ? '\x01' : '\x00');
+				return additionalData;
+			}
+
+			QByteArray ChunkedMediaFileFormat::encryptChunk(QByteArray const& header, QByteArray const& key, QByteArray const& nonce, qint64 chunkIndex, bool isFinalChunk, char const* data, int length) {
+				if ((key.size() != getKeySize()) || (nonce.size() != getNonceSize())) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not encrypt media chunk, the key or nonce size is incorrect.";
+				}
+
+				QByteArray const chunkNonce = buildChunkNonce(nonce, chunkIndex);
+				QByteArray const additionalData = buildAdditionalData(header, isFinalChunk);
+				QByteArray encryptedChunk(length + getTagSize(), '\0');
+				unsigned long long ciphertext_len = 0;
+				if (crypto_aead_xchacha20poly1305_ietf_encrypt(reinterpret_cast<unsigned char*>(encryptedChunk.data()), &ciphertext_len, reinterpret_cast<unsigned char const*>(data), length, reinterpret_cast<unsigned char const*>(additionalData.constData()), additionalData.size(), NULL, reinterpret_cast<unsigned char const*>(chunkNonce.constData()), reinterpret_cast<unsigned char const*>(key.constData())) != 0) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not encrypt media chunk " << chunkIndex << ".";
+				} else if (static_cast<int>(ciphertext_len) != encryptedChunk.size()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not encrypt media chunk " << chunkIndex << ": Expected size was " << encryptedChunk.size() << " Bytes, but we got " << ciphertext_len << " Bytes instead!";
+				}
+
+				return encryptedChunk;
+			}
+
+			QByteArray ChunkedMediaFileFormat::decryptChunk(QByteArray const& header, QByteArray const& key, QByteArray const& nonce, qint64 chunkIndex, bool isFinalChunk, QByteArray const& encryptedChunk) {
+				if ((key.size() != getKeySize()) || (nonce.size() != getNonceSize())) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not decrypt media chunk, the key or nonce size is incorrect.";
+				} else if (encryptedChunk.size() < getTagSize()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not decrypt media chunk " << chunkIndex << ", it is too short.";
+				}
+
+				QByteArray const chunkNonce = buildChunkNonce(nonce, chunkIndex);
+				QByteArray const additionalData = buildAdditionalData(header, isFinalChunk);
+				QByteArray decryptedChunk(encryptedChunk.size() - getTagSize(), '\0');
+				unsigned long long decrypted_len = 0;
+				if (crypto_aead_xchacha20poly1305_ietf_decrypt(reinterpret_cast<unsigned char*>(decryptedChunk.data()), &decrypted_len, NULL, reinterpret_cast<unsigned char const*>(encryptedChunk.constData()), encryptedChunk.size(), reinterpret_cast<unsigned char const*>(additionalData.constData()), additionalData.size(), reinterpret_cast<unsigned char const*>(chunkNonce.constData()), reinterpret_cast<unsigned char const*>(key.constData())) != 0) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not decrypt media chunk " << chunkIndex << ", data corrupt!";
+				} else if (static_cast<int>(decrypted_len) != decryptedChunk.size()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not decrypt media chunk " << chunkIndex << ": Expected size was " << decryptedChunk.size() << " Bytes, but we got " << decrypted_len << " Bytes instead!";
+				}
+
+				return decryptedChunk;
+			}
+
+		}
+	}
+}
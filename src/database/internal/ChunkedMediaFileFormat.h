@@ -0,0 +1,49 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEFORMAT_H_
+#define OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEFORMAT_H_
+
+#include <QByteArray>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Describes media file format version 2, which encrypts media data in independently authenticated chunks.
+			 *
+			 * A file starts with a header (magic "OMMF", format version and chunk size, each 32-bit big endian), followed by the chunks.
+			 * Every chunk is encrypted with XChaCha20-Poly1305 under the media key, using the media nonce with the chunk index XORed into its last eight bytes.
+			 * The header and a flag marking the final chunk are authenticated as additional data, so reordered, truncated or extended files fail to decrypt.
+			 * All chunks except the last hold exactly getChunkSize() bytes of plaintext, the last one holds between zero and getChunkSize() bytes.
+			 */
+			class ChunkedMediaFileFormat {
+			public:
+				static int getFormatVersion();
+				static int getDefaultChunkSize();
+				static int getHeaderSize();
+				static int getTagSize();
+				static int getKeySize();
+				static int getNonceSize();
+
+				static QByteArray buildHeader(int chunkSize);
+
+				/** Returns the chunk size stored in the header, or zero if the header is not valid. */
+				static int parseHeader(QByteArray const& header);
+
+				/** Computes the number of chunks and the plaintext size for a file of the given size, returns false if no valid file can have this size. */
+				static bool computeLayout(qint64 fileSize, int chunkSize, qint64& chunkCount, qint64& plaintextSize);
+
+				static QByteArray encryptChunk(QByteArray const& header, QByteArray const& key, QByteArray const& nonce, qint64 chunkIndex, bool isFinalChunk, char const* data, int length);
+
+				/** Throws an InternalErrorException if the chunk does not authenticate. */
+				static QByteArray decryptChunk(QByteArray const& header, QByteArray const& key, QByteArray const& nonce, qint64 chunkIndex, bool isFinalChunk, QByteArray const& encryptedChunk);
+			private:
+				static QByteArray buildChunkNonce(QByteArray const& nonce, qint64 chunkIndex);
+				static QByteArray buildAdditionalData(QByteArray const& header, bool isFinalChunk);
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEFORMAT_H_
@@ -0,0 +1,99 @@
+#include "src/database/internal/ChunkedMediaFileReader.h"
+
+#include "src/database/internal/ChunkedMediaFileFormat.h"
+#include "src/exceptions/InternalErrorException.h"
+
+#include <algorithm>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			ChunkedMediaFileReader::ChunkedMediaFileReader(QString const& fileName, QByteArray const& key, QByteArray const& nonce) : m_file(fileName), m_key(key), m_nonce(nonce), m_header(), m_chunkSize(0), m_chunkCount(0), m_size(0), m_cachedChunkIndex(-1), m_cachedChunk() {
+				//
+			}
+
+			ChunkedMediaFileReader::~ChunkedMediaFileReader() {
+				close();
+			}
+
+			bool ChunkedMediaFileReader::open() {
+				if (!m_file.open(QFile::ReadOnly)) {
+					return false;
+				}
+
+				m_header = m_file.read(ChunkedMediaFileFormat::getHeaderSize());
+				m_chunkSize = ChunkedMediaFileFormat::parseHeader(m_header);
+				if ((m_chunkSize <= 0) || !ChunkedMediaFileFormat::computeLayout(m_file.size(), m_chunkSize, m_chunkCount, m_size)) {
+					m_file.close();
+					return false;
+				}
+
+				return true;
+			}
+
+			void ChunkedMediaFileReader::close() {
+				if (m_file.isOpen()) {
+					m_file.close();
+				}
+				m_cachedChunkIndex = -1;
+				m_cachedChunk.clear();
+			}
+
+			qint64 ChunkedMediaFileReader::getSize() const {
+				return m_size;
+			}
+
+			int ChunkedMediaFileReader::getChunkSize() const {
+				return m_chunkSize;
+			}
+
+			qint64 ChunkedMediaFileReader::getChunkCount() const {
+				return m_chunkCount;
+			}
+
+			QByteArray ChunkedMediaFileReader::readChunk(qint64 chunkIndex) {
+				if (!m_file.isOpen() || (chunkIndex < 0) || (chunkIndex >= m_chunkCount)) {
+					throw openmittsu::exceptions::InternalErrorException() << "Can not read chunk " << chunkIndex << " of media file \"" << m_file.fileName().toStdString() << "\".";
+				} else if (chunkIndex == m_cachedChunkIndex) {
+					return m_cachedChunk;
+				}
+
+				qint64 const encryptedChunkSize = m_chunkSize + ChunkedMediaFileFormat::getTagSize();
+				if (!m_file.seek(ChunkedMediaFileFormat::getHeaderSize() + (chunkIndex * encryptedChunkSize))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not seek to chunk " << chunkIndex << " of media file \"" << m_file.fileName().toStdString() << "\".";
+				}
+
+				QByteArray const encryptedChunk = m_file.read(encryptedChunkSize);
+				m_cachedChunk = ChunkedMediaFileFormat::decryptChunk(m_header, m_key, m_nonce, chunkIndex, chunkIndex == (m_chunkCount - 1), encryptedChunk);
+				m_cachedChunkIndex = chunkIndex;
+				return m_cachedChunk;
+			}
+
+			QByteArray ChunkedMediaFileReader::read(qint64 offset, qint64 maxLength) {
+				QByteArray result;
+				if ((offset < 0) || (offset >= m_size) || (maxLength <= 0)) {
+					return result;
+				}
+
+				qint64 const length = std::min(maxLength, m_size - offset);
+				result.reserve(static_cast<int>(length));
+				qint64 position = offset;
+				while (position < (offset + length)) {
+					qint64 const chunkIndex = position / m_chunkSize;
+					int const offsetInChunk = static_cast<int>(position % m_chunkSize);
+					QByteArray const chunk = readChunk(chunkIndex);
+					int const bytesToCopy = static_cast<int>(std::min<qint64>(chunk.size() - offsetInChunk, (offset + length) - position));
+					if (bytesToCopy <= 0) {
+						throw openmittsu::exceptions::InternalErrorException() << "Chunk " << chunkIndex << " of media file \"" << m_file.fileName().toStdString() << "\" is shorter than expected.";
+					}
+					result.append(chunk.constData() + offsetInChunk, bytesToCopy);
+					position += bytesToCopy;
+				}
+
+				return result;
+			}
+
+		}
+	}
+}
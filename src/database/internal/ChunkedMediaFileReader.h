@@ -0,0 +1,52 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEREADER_H_
+#define OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEREADER_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Random access to a media file in the chunked format described by ChunkedMediaFileFormat.
+			 * Only the chunks touched by a read are loaded and decrypted, the most recently decrypted chunk is kept for sequential reads.
+			 */
+			class ChunkedMediaFileReader {
+			public:
+				ChunkedMediaFileReader(QString const& fileName, QByteArray const& key, QByteArray const& nonce);
+				virtual ~ChunkedMediaFileReader();
+
+				/** Returns false if the file can not be opened or has no valid header. */
+				bool open();
+				void close();
+
+				qint64 getSize() const;
+				int getChunkSize() const;
+				qint64 getChunkCount() const;
+
+				/** Throws an InternalErrorException if the chunk does not authenticate. */
+				QByteArray readChunk(qint64 chunkIndex);
+
+				/** Reads up to maxLength bytes starting at offset, shorter only at the end of the data. */
+				QByteArray read(qint64 offset, qint64 maxLength);
+			private:
+				QFile m_file;
+				QByteArray const m_key;
+				QByteArray const m_nonce;
+				QByteArray m_header;
+				int m_chunkSize;
+				qint64 m_chunkCount;
+				qint64 m_size;
+
+				qint64 m_cachedChunkIndex;
+				QByteArray m_cachedChunk;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEREADER_H_
@@ -0,0 +1,93 @@
+#include "src/database/internal/ChunkedMediaFileWriter.h"
+
+#include "src/crypto/Crc32.h"
+#include "src/database/internal/ChunkedMediaFileFormat.h"
+#include "src/exceptions/InternalErrorException.h"
+#include "src/utility/FileSync.h"
+
+#include <algorithm>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			ChunkedMediaFileWriter::ChunkedMediaFileWriter(QString const& fileName, QByteArray const& key, QByteArray const& nonce, int chunkSize) : m_file(fileName), m_key(key), m_nonce(nonce), m_chunkSize((chunkSize > 0) ? chunkSize : ChunkedMediaFileFormat::getDefaultChunkSize()), m_header(ChunkedMediaFileFormat::buildHeader(m_chunkSize)), m_buffer(), m_chunkIndex(0), m_size(0), m_checksum(0), m_isFinished(false) {
+				//
+			}
+
+			ChunkedMediaFileWriter::~ChunkedMediaFileWriter() {
+				if (!m_isFinished && m_file.isOpen()) {
+					m_file.close();
+					m_file.remove();
+				}
+			}
+
+			void ChunkedMediaFileWriter::open() {
+				if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not open media file \"" << m_file.fileName().toStdString() << "\" for writing.";
+				}
+				m_buffer.reserve(m_chunkSize);
+				writeRaw(m_header);
+			}
+
+			void ChunkedMediaFileWriter::write(QByteArray const& data) {
+				write(data.constData(), data.size());
+			}
+
+			void ChunkedMediaFileWriter::write(char const* data, qint64 length) {
+				if (m_isFinished || !m_file.isOpen()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Can not write to media file \"" << m_file.fileName().toStdString() << "\", it is not open.";
+				}
+
+				m_checksum = openmittsu::crypto::Crc32::update(m_checksum, data, static_cast<size_t>(length));
+				m_size += length;
+				while (length > 0) {
+					// A full buffer is only flushed once more data arrives, as the last chunk has to be marked as final.
+					if (m_buffer.size() == m_chunkSize) {
+						writeChunk(false);
+					}
+
+					int const bytesToCopy = static_cast<int>(std::min<qint64>(length, m_chunkSize - m_buffer.size()));
+					m_buffer.append(data, bytesToCopy);
+					data += bytesToCopy;
+					length -= bytesToCopy;
+				}
+			}
+
+			void ChunkedMediaFileWriter::finish() {
+				if (m_isFinished || !m_file.isOpen()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Can not finish media file \"" << m_file.fileName().toStdString() << "\", it is not open.";
+				}
+
+				writeChunk(true);
+				if (!openmittsu::utility::FileSync::syncFile(m_file)) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not flush media file \"" << m_file.fileName().toStdString() << "\" to disk.";
+				}
+				m_file.close();
+				m_isFinished = true;
+			}
+
+			qint64 ChunkedMediaFileWriter::getSize() const {
+				return m_size;
+			}
+
+			uint32_t ChunkedMediaFileWriter::getChecksum() const {
+				return m_checksum;
+			}
+
+			void ChunkedMediaFileWriter::writeChunk(bool isFinalChunk) {
+				writeRaw(ChunkedMediaFileFormat::encryptChunk(m_header, m_key, m_nonce, m_chunkIndex, isFinalChunk, m_buffer.constData(), m_buffer.size()));
+				++m_chunkIndex;
+				m_buffer.resize(0);
+			}
+
+			void ChunkedMediaFileWriter::writeRaw(QByteArray const& data) {
+				qint64 const writtenBytes = m_file.write(data);
+				if (writtenBytes != data.size()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not write media file \"" << m_file.fileName().toStdString() << "\" (size missmatch, " << writtenBytes << " vs. " << data.size() << " Bytes).";
+				}
+			}
+
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEWRITER_H_
+#define OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEWRITER_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include <cstdint>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Writes a media file in the chunked format described by ChunkedMediaFileFormat.
+			 * At most one chunk of plaintext is buffered. A file that was not completed with finish() is removed on destruction.
+			 * finish() syncs the file to disk, so it can be renamed into place afterwards without risking an empty file after a crash.
+			 */
+			class ChunkedMediaFileWriter {
+			public:
+				ChunkedMediaFileWriter(QString const& fileName, QByteArray const& key, QByteArray const& nonce, int chunkSize = 0);
+				virtual ~ChunkedMediaFileWriter();
+
+				void open();
+				void write(QByteArray const& data);
+				void write(char const* data, qint64 length);
+				void finish();
+
+				qint64 getSize() const;
+				uint32_t getChecksum() const;
+			private:
+				QFile m_file;
+				QByteArray const m_key;
+				QByteArray const m_nonce;
+				int const m_chunkSize;
+				QByteArray const m_header;
+				QByteArray m_buffer;
+				qint64 m_chunkIndex;
+				qint64 m_size;
+				uint32_t m_checksum;
+				bool m_isFinished;
+
+				void writeChunk(bool isFinalChunk);
+				void writeRaw(QByteArray const& data);
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_CHUNKEDMEDIAFILEWRITER_H_
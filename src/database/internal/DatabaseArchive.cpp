@@ -0,0 +1,345 @@
+#include "src/database/internal/DatabaseArchive.h"
+
+#include "src/database/internal/DatabaseUtilities.h"
+#include "src/database/internal/InternalDatabaseInterface.h"
+#include "src/exceptions/InternalErrorException.h"
+#include "src/utility/Logging.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTextStream>
+#include <QVariant>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			namespace {
+				struct ArchivedTable {
+					char const* tableName;
+					char const* resourceName;
+					int version;
+				};
+
+				// Versions of the archive tables, created by CreateArchive.sql. A change to one of the mirrored main tables needs the same change here,
+				// as a new version with an UpdateArchive<resourceName>ToVersion<version>.sql resource written against the `archive` schema.
+				ArchivedTable const archivedTables[] = {
+					{ "contact_messages", "ContactMessages", 2 },
+					{ "group_messages", "GroupMessages", 2 },
+					{ "media", "Media", 2 }
+				};
+
+				// The message tables in the order they are archived. A cursor names the table and the last visited (`sort_by`, `uid`) position in it.
+				char const* const archivedMessageTables[] = { "contact_messages", "group_messages" };
+				QChar const cursorSeparator = QLatin1Char('|');
+			}
+
+			DatabaseArchive::DatabaseArchive(InternalDatabaseInterface* database, QString const& archiveFileName) : m_database(database), m_archiveFileName(archiveFileName), m_isAttached(false), m_archiveAgeInDays(getDefaultArchiveAgeInDays()) {
+				//
+			}
+
+			DatabaseArchive::~DatabaseArchive() {
+				// Intentionally left empty.
+			}
+
+			QString DatabaseArchive::getArchiveFileName(QString const& databaseFileName) {
+				return databaseFileName + QStringLiteral(".archive");
+			}
+
+			QString DatabaseArchive::getMainSchemaName() {
+				return QStringLiteral("main");
+			}
+
+			QString DatabaseArchive::getArchiveSchemaName() {
+				return QStringLiteral("archive");
+			}
+
+			int DatabaseArchive::getDefaultArchiveAgeInDays() {
+				return 365;
+			}
+
+			bool DatabaseArchive::isAttached() const {
+				return m_isAttached;
+			}
+
+			QStringList DatabaseArchive::getSchemas() const {
+				if (m_isAttached) {
+					return QStringList({ getMainSchemaName(), getArchiveSchemaName() });
+				}
+				return QStringList({ getMainSchemaName() });
+			}
+
+			int DatabaseArchive::getArchiveAgeInDays() const {
+				return m_archiveAgeInDays;
+			}
+
+			void DatabaseArchive::setArchiveAgeInDays(int days) {
+				m_archiveAgeInDays = days;
+			}
+
+			void DatabaseArchive::attachIfPresent() {
+				if ((!m_isAttached) && QFileInfo::exists(m_archiveFileName)) {
+					attach();
+				}
+			}
+
+			void DatabaseArchive::attach() {
+				if (m_isAttached) {
+					return;
+				}
+
+				bool const isNewArchive = !QFileInfo::exists(m_archiveFileName);
+				QSqlQuery query(m_database->getQueryObject());
+				// Without an explicit KEY clause, SQLCipher encrypts the attached database with the key of the main database.
+				query.prepare(QStringLiteral("ATTACH DATABASE :fileName AS `%1`;").arg(getArchiveSchemaName()));
+				query.bindValue(QStringLiteral(":fileName"), QVariant(m_archiveFileName));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not attach archive database \"" << m_archiveFileName.toStdString() << "\". Query error: " << query.lastError().text().toStdString();
+				}
+				m_isAttached = true;
+
+				if (isNewArchive) {
+					LOGGER()->info("Created new message archive database \"{}\".", m_archiveFileName.toStdString());
+					if (!query.exec(QStringLiteral("PRAGMA `%1`.auto_vacuum = INCREMENTAL;").arg(getArchiveSchemaName()))) {
+						LOGGER()->warn("Could not enable incremental auto vacuum on archive database. Query error: {}", query.lastError().text().toStdString());
+					}
+				}
+
+				QFile sqlFile(QStringLiteral(":/sql/CreateArchive.sql"));
+				if (!sqlFile.exists() || !sqlFile.open(QFile::ReadOnly)) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not find or open the file \"" << sqlFile.fileName().toStdString() << "\" containg the archive create statements from resources.";
+				}
+				QTextStream fileStream(&sqlFile);
+				QStringList const createQueries = fileStream.readAll().split(QStringLiteral("__OPENMITTSU_QUERY_SEP__"), QString::SplitBehavior::SkipEmptyParts);
+				sqlFile.close();
+
+				auto it = createQueries.constBegin();
+				auto const end = createQueries.constEnd();
+				for (; it != end; ++it) {
+					if (!query.exec(*it)) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not create archive tables. Query error: " << query.lastError().text().toStdString();
+					}
+				}
+
+				createOrUpdateTables();
+			}
+
+			void DatabaseArchive::createOrUpdateTables() {
+				for (ArchivedTable const& table : archivedTables) {
+					QString const tableName = QString::fromLatin1(table.tableName);
+					int currentVersion = getTableVersion(tableName);
+					if (currentVersion == 0) {
+						// Just created, or created before the archive kept versions. Both have the layout of version 1.
+						currentVersion = 1;
+						setTableVersion(tableName, currentVersion);
+					}
+
+					if (currentVersion > table.version) {
+						throw openmittsu::exceptions::InternalErrorException() << "Archive table " << tableName.toStdString() << " has version " << currentVersion << ", but only version " << table.version << " is supported.";
+					} else if (currentVersion == table.version) {
+						continue;
+					}
+
+					LOGGER()->info("Upgrading archive table {} from version {} to version {}...", tableName.toStdString(), currentVersion, table.version);
+					if (!m_database->transactionStart()) {
+						LOGGER()->warn("DatabaseArchive: Could NOT start transaction!");
+					}
+					try {
+						QSqlQuery query(m_database->getQueryObject());
+						for (int toVersion = currentVersion + 1; toVersion <= table.version; ++toVersion) {
+							for (QString const& statement : getUpdateStatements(QString::fromLatin1(table.resourceName), toVersion)) {
+								if (!query.exec(statement)) {
+									throw openmittsu::exceptions::InternalErrorException() << "Could not update archive table " << tableName.toStdString() << " to version " << toVersion << ". Query error: " << query.lastError().text().toStdString();
+								}
+							}
+						}
+						setTableVersion(tableName, table.version);
+					} catch (...) {
+						m_database->transactionRollback();
+						throw;
+					}
+					if (!m_database->transactionCommit()) {
+						LOGGER()->warn("DatabaseArchive: Could NOT commit transaction!");
+					}
+				}
+			}
+
+			int DatabaseArchive::getTableVersion(QString const& tableName) const {
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `version` FROM %1 WHERE `table_name` = :tableName;").arg(DatabaseUtilities::getQualifiedTableName(getArchiveSchemaName(), QStringLiteral("table_versions"))));
+				query.bindValue(QStringLiteral(":tableName"), QVariant(tableName));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not query the version of archive table " << tableName.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				}
+				return query.next() ? query.value(0).toInt() : 0;
+			}
+
+			void DatabaseArchive::setTableVersion(QString const& tableName, int version) {
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("INSERT OR REPLACE INTO %1 (`table_name`, `version`) VALUES (:tableName, :version);").arg(DatabaseUtilities::getQualifiedTableName(getArchiveSchemaName(), QStringLiteral("table_versions"))));
+				query.bindValue(QStringLiteral(":tableName"), QVariant(tableName));
+				query.bindValue(QStringLiteral(":version"), QVariant(version));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not set the version of archive table " << tableName.toStdString() << " to " << version << ". Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+			QStringList DatabaseArchive::getUpdateStatements(QString const& resourceName, int toVersion) {
+				QFile sqlFile(QStringLiteral(":/sql/UpdateArchive%1ToVersion%2.sql").arg(resourceName).arg(toVersion));
+				if (!sqlFile.exists() || !sqlFile.open(QFile::ReadOnly)) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not find or open the file \"" << sqlFile.fileName().toStdString() << "\" containg the archive update statements from resources.";
+				}
+				QTextStream fileStream(&sqlFile);
+				return fileStream.readAll().split(QStringLiteral("__OPENMITTSU_QUERY_SEP__"), QString::SplitBehavior::SkipEmptyParts);
+			}
+
+			QStringList DatabaseArchive::getColumns(QString const& tableName) const {
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.exec(QStringLiteral("PRAGMA `%1`.table_info(`%2`);").arg(getArchiveSchemaName()).arg(tableName))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read the columns of archive table " << tableName.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				}
+
+				QStringList result;
+				while (query.next()) {
+					result.append(QStringLiteral("`%1`").arg(query.value(QStringLiteral("name")).toString()));
+				}
+				if (result.isEmpty()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Archive table " << tableName.toStdString() << " has no columns.";
+				}
+				return result;
+			}
+
+			int DatabaseArchive::archiveMessages(openmittsu::protocol::MessageTime const& olderThan, int maxMessageCount, QString& cursor) {
+				int const tableCount = static_cast<int>(sizeof(archivedMessageTables) / sizeof(archivedMessageTables[0]));
+				int tableIndex = 0;
+				qint64 startSortBy = 0;
+				QString startUuid;
+				if (!cursor.isEmpty()) {
+					QStringList const parts = cursor.split(cursorSeparator);
+					while ((tableIndex < tableCount) && (parts.at(0) != QLatin1String(archivedMessageTables[tableIndex]))) {
+						++tableIndex;
+					}
+					if ((tableIndex < tableCount) && (parts.size() == 3)) {
+						startSortBy = parts.at(1).toLongLong();
+						startUuid = parts.at(2);
+					} else if (tableIndex >= tableCount) {
+						LOGGER()->warn("Ignoring invalid archive cursor \"{}\".", cursor.toStdString());
+						tableIndex = 0;
+					}
+				}
+
+				QString const tableName = QString::fromLatin1(archivedMessageTables[tableIndex]);
+				bool isTableDone = false;
+				int const archivedMessages = archiveMessagesFromTable(tableName, olderThan, maxMessageCount, startSortBy, startUuid, isTableDone);
+				if (!isTableDone) {
+					cursor = QStringList({ tableName, QString::number(startSortBy), startUuid }).join(cursorSeparator);
+				} else if ((tableIndex + 1) < tableCount) {
+					cursor = QString::fromLatin1(archivedMessageTables[tableIndex + 1]);
+				} else {
+					cursor.clear();
+				}
+				return archivedMessages;
+			}
+
+			int DatabaseArchive::archiveMessagesFromTable(QString const& tableName, openmittsu::protocol::MessageTime const& olderThan, int maxMessageCount, qint64& startSortBy, QString& startUuid, bool& isTableDone) {
+				QString const mainTable = DatabaseUtilities::getQualifiedTableName(getMainSchemaName(), tableName);
+				QString const archiveTable = DatabaseUtilities::getQualifiedTableName(getArchiveSchemaName(), tableName);
+				QString const mainMedia = DatabaseUtilities::getQualifiedTableName(getMainSchemaName(), QStringLiteral("media"));
+				QString const archiveMedia = DatabaseUtilities::getQualifiedTableName(getArchiveSchemaName(), QStringLiteral("media"));
+
+				QStringList uuids;
+				int visitedMessages = 0;
+				qint64 lastSortBy = startSortBy;
+				QString lastUuid = startUuid;
+				{
+					// A range scan over the (`sort_by`, `uid`) index created by CreateContactMessages.sql and CreateGroupMessages.sql, starting after the cursor.
+					bool const hasStart = !startUuid.isEmpty();
+					QString const startCondition = hasStart ? QStringLiteral(" AND `sort_by` >= :startSortBy AND (`sort_by` > :startSortByExclusive OR `uid` > :startUuid)") : QString();
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `uid`, `sort_by`, `is_outbox`, `is_sent` FROM %1 WHERE `sort_by` < :olderThan%2 ORDER BY `sort_by` ASC, `uid` ASC LIMIT :limit;").arg(mainTable).arg(startCondition));
+					query.bindValue(QStringLiteral(":olderThan"), QVariant(olderThan.getMessageTimeMSecs()));
+					if (hasStart) {
+						query.bindValue(QStringLiteral(":startSortBy"), QVariant(startSortBy));
+						query.bindValue(QStringLiteral(":startSortByExclusive"), QVariant(startSortBy));
+						query.bindValue(QStringLiteral(":startUuid"), QVariant(startUuid));
+					}
+					query.bindValue(QStringLiteral(":limit"), QVariant(maxMessageCount));
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute archive candidate query for table " << tableName.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						++visitedMessages;
+						lastUuid = query.value(QStringLiteral("uid")).toString();
+						lastSortBy = query.value(QStringLiteral("sort_by")).toLongLong();
+						if ((query.value(QStringLiteral("is_outbox")).toInt() == 0) || (query.value(QStringLiteral("is_sent")).toInt() == 1)) {
+							uuids.append(lastUuid);
+						}
+					}
+				}
+
+				// The position only advances once the visited messages were moved, a failed move visits them again.
+				isTableDone = visitedMessages < maxMessageCount;
+				if (uuids.isEmpty()) {
+					startSortBy = lastSortBy;
+					startUuid = lastUuid;
+					return 0;
+				}
+
+				// Attaching is not possible within a transaction.
+				attach();
+
+				// Copied by name, so the column order of the two tables does not matter. A message can not be in both tiers, a conflict fails and rolls back the batch.
+				QString const messageColumns = getColumns(tableName).join(QStringLiteral(", "));
+				QString const mediaColumns = getColumns(QStringLiteral("media")).join(QStringLiteral(", "));
+
+				if (!m_database->transactionStart()) {
+					LOGGER()->warn("DatabaseArchive: Could NOT start transaction!");
+				}
+
+				// Messages and their media are moved together or not at all, nothing may remain half moved between the two files.
+				try {
+					QSqlQuery copyMessageQuery(m_database->getQueryObject());
+					copyMessageQuery.prepare(QStringLiteral("INSERT INTO %1 (%2) SELECT %2 FROM %3 WHERE `uid` = :uid;").arg(archiveTable).arg(messageColumns).arg(mainTable));
+					QSqlQuery copyMediaQuery(m_database->getQueryObject());
+					copyMediaQuery.prepare(QStringLiteral("INSERT INTO %1 (%2) SELECT %2 FROM %3 WHERE `uid` = :uid;").arg(archiveMedia).arg(mediaColumns).arg(mainMedia));
+					QSqlQuery deleteMediaQuery(m_database->getQueryObject());
+					deleteMediaQuery.prepare(QStringLiteral("DELETE FROM %1 WHERE `uid` = :uid;").arg(mainMedia));
+					QSqlQuery deleteMessageQuery(m_database->getQueryObject());
+					deleteMessageQuery.prepare(QStringLiteral("DELETE FROM %1 WHERE `uid` = :uid;").arg(mainTable));
+
+					auto it = uuids.constBegin();
+					auto const end = uuids.constEnd();
+					for (; it != end; ++it) {
+						QVariant const uuid(*it);
+						copyMessageQuery.bindValue(QStringLiteral(":uid"), uuid);
+						copyMediaQuery.bindValue(QStringLiteral(":uid"), uuid);
+						deleteMediaQuery.bindValue(QStringLiteral(":uid"), uuid);
+						deleteMessageQuery.bindValue(QStringLiteral(":uid"), uuid);
+						if (!copyMessageQuery.exec() || !copyMediaQuery.exec() || !deleteMediaQuery.exec() || !deleteMessageQuery.exec()) {
+							throw openmittsu::exceptions::InternalErrorException() << "Could not move message " << it->toStdString() << " from table " << tableName.toStdString() << " to the archive.";
+						}
+					}
+				} catch (...) {
+					if (!m_database->transactionRollback()) {
+						LOGGER()->warn("DatabaseArchive: Could NOT roll back transaction!");
+					}
+					throw;
+				}
+
+				if (!m_database->transactionCommit()) {
+					m_database->transactionRollback();
+					throw openmittsu::exceptions::InternalErrorException() << "Could not commit moving " << uuids.size() << " messages from table " << tableName.toStdString() << " to the archive.";
+				}
+
+				LOGGER_DEBUG("Moved {} messages from table {} to the archive.", uuids.size(), tableName.toStdString());
+				startSortBy = lastSortBy;
+				startUuid = lastUuid;
+				return uuids.size();
+			}
+
+		}
+	}
+}
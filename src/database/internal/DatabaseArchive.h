@@ -0,0 +1,73 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_DATABASEARCHIVE_H_
+#define OPENMITTSU_DATABASE_INTERNAL_DATABASEARCHIVE_H_
+
+#include <QString>
+#include <QStringList>
+
+#include "src/protocol/MessageTime.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+			class InternalDatabaseInterface;
+
+			/**
+			 * Cold storage tier for old conversation history.
+			 *
+			 * The archive is a second database file attached to the main connection under the schema name "archive". It holds the same contact_messages,
+			 * group_messages and media tables as the main database. Messages older than the configured age are moved over together with their media entries,
+			 * while the encrypted media files stay where they are. Readers query the hot tier first and then the archive, see InternalDatabaseInterface::getMessageStorageSchemas().
+			 * The archive tables carry their own versions and are upgraded when the archive is attached, like the tables of the main database.
+			 */
+			class DatabaseArchive {
+			public:
+				DatabaseArchive(InternalDatabaseInterface* database, QString const& archiveFileName);
+				virtual ~DatabaseArchive();
+
+				bool isAttached() const;
+
+				/** Attaches the archive if its file already exists. New archives are only created once the first message is archived. */
+				void attachIfPresent();
+
+				QStringList getSchemas() const;
+
+				/** Messages older than this many days are moved to the archive, zero or less disables archiving. Set from the user options by the database. */
+				int getArchiveAgeInDays() const;
+				void setArchiveAgeInDays(int days);
+
+				/**
+				 * Moves the oldest messages created before olderThan into the archive, visiting at most maxMessageCount messages after the cursor.
+				 * Outgoing messages that have not been sent yet are never archived, the cursor moves past them so later calls do not visit them again.
+				 * An empty cursor starts at the oldest message, the cursor is empty again once all messages were visited. Returns the number of archived messages.
+				 */
+				int archiveMessages(openmittsu::protocol::MessageTime const& olderThan, int maxMessageCount, QString& cursor);
+
+				static QString getArchiveFileName(QString const& databaseFileName);
+				static QString getMainSchemaName();
+				static QString getArchiveSchemaName();
+				static int getDefaultArchiveAgeInDays();
+			private:
+				InternalDatabaseInterface* const m_database;
+				QString const m_archiveFileName;
+				bool m_isAttached;
+				int m_archiveAgeInDays;
+
+				void attach();
+				/** Visits the messages following (startSortBy, startUuid) in the `sort_by` index of the table and advances the position to the last one visited. */
+				int archiveMessagesFromTable(QString const& tableName, openmittsu::protocol::MessageTime const& olderThan, int maxMessageCount, qint64& startSortBy, QString& startUuid, bool& isTableDone);
+
+				/** Brings the archive tables to the versions of this build, see the comment on the table list. Versions are kept in the table_versions table of the archive. */
+				void createOrUpdateTables();
+				int getTableVersion(QString const& tableName) const;
+				void setTableVersion(QString const& tableName, int version);
+				static QStringList getUpdateStatements(QString const& resourceName, int toVersion);
+
+				/** The columns of the archived table, which are copied by name so their order in the main and the archive table does not matter. */
+				QStringList getColumns(QString const& tableName) const;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_DATABASEARCHIVE_H_
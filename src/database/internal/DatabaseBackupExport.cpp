@@ -0,0 +1,128 @@
+#include "src/database/internal/DatabaseBackupExport.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include "src/backup/ContactBackupObject.h"
+#include "src/backup/GroupBackupObject.h"
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/database/MediaFileType.h"
+#include "src/database/internal/DatabaseUtilities.h"
+#include "src/dataproviders/messages/ContactMessageType.h"
+#include "src/dataproviders/messages/GroupMessageType.h"
+#include "src/dataproviders/messages/UserMessageState.h"
+#include "src/exceptions/InternalErrorException.h"
+#include "src/protocol/ContactIdList.h"
+#include "src/protocol/GroupId.h"
+#include "src/protocol/MessageId.h"
+#include "src/protocol/MessageTime.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			using namespace openmittsu::dataproviders::messages;
+
+			QList<openmittsu::backup::ContactBackupObject> DatabaseBackupExport::getContacts(InternalDatabaseInterface const* database, openmittsu::protocol::ContactId const& selfContact) {
+				QSqlQuery query(database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `identity`, `publickey`, `verification`, `firstname`, `lastname`, `nick_name`, `color` FROM `contacts` WHERE `identity` != :selfContact ORDER BY `identity` ASC;"));
+				query.bindValue(QStringLiteral(":selfContact"), QVariant(selfContact.toQString()));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read contacts for a backup. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QList<openmittsu::backup::ContactBackupObject> result;
+				while (query.next()) {
+					result.append(openmittsu::backup::ContactBackupObject(openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString()), openmittsu::crypto::PublicKey::fromHexString(query.value(QStringLiteral("publickey")).toString()),
+						openmittsu::protocol::ContactIdVerificationStatusHelper::fromQString(query.value(QStringLiteral("verification")).toString()), query.value(QStringLiteral("firstname")).toString(), query.value(QStringLiteral("lastname")).toString(),
+						query.value(QStringLiteral("nick_name")).toString(), query.value(QStringLiteral("color")).toInt()));
+				}
+				return result;
+			}
+
+			QList<openmittsu::backup::GroupBackupObject> DatabaseBackupExport::getGroups(InternalDatabaseInterface const* database) {
+				QSqlQuery query(database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `id`, `creator`, `groupname`, `created_at`, `members`, `is_deleted` FROM `groups` ORDER BY `creator` ASC, `id` ASC;"));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read groups for a backup. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QList<openmittsu::backup::GroupBackupObject> result;
+				while (query.next()) {
+					openmittsu::protocol::GroupId const group(openmittsu::protocol::ContactId(query.value(QStringLiteral("creator")).toString()), query.value(QStringLiteral("id")).toString());
+					result.append(openmittsu::backup::GroupBackupObject(group, query.value(QStringLiteral("groupname")).toString(), openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("created_at")).toLongLong()),
+						openmittsu::protocol::ContactIdList::fromString(query.value(QStringLiteral("members")).toString()).getContactIds(), query.value(QStringLiteral("is_deleted")).toBool()));
+				}
+				return result;
+			}
+
+			QList<openmittsu::backup::ContactMessageBackupObject> DatabaseBackupExport::getContactMessages(InternalDatabaseInterface const* database, QString const& schema, qint64 startAfterRowId, int maxCount, qint64& lastRowId) {
+				QSqlQuery query(database->getQueryObject());
+				query.setForwardOnly(true);
+				query.prepare(QStringLiteral("SELECT `rowid` AS `row_id`, `identity`, `apiid`, `uid`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `created_at`, `sent_at`, `received_at`, `modified_at`, `contact_message_type`, `body`, `is_statusmessage`, `is_queued`, `caption` FROM %1 WHERE `rowid` > :cursor ORDER BY `rowid` ASC LIMIT :limit;").arg(DatabaseUtilities::getQualifiedTableName(schema, QStringLiteral("contact_messages"))));
+				query.bindValue(QStringLiteral(":cursor"), QVariant(startAfterRowId));
+				query.bindValue(QStringLiteral(":limit"), QVariant(maxCount));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read contact messages for a backup. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QList<openmittsu::backup::ContactMessageBackupObject> result;
+				lastRowId = startAfterRowId;
+				while (query.next()) {
+					lastRowId = query.value(QStringLiteral("row_id")).toLongLong();
+					result.append(openmittsu::backup::ContactMessageBackupObject(openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString()), openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString()), query.value(QStringLiteral("uid")).toString(),
+						query.value(QStringLiteral("is_outbox")).toBool(), query.value(QStringLiteral("is_read")).toBool(), query.value(QStringLiteral("is_saved")).toBool(), UserMessageStateHelper::fromString(query.value(QStringLiteral("messagestate")).toString()),
+						openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("created_at")).toLongLong()), openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("sent_at")).toLongLong()),
+						openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("received_at")).toLongLong()), openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("modified_at")).toLongLong()),
+						ContactMessageTypeHelper::fromString(query.value(QStringLiteral("contact_message_type")).toString()), query.value(QStringLiteral("body")).toString(), query.value(QStringLiteral("is_statusmessage")).toBool(), query.value(QStringLiteral("is_queued")).toBool(), query.value(QStringLiteral("caption")).toString()));
+				}
+				return result;
+			}
+
+			QList<openmittsu::backup::GroupMessageBackupObject> DatabaseBackupExport::getGroupMessages(InternalDatabaseInterface const* database, QString const& schema, qint64 startAfterRowId, int maxCount, qint64& lastRowId) {
+				QSqlQuery query(database->getQueryObject());
+				query.setForwardOnly(true);
+				query.prepare(QStringLiteral("SELECT `rowid` AS `row_id`, `group_id`, `group_creator`, `identity`, `apiid`, `uid`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `created_at`, `sent_at`, `received_at`, `modified_at`, `group_message_type`, `body`, `is_statusmessage`, `is_queued`, `caption` FROM %1 WHERE `rowid` > :cursor ORDER BY `rowid` ASC LIMIT :limit;").arg(DatabaseUtilities::getQualifiedTableName(schema, QStringLiteral("group_messages"))));
+				query.bindValue(QStringLiteral(":cursor"), QVariant(startAfterRowId));
+				query.bindValue(QStringLiteral(":limit"), QVariant(maxCount));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read group messages for a backup. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QList<openmittsu::backup::GroupMessageBackupObject> result;
+				lastRowId = startAfterRowId;
+				while (query.next()) {
+					lastRowId = query.value(QStringLiteral("row_id")).toLongLong();
+					openmittsu::protocol::GroupId const group(openmittsu::protocol::ContactId(query.value(QStringLiteral("group_creator")).toString()), query.value(QStringLiteral("group_id")).toString());
+					result.append(openmittsu::backup::GroupMessageBackupObject(group, openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString()), openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString()), query.value(QStringLiteral("uid")).toString(),
+						query.value(QStringLiteral("is_outbox")).toBool(), query.value(QStringLiteral("is_read")).toBool(), query.value(QStringLiteral("is_saved")).toBool(), UserMessageStateHelper::fromString(query.value(QStringLiteral("messagestate")).toString()),
+						openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("created_at")).toLongLong()), openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("sent_at")).toLongLong()),
+						openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("received_at")).toLongLong()), openmittsu::protocol::MessageTime::fromDatabase(query.value(QStringLiteral("modified_at")).toLongLong()),
+						GroupMessageTypeHelper::fromString(query.value(QStringLiteral("group_message_type")).toString()), query.value(QStringLiteral("body")).toString(), query.value(QStringLiteral("is_statusmessage")).toBool(), query.value(QStringLiteral("is_queued")).toBool(), query.value(QStringLiteral("caption")).toString()));
+				}
+				return result;
+			}
+
+			QStringList DatabaseBackupExport::getMediaItemUuids(InternalDatabaseInterface const* database, bool isGroupMedia, QString const& startAfterUuid, int maxCount) {
+				QSqlQuery query(database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `m`.`uid` AS `uid` FROM %1 AS `m` WHERE `m`.`type` = :type AND `m`.`uid` > :cursor AND %2 EXISTS (SELECT 1 FROM %3 AS `g` WHERE `g`.`uid` = `m`.`uid`) ORDER BY `m`.`uid` ASC LIMIT :limit;")
+					.arg(DatabaseUtilities::getTableInAllSchemas(database, QStringLiteral("media"))).arg(isGroupMedia ? QString() : QStringLiteral("NOT")).arg(DatabaseUtilities::getTableInAllSchemas(database, QStringLiteral("group_messages"))));
+				query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(MediaFileType::TYPE_STANDARD)));
+				query.bindValue(QStringLiteral(":cursor"), QVariant(startAfterUuid));
+				query.bindValue(QStringLiteral(":limit"), QVariant(maxCount));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read media items for a backup. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QStringList result;
+				while (query.next()) {
+					result.append(query.value(QStringLiteral("uid")).toString());
+				}
+				return result;
+			}
+
+		}
+	}
+}
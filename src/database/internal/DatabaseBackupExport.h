@@ -0,0 +1,44 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_DATABASEBACKUPEXPORT_H_
+#define OPENMITTSU_DATABASE_INTERNAL_DATABASEBACKUPEXPORT_H_
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include "src/database/internal/InternalDatabaseInterface.h"
+#include "src/protocol/ContactId.h"
+
+namespace openmittsu {
+	namespace backup {
+		class ContactBackupObject;
+		class GroupBackupObject;
+		class ContactMessageBackupObject;
+		class GroupMessageBackupObject;
+	}
+
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Reads the data written to a data backup, the counterpart of the insert*FromBackup() functions.
+			 * Messages are read in pages in row order of one storage schema, which needs neither an index nor a sort, so every page is a short query.
+			 */
+			class DatabaseBackupExport {
+			public:
+				static QList<openmittsu::backup::ContactBackupObject> getContacts(InternalDatabaseInterface const* database, openmittsu::protocol::ContactId const& selfContact);
+				static QList<openmittsu::backup::GroupBackupObject> getGroups(InternalDatabaseInterface const* database);
+
+				/** At most maxCount messages of schema with a row id larger than startAfterRowId. The row id of the last one is stored in lastRowId. */
+				static QList<openmittsu::backup::ContactMessageBackupObject> getContactMessages(InternalDatabaseInterface const* database, QString const& schema, qint64 startAfterRowId, int maxCount, qint64& lastRowId);
+				static QList<openmittsu::backup::GroupMessageBackupObject> getGroupMessages(InternalDatabaseInterface const* database, QString const& schema, qint64 startAfterRowId, int maxCount, qint64& lastRowId);
+
+				/** At most maxCount uuids of full-size media items after startAfterUuid in uuid order, either of those belonging to a group message or of all others. */
+				static QStringList getMediaItemUuids(InternalDatabaseInterface const* database, bool isGroupMedia, QString const& startAfterUuid, int maxCount);
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_DATABASEBACKUPEXPORT_H_
@@ -0,0 +1,105 @@
+#include "src/database/internal/DatabaseBackupImportJournal.h"
+
+#include <QVariant>
+#include <QVariantList>
+
+#include "src/exceptions/InternalErrorException.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			QHash<QString, BackupImportCheckpoint> DatabaseBackupImportJournal::getCheckpoints(InternalDatabaseInterface const* database) {
+				QSqlQuery query(database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `file_name`, `offset`, `is_complete` FROM `backup_import_journal`;"));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not query the backup import journal. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QHash<QString, BackupImportCheckpoint> result;
+				while (query.next()) {
+					BackupImportCheckpoint const checkpoint = { query.value(QStringLiteral("file_name")).toString(), query.value(QStringLiteral("offset")).toLongLong(), query.value(QStringLiteral("is_complete")).toBool() };
+					result.insert(checkpoint.fileName, checkpoint);
+				}
+				return result;
+			}
+
+			QString DatabaseBackupImportJournal::getFingerprint(InternalDatabaseInterface const* database) {
+				QSqlQuery query(database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT DISTINCT `fingerprint` FROM `backup_import_journal`;"));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not query the fingerprint of the backup import journal. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QString result;
+				if (query.next()) {
+					result = query.value(QStringLiteral("fingerprint")).toString();
+					if (query.next()) {
+						throw openmittsu::exceptions::InternalErrorException() << "The backup import journal holds checkpoints of more than one backup.";
+					}
+				}
+				return result;
+			}
+
+			void DatabaseBackupImportJournal::start(InternalDatabaseInterface* database, QString const& fingerprint, QStringList const& fileNames) {
+				clear(database);
+				if (fileNames.isEmpty()) {
+					return;
+				}
+
+				QVariantList fileNameValues;
+				fileNameValues.reserve(fileNames.size());
+				QVariantList fingerprints;
+				fingerprints.reserve(fileNames.size());
+				for (QString const& fileName : fileNames) {
+					fileNameValues.append(fileName);
+					fingerprints.append(fingerprint);
+				}
+
+				QSqlQuery query(database->getQueryObject());
+				query.prepare(QStringLiteral("INSERT INTO `backup_import_journal` (`file_name`, `offset`, `is_complete`, `fingerprint`) VALUES (:fileName, 0, 0, :fingerprint);"));
+				query.bindValue(QStringLiteral(":fileName"), fileNameValues);
+				query.bindValue(QStringLiteral(":fingerprint"), fingerprints);
+				if (!query.execBatch()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not start the backup import journal. Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+			void DatabaseBackupImportJournal::storeCheckpoints(InternalDatabaseInterface* database, QList<BackupImportCheckpoint> const& checkpoints) {
+				if (checkpoints.isEmpty()) {
+					return;
+				}
+
+				QVariantList fileNames;
+				fileNames.reserve(checkpoints.size());
+				QVariantList offsets;
+				offsets.reserve(checkpoints.size());
+				QVariantList isComplete;
+				isComplete.reserve(checkpoints.size());
+				for (BackupImportCheckpoint const& checkpoint : checkpoints) {
+					fileNames.append(checkpoint.fileName);
+					offsets.append(checkpoint.offset);
+					isComplete.append(checkpoint.isComplete);
+				}
+
+				QSqlQuery query(database->getQueryObject());
+				// Updated in place, so the rows keep the fingerprint of their backup.
+				query.prepare(QStringLiteral("UPDATE `backup_import_journal` SET `offset` = :offset, `is_complete` = :isComplete WHERE `file_name` = :fileName;"));
+				query.bindValue(QStringLiteral(":fileName"), fileNames);
+				query.bindValue(QStringLiteral(":offset"), offsets);
+				query.bindValue(QStringLiteral(":isComplete"), isComplete);
+				if (!query.execBatch()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not store backup import checkpoints. Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+			void DatabaseBackupImportJournal::clear(InternalDatabaseInterface* database) {
+				QSqlQuery query(database->getQueryObject());
+				if (!query.exec(QStringLiteral("DELETE FROM `backup_import_journal`;"))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not clear the backup import journal. Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_DATABASEBACKUPIMPORTJOURNAL_H_
+#define OPENMITTSU_DATABASE_INTERNAL_DATABASEBACKUPIMPORTJOURNAL_H_
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "src/database/BackupImportCheckpoint.h"
+#include "src/database/internal/InternalDatabaseInterface.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Access to the backup_import_journal table, which holds a checkpoint for every file of a data backup while it is imported.
+			 * None of the functions start a transaction, checkpoints are written in the transaction storing the records they cover.
+			 * Every row holds the fingerprint of the backup being imported, so an import is only ever resumed with the same backup.
+			 */
+			class DatabaseBackupImportJournal {
+			public:
+				static QHash<QString, BackupImportCheckpoint> getCheckpoints(InternalDatabaseInterface const* database);
+				/** The fingerprint of the backup the journal belongs to, empty if the journal is empty. Throws if the rows disagree. */
+				static QString getFingerprint(InternalDatabaseInterface const* database);
+				/** Adds an incomplete checkpoint at the start of each file, replacing any previous journal. */
+				static void start(InternalDatabaseInterface* database, QString const& fingerprint, QStringList const& fileNames);
+				/** Updates the checkpoints of files added by start(). */
+				static void storeCheckpoints(InternalDatabaseInterface* database, QList<BackupImportCheckpoint> const& checkpoints);
+				static void clear(InternalDatabaseInterface* database);
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_DATABASEBACKUPIMPORTJOURNAL_H_
@@ -0,0 +1,98 @@
+#include "src/database/internal/DatabaseBulkInsert.h"
+
+#include <QSqlError>
+
+#include <algorithm>
+
+#include "src/exceptions/InternalErrorException.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			namespace {
+				// SQLITE_MAX_VARIABLE_NUMBER of SQLite before 3.32, which SQLCipher builds may still use.
+				int const maxParametersPerStatement = 999;
+			}
+
+			DatabaseBulkInsert::DatabaseBulkInsert(InternalDatabaseInterface* database, QString const& tableName, QStringList const& columns, bool ignoreExisting) : m_database(database), m_tableName(tableName), m_columns(columns), m_ignoreExisting(ignoreExisting),
+				m_rowsPerStatement(std::max(1, maxParametersPerStatement / std::max(1, columns.size()))), m_fullQuery(database->getQueryObject()), m_isFullQueryPrepared(false), m_values(), m_pendingRows(0), m_insertedRows(0) {
+				m_values.reserve(m_rowsPerStatement * m_columns.size());
+			}
+
+			DatabaseBulkInsert::~DatabaseBulkInsert() {
+				//
+			}
+
+			void DatabaseBulkInsert::addValue(QVariant const& value) {
+				m_values.push_back(value);
+			}
+
+			void DatabaseBulkInsert::endRow() {
+				++m_pendingRows;
+				if (m_values.size() != static_cast<std::size_t>(m_pendingRows * m_columns.size())) {
+					throw openmittsu::exceptions::InternalErrorException() << "Row " << m_pendingRows << " for table '" << m_tableName.toStdString() << "' does not have " << m_columns.size() << " values.";
+				}
+
+				if (m_pendingRows == m_rowsPerStatement) {
+					if (!m_isFullQueryPrepared) {
+						if (!m_fullQuery.prepare(createStatement(m_rowsPerStatement))) {
+							throw openmittsu::exceptions::InternalErrorException() << "Could not prepare bulk insert into '" << m_tableName.toStdString() << "'. Query error: " << m_fullQuery.lastError().text().toStdString();
+						}
+						m_isFullQueryPrepared = true;
+					}
+					execute(m_fullQuery);
+				}
+			}
+
+			void DatabaseBulkInsert::finish() {
+				if (m_pendingRows == 0) {
+					return;
+				}
+
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.prepare(createStatement(m_pendingRows))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not prepare bulk insert into '" << m_tableName.toStdString() << "'. Query error: " << query.lastError().text().toStdString();
+				}
+				execute(query);
+			}
+
+			int DatabaseBulkInsert::getInsertedRowCount() const {
+				return m_insertedRows;
+			}
+
+			QString DatabaseBulkInsert::createStatement(int rowCount) const {
+				QString placeholders(QStringLiteral("(?"));
+				for (int i = 1; i < m_columns.size(); ++i) {
+					placeholders.append(QStringLiteral(", ?"));
+				}
+				placeholders.append(QChar(')'));
+
+				QString result = QStringLiteral("%1 INTO `%2` (`%3`) VALUES ").arg(m_ignoreExisting ? QStringLiteral("INSERT OR IGNORE") : QStringLiteral("INSERT")).arg(m_tableName).arg(m_columns.join(QStringLiteral("`, `")));
+				result.reserve(result.size() + rowCount * (placeholders.size() + 2) + 1);
+				for (int i = 0; i < rowCount; ++i) {
+					if (i > 0) {
+						result.append(QStringLiteral(", "));
+					}
+					result.append(placeholders);
+				}
+				result.append(QChar(';'));
+				return result;
+			}
+
+			void DatabaseBulkInsert::execute(QSqlQuery& query) {
+				for (std::size_t i = 0; i < m_values.size(); ++i) {
+					query.bindValue(static_cast<int>(i), m_values[i]);
+				}
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not bulk insert " << m_pendingRows << " rows into '" << m_tableName.toStdString() << "'. Query error: " << query.lastError().text().toStdString();
+				}
+
+				m_insertedRows += std::max(0, query.numRowsAffected());
+				m_values.clear();
+				m_pendingRows = 0;
+			}
+
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_DATABASEBULKINSERT_H_
+#define OPENMITTSU_DATABASE_INTERNAL_DATABASEBULKINSERT_H_
+
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include <vector>
+
+#include "src/database/internal/InternalDatabaseInterface.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Inserts many rows into one table with multi-row INSERT statements and positional parameters.
+			 * The statement for a full set of rows is prepared once and reused, only the last, partial set needs a statement of its own.
+			 * Does not start a transaction, callers wrap all rows into one.
+			 */
+			class DatabaseBulkInsert {
+			public:
+				/** Existing rows are kept if ignoreExisting is set, otherwise a conflict fails the insert. */
+				DatabaseBulkInsert(InternalDatabaseInterface* database, QString const& tableName, QStringList const& columns, bool ignoreExisting);
+				virtual ~DatabaseBulkInsert();
+
+				/** Appends the next value of the current row, in the order of the columns. */
+				void addValue(QVariant const& value);
+
+				/** Completes the current row. Pending rows are inserted as soon as they fill a statement. */
+				void endRow();
+
+				/** Inserts the remaining rows. */
+				void finish();
+
+				/** The number of rows actually inserted so far, which excludes ignored ones. */
+				int getInsertedRowCount() const;
+			private:
+				InternalDatabaseInterface* const m_database;
+				QString const m_tableName;
+				QStringList const m_columns;
+				bool const m_ignoreExisting;
+				int const m_rowsPerStatement;
+
+				QSqlQuery m_fullQuery;
+				bool m_isFullQueryPrepared;
+				std::vector<QVariant> m_values;
+				int m_pendingRows;
+				int m_insertedRows;
+
+				QString createStatement(int rowCount) const;
+				void execute(QSqlQuery& query);
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_DATABASEBULKINSERT_H_
@@ -17,7 +17,7 @@ namespace openmittsu {
 	namespace database {
 		namespace internal {
 
-			DatabaseContactAndGroupDataProvider::DatabaseContactAndGroupDataProvider(Database* signalSource, InternalDatabaseInterface* database) : GroupDataProvider(), m_signalSource(signalSource), m_database(database) {
+			DatabaseContactAndGroupDataProvider::DatabaseContactAndGroupDataProvider(Database* signalSource, InternalDatabaseInterface* database) : GroupDataProvider(), m_signalSource(signalSource), m_database(database), m_isContactCacheLoaded(false), m_contactCache(), m_isGroupCacheLoaded(false), m_groupCache(), m_contactsWrittenThrough(), m_groupsWrittenThrough() {
 				OPENMITTSU_CONNECT(m_signalSource, groupChanged(openmittsu::protocol::GroupId const&), this, onGroupChanged(openmittsu::protocol::GroupId const&));
 				OPENMITTSU_CONNECT(m_signalSource, contactChanged(openmittsu::protocol::ContactId const&), this, onContactChanged(openmittsu::protocol::ContactId const&));
 
@@ -40,41 +40,25 @@ namespace openmittsu {
 			}
 
 			bool DatabaseContactAndGroupDataProvider::hasGroup(openmittsu::protocol::GroupId const& group) const {
-				QSqlQuery query(m_database->getQueryObject());
+				ensureGroupCacheLoaded();
 
-				query.prepare(QStringLiteral("SELECT `members` FROM `groups` WHERE `id` = :groupId AND `creator` = :groupCreator AND `is_deleted` = 0"));
-				query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
-				query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
-
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group existance query for table groups for group " << group.toString() << ". Query error: " << query.lastError().text().toStdString();
-				}
-
-				return query.next();
+				auto const it = m_groupCache.constFind(group);
+				return (it != m_groupCache.constEnd()) && (!it->isDeleted);
 			}
 
 			openmittsu::protocol::GroupStatus DatabaseContactAndGroupDataProvider::getGroupStatus(openmittsu::protocol::GroupId const& group) const {
-				QSqlQuery query(m_database->getQueryObject());
+				ensureGroupCacheLoaded();
 
-				query.prepare(QStringLiteral("SELECT `is_deleted`, `is_awaiting_sync` FROM `groups` WHERE `id` = :groupId AND `creator` = :groupCreator"));
-				query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
-				query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
-
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group existance query for table groups for group " << group.toString() << ". Query error: " << query.lastError().text().toStdString();
-				}
-
-				if (!query.next()) {
+				auto const it = m_groupCache.constFind(group);
+				if (it == m_groupCache.constEnd()) {
 					return openmittsu::protocol::GroupStatus::UNKNOWN;
 				}
 
-				bool const isDeleted = query.value(QStringLiteral("is_deleted")).toInt() != 0;
-				if (isDeleted) {
+				if (it->isDeleted) {
 					return openmittsu::protocol::GroupStatus::DELETED;
 				}
 
-				bool const isAwaitingSync = query.value(QStringLiteral("is_awaiting_sync")).toInt() != 0;
-				if (isAwaitingSync) {
+				if (it->isAwaitingSync) {
 					return openmittsu::protocol::GroupStatus::TEMPORARY;
 				}
 
@@ -82,45 +66,36 @@ namespace openmittsu {
 			}
 
 			int DatabaseContactAndGroupDataProvider::getGroupCount() const {
-				return openmittsu::database::internal::DatabaseUtilities::countQuery(m_database, QStringLiteral("groups"));
+				ensureGroupCacheLoaded();
+				return m_groupCache.size();
 			}
 
 			openmittsu::database::MediaFileItem DatabaseContactAndGroupDataProvider::getGroupImage(openmittsu::protocol::GroupId const& group) const {
-				QVariant const result = queryField(group, QStringLiteral("avatar_uuid"));
-				if (result.isNull() || result.toString().isEmpty()) {
+				QString const avatarUuid = getCachedGroup(group).avatarUuid;
+				if (avatarUuid.isEmpty()) {
 					return openmittsu::database::MediaFileItem(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, MediaFileType::TYPE_STANDARD);
 				}
 
-				return m_database->getMediaItem(result.toString(), MediaFileType::TYPE_STANDARD);
+				return m_database->getMediaItemHandle(avatarUuid, MediaFileType::TYPE_STANDARD).get();
 			}
 
 			QSet<openmittsu::protocol::ContactId> DatabaseContactAndGroupDataProvider::getGroupMembers(openmittsu::protocol::GroupId const& group, bool excludeSelfContact) const {
-				QSqlQuery query(m_database->getQueryObject());
-				openmittsu::protocol::ContactId const selfContact = m_database->getSelfContact();
-
-				query.prepare(QStringLiteral("SELECT `members` FROM `groups` WHERE `id` = :id AND `creator` = :creator;"));
-				query.bindValue(QStringLiteral(":id"), QVariant(group.groupIdWithoutOwnerToQString()));
-				query.bindValue(QStringLiteral(":creator"), QVariant(group.getOwner().toQString()));
+				ensureGroupCacheLoaded();
 
-				if (query.exec() && query.isSelect()) {
-					if (!query.next()) {
-						throw openmittsu::exceptions::InternalErrorException() << "Could not execute group member enumeration query for group " << group.toString() << " on table groups. Group does not exist!";
-					}
-
-					QString const memberString(query.value(QStringLiteral("members")).toString());
-					QSet<openmittsu::protocol::ContactId> result = openmittsu::protocol::ContactIdList::fromString(memberString).getContactIds();
+				auto const it = m_groupCache.constFind(group);
+				if (it == m_groupCache.constEnd()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group member enumeration query for group " << group.toString() << " on table groups. Group does not exist!";
+				}
 
-					if (excludeSelfContact) {
-						result.remove(selfContact);
-					}
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group member enumeration query for group " << group.toString() << " on table groups. Query error: " << query.lastError().text().toStdString();
+				QSet<openmittsu::protocol::ContactId> result = it->members;
+				if (excludeSelfContact) {
+					result.remove(m_database->getSelfContact());
 				}
+				return result;
 			}
 
 			bool DatabaseContactAndGroupDataProvider::getGroupIsAwaitingSync(openmittsu::protocol::GroupId const& group) const {
-				return queryField(group, QStringLiteral("is_awaiting_sync")).toBool();
+				return getCachedGroup(group).isAwaitingSync;
 			}
 
 			void DatabaseContactAndGroupDataProvider::addGroup(QVector<openmittsu::database::NewGroupData> const& newGroupData) {
@@ -147,8 +122,6 @@ namespace openmittsu {
 						if (!query.exec()) {
 							throw openmittsu::exceptions::InternalErrorException() << "Could not update group data for group ID \"" << it->id.toString() << "\". Query error: " << query.lastError().text().toStdString();
 						}
-
-						m_database->announceGroupChanged(it->id);
 					} else {
 						openmittsu::protocol::ContactId const ourId = m_database->getSelfContact();
 						bool containsUs = it->members.contains(ourId);
@@ -170,9 +143,11 @@ namespace openmittsu {
 						if (!query.exec()) {
 							throw openmittsu::exceptions::InternalErrorException() << "Could not insert group into 'groups'. Query error: " << query.lastError().text().toStdString();
 						}
-
-						m_database->announceGroupChanged(it->id);
 					}
+
+					reloadCachedGroup(it->id);
+					m_groupsWrittenThrough.insert(it->id);
+					m_database->announceGroupChanged(it->id);
 				}
 			}
 
@@ -189,9 +164,9 @@ namespace openmittsu {
 					throw openmittsu::exceptions::InternalErrorException() << "Could not set group image, the given group " << group.toString() << " is unknown!";
 				}
 
-				QVariant const oldUuid = queryField(group, QStringLiteral("avatar_uuid"));
-				if (!oldUuid.isNull() && !oldUuid.toString().isEmpty()) {
-					m_database->removeMediaItem(oldUuid.toString(), MediaFileType::TYPE_STANDARD);
+				QString const oldUuid = getCachedGroup(group).avatarUuid;
+				if (!oldUuid.isEmpty()) {
+					m_database->removeMediaItem(oldUuid, MediaFileType::TYPE_STANDARD);
 				}
 
 				QString const uuid = m_database->generateUuid();
@@ -214,72 +189,47 @@ namespace openmittsu {
 			}
 
 			QSet<openmittsu::protocol::GroupId> DatabaseContactAndGroupDataProvider::getKnownGroups() const {
-				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `id`, `creator` FROM `groups` WHERE `is_deleted` = 0"));
-
-				if (query.exec() && query.isSelect()) {
-					QSet<openmittsu::protocol::GroupId> result;
-					while (query.next()) {
-						QString const groupId = query.value(QStringLiteral("id")).toString();
-						openmittsu::protocol::ContactId const creator(query.value(QStringLiteral("creator")).toString());
-						openmittsu::protocol::GroupId const group(creator, groupId);
+				ensureGroupCacheLoaded();
 
-						result.insert(group);
+				QSet<openmittsu::protocol::GroupId> result;
+				for (auto it = m_groupCache.constBegin(), end = m_groupCache.constEnd(); it != end; ++it) {
+					if (!it->isDeleted) {
+						result.insert(it.key());
 					}
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group enumeration query for table groups. Query error: " << query.lastError().text().toStdString();
 				}
+				return result;
 			}
 
 			QHash<openmittsu::protocol::GroupId, std::pair<QSet<openmittsu::protocol::ContactId>, QString>> DatabaseContactAndGroupDataProvider::getKnownGroupsWithMembersAndTitles() const {
-				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `id`, `creator`, `groupname`, `members` FROM `groups` WHERE `is_deleted` = 0"));
-
-				if (query.exec() && query.isSelect()) {
-					QHash<openmittsu::protocol::GroupId, std::pair<QSet<openmittsu::protocol::ContactId>, QString>> result;
-					while (query.next()) {
-						QString const groupId = query.value(QStringLiteral("id")).toString();
-						openmittsu::protocol::ContactId const creator(query.value(QStringLiteral("creator")).toString());
-						openmittsu::protocol::GroupId const group(creator, groupId);
-
-						QString const title(query.value(QStringLiteral("groupname")).toString());
-						QString const memberString(query.value(QStringLiteral("members")).toString());
-						QSet<openmittsu::protocol::ContactId> const members = openmittsu::protocol::ContactIdList::fromString(memberString).getContactIds();
-						result.insert(group, std::make_pair(members, title));
+				ensureGroupCacheLoaded();
+
+				QHash<openmittsu::protocol::GroupId, std::pair<QSet<openmittsu::protocol::ContactId>, QString>> result;
+				for (auto it = m_groupCache.constBegin(), end = m_groupCache.constEnd(); it != end; ++it) {
+					if (!it->isDeleted) {
+						result.insert(it.key(), std::make_pair(it->members, it->title));
 					}
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group enumeration query with title and members for table groups. Query error: " << query.lastError().text().toStdString();
 				}
+				return result;
 			}
 
 			QHash<openmittsu::protocol::GroupId, QString> DatabaseContactAndGroupDataProvider::getKnownGroupsContainingMember(openmittsu::protocol::ContactId const& identity) const {
-				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `id`, `creator`, `groupname`, `members` FROM `groups` WHERE `is_deleted` = 0"));
+				ensureGroupCacheLoaded();
 
-				if (query.exec() && query.isSelect()) {
-					QHash<openmittsu::protocol::GroupId, QString> result;
-					QString const keyMember = identity.toQString();
-
-					while (query.next()) {
-						QString const memberString(query.value(QStringLiteral("members")).toString());
-						if (memberString.contains(keyMember, Qt::CaseInsensitive)) {
-							QString const groupId = query.value(QStringLiteral("id")).toString();
-							openmittsu::protocol::ContactId const creator(query.value(QStringLiteral("creator")).toString());
-							openmittsu::protocol::GroupId const group(creator, groupId);
-							QString const title(query.value(QStringLiteral("groupname")).toString());
-
-							result.insert(group, title);
-						}
+				QHash<openmittsu::protocol::GroupId, QString> result;
+				for (auto it = m_groupCache.constBegin(), end = m_groupCache.constEnd(); it != end; ++it) {
+					if ((!it->isDeleted) && it->members.contains(identity)) {
+						result.insert(it.key(), it->title);
 					}
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group enumeration query for table groups for key member " << identity.toString() << ". Query error: " << query.lastError().text().toStdString();
 				}
+				return result;
 			}
 
 			void DatabaseContactAndGroupDataProvider::onGroupChanged(openmittsu::protocol::GroupId const& group) {
+				// Changes made through this provider are already reflected in the cache, everything else is re-read.
+				if (!m_groupsWrittenThrough.remove(group)) {
+					reloadCachedGroup(group);
+				}
+
 				emit groupChanged(group);
 			}
 
@@ -299,22 +249,6 @@ namespace openmittsu {
 				emit groupHasNewMessage(group, messageUuid);
 			}
 
-			QVariant DatabaseContactAndGroupDataProvider::queryField(openmittsu::protocol::GroupId const& group, QString const& fieldName) const {
-				QSqlQuery query(m_database->getQueryObject());
-
-				query.prepare(QStringLiteral("SELECT `%1` FROM `groups` WHERE `id` = :groupId AND `creator` = :groupCreator;").arg(fieldName));
-				query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
-				query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
-
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute message field query for table groups with group \"" << group.toString() << "\" for field \"" << fieldName.toStdString() << "\". Query error: " << query.lastError().text().toStdString();
-				} else if (!query.next()) {
-					throw openmittsu::exceptions::InternalErrorException() << "No group with group ID \"" << group.toString() << "\" exists, can not manipulate.";
-				}
-
-				return query.value(fieldName);
-			}
-
 			void DatabaseContactAndGroupDataProvider::setFields(openmittsu::protocol::GroupId const& group, QVariantMap const& fieldsAndValues, bool doAnnounce) {
 				if (fieldsAndValues.size() > 0) {
 					QSqlQuery query(m_database->getQueryObject());
@@ -327,7 +261,10 @@ namespace openmittsu {
 						throw openmittsu::exceptions::InternalErrorException() << "Could not update group data for group ID \"" << group.toString() << "\". Query error: " << query.lastError().text().toStdString();
 					}
 
+					writeThroughGroupFields(group, fieldsAndValues);
+
 					if (doAnnounce) {
+						m_groupsWrittenThrough.insert(group);
 						m_database->announceGroupChanged(group);
 					}
 				} else {
@@ -346,7 +283,10 @@ namespace openmittsu {
 						throw openmittsu::exceptions::InternalErrorException() << "Could not update contact data for group ID \"" << contact.toString() << "\". Query error: " << query.lastError().text().toStdString();
 					}
 
+					writeThroughContactFields(contact, fieldsAndValues);
+
 					if (doAnnounce) {
+						m_contactsWrittenThrough.insert(contact);
 						m_database->announceContactChanged(contact);
 					}
 				} else {
@@ -354,19 +294,229 @@ namespace openmittsu {
 				}
 			}
 
-			QVariant DatabaseContactAndGroupDataProvider::queryField(openmittsu::protocol::ContactId const& contact, QString const& fieldName) const {
+			void DatabaseContactAndGroupDataProvider::ensureContactCacheLoaded() const {
+				if (m_isContactCacheLoaded) {
+					return;
+				}
+
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `identity`, `publickey`, `firstname`, `lastname`, `nick_name`, `status`, `status_last_check`, `verification`, `feature_level`, `feature_level_last_check`, `color` FROM `contacts`;"));
+
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact cache query for table contacts. Query error: " << query.lastError().text().toStdString();
+				}
+
+				m_contactCache.clear();
+				while (query.next()) {
+					openmittsu::protocol::ContactId const identity(query.value(QStringLiteral("identity")).toString());
+					m_contactCache.insert(identity, readContactFromQuery(query, identity));
+				}
+				m_isContactCacheLoaded = true;
+
+				LOGGER_DEBUG("Loaded {} contacts into the contact cache.", m_contactCache.size());
+			}
+
+			void DatabaseContactAndGroupDataProvider::ensureGroupCacheLoaded() const {
+				if (m_isGroupCacheLoaded) {
+					return;
+				}
+
 				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `id`, `creator`, `groupname`, `members`, `avatar_uuid`, `is_deleted`, `is_awaiting_sync` FROM `groups`;"));
+
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group cache query for table groups. Query error: " << query.lastError().text().toStdString();
+				}
+
+				m_groupCache.clear();
+				while (query.next()) {
+					openmittsu::protocol::ContactId const creator(query.value(QStringLiteral("creator")).toString());
+					openmittsu::protocol::GroupId const group(creator, query.value(QStringLiteral("id")).toString());
+					m_groupCache.insert(group, readGroupFromQuery(query));
+				}
+				m_isGroupCacheLoaded = true;
+
+				LOGGER_DEBUG("Loaded {} groups into the group cache.", m_groupCache.size());
+			}
 
-				query.prepare(QStringLiteral("SELECT `%1` FROM `contacts` WHERE `identity` = :identity;").arg(fieldName));
+			void DatabaseContactAndGroupDataProvider::reloadCachedContact(openmittsu::protocol::ContactId const& contact) const {
+				if (!m_isContactCacheLoaded) {
+					return;
+				}
+
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `identity`, `publickey`, `firstname`, `lastname`, `nick_name`, `status`, `status_last_check`, `verification`, `feature_level`, `feature_level_last_check`, `color` FROM `contacts` WHERE `identity` = :identity;"));
 				query.bindValue(QStringLiteral(":identity"), QVariant(contact.toQString()));
 
 				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact field query for field \"" << fieldName.toStdString() << "\". Query error: " << query.lastError().text().toStdString();
-				} else if (!query.next()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact data query for ID \"" << contact.toString() << "\". Query error: " << query.lastError().text().toStdString();
+				}
+
+				if (query.next()) {
+					m_contactCache.insert(contact, readContactFromQuery(query, contact));
+				} else {
+					m_contactCache.remove(contact);
+				}
+			}
+
+			void DatabaseContactAndGroupDataProvider::reloadCachedGroup(openmittsu::protocol::GroupId const& group) const {
+				if (!m_isGroupCacheLoaded) {
+					return;
+				}
+
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `groupname`, `members`, `avatar_uuid`, `is_deleted`, `is_awaiting_sync` FROM `groups` WHERE `id` = :groupId AND `creator` = :groupCreator;"));
+				query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
+				query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
+
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group data query for table groups with group \"" << group.toString() << "\". Query error: " << query.lastError().text().toStdString();
+				}
+
+				if (query.next()) {
+					m_groupCache.insert(group, readGroupFromQuery(query));
+				} else {
+					m_groupCache.remove(group);
+				}
+			}
+
+			void DatabaseContactAndGroupDataProvider::writeThroughContactFields(openmittsu::protocol::ContactId const& contact, QVariantMap const& fieldsAndValues) {
+				if (!m_isContactCacheLoaded) {
+					return;
+				}
+
+				auto const cacheIt = m_contactCache.find(contact);
+				if (cacheIt == m_contactCache.end()) {
+					// The update did not match any row.
+					return;
+				}
+
+				CachedContact& cachedContact = cacheIt.value();
+				for (auto it = fieldsAndValues.constBegin(), end = fieldsAndValues.constEnd(); it != end; ++it) {
+					QString const& field = it.key();
+					if (field == QStringLiteral("firstname")) {
+						cachedContact.data.firstName = it.value().toString();
+					} else if (field == QStringLiteral("lastname")) {
+						cachedContact.data.lastName = it.value().toString();
+					} else if (field == QStringLiteral("nick_name")) {
+						cachedContact.data.nickNameRaw = it.value().toString();
+					} else if (field == QStringLiteral("status")) {
+						cachedContact.data.accountStatus = openmittsu::protocol::AccountStatusHelper::fromInt(it.value().toInt());
+					} else if (field == QStringLiteral("status_last_check")) {
+						cachedContact.statusLastCheck = it.value().toLongLong();
+					} else if (field == QStringLiteral("verification")) {
+						cachedContact.data.verificationStatus = openmittsu::protocol::ContactIdVerificationStatusHelper::fromQString(it.value().toString());
+					} else if (field == QStringLiteral("feature_level")) {
+						cachedContact.data.featureLevel = openmittsu::protocol::FeatureLevelHelper::fromInt(it.value().toInt());
+					} else if (field == QStringLiteral("feature_level_last_check")) {
+						cachedContact.featureLevelLastCheck = it.value().toLongLong();
+					} else if (field == QStringLiteral("color")) {
+						cachedContact.data.color = it.value().toInt();
+					} else {
+						// Not mirrored field-by-field, take the whole row from the database instead.
+						reloadCachedContact(contact);
+						return;
+					}
+				}
+
+				cachedContact.data.nickName = buildNickname(cachedContact.data.nickNameRaw, cachedContact.data.firstName, cachedContact.data.lastName, contact);
+			}
+
+			void DatabaseContactAndGroupDataProvider::writeThroughGroupFields(openmittsu::protocol::GroupId const& group, QVariantMap const& fieldsAndValues) {
+				if (!m_isGroupCacheLoaded) {
+					return;
+				}
+
+				auto const cacheIt = m_groupCache.find(group);
+				if (cacheIt == m_groupCache.end()) {
+					// The update did not match any row.
+					return;
+				}
+
+				CachedGroup& cachedGroup = cacheIt.value();
+				for (auto it = fieldsAndValues.constBegin(), end = fieldsAndValues.constEnd(); it != end; ++it) {
+					QString const& field = it.key();
+					if (field == QStringLiteral("groupname")) {
+						cachedGroup.title = it.value().toString();
+					} else if (field == QStringLiteral("members")) {
+						cachedGroup.members = openmittsu::protocol::ContactIdList::fromString(it.value().toString()).getContactIds();
+					} else if (field == QStringLiteral("avatar_uuid")) {
+						cachedGroup.avatarUuid = it.value().toString();
+					} else if (field == QStringLiteral("is_deleted")) {
+						cachedGroup.isDeleted = it.value().toInt() != 0;
+					} else if (field == QStringLiteral("is_awaiting_sync")) {
+						cachedGroup.isAwaitingSync = it.value().toInt() != 0;
+					} else {
+						// Not mirrored field-by-field, take the whole row from the database instead.
+						reloadCachedGroup(group);
+						return;
+					}
+				}
+			}
+
+			void DatabaseContactAndGroupDataProvider::invalidateCaches() {
+				m_isContactCacheLoaded = false;
+				m_contactCache.clear();
+				m_contactsWrittenThrough.clear();
+
+				m_isGroupCacheLoaded = false;
+				m_groupCache.clear();
+				m_groupsWrittenThrough.clear();
+			}
+
+			DatabaseContactAndGroupDataProvider::CachedContact const& DatabaseContactAndGroupDataProvider::getCachedContact(openmittsu::protocol::ContactId const& contact) const {
+				ensureContactCacheLoaded();
+
+				auto const it = m_contactCache.constFind(contact);
+				if (it == m_contactCache.constEnd()) {
 					throw openmittsu::exceptions::InternalErrorException() << "No contact with identity \"" << contact.toString() << "\" exists, can not manipulate.";
 				}
 
-				return query.value(fieldName);
+				return it.value();
+			}
+
+			DatabaseContactAndGroupDataProvider::CachedGroup const& DatabaseContactAndGroupDataProvider::getCachedGroup(openmittsu::protocol::GroupId const& group) const {
+				ensureGroupCacheLoaded();
+
+				auto const it = m_groupCache.constFind(group);
+				if (it == m_groupCache.constEnd()) {
+					throw openmittsu::exceptions::InternalErrorException() << "No group with group ID \"" << group.toString() << "\" exists, can not manipulate.";
+				}
+
+				return it.value();
+			}
+
+			DatabaseContactAndGroupDataProvider::CachedContact DatabaseContactAndGroupDataProvider::readContactFromQuery(QSqlQuery const& query, openmittsu::protocol::ContactId const& contact) const {
+				CachedContact result;
+				result.data.publicKey = openmittsu::crypto::PublicKey::fromHexString(query.value(QStringLiteral("publickey")).toString());
+				result.data.firstName = query.value(QStringLiteral("firstname")).toString();
+				result.data.lastName = query.value(QStringLiteral("lastname")).toString();
+				result.data.nickNameRaw = query.value(QStringLiteral("nick_name")).toString();
+				result.data.nickName = buildNickname(result.data.nickNameRaw, result.data.firstName, result.data.lastName, contact);
+				result.data.accountStatus = openmittsu::protocol::AccountStatusHelper::fromInt(query.value(QStringLiteral("status")).toInt());
+				result.data.verificationStatus = openmittsu::protocol::ContactIdVerificationStatusHelper::fromQString(query.value(QStringLiteral("verification")).toString());
+				result.data.featureLevel = openmittsu::protocol::FeatureLevelHelper::fromInt(query.value(QStringLiteral("feature_level")).toInt());
+				result.data.color = query.value(QStringLiteral("color")).toInt();
+				result.data.messageCount = -1;
+
+				// A missing check time means the check is overdue, just like a very old one.
+				QVariant const statusLastCheck = query.value(QStringLiteral("status_last_check"));
+				result.statusLastCheck = statusLastCheck.isNull() ? -1 : statusLastCheck.toLongLong();
+				QVariant const featureLevelLastCheck = query.value(QStringLiteral("feature_level_last_check"));
+				result.featureLevelLastCheck = featureLevelLastCheck.isNull() ? -1 : featureLevelLastCheck.toLongLong();
+
+				return result;
+			}
+
+			DatabaseContactAndGroupDataProvider::CachedGroup DatabaseContactAndGroupDataProvider::readGroupFromQuery(QSqlQuery const& query) const {
+				CachedGroup result;
+				result.title = query.value(QStringLiteral("groupname")).toString();
+				result.members = openmittsu::protocol::ContactIdList::fromString(query.value(QStringLiteral("members")).toString()).getContactIds();
+				result.avatarUuid = query.value(QStringLiteral("avatar_uuid")).toString();
+				result.isDeleted = query.value(QStringLiteral("is_deleted")).toInt() != 0;
+				result.isAwaitingSync = query.value(QStringLiteral("is_awaiting_sync")).toInt() != 0;
+
+				return result;
 			}
 
 			std::shared_ptr<openmittsu::dataproviders::messages::GroupMessageCursor> DatabaseContactAndGroupDataProvider::getGroupMessageCursor(openmittsu::protocol::GroupId const& group) {
@@ -375,20 +525,12 @@ namespace openmittsu {
 
 			// Contacts
 			bool DatabaseContactAndGroupDataProvider::hasContact(openmittsu::protocol::ContactId const& contact) const {
-				QSqlQuery query(m_database->getQueryObject());
-
-				query.prepare(QStringLiteral("SELECT `identity` FROM `contacts` WHERE `identity` = :identity;"));
-				query.bindValue(QStringLiteral(":identity"), QVariant(contact.toQString()));
-
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact existance query for contact \"" << contact.toString() << "\". Query error: " << query.lastError().text().toStdString();
-				}
-
-				return query.next();
+				ensureContactCacheLoaded();
+				return m_contactCache.contains(contact);
 			}
 
 			openmittsu::crypto::PublicKey DatabaseContactAndGroupDataProvider::getPublicKey(openmittsu::protocol::ContactId const& contact) const {
-				return openmittsu::crypto::PublicKey::fromHexString(queryField(contact, QStringLiteral("publickey")).toString());
+				return getCachedContact(contact).data.publicKey;
 			}
 
 			openmittsu::protocol::ContactStatus DatabaseContactAndGroupDataProvider::getContactStatus(openmittsu::protocol::ContactId const& contact) const {
@@ -400,7 +542,8 @@ namespace openmittsu {
 			}
 
 			int DatabaseContactAndGroupDataProvider::getContactCount() const {
-				return openmittsu::database::internal::DatabaseUtilities::countQuery(m_database, QStringLiteral("contacts"));
+				ensureContactCacheLoaded();
+				return m_contactCache.size();
 			}
 
 			void DatabaseContactAndGroupDataProvider::addContact(QVector<openmittsu::database::NewContactData> const& newContactData) {
@@ -426,8 +569,6 @@ namespace openmittsu {
 						if (!query.exec()) {
 							throw openmittsu::exceptions::InternalErrorException() << "Could not update contact data for contact ID \"" << it->id.toString() << "\". Query error: " << query.lastError().text().toStdString();
 						}
-
-						m_database->announceContactChanged(it->id);
 					} else {
 						QSqlQuery query(m_database->getQueryObject());
 						query.prepare(QStringLiteral("INSERT INTO `contacts` (`identity`, `publickey`, `verification`, `acid`, `tacid`, `firstname`, `lastname`, `nick_name`, `color`, `status`, `status_last_check`, `feature_level`, `feature_level_last_check`) VALUES "
@@ -445,9 +586,11 @@ namespace openmittsu {
 						if (!query.exec()) {
 							throw openmittsu::exceptions::InternalErrorException() << "Could not insert contact into 'contacts'. Query error: " << query.lastError().text().toStdString();
 						}
-
-						m_database->announceContactChanged(it->id);
 					}
+
+					reloadCachedContact(it->id);
+					m_contactsWrittenThrough.insert(it->id);
+					m_database->announceContactChanged(it->id);
 				}
 			}
 
@@ -484,11 +627,17 @@ namespace openmittsu {
 				auto end = status.constEnd();
 				qint64 const timeNow = openmittsu::protocol::MessageTime::now().getMessageTimeMSecs();
 
-				m_database->transactionStart();
-				for (; it != end; ++it) {
-					setFields(it.key(), { {QStringLiteral("status"), openmittsu::protocol::AccountStatusHelper::toInt(it.value())}, {QStringLiteral("status_last_check"), timeNow} }, false);
+				try {
+					m_database->transactionStart();
+					for (; it != end; ++it) {
+						setFields(it.key(), { {QStringLiteral("status"), openmittsu::protocol::AccountStatusHelper::toInt(it.value())}, {QStringLiteral("status_last_check"), timeNow} }, false);
+					}
+					m_database->transactionCommit();
+				} catch (...) {
+					// The cache may hold values that never made it into the database.
+					invalidateCaches();
+					throw;
 				}
-				m_database->transactionCommit();
 
 				// TODO: Fixme. This might be broken
 				m_database->announceContactChanged(m_database->getSelfContact());
@@ -499,82 +648,68 @@ namespace openmittsu {
 				auto end = featureLevels.constEnd();
 				qint64 const timeNow = openmittsu::protocol::MessageTime::now().getMessageTimeMSecs();
 
-				m_database->transactionStart();
-				for (; it != end; ++it) {
-					setFields(it.key(), { {QStringLiteral("feature_level"), openmittsu::protocol::FeatureLevelHelper::toInt(it.value())}, {QStringLiteral("feature_level_last_check"), timeNow} }, false);
+				try {
+					m_database->transactionStart();
+					for (; it != end; ++it) {
+						setFields(it.key(), { {QStringLiteral("feature_level"), openmittsu::protocol::FeatureLevelHelper::toInt(it.value())}, {QStringLiteral("feature_level_last_check"), timeNow} }, false);
+					}
+					m_database->transactionCommit();
+				} catch (...) {
+					// The cache may hold values that never made it into the database.
+					invalidateCaches();
+					throw;
 				}
-				m_database->transactionCommit();
 
 				// TODO: Fixme. This might be broken
 				m_database->announceContactChanged(m_database->getSelfContact());
 			}
 
 			QSet<openmittsu::protocol::ContactId> DatabaseContactAndGroupDataProvider::getKnownContacts() const {
-				QSet<openmittsu::protocol::ContactId> result;
-
-				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `identity` FROM `contacts`;"));
+				ensureContactCacheLoaded();
 
-				if (query.exec() && query.isSelect()) {
-					while (query.next()) {
-						result.insert(openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString()));
-					}
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact enumeration query for table contacts. Query error: " << query.lastError().text().toStdString();
+				QSet<openmittsu::protocol::ContactId> result;
+				result.reserve(m_contactCache.size());
+				for (auto it = m_contactCache.constBegin(), end = m_contactCache.constEnd(); it != end; ++it) {
+					result.insert(it.key());
 				}
+				return result;
 			}
 
 			QSet<openmittsu::protocol::ContactId> DatabaseContactAndGroupDataProvider::getContactsRequiringFeatureLevelCheck(int maximalAgeInSeconds) const {
-				QSet<openmittsu::protocol::ContactId> result;
-				QSqlQuery query(m_database->getQueryObject());
-				openmittsu::protocol::MessageTime const limit(QDateTime::currentDateTime().addSecs(-maximalAgeInSeconds));
+				ensureContactCacheLoaded();
+				qint64 const limit = openmittsu::protocol::MessageTime(QDateTime::currentDateTime().addSecs(-maximalAgeInSeconds)).getMessageTimeMSecs();
 
-				query.prepare(QStringLiteral("SELECT `identity` FROM `contacts` WHERE ((`feature_level_last_check` <= %1) OR (`feature_level_last_check` IS NULL));").arg(limit.getMessageTimeMSecs()));
-				if (query.exec() && query.isSelect()) {
-					while (query.next()) {
-						result.insert(openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString()));
+				QSet<openmittsu::protocol::ContactId> result;
+				for (auto it = m_contactCache.constBegin(), end = m_contactCache.constEnd(); it != end; ++it) {
+					if (it->featureLevelLastCheck <= limit) {
+						result.insert(it.key());
 					}
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contacts requiring feature level check enumeration query for table contacts. Query error: " << query.lastError().text().toStdString();
 				}
+				return result;
 			}
 
 			QSet<openmittsu::protocol::ContactId> DatabaseContactAndGroupDataProvider::getContactsRequiringAccountStatusCheck(int maximalAgeInSeconds) const {
-				QSet<openmittsu::protocol::ContactId> result;
-				QSqlQuery query(m_database->getQueryObject());
-				openmittsu::protocol::MessageTime const limit(QDateTime::currentDateTime().addSecs(-maximalAgeInSeconds));
+				ensureContactCacheLoaded();
+				qint64 const limit = openmittsu::protocol::MessageTime(QDateTime::currentDateTime().addSecs(-maximalAgeInSeconds)).getMessageTimeMSecs();
 
-				query.prepare(QStringLiteral("SELECT `identity` FROM `contacts` WHERE ((`status_last_check` <= %1) OR (`status_last_check` IS NULL));").arg(limit.getMessageTimeMSecs()));
-				if (query.exec() && query.isSelect()) {
-					while (query.next()) {
-						result.insert(openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString()));
+				QSet<openmittsu::protocol::ContactId> result;
+				for (auto it = m_contactCache.constBegin(), end = m_contactCache.constEnd(); it != end; ++it) {
+					if (it->statusLastCheck <= limit) {
+						result.insert(it.key());
 					}
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contacts requiring feature level check enumeration query for table contacts. Query error: " << query.lastError().text().toStdString();
 				}
+				return result;
 			}
 
 			QHash<openmittsu::protocol::ContactId, openmittsu::crypto::PublicKey> DatabaseContactAndGroupDataProvider::getKnownContactsWithPublicKeys() const {
-				QHash<openmittsu::protocol::ContactId, openmittsu::crypto::PublicKey> result;
+				ensureContactCacheLoaded();
 
-				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `identity`, `publickey` FROM `contacts`;"));
-
-				if (query.exec() && query.isSelect()) {
-					while (query.next()) {
-						openmittsu::protocol::ContactId const contactId(query.value(QStringLiteral("identity")).toString());
-						openmittsu::crypto::PublicKey const publicKey(openmittsu::crypto::PublicKey::fromHexString(query.value(QStringLiteral("publickey")).toString()));
-
-						result.insert(contactId, publicKey);
-					}
-
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact/key enumeration query for table contacts. Query error: " << query.lastError().text().toStdString();
+				QHash<openmittsu::protocol::ContactId, openmittsu::crypto::PublicKey> result;
+				result.reserve(m_contactCache.size());
+				for (auto it = m_contactCache.constBegin(), end = m_contactCache.constEnd(); it != end; ++it) {
+					result.insert(it.key(), it->data.publicKey);
 				}
+				return result;
 			}
 
 			QString DatabaseContactAndGroupDataProvider::buildNickname(QString const& nickname, QString const& firstName, QString const& lastName, openmittsu::protocol::ContactId const& contact) const {
@@ -595,35 +730,31 @@ namespace openmittsu {
 			}
 
 			QHash<openmittsu::protocol::ContactId, QString> DatabaseContactAndGroupDataProvider::getKnownContactsWithNicknames(bool withSelfContactId) const {
-				QHash<openmittsu::protocol::ContactId, QString> result;
+				ensureContactCacheLoaded();
 				openmittsu::protocol::ContactId const selfContact = m_database->getSelfContact();
 
-				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `identity`, `firstname`, `lastname`, `nick_name` FROM `contacts`;"));
-
-				if (query.exec() && query.isSelect()) {
-					while (query.next()) {
-						openmittsu::protocol::ContactId const contactId(query.value(QStringLiteral("identity")).toString());
-						QString const nickname = buildNickname(query.value(QStringLiteral("nick_name")).toString(), query.value(QStringLiteral("firstname")).toString(), query.value(QStringLiteral("lastname")).toString(), contactId);
-
-						if ((!withSelfContactId) && (selfContact == contactId)) {
-							continue;
-						}
-
-						result.insert(contactId, nickname);
+				QHash<openmittsu::protocol::ContactId, QString> result;
+				for (auto it = m_contactCache.constBegin(), end = m_contactCache.constEnd(); it != end; ++it) {
+					if ((!withSelfContactId) && (selfContact == it.key())) {
+						continue;
 					}
 
-					if (withSelfContactId && (!result.contains(selfContact))) {
-						result.insert(selfContact, QStringLiteral("You"));
-					}
+					result.insert(it.key(), it->data.nickName);
+				}
 
-					return result;
-				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact/nickname enumeration query for table contacts. Query error: " << query.lastError().text().toStdString();
+				if (withSelfContactId && (!result.contains(selfContact))) {
+					result.insert(selfContact, QStringLiteral("You"));
 				}
+
+				return result;
 			}
 
 			void DatabaseContactAndGroupDataProvider::onContactChanged(openmittsu::protocol::ContactId const& identity) {
+				// Changes made through this provider are already reflected in the cache, everything else is re-read.
+				if (!m_contactsWrittenThrough.remove(identity)) {
+					reloadCachedContact(identity);
+				}
+
 				emit contactChanged(identity);
 			}
 
@@ -631,8 +762,7 @@ namespace openmittsu {
 				return std::make_shared<openmittsu::database::internal::DatabaseContactMessageCursor>(m_database, contact);
 			}
 
-			QString DatabaseContactAndGroupDataProvider::getGroupDescription(QString const& memberField) const {
-				QSet<openmittsu::protocol::ContactId> groupMembers = openmittsu::protocol::ContactIdList::fromString(memberField).getContactIds();
+			QString DatabaseContactAndGroupDataProvider::getGroupDescription(QSet<openmittsu::protocol::ContactId> const& groupMembers) const {
 				QHash<openmittsu::protocol::ContactId, QString> nicknames = getNicknames(groupMembers);
 
 				QString result;
@@ -660,21 +790,11 @@ namespace openmittsu {
 					return result;
 				}
 
-				QSqlQuery query(m_database->getQueryObject());
-
-				query.prepare(QStringLiteral("SELECT `firstname`, `lastname`, `nick_name`, `identity` FROM `contacts`;"));
-
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact nicknames query. Query error: " << query.lastError().text().toStdString();
-				}
-
-				while (query.next()) {
-					openmittsu::protocol::ContactId const identity = openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString());
-					if (contacts.contains(identity)) {
-						QString const firstName = query.value(QStringLiteral("firstname")).toString();
-						QString const lastName = query.value(QStringLiteral("lastname")).toString();
-						QString const nickName = buildNickname(query.value(QStringLiteral("lastname")).toString(), firstName, lastName, identity);
-						result.insert(identity, nickName);
+				ensureContactCacheLoaded();
+				for (auto it = contacts.constBegin(), end = contacts.constEnd(); it != end; ++it) {
+					auto const cacheIt = m_contactCache.constFind(*it);
+					if (cacheIt != m_contactCache.constEnd()) {
+						result.insert(*it, cacheIt->data.nickName);
 					}
 				}
 
@@ -685,28 +805,8 @@ namespace openmittsu {
 				return result;
 			}
 
-			openmittsu::database::ContactData DatabaseContactAndGroupDataProvider::getContactData(openmittsu::protocol::ContactId const& contact, bool fetchMessageCount) const {
-				QSqlQuery query(m_database->getQueryObject());
-
-				query.prepare(QStringLiteral("SELECT `publickey`, `firstname`, `lastname`, `nick_name`, `status`, `verification`, `feature_level`, `color` FROM `contacts` WHERE `identity` = :identity;"));
-				query.bindValue(QStringLiteral(":identity"), QVariant(contact.toQString()));
-
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact data query for ID \"" << contact.toString() << "\". Query error: " << query.lastError().text().toStdString();
-				} else if (!query.next()) {
-					throw openmittsu::exceptions::InternalErrorException() << "No contact with identity \"" << contact.toString() << "\" exists, can not manipulate.";
-				}
-
-				ContactData result;
-				result.publicKey = openmittsu::crypto::PublicKey::fromHexString(query.value(QStringLiteral("publickey")).toString());
-				result.firstName = query.value(QStringLiteral("firstname")).toString();
-				result.lastName = query.value(QStringLiteral("lastname")).toString();
-				result.nickNameRaw = query.value(QStringLiteral("nick_name")).toString();
-				result.nickName = buildNickname(result.nickNameRaw, result.firstName, result.lastName, contact);
-				result.accountStatus = openmittsu::protocol::AccountStatusHelper::fromInt(query.value(QStringLiteral("status")).toInt());
-				result.verificationStatus = openmittsu::protocol::ContactIdVerificationStatusHelper::fromQString(query.value(QStringLiteral("verification")).toString());
-				result.featureLevel = openmittsu::protocol::FeatureLevelHelper::fromInt(query.value(QStringLiteral("feature_level")).toInt());
-				result.color = query.value(QStringLiteral("color")).toInt();
+			openmittsu::database::ContactData DatabaseContactAndGroupDataProvider::buildContactData(openmittsu::protocol::ContactId const& contact, CachedContact const& cachedContact, bool fetchMessageCount) const {
+				ContactData result = cachedContact.data;
 				if (fetchMessageCount) {
 					result.messageCount = openmittsu::database::internal::DatabaseContactMessage::getContactMessageCount(m_database, contact);
 				} else {
@@ -716,118 +816,86 @@ namespace openmittsu {
 				return result;
 			}
 
-			QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> DatabaseContactAndGroupDataProvider::getContactDataAll(bool fetchMessageCount) const {
-				QSqlQuery query(m_database->getQueryObject());
-
-				query.prepare(QStringLiteral("SELECT `identity`, `publickey`, `firstname`, `lastname`, `nick_name`, `status`, `verification`, `feature_level`, `color` FROM `contacts`;"));
+			openmittsu::database::ContactData DatabaseContactAndGroupDataProvider::getContactData(openmittsu::protocol::ContactId const& contact, bool fetchMessageCount) const {
+				return buildContactData(contact, getCachedContact(contact), fetchMessageCount);
+			}
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact data enumeration query. Query error: " << query.lastError().text().toStdString();
-				}
+			QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> DatabaseContactAndGroupDataProvider::getContactDataAll(bool fetchMessageCount) const {
+				ensureContactCacheLoaded();
 
 				QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> result;
-				while (query.next()) {
-					ContactData data;
-					openmittsu::protocol::ContactId const identity = openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString());
-					data.publicKey = openmittsu::crypto::PublicKey::fromHexString(query.value(QStringLiteral("publickey")).toString());
-					data.firstName = query.value(QStringLiteral("firstname")).toString();
-					data.lastName = query.value(QStringLiteral("lastname")).toString();
-					data.nickNameRaw = query.value(QStringLiteral("nick_name")).toString();
-					data.nickName = buildNickname(data.nickNameRaw, data.firstName, data.lastName, identity);
-					data.accountStatus = openmittsu::protocol::AccountStatusHelper::fromInt(query.value(QStringLiteral("status")).toInt());
-					data.verificationStatus = openmittsu::protocol::ContactIdVerificationStatusHelper::fromQString(query.value(QStringLiteral("verification")).toString());
-					data.featureLevel = openmittsu::protocol::FeatureLevelHelper::fromInt(query.value(QStringLiteral("feature_level")).toInt());
-					data.color = query.value(QStringLiteral("color")).toInt();
-					if (fetchMessageCount) {
-						data.messageCount = openmittsu::database::internal::DatabaseContactMessage::getContactMessageCount(m_database, identity);
-					} else {
-						data.messageCount = -1;
-					}
-
-					result.insert(identity, data);
+				result.reserve(m_contactCache.size());
+				for (auto it = m_contactCache.constBegin(), end = m_contactCache.constEnd(); it != end; ++it) {
+					result.insert(it.key(), buildContactData(it.key(), it.value(), fetchMessageCount));
 				}
 
 				return result;
 			}
 
-			openmittsu::database::GroupData DatabaseContactAndGroupDataProvider::getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const {
-				QSqlQuery query(m_database->getQueryObject());
-
-				query.prepare(QStringLiteral("SELECT `groupname`, `members`, `avatar_uuid`, `is_awaiting_sync` FROM `groups` WHERE `id` = :groupId AND `creator` = :groupCreator;"));
-				query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
-				query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
+			QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> DatabaseContactAndGroupDataProvider::getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const {
+				ensureContactCacheLoaded();
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group data query for table groups with group \"" << group.toString() << "\". Query error: " << query.lastError().text().toStdString();
-				} else if (!query.next()) {
-					throw openmittsu::exceptions::InternalErrorException() << "No group with group ID \"" << group.toString() << "\" exists, can not manipulate.";
+				QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> result;
+				result.reserve(contacts.size());
+				for (auto it = contacts.constBegin(), end = contacts.constEnd(); it != end; ++it) {
+					auto const cacheIt = m_contactCache.constFind(*it);
+					if (cacheIt != m_contactCache.constEnd()) {
+						result.insert(*it, buildContactData(*it, cacheIt.value(), fetchMessageCount));
+					}
 				}
 
+				return result;
+			}
+
+			openmittsu::database::GroupData DatabaseContactAndGroupDataProvider::buildGroupData(openmittsu::protocol::GroupId const& group, CachedGroup const& cachedGroup, bool withDescription) const {
 				GroupData result;
-				result.title = query.value(QStringLiteral("groupname")).toString();
+				result.title = cachedGroup.title;
 
-				QString const memberField = query.value(QStringLiteral("members")).toString();
 				if (withDescription) {
-					result.description = getGroupDescription(memberField);
+					result.description = getGroupDescription(cachedGroup.members);
 				} else {
 					result.description = QStringLiteral("");
 				}
 
-				result.members = openmittsu::protocol::ContactIdList::fromString(memberField).getContactIds();
-
-				QVariant const avatar = queryField(group, QStringLiteral("avatar_uuid"));
-				result.hasImage = !(avatar.isNull() || avatar.toString().isEmpty());
+				result.members = cachedGroup.members;
+				result.hasImage = !cachedGroup.avatarUuid.isEmpty();
 
-				if (!result.hasImage) {
-					result.image = openmittsu::database::MediaFileItem(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, MediaFileType::TYPE_STANDARD);
-				} else {
-					result.image = m_database->getMediaItem(avatar.toString(), MediaFileType::TYPE_STANDARD);
+				if (result.hasImage) {
+					result.image = m_database->getMediaItemHandle(cachedGroup.avatarUuid, MediaFileType::TYPE_STANDARD);
 				}
 
-				result.isAwaitingSync = query.value(QStringLiteral("is_awaiting_sync")).toBool();
+				result.isAwaitingSync = cachedGroup.isAwaitingSync;
 				result.messageCount = openmittsu::database::internal::DatabaseGroupMessage::getGroupMessageCount(m_database, group);
 
 				return result;
 			}
 
-			QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> DatabaseContactAndGroupDataProvider::getGroupDataAll(bool withDescription) const {
-				QSqlQuery query(m_database->getQueryObject());
-
-				query.prepare(QStringLiteral("SELECT `id`, `creator`, `groupname`, `members`, `avatar_uuid`, `is_awaiting_sync` FROM `groups`;"));
+			openmittsu::database::GroupData DatabaseContactAndGroupDataProvider::getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const {
+				return buildGroupData(group, getCachedGroup(group), withDescription);
+			}
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group data enumeration query for table groups. Query error: " << query.lastError().text().toStdString();
-				}
+			QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> DatabaseContactAndGroupDataProvider::getGroupDataAll(bool withDescription) const {
+				ensureGroupCacheLoaded();
 
 				QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> result;
-				while (query.next()) {
-					GroupData groupData;
-					openmittsu::protocol::ContactId const creator(query.value(QStringLiteral("creator")).toString());
-					openmittsu::protocol::GroupId const group(creator, query.value(QStringLiteral("id")).toString());
-
-					groupData.title = query.value(QStringLiteral("groupname")).toString();
+				result.reserve(m_groupCache.size());
+				for (auto it = m_groupCache.constBegin(), end = m_groupCache.constEnd(); it != end; ++it) {
+					result.insert(it.key(), buildGroupData(it.key(), it.value(), withDescription));
+				}
 
-					QString const memberField = query.value(QStringLiteral("members")).toString();
-					if (withDescription) {
-						groupData.description = getGroupDescription(memberField);
-					} else {
-						groupData.description = QStringLiteral("");
-					}
-					groupData.members = openmittsu::protocol::ContactIdList::fromString(memberField).getContactIds();
+				return result;
+			}
 
-					QVariant const avatar = queryField(group, QStringLiteral("avatar_uuid"));
-					groupData.hasImage = !(avatar.isNull() || avatar.toString().isEmpty());
+			QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> DatabaseContactAndGroupDataProvider::getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const {
+				ensureGroupCacheLoaded();
 
-					if (!groupData.hasImage) {
-						groupData.image = openmittsu::database::MediaFileItem(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, MediaFileType::TYPE_STANDARD);
-					} else {
-						groupData.image = m_database->getMediaItem(avatar.toString(), MediaFileType::TYPE_STANDARD);
+				QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> result;
+				result.reserve(groups.size());
+				for (auto it = groups.constBegin(), end = groups.constEnd(); it != end; ++it) {
+					auto const cacheIt = m_groupCache.constFind(*it);
+					if (cacheIt != m_groupCache.constEnd()) {
+						result.insert(*it, buildGroupData(*it, cacheIt.value(), withDescription));
 					}
-
-					groupData.isAwaitingSync = query.value(QStringLiteral("is_awaiting_sync")).toBool();
-					groupData.messageCount = openmittsu::database::internal::DatabaseGroupMessage::getGroupMessageCount(m_database, group);
-
-					result.insert(group, groupData);
 				}
 
 				return result;
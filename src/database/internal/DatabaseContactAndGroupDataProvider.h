@@ -4,9 +4,13 @@
 #include "src/database/internal/DatabaseGroupMessageCursor.h"
 #include "src/dataproviders/GroupDataProvider.h"
 
+#include <QHash>
+#include <QSet>
 #include <QString>
 #include <QVariant>
 
+class QSqlQuery;
+
 namespace openmittsu {
 	namespace database {
 		class Database;
@@ -30,6 +34,7 @@ namespace openmittsu {
 
 				virtual openmittsu::database::GroupData getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const override;
 				virtual QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> getGroupDataAll(bool withDescription) const override;
+				virtual QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const override;
 
 				virtual void addGroup(QVector<NewGroupData> const& newGroupData) override;
 
@@ -52,6 +57,7 @@ namespace openmittsu {
 				
 				virtual openmittsu::database::ContactData getContactData(openmittsu::protocol::ContactId const& contact, bool fetchMessageCount) const override;
 				virtual QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> getContactDataAll(bool fetchMessageCount) const override;
+				virtual QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const override;
 
 				virtual void addContact(QVector<NewContactData> const& newContactData) override;
 
@@ -82,18 +88,59 @@ namespace openmittsu {
 				void onContactHasNewMessage(openmittsu::protocol::ContactId const& identity, QString const& messageUuid);
 				void onGroupHasNewMessage(openmittsu::protocol::GroupId const& group, QString const& messageUuid);
 			private:
+				/**
+				 * Cached copy of a row of the contacts table.
+				 * The message count of the contained ContactData is not cached and always -1.
+				 */
+				struct CachedContact {
+					openmittsu::database::ContactData data;
+					qint64 statusLastCheck;
+					qint64 featureLevelLastCheck;
+				};
+
+				/** Cached copy of a row of the groups table. */
+				struct CachedGroup {
+					QString title;
+					QSet<openmittsu::protocol::ContactId> members;
+					QString avatarUuid;
+					bool isDeleted;
+					bool isAwaitingSync;
+				};
+
 				Database* const m_signalSource;
 				InternalDatabaseInterface* const m_database;
 
-				QVariant queryField(openmittsu::protocol::GroupId const& group, QString const& fieldName) const;
+				// Write-through caches of the contacts and groups tables. They are filled on first use and live on the database thread, as does the connection itself.
+				mutable bool m_isContactCacheLoaded;
+				mutable QHash<openmittsu::protocol::ContactId, CachedContact> m_contactCache;
+				mutable bool m_isGroupCacheLoaded;
+				mutable QHash<openmittsu::protocol::GroupId, CachedGroup> m_groupCache;
+
+				// Records whose pending change announcement was caused by a write through this provider, so the cache already holds the new values.
+				QSet<openmittsu::protocol::ContactId> m_contactsWrittenThrough;
+				QSet<openmittsu::protocol::GroupId> m_groupsWrittenThrough;
 
 				void setFields(openmittsu::protocol::GroupId const& group, QVariantMap const& fieldsAndValues, bool doAnnounce = true);
 				void setFields(openmittsu::protocol::ContactId const& contact, QVariantMap const& fieldsAndValues, bool doAnnounce = true);
 
-				QVariant queryField(openmittsu::protocol::ContactId const& contact, QString const& fieldName) const;
+				void ensureContactCacheLoaded() const;
+				void ensureGroupCacheLoaded() const;
+				void reloadCachedContact(openmittsu::protocol::ContactId const& contact) const;
+				void reloadCachedGroup(openmittsu::protocol::GroupId const& group) const;
+				void writeThroughContactFields(openmittsu::protocol::ContactId const& contact, QVariantMap const& fieldsAndValues);
+				void writeThroughGroupFields(openmittsu::protocol::GroupId const& group, QVariantMap const& fieldsAndValues);
+				void invalidateCaches();
+
+				CachedContact const& getCachedContact(openmittsu::protocol::ContactId const& contact) const;
+				CachedGroup const& getCachedGroup(openmittsu::protocol::GroupId const& group) const;
+				CachedContact readContactFromQuery(QSqlQuery const& query, openmittsu::protocol::ContactId const& contact) const;
+				CachedGroup readGroupFromQuery(QSqlQuery const& query) const;
+
+				openmittsu::database::ContactData buildContactData(openmittsu::protocol::ContactId const& contact, CachedContact const& cachedContact, bool fetchMessageCount) const;
+				openmittsu::database::GroupData buildGroupData(openmittsu::protocol::GroupId const& group, CachedGroup const& cachedGroup, bool withDescription) const;
 
 				QString buildNickname(QString const& nickname, QString const& firstName, QString const& lastName, openmittsu::protocol::ContactId const& contact) const;
-				QString getGroupDescription(QString const& memberField) const;
+				QString getGroupDescription(QSet<openmittsu::protocol::ContactId> const& groupMembers) const;
 				QHash<openmittsu::protocol::ContactId, QString> getNicknames(QSet<openmittsu::protocol::ContactId> const& contacts) const;
 			};
 		}
@@ -1,6 +1,8 @@
 #include "src/database/internal/DatabaseContactMessage.h"
 
 #include "src/backup/ContactMessageBackupObject.h"
+#include "src/database/internal/DatabaseBackupImportJournal.h"
+#include "src/database/internal/DatabaseBulkInsert.h"
 #include "src/database/internal/InternalDatabaseInterface.h"
 #include "src/database/internal/DatabaseUtilities.h"
 #include "src/exceptions/InternalErrorException.h"
@@ -16,9 +18,11 @@ namespace openmittsu {
 			using namespace openmittsu::dataproviders::messages;
 
 			DatabaseContactMessage::DatabaseContactMessage(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, openmittsu::protocol::MessageId const& messageId) : DatabaseMessage(database, messageId), DatabaseUserMessage(database, messageId), ContactMessage(), m_contact(contact) {
-				if (!exists(database, contact, messageId)) {
+				QString const schema = findSchema(database, contact, messageId);
+				if (schema.isEmpty()) {
 					throw openmittsu::exceptions::InternalErrorException() << "No message from contact \"" << contact.toString() << "\" and message ID \"" << messageId.toString() << "\" exists, can not manipulate.";
 				}
+				setSchema(schema);
 			}
 
 			DatabaseContactMessage::~DatabaseContactMessage() {
@@ -30,23 +34,35 @@ namespace openmittsu {
 			}
 
 			int DatabaseContactMessage::getContactMessageCount(InternalDatabaseInterface const* database) {
-				return openmittsu::database::internal::DatabaseUtilities::countQuery(database, QStringLiteral("contact_messages"));
+				return openmittsu::database::internal::DatabaseUtilities::countQueryInAllSchemas(database, QStringLiteral("contact_messages"));
 			}
 
 			int DatabaseContactMessage::getContactMessageCount(InternalDatabaseInterface const* database, openmittsu::protocol::ContactId const& contact) {
-				return openmittsu::database::internal::DatabaseUtilities::countQuery(database, QStringLiteral("contact_messages"), { { QStringLiteral("identity"), contact.toQString() } });
+				return openmittsu::database::internal::DatabaseUtilities::countQueryInAllSchemas(database, QStringLiteral("contact_messages"), { { QStringLiteral("identity"), contact.toQString() } });
 			}
 
 			bool DatabaseContactMessage::exists(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, openmittsu::protocol::MessageId const& messageId) {
-				QSqlQuery query(database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `apiid` FROM `contact_messages` WHERE `identity` = :identity AND `apiid` = :apiid;"));
-				query.bindValue(QStringLiteral(":identity"), QVariant(contact.toQString()));
-				query.bindValue(QStringLiteral(":apiid"), QVariant(messageId.toQString()));
+				return !findSchema(database, contact, messageId).isEmpty();
+			}
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact message existance query for table contact_messages for identity \"" << contact.toString() << "\" and message ID \"" << messageId.toString() << "\". Query error: " << query.lastError().text().toStdString();
+			QString DatabaseContactMessage::findSchema(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, openmittsu::protocol::MessageId const& messageId) {
+				QStringList const schemas = database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery query(database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `apiid` FROM %1 WHERE `identity` = :identity AND `apiid` = :apiid;").arg(DatabaseUtilities::getQualifiedTableName(*it, QStringLiteral("contact_messages"))));
+					query.bindValue(QStringLiteral(":identity"), QVariant(contact.toQString()));
+					query.bindValue(QStringLiteral(":apiid"), QVariant(messageId.toQString()));
+
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact message existance query for table contact_messages for identity \"" << contact.toString() << "\" and message ID \"" << messageId.toString() << "\". Query error: " << query.lastError().text().toStdString();
+					}
+					if (query.next()) {
+						return *it;
+					}
 				}
-				return query.next();
+				return QString();
 			}
 
 			ContactMessageType DatabaseContactMessage::getMessageType() const {
@@ -135,104 +151,51 @@ namespace openmittsu {
 				database->announceReceivedNewMessage(contact);
 			}
 
-			void DatabaseContactMessage::insertContactMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::ContactMessageBackupObject> const& messages) {
+			void DatabaseContactMessage::insertContactMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::ContactMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints) {
 				auto startTime = std::chrono::high_resolution_clock::now();
-				QVariantList identity;
-				identity.reserve(messages.size());
-				QVariantList apiid;
-				apiid.reserve(messages.size());
-				QVariantList uid;
-				uid.reserve(messages.size());
-				QVariantList isOutbox;
-				isOutbox.reserve(messages.size());
-				QVariantList isRead;
-				isRead.reserve(messages.size());
-				QVariantList isSaved;
-				isSaved.reserve(messages.size());
-				QVariantList messageState;
-				messageState.reserve(messages.size());
-				QVariantList sortBy;
-				sortBy.reserve(messages.size());
-				QVariantList createdAt;
-				createdAt.reserve(messages.size());
-				QVariantList sentAt;
-				sentAt.reserve(messages.size());
-				QVariantList receivedAt;
-				receivedAt.reserve(messages.size());
-				QVariantList seenAt;
-				seenAt.reserve(messages.size());
-				QVariantList modifiedAt;
-				modifiedAt.reserve(messages.size());
-				QVariantList type;
-				type.reserve(messages.size());
-				QVariantList body;
-				body.reserve(messages.size());
-				QVariantList isStatusMessage;
-				isStatusMessage.reserve(messages.size());
-				QVariantList isQueued;
-				isQueued.reserve(messages.size());
-				QVariantList isSent;
-				isSent.reserve(messages.size());
-				QVariantList caption;
-				caption.reserve(messages.size());
-
-				auto it = messages.constBegin();
-				auto end = messages.constEnd();
-				for (; it != end; ++it) {
-					identity.append(it->getContactId().toQString());
-					apiid.append(it->getApiId().toQString());
-					uid.append(it->getUuid());
-					isOutbox.append(it->getIsOutbox());
-					isRead.append(it->getIsRead());
-					isSaved.append(it->getIsSaved());
-					messageState.append(UserMessageStateHelper::toString(it->getMessageState()));
-					sortBy.append(((it->getIsOutbox()) ? (it->getCreatedAt().getMessageTimeMSecs()) : (it->getReceivedAt().getMessageTimeMSecs())));
-					createdAt.append((it->getCreatedAt().isNull()) ? QVariant() : QVariant(it->getCreatedAt().getMessageTimeMSecs()));
-					sentAt.append((it->getSentAt().isNull()) ? QVariant() : QVariant(it->getSentAt().getMessageTimeMSecs()));
-					receivedAt.append((it->getReceivedAt().isNull()) ? QVariant() : QVariant(it->getReceivedAt().getMessageTimeMSecs()));
-					seenAt.append((!it->getIsRead()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
-					modifiedAt.append((it->getModifiedAt().isNull()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
-					type.append(ContactMessageTypeHelper::toQString(it->getMessageType()));
-					body.append(it->getBody());
-					isStatusMessage.append(it->getIsStatusMessage());
-					isQueued.append(it->getIsQueued());
-					isSent.append(UserMessageStateHelper::isSent(it->getMessageState()));
-					caption.append(it->getCaption());
-				}
 
-				//if (!database.database.transaction()) {
 				if (!database->transactionStart()) {
 					LOGGER()->warn("Could NOT start transaction!");
 				}
 
-				QSqlQuery query(database->getQueryObject());
-				query.prepare(QStringLiteral("INSERT INTO `contact_messages` (`identity`, `apiid`, `uid`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `sort_by`, `created_at`, `sent_at`, `received_at`, `seen_at`, `modified_at`, `contact_message_type`, `body`, `is_statusmessage`, `is_queued`, `is_sent`, `caption`) VALUES "
-											 "(:identity, :apiid, :uid, :isOutbox, :isRead, :isSaved, :messageState, :sortBy, :createdAt, :sentAt, :receivedAt, :seenAt, :modifiedAt, :type, :body, :isStatusMessage, :isQueued, :isSent, :caption);"));
-				query.bindValue(QStringLiteral(":identity"), identity);
-				query.bindValue(QStringLiteral(":apiid"), apiid);
-				query.bindValue(QStringLiteral(":uid"), uid);
-				query.bindValue(QStringLiteral(":isOutbox"), isOutbox);
-				query.bindValue(QStringLiteral(":isRead"), isRead);
-				query.bindValue(QStringLiteral(":isSaved"), isSaved);
-				query.bindValue(QStringLiteral(":messageState"), messageState);
-				query.bindValue(QStringLiteral(":sortBy"), sortBy);
-				query.bindValue(QStringLiteral(":createdAt"), createdAt);
-				query.bindValue(QStringLiteral(":sentAt"), sentAt);
-				query.bindValue(QStringLiteral(":receivedAt"), receivedAt);
-				query.bindValue(QStringLiteral(":seenAt"), seenAt);
-				query.bindValue(QStringLiteral(":modifiedAt"), modifiedAt);
-				query.bindValue(QStringLiteral(":type"), type);
-				query.bindValue(QStringLiteral(":body"), body);
-				query.bindValue(QStringLiteral(":isStatusMessage"), isStatusMessage);
-				query.bindValue(QStringLiteral(":isQueued"), isQueued);
-				query.bindValue(QStringLiteral(":isSent"), isSent);
-				query.bindValue(QStringLiteral(":caption"), caption);
-
-				if (!query.execBatch()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not batch-insert contact message data into 'contact_messages'. Query error: " << query.lastError().text().toStdString();
+				// Messages already stored by an interrupted import of the same backup are skipped.
+				DatabaseBulkInsert insert(database, QStringLiteral("contact_messages"), { QStringLiteral("identity"), QStringLiteral("apiid"), QStringLiteral("uid"), QStringLiteral("is_outbox"), QStringLiteral("is_read"), QStringLiteral("is_saved"), QStringLiteral("messagestate"), QStringLiteral("sort_by"), QStringLiteral("created_at"), QStringLiteral("sent_at"), QStringLiteral("received_at"), QStringLiteral("seen_at"), QStringLiteral("modified_at"), QStringLiteral("contact_message_type"), QStringLiteral("body"), QStringLiteral("is_statusmessage"), QStringLiteral("is_queued"), QStringLiteral("is_sent"), QStringLiteral("caption") }, true);
+
+				// Batches hold long runs of messages from the same file, so the identity is converted once per run instead of once per message.
+				openmittsu::protocol::ContactId contact;
+				QString identity;
+				auto it = messages.constBegin();
+				auto end = messages.constEnd();
+				for (; it != end; ++it) {
+					if (identity.isEmpty() || (it->getContactId() != contact)) {
+						contact = it->getContactId();
+						identity = contact.toQString();
+					}
+
+					insert.addValue(identity);
+					insert.addValue(it->getApiId().toQString());
+					insert.addValue(it->getUuid());
+					insert.addValue(it->getIsOutbox());
+					insert.addValue(it->getIsRead());
+					insert.addValue(it->getIsSaved());
+					insert.addValue(UserMessageStateHelper::toString(it->getMessageState()));
+					insert.addValue(((it->getIsOutbox()) ? (it->getCreatedAt().getMessageTimeMSecs()) : (it->getReceivedAt().getMessageTimeMSecs())));
+					insert.addValue((it->getCreatedAt().isNull()) ? QVariant() : QVariant(it->getCreatedAt().getMessageTimeMSecs()));
+					insert.addValue((it->getSentAt().isNull()) ? QVariant() : QVariant(it->getSentAt().getMessageTimeMSecs()));
+					insert.addValue((it->getReceivedAt().isNull()) ? QVariant() : QVariant(it->getReceivedAt().getMessageTimeMSecs()));
+					insert.addValue((!it->getIsRead()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
+					insert.addValue((it->getModifiedAt().isNull()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
+					insert.addValue(ContactMessageTypeHelper::toQString(it->getMessageType()));
+					insert.addValue(it->getBody());
+					insert.addValue(it->getIsStatusMessage());
+					insert.addValue(it->getIsQueued());
+					insert.addValue(UserMessageStateHelper::isSent(it->getMessageState()));
+					insert.addValue(it->getCaption());
+					insert.endRow();
 				}
+				insert.finish();
+				DatabaseBackupImportJournal::storeCheckpoints(database, checkpoints);
 
-				//if (!database.database.commit()) {
 				if (!database->transactionCommit()) {
 					LOGGER()->warn("Could NOT commit transaction!");
 				}
@@ -243,8 +206,21 @@ namespace openmittsu {
 				timePerMsg /= messages.size();
 
 				LOGGER()->info("Inserting {} contact messages took {}ms, whick makes {}ms per message.", messages.size(), timeInMs, timePerMsg);
+			}
 
-				//insertContactMessage(database, message.getContactId(), message.getApiId(), message.getUuid(), message.getIsOutbox(), message.getIsRead(), message.getIsSaved(), message.getMessageState(), message.getCreatedAt(), message.getSentAt(), message.getReceivedAt(), seenAt, message.getModifiedAt(), message.getMessageType(), message.getBody(), message.getIsStatusMessage(), message.getIsQueued(), isSent, message.getCaption());
+			void DatabaseContactMessage::readMessageKeysForMerge(InternalDatabaseInterface const* database, MessageKeyCallback const& callback) {
+				QSqlQuery query(database->getQueryObject());
+				query.setForwardOnly(true);
+				query.prepare(QStringLiteral("SELECT `uid`, `identity`, `apiid`, `is_outbox` FROM %1;").arg(DatabaseUtilities::getTableInAllSchemas(database, QStringLiteral("contact_messages"))));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read contact message keys for merging a backup. Query error: " << query.lastError().text().toStdString();
+				}
+
+				// Columns by position, this runs once per stored message. The identity is both the conversation and the stored sender.
+				while (query.next()) {
+					QString const identity = query.value(1).toString();
+					callback(query.value(0).toString(), identity, identity, query.value(2).toString(), query.value(3).toBool());
+				}
 			}
 
 			QString DatabaseContactMessage::getContentAsText() const {
@@ -268,7 +244,8 @@ namespace openmittsu {
 				if ((messageType != ContactMessageType::IMAGE) && (messageType != ContactMessageType::AUDIO) && (messageType != ContactMessageType::FILE) && (messageType != ContactMessageType::VIDEO)) {
 					throw openmittsu::exceptions::InternalErrorException() << "Can not get content of contact message for message ID \"" << getMessageId().toString() << "\" as media file because it has type " << ContactMessageTypeHelper::toString(messageType) << "!";
 				}
-				return getMediaItem(getUid());
+				// The file is read and decrypted on the media I/O pool.
+				return getMediaItemHandle(getUid()).get();
 			}
 
 		}
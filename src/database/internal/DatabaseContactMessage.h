@@ -4,6 +4,7 @@
 #include <QList>
 #include <QString>
 
+#include "src/database/BackupImportCheckpoint.h"
 #include "src/protocol/ContactId.h"
 #include "src/database/internal/DatabaseUserMessage.h"
 #include "src/dataproviders/messages/ContactMessage.h"
@@ -32,9 +33,14 @@ namespace openmittsu {
 				static int getContactMessageCount(InternalDatabaseInterface const* database, openmittsu::protocol::ContactId const& contact);
 
 				static bool exists(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, openmittsu::protocol::MessageId const& messageId);
+				/** Returns the schema holding the given message, or an empty string if it does not exist in any storage tier. */
+				static QString findSchema(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, openmittsu::protocol::MessageId const& messageId);
 				static openmittsu::protocol::MessageId insertContactMessageFromUs(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, QString const& uuid, openmittsu::protocol::MessageTime const& createdAt, openmittsu::dataproviders::messages::ContactMessageType const& type, QString const& body, bool isQueued, bool isStatusMessage, QString const& caption);
 				static void insertContactMessageFromThem(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, openmittsu::protocol::MessageId const& messageId, QString const& uuid, openmittsu::protocol::MessageTime const& sentAt, openmittsu::protocol::MessageTime const& receivedAt, openmittsu::dataproviders::messages::ContactMessageType const& type, QString const& body, bool isStatusMessage, QString const& caption);
-				static void insertContactMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::ContactMessageBackupObject> const& messages);
+				/** Inserts the messages and stores the checkpoints covering them in one transaction. */
+				static void insertContactMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::ContactMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints);
+				/** Calls callback with the keys of every contact message in all schemas, in one sequential scan, for merging a backup into the database. */
+				static void readMessageKeysForMerge(InternalDatabaseInterface const* database, MessageKeyCallback const& callback);
 				static bool resetQueueStatus(InternalDatabaseInterface* database, int maxAgeInSeconds);
 			protected:
 				virtual QString getWhereString() const override;
@@ -1,6 +1,7 @@
 #include "src/database/internal/DatabaseContactMessageCursor.h"
 
 #include "src/database/SimpleDatabase.h"
+#include "src/database/internal/DatabaseUtilities.h"
 #include "src/exceptions/InternalErrorException.h"
 #include "src/utility/Logging.h"
 
@@ -55,7 +56,7 @@ namespace openmittsu {
 				// openmittsu::protocol::MessageTime const& modifiedAt, bool isQueued, bool isSent, QString const& uuid, bool isRead, bool isSaved, openmittsu::dataproviders::messages::UserMessageState const& messageState, 
 				// openmittsu::protocol::MessageTime const& receivedAt, openmittsu::protocol::MessageTime const& seenAt, bool isStatusMessage, QString const& caption, openmittsu::protocol::ContactId const& contact, 
 				// openmittsu::dataproviders::messages::ContactMessageType const& contactMessageType, QString const& body, MediaFileItem const& mediaItem
-				query.prepare(QStringLiteral("SELECT `identity`, `apiid`, `uid`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `sort_by`, `created_at`, `sent_at`, `received_at`, `seen_at`, `modified_at`, `contact_message_type`, `body`, `is_statusmessage`, `is_queued`, `is_sent`, `caption` FROM `contact_messages` WHERE `identity` = :identity AND `uid` = :uid;"));
+				query.prepare(QStringLiteral("SELECT `identity`, `apiid`, `uid`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `sort_by`, `created_at`, `sent_at`, `received_at`, `seen_at`, `modified_at`, `contact_message_type`, `body`, `is_statusmessage`, `is_queued`, `is_sent`, `caption` FROM %1 WHERE `identity` = :identity AND `uid` = :uid;").arg(DatabaseUtilities::getQualifiedTableName(getMessageSchema(), getTableName())));
 				bindWhereStringValues(query);
 				query.bindValue(QStringLiteral(":uid"), QVariant(getMessageUuid()));
 				if (!query.exec() || !query.isSelect() || !query.next()) {
@@ -81,11 +82,10 @@ namespace openmittsu {
 				openmittsu::dataproviders::messages::ContactMessageType const contactMessageType(openmittsu::dataproviders::messages::ContactMessageTypeHelper::fromString(query.value(QStringLiteral("contact_message_type")).toString()));
 				QString const body(query.value(QStringLiteral("body")).toString());
 
-				openmittsu::database::MediaFileItem mediaItem;
+				// Media is only read and decrypted once the message content is accessed, not for listing messages.
+				MediaItemHandle mediaItem;
 				if ((contactMessageType == openmittsu::dataproviders::messages::ContactMessageType::AUDIO) || (contactMessageType == openmittsu::dataproviders::messages::ContactMessageType::FILE) || (contactMessageType == openmittsu::dataproviders::messages::ContactMessageType::IMAGE) || (contactMessageType == openmittsu::dataproviders::messages::ContactMessageType::VIDEO)) {
-					mediaItem = getDatabase()->getMediaItem(uuid, MediaFileType::TYPE_STANDARD);
-				} else {
-					mediaItem = MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, MediaFileType::TYPE_STANDARD);
+					mediaItem = getDatabase()->getMediaItemHandle(uuid, MediaFileType::TYPE_STANDARD);
 				}
 
 				auto drcm = std::make_shared<DatabaseReadonlyContactMessage>(contact, messageId, isMessageFromUs, createdAt, sentAt, modifiedAt, isQueued, isSent, uuid, isRead, isSaved, messageState, receivedAt, seenAt, isStatusMessage, caption, contactMessageType, body, mediaItem);
@@ -136,7 +136,7 @@ namespace openmittsu {
 			void DatabaseContactMessageCursor::deletionHelper(InternalDatabaseInterface* database, openmittsu::protocol::ContactId const& contact, QString const& whereAndOrderQueryPart) {
 				database->transactionStart();
 				QVector<QString> uuids;
-				QString const selectQuery = QStringLiteral("SELECT `uid` FROM `contact_messages` WHERE `identity` = :identity %1").arg(whereAndOrderQueryPart);
+				QString const selectQuery = QStringLiteral("SELECT `uid` FROM %2 WHERE `identity` = :identity %1").arg(whereAndOrderQueryPart).arg(DatabaseUtilities::getTableInAllSchemas(database, QStringLiteral("contact_messages")));
 				{
 					QSqlQuery query(database->getQueryObject());
 					if (!query.prepare(selectQuery)) {
@@ -152,18 +152,7 @@ namespace openmittsu {
 						uuids.append(uuid);
 					}
 				}
-				{
-					QSqlQuery query(database->getQueryObject());
-					QString const deleteQuery = QStringLiteral("DELETE FROM `contact_messages` WHERE `uid` in (%1)").arg(selectQuery);
-					if (!query.prepare(deleteQuery)) {
-						throw openmittsu::exceptions::InternalErrorException() << "Could not prepare contact message mass deletion query. SQL error: " << query.lastError().text().toStdString();
-					}
-					query.bindValue(QStringLiteral(":identity"), QVariant(contact.toQString()));
-					if (!query.exec()) {
-						throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact message mass deletion query for table contact_messages. Query error: " << query.lastError().text().toStdString();
-					}
-					
-				}
+				DatabaseUtilities::deleteMessagesInAllSchemas(database, QStringLiteral("contact_messages"), uuids);
 				{
 					auto it = uuids.constBegin();
 					auto const end = uuids.constEnd();
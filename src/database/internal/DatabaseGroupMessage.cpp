@@ -1,6 +1,8 @@
 #include "src/database/internal/DatabaseGroupMessage.h"
 
 #include "src/backup/GroupMessageBackupObject.h"
+#include "src/database/internal/DatabaseBackupImportJournal.h"
+#include "src/database/internal/DatabaseBulkInsert.h"
 #include "src/database/internal/InternalDatabaseInterface.h"
 #include "src/database/internal/DatabaseUtilities.h"
 #include "src/exceptions/InternalErrorException.h"
@@ -15,9 +17,11 @@ namespace openmittsu {
 			using namespace openmittsu::dataproviders::messages;
 
 			DatabaseGroupMessage::DatabaseGroupMessage(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, openmittsu::protocol::MessageId const& messageId) : DatabaseMessage(database, messageId), DatabaseUserMessage(database, messageId), GroupMessage(), m_group(group) {
-				if (!exists(database, group, messageId)) {
+				QString const schema = findSchema(database, group, messageId);
+				if (schema.isEmpty()) {
 					throw openmittsu::exceptions::InternalErrorException() << "No message from group \"" << group.toString() << "\" and message ID \"" << messageId.toString() << "\" exists, can not manipulate.";
 				}
+				setSchema(schema);
 			}
 
 			DatabaseGroupMessage::~DatabaseGroupMessage() {
@@ -29,24 +33,36 @@ namespace openmittsu {
 			}
 
 			int DatabaseGroupMessage::getGroupMessageCount(InternalDatabaseInterface const* database) {
-				return openmittsu::database::internal::DatabaseUtilities::countQuery(database, QStringLiteral("group_messages"));
+				return openmittsu::database::internal::DatabaseUtilities::countQueryInAllSchemas(database, QStringLiteral("group_messages"));
 			}
 
 			int DatabaseGroupMessage::getGroupMessageCount(InternalDatabaseInterface const* database, openmittsu::protocol::GroupId const& group) {
-				return openmittsu::database::internal::DatabaseUtilities::countQuery(database, QStringLiteral("group_messages"), { { QStringLiteral("group_id"), group.groupIdWithoutOwnerToQString() }, { QStringLiteral("group_creator"), group.getOwner().toQString() } });
+				return openmittsu::database::internal::DatabaseUtilities::countQueryInAllSchemas(database, QStringLiteral("group_messages"), { { QStringLiteral("group_id"), group.groupIdWithoutOwnerToQString() }, { QStringLiteral("group_creator"), group.getOwner().toQString() } });
 			}
 
 			bool DatabaseGroupMessage::exists(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, openmittsu::protocol::MessageId const& messageId) {
-				QSqlQuery query(database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `apiid` FROM `group_messages` WHERE `group_id` = :groupId AND `group_creator` = :groupCreator AND `apiid` = :apiid;"));
-				query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
-				query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
-				query.bindValue(QStringLiteral(":apiid"), QVariant(messageId.toQString()));
+				return !findSchema(database, group, messageId).isEmpty();
+			}
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute group message existance query for table contact_messages for group \"" << group.toString() << "\" and message ID \"" << messageId.toString() << "\". Query error: " << query.lastError().text().toStdString();
+			QString DatabaseGroupMessage::findSchema(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, openmittsu::protocol::MessageId const& messageId) {
+				QStringList const schemas = database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery query(database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `apiid` FROM %1 WHERE `group_id` = :groupId AND `group_creator` = :groupCreator AND `apiid` = :apiid;").arg(DatabaseUtilities::getQualifiedTableName(*it, QStringLiteral("group_messages"))));
+					query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
+					query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
+					query.bindValue(QStringLiteral(":apiid"), QVariant(messageId.toQString()));
+
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute group message existance query for table group_messages for group \"" << group.toString() << "\" and message ID \"" << messageId.toString() << "\". Query error: " << query.lastError().text().toStdString();
+					}
+					if (query.next()) {
+						return *it;
+					}
 				}
-				return query.next();
+				return QString();
 			}
 
 			GroupMessageType DatabaseGroupMessage::getMessageType() const {
@@ -136,110 +152,54 @@ namespace openmittsu {
 				database->announceReceivedNewMessage(group);
 			}
 
-			void DatabaseGroupMessage::insertGroupMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::GroupMessageBackupObject> const& messages) {
+			void DatabaseGroupMessage::insertGroupMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::GroupMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints) {
 				auto startTime = std::chrono::high_resolution_clock::now();
-				QVariantList groupId;
-				groupId.reserve(messages.size());
-				QVariantList groupCreator;
-				groupCreator.reserve(messages.size());
-				QVariantList identity;
-				identity.reserve(messages.size());
-				QVariantList apiid;
-				apiid.reserve(messages.size());
-				QVariantList uid;
-				uid.reserve(messages.size());
-				QVariantList isOutbox;
-				isOutbox.reserve(messages.size());
-				QVariantList isRead;
-				isRead.reserve(messages.size());
-				QVariantList isSaved;
-				isSaved.reserve(messages.size());
-				QVariantList messageState;
-				messageState.reserve(messages.size());
-				QVariantList sortBy;
-				sortBy.reserve(messages.size());
-				QVariantList createdAt;
-				createdAt.reserve(messages.size());
-				QVariantList sentAt;
-				sentAt.reserve(messages.size());
-				QVariantList receivedAt;
-				receivedAt.reserve(messages.size());
-				QVariantList seenAt;
-				seenAt.reserve(messages.size());
-				QVariantList modifiedAt;
-				modifiedAt.reserve(messages.size());
-				QVariantList type;
-				type.reserve(messages.size());
-				QVariantList body;
-				body.reserve(messages.size());
-				QVariantList isStatusMessage;
-				isStatusMessage.reserve(messages.size());
-				QVariantList isQueued;
-				isQueued.reserve(messages.size());
-				QVariantList isSent;
-				isSent.reserve(messages.size());
-				QVariantList caption;
-				caption.reserve(messages.size());
-
-				auto it = messages.constBegin();
-				auto end = messages.constEnd();
-				for (; it != end; ++it) {
-					groupId.append(it->getGroupId().groupIdWithoutOwnerToQString());
-					groupCreator.append(it->getGroupId().getOwner().toQString());
-					identity.append(it->getContactId().toQString());
-					apiid.append(it->getApiId().toQString());
-					uid.append(it->getUuid());
-					isOutbox.append(it->getIsOutbox());
-					isRead.append(it->getIsRead());
-					isSaved.append(it->getIsSaved());
-					messageState.append(UserMessageStateHelper::toString(it->getMessageState()));
-					sortBy.append(((it->getIsOutbox()) ? (it->getCreatedAt().getMessageTimeMSecs()) : (it->getReceivedAt().getMessageTimeMSecs())));
-					createdAt.append((it->getCreatedAt().isNull()) ? QVariant() : QVariant(it->getCreatedAt().getMessageTimeMSecs()));
-					sentAt.append((it->getSentAt().isNull()) ? QVariant() : QVariant(it->getSentAt().getMessageTimeMSecs()));
-					receivedAt.append((it->getReceivedAt().isNull()) ? QVariant() : QVariant(it->getReceivedAt().getMessageTimeMSecs()));
-					seenAt.append((!it->getIsRead()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
-					modifiedAt.append((it->getModifiedAt().isNull()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
-					type.append(GroupMessageTypeHelper::toQString(it->getMessageType()));
-					body.append(it->getBody());
-					isStatusMessage.append(it->getIsStatusMessage());
-					isQueued.append(it->getIsQueued());
-					isSent.append(UserMessageStateHelper::isSent(it->getMessageState()));
-					caption.append(it->getCaption());
-				}
 
 				if (!database->transactionStart()) {
 					LOGGER()->warn("Could NOT start transaction!");
 				}
 
-				QSqlQuery query(database->getQueryObject());
-				query.prepare(QStringLiteral("INSERT INTO `group_messages` (`group_id`, `group_creator`, `apiid`, `uid`, `identity`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `sort_by`, `created_at`, `sent_at`, `received_at`, `seen_at`, `modified_at`, `group_message_type`, `body`, `is_statusmessage`, `is_queued`, `is_sent`, `caption`) VALUES "
-											 "(:groupId, :groupCreator, :apiid, :uid, :identity, :isOutbox, :isRead, :isSaved, :messageState, :sortBy, :createdAt, :sentAt, :receivedAt, :seenAt, :modifiedAt, :type, :body, :isStatusMessage, :isQueued, :isSent, :caption);"));
-				query.bindValue(QStringLiteral(":groupId"), groupId);
-				query.bindValue(QStringLiteral(":groupCreator"), groupCreator);
-				query.bindValue(QStringLiteral(":identity"), identity);
-				query.bindValue(QStringLiteral(":apiid"), apiid);
-				query.bindValue(QStringLiteral(":uid"), uid);
-				query.bindValue(QStringLiteral(":isOutbox"), isOutbox);
-				query.bindValue(QStringLiteral(":isRead"), isRead);
-				query.bindValue(QStringLiteral(":isSaved"), isSaved);
-				query.bindValue(QStringLiteral(":messageState"), messageState);
-				query.bindValue(QStringLiteral(":sortBy"), sortBy);
-				query.bindValue(QStringLiteral(":createdAt"), createdAt);
-				query.bindValue(QStringLiteral(":sentAt"), sentAt);
-				query.bindValue(QStringLiteral(":receivedAt"), receivedAt);
-				query.bindValue(QStringLiteral(":seenAt"), seenAt);
-				query.bindValue(QStringLiteral(":modifiedAt"), modifiedAt);
-				query.bindValue(QStringLiteral(":type"), type);
-				query.bindValue(QStringLiteral(":body"), body);
-				query.bindValue(QStringLiteral(":isStatusMessage"), isStatusMessage);
-				query.bindValue(QStringLiteral(":isQueued"), isQueued);
-				query.bindValue(QStringLiteral(":isSent"), isSent);
-				query.bindValue(QStringLiteral(":caption"), caption);
-
-				if (!query.execBatch()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not batch-insert group message data into 'group_messages'. Query error: " << query.lastError().text().toStdString();
+				// Messages already stored by an interrupted import of the same backup are skipped.
+				DatabaseBulkInsert insert(database, QStringLiteral("group_messages"), { QStringLiteral("group_id"), QStringLiteral("group_creator"), QStringLiteral("apiid"), QStringLiteral("uid"), QStringLiteral("identity"), QStringLiteral("is_outbox"), QStringLiteral("is_read"), QStringLiteral("is_saved"), QStringLiteral("messagestate"), QStringLiteral("sort_by"), QStringLiteral("created_at"), QStringLiteral("sent_at"), QStringLiteral("received_at"), QStringLiteral("seen_at"), QStringLiteral("modified_at"), QStringLiteral("group_message_type"), QStringLiteral("body"), QStringLiteral("is_statusmessage"), QStringLiteral("is_queued"), QStringLiteral("is_sent"), QStringLiteral("caption") }, true);
+
+				// The group columns are converted once per run of messages from the same file.
+				openmittsu::protocol::GroupId group(0, 0);
+				QString groupId;
+				QString groupCreator;
+				auto it = messages.constBegin();
+				auto end = messages.constEnd();
+				for (; it != end; ++it) {
+					if (groupId.isEmpty() || (it->getGroupId() != group)) {
+						group = it->getGroupId();
+						groupId = group.groupIdWithoutOwnerToQString();
+						groupCreator = group.getOwner().toQString();
+					}
+
+					insert.addValue(groupId);
+					insert.addValue(groupCreator);
+					insert.addValue(it->getApiId().toQString());
+					insert.addValue(it->getUuid());
+					insert.addValue(it->getContactId().toQString());
+					insert.addValue(it->getIsOutbox());
+					insert.addValue(it->getIsRead());
+					insert.addValue(it->getIsSaved());
+					insert.addValue(UserMessageStateHelper::toString(it->getMessageState()));
+					insert.addValue(((it->getIsOutbox()) ? (it->getCreatedAt().getMessageTimeMSecs()) : (it->getReceivedAt().getMessageTimeMSecs())));
+					insert.addValue((it->getCreatedAt().isNull()) ? QVariant() : QVariant(it->getCreatedAt().getMessageTimeMSecs()));
+					insert.addValue((it->getSentAt().isNull()) ? QVariant() : QVariant(it->getSentAt().getMessageTimeMSecs()));
+					insert.addValue((it->getReceivedAt().isNull()) ? QVariant() : QVariant(it->getReceivedAt().getMessageTimeMSecs()));
+					insert.addValue((!it->getIsRead()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
+					insert.addValue((it->getModifiedAt().isNull()) ? QVariant() : QVariant(it->getModifiedAt().getMessageTimeMSecs()));
+					insert.addValue(GroupMessageTypeHelper::toQString(it->getMessageType()));
+					insert.addValue(it->getBody());
+					insert.addValue(it->getIsStatusMessage());
+					insert.addValue(it->getIsQueued());
+					insert.addValue(UserMessageStateHelper::isSent(it->getMessageState()));
+					insert.addValue(it->getCaption());
+					insert.endRow();
 				}
-				// insertGroupMessage(database, message.getGroupId(), message.getContactId(), message.getApiId(), message.getUuid(), message.getIsOutbox(), message.getIsRead(), message.getIsSaved(), message.getMessageState(), message.getCreatedAt(), message.getSentAt(), message.getReceivedAt(), seenAt, message.getModifiedAt(), message.getMessageType(), message.getBody(), message.getIsStatusMessage(), message.getIsQueued(), isSent, message.getCaption());
+				insert.finish();
+				DatabaseBackupImportJournal::storeCheckpoints(database, checkpoints);
 
 				if (!database->transactionCommit()) {
 					LOGGER()->info("Could NOT commit transaction!");
@@ -252,6 +212,20 @@ namespace openmittsu {
 				LOGGER()->info("Inserting {} group messages took {}ms, whick makes {}ms per message.", messages.size(), timeInMs, timePerMsg);
 			}
 
+			void DatabaseGroupMessage::readMessageKeysForMerge(InternalDatabaseInterface const* database, MessageKeyCallback const& callback) {
+				QSqlQuery query(database->getQueryObject());
+				query.setForwardOnly(true);
+				query.prepare(QStringLiteral("SELECT `uid`, `group_creator` || ':' || `group_id`, `identity`, `apiid`, `is_outbox` FROM %1;").arg(DatabaseUtilities::getTableInAllSchemas(database, QStringLiteral("group_messages"))));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not read group message keys for merging a backup. Query error: " << query.lastError().text().toStdString();
+				}
+
+				// Columns by position, this runs once per stored message.
+				while (query.next()) {
+					callback(query.value(0).toString(), query.value(1).toString(), query.value(2).toString(), query.value(3).toString(), query.value(4).toBool());
+				}
+			}
+
 			QString DatabaseGroupMessage::getContentAsText() const {
 				GroupMessageType const messageType = getMessageType();
 				if ((messageType != GroupMessageType::TEXT) && (messageType != GroupMessageType::AUDIO) && (messageType != GroupMessageType::SET_IMAGE) && (messageType != GroupMessageType::SET_TITLE) && (messageType != GroupMessageType::GROUP_CREATION) && (messageType != GroupMessageType::LEAVE) && (messageType != GroupMessageType::SYNC_REQUEST)) {
@@ -273,7 +247,8 @@ namespace openmittsu {
 				if ((messageType != GroupMessageType::IMAGE) && (messageType != GroupMessageType::AUDIO) && (messageType != GroupMessageType::FILE) && (messageType != GroupMessageType::VIDEO)) {
 					throw openmittsu::exceptions::InternalErrorException() << "Can not get content of group message for message ID \"" << getMessageId().toString() << "\" as media file because it has type " << GroupMessageTypeHelper::toString(messageType) << "!";
 				}
-				return getMediaItem(getUid());
+				// The file is read and decrypted on the media I/O pool.
+				return getMediaItemHandle(getUid()).get();
 			}
 
 		}
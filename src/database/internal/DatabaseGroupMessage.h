@@ -4,6 +4,7 @@
 #include <QList>
 #include <QString>
 
+#include "src/database/BackupImportCheckpoint.h"
 #include "src/protocol/ContactId.h"
 #include "src/protocol/GroupId.h"
 #include "src/database/internal/DatabaseUserMessage.h"
@@ -34,9 +35,14 @@ namespace openmittsu {
 				static int getGroupMessageCount(InternalDatabaseInterface const* database, openmittsu::protocol::GroupId const& group);
 
 				static bool exists(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, openmittsu::protocol::MessageId const& messageId);
+				/** Returns the schema holding the given message, or an empty string if it does not exist in any storage tier. */
+				static QString findSchema(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, openmittsu::protocol::MessageId const& messageId);
 				static openmittsu::protocol::MessageId insertGroupMessageFromUs(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, QString const& uuid, openmittsu::protocol::MessageTime const& createdAt, openmittsu::dataproviders::messages::GroupMessageType const& type, QString const& body, bool isQueued, bool isStatusMessage, QString const& caption);
 				static void insertGroupMessageFromThem(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, openmittsu::protocol::ContactId const& sender, openmittsu::protocol::MessageId const& messageId, QString const& uuid, openmittsu::protocol::MessageTime const& sentAt, openmittsu::protocol::MessageTime const& receivedAt, openmittsu::dataproviders::messages::GroupMessageType const& type, QString const& body, bool isStatusMessage, QString const& caption);
-				static void insertGroupMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::GroupMessageBackupObject> const& messages);
+				/** Inserts the messages and stores the checkpoints covering them in one transaction. */
+				static void insertGroupMessagesFromBackup(InternalDatabaseInterface* database, QList<openmittsu::backup::GroupMessageBackupObject> const& messages, QList<BackupImportCheckpoint> const& checkpoints);
+				/** Calls callback with the keys of every group message in all schemas, in one sequential scan, for merging a backup into the database. */
+				static void readMessageKeysForMerge(InternalDatabaseInterface const* database, MessageKeyCallback const& callback);
 				static bool resetQueueStatus(InternalDatabaseInterface* database, int maxAgeInSeconds);
 			protected:
 				virtual QString getWhereString() const override;
@@ -1,6 +1,7 @@
 #include "src/database/internal/DatabaseGroupMessageCursor.h"
 
 #include "src/database/SimpleDatabase.h"
+#include "src/database/internal/DatabaseUtilities.h"
 #include "src/exceptions/InternalErrorException.h"
 #include "src/utility/Logging.h"
 
@@ -50,7 +51,7 @@ namespace openmittsu {
 				}
 
 				QSqlQuery query(getDatabase()->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `group_id`, `group_creator`, `apiid`, `uid`, `identity`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `sort_by`, `created_at`, `sent_at`, `received_at`, `seen_at`, `modified_at`, `group_message_type`, `body`, `is_statusmessage`, `is_queued`, `is_sent`, `caption` FROM `group_messages` WHERE `group_id` = :groupId AND `group_creator` = :groupCreator AND `uid` = :uid;"));
+				query.prepare(QStringLiteral("SELECT `group_id`, `group_creator`, `apiid`, `uid`, `identity`, `is_outbox`, `is_read`, `is_saved`, `messagestate`, `sort_by`, `created_at`, `sent_at`, `received_at`, `seen_at`, `modified_at`, `group_message_type`, `body`, `is_statusmessage`, `is_queued`, `is_sent`, `caption` FROM %1 WHERE `group_id` = :groupId AND `group_creator` = :groupCreator AND `uid` = :uid;").arg(DatabaseUtilities::getQualifiedTableName(getMessageSchema(), getTableName())));
 				bindWhereStringValues(query);
 				query.bindValue(QStringLiteral(":uid"), QVariant(getMessageUuid()));
 				if (!query.exec() || !query.isSelect() || !query.next()) {
@@ -76,11 +77,10 @@ namespace openmittsu {
 				openmittsu::dataproviders::messages::GroupMessageType const groupMessageType(openmittsu::dataproviders::messages::GroupMessageTypeHelper::fromString(query.value(QStringLiteral("group_message_type")).toString()));
 				QString const body(query.value(QStringLiteral("body")).toString());
 
-				openmittsu::database::MediaFileItem mediaItem;
+				// Media is only read and decrypted once the message content is accessed, not for listing messages.
+				MediaItemHandle mediaItem;
 				if ((groupMessageType == openmittsu::dataproviders::messages::GroupMessageType::AUDIO) || (groupMessageType == openmittsu::dataproviders::messages::GroupMessageType::FILE) || (groupMessageType == openmittsu::dataproviders::messages::GroupMessageType::IMAGE) || (groupMessageType == openmittsu::dataproviders::messages::GroupMessageType::VIDEO)) {
-					mediaItem = getDatabase()->getMediaItem(uuid, MediaFileType::TYPE_STANDARD);
-				} else {
-					mediaItem = MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, MediaFileType::TYPE_STANDARD);
+					mediaItem = getDatabase()->getMediaItemHandle(uuid, MediaFileType::TYPE_STANDARD);
 				}
 
 				auto drgm = std::make_shared<DatabaseReadonlyGroupMessage>(m_group, contact, messageId, isMessageFromUs, createdAt, sentAt, modifiedAt, isQueued, isSent, uuid, isRead, isSaved, messageState, receivedAt, seenAt, isStatusMessage, caption, groupMessageType, body, mediaItem);
@@ -132,7 +132,7 @@ namespace openmittsu {
 			void DatabaseGroupMessageCursor::deletionHelper(InternalDatabaseInterface* database, openmittsu::protocol::GroupId const& group, QString const& whereAndOrderQueryPart) {
 				database->transactionStart();
 				QVector<QString> uuids;
-				QString const selectQuery = QStringLiteral("SELECT `uid` FROM `group_messages` WHERE `group_id` = :groupId AND `group_creator` = :groupCreator %1").arg(whereAndOrderQueryPart);
+				QString const selectQuery = QStringLiteral("SELECT `uid` FROM %2 WHERE `group_id` = :groupId AND `group_creator` = :groupCreator %1").arg(whereAndOrderQueryPart).arg(DatabaseUtilities::getTableInAllSchemas(database, QStringLiteral("group_messages")));
 				{
 					QSqlQuery query(database->getQueryObject());
 					if (!query.prepare(selectQuery)) {
@@ -149,18 +149,7 @@ namespace openmittsu {
 						uuids.append(uuid);
 					}
 				}
-				{
-					QSqlQuery query(database->getQueryObject());
-					QString const deleteQuery = QStringLiteral("DELETE FROM `group_messages` WHERE `uid` in (%1)").arg(selectQuery);
-					if (!query.prepare(deleteQuery)) {
-						throw openmittsu::exceptions::InternalErrorException() << "Could not prepare group message mass deletion query. SQL error: " << query.lastError().text().toStdString();
-					}
-					query.bindValue(QStringLiteral(":groupId"), QVariant(group.groupIdWithoutOwnerToQString()));
-					query.bindValue(QStringLiteral(":groupCreator"), QVariant(group.getOwner().toQString()));
-					if (!query.exec()) {
-						throw openmittsu::exceptions::InternalErrorException() << "Could not execute group message mass deletion query for table group_messages. Query error: " << query.lastError().text().toStdString();
-					}
-				}
+				DatabaseUtilities::deleteMessagesInAllSchemas(database, QStringLiteral("group_messages"), uuids);
 				{
 					auto it = uuids.constBegin();
 					auto const end = uuids.constEnd();
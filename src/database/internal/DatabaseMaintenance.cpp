@@ -0,0 +1,437 @@
+#include "src/database/internal/DatabaseMaintenance.h"
+
+#include "src/database/internal/DatabaseArchive.h"
+#include "src/database/internal/DatabaseUtilities.h"
+#include "src/database/internal/InternalDatabaseInterface.h"
+#include "src/database/internal/MediaFileStorage.h"
+#include "src/database/internal/MediaQuota.h"
+#include "src/exceptions/InternalErrorException.h"
+#include "src/utility/Logging.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+
+#include <limits>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			namespace {
+				int const archivedMessagesPerStep = 128;
+				int const orphanedMediaRowsPerStep = 64;
+				int const migratedMediaItemsPerStep = 16;
+				/** Migrations are written on the media I/O pool, more queued writes would only hold temporary files until the database thread stores them. */
+				int const maxPendingMediaWrites = 4 * migratedMediaItemsPerStep;
+				int const shardedMediaFilesPerStep = 256;
+				int const evictedMediaItemsPerStep = 32;
+				int const orphanedMediaFilesPerStep = 64;
+				int const vacuumPagesPerStep = 256;
+
+				QString const optionNameJob = QStringLiteral("maintenance_job");
+				QString const optionNameCursor = QStringLiteral("maintenance_cursor");
+				QString const optionNameLastCompleted = QStringLiteral("maintenance_last_completed");
+				QString const optionNameRunsCompleted = QStringLiteral("maintenance_runs_completed");
+				QString const optionNameMessagesArchived = QStringLiteral("maintenance_messages_archived");
+				QString const optionNameMediaRowsRemoved = QStringLiteral("maintenance_media_rows_removed");
+				QString const optionNameMediaFilesMigrated = QStringLiteral("maintenance_media_files_migrated");
+				QString const optionNameMediaFilesRemoved = QStringLiteral("maintenance_media_files_removed");
+				QString const optionNameMediaItemsEvicted = QStringLiteral("maintenance_media_items_evicted");
+				QString const optionNamePagesFreed = QStringLiteral("maintenance_pages_freed");
+			}
+
+			DatabaseMaintenance::DatabaseMaintenance(InternalDatabaseInterface* database, MediaFileStorage* mediaFileStorage, DatabaseArchive* archive, MediaQuota* mediaQuota) : m_database(database), m_mediaFileStorage(mediaFileStorage), m_archive(archive), m_mediaQuota(mediaQuota), m_isCancelled(false), m_lastActivity(QDateTime::currentMSecsSinceEpoch()), m_isStateLoaded(false), m_isRunInProgress(false), m_isWaitingForMediaWrites(false), m_job(Job::ARCHIVE_MESSAGES), m_cursor(), m_mediaQuotaPass(MediaQuota::startPass()), m_statistics({ 0, 0, 0, 0, 0, 0, 0, 0 }) {
+				//
+			}
+
+			DatabaseMaintenance::~DatabaseMaintenance() {
+				// Intentionally left empty.
+			}
+
+			int DatabaseMaintenance::getMaintenanceIntervalInSeconds() {
+				return 24 * 60 * 60;
+			}
+
+			int DatabaseMaintenance::getIdleThresholdInSeconds() {
+				return 5 * 60;
+			}
+
+			bool DatabaseMaintenance::isDue() {
+				ensureStateLoaded();
+				if (m_isRunInProgress) {
+					return true;
+				}
+
+				return (QDateTime::currentMSecsSinceEpoch() - m_statistics.lastCompletedAt) >= (getMaintenanceIntervalInSeconds() * Q_INT64_C(1000));
+			}
+
+			bool DatabaseMaintenance::isIdle() const {
+				return (QDateTime::currentMSecsSinceEpoch() - m_lastActivity.load()) >= (getIdleThresholdInSeconds() * Q_INT64_C(1000));
+			}
+
+			void DatabaseMaintenance::notifyActivity() {
+				m_lastActivity.store(QDateTime::currentMSecsSinceEpoch());
+			}
+
+			void DatabaseMaintenance::cancel() {
+				m_isCancelled.store(true);
+				notifyActivity();
+			}
+
+			DatabaseMaintenance::Statistics DatabaseMaintenance::getStatistics() {
+				ensureStateLoaded();
+				return m_statistics;
+			}
+
+			bool DatabaseMaintenance::runSlice(qint64 timeBudgetInMs) {
+				ensureStateLoaded();
+				m_isCancelled.store(false);
+				m_isWaitingForMediaWrites = false;
+
+				if (!m_isRunInProgress) {
+					LOGGER_DEBUG("Starting database maintenance run.");
+					m_isRunInProgress = true;
+					m_job = Job::ARCHIVE_MESSAGES;
+					m_cursor.clear();
+				}
+
+				QElapsedTimer timer;
+				timer.start();
+
+				bool isRunCompleted = false;
+				try {
+					do {
+						if (runStep()) {
+							if (m_job == Job::INCREMENTAL_VACUUM) {
+								completeRun();
+								isRunCompleted = true;
+								break;
+							}
+							m_job = static_cast<Job>(static_cast<int>(m_job) + 1);
+							m_cursor.clear();
+						}
+					} while ((!m_isCancelled.load()) && (!m_isWaitingForMediaWrites) && (timer.elapsed() < timeBudgetInMs));
+				} catch (...) {
+					saveState();
+					throw;
+				}
+
+				saveState();
+				return isRunCompleted;
+			}
+
+			void DatabaseMaintenance::runToCompletion() {
+				while (!runSlice(std::numeric_limits<qint64>::max())) {
+					if (m_isCancelled.load()) {
+						break;
+					}
+
+					// The slice stopped to let the media I/O pool catch up, which is waited for here.
+					m_mediaFileStorage->completePendingWrites();
+				}
+				m_mediaFileStorage->completePendingWrites();
+			}
+
+			void DatabaseMaintenance::completeRun() {
+				m_isRunInProgress = false;
+				m_job = Job::ARCHIVE_MESSAGES;
+				m_cursor.clear();
+				m_statistics.lastCompletedAt = QDateTime::currentMSecsSinceEpoch();
+				m_statistics.runsCompleted += 1;
+
+				LOGGER()->info("Database maintenance run completed. Totals so far: {} messages archived, {} orphaned media entries removed, {} media files migrated, {} media items evicted, {} orphaned media files removed, {} pages freed.", m_statistics.messagesArchived, m_statistics.mediaRowsRemoved, m_statistics.mediaFilesMigrated, m_statistics.mediaItemsEvicted, m_statistics.mediaFilesRemoved, m_statistics.pagesFreed);
+			}
+
+			void DatabaseMaintenance::ensureStateLoaded() {
+				if (m_isStateLoaded) {
+					return;
+				}
+
+				auto readNumber = [this](QString const& optionName) -> qint64 {
+					if (!m_database->hasInternalOption(optionName)) {
+						return 0;
+					}
+					return m_database->getInternalOptionValue(optionName).toLongLong();
+				};
+
+				qint64 const job = m_database->hasInternalOption(optionNameJob) ? readNumber(optionNameJob) : -1;
+				if ((job >= static_cast<int>(Job::ARCHIVE_MESSAGES)) && (job <= static_cast<int>(Job::INCREMENTAL_VACUUM))) {
+					m_isRunInProgress = true;
+					m_job = static_cast<Job>(job);
+					m_cursor = m_database->hasInternalOption(optionNameCursor) ? m_database->getInternalOptionValue(optionNameCursor) : QString();
+				} else {
+					m_isRunInProgress = false;
+					m_job = Job::ARCHIVE_MESSAGES;
+					m_cursor.clear();
+				}
+
+				m_statistics.lastCompletedAt = readNumber(optionNameLastCompleted);
+				m_statistics.runsCompleted = readNumber(optionNameRunsCompleted);
+				m_statistics.messagesArchived = readNumber(optionNameMessagesArchived);
+				m_statistics.mediaRowsRemoved = readNumber(optionNameMediaRowsRemoved);
+				m_statistics.mediaFilesMigrated = readNumber(optionNameMediaFilesMigrated);
+				m_statistics.mediaFilesRemoved = readNumber(optionNameMediaFilesRemoved);
+				m_statistics.mediaItemsEvicted = readNumber(optionNameMediaItemsEvicted);
+				m_statistics.pagesFreed = readNumber(optionNamePagesFreed);
+
+				m_isStateLoaded = true;
+			}
+
+			void DatabaseMaintenance::saveState() {
+				if (!m_database->transactionStart()) {
+					LOGGER()->warn("DatabaseMaintenance: Could NOT start transaction!");
+				}
+
+				m_database->setInternalOptionValue(optionNameJob, QString::number(m_isRunInProgress ? static_cast<int>(m_job) : -1));
+				m_database->setInternalOptionValue(optionNameCursor, m_cursor);
+				m_database->setInternalOptionValue(optionNameLastCompleted, QString::number(m_statistics.lastCompletedAt));
+				m_database->setInternalOptionValue(optionNameRunsCompleted, QString::number(m_statistics.runsCompleted));
+				m_database->setInternalOptionValue(optionNameMessagesArchived, QString::number(m_statistics.messagesArchived));
+				m_database->setInternalOptionValue(optionNameMediaRowsRemoved, QString::number(m_statistics.mediaRowsRemoved));
+				m_database->setInternalOptionValue(optionNameMediaFilesMigrated, QString::number(m_statistics.mediaFilesMigrated));
+				m_database->setInternalOptionValue(optionNameMediaFilesRemoved, QString::number(m_statistics.mediaFilesRemoved));
+				m_database->setInternalOptionValue(optionNameMediaItemsEvicted, QString::number(m_statistics.mediaItemsEvicted));
+				m_database->setInternalOptionValue(optionNamePagesFreed, QString::number(m_statistics.pagesFreed));
+
+				if (!m_database->transactionCommit()) {
+					LOGGER()->warn("DatabaseMaintenance: Could NOT commit transaction!");
+				}
+			}
+
+			bool DatabaseMaintenance::runStep() {
+				switch (m_job) {
+					case Job::ARCHIVE_MESSAGES:
+						return runStepArchiveMessages();
+					case Job::REMOVE_ORPHANED_MEDIA_ROWS:
+						return runStepRemoveOrphanedMediaRows();
+					case Job::MIGRATE_MEDIA_FILES:
+						return runStepMigrateMediaFiles();
+					case Job::SHARD_MEDIA_FILES:
+						return runStepShardMediaFiles();
+					case Job::ENFORCE_MEDIA_QUOTA:
+						return runStepEnforceMediaQuota();
+					case Job::REMOVE_ORPHANED_MEDIA_FILES:
+						return runStepRemoveOrphanedMediaFiles();
+					case Job::ANALYZE_TABLES:
+						return runStepAnalyzeTables();
+					case Job::OPTIMIZE:
+						return runStepOptimize();
+					case Job::INCREMENTAL_VACUUM:
+						return runStepIncrementalVacuum();
+					default:
+						throw openmittsu::exceptions::InternalErrorException() << "Unhandled database maintenance job " << static_cast<int>(m_job) << ".";
+				}
+			}
+
+			bool DatabaseMaintenance::runStepArchiveMessages() {
+				int const archiveAgeInDays = m_archive->getArchiveAgeInDays();
+				if (archiveAgeInDays <= 0) {
+					return true;
+				}
+
+				openmittsu::protocol::MessageTime const olderThan(openmittsu::protocol::MessageTime::fromDatabase(QDateTime::currentMSecsSinceEpoch() - (archiveAgeInDays * Q_INT64_C(24 * 60 * 60 * 1000))));
+				m_statistics.messagesArchived += m_archive->archiveMessages(olderThan, archivedMessagesPerStep, m_cursor);
+
+				return m_cursor.isEmpty();
+			}
+
+			bool DatabaseMaintenance::runStepRemoveOrphanedMediaRows() {
+				QStringList orphanedUuids;
+				int rowCount = 0;
+				{
+					// The inner SELECT bounds the amount of work per step, independent of how many of the visited items are still referenced.
+					QSqlQuery query(m_database->getQueryObject());
+					QStringList referenceChecks;
+					QStringList const schemas = m_database->getMessageStorageSchemas();
+					auto schemaIt = schemas.constBegin();
+					auto const schemaEnd = schemas.constEnd();
+					for (; schemaIt != schemaEnd; ++schemaIt) {
+						referenceChecks.append(QStringLiteral("EXISTS (SELECT 1 FROM %1 AS `c` WHERE `c`.`uid` = `m`.`uid`)").arg(DatabaseUtilities::getQualifiedTableName(*schemaIt, QStringLiteral("contact_messages"))));
+						referenceChecks.append(QStringLiteral("EXISTS (SELECT 1 FROM %1 AS `g` WHERE `g`.`uid` = `m`.`uid`)").arg(DatabaseUtilities::getQualifiedTableName(*schemaIt, QStringLiteral("group_messages"))));
+					}
+					referenceChecks.append(QStringLiteral("EXISTS (SELECT 1 FROM `main`.`groups` AS `a` WHERE `a`.`avatar_uuid` = `m`.`uid`)"));
+
+					query.prepare(QStringLiteral("SELECT `m`.`uid` AS `uid`, (%1) AS `is_referenced` FROM (SELECT DISTINCT `uid` FROM `main`.`media` WHERE `uid` > :cursor ORDER BY `uid` ASC LIMIT :limit) AS `m` ORDER BY `m`.`uid` ASC;").arg(referenceChecks.join(QStringLiteral(" OR "))));
+					query.bindValue(QStringLiteral(":cursor"), QVariant(m_cursor));
+					query.bindValue(QStringLiteral(":limit"), QVariant(orphanedMediaRowsPerStep));
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute orphaned media query on table 'media'. Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						++rowCount;
+						QString const uuid = query.value(QStringLiteral("uid")).toString();
+						if (!query.value(QStringLiteral("is_referenced")).toBool()) {
+							orphanedUuids.append(uuid);
+						}
+						m_cursor = uuid;
+					}
+				}
+
+				auto it = orphanedUuids.constBegin();
+				auto const end = orphanedUuids.constEnd();
+				for (; it != end; ++it) {
+					LOGGER_DEBUG("Database maintenance: Removing orphaned media item {}.", it->toStdString());
+					m_database->removeAllMediaItems(*it);
+					m_statistics.mediaRowsRemoved += 1;
+				}
+
+				return rowCount < orphanedMediaRowsPerStep;
+			}
+
+			bool DatabaseMaintenance::runStepMigrateMediaFiles() {
+				// The slice ends instead, so the database thread can store the finished migrations before more are queued.
+				if (m_mediaFileStorage->getPendingWriteCount() >= maxPendingMediaWrites) {
+					m_isWaitingForMediaWrites = true;
+					return false;
+				}
+
+				QString lastVisitedUuid;
+				int const migratedItems = m_mediaFileStorage->migrateLegacyFiles(m_cursor, migratedMediaItemsPerStep, lastVisitedUuid);
+				m_statistics.mediaFilesMigrated += migratedItems;
+
+				if (lastVisitedUuid.isEmpty()) {
+					return true;
+				}
+				m_cursor = lastVisitedUuid;
+				return false;
+			}
+
+			bool DatabaseMaintenance::runStepShardMediaFiles() {
+				QString lastVisitedContentId;
+				int const movedFiles = m_mediaFileStorage->moveToShardedLayout(m_cursor, shardedMediaFilesPerStep, lastVisitedContentId);
+				m_statistics.mediaFilesMigrated += movedFiles;
+
+				if (lastVisitedContentId.isEmpty()) {
+					return true;
+				}
+				m_cursor = lastVisitedContentId;
+				return false;
+			}
+
+			bool DatabaseMaintenance::runStepEnforceMediaQuota() {
+				if (!m_mediaQuota->isEnabled()) {
+					return true;
+				}
+
+				if (m_cursor.isEmpty()) {
+					m_mediaQuotaPass = MediaQuota::startPass();
+				}
+
+				qint64 freedBytes = 0;
+				int const evictedItems = m_mediaQuota->enforce(m_mediaQuotaPass, evictedMediaItemsPerStep, freedBytes);
+				m_statistics.mediaItemsEvicted += evictedItems;
+				m_cursor = m_mediaQuotaPass.budgetCursor.uuid.isEmpty() ? m_mediaQuotaPass.ageCursor.uuid : m_mediaQuotaPass.budgetCursor.uuid;
+
+				return evictedItems < evictedMediaItemsPerStep;
+			}
+
+			bool DatabaseMaintenance::runStepRemoveOrphanedMediaFiles() {
+				QString lastVisitedFileName;
+				int const removedFiles = m_mediaFileStorage->removeUnreferencedFiles(m_cursor, orphanedMediaFilesPerStep, lastVisitedFileName);
+				m_statistics.mediaFilesRemoved += removedFiles;
+
+				if (lastVisitedFileName.isEmpty()) {
+					return true;
+				}
+				m_cursor = lastVisitedFileName;
+				return false;
+			}
+
+			bool DatabaseMaintenance::runStepAnalyzeTables() {
+				QStringList const tables = getAnalyzedTables();
+				int const index = m_cursor.isEmpty() ? 0 : m_cursor.toInt();
+				if (index >= tables.size()) {
+					return true;
+				}
+
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.exec(QStringLiteral("ANALYZE `%1`;").arg(tables.at(index)))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not analyze table '" << tables.at(index).toStdString() << "'. Query error: " << query.lastError().text().toStdString();
+				}
+
+				m_cursor = QString::number(index + 1);
+				return (index + 1) >= tables.size();
+			}
+
+			bool DatabaseMaintenance::runStepOptimize() {
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.exec(QStringLiteral("PRAGMA optimize;"))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not optimize database. Query error: " << query.lastError().text().toStdString();
+				}
+				while (query.next()) {
+					// Drain all rows, the pragma does its work while being stepped.
+				}
+
+				return true;
+			}
+
+			bool DatabaseMaintenance::isIncrementalVacuumEnabled() const {
+				return queryPragmaValue(QStringLiteral("auto_vacuum")) == 2;
+			}
+
+			void DatabaseMaintenance::enableIncrementalVacuum() {
+				if (isIncrementalVacuumEnabled()) {
+					return;
+				}
+
+				// Switching the mode of an existing database needs one full VACUUM, which rewrites the whole file. That is far too long for a maintenance slice.
+				qint64 const freePagesBefore = queryPragmaValue(QStringLiteral("freelist_count"));
+				LOGGER()->info("Database maintenance: Switching database to incremental auto vacuum, rewriting it once and freeing {} pages.", freePagesBefore);
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL;"))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not enable incremental auto vacuum. Query error: " << query.lastError().text().toStdString();
+				}
+				if (!query.exec(QStringLiteral("VACUUM;"))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not vacuum database. Query error: " << query.lastError().text().toStdString();
+				}
+
+				ensureStateLoaded();
+				m_statistics.pagesFreed += freePagesBefore;
+				saveState();
+			}
+
+			bool DatabaseMaintenance::runStepIncrementalVacuum() {
+				// Only bounded incremental steps run here, databases created before incremental vacuuming need enableIncrementalVacuum() first.
+				if (!isIncrementalVacuumEnabled()) {
+					return true;
+				}
+
+				qint64 const freePagesBefore = queryPragmaValue(QStringLiteral("freelist_count"));
+				if (freePagesBefore == 0) {
+					return true;
+				}
+
+				{
+					QSqlQuery query(m_database->getQueryObject());
+					if (!query.exec(QStringLiteral("PRAGMA incremental_vacuum(%1);").arg(vacuumPagesPerStep))) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not run incremental vacuum. Query error: " << query.lastError().text().toStdString();
+					}
+					while (query.next()) {
+						// Each step of this pragma frees one page, so all rows have to be consumed.
+					}
+				}
+
+				qint64 const freePagesAfter = queryPragmaValue(QStringLiteral("freelist_count"));
+				m_statistics.pagesFreed += (freePagesBefore - freePagesAfter);
+				return (freePagesAfter == 0) || (freePagesAfter >= freePagesBefore);
+			}
+
+			qint64 DatabaseMaintenance::queryPragmaValue(QString const& pragma) const {
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.exec(QStringLiteral("PRAGMA %1;").arg(pragma)) || !query.next()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not query pragma '" << pragma.toStdString() << "'. Query error: " << query.lastError().text().toStdString();
+				}
+				return query.value(0).toLongLong();
+			}
+
+			QStringList DatabaseMaintenance::getAnalyzedTables() {
+				return QStringList({ QStringLiteral("contacts"), QStringLiteral("contact_messages"), QStringLiteral("control_messages"), QStringLiteral("feature_levels"), QStringLiteral("groups"), QStringLiteral("group_messages"), QStringLiteral("media"), QStringLiteral("media_content"), QStringLiteral("settings") });
+			}
+
+		}
+	}
+}
@@ -0,0 +1,119 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_DATABASEMAINTENANCE_H_
+#define OPENMITTSU_DATABASE_INTERNAL_DATABASEMAINTENANCE_H_
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <atomic>
+
+#include "src/database/MaintenanceStatistics.h"
+#include "src/database/internal/MediaQuota.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+			class DatabaseArchive;
+			class InternalDatabaseInterface;
+			class MediaFileStorage;
+
+			/**
+			 * Keeps long-lived databases small and their query plans fresh.
+			 *
+			 * A maintenance run consists of a fixed sequence of jobs (archiving old messages, orphaned media rows, migrating legacy media files, moving media files into shard directories, the media quota, orphaned media files, ANALYZE, PRAGMA optimize, incremental vacuum).
+			 * Each job is split into small steps, and runSlice() executes steps only until its time budget is used up. The current job, its cursor and the
+			 * accumulated statistics are persisted as internal options in the settings table, so an interrupted or cancelled run resumes where it stopped.
+			 */
+			class DatabaseMaintenance {
+			public:
+				typedef openmittsu::database::MaintenanceStatistics Statistics;
+
+				DatabaseMaintenance(InternalDatabaseInterface* database, MediaFileStorage* mediaFileStorage, DatabaseArchive* archive, MediaQuota* mediaQuota);
+				virtual ~DatabaseMaintenance();
+
+				/** True if a run is in progress or the last completed run is older than the maintenance interval. */
+				bool isDue();
+
+				/** True if no activity was reported for at least the idle threshold. */
+				bool isIdle() const;
+				void notifyActivity();
+
+				/**
+				 * Executes maintenance steps until the time budget is used up, the run is complete or cancel() is called.
+				 * At least one step is executed per call. Returns true if the run was completed.
+				 */
+				bool runSlice(qint64 timeBudgetInMs);
+
+				/** Executes the current run to completion, ignoring the idle state. Intended for tests and explicit user requests. */
+				void runToCompletion();
+
+				/** Stops the currently executing slice after its current step. Progress is kept and the run resumes with the next slice. */
+				void cancel();
+
+				Statistics getStatistics();
+
+				/** False for databases created before incremental vacuuming, whose free pages are not given back by maintenance runs. */
+				bool isIncrementalVacuumEnabled() const;
+
+				/** Converts the database to incremental auto vacuum with one full VACUUM, which blocks until the whole file was rewritten. Only for explicit user requests. */
+				void enableIncrementalVacuum();
+
+				static int getMaintenanceIntervalInSeconds();
+				static int getIdleThresholdInSeconds();
+			private:
+				enum class Job : int {
+					ARCHIVE_MESSAGES = 0,
+					REMOVE_ORPHANED_MEDIA_ROWS = 1,
+					MIGRATE_MEDIA_FILES = 2,
+					SHARD_MEDIA_FILES = 3,
+					ENFORCE_MEDIA_QUOTA = 4,
+					REMOVE_ORPHANED_MEDIA_FILES = 5,
+					ANALYZE_TABLES = 6,
+					OPTIMIZE = 7,
+					INCREMENTAL_VACUUM = 8
+				};
+
+				InternalDatabaseInterface* const m_database;
+				MediaFileStorage* const m_mediaFileStorage;
+				DatabaseArchive* const m_archive;
+				MediaQuota* const m_mediaQuota;
+
+				std::atomic<bool> m_isCancelled;
+				std::atomic<qint64> m_lastActivity;
+
+				bool m_isStateLoaded;
+				bool m_isRunInProgress;
+				/** Set by a step that can only continue once the media I/O pool caught up, which ends the current slice. */
+				bool m_isWaitingForMediaWrites;
+				Job m_job;
+				QString m_cursor;
+				/** Only kept in memory, a quota job resumed after a restart starts its pass over. */
+				MediaQuota::Pass m_mediaQuotaPass;
+				Statistics m_statistics;
+
+				void ensureStateLoaded();
+				void saveState();
+
+				/** Executes one small step of the current job. Returns true if the job is finished. */
+				bool runStep();
+				bool runStepArchiveMessages();
+				bool runStepRemoveOrphanedMediaRows();
+				bool runStepMigrateMediaFiles();
+				bool runStepShardMediaFiles();
+				bool runStepEnforceMediaQuota();
+				bool runStepRemoveOrphanedMediaFiles();
+				bool runStepAnalyzeTables();
+				bool runStepOptimize();
+				bool runStepIncrementalVacuum();
+
+				qint64 queryPragmaValue(QString const& pragma) const;
+				void completeRun();
+
+				static QStringList getAnalyzedTables();
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_DATABASEMAINTENANCE_H_
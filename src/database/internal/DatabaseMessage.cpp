@@ -14,7 +14,7 @@ namespace openmittsu {
 
 			using namespace openmittsu::dataproviders::messages;
 
-			DatabaseMessage::DatabaseMessage(InternalDatabaseInterface* database, openmittsu::protocol::MessageId const& messageId) : Message(), m_database(database), m_messageId(messageId) {
+			DatabaseMessage::DatabaseMessage(InternalDatabaseInterface* database, openmittsu::protocol::MessageId const& messageId) : Message(), m_database(database), m_messageId(messageId), m_schema(QStringLiteral("main")) {
 				//
 			}
 
@@ -26,10 +26,14 @@ namespace openmittsu {
 				return m_messageId;
 			}
 
+			void DatabaseMessage::setSchema(QString const& schema) {
+				m_schema = schema;
+			}
+
 			QVariant DatabaseMessage::queryField(QString const& fieldName) const {
 				QSqlQuery query(m_database->getQueryObject());
 
-				query.prepare(QStringLiteral("SELECT `%1` FROM `%2` WHERE %3 AND `apiid` = :apiid;").arg(fieldName).arg(getTableName()).arg(getWhereString()));
+				query.prepare(QStringLiteral("SELECT `%1` FROM %2 WHERE %3 AND `apiid` = :apiid;").arg(fieldName).arg(DatabaseUtilities::getQualifiedTableName(m_schema, getTableName())).arg(getWhereString()));
 				bindWhereStringValues(query);
 				query.bindValue(QStringLiteral(":apiid"), QVariant(m_messageId.toQString()));
 
@@ -46,7 +50,7 @@ namespace openmittsu {
 				if (fieldsAndValues.size() > 0) {
 					QSqlQuery query(m_database->getQueryObject());
 
-					DatabaseUtilities::prepareSetFieldsUpdateQuery(query, QStringLiteral("UPDATE `%1` SET %3 WHERE %2 AND `apiid` = :apiid;").arg(getTableName()).arg(getWhereString()), fieldsAndValues);
+					DatabaseUtilities::prepareSetFieldsUpdateQuery(query, QStringLiteral("UPDATE %1 SET %3 WHERE %2 AND `apiid` = :apiid;").arg(DatabaseUtilities::getQualifiedTableName(m_schema, getTableName())).arg(getWhereString()), fieldsAndValues);
 					bindWhereStringValues(query);
 					query.bindValue(QStringLiteral(":apiid"), QVariant(m_messageId.toQString()));
 
@@ -92,8 +96,8 @@ namespace openmittsu {
 				return QSqlQuery(m_database->getQueryObject());
 			}
 
-			MediaFileItem DatabaseMessage::getMediaItem(QString const& uuid) const {
-				return m_database->getMediaItem(uuid, MediaFileType::TYPE_STANDARD);
+			MediaItemHandle DatabaseMessage::getMediaItemHandle(QString const& uuid) const {
+				return m_database->getMediaItemHandle(uuid, MediaFileType::TYPE_STANDARD);
 			}
 
 			void DatabaseMessage::announceMessageChanged() {
@@ -5,12 +5,11 @@
 #include <QSqlQuery>
 #include <QVariant>
 
+#include "src/database/MediaItemHandle.h"
 #include "src/dataproviders/messages/Message.h"
 
 namespace openmittsu {
 	namespace database {
-		class MediaFileItem;
-
 		namespace internal {
 			class InternalDatabaseInterface;
 
@@ -48,15 +47,19 @@ namespace openmittsu {
 				virtual void bindWhereStringValues(QSqlQuery& query) const = 0;
 				virtual QString getTableName() const = 0;
 
+				/** Selects the storage tier this message lives in, defaults to the main schema. */
+				void setSchema(QString const& schema);
+
 				QVariant queryField(QString const& fieldName) const;
 				void setFields(QVariantMap const& fieldsAndValues);
 
-				MediaFileItem getMediaItem(QString const& uuid) const;
+				MediaItemHandle getMediaItemHandle(QString const& uuid) const;
 
 				void announceMessageChanged();
 			private:
 				InternalDatabaseInterface* const m_database;
 				openmittsu::protocol::MessageId const m_messageId;
+				QString m_schema;
 			};
 
 		}
@@ -1,18 +1,22 @@
 #include "src/database/internal/DatabaseMessageCursor.h"
 
+#include "src/database/internal/DatabaseUtilities.h"
 #include "src/database/internal/InternalDatabaseInterface.h"
 #include "src/exceptions/InternalErrorException.h"
 #include "src/utility/Logging.h"
 
+#include <QPair>
 #include <QVariant>
 
+#include <algorithm>
+
 namespace openmittsu {
 	namespace database {
 		namespace internal {
 
 			using namespace openmittsu::dataproviders::messages;
 
-			DatabaseMessageCursor::DatabaseMessageCursor(InternalDatabaseInterface* database) : m_database(database), m_messageId(0), m_isMessageIdValid(false), m_messageType() {
+			DatabaseMessageCursor::DatabaseMessageCursor(InternalDatabaseInterface* database) : m_database(database), m_messageId(0), m_isMessageIdValid(false), m_messageType(), m_schema() {
 				//
 			}
 
@@ -32,56 +36,86 @@ namespace openmittsu {
 				return getFirstOrLastMessageId(false);
 			}
 
-			bool DatabaseMessageCursor::seek(openmittsu::protocol::MessageId const& messageId) {
-				QSqlQuery query(m_database->getQueryObject());
-				QString const queryString = QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%3` AS `messageType` FROM `%1` WHERE %2 AND `apiid` = :apiid;").arg(getTableName()).arg(getWhereString()).arg(getMessageTypeField());
-				if (!query.prepare(queryString)) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not prepare message seek query. SQL error: " << query.lastError().text().toStdString();
+			bool DatabaseMessageCursor::readPosition(QSqlQuery& query, QString const& schema, CursorPosition& position) {
+				if (!query.next()) {
+					return false;
 				}
-				query.bindValue(QStringLiteral(":apiid"), QVariant(messageId.toQString()));
-				bindWhereStringValues(query);
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute message seek query for table " << getTableName().toStdString() << " for message ID \"" << messageId.toString() << "\". Query error: " << query.lastError().text().toStdString();
-				}
+				position.messageId = openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString());
+				position.uid = query.value(QStringLiteral("uid")).toString();
+				position.sortByValue = query.value(QStringLiteral("sort_by")).toLongLong();
+				position.messageType = query.value(QStringLiteral("messageType")).toString();
+				position.schema = schema;
+				return true;
+			}
 
-				if (query.next()) {
-					m_isMessageIdValid = true;
-					m_messageId = openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString());
-					m_uid = query.value(QStringLiteral("uid")).toString();
-					m_sortByValue = query.value(QStringLiteral("sort_by")).toLongLong();
-					m_messageType = query.value(QStringLiteral("messageType")).toString();
-					return true;
-				} else {
-					m_isMessageIdValid = false;
-					return false;
+			bool DatabaseMessageCursor::isOrderedBefore(CursorPosition const& a, CursorPosition const& b) {
+				return (a.sortByValue < b.sortByValue) || ((a.sortByValue == b.sortByValue) && (a.uid < b.uid));
+			}
+
+			void DatabaseMessageCursor::applyPosition(CursorPosition const& position) {
+				m_isMessageIdValid = true;
+				m_messageId = position.messageId;
+				m_uid = position.uid;
+				m_sortByValue = position.sortByValue;
+				m_messageType = position.messageType;
+				m_schema = position.schema;
+			}
+
+			bool DatabaseMessageCursor::seek(openmittsu::protocol::MessageId const& messageId) {
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery query(m_database->getQueryObject());
+					QString const queryString = QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%3` AS `messageType` FROM %1 WHERE %2 AND `apiid` = :apiid;").arg(DatabaseUtilities::getQualifiedTableName(*it, getTableName())).arg(getWhereString()).arg(getMessageTypeField());
+					if (!query.prepare(queryString)) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not prepare message seek query. SQL error: " << query.lastError().text().toStdString();
+					}
+					query.bindValue(QStringLiteral(":apiid"), QVariant(messageId.toQString()));
+					bindWhereStringValues(query);
+
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute message seek query for table " << getTableName().toStdString() << " for message ID \"" << messageId.toString() << "\". Query error: " << query.lastError().text().toStdString();
+					}
+
+					CursorPosition position;
+					if (readPosition(query, *it, position)) {
+						applyPosition(position);
+						return true;
+					}
 				}
+
+				m_isMessageIdValid = false;
+				return false;
 			}
 
 			bool DatabaseMessageCursor::seekByUuid(QString const& uuid) {
-				QSqlQuery query(m_database->getQueryObject());
-				QString const queryString = QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%3` AS `messageType` FROM `%1` WHERE %2 AND `uid` = :uid;").arg(getTableName()).arg(getWhereString()).arg(getMessageTypeField());
-				if (!query.prepare(queryString)) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not prepare message seekByUuid query. SQL error: " << query.lastError().text().toStdString();
-				}
-				query.bindValue(QStringLiteral(":uid"), QVariant(uuid));
-				bindWhereStringValues(query);
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery query(m_database->getQueryObject());
+					QString const queryString = QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%3` AS `messageType` FROM %1 WHERE %2 AND `uid` = :uid;").arg(DatabaseUtilities::getQualifiedTableName(*it, getTableName())).arg(getWhereString()).arg(getMessageTypeField());
+					if (!query.prepare(queryString)) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not prepare message seekByUuid query. SQL error: " << query.lastError().text().toStdString();
+					}
+					query.bindValue(QStringLiteral(":uid"), QVariant(uuid));
+					bindWhereStringValues(query);
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute message seek query for table " << getTableName().toStdString() << " for UUID \"" << uuid.toStdString() << "\". Query error: " << query.lastError().text().toStdString();
-				}
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute message seek query for table " << getTableName().toStdString() << " for UUID \"" << uuid.toStdString() << "\". Query error: " << query.lastError().text().toStdString();
+					}
 
-				if (query.next()) {
-					m_isMessageIdValid = true;
-					m_messageId = openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString());
-					m_uid = query.value(QStringLiteral("uid")).toString();
-					m_sortByValue = query.value(QStringLiteral("sort_by")).toLongLong();
-					m_messageType = query.value(QStringLiteral("messageType")).toString();
-					return true;
-				} else {
-					m_isMessageIdValid = false;
-					return false;
+					CursorPosition position;
+					if (readPosition(query, *it, position)) {
+						applyPosition(position);
+						return true;
+					}
 				}
+
+				m_isMessageIdValid = false;
+				return false;
 			}
 
 			bool DatabaseMessageCursor::getFollowingMessageId(bool ascending) {
@@ -89,6 +123,29 @@ namespace openmittsu {
 					return false;
 				}
 
+				// Archiving moves messages in sort order, but a conversation can still interleave between the tiers (e.g. after a backup import), so both are asked.
+				bool foundPosition = false;
+				CursorPosition bestPosition;
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					CursorPosition position;
+					if (getFollowingMessageIdInSchema(*it, ascending, position)) {
+						if ((!foundPosition) || (ascending ? isOrderedBefore(position, bestPosition) : isOrderedBefore(bestPosition, position))) {
+							bestPosition = position;
+							foundPosition = true;
+						}
+					}
+				}
+
+				if (foundPosition) {
+					applyPosition(bestPosition);
+				}
+				return foundPosition;
+			}
+
+			bool DatabaseMessageCursor::getFollowingMessageIdInSchema(QString const& schema, bool ascending, CursorPosition& position) const {
 				QString sortOrder;
 				QString sortOrderSign;
 				if (ascending) {
@@ -98,11 +155,12 @@ namespace openmittsu {
 					sortOrder = QStringLiteral("DESC");
 					sortOrderSign = QStringLiteral("<");
 				}
+				QString const tableName = DatabaseUtilities::getQualifiedTableName(schema, getTableName());
 
 #if defined(QT_VERSION) && (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)) && (QT_VERSION < QT_VERSION_CHECK(5, 10, 1))
 				// Check in two steps to mitigate a cool bug in the query engine.
 				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%5` AS `messageType` FROM `%1` WHERE (%2) AND (((`sort_by` = :sortByValue) AND (`uid` %3 :uid))) ORDER BY `sort_by` %4, `uid` %4 LIMIT 1;").arg(getTableName()).arg(getWhereString()).arg(sortOrderSign).arg(sortOrder).arg(getMessageTypeField()));
+				query.prepare(QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%5` AS `messageType` FROM %1 WHERE (%2) AND (((`sort_by` = :sortByValue) AND (`uid` %3 :uid))) ORDER BY `sort_by` %4, `uid` %4 LIMIT 1;").arg(tableName).arg(getWhereString()).arg(sortOrderSign).arg(sortOrder).arg(getMessageTypeField()));
 				bindWhereStringValues(query);
 				query.bindValue(QStringLiteral(":sortByValue"), QVariant(m_sortByValue));
 				query.bindValue(QStringLiteral(":uid"), QVariant(m_uid));
@@ -111,15 +169,10 @@ namespace openmittsu {
 					throw openmittsu::exceptions::InternalErrorException() << "Could not execute message iteration query for table " << getTableName().toStdString() << ". Query error: " << query.lastError().text().toStdString();
 				}
 
-				if (query.next()) {
-					m_isMessageIdValid = true;
-					m_messageId = openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString());
-					m_uid = query.value(QStringLiteral("uid")).toString();
-					m_sortByValue = query.value(QStringLiteral("sort_by")).toLongLong();
-					m_messageType = query.value(QStringLiteral("messageType")).toString();
+				if (readPosition(query, schema, position)) {
 					return true;
 				} else {
-					query.prepare(QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%5` AS `messageType` FROM `%1` WHERE (%2) AND ((`sort_by` %3 :sortByValue)) ORDER BY `sort_by` %4, `uid` %4 LIMIT 1;").arg(getTableName()).arg(getWhereString()).arg(sortOrderSign).arg(sortOrder).arg(getMessageTypeField()));
+					query.prepare(QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%5` AS `messageType` FROM %1 WHERE (%2) AND ((`sort_by` %3 :sortByValue)) ORDER BY `sort_by` %4, `uid` %4 LIMIT 1;").arg(tableName).arg(getWhereString()).arg(sortOrderSign).arg(sortOrder).arg(getMessageTypeField()));
 					bindWhereStringValues(query);
 					query.bindValue(QStringLiteral(":sortByValue"), QVariant(m_sortByValue));
 
@@ -127,20 +180,11 @@ namespace openmittsu {
 						throw openmittsu::exceptions::InternalErrorException() << "Could not execute message iteration query for table " << getTableName().toStdString() << ". Query error: " << query.lastError().text().toStdString();
 					}
 
-					if (query.next()) {
-						m_isMessageIdValid = true;
-						m_messageId = openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString());
-						m_uid = query.value(QStringLiteral("uid")).toString();
-						m_sortByValue = query.value(QStringLiteral("sort_by")).toLongLong();
-						m_messageType = query.value(QStringLiteral("messageType")).toString();
-						return true;
-					} else {
-						return false;
-					}
+					return readPosition(query, schema, position);
 				}
 #else
 				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%5` AS `messageType` FROM `%1` WHERE %2 AND ((`sort_by` %3 :sortByValue) OR ((`sort_by` = :sortByValue) AND (`uid` %3 :uid))) ORDER BY `sort_by` %4, `uid` %4 LIMIT 1;").arg(getTableName()).arg(getWhereString()).arg(sortOrderSign).arg(sortOrder).arg(getMessageTypeField()));
+				query.prepare(QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%5` AS `messageType` FROM %1 WHERE %2 AND ((`sort_by` %3 :sortByValue) OR ((`sort_by` = :sortByValue) AND (`uid` %3 :uid))) ORDER BY `sort_by` %4, `uid` %4 LIMIT 1;").arg(tableName).arg(getWhereString()).arg(sortOrderSign).arg(sortOrder).arg(getMessageTypeField()));
 				bindWhereStringValues(query);
 				query.bindValue(QStringLiteral(":sortByValue"), QVariant(m_sortByValue));
 				query.bindValue(QStringLiteral(":uid"), QVariant(m_uid));
@@ -149,16 +193,7 @@ namespace openmittsu {
 					throw openmittsu::exceptions::InternalErrorException() << "Could not execute message iteration query for table " << getTableName().toStdString() << ". Query error: " << query.lastError().text().toStdString();
 				}
 
-				if (query.next()) {
-					m_isMessageIdValid = true;
-					m_messageId = openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString());
-					m_uid = query.value(QStringLiteral("uid")).toString();
-					m_sortByValue = query.value(QStringLiteral("sort_by")).toLongLong();
-					m_messageType = query.value(QStringLiteral("messageType")).toString();
-					return true;
-				} else {
-					return false;
-				}
+				return readPosition(query, schema, position);
 #endif
 			}
 
@@ -170,42 +205,65 @@ namespace openmittsu {
 					sortOrder = QStringLiteral("DESC");
 				}
 
-				QSqlQuery query(m_database->getQueryObject());
-				QString const queryString = QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%4` AS `messageType` FROM `%1` WHERE %2 ORDER BY `sort_by` %3, `uid` %3 LIMIT 1;").arg(getTableName()).arg(getWhereString()).arg(sortOrder).arg(getMessageTypeField());
-				if (!query.prepare(queryString)) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not prepare message firstOrLastMessageId query. SQL error: " << query.lastError().text().toStdString();
-				}
-				bindWhereStringValues(query);
+				bool foundPosition = false;
+				CursorPosition bestPosition;
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery query(m_database->getQueryObject());
+					QString const queryString = QStringLiteral("SELECT `apiid`, `uid`, `sort_by`, `%4` AS `messageType` FROM %1 WHERE %2 ORDER BY `sort_by` %3, `uid` %3 LIMIT 1;").arg(DatabaseUtilities::getQualifiedTableName(*it, getTableName())).arg(getWhereString()).arg(sortOrder).arg(getMessageTypeField());
+					if (!query.prepare(queryString)) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not prepare message firstOrLastMessageId query. SQL error: " << query.lastError().text().toStdString();
+					}
+					bindWhereStringValues(query);
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute message first/last query for table " << getTableName().toStdString() << ". Query error: " << query.lastError().text().toStdString();
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute message first/last query for table " << getTableName().toStdString() << ". Query error: " << query.lastError().text().toStdString();
+					}
+
+					CursorPosition position;
+					if (readPosition(query, *it, position)) {
+						if ((!foundPosition) || (first ? isOrderedBefore(position, bestPosition) : isOrderedBefore(bestPosition, position))) {
+							bestPosition = position;
+							foundPosition = true;
+						}
+					}
 				}
 
-				if (query.next()) {
-					m_isMessageIdValid = true;
-					m_messageId = openmittsu::protocol::MessageId(query.value(QStringLiteral("apiid")).toString());
-					m_uid = query.value(QStringLiteral("uid")).toString();
-					m_sortByValue = query.value(QStringLiteral("sort_by")).toLongLong();
-					m_messageType = query.value(QStringLiteral("messageType")).toString();
-					return true;
-				} else {
-					return false;
+				if (foundPosition) {
+					applyPosition(bestPosition);
 				}
+				return foundPosition;
 			}
 
 			QVector<QString> DatabaseMessageCursor::getLastMessages(std::size_t n) const {
-				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `uid` FROM `%1` WHERE %2 ORDER BY `sort_by` DESC, `uid` DESC LIMIT %3;").arg(getTableName()).arg(getWhereString()).arg(n));
-				bindWhereStringValues(query);
+				QVector<QPair<qint64, QString>> entries;
+
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `uid`, `sort_by` FROM %1 WHERE %2 ORDER BY `sort_by` DESC, `uid` DESC LIMIT %3;").arg(DatabaseUtilities::getQualifiedTableName(*it, getTableName())).arg(getWhereString()).arg(n));
+					bindWhereStringValues(query);
 
-				if (!query.exec() || !query.isSelect()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute message enumeration query for table " << getTableName().toStdString() << ". Query error: " << query.lastError().text().toStdString();
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute message enumeration query for table " << getTableName().toStdString() << ". Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						entries.append(qMakePair(query.value(QStringLiteral("sort_by")).toLongLong(), query.value(QStringLiteral("uid")).toString()));
+					}
 				}
 
-				QVector<QString> result;
+				if (schemas.size() > 1) {
+					std::sort(entries.begin(), entries.end(), [](QPair<qint64, QString> const& a, QPair<qint64, QString> const& b) { return b < a; });
+				}
 
-				while (query.next()) {
-					result.push_back(query.value(QStringLiteral("uid")).toString());
+				QVector<QString> result;
+				for (int i = 0; (i < entries.size()) && (static_cast<std::size_t>(i) < n); ++i) {
+					result.push_back(entries.at(i).second);
 				}
 
 				return result;
@@ -219,7 +277,7 @@ namespace openmittsu {
 				getDatabase()->removeAllMediaItems(getMessageUuid());
 
 				QSqlQuery query(getDatabase()->getQueryObject());
-				query.prepare(QStringLiteral("DELETE FROM `%1` WHERE %2 AND `uid` = :uid;").arg(getTableName()).arg(getWhereString()));
+				query.prepare(QStringLiteral("DELETE FROM %1 WHERE %2 AND `uid` = :uid;").arg(DatabaseUtilities::getQualifiedTableName(m_schema, getTableName())).arg(getWhereString()));
 				bindWhereStringValues(query);
 				query.bindValue(QStringLiteral(":uid"), QVariant(getMessageUuid()));
 				if (!query.exec()) {
@@ -243,6 +301,10 @@ namespace openmittsu {
 				return m_database;
 			}
 
+			QString const& DatabaseMessageCursor::getMessageSchema() const {
+				return m_schema;
+			}
+
 			openmittsu::protocol::MessageId const& DatabaseMessageCursor::getMessageId() const {
 				return m_messageId;
 			}
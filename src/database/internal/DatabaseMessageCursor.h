@@ -38,20 +38,39 @@ namespace openmittsu {
 			protected:
 				InternalDatabaseInterface* getDatabase() const;
 
+				/** The schema (storage tier) the current message lives in. */
+				QString const& getMessageSchema() const;
+
 				virtual QString getWhereString() const = 0;
 				virtual void bindWhereStringValues(QSqlQuery& query) const = 0;
 				virtual QString getTableName() const = 0;
 				virtual QString getMessageTypeField() const = 0;
 			private:
+				struct CursorPosition {
+					CursorPosition() : messageId(0), uid(), sortByValue(0), messageType(), schema() {}
+
+					openmittsu::protocol::MessageId messageId;
+					QString uid;
+					qint64 sortByValue;
+					QString messageType;
+					QString schema;
+				};
+
 				InternalDatabaseInterface* const m_database;
 				openmittsu::protocol::MessageId m_messageId;
 				bool m_isMessageIdValid;
 				qint64 m_sortByValue;
 				QString m_uid;
 				QString m_messageType;
+				QString m_schema;
 
 				bool getFollowingMessageId(bool ascending);
+				bool getFollowingMessageIdInSchema(QString const& schema, bool ascending, CursorPosition& position) const;
 				bool getFirstOrLastMessageId(bool first);
+
+				static bool readPosition(QSqlQuery& query, QString const& schema, CursorPosition& position);
+				static bool isOrderedBefore(CursorPosition const& a, CursorPosition const& b);
+				void applyPosition(CursorPosition const& position);
 			};
 
 		}
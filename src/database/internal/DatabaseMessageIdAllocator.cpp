@@ -0,0 +1,102 @@
+#include "src/database/internal/DatabaseMessageIdAllocator.h"
+
+#include "src/exceptions/InternalErrorException.h"
+
+#include <QMutexLocker>
+
+#include <sodium.h>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			DatabaseMessageIdAllocator::DatabaseMessageIdAllocator() : m_mutex(), m_key(), m_epoch(0), m_counter(0), m_isInitialized(false) {
+				//
+			}
+
+			DatabaseMessageIdAllocator::~DatabaseMessageIdAllocator() {
+				// Intentionally left empty.
+			}
+
+			void DatabaseMessageIdAllocator::initialize(QByteArray const& key, quint32 epoch) {
+				if (key.size() != getKeySizeInBytes()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Message ID allocator key has invalid size " << key.size() << " instead of " << getKeySizeInBytes() << ".";
+				}
+
+				QMutexLocker lock(&m_mutex);
+				m_key = key;
+				m_epoch = epoch;
+				m_counter = 0;
+				m_isInitialized = true;
+			}
+
+			bool DatabaseMessageIdAllocator::isInitialized() const {
+				QMutexLocker lock(&m_mutex);
+				return m_isInitialized;
+			}
+
+			bool DatabaseMessageIdAllocator::isExhausted() const {
+				QMutexLocker lock(&m_mutex);
+				return m_counter > Q_UINT64_C(0xFFFFFFFF);
+			}
+
+			openmittsu::protocol::MessageId DatabaseMessageIdAllocator::getNextMessageId() {
+				QMutexLocker lock(&m_mutex);
+				if (!m_isInitialized) {
+					throw openmittsu::exceptions::InternalErrorException() << "Message ID allocator used before it was initialized.";
+				}
+
+				while (m_counter <= Q_UINT64_C(0xFFFFFFFF)) {
+					quint64 const plain = (static_cast<quint64>(m_epoch) << 32) | m_counter;
+					++m_counter;
+
+					quint64 const id = permute(plain);
+					// Zero is not a valid message ID, skip it.
+					if (id != 0) {
+						return openmittsu::protocol::MessageId(id);
+					}
+				}
+
+				throw openmittsu::exceptions::InternalErrorException() << "Message ID allocator ran out of IDs for epoch " << m_epoch << ", a new epoch needs to be reserved.";
+			}
+
+			quint64 DatabaseMessageIdAllocator::permute(quint64 value) const {
+				quint32 left = static_cast<quint32>(value >> 32);
+				quint32 right = static_cast<quint32>(value & Q_UINT64_C(0xFFFFFFFF));
+
+				for (int round = 0; round < 4; ++round) {
+					quint32 const newRight = left ^ roundFunction(round, right);
+					left = right;
+					right = newRight;
+				}
+
+				return (static_cast<quint64>(left) << 32) | right;
+			}
+
+			quint32 DatabaseMessageIdAllocator::roundFunction(int round, quint32 value) const {
+				unsigned char input[5];
+				input[0] = static_cast<unsigned char>(round);
+				input[1] = static_cast<unsigned char>((value >> 24) & 0xFF);
+				input[2] = static_cast<unsigned char>((value >> 16) & 0xFF);
+				input[3] = static_cast<unsigned char>((value >> 8) & 0xFF);
+				input[4] = static_cast<unsigned char>(value & 0xFF);
+
+				unsigned char output[crypto_shorthash_BYTES];
+				crypto_shorthash(output, input, sizeof(input), reinterpret_cast<unsigned char const*>(m_key.constData()));
+
+				return (static_cast<quint32>(output[0]) << 24) | (static_cast<quint32>(output[1]) << 16) | (static_cast<quint32>(output[2]) << 8) | static_cast<quint32>(output[3]);
+			}
+
+			QByteArray DatabaseMessageIdAllocator::generateKey() {
+				QByteArray key(getKeySizeInBytes(), 0x00);
+				randombytes_buf(key.data(), getKeySizeInBytes());
+				return key;
+			}
+
+			int DatabaseMessageIdAllocator::getKeySizeInBytes() {
+				return crypto_shorthash_KEYBYTES;
+			}
+
+		}
+	}
+}
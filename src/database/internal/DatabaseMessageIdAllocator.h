@@ -0,0 +1,51 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_DATABASEMESSAGEIDALLOCATOR_H_
+#define OPENMITTSU_DATABASE_INTERNAL_DATABASEMESSAGEIDALLOCATOR_H_
+
+#include <QByteArray>
+#include <QMutex>
+#include <QtGlobal>
+
+#include "src/protocol/MessageId.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Hands out message IDs for outgoing messages without consulting the database.
+			 *
+			 * Every ID is the image of a unique (epoch, counter) pair under a keyed 64-bit permutation (a four round Feistel network over SipHash).
+			 * The epoch is reserved once per session and persisted by the owner, the counter is held in memory only.
+			 * As the permutation is a bijection, no two IDs handed out under the same key can collide, while the secret key keeps them unpredictable on the wire.
+			 */
+			class DatabaseMessageIdAllocator {
+			public:
+				DatabaseMessageIdAllocator();
+				virtual ~DatabaseMessageIdAllocator();
+
+				void initialize(QByteArray const& key, quint32 epoch);
+				bool isInitialized() const;
+
+				/** True if all IDs of the current epoch have been handed out and a new epoch needs to be reserved. */
+				bool isExhausted() const;
+
+				openmittsu::protocol::MessageId getNextMessageId();
+
+				static QByteArray generateKey();
+				static int getKeySizeInBytes();
+			private:
+				mutable QMutex m_mutex;
+				QByteArray m_key;
+				quint32 m_epoch;
+				quint64 m_counter;
+				bool m_isInitialized;
+
+				quint64 permute(quint64 value) const;
+				quint32 roundFunction(int round, quint32 value) const;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_DATABASEMESSAGEIDALLOCATOR_H_
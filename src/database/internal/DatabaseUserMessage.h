@@ -4,6 +4,8 @@
 #include <QString>
 #include <QSqlQuery>
 
+#include <functional>
+
 #include "src/protocol/MessageId.h"
 #include "src/protocol/MessageTime.h"
 #include "src/database/internal/DatabaseMessage.h"
@@ -32,6 +34,9 @@ namespace openmittsu {
 				virtual bool isStatusMessage() const override;
 
 				virtual QString getCaption() const override;
+
+				/** Receives the identifying columns of a stored message. The conversation is the identity of the contact or "creator:id" of the group, sender is the identity stored with the message. */
+				typedef std::function<void(QString const& uuid, QString const& conversation, QString const& sender, QString const& apiId, bool isOutbox)> MessageKeyCallback;
 			};
 
 		}
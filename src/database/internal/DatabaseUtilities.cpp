@@ -10,6 +10,61 @@ namespace openmittsu {
 		namespace internal {
 
 			int DatabaseUtilities::countQuery(InternalDatabaseInterface const* database, QString const& tableName, QVariantMap const& whereQueryPart) {
+				return countQueryQualified(database, QStringLiteral("`%1`").arg(tableName), whereQueryPart);
+			}
+
+			int DatabaseUtilities::countQueryInAllSchemas(InternalDatabaseInterface const* database, QString const& tableName, QVariantMap const& whereQueryPart) {
+				int result = 0;
+				QStringList const schemas = database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					result += countQueryQualified(database, getQualifiedTableName(*it, tableName), whereQueryPart);
+				}
+				return result;
+			}
+
+			QString DatabaseUtilities::getQualifiedTableName(QString const& schemaName, QString const& tableName) {
+				return QStringLiteral("`%1`.`%2`").arg(schemaName).arg(tableName);
+			}
+
+			QString DatabaseUtilities::getTableInAllSchemas(InternalDatabaseInterface const* database, QString const& tableName) {
+				QStringList const schemas = database->getMessageStorageSchemas();
+				if (schemas.size() == 1) {
+					return getQualifiedTableName(schemas.first(), tableName);
+				}
+
+				QStringList parts;
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					parts.append(QStringLiteral("SELECT * FROM %1").arg(getQualifiedTableName(*it, tableName)));
+				}
+				return QStringLiteral("(%1)").arg(parts.join(QStringLiteral(" UNION ALL ")));
+			}
+
+			void DatabaseUtilities::deleteMessagesInAllSchemas(InternalDatabaseInterface* database, QString const& tableName, QVector<QString> const& uuids) {
+				QStringList const schemas = database->getMessageStorageSchemas();
+				auto schemaIt = schemas.constBegin();
+				auto const schemaEnd = schemas.constEnd();
+				for (; schemaIt != schemaEnd; ++schemaIt) {
+					QSqlQuery query(database->getQueryObject());
+					if (!query.prepare(QStringLiteral("DELETE FROM %1 WHERE `uid` = :uid;").arg(getQualifiedTableName(*schemaIt, tableName)))) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not prepare message deletion query for table " << tableName.toStdString() << ". SQL error: " << query.lastError().text().toStdString();
+					}
+
+					auto it = uuids.constBegin();
+					auto const end = uuids.constEnd();
+					for (; it != end; ++it) {
+						query.bindValue(QStringLiteral(":uid"), QVariant(*it));
+						if (!query.exec()) {
+							throw openmittsu::exceptions::InternalErrorException() << "Could not execute message deletion query for table " << tableName.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+						}
+					}
+				}
+			}
+
+			int DatabaseUtilities::countQueryQualified(InternalDatabaseInterface const* database, QString const& qualifiedTableName, QVariantMap const& whereQueryPart) {
 				QSqlQuery query(database->getQueryObject());
 				QString whereString;
 				whereString.reserve(512);
@@ -27,7 +82,7 @@ namespace openmittsu {
 					++keyIndex;
 				}
 
-				query.prepare(QStringLiteral("SELECT Count(*) AS `count` FROM `%1`%2").arg(tableName).arg(whereString));
+				query.prepare(QStringLiteral("SELECT Count(*) AS `count` FROM %1%2").arg(qualifiedTableName).arg(whereString));
 
 				it = whereQueryPart.constBegin();
 				keyIndex = 1;
@@ -39,7 +94,7 @@ namespace openmittsu {
 				if (query.exec() && query.isSelect() && query.next()) {
 					return query.value(QStringLiteral("count")).toInt();
 				} else {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not execute count query for table '" << tableName.toStdString() << "'. Query error: " << query.lastError().text().toStdString();
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute count query for table " << qualifiedTableName.toStdString() << ". Query error: " << query.lastError().text().toStdString();
 				}
 			}
 
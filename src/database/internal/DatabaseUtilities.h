@@ -5,6 +5,7 @@
 #include <QSqlQuery>
 #include <QSqlDatabase>
 #include <QVariant>
+#include <QVector>
 
 #include "src/database/internal/InternalDatabaseInterface.h"
 #include "src/dataproviders/messages/Message.h"
@@ -16,7 +17,14 @@ namespace openmittsu {
 			class DatabaseUtilities {
 			public:
 				static int countQuery(InternalDatabaseInterface const* database, QString const& tableName, QVariantMap const& whereQueryPart = {});
+				static int countQueryInAllSchemas(InternalDatabaseInterface const* database, QString const& tableName, QVariantMap const& whereQueryPart = {});
+				static QString getQualifiedTableName(QString const& schemaName, QString const& tableName);
+				/** A table expression covering the given table in all message storage schemas, for use in FROM clauses. */
+				static QString getTableInAllSchemas(InternalDatabaseInterface const* database, QString const& tableName);
+				static void deleteMessagesInAllSchemas(InternalDatabaseInterface* database, QString const& tableName, QVector<QString> const& uuids);
 				static void prepareSetFieldsUpdateQuery(QSqlQuery& query, QString const& queryString, QVariantMap const& fieldsAndValues);
+			private:
+				static int countQueryQualified(InternalDatabaseInterface const* database, QString const& qualifiedTableName, QVariantMap const& whereQueryPart);
 			};
 
 		}
@@ -3,15 +3,30 @@
 #include "src/backup/ContactMediaItemBackupObject.h"
 #include "src/backup/GroupMediaItemBackupObject.h"
 #include "src/crypto/Crc32.h"
+#include "src/database/internal/ChunkedMediaFileDevice.h"
+#include "src/database/internal/ChunkedMediaFileFormat.h"
+#include "src/database/internal/ChunkedMediaFileReader.h"
+#include "src/database/internal/ChunkedMediaFileWriter.h"
 #include "src/database/internal/InternalDatabaseInterface.h"
 #include "src/database/internal/DatabaseUtilities.h"
 #include "src/exceptions/InternalErrorException.h"
+#include "src/utility/FileSync.h"
 #include "src/utility/Logging.h"
 
+#include <QDateTime>
 #include <QDirIterator>
+#include <QFileInfo>
+#include <QMap>
+#include <QPair>
 #include <QUuid>
 #include <QSqlQuery>
 #include <QRegularExpression>
+#include <QSet>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <limits>
 
 #include <sodium.h>
 
@@ -19,12 +34,23 @@ namespace openmittsu {
 	namespace database {
 		namespace internal {
 
-			ExternalMediaFileStorage::ExternalMediaFileStorage(QDir const& storagePath, InternalDatabaseInterface* database) : MediaFileStorage(), m_storagePath(storagePath), m_database(database) {
+			namespace {
+				QString const optionNameContentHashKey = QStringLiteral("media_content_key");
+				QString const optionNameContentLayout = QStringLiteral("media_content_layout");
+				QString const contentLayoutFlat = QStringLiteral("flat");
+				QString const contentLayoutSharded = QStringLiteral("sharded");
+			}
+
+			ExternalMediaFileStorage::ExternalMediaFileStorage(QDir const& storagePath, InternalDatabaseInterface* database) : MediaFileStorage(), m_storagePath(storagePath), m_database(database), m_contentHashKey(), m_contentLayout(ContentLayout::UNKNOWN), m_cache(std::make_shared<MediaItemCache>()), m_ioPool(std::make_shared<MediaIoPool>()), m_pendingWrites(), m_writeNotifier(std::make_unique<MediaWriteNotifier>([this]() { onPendingWritesFinished(); })) {
 				//
 			}
 
 			ExternalMediaFileStorage::~ExternalMediaFileStorage() {
-				//
+				// Running jobs still notify, and writes that were not stored only leave their temporary files behind.
+				m_ioPool->waitForDone();
+				for (PendingWrite const& write : m_pendingWrites) {
+					QFile::remove(write.content->temporaryFileName);
+				}
 			}
 
 			void ExternalMediaFileStorage::upgradeMediaDatabase(int fromVersion) {
@@ -42,15 +68,271 @@ namespace openmittsu {
 					}
 					fromVersion = 2;
 				}
+				if (fromVersion < 4) {
+					// Files are converted to the shared chunked format by the background maintenance or when first opened for streaming, not during the upgrade.
+					LOGGER()->info("Existing media files will be migrated to the deduplicated chunked file format in the background.");
+					fromVersion = 4;
+				}
+			}
+
+			int ExternalMediaFileStorage::removeUnreferencedFiles(QString const& startAfterFileName, int maxFileCount, QString& lastVisitedFileName) {
+				QStringList const unreferencedFiles = findUnreferencedFiles(startAfterFileName, maxFileCount, lastVisitedFileName);
+				int removedFiles = 0;
+				for (QString const& relativeFileName : unreferencedFiles) {
+					if (removeUnreferencedFile(relativeFileName)) {
+						++removedFiles;
+					}
+				}
+				return removedFiles;
+			}
+
+			bool ExternalMediaFileStorage::removeUnreferencedFile(QString const& relativeFileName) {
+				if (isReferencedFile(relativeFileName)) {
+					return false;
+				}
+
+				LOGGER()->info("Removing media file {} as it is not referenced by the database.", relativeFileName.toStdString());
+				if (!m_storagePath.remove(relativeFileName)) {
+					LOGGER()->warn("Could not remove unreferenced media file {}.", relativeFileName.toStdString());
+					return false;
+				}
+				return true;
+			}
+
+			QStringList ExternalMediaFileStorage::findUnreferencedFiles(QString const& startAfterFileName, int maxFileCount, QString& lastVisitedFileName) const {
+				QStringList unreferencedFiles;
+				int visitedFiles = 0;
+				lastVisitedFileName.clear();
+
+				auto visitFile = [&](QString const& relativeFileName) {
+					++visitedFiles;
+					lastVisitedFileName = relativeFileName;
+					if (!isReferencedFile(relativeFileName)) {
+						unreferencedFiles.append(relativeFileName);
+					}
+				};
+
+				// Files directly in the storage directory are visited first, then the shard directories. Shard paths never start with "encMedia_".
+				bool const isInShards = !startAfterFileName.isEmpty() && !startAfterFileName.startsWith(QStringLiteral("encMedia_"));
+				if (!isInShards) {
+					QStringList fileNames = m_storagePath.entryList(QStringList({ QStringLiteral("encMedia_*") }), QDir::Files | QDir::NoDotAndDotDot, QDir::NoSort);
+					std::sort(fileNames.begin(), fileNames.end());
+
+					auto it = std::upper_bound(fileNames.constBegin(), fileNames.constEnd(), startAfterFileName);
+					auto const end = fileNames.constEnd();
+					for (; (it != end) && (visitedFiles < maxFileCount); ++it) {
+						visitFile(*it);
+					}
+
+					if ((it != end) || (visitedFiles >= maxFileCount)) {
+						return unreferencedFiles;
+					}
+				}
+
+				int const remainingFileCount = maxFileCount - visitedFiles;
+				QStringList const shardedFiles = listShardedFiles(isInShards ? startAfterFileName : QString(), remainingFileCount);
+				auto it = shardedFiles.constBegin();
+				auto const end = shardedFiles.constEnd();
+				for (; it != end; ++it) {
+					visitFile(*it);
+				}
+
+				if (shardedFiles.size() < remainingFileCount) {
+					lastVisitedFileName.clear();
+				}
+
+				return unreferencedFiles;
+			}
+
+			QStringList ExternalMediaFileStorage::listShardedFiles(QString const& startAfterFileName, int maxFileCount) const {
+				static QRegularExpression const shardRegex(QStringLiteral("^[0-9a-f]{2}$"));
+				QStringList result;
+				if (maxFileCount <= 0) {
+					return result;
+				}
+
+				auto listSorted = [](QDir const& dir, QDir::Filters filters) -> QStringList {
+					QStringList names = dir.entryList(filters | QDir::NoDotAndDotDot, QDir::NoSort);
+					std::sort(names.begin(), names.end());
+					return names;
+				};
+
+				// Whole directories before the cursor are skipped without listing them.
+				bool const hasCursor = !startAfterFileName.isEmpty();
+				QString const cursorFirstLevel = startAfterFileName.section(QChar('/'), 0, 0);
+				QString const cursorSecondLevel = startAfterFileName.section(QChar('/'), 1, 1);
+				QStringList const firstLevel = listSorted(m_storagePath, QDir::Dirs);
+				for (QString const& first : firstLevel) {
+					if (!shardRegex.match(first).hasMatch() || (hasCursor && (first < cursorFirstLevel))) {
+						continue;
+					}
+
+					QDir const firstDir(m_storagePath.filePath(first));
+					QStringList const secondLevel = listSorted(firstDir, QDir::Dirs);
+					for (QString const& second : secondLevel) {
+						if (!shardRegex.match(second).hasMatch() || (hasCursor && (first == cursorFirstLevel) && (second < cursorSecondLevel))) {
+							continue;
+						}
+
+						QStringList const fileNames = listSorted(QDir(firstDir.filePath(second)), QDir::Files);
+						for (QString const& fileName : fileNames) {
+							QString const relativeFileName = QStringLiteral("%1/%2/%3").arg(first).arg(second).arg(fileName);
+							if (hasCursor && (relativeFileName <= startAfterFileName)) {
+								continue;
+							}
+
+							result.append(relativeFileName);
+							if (result.size() >= maxFileCount) {
+								return result;
+							}
+						}
+					}
+				}
+
+				return result;
+			}
+
+			bool ExternalMediaFileStorage::isReferencedFile(QString const& relativeFileName) const {
+				static QRegularExpression const itemRegex(QStringLiteral("^encMedia_([12])_([12])_(.+)$"));
+				static QRegularExpression const contentRegex(QStringLiteral("^encMedia_3_([0-9a-f]+)$"));
+				static QRegularExpression const temporaryRegex(QStringLiteral("^encMedia_tmp_"));
+
+				int const separatorIndex = relativeFileName.lastIndexOf(QChar('/'));
+				QString const directory = (separatorIndex < 0) ? QString() : relativeFileName.left(separatorIndex);
+				QString const fileName = relativeFileName.mid(separatorIndex + 1);
+
+				QRegularExpressionMatch const itemMatch = itemRegex.match(fileName);
+				QRegularExpressionMatch const contentMatch = contentRegex.match(fileName);
+				if (itemMatch.hasMatch()) {
+					// Files left behind by an interrupted format migration are unreferenced as well, as the database only points to one format.
+					FileFormat const fileFormat = static_cast<FileFormat>(itemMatch.captured(1).toInt());
+					MediaFileType const fileType = MediaFileTypeHelper::fromInt(itemMatch.captured(2).toInt());
+					return directory.isEmpty() && (getMediaItemRecord(itemMatch.captured(3), fileType).format == fileFormat);
+				} else if (contentMatch.hasMatch()) {
+					QString const contentId = contentMatch.captured(1);
+					MediaItemRecord record;
+					if (!getContentRecord(contentId, record)) {
+						return false;
+					} else if (!directory.isEmpty()) {
+						return directory == getShardDirectoryName(contentId);
+					}
+
+					// A flat file is a copy left behind by an interrupted move if the sharded one exists, and otherwise still waits to be moved.
+					if (QFile::exists(getShardedContentFilePath(contentId))) {
+						return false;
+					} else if (!hasFlatContentFiles()) {
+						m_contentLayout = ContentLayout::FLAT_FILES_REMAINING;
+						m_database->setInternalOptionValue(optionNameContentLayout, contentLayoutFlat);
+					}
+					return true;
+				} else if (temporaryRegex.match(fileName).hasMatch()) {
+					// Temporary files of inserts that are still running must not be touched.
+					return QFileInfo(m_storagePath.filePath(relativeFileName)).lastModified() > QDateTime::currentDateTime().addDays(-1);
+				}
+
+				return true;
 			}
 
-			QString ExternalMediaFileStorage::buildFilename(QString const& uuid, MediaFileType const& fileType) const {
-				return QStringLiteral("encMedia_1_%1_").arg(MediaFileTypeHelper::toInt(fileType)).append(uuid);
+			QString ExternalMediaFileStorage::buildFilename(QString const& uuid, MediaFileType const& fileType, FileFormat const& format) const {
+				return QStringLiteral("encMedia_%1_%2_").arg(static_cast<int>(format)).arg(MediaFileTypeHelper::toInt(fileType)).append(uuid);
+			}
+
+			QString ExternalMediaFileStorage::buildContentFilename(QString const& contentId) const {
+				return QStringLiteral("encMedia_%1_").arg(static_cast<int>(FileFormat::CHUNKED_SHARED)).append(contentId);
+			}
+
+			QString ExternalMediaFileStorage::buildTemporaryFilename() const {
+				return QStringLiteral("encMedia_tmp_").append(QUuid::createUuid().toString().mid(1, 36));
+			}
+
+			QString ExternalMediaFileStorage::getShardDirectoryName(QString const& contentId) {
+				return QStringLiteral("%1/%2").arg(contentId.left(2)).arg(contentId.mid(2, 2));
+			}
+
+			QString ExternalMediaFileStorage::getShardedContentFilePath(QString const& contentId) const {
+				return m_storagePath.filePath(QStringLiteral("%1/%2").arg(getShardDirectoryName(contentId)).arg(buildContentFilename(contentId)));
+			}
+
+			QString ExternalMediaFileStorage::getContentFilePath(QString const& contentId) const {
+				QString const shardedFilePath = getShardedContentFilePath(contentId);
+				if (hasFlatContentFiles() && !QFile::exists(shardedFilePath)) {
+					QString const flatFilePath = m_storagePath.filePath(buildContentFilename(contentId));
+					if (QFile::exists(flatFilePath)) {
+						return flatFilePath;
+					}
+				}
+				return shardedFilePath;
+			}
+
+			bool ExternalMediaFileStorage::hasFlatContentFiles() const {
+				if (m_contentLayout == ContentLayout::UNKNOWN) {
+					if (m_database->hasInternalOption(optionNameContentLayout)) {
+						m_contentLayout = (m_database->getInternalOptionValue(optionNameContentLayout) == contentLayoutSharded) ? ContentLayout::SHARDED : ContentLayout::FLAT_FILES_REMAINING;
+					} else {
+						// Without the option, the database was last used by a version writing all content files flat.
+						QSqlQuery query(m_database->getQueryObject());
+						if (!query.exec(QStringLiteral("SELECT 1 FROM `media_content` LIMIT 1;")) || !query.isSelect()) {
+							throw openmittsu::exceptions::InternalErrorException() << "Could not query table 'media_content'. Query error: " << query.lastError().text().toStdString();
+						}
+						m_contentLayout = query.next() ? ContentLayout::FLAT_FILES_REMAINING : ContentLayout::SHARDED;
+						m_database->setInternalOptionValue(optionNameContentLayout, (m_contentLayout == ContentLayout::SHARDED) ? contentLayoutSharded : contentLayoutFlat);
+					}
+				}
+				return m_contentLayout == ContentLayout::FLAT_FILES_REMAINING;
+			}
+
+			QString ExternalMediaFileStorage::getFilePath(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& record) const {
+				if (record.format == FileFormat::CHUNKED_SHARED) {
+					return getContentFilePath(record.contentId);
+				}
+				return m_storagePath.filePath(buildFilename(uuid, fileType, record.format));
+			}
+
+			ExternalMediaFileStorage::MediaItemRecord ExternalMediaFileStorage::getMediaItemRecord(QString const& uuid, MediaFileType const& fileType) const {
+				MediaItemRecord record = { FileFormat::NOT_IN_DATABASE, 0, 0, QByteArray(), QByteArray(), QString() };
+
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `size`, `checksum`, `nonce`, `key`, `format`, `content_id` FROM %1 WHERE `uid` = :uuid AND `type` = :type").arg(DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("media"))));
+				query.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
+				query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
+
+				if (!query.exec() || !query.isSelect()) {
+					LOGGER()->warn("Could not execute media query for uuid \"{}\" table 'media'. Query error: {}", uuid.toStdString(), query.lastError().text().toStdString());
+					return record;
+				} else if (!query.next()) {
+					return record;
+				}
+
+				int const format = query.value(QStringLiteral("format")).toInt();
+				if ((format < static_cast<int>(FileFormat::LEGACY_SINGLE_BLOB)) || (format > static_cast<int>(FileFormat::EVICTED))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not fetch media item for uuid \"" << uuid.toStdString() << "\". The file format " << format << " is unknown.";
+				}
+				record.format = static_cast<FileFormat>(format);
+				record.contentId = query.value(QStringLiteral("content_id")).toString();
+				if ((record.format == FileFormat::CHUNKED_SHARED) && record.contentId.isEmpty()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not fetch media item for uuid \"" << uuid.toStdString() << "\". The content reference is missing.";
+				}
+				record.size = query.value(QStringLiteral("size")).toInt();
+				record.checksum = query.value(QStringLiteral("checksum")).toUInt();
+				record.nonce = QByteArray::fromHex(query.value(QStringLiteral("nonce")).toString().toUtf8());
+				if (record.nonce.size() != cryptoGetNonceSize()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not fetch media item for uuid \"" << uuid.toStdString() << "\". The nonce size is incorrect.";
+				}
+				record.key = QByteArray::fromHex(query.value(QStringLiteral("key")).toString().toUtf8());
+				if (record.key.size() != cryptoGetKeySize()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not fetch media item for uuid \"" << uuid.toStdString() << "\". The key size is incorrect.";
+				}
+
+				return record;
 			}
 
 			bool ExternalMediaFileStorage::hasMediaItem(QString const& uuid, MediaFileType const& fileType) const {
+				if (findPendingInsert(uuid, fileType) != nullptr) {
+					return true;
+				}
+
 				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `uid` FROM `media` WHERE `uid` = :uuid AND `type` = :type"));
+				query.prepare(QStringLiteral("SELECT `uid` FROM %1 WHERE `uid` = :uuid AND `type` = :type").arg(DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("media"))));
 				query.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
 				query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
 
@@ -62,124 +344,1084 @@ namespace openmittsu {
 			}
 
 			int ExternalMediaFileStorage::getMediaItemCount() const {
-				return DatabaseUtilities::countQuery(m_database, QStringLiteral("media"));
+				return DatabaseUtilities::countQueryInAllSchemas(m_database, QStringLiteral("media"));
+			}
+
+			std::shared_future<MediaFileItem> ExternalMediaFileStorage::getMediaItemAsync(QString const& uuid, MediaFileType const& fileType) const {
+				return getMediaItemHandle(uuid, fileType).load();
+			}
+
+			MediaItemHandle ExternalMediaFileStorage::getMediaItemHandle(QString const& uuid, MediaFileType const& fileType) const {
+				// Items still written on the pool are served from the data they were inserted with.
+				PendingWrite const* const pendingInsert = findPendingInsert(uuid, fileType);
+				if ((pendingInsert != nullptr) && pendingInsert->hasData) {
+					return MediaItemHandle(MediaFileItem(pendingInsert->data, fileType));
+				}
+
+				quint64 const cacheGeneration = m_cache->getGeneration();
+				MediaItemRecord const record = getMediaItemRecord(uuid, fileType);
+				if (record.format == FileFormat::NOT_IN_DATABASE) {
+					return MediaItemHandle(MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, fileType));
+				} else if (record.format == FileFormat::EVICTED) {
+					return MediaItemHandle(MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED, fileType));
+				}
+
+				// Only the metadata lookup above needs the database, the loader gets copies of everything else.
+				QString const fileName = getFilePath(uuid, fileType, record);
+				std::shared_ptr<MediaItemCache> const cache = m_cache;
+				std::shared_ptr<MediaIoPool> const pool = m_ioPool;
+				MediaItemHandle::Loader const loader = [uuid, fileType, fileName, record, cache, cacheGeneration, pool]() {
+					QByteArray cachedData;
+					if (cache->get(uuid, fileType, cachedData)) {
+						return MediaIoPool::makeReadyFuture(MediaFileItem(cachedData, fileType));
+					}
+
+					return pool->submit([uuid, fileType, fileName, record, cache, cacheGeneration]() {
+						MediaFileItem const item = readMediaFile(uuid, fileType, fileName, record);
+						if (item.isAvailable()) {
+							cache->insert(uuid, fileType, item.getData(), cacheGeneration);
+						}
+						return item;
+					});
+				};
+
+				// Legacy files are a single encrypted blob, those are left to the loader and served from memory.
+				if ((record.format != FileFormat::CHUNKED) && (record.format != FileFormat::CHUNKED_SHARED)) {
+					return MediaItemHandle(loader);
+				}
+
+				return MediaItemHandle(loader, [uuid, fileName, record]() -> std::unique_ptr<QIODevice> {
+					std::unique_ptr<ChunkedMediaFileReader> reader = std::make_unique<ChunkedMediaFileReader>(fileName, record.key, record.nonce);
+					if (!reader->open() || (reader->getSize() != record.size)) {
+						LOGGER()->warn("Could not stream media item for uuid \"{}\", the file is missing or damaged.", uuid.toStdString());
+						return nullptr;
+					}
+					return std::make_unique<ChunkedMediaFileDevice>(std::move(reader));
+				});
 			}
 
-			MediaFileItem ExternalMediaFileStorage::getMediaItem(QString const& uuid, MediaFileType const& fileType) const {
+			MediaItemCache& ExternalMediaFileStorage::getCache() {
+				return *m_cache;
+			}
+
+			MediaItemCache const& ExternalMediaFileStorage::getCache() const {
+				return *m_cache;
+			}
+
+			MediaFileItem ExternalMediaFileStorage::readMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record) {
+				switch (record.format) {
+					case FileFormat::LEGACY_SINGLE_BLOB:
+						return readLegacyMediaFile(uuid, fileType, fileName, record);
+					case FileFormat::CHUNKED:
+					case FileFormat::CHUNKED_SHARED:
+						return readChunkedMediaFile(uuid, fileType, fileName, record);
+					case FileFormat::EVICTED:
+						return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED, fileType);
+					default:
+						return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, fileType);
+				}
+			}
+
+			MediaFileItem ExternalMediaFileStorage::readLegacyMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record) {
+				QFile file(fileName);
+				if (!file.open(QFile::ReadOnly)) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". Could not open or read file.", uuid.toStdString());
+					return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_EXTERNAL_FILE_DELETED, fileType);
+				}
+
+				QByteArray const data = file.readAll();
+				file.close();
+
+				if (data.size() < cryptoGetHeaderSize()) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". The file is truncated.", uuid.toStdString());
+					return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_FILE_CORRUPTED, fileType);
+				}
+
+				QByteArray decryptedData;
+				try {
+					decryptedData = decrypt(data, record.key, record.nonce);
+				} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". Decryption failed: {}", uuid.toStdString(), iee.what());
+					return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_DECRYPTION_FAILED, fileType);
+				}
+
+				if (decryptedData.size() != record.size) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". File size {} Bytes does not match expected size of {} Bytes!", uuid.toStdString(), decryptedData.size(), record.size);
+					return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_DECRYPTION_FAILED, fileType);
+				} else if (record.checksum != openmittsu::crypto::Crc32::checksum(decryptedData)) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". The specified checksum {} did not match the checksum of the retrieved object {}.", uuid.toStdString(), openmittsu::crypto::Crc32::toString(record.checksum).toStdString(), openmittsu::crypto::Crc32::toString(openmittsu::crypto::Crc32::checksum(decryptedData)).toStdString());
+					return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_FILE_CORRUPTED, fileType);
+				}
+
+				return MediaFileItem(decryptedData, fileType);
+			}
+
+			MediaFileItem ExternalMediaFileStorage::readChunkedMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record) {
+				QByteArray decryptedData;
+				MediaFileItem::ItemStatus const status = checkChunkedMediaFile(uuid, fileName, record, &decryptedData);
+				if (status != MediaFileItem::ItemStatus::AVAILABLE) {
+					return MediaFileItem(status, fileType);
+				}
+				return MediaFileItem(decryptedData, fileType);
+			}
+
+			MediaFileItem::ItemStatus ExternalMediaFileStorage::checkChunkedMediaFile(QString const& uuid, QString const& fileName, MediaItemRecord const& record, QByteArray* decryptedData) {
+				ChunkedMediaFileReader reader(fileName, record.key, record.nonce);
+				if (!reader.open()) {
+					if (!QFile::exists(fileName)) {
+						LOGGER()->warn("Could not fetch media item for uuid \"{}\". Could not open or read file.", uuid.toStdString());
+						return MediaFileItem::ItemStatus::UNAVAILABLE_EXTERNAL_FILE_DELETED;
+					}
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". The file header is damaged.", uuid.toStdString());
+					return MediaFileItem::ItemStatus::UNAVAILABLE_FILE_CORRUPTED;
+				} else if (reader.getSize() != record.size) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". File size {} Bytes does not match expected size of {} Bytes!", uuid.toStdString(), reader.getSize(), record.size);
+					return MediaFileItem::ItemStatus::UNAVAILABLE_DECRYPTION_FAILED;
+				}
+
+				// Decrypt chunk by chunk into the result, so no encrypted copy of the whole file is held in memory. Without a result, only one chunk is held at a time.
+				if (decryptedData != nullptr) {
+					decryptedData->reserve(record.size);
+				}
+				uint32_t checksum = 0;
+				try {
+					for (qint64 chunkIndex = 0; chunkIndex < reader.getChunkCount(); ++chunkIndex) {
+						QByteArray const chunk = reader.readChunk(chunkIndex);
+						checksum = openmittsu::crypto::Crc32::update(checksum, chunk.constData(), chunk.size());
+						if (decryptedData != nullptr) {
+							decryptedData->append(chunk);
+						}
+					}
+				} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". Decryption failed: {}", uuid.toStdString(), iee.what());
+					return MediaFileItem::ItemStatus::UNAVAILABLE_DECRYPTION_FAILED;
+				}
+
+				if (record.checksum != checksum) {
+					LOGGER()->warn("Could not fetch media item for uuid \"{}\". The specified checksum {} did not match the checksum of the retrieved object {}.", uuid.toStdString(), openmittsu::crypto::Crc32::toString(record.checksum).toStdString(), openmittsu::crypto::Crc32::toString(checksum).toStdString());
+					return MediaFileItem::ItemStatus::UNAVAILABLE_FILE_CORRUPTED;
+				}
+
+				return MediaFileItem::ItemStatus::AVAILABLE;
+			}
+
+			MediaFileItem::ItemStatus ExternalMediaFileStorage::verifyMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record) {
+				switch (record.format) {
+					case FileFormat::LEGACY_SINGLE_BLOB:
+						return readLegacyMediaFile(uuid, fileType, fileName, record).getStatus();
+					case FileFormat::CHUNKED:
+					case FileFormat::CHUNKED_SHARED:
+						return checkChunkedMediaFile(uuid, fileName, record, nullptr);
+					case FileFormat::EVICTED:
+						return MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED;
+					default:
+						return MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE;
+				}
+			}
+
+			QList<ExternalMediaFileStorage::PendingVerification> ExternalMediaFileStorage::verifyMediaItems(QString const& startAfterUuid, int maxItemCount, QString& lastVisitedUuid, MediaIoPool& pool) const {
+				QString const mediaTable = DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("media"));
+				QList<std::pair<QString, MediaFileType>> items;
+				QSet<QString> visitedUuids;
+				lastVisitedUuid.clear();
+				{
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `uid`, `type` FROM %1 WHERE `uid` IN (SELECT DISTINCT `uid` FROM %1 WHERE `uid` > :cursor ORDER BY `uid` ASC LIMIT :limit) ORDER BY `uid` ASC, `type` ASC;").arg(mediaTable));
+					query.bindValue(QStringLiteral(":cursor"), QVariant(startAfterUuid));
+					query.bindValue(QStringLiteral(":limit"), QVariant(maxItemCount));
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute media verification query on table 'media'. Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						QString const uuid = query.value(QStringLiteral("uid")).toString();
+						items.append(std::make_pair(uuid, MediaFileTypeHelper::fromInt(query.value(QStringLiteral("type")).toInt())));
+						visitedUuids.insert(uuid);
+						lastVisitedUuid = uuid;
+					}
+				}
+
+				QList<PendingVerification> result;
+				for (std::pair<QString, MediaFileType> const& item : items) {
+					QString const uuid = item.first;
+					MediaFileType const fileType = item.second;
+					MediaItemRecord record;
+					try {
+						record = getMediaItemRecord(uuid, fileType);
+					} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+						LOGGER()->warn("The database entry of media item {} is damaged: {}", uuid.toStdString(), iee.what());
+						result.append({ uuid, fileType, MediaIoPool::makeReadyFuture(MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_CRYPTO_ERROR, fileType)) });
+						continue;
+					}
+
+					QString const fileName = getFilePath(uuid, fileType, record);
+					result.append({ uuid, fileType, pool.submit([uuid, fileType, fileName, record]() {
+						return MediaFileItem(verifyMediaFile(uuid, fileType, fileName, record), fileType);
+					}) });
+				}
+
+				if (visitedUuids.size() < maxItemCount) {
+					lastVisitedUuid.clear();
+				}
+
+				return result;
+			}
+
+			void ExternalMediaFileStorage::markDamagedMediaItem(DamagedMediaItem const& item) {
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("INSERT OR REPLACE INTO `media_damage` (`uid`, `type`, `status`, `detected_at`) VALUES (:uuid, :type, :status, :detectedAt);"));
+				query.bindValue(QStringLiteral(":uuid"), QVariant(item.uuid));
+				query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(item.fileType)));
+				query.bindValue(QStringLiteral(":status"), QVariant(static_cast<int>(item.status)));
+				query.bindValue(QStringLiteral(":detectedAt"), QVariant(QDateTime::currentMSecsSinceEpoch()));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not mark media item " << item.uuid.toStdString() << " as damaged. Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+			void ExternalMediaFileStorage::clearDamagedMediaItem(QString const& uuid, MediaFileType const& fileType) {
 				QSqlQuery query(m_database->getQueryObject());
-				query.prepare(QStringLiteral("SELECT `uid`, `size`, `checksum`, `nonce`, `key` FROM `media` WHERE `uid` = :uuid AND `type` = :type"));
+				query.prepare(QStringLiteral("DELETE FROM `media_damage` WHERE `uid` = :uuid AND `type` = :type;"));
 				query.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
 				query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not delete damage mark of media item " << uuid.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+			QList<ExternalMediaFileStorage::DamagedMediaItem> ExternalMediaFileStorage::getDamagedMediaItems() const {
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.exec(QStringLiteral("SELECT `uid`, `type`, `status` FROM `media_damage` ORDER BY `uid` ASC, `type` ASC;")) || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not query damaged media items. Query error: " << query.lastError().text().toStdString();
+				}
+
+				QList<DamagedMediaItem> result;
+				while (query.next()) {
+					result.append({ query.value(QStringLiteral("uid")).toString(), MediaFileTypeHelper::fromInt(query.value(QStringLiteral("type")).toInt()), static_cast<MediaFileItem::ItemStatus>(query.value(QStringLiteral("status")).toInt()) });
+				}
+				return result;
+			}
+
+			std::unique_ptr<ChunkedMediaFileReader> ExternalMediaFileStorage::openMediaItem(QString const& uuid, MediaFileType const& fileType) {
+				MediaItemRecord const record = getMediaItemRecord(uuid, fileType);
+				if (record.format == FileFormat::LEGACY_SINGLE_BLOB) {
+					// Migrating here would mean waiting for the pool, the item is queued and can be read through a handle meanwhile.
+					migrateLegacyFile(uuid, fileType);
+					return nullptr;
+				} else if ((record.format != FileFormat::CHUNKED) && (record.format != FileFormat::CHUNKED_SHARED)) {
+					return nullptr;
+				}
 
-				if (query.exec() && query.isSelect() && query.next()) {
-					int const size = query.value(QStringLiteral("size")).toInt();
-					uint32_t const specifiedChecksum = query.value(QStringLiteral("checksum")).toUInt();
-					QString const nonceString = query.value(QStringLiteral("nonce")).toString();
-					QByteArray const nonce = QByteArray::fromHex(nonceString.toUtf8());
-					if (nonce.size() != cryptoGetNonceSize()) {
-						throw openmittsu::exceptions::InternalErrorException() << "Could not fetch media item for uuid \"" << uuid.toStdString() << "\". The nonce size is incorrect.";
+				std::unique_ptr<ChunkedMediaFileReader> reader = std::make_unique<ChunkedMediaFileReader>(getFilePath(uuid, fileType, record), record.key, record.nonce);
+				if (!reader->open() || (reader->getSize() != record.size)) {
+					LOGGER()->warn("Could not open media item for uuid \"{}\", the file is missing or damaged.", uuid.toStdString());
+					return nullptr;
+				}
+
+				return reader;
+			}
+
+			void ExternalMediaFileStorage::insertMediaItem(QString const& uuid, QByteArray const& data, MediaFileType const& fileType) {
+				QByteArray const hashKey = getContentHashKey();
+				cancelPendingWrites(uuid, fileType);
+				m_cache->remove(uuid, fileType);
+
+				PendingWrite write = { uuid, fileType, data, true, false, { FileFormat::NOT_IN_DATABASE, 0, 0, QByteArray(), QByteArray(), QString() }, std::make_shared<PreparedContent>(createPreparedContent()), std::shared_future<void>(), false };
+				std::shared_ptr<PreparedContent> const content = write.content;
+				queueWrite(write, [data, hashKey, content]() {
+					prepareContent(data, hashKey, *content);
+				});
+			}
+
+			void ExternalMediaFileStorage::insertMediaItem(QString const& uuid, std::unique_ptr<QIODevice>&& source, MediaFileType const& fileType) {
+				QByteArray const hashKey = getContentHashKey();
+				cancelPendingWrites(uuid, fileType);
+				m_cache->remove(uuid, fileType);
+
+				PendingWrite write = { uuid, fileType, QByteArray(), false, false, { FileFormat::NOT_IN_DATABASE, 0, 0, QByteArray(), QByteArray(), QString() }, std::make_shared<PreparedContent>(createPreparedContent()), std::shared_future<void>(), false };
+				std::shared_ptr<PreparedContent> const content = write.content;
+				std::shared_ptr<QIODevice> const sharedSource(std::move(source));
+				queueWrite(write, [sharedSource, hashKey, content]() {
+					prepareContent(*sharedSource, hashKey, *content);
+				});
+			}
+
+			void ExternalMediaFileStorage::queueWrite(PendingWrite& write, std::function<void()> const& job) {
+				MediaWriteNotifier* const notifier = m_writeNotifier.get();
+				write.result = m_ioPool->submitTask(job, [notifier]() {
+					notifier->notify();
+				});
+				m_pendingWrites.append(write);
+			}
+
+			void ExternalMediaFileStorage::cancelPendingWrites(QString const& uuid, MediaFileType const& fileType) {
+				for (PendingWrite& write : m_pendingWrites) {
+					if ((write.uuid == uuid) && (write.fileType == fileType)) {
+						write.isCancelled = true;
 					}
-					QString const keyString = query.value(QStringLiteral("key")).toString();
-					QByteArray const key = QByteArray::fromHex(keyString.toUtf8());
-					if (key.size() != cryptoGetKeySize()) {
-						throw openmittsu::exceptions::InternalErrorException() << "Could not fetch media item for uuid \"" << uuid.toStdString() << "\". The key size is incorrect.";
+				}
+			}
+
+			ExternalMediaFileStorage::PendingWrite const* ExternalMediaFileStorage::findPendingInsert(QString const& uuid, MediaFileType const& fileType) const {
+				for (PendingWrite const& write : m_pendingWrites) {
+					if ((!write.isCancelled) && (!write.isMigration) && (write.uuid == uuid) && (write.fileType == fileType)) {
+						return &write;
 					}
+				}
+				return nullptr;
+			}
 
-					QFile file(m_storagePath.filePath(buildFilename(uuid, fileType)));
-					if (!file.open(QFile::ReadOnly)) {
-						LOGGER()->warn("Could not fetch media item for uuid \"{}\". Could not open or read file.", uuid.toStdString());
-						return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_EXTERNAL_FILE_DELETED, fileType);
+			bool ExternalMediaFileStorage::hasPendingMigration(QString const& uuid, MediaFileType const& fileType) const {
+				for (PendingWrite const& write : m_pendingWrites) {
+					if ((!write.isCancelled) && write.isMigration && (write.uuid == uuid) && (write.fileType == fileType)) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			int ExternalMediaFileStorage::getPendingWriteCount() const {
+				return m_pendingWrites.size();
+			}
+
+			void ExternalMediaFileStorage::completePendingWrites() {
+				storePendingWrites(true);
+			}
+
+			void ExternalMediaFileStorage::onPendingWritesFinished() {
+				// Runs from the event loop, so errors can only be logged. The writes concerned are dropped, their messages show the media as missing.
+				try {
+					storePendingWrites(false);
+				} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+					LOGGER()->warn("Could not store media items written on the media I/O pool: {}", iee.what());
+				} catch (std::exception& e) {
+					LOGGER()->warn("Could not store media items written on the media I/O pool: {}", e.what());
+				}
+			}
+
+			void ExternalMediaFileStorage::storePendingWrites(bool waitForPool) {
+				// Taken out of the list first, as a notification can arrive for a job whose write was already stored by an earlier call.
+				QList<PendingWrite> finishedWrites;
+				for (auto it = m_pendingWrites.begin(); it != m_pendingWrites.end();) {
+					if (waitForPool) {
+						it->result.wait();
+					} else if (it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+						++it;
+						continue;
 					}
+					finishedWrites.append(*it);
+					it = m_pendingWrites.erase(it);
+				}
+				if (finishedWrites.isEmpty()) {
+					return;
+				}
 
-					QByteArray const data = file.readAll();
-					file.close();
+				std::exception_ptr error;
+				QStringList replacedFiles;
+				if (!m_database->transactionStart()) {
+					LOGGER()->warn("ExternalMediaFileStorage: Could NOT start transaction!");
+				}
+				try {
+					for (PendingWrite const& write : finishedWrites) {
+						try {
+							write.result.get();
+						} catch (...) {
+							// A failed job only drops its own write.
+							QFile::remove(write.content->temporaryFileName);
+							if (!error) {
+								error = std::current_exception();
+							}
+							continue;
+						}
+						storePendingWrite(write, replacedFiles);
+					}
 
-					QByteArray const decryptedData = decrypt(data, key, nonce);
-					if (decryptedData.size() != size) {
-						LOGGER()->warn("Could not fetch media item for uuid \"{}\". File size {} Bytes does not match expected size of {} Bytes!", uuid.toStdString(), decryptedData.size(), size);
-						return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_DECRYPTION_FAILED, fileType);
-					} else if (specifiedChecksum != openmittsu::crypto::Crc32::checksum(decryptedData)) {
-						LOGGER()->warn("Could not fetch media item for uuid \"{}\". The specified checksum {} did not match the checksum of the retrieved object {}.", uuid.toStdString(), openmittsu::crypto::Crc32::toString(specifiedChecksum).toStdString(), openmittsu::crypto::Crc32::toString(openmittsu::crypto::Crc32::checksum(decryptedData)).toStdString());
-						return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_FILE_CORRUPTED, fileType);
+					if (!m_database->transactionCommit()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not commit " << finishedWrites.size() << " media items.";
+					}
+				} catch (...) {
+					if (!m_database->transactionRollback()) {
+						LOGGER()->warn("ExternalMediaFileStorage: Could NOT roll back transaction!");
 					}
 
-					return MediaFileItem(decryptedData, fileType);
-				} else {
-					LOGGER()->warn("Could not execute media query for uuid \"{}\" table 'media'. Query error: {}", uuid.toStdString(), query.lastError().text().toStdString());
-					return MediaFileItem(MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, fileType);
+					// Content files moved into place by this transaction are unknown to the database again.
+					for (PendingWrite const& write : finishedWrites) {
+						QFile::remove(write.content->temporaryFileName);
+						MediaItemRecord record;
+						if (!write.content->record.contentId.isEmpty() && !getContentRecord(write.content->record.contentId, record)) {
+							QFile::remove(getShardedContentFilePath(write.content->record.contentId));
+						}
+					}
+					throw;
+				}
+
+				// The old files of migrated items are only removed once the database points to their replacements.
+				for (QString const& fileName : replacedFiles) {
+					QFile::remove(fileName);
+				}
+
+				if (error) {
+					std::rethrow_exception(error);
 				}
 			}
 
-			void ExternalMediaFileStorage::insertMediaItem(QString const& uuid, QByteArray const& data, MediaFileType const& fileType) {
-				int const size = data.size();
-				uint32_t actualChecksum = openmittsu::crypto::Crc32::checksum(data);
+			void ExternalMediaFileStorage::storePendingWrite(PendingWrite const& write, QStringList& replacedFiles) {
+				if (write.isCancelled) {
+					QFile::remove(write.content->temporaryFileName);
+					return;
+				}
 
-				QByteArray const key = generateKey();
-				QByteArray const nonce = generateNonce();
-				QByteArray const encryptedData = encrypt(data, key, nonce);
-				int const encryptedSize = data.size() + cryptoGetHeaderSize();
+				m_cache->remove(write.uuid, write.fileType);
+				if (!write.isMigration) {
+					insertMediaItemRecord(write.uuid, write.fileType, acquirePreparedContent(*write.content));
+					return;
+				}
 
-				QFile file(m_storagePath.filePath(buildFilename(uuid, fileType)));
-				if (!file.open(QFile::WriteOnly)) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not write media item for uuid \"" << uuid.toStdString() << "\". Could not open file for writing.";
+				// The item was evicted, removed or migrated otherwise while its file was written.
+				MediaItemRecord const record = getMediaItemRecord(write.uuid, write.fileType);
+				if ((record.format != write.previousRecord.format) || (record.key != write.previousRecord.key)) {
+					QFile::remove(write.content->temporaryFileName);
+					return;
 				}
 
-				qint64 const writtenBytes = file.write(encryptedData);
-				if (writtenBytes != encryptedSize) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not write media item for uuid \"" << uuid.toStdString() << "\". Could not write file data (size missmatch, " << writtenBytes << " vs. " << encryptedSize << " Bytes).";
+				updateMediaItemRecord(write.uuid, write.fileType, record, acquirePreparedContent(*write.content));
+				replacedFiles.append(m_storagePath.filePath(buildFilename(write.uuid, write.fileType, record.format)));
+			}
+
+			ExternalMediaFileStorage::PreparedContent ExternalMediaFileStorage::createPreparedContent() const {
+				PreparedContent content;
+				content.temporaryFileName = m_storagePath.filePath(buildTemporaryFilename());
+				content.record.key = generateKey();
+				content.record.nonce = generateNonce();
+				return content;
+			}
+
+			ExternalMediaFileStorage::MediaItemRecord ExternalMediaFileStorage::acquirePreparedContent(PreparedContent const& content) {
+				MediaItemRecord record;
+				if (addContentReference(content.record.contentId, record)) {
+					QFile::remove(content.temporaryFileName);
+					return record;
+				}
+
+				moveContentFileIntoPlace(content.temporaryFileName, content.record.contentId);
+				insertContentRecord(content.record);
+				return content.record;
+			}
+
+			void ExternalMediaFileStorage::prepareContent(QByteArray const& data, QByteArray const& hashKey, PreparedContent& content) {
+				QByteArray contentHash(crypto_generichash_BYTES, '\0');
+				crypto_generichash(reinterpret_cast<unsigned char*>(contentHash.data()), contentHash.size(), reinterpret_cast<unsigned char const*>(data.constData()), data.size(), reinterpret_cast<unsigned char const*>(hashKey.constData()), hashKey.size());
+
+				ChunkedMediaFileWriter writer(content.temporaryFileName, content.record.key, content.record.nonce);
+				writer.open();
+				writer.write(data);
+				writer.finish();
+
+				content.record.format = FileFormat::CHUNKED_SHARED;
+				content.record.size = data.size();
+				content.record.checksum = writer.getChecksum();
+				content.record.contentId = QString(contentHash.toHex());
+			}
+
+			void ExternalMediaFileStorage::prepareContent(QIODevice& source, QByteArray const& hashKey, PreparedContent& content) {
+				// The content hash is only known after all data was read, so hashing and encryption run side by side.
+				crypto_generichash_state hashState;
+				crypto_generichash_init(&hashState, reinterpret_cast<unsigned char const*>(hashKey.constData()), hashKey.size(), crypto_generichash_BYTES);
+
+				ChunkedMediaFileWriter writer(content.temporaryFileName, content.record.key, content.record.nonce);
+				writer.open();
+				QByteArray buffer(ChunkedMediaFileFormat::getDefaultChunkSize(), '\0');
+				while (true) {
+					qint64 const readBytes = source.read(buffer.data(), buffer.size());
+					if (readBytes < 0) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not write media item. Reading the source failed: " << source.errorString().toStdString();
+					} else if (readBytes == 0) {
+						break;
+					}
+					writer.write(buffer.constData(), readBytes);
+					crypto_generichash_update(&hashState, reinterpret_cast<unsigned char const*>(buffer.constData()), static_cast<unsigned long long>(readBytes));
+				}
+				writer.finish();
+
+				if (writer.getSize() > std::numeric_limits<int>::max()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not write media item. The item is too large.";
+				}
+
+				QByteArray contentHash(crypto_generichash_BYTES, '\0');
+				crypto_generichash_final(&hashState, reinterpret_cast<unsigned char*>(contentHash.data()), contentHash.size());
+
+				content.record.format = FileFormat::CHUNKED_SHARED;
+				content.record.size = static_cast<int>(writer.getSize());
+				content.record.checksum = writer.getChecksum();
+				content.record.contentId = QString(contentHash.toHex());
+			}
+
+			void ExternalMediaFileStorage::moveContentFileIntoPlace(QString const& temporaryFileName, QString const& contentId) {
+				QString const shardDirectory = getShardDirectoryName(contentId);
+				if (!m_storagePath.mkpath(shardDirectory)) {
+					QFile::remove(temporaryFileName);
+					throw openmittsu::exceptions::InternalErrorException() << "Could not create media directory \"" << shardDirectory.toStdString() << "\".";
+				}
+
+				// A file with this name can only be a leftover of an interrupted insert, as the content is not in the database.
+				QString const contentFileName = getShardedContentFilePath(contentId);
+				QFile::remove(contentFileName);
+				if (!QFile::rename(temporaryFileName, contentFileName)) {
+					QFile::remove(temporaryFileName);
+					throw openmittsu::exceptions::InternalErrorException() << "Could not move media file to \"" << contentFileName.toStdString() << "\".";
+				}
+
+				if (!openmittsu::utility::FileSync::syncDirectory(m_storagePath.filePath(shardDirectory))) {
+					LOGGER()->warn("Could not sync media directory {} to disk.", shardDirectory.toStdString());
+				}
+			}
+
+			bool ExternalMediaFileStorage::getContentRecord(QString const& contentId, MediaItemRecord& record) const {
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `size`, `checksum`, `nonce`, `key` FROM `media_content` WHERE `content_id` = :contentId;"));
+				query.bindValue(QStringLiteral(":contentId"), QVariant(contentId));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute media content query for content " << contentId.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				} else if (!query.next()) {
+					return false;
+				}
+
+				record.format = FileFormat::CHUNKED_SHARED;
+				record.size = query.value(QStringLiteral("size")).toInt();
+				record.checksum = query.value(QStringLiteral("checksum")).toUInt();
+				record.nonce = QByteArray::fromHex(query.value(QStringLiteral("nonce")).toString().toUtf8());
+				record.key = QByteArray::fromHex(query.value(QStringLiteral("key")).toString().toUtf8());
+				record.contentId = contentId;
+				return true;
+			}
+
+			bool ExternalMediaFileStorage::addContentReference(QString const& contentId, MediaItemRecord& record) {
+				if (!getContentRecord(contentId, record)) {
+					return false;
+				}
+
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("UPDATE `media_content` SET `refcount` = `refcount` + 1 WHERE `content_id` = :contentId;"));
+				query.bindValue(QStringLiteral(":contentId"), QVariant(contentId));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not add reference to media content " << contentId.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				}
+				return true;
+			}
+
+			void ExternalMediaFileStorage::insertContentRecord(MediaItemRecord const& record) {
+				// Decides the layout before the first content is added, as an empty content table tells that no flat files exist.
+				hasFlatContentFiles();
+
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("INSERT INTO `media_content` (`content_id`, `size`, `checksum`, `nonce`, `key`, `refcount`) VALUES (:contentId, :size, :checksum, :nonce, :key, 1);"));
+				query.bindValue(QStringLiteral(":contentId"), QVariant(record.contentId));
+				query.bindValue(QStringLiteral(":size"), QVariant(record.size));
+				query.bindValue(QStringLiteral(":checksum"), QVariant(record.checksum));
+				query.bindValue(QStringLiteral(":nonce"), QVariant(QString(record.nonce.toHex())));
+				query.bindValue(QStringLiteral(":key"), QVariant(QString(record.key.toHex())));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not insert media content into 'media_content'. Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+			bool ExternalMediaFileStorage::releaseContent(QString const& contentId) {
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("UPDATE `media_content` SET `refcount` = `refcount` - 1 WHERE `content_id` = :contentId;"));
+				query.bindValue(QStringLiteral(":contentId"), QVariant(contentId));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not release reference to media content " << contentId.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				}
+
+				query.prepare(QStringLiteral("SELECT `refcount` FROM `media_content` WHERE `content_id` = :contentId;"));
+				query.bindValue(QStringLiteral(":contentId"), QVariant(contentId));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not query references of media content " << contentId.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				} else if (!query.next() || (query.value(QStringLiteral("refcount")).toInt() > 0)) {
+					return false;
+				}
+
+				query.prepare(QStringLiteral("DELETE FROM `media_content` WHERE `content_id` = :contentId;"));
+				query.bindValue(QStringLiteral(":contentId"), QVariant(contentId));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not delete media content " << contentId.toStdString() << ". Query error: " << query.lastError().text().toStdString();
+				}
+				QFile::remove(getShardedContentFilePath(contentId));
+				if (hasFlatContentFiles()) {
+					QFile::remove(m_storagePath.filePath(buildContentFilename(contentId)));
+				}
+				return true;
+			}
+
+			QByteArray ExternalMediaFileStorage::getContentHashKey() {
+				if (!m_contentHashKey.isEmpty()) {
+					return m_contentHashKey;
+				}
+
+				// The hash is keyed with a per-database secret, so file names do not reveal whether a file holds some known content.
+				if (m_database->hasInternalOption(optionNameContentHashKey)) {
+					m_contentHashKey = QByteArray::fromHex(m_database->getInternalOptionValue(optionNameContentHashKey).toUtf8());
+					if (m_contentHashKey.size() != crypto_generichash_KEYBYTES) {
+						m_contentHashKey.clear();
+						throw openmittsu::exceptions::InternalErrorException() << "The stored media content hash key is corrupted.";
+					}
+				} else {
+					QByteArray key(crypto_generichash_KEYBYTES, '\0');
+					randombytes_buf(key.data(), key.size());
+					m_database->setInternalOptionValue(optionNameContentHashKey, QString(key.toHex()));
+					m_contentHashKey = key;
+				}
+
+				return m_contentHashKey;
+			}
+
+			void ExternalMediaFileStorage::insertMediaItemRecord(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& record) {
+				// Storing an evicted item again, e.g. after downloading it once more, fills its existing entry.
+				MediaItemRecord const previousRecord = getMediaItemRecord(uuid, fileType);
+				if (previousRecord.format == FileFormat::EVICTED) {
+					updateMediaItemRecord(uuid, fileType, previousRecord, record);
+					clearDamagedMediaItem(uuid, fileType);
+					return;
 				}
-				file.close();
 
 				QSqlQuery queryMedia(m_database->getQueryObject());
-				queryMedia.prepare(QStringLiteral("INSERT INTO `media` (`uid`, `type`, `size`, `checksum`, `nonce`, `key`) VALUES (:uid, :type, :size, :checksum, :nonce, :key);"));
+				queryMedia.prepare(QStringLiteral("INSERT INTO `media` (`uid`, `type`, `size`, `checksum`, `nonce`, `key`, `format`, `content_id`) VALUES (:uid, :type, :size, :checksum, :nonce, :key, :format, :contentId);"));
 				queryMedia.bindValue(QStringLiteral(":uid"), QVariant(uuid));
 				queryMedia.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
-				queryMedia.bindValue(QStringLiteral(":size"), QVariant(size));
-				queryMedia.bindValue(QStringLiteral(":checksum"), QVariant(actualChecksum));
-				queryMedia.bindValue(QStringLiteral(":nonce"), QVariant(QString(nonce.toHex())));
-				queryMedia.bindValue(QStringLiteral(":key"), QVariant(QString(key.toHex())));
+				queryMedia.bindValue(QStringLiteral(":size"), QVariant(record.size));
+				queryMedia.bindValue(QStringLiteral(":checksum"), QVariant(record.checksum));
+				queryMedia.bindValue(QStringLiteral(":nonce"), QVariant(QString(record.nonce.toHex())));
+				queryMedia.bindValue(QStringLiteral(":key"), QVariant(QString(record.key.toHex())));
+				queryMedia.bindValue(QStringLiteral(":format"), QVariant(static_cast<int>(record.format)));
+				queryMedia.bindValue(QStringLiteral(":contentId"), (record.contentId.isEmpty()) ? QVariant() : QVariant(record.contentId));
 				if (!queryMedia.exec()) {
 					throw openmittsu::exceptions::InternalErrorException() << "Could not insert media data into 'media'. Query error: " << queryMedia.lastError().text().toStdString();
 				}
+				updateMediaUsage(fileType, record, true);
+				clearDamagedMediaItem(uuid, fileType);
+			}
+
+			void ExternalMediaFileStorage::updateMediaItemRecord(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& previousRecord, MediaItemRecord const& record) {
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("UPDATE %1 SET `size` = :size, `checksum` = :checksum, `nonce` = :nonce, `key` = :key, `format` = :format, `content_id` = :contentId WHERE `uid` = :uuid AND `type` = :type;").arg(DatabaseUtilities::getQualifiedTableName(*it, QStringLiteral("media"))));
+					query.bindValue(QStringLiteral(":size"), QVariant(record.size));
+					query.bindValue(QStringLiteral(":checksum"), QVariant(record.checksum));
+					query.bindValue(QStringLiteral(":nonce"), QVariant(QString(record.nonce.toHex())));
+					query.bindValue(QStringLiteral(":key"), QVariant(QString(record.key.toHex())));
+					query.bindValue(QStringLiteral(":format"), QVariant(static_cast<int>(record.format)));
+					query.bindValue(QStringLiteral(":contentId"), (record.contentId.isEmpty()) ? QVariant() : QVariant(record.contentId));
+					query.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
+					query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
+					if (!query.exec()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not update media data in table 'media'. Query error: " << query.lastError().text().toStdString();
+					}
+				}
+
+				if ((previousRecord.size != record.size) || ((previousRecord.format == FileFormat::EVICTED) != (record.format == FileFormat::EVICTED))) {
+					updateMediaUsage(fileType, previousRecord, false);
+					updateMediaUsage(fileType, record, true);
+				}
+			}
+
+			int ExternalMediaFileStorage::migrateLegacyFiles(QString const& startAfterUuid, int maxItemCount, QString& lastVisitedUuid) {
+				QString const mediaTable = DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("media"));
+				QList<std::pair<QString, MediaFileType>> items;
+				QSet<QString> visitedUuids;
+				lastVisitedUuid.clear();
+				{
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `uid`, `type` FROM %1 WHERE `format` < 3 AND `uid` IN (SELECT DISTINCT `uid` FROM %1 WHERE `format` < 3 AND `uid` > :cursor ORDER BY `uid` ASC LIMIT :limit) ORDER BY `uid` ASC, `type` ASC;").arg(mediaTable));
+					query.bindValue(QStringLiteral(":cursor"), QVariant(startAfterUuid));
+					query.bindValue(QStringLiteral(":limit"), QVariant(maxItemCount));
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute legacy media query on table 'media'. Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						QString const uuid = query.value(QStringLiteral("uid")).toString();
+						items.append(std::make_pair(uuid, MediaFileTypeHelper::fromInt(query.value(QStringLiteral("type")).toInt())));
+						visitedUuids.insert(uuid);
+						lastVisitedUuid = uuid;
+					}
+				}
+
+				int migratedItems = 0;
+				auto it = items.constBegin();
+				auto const end = items.constEnd();
+				for (; it != end; ++it) {
+					if (migrateLegacyFile(it->first, it->second)) {
+						++migratedItems;
+					}
+				}
+
+				if (visitedUuids.size() < maxItemCount) {
+					lastVisitedUuid.clear();
+				}
+
+				return migratedItems;
+			}
+
+			int ExternalMediaFileStorage::moveToShardedLayout(QString const& startAfterContentId, int maxFileCount, QString& lastVisitedContentId) {
+				lastVisitedContentId.clear();
+				if (!hasFlatContentFiles()) {
+					return 0;
+				}
+
+				QStringList contentIds;
+				{
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `content_id` FROM `media_content` WHERE `content_id` > :cursor ORDER BY `content_id` ASC LIMIT :limit;"));
+					query.bindValue(QStringLiteral(":cursor"), QVariant(startAfterContentId));
+					query.bindValue(QStringLiteral(":limit"), QVariant(maxFileCount));
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute media content query on table 'media_content'. Query error: " << query.lastError().text().toStdString();
+					}
+					while (query.next()) {
+						contentIds.append(query.value(QStringLiteral("content_id")).toString());
+					}
+				}
+
+				int movedFiles = 0;
+				for (QString const& contentId : contentIds) {
+					lastVisitedContentId = contentId;
+					QString const flatFilePath = m_storagePath.filePath(buildContentFilename(contentId));
+					if (!QFile::exists(flatFilePath)) {
+						continue;
+					}
+
+					// The sharded file exists if an earlier move was interrupted after the rename.
+					QString const shardedFilePath = getShardedContentFilePath(contentId);
+					if (QFile::exists(shardedFilePath)) {
+						QFile::remove(flatFilePath);
+						continue;
+					}
+
+					QString const shardDirectory = getShardDirectoryName(contentId);
+					if (!m_storagePath.mkpath(shardDirectory) || !QFile::rename(flatFilePath, shardedFilePath)) {
+						LOGGER()->warn("Could not move media file {} into its shard directory, it will be retried in the next maintenance run.", buildContentFilename(contentId).toStdString());
+						continue;
+					}
+					openmittsu::utility::FileSync::syncDirectory(m_storagePath.filePath(shardDirectory));
+					++movedFiles;
+				}
+
+				if (contentIds.size() < maxFileCount) {
+					lastVisitedContentId.clear();
+
+					// Files that could not be moved are found by the orphaned file scan, which switches the layout back.
+					m_contentLayout = ContentLayout::SHARDED;
+					m_database->setInternalOptionValue(optionNameContentLayout, contentLayoutSharded);
+					LOGGER()->info("All media content files were moved into shard directories.");
+				}
+
+				return movedFiles;
+			}
+
+			bool ExternalMediaFileStorage::migrateLegacyFile(QString const& uuid, MediaFileType const& fileType) {
+				MediaItemRecord const record = getMediaItemRecord(uuid, fileType);
+				if (((record.format != FileFormat::LEGACY_SINGLE_BLOB) && (record.format != FileFormat::CHUNKED)) || hasPendingMigration(uuid, fileType)) {
+					return false;
+				}
+
+				// Reading the old file and writing the new one both happen on the pool. The shared file has a different name, so the old file stays valid until the database points to its replacement.
+				QString const fileName = getFilePath(uuid, fileType, record);
+				QByteArray const hashKey = getContentHashKey();
+				PendingWrite write = { uuid, fileType, QByteArray(), false, true, record, std::make_shared<PreparedContent>(createPreparedContent()), std::shared_future<void>(), false };
+				std::shared_ptr<PreparedContent> const content = write.content;
+				queueWrite(write, [uuid, fileType, fileName, record, hashKey, content]() {
+					MediaFileItem const item = readMediaFile(uuid, fileType, fileName, record);
+					if (!item.isAvailable()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not migrate media item for uuid \"" << uuid.toStdString() << "\" to the shared chunked format, the old file is not readable.";
+					}
+					prepareContent(item.getData(), hashKey, *content);
+				});
+				return true;
+			}
+
+			bool ExternalMediaFileStorage::removeMediaItemFiles(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& record) {
+				if (record.format == FileFormat::CHUNKED_SHARED) {
+					return releaseContent(record.contentId);
+				} else if ((record.format == FileFormat::LEGACY_SINGLE_BLOB) || (record.format == FileFormat::CHUNKED)) {
+					QFile::remove(m_storagePath.filePath(buildFilename(uuid, fileType, FileFormat::LEGACY_SINGLE_BLOB)));
+					QFile::remove(m_storagePath.filePath(buildFilename(uuid, fileType, FileFormat::CHUNKED)));
+					return true;
+				}
+				return false;
 			}
 
 			void ExternalMediaFileStorage::removeMediaItem(QString const& uuid, MediaFileType const& fileType) {
-				QFile::remove(m_storagePath.filePath(buildFilename(uuid, fileType)));
+				cancelPendingWrites(uuid, fileType);
+				m_cache->remove(uuid, fileType);
+				MediaItemRecord const record = getMediaItemRecord(uuid, fileType);
 
-				QSqlQuery queryMedia(m_database->getQueryObject());
-				queryMedia.prepare(QStringLiteral("DELETE FROM `media` WHERE `uid` = :uuid AND `type` = :type;"));
-				queryMedia.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
-				queryMedia.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
-				if (!queryMedia.exec()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not delete media data from table 'media'. Query error: " << queryMedia.lastError().text().toStdString();
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery queryMedia(m_database->getQueryObject());
+					queryMedia.prepare(QStringLiteral("DELETE FROM %1 WHERE `uid` = :uuid AND `type` = :type;").arg(DatabaseUtilities::getQualifiedTableName(*it, QStringLiteral("media"))));
+					queryMedia.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
+					queryMedia.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
+					if (!queryMedia.exec()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not delete media data from table 'media'. Query error: " << queryMedia.lastError().text().toStdString();
+					}
 				}
+
+				updateMediaUsage(fileType, record, false);
+				removeMediaItemFiles(uuid, fileType, record);
+				clearDamagedMediaItem(uuid, fileType);
 			}
 
 			void ExternalMediaFileStorage::removeAllMediaItems(QString const& uuid) {
-				QFile::remove(m_storagePath.filePath(buildFilename(uuid, MediaFileType::TYPE_STANDARD)));
-				QFile::remove(m_storagePath.filePath(buildFilename(uuid, MediaFileType::TYPE_THUMBNAIL)));
+				cancelPendingWrites(uuid, MediaFileType::TYPE_STANDARD);
+				cancelPendingWrites(uuid, MediaFileType::TYPE_THUMBNAIL);
+				m_cache->remove(uuid, MediaFileType::TYPE_STANDARD);
+				m_cache->remove(uuid, MediaFileType::TYPE_THUMBNAIL);
+				MediaItemRecord const standardRecord = getMediaItemRecord(uuid, MediaFileType::TYPE_STANDARD);
+				MediaItemRecord const thumbnailRecord = getMediaItemRecord(uuid, MediaFileType::TYPE_THUMBNAIL);
 
-				QSqlQuery queryMedia(m_database->getQueryObject());
-				queryMedia.prepare(QStringLiteral("DELETE FROM `media` WHERE `uid` = :uuid;"));
-				queryMedia.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
-				if (!queryMedia.exec()) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not delete media data from table 'media'. Query error: " << queryMedia.lastError().text().toStdString();
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				auto it = schemas.constBegin();
+				auto const end = schemas.constEnd();
+				for (; it != end; ++it) {
+					QSqlQuery queryMedia(m_database->getQueryObject());
+					queryMedia.prepare(QStringLiteral("DELETE FROM %1 WHERE `uid` = :uuid;").arg(DatabaseUtilities::getQualifiedTableName(*it, QStringLiteral("media"))));
+					queryMedia.bindValue(QStringLiteral(":uuid"), QVariant(uuid));
+					if (!queryMedia.exec()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not delete media data from table 'media'. Query error: " << queryMedia.lastError().text().toStdString();
+					}
+				}
+
+				updateMediaUsage(MediaFileType::TYPE_STANDARD, standardRecord, false);
+				updateMediaUsage(MediaFileType::TYPE_THUMBNAIL, thumbnailRecord, false);
+				removeMediaItemFiles(uuid, MediaFileType::TYPE_STANDARD, standardRecord);
+				removeMediaItemFiles(uuid, MediaFileType::TYPE_THUMBNAIL, thumbnailRecord);
+				clearDamagedMediaItem(uuid, MediaFileType::TYPE_STANDARD);
+				clearDamagedMediaItem(uuid, MediaFileType::TYPE_THUMBNAIL);
+			}
+
+			MediaFileStorage::MediaUsage ExternalMediaFileStorage::getMediaUsage() const {
+				MediaUsage usage = { 0, 0, 0 };
+
+				QSqlQuery query(m_database->getQueryObject());
+				if (!query.exec(QStringLiteral("SELECT `type`, `is_evicted`, `bytes` FROM `media_usage`;")) || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute media usage query on table 'media_usage'. Query error: " << query.lastError().text().toStdString();
+				}
+
+				bool hasTotals = false;
+				while (query.next()) {
+					hasTotals = true;
+					addToMediaUsage(usage, MediaFileTypeHelper::fromInt(query.value(QStringLiteral("type")).toInt()), query.value(QStringLiteral("is_evicted")).toBool(), query.value(QStringLiteral("bytes")).toLongLong());
+				}
+
+				// The totals are computed once for databases created by older versions, and kept up to date from then on.
+				if (!hasTotals) {
+					return storeMediaUsage();
+				}
+				return usage;
+			}
+
+			MediaFileStorage::MediaUsage ExternalMediaFileStorage::recalculateMediaUsage() {
+				return storeMediaUsage();
+			}
+
+			MediaFileStorage::MediaUsage ExternalMediaFileStorage::storeMediaUsage() const {
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("SELECT `type`, (`format` = :evicted) AS `is_evicted`, SUM(`size`) AS `bytes` FROM %1 GROUP BY `type`, `is_evicted`;").arg(DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("media"))));
+				query.bindValue(QStringLiteral(":evicted"), QVariant(static_cast<int>(FileFormat::EVICTED)));
+				if (!query.exec() || !query.isSelect()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not execute media usage query on table 'media'. Query error: " << query.lastError().text().toStdString();
+				}
+
+				// Keyed by type and whether the items are evicted.
+				QMap<QPair<int, int>, qint64> totals;
+				for (MediaFileType const fileType : { MediaFileType::TYPE_STANDARD, MediaFileType::TYPE_THUMBNAIL }) {
+					totals.insert(qMakePair(MediaFileTypeHelper::toInt(fileType), 0), 0);
+					totals.insert(qMakePair(MediaFileTypeHelper::toInt(fileType), 1), 0);
+				}
+				while (query.next()) {
+					totals.insert(qMakePair(query.value(QStringLiteral("type")).toInt(), query.value(QStringLiteral("is_evicted")).toBool() ? 1 : 0), query.value(QStringLiteral("bytes")).toLongLong());
+				}
+
+				if (!query.exec(QStringLiteral("DELETE FROM `media_usage`;"))) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not clear table 'media_usage'. Query error: " << query.lastError().text().toStdString();
+				}
+
+				// Every row exists from now on, so updateMediaUsage() only has to change them.
+				MediaUsage usage = { 0, 0, 0 };
+				query.prepare(QStringLiteral("INSERT INTO `media_usage` (`type`, `is_evicted`, `bytes`) VALUES (:type, :isEvicted, :bytes);"));
+				for (auto it = totals.constBegin(), end = totals.constEnd(); it != end; ++it) {
+					query.bindValue(QStringLiteral(":type"), QVariant(it.key().first));
+					query.bindValue(QStringLiteral(":isEvicted"), QVariant(it.key().second));
+					query.bindValue(QStringLiteral(":bytes"), QVariant(it.value()));
+					if (!query.exec()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not insert media usage into 'media_usage'. Query error: " << query.lastError().text().toStdString();
+					}
+					addToMediaUsage(usage, MediaFileTypeHelper::fromInt(it.key().first), it.key().second != 0, it.value());
+				}
+
+				return usage;
+			}
+
+			void ExternalMediaFileStorage::updateMediaUsage(MediaFileType const& fileType, MediaItemRecord const& record, bool isAdded) {
+				if (record.format == FileFormat::NOT_IN_DATABASE) {
+					return;
+				}
+
+				QSqlQuery query(m_database->getQueryObject());
+				query.prepare(QStringLiteral("UPDATE `media_usage` SET `bytes` = `bytes` + :bytes WHERE `type` = :type AND `is_evicted` = :isEvicted;"));
+				query.bindValue(QStringLiteral(":bytes"), QVariant(isAdded ? static_cast<qint64>(record.size) : -static_cast<qint64>(record.size)));
+				query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(fileType)));
+				query.bindValue(QStringLiteral(":isEvicted"), QVariant((record.format == FileFormat::EVICTED) ? 1 : 0));
+				if (!query.exec()) {
+					throw openmittsu::exceptions::InternalErrorException() << "Could not update media usage in table 'media_usage'. Query error: " << query.lastError().text().toStdString();
+				}
+			}
+
+			void ExternalMediaFileStorage::addToMediaUsage(MediaUsage& usage, MediaFileType const& fileType, bool isEvicted, qint64 bytes) {
+				if (isEvicted) {
+					usage.evictedBytes += bytes;
+				} else if (fileType == MediaFileType::TYPE_THUMBNAIL) {
+					usage.thumbnailBytes += bytes;
+				} else {
+					usage.standardBytes += bytes;
+				}
+			}
+
+			ExternalMediaFileStorage::ConversationMediaUsage ExternalMediaFileStorage::getConversationMediaUsage() const {
+				ConversationMediaUsage usage;
+				QString const mediaTable = DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("media"));
+				{
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `c`.`identity` AS `identity`, SUM(`m`.`size`) AS `bytes` FROM %1 AS `m` INNER JOIN %2 AS `c` ON `c`.`uid` = `m`.`uid` WHERE `m`.`type` = :type AND `m`.`format` != :evicted GROUP BY `c`.`identity`;").arg(mediaTable).arg(DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("contact_messages"))));
+					query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(MediaFileType::TYPE_STANDARD)));
+					query.bindValue(QStringLiteral(":evicted"), QVariant(static_cast<int>(FileFormat::EVICTED)));
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute contact media usage query. Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						usage.contactBytes.insert(openmittsu::protocol::ContactId(query.value(QStringLiteral("identity")).toString()), query.value(QStringLiteral("bytes")).toLongLong());
+					}
 				}
+				{
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(QStringLiteral("SELECT `g`.`group_id` AS `group_id`, `g`.`group_creator` AS `group_creator`, SUM(`m`.`size`) AS `bytes` FROM %1 AS `m` INNER JOIN %2 AS `g` ON `g`.`uid` = `m`.`uid` WHERE `m`.`type` = :type AND `m`.`format` != :evicted GROUP BY `g`.`group_id`, `g`.`group_creator`;").arg(mediaTable).arg(DatabaseUtilities::getTableInAllSchemas(m_database, QStringLiteral("group_messages"))));
+					query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(MediaFileType::TYPE_STANDARD)));
+					query.bindValue(QStringLiteral(":evicted"), QVariant(static_cast<int>(FileFormat::EVICTED)));
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute group media usage query. Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						openmittsu::protocol::GroupId const group(openmittsu::protocol::ContactId(query.value(QStringLiteral("group_creator")).toString()), query.value(QStringLiteral("group_id")).toString());
+						usage.groupBytes.insert(group, query.value(QStringLiteral("bytes")).toLongLong());
+					}
+				}
+
+				return usage;
 			}
 
-			int ExternalMediaFileStorage::cryptoGetNonceSize() const {
+			QList<MediaFileStorage::EvictionCandidate> ExternalMediaFileStorage::getEvictionCandidates(EvictionOrder order, qint64 sortedBefore, EvictionCandidate const& startAfter, int maxItemCount) const {
+				bool const isLargestFirst = (order == EvictionOrder::LARGEST_FIRST);
+				bool const hasStart = !startAfter.uuid.isEmpty();
+
+				// Each schema and message table is walked along its own index, from the position of the last visited item on. The results are merged below.
+				// The redundant bounds on `sort_by` and `size` let SQLite seek the index to that position instead of filtering every row before it.
+				// The CROSS JOIN keeps the message table in the outer loop, as only its index has the order of oldest first.
+				QStringList queries;
+				QStringList const schemas = m_database->getMessageStorageSchemas();
+				for (QString const& schema : schemas) {
+					QString const mediaTable = DatabaseUtilities::getQualifiedTableName(schema, QStringLiteral("media"));
+					QString const contactMessagesTable = DatabaseUtilities::getQualifiedTableName(schema, QStringLiteral("contact_messages"));
+					QString const groupMessagesTable = DatabaseUtilities::getQualifiedTableName(schema, QStringLiteral("group_messages"));
+					if (isLargestFirst) {
+						QString const startCondition = hasStart ? QStringLiteral(" AND `m`.`size` <= :startSize AND (`m`.`size` < :startSizeExclusive OR `m`.`uid` < :startUuid)") : QString();
+						QString const messageCondition = QStringLiteral("SELECT `msg`.`sort_by` FROM %1 AS `msg` WHERE `msg`.`uid` = `m`.`uid` AND `msg`.`sort_by` < %2");
+						queries.append(QStringLiteral("SELECT `m`.`uid` AS `uid`, `m`.`size` AS `size`, COALESCE((%1), (%2)) AS `sort_by` FROM %3 AS `m` WHERE `m`.`type` = :type AND `m`.`format` != :evicted%4 AND `sort_by` IS NOT NULL ORDER BY `m`.`size` DESC, `m`.`uid` DESC LIMIT :limit").arg(messageCondition.arg(contactMessagesTable).arg(QStringLiteral(":sortedBefore"))).arg(messageCondition.arg(groupMessagesTable).arg(QStringLiteral(":sortedBeforeGroup"))).arg(mediaTable).arg(startCondition));
+					} else {
+						QString const startCondition = hasStart ? QStringLiteral(" AND `msg`.`sort_by` >= :startSortBy AND (`msg`.`sort_by` > :startSortByExclusive OR `msg`.`uid` > :startUuid)") : QString();
+						for (QString const& messageTable : { contactMessagesTable, groupMessagesTable }) {
+							queries.append(QStringLiteral("SELECT `msg`.`uid` AS `uid`, `m`.`size` AS `size`, `msg`.`sort_by` AS `sort_by` FROM %1 AS `msg` CROSS JOIN %2 AS `m` ON `m`.`uid` = `msg`.`uid` AND `m`.`type` = :type WHERE `msg`.`sort_by` < :sortedBefore AND `m`.`format` != :evicted%3 ORDER BY `msg`.`sort_by` ASC, `msg`.`uid` ASC LIMIT :limit").arg(messageTable).arg(mediaTable).arg(startCondition));
+						}
+					}
+				}
+
+				QList<EvictionCandidate> result;
+				for (QString const& queryString : queries) {
+					QSqlQuery query(m_database->getQueryObject());
+					query.prepare(queryString);
+					query.bindValue(QStringLiteral(":type"), QVariant(MediaFileTypeHelper::toInt(MediaFileType::TYPE_STANDARD)));
+					query.bindValue(QStringLiteral(":evicted"), QVariant(static_cast<int>(FileFormat::EVICTED)));
+					query.bindValue(QStringLiteral(":sortedBefore"), QVariant(sortedBefore));
+					if (isLargestFirst) {
+						query.bindValue(QStringLiteral(":sortedBeforeGroup"), QVariant(sortedBefore));
+					}
+					query.bindValue(QStringLiteral(":limit"), QVariant(maxItemCount));
+					if (hasStart) {
+						query.bindValue(QStringLiteral(":startUuid"), QVariant(startAfter.uuid));
+						// Qt binds every name once, so the position is passed separately for both of its uses.
+						QString const startName = isLargestFirst ? QStringLiteral(":startSize") : QStringLiteral(":startSortBy");
+						QVariant const startValue(isLargestFirst ? startAfter.size : startAfter.sortBy);
+						query.bindValue(startName, startValue);
+						query.bindValue(startName + QStringLiteral("Exclusive"), startValue);
+					}
+					if (!query.exec() || !query.isSelect()) {
+						throw openmittsu::exceptions::InternalErrorException() << "Could not execute media eviction candidate query. Query error: " << query.lastError().text().toStdString();
+					}
+
+					while (query.next()) {
+						EvictionCandidate const candidate = { query.value(QStringLiteral("uid")).toString(), query.value(QStringLiteral("sort_by")).toLongLong(), query.value(QStringLiteral("size")).toLongLong() };
+						result.append(candidate);
+					}
+				}
+
+				std::sort(result.begin(), result.end(), [isLargestFirst](EvictionCandidate const& a, EvictionCandidate const& b) -> bool {
+					if (isLargestFirst) {
+						return (a.size > b.size) || ((a.size == b.size) && (a.uuid > b.uuid));
+					}
+					return (a.sortBy < b.sortBy) || ((a.sortBy == b.sortBy) && (a.uuid < b.uuid));
+				});
+				return result.mid(0, maxItemCount);
+			}
+
+			qint64 ExternalMediaFileStorage::evictMediaItem(QString const& uuid) {
+				MediaFileType const fileType = MediaFileType::TYPE_STANDARD;
+				MediaItemRecord const record = getMediaItemRecord(uuid, fileType);
+				if ((record.format == FileFormat::NOT_IN_DATABASE) || (record.format == FileFormat::EVICTED)) {
+					return 0;
+				}
+
+				// Size and checksum stay behind, so usage statistics can report what was evicted.
+				m_cache->remove(uuid, fileType);
+				MediaItemRecord evictedRecord = record;
+				evictedRecord.format = FileFormat::EVICTED;
+				evictedRecord.contentId.clear();
+				updateMediaItemRecord(uuid, fileType, record, evictedRecord);
+				bool const isFileRemoved = removeMediaItemFiles(uuid, fileType, record);
+				clearDamagedMediaItem(uuid, fileType);
+
+				// Content still referenced by other items stays on disk, evicting this item freed nothing.
+				return isFileRemoved ? record.size : 0;
+			}
+
+			int ExternalMediaFileStorage::cryptoGetNonceSize() {
 				return crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
 			}
 
-			int ExternalMediaFileStorage::cryptoGetHeaderSize() const {
+			int ExternalMediaFileStorage::cryptoGetHeaderSize() {
 				return crypto_aead_xchacha20poly1305_ietf_ABYTES;
 			}
 
-			int ExternalMediaFileStorage::cryptoGetKeySize() const {
+			int ExternalMediaFileStorage::cryptoGetKeySize() {
 				return crypto_aead_xchacha20poly1305_ietf_KEYBYTES;
 			}
 
-			QByteArray ExternalMediaFileStorage::decrypt(QByteArray const& encryptedData, QByteArray const& key, QByteArray const& nonce) const {
+			QByteArray ExternalMediaFileStorage::decrypt(QByteArray const& encryptedData, QByteArray const& key, QByteArray const& nonce) {
 				QByteArray decryptedData(encryptedData.size() - cryptoGetHeaderSize(), '\0');
 				unsigned long long decrypted_len;
 				if (crypto_aead_xchacha20poly1305_ietf_decrypt(reinterpret_cast<unsigned char*>(decryptedData.data()), &decrypted_len, NULL, reinterpret_cast<unsigned char const*>(encryptedData.data()), encryptedData.size(), NULL, 0, reinterpret_cast<unsigned char const*>(nonce.data()), reinterpret_cast<unsigned char const*>(key.data())) != 0) {
@@ -203,47 +1445,30 @@ namespace openmittsu {
 				return nonceBytes;
 			}
 
-			QByteArray ExternalMediaFileStorage::encrypt(QByteArray const& unencryptedData, QByteArray const& key, QByteArray const& nonce) const {
-				QByteArray encryptedData(unencryptedData.size() + cryptoGetHeaderSize(), '\0');
-				unsigned long long ciphertext_len;
-				if (crypto_aead_xchacha20poly1305_ietf_encrypt(reinterpret_cast<unsigned char*>(encryptedData.data()), &ciphertext_len, reinterpret_cast<unsigned char const*>(unencryptedData.data()), unencryptedData.size(), NULL, 0, NULL, reinterpret_cast<unsigned char const*>(nonce.data()), reinterpret_cast<unsigned char const*>(key.data())) != 0) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not encrypt blob, data corrupt!";
-				} else if (static_cast<int>(ciphertext_len) != (unencryptedData.size() + cryptoGetHeaderSize())) {
-					throw openmittsu::exceptions::InternalErrorException() << "Could not encrypt media item blob: Expected size was " << (unencryptedData.size() + cryptoGetHeaderSize()) << " Bytes, but we got " << ciphertext_len << " Bytes instead!";
-				}
-
-				return encryptedData;
-			}
-
 			void ExternalMediaFileStorage::insertMediaItemsFromBackup(QList<openmittsu::backup::ContactMediaItemBackupObject> const& items) {
-				if (!m_database->transactionStart()) {
-					LOGGER()->warn("ExternalMediaFileStorage: Could NOT start transaction!");
-				}
-
-				auto it = items.constBegin();
-				auto end = items.constEnd();
-				for (; it != end; ++it) {
-					insertMediaItem(it->getUuid(), it->getData(), MediaFileType::TYPE_STANDARD);
-				}
-
-				if (!m_database->transactionCommit()) {
-					LOGGER()->info("ExternalMediaFileStorage: Could NOT commit transaction!");
+				QList<std::pair<QString, QByteArray>> backupItems;
+				backupItems.reserve(items.size());
+				for (openmittsu::backup::ContactMediaItemBackupObject const& item : items) {
+					backupItems.append(std::make_pair(item.getUuid(), item.getData()));
 				}
+				queueBackupMediaItems(backupItems, MediaFileType::TYPE_STANDARD);
 			}
 
 			void ExternalMediaFileStorage::insertMediaItemsFromBackup(QList<openmittsu::backup::GroupMediaItemBackupObject> const& items) {
-				if (!m_database->transactionStart()) {
-					LOGGER()->warn("ExternalMediaFileStorage: Could NOT start transaction!");
-				}
-
-				auto it = items.constBegin();
-				auto end = items.constEnd();
-				for (; it != end; ++it) {
-					insertMediaItem(it->getUuid(), it->getData(), MediaFileType::TYPE_STANDARD);
+				QList<std::pair<QString, QByteArray>> backupItems;
+				backupItems.reserve(items.size());
+				for (openmittsu::backup::GroupMediaItemBackupObject const& item : items) {
+					backupItems.append(std::make_pair(item.getUuid(), item.getData()));
 				}
+				queueBackupMediaItems(backupItems, MediaFileType::TYPE_STANDARD);
+			}
 
-				if (!m_database->transactionCommit()) {
-					LOGGER()->info("ExternalMediaFileStorage: Could NOT commit transaction!");
+			void ExternalMediaFileStorage::queueBackupMediaItems(QList<std::pair<QString, QByteArray>> const& items, MediaFileType const& fileType) {
+				// Imports have no event loop to run the continuation. Storing the previous batch here keeps one batch encrypting while the next one is read,
+				// and bounds the memory held by queued items. Content that turns out to be stored already was encrypted for nothing.
+				storePendingWrites(true);
+				for (std::pair<QString, QByteArray> const& item : items) {
+					insertMediaItem(item.first, item.second, fileType);
 				}
 			}
 
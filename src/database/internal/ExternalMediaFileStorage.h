@@ -1,7 +1,23 @@
 #ifndef OPENMITTSU_DATABASE_INTERNAL_EXTERNALMEDIAFILESTORAGE_H_
 #define OPENMITTSU_DATABASE_INTERNAL_EXTERNALMEDIAFILESTORAGE_H_
 
+#include "src/database/DamagedMediaItem.h"
+#include "src/database/MediaItemHandle.h"
 #include "src/database/internal/MediaFileStorage.h"
+#include "src/database/internal/MediaIoPool.h"
+#include "src/database/internal/MediaItemCache.h"
+#include "src/database/internal/MediaWriteNotifier.h"
+#include "src/protocol/ContactId.h"
+#include "src/protocol/GroupId.h"
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
 #include <utility>
 
 namespace openmittsu {
@@ -9,16 +25,55 @@ namespace openmittsu {
 		namespace internal {
 			class InternalDatabaseInterface;
 
+			/**
+			 * Stores media items as encrypted files next to the database.
+			 *
+			 * New items are content addressed: the file of an item is named after a keyed hash of its plaintext, and the media_content table counts
+			 * the media entries referring to it. Storing the same data under several message UUIDs therefore writes a single file, which is removed
+			 * once its last reference is gone. Items stored by older versions keep a file per message UUID until they are migrated.
+			 *
+			 * Content files live in two levels of shard directories named after the first four hex digits of their content id, e.g. "3f/a2/encMedia_3_3fa2...",
+			 * which keeps every directory small. Content files written flat into the storage directory by older versions are moved in the background,
+			 * and are looked up at their old location until that finished. New files are written to a temporary file, synced and then renamed into place.
+			 */
 			class ExternalMediaFileStorage : public MediaFileStorage {
 			public:
+				typedef openmittsu::database::DamagedMediaItem DamagedMediaItem;
+
+				/** Plaintext bytes of full-size media still stored per conversation. */
+				struct ConversationMediaUsage {
+					QHash<openmittsu::protocol::ContactId, qint64> contactBytes;
+					QHash<openmittsu::protocol::GroupId, qint64> groupBytes;
+				};
+
+				struct PendingVerification {
+					QString uuid;
+					MediaFileType fileType;
+					std::shared_future<MediaFileItem> result;
+				};
+
 				explicit ExternalMediaFileStorage(QDir const& storagePath, InternalDatabaseInterface* database);
 				virtual ~ExternalMediaFileStorage();
 
 				virtual bool hasMediaItem(QString const& uuid, MediaFileType const& fileType) const override;
 				virtual int getMediaItemCount() const override;
 
-				virtual MediaFileItem getMediaItem(QString const& uuid, MediaFileType const& fileType) const override;
+				/** Looks up the item on the calling thread, but reads and decrypts its file on the media I/O pool. */
+				std::shared_future<MediaFileItem> getMediaItemAsync(QString const& uuid, MediaFileType const& fileType) const;
+
+				/**
+				 * Looks up the item on the calling thread, but neither reads nor decrypts anything until the handle is first accessed.
+				 * The handle then checks the cache and reads the file on the media I/O pool. It stays valid after this storage was destroyed.
+				 */
+				virtual MediaItemHandle getMediaItemHandle(QString const& uuid, MediaFileType const& fileType) const override;
+
+				/**
+				 * Returns right away, hashing, encryption and syncing of the file run on the media I/O pool. The item is stored in the database by a
+				 * continuation on the thread owning this storage once the pool finished, until then it is served from data.
+				 */
 				virtual void insertMediaItem(QString const& uuid, QByteArray const& data, MediaFileType const& fileType) override;
+				virtual void insertMediaItem(QString const& uuid, std::unique_ptr<QIODevice>&& source, MediaFileType const& fileType) override;
+				virtual std::unique_ptr<ChunkedMediaFileReader> openMediaItem(QString const& uuid, MediaFileType const& fileType) override;
 				virtual void removeMediaItem(QString const& uuid, MediaFileType const& fileType) override;
 				virtual void removeAllMediaItems(QString const& uuid) override;
 
@@ -26,20 +81,177 @@ namespace openmittsu {
 				virtual void insertMediaItemsFromBackup(QList<openmittsu::backup::GroupMediaItemBackupObject> const& items) override;
 
 				virtual void upgradeMediaDatabase(int fromVersion) override;
+				virtual int removeUnreferencedFiles(QString const& startAfterFileName, int maxFileCount, QString& lastVisitedFileName) override;
+				virtual int migrateLegacyFiles(QString const& startAfterUuid, int maxItemCount, QString& lastVisitedUuid) override;
+				virtual int moveToShardedLayout(QString const& startAfterContentId, int maxFileCount, QString& lastVisitedContentId) override;
+				virtual int getPendingWriteCount() const override;
+				virtual void completePendingWrites() override;
+
+				/** Reads the running totals, which are kept up to date whenever an item is stored, evicted or removed. */
+				virtual MediaUsage getMediaUsage() const override;
+
+				/** Computes the totals from all media entries again and stores them. Only needed to repair them, as this scans every entry. */
+				MediaUsage recalculateMediaUsage();
+				virtual QList<EvictionCandidate> getEvictionCandidates(EvictionOrder order, qint64 sortedBefore, EvictionCandidate const& startAfter, int maxItemCount) const override;
+				virtual qint64 evictMediaItem(QString const& uuid) override;
+				ConversationMediaUsage getConversationMediaUsage() const;
+
+				/**
+				 * Looks up the items of at most maxItemCount uuids, in uuid order after startAfterUuid, and checks size, authentication tags and checksum of their files on pool.
+				 * The results only carry the status, not the data. The last visited uuid is stored in lastVisitedUuid, which is empty once all items were visited.
+				 */
+				QList<PendingVerification> verifyMediaItems(QString const& startAfterUuid, int maxItemCount, QString& lastVisitedUuid, MediaIoPool& pool) const;
+
+				/** Like removeUnreferencedFiles(), but only returns the unreferenced files, relative to the storage directory. */
+				QStringList findUnreferencedFiles(QString const& startAfterFileName, int maxFileCount, QString& lastVisitedFileName) const;
+
+				/** Removes a file returned by findUnreferencedFiles(), unless it became referenced in the meantime. */
+				bool removeUnreferencedFile(QString const& relativeFileName);
+
+				/** Damaged items are recorded until they are removed or stored again. */
+				void markDamagedMediaItem(DamagedMediaItem const& item);
+				QList<DamagedMediaItem> getDamagedMediaItems() const;
+
+				/** The shard directory of a content file, relative to the storage directory. */
+				static QString getShardDirectoryName(QString const& contentId);
+
+				/** Decrypted items loaded through handles are kept here. */
+				MediaItemCache& getCache();
+				MediaItemCache const& getCache() const;
 			private:
-				QString buildFilename(QString const& uuid, MediaFileType const& fileType) const;
+				/** Media file formats, the format is part of the file name. */
+				enum class FileFormat : int {
+					NOT_IN_DATABASE = 0,
+					LEGACY_SINGLE_BLOB = 1,
+					CHUNKED = 2,
+					CHUNKED_SHARED = 3,
+					/** The entry is kept without data, see evictMediaItem(). */
+					EVICTED = 4
+				};
+
+				/** Whether content files written flat into the storage directory by older versions may still exist. */
+				enum class ContentLayout {
+					UNKNOWN,
+					FLAT_FILES_REMAINING,
+					SHARDED
+				};
+
+				struct MediaItemRecord {
+					FileFormat format;
+					int size;
+					uint32_t checksum;
+					QByteArray nonce;
+					QByteArray key;
+					QString contentId;
+				};
+
+				QString buildFilename(QString const& uuid, MediaFileType const& fileType, FileFormat const& format) const;
+				QString buildContentFilename(QString const& contentId) const;
+				QString buildTemporaryFilename() const;
+				QString getShardedContentFilePath(QString const& contentId) const;
+				QString getContentFilePath(QString const& contentId) const;
+				bool hasFlatContentFiles() const;
+				QStringList listShardedFiles(QString const& startAfterFileName, int maxFileCount) const;
+				bool isReferencedFile(QString const& relativeFileName) const;
+				QString getFilePath(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& record) const;
+				MediaItemRecord getMediaItemRecord(QString const& uuid, MediaFileType const& fileType) const;
+
+				/** Reads and decrypts a media file. Does not use the database, so it may run on any thread. */
+				static MediaFileItem readMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record);
+				static MediaFileItem readLegacyMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record);
+				static MediaFileItem readChunkedMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record);
+				static MediaFileItem::ItemStatus checkChunkedMediaFile(QString const& uuid, QString const& fileName, MediaItemRecord const& record, QByteArray* decryptedData);
+				static MediaFileItem::ItemStatus verifyMediaFile(QString const& uuid, MediaFileType const& fileType, QString const& fileName, MediaItemRecord const& record);
+				void clearDamagedMediaItem(QString const& uuid, MediaFileType const& fileType);
+				void insertMediaItemRecord(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& record);
+				void updateMediaItemRecord(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& previousRecord, MediaItemRecord const& record);
+				/** Returns true if the files of the item were removed, false if they are still used by other items. */
+				bool removeMediaItemFiles(QString const& uuid, MediaFileType const& fileType, MediaItemRecord const& record);
+				/** Queues the re-encryption of the item on the media I/O pool. Returns false if the item needs no migration or one is already queued. */
+				bool migrateLegacyFile(QString const& uuid, MediaFileType const& fileType);
+
+				/** Content encrypted into a temporary file, which is not yet known to the database. */
+				struct PreparedContent {
+					QString temporaryFileName;
+					MediaItemRecord record;
+				};
+
+				/** An insert or migration whose file is written on the media I/O pool, and which is stored by storePendingWrites() once that finished. */
+				struct PendingWrite {
+					QString uuid;
+					MediaFileType fileType;
+					/** Served to readers until the item is stored. Empty for migrations and inserts from a device. */
+					QByteArray data;
+					bool hasData;
+					bool isMigration;
+					/** The entry a migration replaces, the migration is dropped if the entry changed in the meantime. */
+					MediaItemRecord previousRecord;
+					std::shared_ptr<PreparedContent> content;
+					std::shared_future<void> result;
+					/** Set if the item was removed or stored again before this write was stored. */
+					bool isCancelled;
+				};
+
+				/** Runs job on the media I/O pool. The continuation storing the write is posted to the thread owning this storage once the job finished. */
+				void queueWrite(PendingWrite& write, std::function<void()> const& job);
+				void cancelPendingWrites(QString const& uuid, MediaFileType const& fileType);
+				PendingWrite const* findPendingInsert(QString const& uuid, MediaFileType const& fileType) const;
+				bool hasPendingMigration(QString const& uuid, MediaFileType const& fileType) const;
+
+				/**
+				 * Stores all writes whose job finished in one transaction, which is rolled back if storing one of them fails.
+				 * With waitForPool, all pending writes are waited for first. Rethrows the first error of a job or of the transaction.
+				 */
+				void storePendingWrites(bool waitForPool);
+				void storePendingWrite(PendingWrite const& write, QStringList& replacedFiles);
+				void onPendingWritesFinished();
+
+				/**
+				 * Returns a reference to the shared file holding the content written by prepareContent(), the reference count is already incremented.
+				 * The temporary file is moved into place, or removed if the content is already stored. Only touches the metadata in the database.
+				 */
+				MediaItemRecord acquirePreparedContent(PreparedContent const& content);
+
+				/** A temporary file name, key and nonce for new content. */
+				PreparedContent createPreparedContent() const;
+
+				/**
+				 * Hashes data and encrypts it into the temporary file of content, using the key and nonce already set in its record.
+				 * Does not use the database, so it may run on any thread.
+				 */
+				static void prepareContent(QByteArray const& data, QByteArray const& hashKey, PreparedContent& content);
+				static void prepareContent(QIODevice& source, QByteArray const& hashKey, PreparedContent& content);
+
+				/** Queues the encryption of the items on the media I/O pool, after the items queued by the previous call were stored. */
+				void queueBackupMediaItems(QList<std::pair<QString, QByteArray>> const& items, MediaFileType const& fileType);
+				/** Returns true if this was the last reference and the content file was removed. */
+				bool releaseContent(QString const& contentId);
+				bool addContentReference(QString const& contentId, MediaItemRecord& record);
+				bool getContentRecord(QString const& contentId, MediaItemRecord& record) const;
+				void insertContentRecord(MediaItemRecord const& record);
+				void moveContentFileIntoPlace(QString const& temporaryFileName, QString const& contentId);
+				QByteArray getContentHashKey();
+
+				MediaUsage storeMediaUsage() const;
+				void updateMediaUsage(MediaFileType const& fileType, MediaItemRecord const& record, bool isAdded);
+				static void addToMediaUsage(MediaUsage& usage, MediaFileType const& fileType, bool isEvicted, qint64 bytes);
 
-				int cryptoGetNonceSize() const;
-				int cryptoGetHeaderSize() const;
-				int cryptoGetKeySize() const;
+				static int cryptoGetNonceSize();
+				static int cryptoGetHeaderSize();
+				static int cryptoGetKeySize();
 
-				QByteArray decrypt(QByteArray const& encryptedData, QByteArray const& key, QByteArray const& nonce) const;
+				static QByteArray decrypt(QByteArray const& encryptedData, QByteArray const& key, QByteArray const& nonce);
 				QByteArray generateKey() const;
 				QByteArray generateNonce() const;
-				QByteArray encrypt(QByteArray const& unencryptedData, QByteArray const& key, QByteArray const& nonce) const;
 
 				QDir const m_storagePath;
 				InternalDatabaseInterface* const m_database;
+				QByteArray m_contentHashKey;
+				mutable ContentLayout m_contentLayout;
+				std::shared_ptr<MediaItemCache> const m_cache;
+				std::shared_ptr<MediaIoPool> const m_ioPool;
+				QList<PendingWrite> m_pendingWrites;
+				std::unique_ptr<MediaWriteNotifier> const m_writeNotifier;
 			};
 
 		}
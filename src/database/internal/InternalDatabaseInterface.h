@@ -2,14 +2,18 @@
 #define OPENMITTSU_DATABASE_INTERNAL_INTERNALDATABASEINTERFACE_H_
 
 #include <QString>
+#include <QStringList>
 #include <QSqlQuery>
 #include <QSqlError>
 
+#include <future>
+
 #include "src/protocol/ContactId.h"
 #include "src/protocol/GroupId.h"
 #include "src/protocol/MessageId.h"
 
 #include "src/database/MediaFileType.h"
+#include "src/database/MediaItemHandle.h"
 
 namespace openmittsu {
 	namespace database {
@@ -28,6 +32,10 @@ namespace openmittsu {
 				virtual QSqlQuery getQueryObject() const = 0;
 				virtual bool transactionStart() = 0;
 				virtual bool transactionCommit() = 0;
+				virtual bool transactionRollback() = 0;
+
+				/** The schemas holding message and media tables, the hot tier ("main") first, followed by the archive tier if attached. */
+				virtual QStringList getMessageStorageSchemas() const = 0;
 
 				// Announces
 				virtual void announceMessageChanged(QString const& uuid) = 0;
@@ -44,10 +52,16 @@ namespace openmittsu {
 				virtual openmittsu::protocol::MessageId getNextMessageId(openmittsu::protocol::GroupId const& group) = 0;
 
 				// Media Items
-				virtual MediaFileItem getMediaItem(QString const& uuid, MediaFileType const& fileType) const = 0;
+				virtual std::shared_future<MediaFileItem> getMediaItemAsync(QString const& uuid, MediaFileType const& fileType) const = 0;
+				virtual MediaItemHandle getMediaItemHandle(QString const& uuid, MediaFileType const& fileType) const = 0;
 				virtual void removeMediaItem(QString const& uuid, MediaFileType const& fileType) = 0;
 				virtual void removeAllMediaItems(QString const& uuid) = 0;
 				virtual void insertMediaItem(QString const& uuid, QByteArray const& data, MediaFileType const& fileType) = 0;
+
+				// Internal Options
+				virtual bool hasInternalOption(QString const& optionName) = 0;
+				virtual QString getInternalOptionValue(QString const& optionName) = 0;
+				virtual void setInternalOptionValue(QString const& optionName, QString const& optionValue) = 0;
 			};
 
 		}
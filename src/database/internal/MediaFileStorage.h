@@ -4,11 +4,17 @@
 #include <QByteArray>
 #include <QDir>
 #include <QFile>
+#include <QIODevice>
 #include <QList>
 #include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <memory>
 
 #include "src/database/MediaFileItem.h"
 #include "src/database/MediaFileType.h"
+#include "src/database/MediaItemHandle.h"
 
 namespace openmittsu {
 	namespace backup {
@@ -18,16 +24,46 @@ namespace openmittsu {
 
 	namespace database {
 		namespace internal {
+			class ChunkedMediaFileReader;
 
 			class MediaFileStorage {
 			public:
+				/** Plaintext bytes of the stored items. Items sharing their content are each counted with their full size. */
+				struct MediaUsage {
+					qint64 standardBytes;
+					qint64 thumbnailBytes;
+					qint64 evictedBytes;
+				};
+
+				enum class EvictionOrder {
+					OLDEST_FIRST,
+					LARGEST_FIRST
+				};
+
+				/** A full-size media item that may be evicted, with the sort key of its message. An empty uuid stands for the position before the first item. */
+				struct EvictionCandidate {
+					QString uuid;
+					qint64 sortBy;
+					qint64 size;
+				};
+
 				virtual ~MediaFileStorage() {}
 
 				virtual bool hasMediaItem(QString const& uuid, MediaFileType const& fileType) const = 0;
 				virtual int getMediaItemCount() const = 0;
 
-				virtual MediaFileItem getMediaItem(QString const& uuid, MediaFileType const& fileType) const = 0;
+				/** Only looks the item up, its file is read and decrypted off the calling thread once the handle is accessed. */
+				virtual MediaItemHandle getMediaItemHandle(QString const& uuid, MediaFileType const& fileType) const = 0;
 				virtual void insertMediaItem(QString const& uuid, QByteArray const& data, MediaFileType const& fileType) = 0;
+
+				/**
+				 * Takes ownership of source and encrypts its remaining data chunk by chunk, so memory use does not depend on the size of the item.
+				 * Source is read on another thread, which files and buffers allow. The item is not available before all of it was written.
+				 */
+				virtual void insertMediaItem(QString const& uuid, std::unique_ptr<QIODevice>&& source, MediaFileType const& fileType) = 0;
+
+				/** Opens the item for random access reads. Returns nullptr if the item is not available or still stored in a per-item format, see migrateLegacyFiles(). */
+				virtual std::unique_ptr<ChunkedMediaFileReader> openMediaItem(QString const& uuid, MediaFileType const& fileType) = 0;
 				virtual void removeMediaItem(QString const& uuid, MediaFileType const& fileType) = 0;
 				virtual void removeAllMediaItems(QString const& uuid) = 0;
 
@@ -35,6 +71,46 @@ namespace openmittsu {
 				virtual void insertMediaItemsFromBackup(QList<openmittsu::backup::GroupMediaItemBackupObject> const& items) = 0;
 
 				virtual void upgradeMediaDatabase(int fromVersion) = 0;
+
+				/**
+				 * Visits at most maxFileCount media files in the order of their path relative to the storage directory, starting after startAfterFileName, and deletes those without a matching media entry.
+				 * Returns the number of deleted files and stores the name of the last visited file in lastVisitedFileName, which is empty once all files were visited.
+				 */
+				virtual int removeUnreferencedFiles(QString const& startAfterFileName, int maxFileCount, QString& lastVisitedFileName) = 0;
+
+				/**
+				 * Queues the re-encryption of the items of at most maxItemCount uuids, in uuid order after startAfterUuid, that are still stored in a per-item file format.
+				 * Returns the number of queued items and stores the last visited uuid in lastVisitedUuid, which is empty once all items were visited.
+				 */
+				virtual int migrateLegacyFiles(QString const& startAfterUuid, int maxItemCount, QString& lastVisitedUuid) = 0;
+
+				/**
+				 * Moves at most maxFileCount content files, in content id order after startAfterContentId, from the flat storage directory into their shard directories.
+				 * Returns the number of moved files and stores the last visited content id in lastVisitedContentId, which is empty once all files were visited.
+				 */
+				virtual int moveToShardedLayout(QString const& startAfterContentId, int maxFileCount, QString& lastVisitedContentId) = 0;
+
+				/** Inserts and migrations whose files are still written on the media I/O pool, or which wait to be stored in the database. */
+				virtual int getPendingWriteCount() const = 0;
+
+				/** Waits for all pending writes and stores them, so this blocks the calling thread. Only for shutdown, backups and explicit user requests. */
+				virtual void completePendingWrites() = 0;
+
+				/** Cheap enough to be called after every change, as stores keep running totals. */
+				virtual MediaUsage getMediaUsage() const = 0;
+
+				/**
+				 * Returns at most maxItemCount full-size media items attached to messages sorted before sortedBefore (milliseconds since the epoch), in the given order and after startAfter.
+				 * Oldest first orders by message sort key and uuid, largest first by size and uuid, both descending. Both orders are served by an index.
+				 * Thumbnails, group images and evicted items are never returned.
+				 */
+				virtual QList<EvictionCandidate> getEvictionCandidates(EvictionOrder order, qint64 sortedBefore, EvictionCandidate const& startAfter, int maxItemCount) const = 0;
+
+				/**
+				 * Drops the full-size data of a media item, while its entry stays behind and reports MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED until the item is stored again.
+				 * Returns the number of bytes freed on disk, which is zero if there was nothing to evict or the content is still used by other items.
+				 */
+				virtual qint64 evictMediaItem(QString const& uuid) = 0;
 			};
 
 		}
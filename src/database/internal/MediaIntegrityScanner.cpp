@@ -0,0 +1,163 @@
+#include "src/database/internal/MediaIntegrityScanner.h"
+
+#include "src/exceptions/InternalErrorException.h"
+#include "src/utility/Logging.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <limits>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			namespace {
+				int const verifiedItemsPerBatch = 32;
+				int const checkedFilesPerBatch = 128;
+				/** More items in flight would only queue up on the pool, while their results are held in memory. */
+				int const maxPendingVerifications = 4 * verifiedItemsPerBatch;
+			}
+
+			MediaIntegrityScanner::MediaIntegrityScanner(ExternalMediaFileStorage* mediaFileStorage, bool repair) : m_mediaFileStorage(mediaFileStorage), m_repair(repair), m_pool(std::max(1, QThread::idealThreadCount() - 1), QThread::IdlePriority), m_progressCallback(), m_isCancelled(false), m_itemCursor(), m_fileCursor(), m_isItemScanComplete(false), m_isFileScanComplete(false), m_report({ 0, 0, 0, 0, 0, 0, false }), m_pendingVerifications() {
+				//
+			}
+
+			MediaIntegrityScanner::~MediaIntegrityScanner() {
+				// Intentionally left empty.
+			}
+
+			void MediaIntegrityScanner::setProgressCallback(ProgressCallback const& callback) {
+				m_progressCallback = callback;
+			}
+
+			void MediaIntegrityScanner::cancel() {
+				m_isCancelled.store(true);
+			}
+
+			bool MediaIntegrityScanner::isCancelled() const {
+				return m_isCancelled.load();
+			}
+
+			MediaIntegrityScanner::Report MediaIntegrityScanner::getReport() const {
+				return m_report;
+			}
+
+			bool MediaIntegrityScanner::isRepairing() const {
+				return m_repair;
+			}
+
+			bool MediaIntegrityScanner::runSlice(qint64 timeBudgetInMs) {
+				QElapsedTimer timer;
+				timer.start();
+
+				while (!m_report.isComplete) {
+					bool const madeProgress = runBatch();
+					if (m_progressCallback) {
+						m_progressCallback(m_report);
+					}
+
+					if (!madeProgress || m_isCancelled.load() || (timer.elapsed() >= timeBudgetInMs)) {
+						break;
+					}
+				}
+
+				return m_report.isComplete;
+			}
+
+			MediaIntegrityScanner::Report MediaIntegrityScanner::runToCompletion() {
+				while (!runSlice(std::numeric_limits<qint64>::max())) {
+					if (m_isCancelled.load()) {
+						break;
+					}
+
+					// Only checks on the pool are left, so waiting for one of them is all there is to do.
+					if (!m_pendingVerifications.isEmpty()) {
+						m_pendingVerifications.first().result.wait();
+					}
+				}
+				return m_report;
+			}
+
+			bool MediaIntegrityScanner::runBatch() {
+				bool madeProgress = false;
+
+				// Results are only collected once they are ready, a slice never waits for the pool.
+				for (auto it = m_pendingVerifications.begin(); it != m_pendingVerifications.end();) {
+					if (it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+						++it;
+						continue;
+					}
+					collectVerification(*it);
+					it = m_pendingVerifications.erase(it);
+					madeProgress = true;
+				}
+
+				// The files of the next items are checked on the pool while this thread walks the storage directory.
+				int const freeSlots = maxPendingVerifications - m_pendingVerifications.size();
+				if (!m_isItemScanComplete && (freeSlots > 0)) {
+					QString nextItemCursor;
+					m_pendingVerifications.append(m_mediaFileStorage->verifyMediaItems(m_itemCursor, std::min(verifiedItemsPerBatch, freeSlots), nextItemCursor, m_pool));
+					m_itemCursor = nextItemCursor;
+					m_isItemScanComplete = nextItemCursor.isEmpty();
+					madeProgress = true;
+				}
+
+				if (!m_isFileScanComplete) {
+					QString nextFileCursor;
+					QStringList const unreferencedFiles = m_mediaFileStorage->findUnreferencedFiles(m_fileCursor, checkedFilesPerBatch, nextFileCursor);
+					m_fileCursor = nextFileCursor;
+					m_isFileScanComplete = nextFileCursor.isEmpty();
+					madeProgress = true;
+
+					for (QString const& relativeFileName : unreferencedFiles) {
+						LOGGER()->warn("Media integrity scan: File {} is not referenced by any media item.", relativeFileName.toStdString());
+						++m_report.orphanedFiles;
+						if (m_repair && m_mediaFileStorage->removeUnreferencedFile(relativeFileName)) {
+							++m_report.removedFiles;
+						}
+					}
+				}
+
+				if (m_isItemScanComplete && m_isFileScanComplete && m_pendingVerifications.isEmpty() && !m_report.isComplete) {
+					if (m_repair) {
+						m_mediaFileStorage->recalculateMediaUsage();
+					}
+					m_report.isComplete = true;
+					LOGGER()->info("Media integrity scan completed: {} items checked, {} missing, {} corrupted, {} unreferenced files, {} items marked as damaged, {} files removed.", m_report.checkedItems, m_report.missingItems, m_report.corruptedItems, m_report.orphanedFiles, m_report.markedItems, m_report.removedFiles);
+				}
+
+				return madeProgress;
+			}
+
+			void MediaIntegrityScanner::collectVerification(ExternalMediaFileStorage::PendingVerification const& pending) {
+				MediaFileItem::ItemStatus status = MediaFileItem::ItemStatus::UNAVAILABLE_CRYPTO_ERROR;
+				try {
+					status = pending.result.get().getStatus();
+				} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+					LOGGER()->warn("Media integrity scan: Checking media item {} failed: {}", pending.uuid.toStdString(), iee.what());
+				} catch (std::exception& e) {
+					LOGGER()->warn("Media integrity scan: Checking media item {} failed: {}", pending.uuid.toStdString(), e.what());
+				}
+
+				++m_report.checkedItems;
+				if ((status == MediaFileItem::ItemStatus::AVAILABLE) || (status == MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED)) {
+					return;
+				} else if (status == MediaFileItem::ItemStatus::UNAVAILABLE_EXTERNAL_FILE_DELETED) {
+					++m_report.missingItems;
+				} else {
+					++m_report.corruptedItems;
+				}
+
+				if (m_repair) {
+					m_mediaFileStorage->markDamagedMediaItem({ pending.uuid, pending.fileType, status });
+					++m_report.markedItems;
+				}
+			}
+
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_MEDIAINTEGRITYSCANNER_H_
+#define OPENMITTSU_DATABASE_INTERNAL_MEDIAINTEGRITYSCANNER_H_
+
+#include "src/database/MediaIntegrityReport.h"
+#include "src/database/internal/ExternalMediaFileStorage.h"
+#include "src/database/internal/MediaIoPool.h"
+
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+#include <atomic>
+#include <functional>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+			/**
+			 * Checks all media items for missing or damaged files, and the storage directory for files no item refers to.
+			 *
+			 * Files are read and checked (size, authentication tags, checksum) on a pool of idle priority threads, while the database thread looks for
+			 * unreferenced files in the storage directory. runSlice() only processes batches until its time budget is used up, so a scan can be
+			 * spread over many short slices. Slices never wait for the pool, checks still running are collected by a later slice. In repair mode, broken items are marked as damaged in the media_damage table, unreferenced files are removed and the media usage totals are computed again.
+			 * Broken items themselves are never deleted, as their messages should keep showing that they had media attached.
+			 */
+			class MediaIntegrityScanner {
+			public:
+				typedef openmittsu::database::MediaIntegrityReport Report;
+
+				typedef std::function<void(Report const&)> ProgressCallback;
+
+				MediaIntegrityScanner(ExternalMediaFileStorage* mediaFileStorage, bool repair);
+				virtual ~MediaIntegrityScanner();
+
+				/** Called after every batch with the report so far. Must be set before the first slice. */
+				void setProgressCallback(ProgressCallback const& callback);
+
+				/**
+				 * Processes batches until the time budget is used up, the scan is complete, cancel() is called or only checks on the pool are left.
+				 * At least one batch is processed per call. Returns true if the scan is complete.
+				 */
+				bool runSlice(qint64 timeBudgetInMs);
+
+				/** Runs the scan to completion, unless it is cancelled. */
+				Report runToCompletion();
+
+				/** Stops the currently executing slice after its current batch. */
+				void cancel();
+				bool isCancelled() const;
+
+				Report getReport() const;
+				bool isRepairing() const;
+			private:
+				ExternalMediaFileStorage* const m_mediaFileStorage;
+				bool const m_repair;
+				MediaIoPool m_pool;
+				ProgressCallback m_progressCallback;
+				std::atomic<bool> m_isCancelled;
+
+				QString m_itemCursor;
+				QString m_fileCursor;
+				bool m_isItemScanComplete;
+				bool m_isFileScanComplete;
+				Report m_report;
+				QList<ExternalMediaFileStorage::PendingVerification> m_pendingVerifications;
+
+				/** Returns false if nothing could be done without waiting for the pool. */
+				bool runBatch();
+				void collectVerification(ExternalMediaFileStorage::PendingVerification const& pending);
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_MEDIAINTEGRITYSCANNER_H_
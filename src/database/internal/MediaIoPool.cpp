@@ -0,0 +1,109 @@
+#include "src/database/internal/MediaIoPool.h"
+
+#include <QRunnable>
+
+#include <algorithm>
+#include <exception>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			namespace {
+				/** Runs a job on a pool thread and hands its result, or the exception escaping it, to a future. */
+				template<typename T>
+				class MediaIoRunnable : public QRunnable {
+				public:
+					MediaIoRunnable(std::function<T()> const& job, std::function<void()> const& onFinished, QThread::Priority priority) : QRunnable(), m_job(job), m_onFinished(onFinished), m_priority(priority), m_promise() {
+						setAutoDelete(true);
+					}
+
+					virtual ~MediaIoRunnable() {
+						//
+					}
+
+					std::shared_future<T> getFuture() {
+						return m_promise.get_future().share();
+					}
+
+					virtual void run() override {
+						if (m_priority != QThread::InheritPriority) {
+							QThread::currentThread()->setPriority(m_priority);
+						}
+
+						try {
+							fulfill(m_promise, m_job);
+						} catch (...) {
+							m_promise.set_exception(std::current_exception());
+						}
+
+						if (m_onFinished) {
+							m_onFinished();
+						}
+					}
+				private:
+					std::function<T()> const m_job;
+					std::function<void()> const m_onFinished;
+					QThread::Priority const m_priority;
+					std::promise<T> m_promise;
+
+					static void fulfill(std::promise<T>& promise, std::function<T()> const& job) {
+						promise.set_value(job());
+					}
+				};
+
+				template<>
+				void MediaIoRunnable<void>::fulfill(std::promise<void>& promise, std::function<void()> const& job) {
+					job();
+					promise.set_value();
+				}
+			}
+
+			MediaIoPool::MediaIoPool() : m_threadPool(), m_priority(QThread::InheritPriority) {
+				// Media work is mostly bound by disk and memory bandwidth, more threads would only compete for both.
+				m_threadPool.setMaxThreadCount(std::max(1, std::min(QThread::idealThreadCount(), 4)));
+			}
+
+			MediaIoPool::MediaIoPool(int maxThreadCount, QThread::Priority priority) : m_threadPool(), m_priority(priority) {
+				m_threadPool.setMaxThreadCount(std::max(1, maxThreadCount));
+			}
+
+			MediaIoPool::~MediaIoPool() {
+				waitForDone();
+			}
+
+			std::shared_future<MediaFileItem> MediaIoPool::submit(std::function<MediaFileItem()> const& job) {
+				MediaIoRunnable<MediaFileItem>* const runnable = new MediaIoRunnable<MediaFileItem>(job, std::function<void()>(), m_priority);
+				std::shared_future<MediaFileItem> future = runnable->getFuture();
+				m_threadPool.start(runnable);
+				return future;
+			}
+
+			std::shared_future<void> MediaIoPool::submitTask(std::function<void()> const& job) {
+				return submitTask(job, std::function<void()>());
+			}
+
+			std::shared_future<void> MediaIoPool::submitTask(std::function<void()> const& job, std::function<void()> const& onFinished) {
+				MediaIoRunnable<void>* const runnable = new MediaIoRunnable<void>(job, onFinished, m_priority);
+				std::shared_future<void> future = runnable->getFuture();
+				m_threadPool.start(runnable);
+				return future;
+			}
+
+			void MediaIoPool::waitForDone() {
+				m_threadPool.waitForDone();
+			}
+
+			int MediaIoPool::getMaxThreadCount() const {
+				return m_threadPool.maxThreadCount();
+			}
+
+			std::shared_future<MediaFileItem> MediaIoPool::makeReadyFuture(MediaFileItem const& item) {
+				std::promise<MediaFileItem> promise;
+				promise.set_value(item);
+				return promise.get_future().share();
+			}
+
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_MEDIAIOPOOL_H_
+#define OPENMITTSU_DATABASE_INTERNAL_MEDIAIOPOOL_H_
+
+#include "src/database/MediaFileItem.h"
+
+#include <QThread>
+#include <QThreadPool>
+
+#include <functional>
+#include <future>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * A small pool of threads reading and decrypting media files, so large items do not hold up the database thread.
+			 * Jobs must not touch the database connection, everything they need is copied into them when they are submitted.
+			 */
+			class MediaIoPool {
+			public:
+				MediaIoPool();
+
+				/** A pool with maxThreadCount threads, which run their jobs with the given priority. Used for background work like integrity scans. */
+				MediaIoPool(int maxThreadCount, QThread::Priority priority);
+				virtual ~MediaIoPool();
+
+				/** Runs job on a pool thread. The returned future becomes ready once it finished, and rethrows exceptions escaping the job. */
+				std::shared_future<MediaFileItem> submit(std::function<MediaFileItem()> const& job);
+
+				/** Runs job on a pool thread, for work without a result like preparing files. The future rethrows exceptions escaping the job. */
+				std::shared_future<void> submitTask(std::function<void()> const& job);
+
+				/** As above, but runs onFinished on the pool thread once the future is ready, also if the job failed. Used to hand the result back to another thread. */
+				std::shared_future<void> submitTask(std::function<void()> const& job, std::function<void()> const& onFinished);
+				void waitForDone();
+				int getMaxThreadCount() const;
+
+				static std::shared_future<MediaFileItem> makeReadyFuture(MediaFileItem const& item);
+			private:
+				QThreadPool m_threadPool;
+				QThread::Priority const m_priority;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_MEDIAIOPOOL_H_
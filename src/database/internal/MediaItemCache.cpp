@@ -0,0 +1,136 @@
+#include "src/database/internal/MediaItemCache.h"
+
+#include <QMutexLocker>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			MediaItemCache::MediaItemCache() : m_mutex(), m_thumbnails(), m_standard(), m_hits(0), m_misses(0), m_evictions(0), m_generation(0) {
+				m_thumbnails.budget = getDefaultBudget(MediaFileType::TYPE_THUMBNAIL);
+				m_thumbnails.size = 0;
+				m_standard.budget = getDefaultBudget(MediaFileType::TYPE_STANDARD);
+				m_standard.size = 0;
+			}
+
+			MediaItemCache::~MediaItemCache() {
+				//
+			}
+
+			qint64 MediaItemCache::getDefaultBudget(MediaFileType const& fileType) {
+				if (fileType == MediaFileType::TYPE_THUMBNAIL) {
+					return 8 * 1024 * 1024;
+				}
+				return 64 * 1024 * 1024;
+			}
+
+			MediaItemCache::Segment& MediaItemCache::getSegment(MediaFileType const& fileType) const {
+				return (fileType == MediaFileType::TYPE_THUMBNAIL) ? m_thumbnails : m_standard;
+			}
+
+			bool MediaItemCache::get(QString const& uuid, MediaFileType const& fileType, QByteArray& data) const {
+				QMutexLocker lock(&m_mutex);
+				Segment& segment = getSegment(fileType);
+				auto const it = segment.index.constFind(uuid);
+				if (it == segment.index.constEnd()) {
+					++m_misses;
+					return false;
+				}
+
+				segment.entries.splice(segment.entries.begin(), segment.entries, it.value());
+				data = it.value()->second;
+				++m_hits;
+				return true;
+			}
+
+			void MediaItemCache::insert(QString const& uuid, MediaFileType const& fileType, QByteArray const& data) const {
+				QMutexLocker lock(&m_mutex);
+				insertLocked(uuid, fileType, data);
+			}
+
+			void MediaItemCache::insert(QString const& uuid, MediaFileType const& fileType, QByteArray const& data, quint64 generation) const {
+				QMutexLocker lock(&m_mutex);
+				if (generation == m_generation) {
+					insertLocked(uuid, fileType, data);
+				}
+			}
+
+			quint64 MediaItemCache::getGeneration() const {
+				QMutexLocker lock(&m_mutex);
+				return m_generation;
+			}
+
+			void MediaItemCache::insertLocked(QString const& uuid, MediaFileType const& fileType, QByteArray const& data) const {
+				Segment& segment = getSegment(fileType);
+				auto const it = segment.index.find(uuid);
+				if (it != segment.index.end()) {
+					segment.size -= it.value()->second.size();
+					segment.entries.erase(it.value());
+					segment.index.erase(it);
+				}
+
+				// Items larger than the whole budget would only flush everything else.
+				if (data.size() > segment.budget) {
+					return;
+				}
+
+				evict(segment, segment.budget - data.size());
+				segment.entries.emplace_front(uuid, data);
+				segment.index.insert(uuid, segment.entries.begin());
+				segment.size += data.size();
+			}
+
+			void MediaItemCache::remove(QString const& uuid, MediaFileType const& fileType) const {
+				QMutexLocker lock(&m_mutex);
+				++m_generation;
+				Segment& segment = getSegment(fileType);
+				auto const it = segment.index.find(uuid);
+				if (it != segment.index.end()) {
+					segment.size -= it.value()->second.size();
+					segment.entries.erase(it.value());
+					segment.index.erase(it);
+				}
+			}
+
+			void MediaItemCache::clear() const {
+				QMutexLocker lock(&m_mutex);
+				++m_generation;
+				m_thumbnails.entries.clear();
+				m_thumbnails.index.clear();
+				m_thumbnails.size = 0;
+				m_standard.entries.clear();
+				m_standard.index.clear();
+				m_standard.size = 0;
+			}
+
+			void MediaItemCache::evict(Segment& segment, qint64 targetSize) const {
+				while ((segment.size > targetSize) && (!segment.entries.empty())) {
+					Entry const& entry = segment.entries.back();
+					segment.size -= entry.second.size();
+					segment.index.remove(entry.first);
+					segment.entries.pop_back();
+					++m_evictions;
+				}
+			}
+
+			void MediaItemCache::setBudget(MediaFileType const& fileType, qint64 budgetInBytes) {
+				QMutexLocker lock(&m_mutex);
+				Segment& segment = getSegment(fileType);
+				segment.budget = (budgetInBytes > 0) ? budgetInBytes : 0;
+				evict(segment, segment.budget);
+			}
+
+			qint64 MediaItemCache::getBudget(MediaFileType const& fileType) const {
+				QMutexLocker lock(&m_mutex);
+				return getSegment(fileType).budget;
+			}
+
+			MediaItemCache::Statistics MediaItemCache::getStatistics() const {
+				QMutexLocker lock(&m_mutex);
+				Statistics const statistics = { m_hits, m_misses, m_evictions, m_thumbnails.size, m_standard.size };
+				return statistics;
+			}
+
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_MEDIAITEMCACHE_H_
+#define OPENMITTSU_DATABASE_INTERNAL_MEDIAITEMCACHE_H_
+
+#include "src/database/MediaCacheStatistics.h"
+#include "src/database/MediaFileType.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+
+#include <list>
+#include <utility>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Keeps the plaintext of recently read media items, so showing the same item again does not read and decrypt its file.
+			 * Thumbnails and full media items have separate budgets in bytes, each evicting its least recently used entries once it is full.
+			 * All methods may be called from any thread.
+			 */
+			class MediaItemCache {
+			public:
+				typedef openmittsu::database::MediaCacheStatistics Statistics;
+
+				MediaItemCache();
+				virtual ~MediaItemCache();
+
+				/** Returns true and fills data if the item is cached, and marks it as most recently used. */
+				bool get(QString const& uuid, MediaFileType const& fileType, QByteArray& data) const;
+				void insert(QString const& uuid, MediaFileType const& fileType, QByteArray const& data) const;
+
+				/**
+				 * Inserts the item only if nothing was removed since getGeneration() returned generation.
+				 * Used by loads running outside of the database thread, which must not bring back an item removed in the meantime.
+				 */
+				void insert(QString const& uuid, MediaFileType const& fileType, QByteArray const& data, quint64 generation) const;
+				quint64 getGeneration() const;
+				void remove(QString const& uuid, MediaFileType const& fileType) const;
+				void clear() const;
+
+				/** A budget of zero disables caching for the file type. Shrinking a budget evicts entries right away. */
+				void setBudget(MediaFileType const& fileType, qint64 budgetInBytes);
+				qint64 getBudget(MediaFileType const& fileType) const;
+				Statistics getStatistics() const;
+
+				static qint64 getDefaultBudget(MediaFileType const& fileType);
+			private:
+				typedef std::pair<QString, QByteArray> Entry;
+
+				struct Segment {
+					std::list<Entry> entries;
+					QHash<QString, std::list<Entry>::iterator> index;
+					qint64 budget;
+					qint64 size;
+				};
+
+				Segment& getSegment(MediaFileType const& fileType) const;
+				void evict(Segment& segment, qint64 targetSize) const;
+				void insertLocked(QString const& uuid, MediaFileType const& fileType, QByteArray const& data) const;
+
+				mutable QMutex m_mutex;
+				mutable Segment m_thumbnails;
+				mutable Segment m_standard;
+				mutable quint64 m_hits;
+				mutable quint64 m_misses;
+				mutable quint64 m_evictions;
+				mutable quint64 m_generation;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_MEDIAITEMCACHE_H_
@@ -0,0 +1,89 @@
+#include "src/database/internal/MediaQuota.h"
+
+#include "src/utility/Logging.h"
+
+#include <QDateTime>
+
+#include <limits>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			MediaQuota::MediaQuota(MediaFileStorage* mediaFileStorage) : m_mediaFileStorage(mediaFileStorage), m_settings(getDefaultSettings()) {
+				//
+			}
+
+			MediaQuota::~MediaQuota() {
+				// Intentionally left empty.
+			}
+
+			MediaQuota::Settings MediaQuota::getDefaultSettings() {
+				Settings const settings = { 0, 0, MediaFileStorage::EvictionOrder::OLDEST_FIRST };
+				return settings;
+			}
+
+			MediaQuota::Settings MediaQuota::getSettings() const {
+				return m_settings;
+			}
+
+			void MediaQuota::setSettings(Settings const& settings) {
+				m_settings = settings;
+			}
+
+			bool MediaQuota::isEnabled() const {
+				return (m_settings.budgetInBytes > 0) || (m_settings.maxAgeInDays > 0);
+			}
+
+			MediaQuota::Pass MediaQuota::startPass() {
+				Pass const pass = { { QString(), 0, 0 }, { QString(), 0, 0 }, false };
+				return pass;
+			}
+
+			int MediaQuota::enforce(Pass& pass, int maxItemCount, qint64& freedBytes) {
+				int evictedItems = 0;
+
+				if ((m_settings.maxAgeInDays > 0) && (!pass.isAgeLimitMet)) {
+					qint64 const sortedBefore = QDateTime::currentMSecsSinceEpoch() - (m_settings.maxAgeInDays * Q_INT64_C(24 * 60 * 60 * 1000));
+					QList<MediaFileStorage::EvictionCandidate> const candidates = m_mediaFileStorage->getEvictionCandidates(MediaFileStorage::EvictionOrder::OLDEST_FIRST, sortedBefore, pass.ageCursor, maxItemCount);
+					for (MediaFileStorage::EvictionCandidate const& candidate : candidates) {
+						LOGGER_DEBUG("Media quota: Evicting media item {} as it is older than {} days.", candidate.uuid.toStdString(), m_settings.maxAgeInDays);
+						freedBytes += m_mediaFileStorage->evictMediaItem(candidate.uuid);
+						pass.ageCursor = candidate;
+						++evictedItems;
+					}
+					pass.isAgeLimitMet = (candidates.size() < maxItemCount);
+				}
+
+				if ((m_settings.budgetInBytes > 0) && (evictedItems < maxItemCount)) {
+					qint64 bytesOverBudget = m_mediaFileStorage->getMediaUsage().standardBytes - m_settings.budgetInBytes;
+					if (bytesOverBudget > 0) {
+						int const remainingItemCount = maxItemCount - evictedItems;
+						QList<MediaFileStorage::EvictionCandidate> const candidates = m_mediaFileStorage->getEvictionCandidates(m_settings.evictionOrder, std::numeric_limits<qint64>::max(), pass.budgetCursor, remainingItemCount);
+						for (MediaFileStorage::EvictionCandidate const& candidate : candidates) {
+							if (bytesOverBudget <= 0) {
+								break;
+							}
+
+							LOGGER_DEBUG("Media quota: Evicting media item {}, the media budget is exceeded by {} bytes.", candidate.uuid.toStdString(), bytesOverBudget);
+							freedBytes += m_mediaFileStorage->evictMediaItem(candidate.uuid);
+							pass.budgetCursor = candidate;
+							++evictedItems;
+
+							// Items sharing their content free nothing on disk, but still count against the budget in full. The usage is a running total, so it is cheap to read again.
+							bytesOverBudget = m_mediaFileStorage->getMediaUsage().standardBytes - m_settings.budgetInBytes;
+						}
+
+						// Media of messages that no longer exist, or of other owners, can not be evicted. Stop instead of trying again.
+						if ((bytesOverBudget > 0) && (candidates.size() < remainingItemCount)) {
+							LOGGER()->warn("Media quota: The media budget is exceeded by {} bytes, but no more media items can be evicted.", bytesOverBudget);
+						}
+					}
+				}
+
+				return evictedItems;
+			}
+
+		}
+	}
+}
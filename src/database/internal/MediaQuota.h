@@ -0,0 +1,63 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_MEDIAQUOTA_H_
+#define OPENMITTSU_DATABASE_INTERNAL_MEDIAQUOTA_H_
+
+#include "src/database/internal/MediaFileStorage.h"
+
+#include <QtGlobal>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Keeps the full-size media of conversations within a byte budget and a maximum age.
+			 *
+			 * Items beyond either limit are evicted (see MediaFileStorage::evictMediaItem()): their data is dropped, while the message, its thumbnail and
+			 * the media entry stay, so the conversation still shows that an item existed and where it could be downloaded again. Thumbnails, group images
+			 * and items of other owners never count against the budget. Sizes are plaintext sizes, an item sharing its file with others counts in full.
+			 */
+			class MediaQuota {
+			public:
+				struct Settings {
+					/** Zero or less disables the budget. */
+					qint64 budgetInBytes;
+					/** Zero or less keeps items regardless of their age. */
+					int maxAgeInDays;
+					MediaFileStorage::EvictionOrder evictionOrder;
+				};
+
+				/**
+				 * Position of one pass over the eviction candidates. Items before the cursors were evicted or did not need to be, so a pass visits every item
+				 * at most once and each call only reads the next few items from an index. Items stored meanwhile before a cursor are only seen by the next pass.
+				 */
+				struct Pass {
+					MediaFileStorage::EvictionCandidate ageCursor;
+					MediaFileStorage::EvictionCandidate budgetCursor;
+					bool isAgeLimitMet;
+				};
+
+				explicit MediaQuota(MediaFileStorage* mediaFileStorage);
+				virtual ~MediaQuota();
+
+				Settings getSettings() const;
+				void setSettings(Settings const& settings);
+				bool isEnabled() const;
+
+				/**
+				 * Continues pass by evicting at most maxItemCount items that are too old, or, while the budget is exceeded, the next items in eviction order.
+				 * Adds the bytes freed on disk to freedBytes and returns the number of evicted items. Fewer than maxItemCount means all limits are met and the pass is complete.
+				 */
+				int enforce(Pass& pass, int maxItemCount, qint64& freedBytes);
+
+				static Settings getDefaultSettings();
+				static Pass startPass();
+			private:
+				MediaFileStorage* const m_mediaFileStorage;
+				Settings m_settings;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_MEDIAQUOTA_H_
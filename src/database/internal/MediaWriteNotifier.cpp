@@ -0,0 +1,27 @@
+#include "src/database/internal/MediaWriteNotifier.h"
+
+#include "src/utility/QObjectConnectionMacro.h"
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			MediaWriteNotifier::MediaWriteNotifier(std::function<void()> const& callback) : QObject(), m_callback(callback) {
+				OPENMITTSU_CONNECT_QUEUED(this, writeFinished(), this, onWriteFinished());
+			}
+
+			MediaWriteNotifier::~MediaWriteNotifier() {
+				// Intentionally left empty.
+			}
+
+			void MediaWriteNotifier::notify() {
+				emit writeFinished();
+			}
+
+			void MediaWriteNotifier::onWriteFinished() {
+				m_callback();
+			}
+
+		}
+	}
+}
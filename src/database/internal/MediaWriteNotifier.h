@@ -0,0 +1,35 @@
+#ifndef OPENMITTSU_DATABASE_INTERNAL_MEDIAWRITENOTIFIER_H_
+#define OPENMITTSU_DATABASE_INTERNAL_MEDIAWRITENOTIFIER_H_
+
+#include <QObject>
+
+#include <functional>
+
+namespace openmittsu {
+	namespace database {
+		namespace internal {
+
+			/**
+			 * Hands the completion of media writes on the media I/O pool back to the thread owning the database.
+			 * notify() may be called from any thread, the callback always runs on the thread this notifier lives on once it returns to its event loop.
+			 */
+			class MediaWriteNotifier : public QObject {
+				Q_OBJECT
+			public:
+				explicit MediaWriteNotifier(std::function<void()> const& callback);
+				virtual ~MediaWriteNotifier();
+
+				void notify();
+			signals:
+				void writeFinished();
+			private slots:
+				void onWriteFinished();
+			private:
+				std::function<void()> const m_callback;
+			};
+
+		}
+	}
+}
+
+#endif // OPENMITTSU_DATABASE_INTERNAL_MEDIAWRITENOTIFIER_H_
@@ -36,7 +36,7 @@ namespace openmittsu {
 		}
 
 		openmittsu::database::MediaFileItem BackedGroup::getImage() const {
-			return m_groupData.image;
+			return m_groupData.image.get();
 		}
 
 		bool BackedGroup::hasImage() const {
@@ -85,6 +85,10 @@ namespace openmittsu {
 			return getMessage().getContentAsMediaFile();
 		}
 
+		std::unique_ptr<QIODevice> BackedMessage::getContentAsMediaDevice() const {
+			return getMessage().getContentAsMediaDevice();
+		}
+
 		QString const& BackedMessage::getCaption() const {
 			return getMessage().getCaption();
 		}
@@ -45,6 +45,7 @@ namespace openmittsu {
 			QString getContentAsText() const;
 			openmittsu::utility::Location getContentAsLocation() const;
 			openmittsu::database::MediaFileItem getContentAsMediaFile() const;
+			std::unique_ptr<QIODevice> getContentAsMediaDevice() const;
 
 			QString const& getCaption() const;
 
@@ -34,6 +34,7 @@ namespace openmittsu {
 			
 			virtual openmittsu::database::ContactData getContactData(openmittsu::protocol::ContactId const& contact, bool fetchMessageCount) const = 0;
 			virtual QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> getContactDataAll(bool fetchMessageCount) const = 0;
+			virtual QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> getContactDataSnapshot(QSet<openmittsu::protocol::ContactId> const& contacts, bool fetchMessageCount) const = 0;
 
 			virtual int getContactCount() const = 0;
 
@@ -37,6 +37,7 @@ namespace openmittsu {
 
 			virtual openmittsu::database::GroupData getGroupData(openmittsu::protocol::GroupId const& group, bool withDescription) const = 0;
 			virtual QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> getGroupDataAll(bool withDescription) const = 0;
+			virtual QHash<openmittsu::protocol::GroupId, openmittsu::database::GroupData> getGroupDataSnapshot(QSet<openmittsu::protocol::GroupId> const& groups, bool withDescription) const = 0;
 
 			virtual void addGroup(QVector<openmittsu::database::NewGroupData> const& newGroupData) = 0;
 
@@ -7,78 +7,129 @@
 #include "src/utility/QObjectConnectionMacro.h"
 
 #include <QMutexLocker>
+#include <QTimer>
 
 namespace openmittsu {
 	namespace dataproviders {
 
-		KeyRegistry::KeyRegistry(KeyRegistry const& other) : m_mutex(), m_isCacheValid(false), m_cachedSelfContactId(0), m_serverLongTermPublicKey(other.m_serverLongTermPublicKey), m_database(other.m_database) {
+		KeyRegistry::KeyRegistry(KeyRegistry const& other) : m_publicKeys(other.getPublicKeySnapshot()), m_pendingMutex(), m_pendingContacts(), m_cachedSelfContactId(other.m_cachedSelfContactId), m_cachedClientLongTermKeyPair(other.m_cachedClientLongTermKeyPair), m_serverLongTermPublicKey(other.m_serverLongTermPublicKey), m_database(other.m_database) {
+			if (!m_database.hasDatabase()) {
+				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::KeyRegistry() called while the database is unavailable.";
+			} else {
+				OPENMITTSU_CONNECT(&m_database, contactChanged(openmittsu::protocol::ContactId const&), this, onContactChanged(openmittsu::protocol::ContactId const&));
+			}
+			// The snapshot of the other registry is immutable and can be shared, only its pending changes need to be replayed.
 			{
-				if (!m_database.hasDatabase()) {
-					throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::KeyRegistry() called while the database is unavailable.";
-				} else {
-					OPENMITTSU_CONNECT(&m_database, contactChanged(openmittsu::protocol::ContactId const&), this, onContactChanged());
-				}
+				QMutexLocker otherLock(&other.m_pendingMutex);
+				m_pendingContacts = other.m_pendingContacts;
+			}
+			if (!m_pendingContacts.isEmpty()) {
+				QTimer::singleShot(0, this, SLOT(applyPendingContactChanges()));
 			}
-			onContactChanged();
 		}
 
 		KeyRegistry::KeyRegistry(openmittsu::crypto::PublicKey const& serverLongTermPublicKey, openmittsu::database::DatabaseWrapper const& database)
-			: m_mutex(), m_isCacheValid(false), m_cachedSelfContactId(0), m_serverLongTermPublicKey(serverLongTermPublicKey), m_database(database) {
-			{
-				if (!m_database.hasDatabase()) {
-					throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::KeyRegistry() called while the database is unavailable.";
-				} else {
-					OPENMITTSU_CONNECT(&m_database, contactChanged(openmittsu::protocol::ContactId const&), this, onContactChanged());
-				}
+			: m_publicKeys(std::make_shared<PublicKeyMap const>()), m_pendingMutex(), m_pendingContacts(), m_cachedSelfContactId(0), m_serverLongTermPublicKey(serverLongTermPublicKey), m_database(database) {
+			if (!m_database.hasDatabase()) {
+				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::KeyRegistry() called while the database is unavailable.";
+			} else {
+				OPENMITTSU_CONNECT(&m_database, contactChanged(openmittsu::protocol::ContactId const&), this, onContactChanged(openmittsu::protocol::ContactId const&));
 			}
-			onContactChanged();
+			loadFromDatabase();
 		}
 
 		KeyRegistry::~KeyRegistry() {
 			// Intentionally left empty.
 		}
 
-		void KeyRegistry::onContactChanged() {
-			QMutexLocker mutexLock(&m_mutex);
-			invalidateCache();
-			updateCache();
+		void KeyRegistry::onContactChanged(openmittsu::protocol::ContactId const& identity) {
+			QMutexLocker mutexLock(&m_pendingMutex);
+			bool const needsScheduling = m_pendingContacts.isEmpty();
+			m_pendingContacts.insert(identity);
+
+			// Notifications that are already queued will be delivered before this fires, so a bulk import is applied as one batch.
+			if (needsScheduling) {
+				QTimer::singleShot(0, this, SLOT(applyPendingContactChanges()));
+			}
 		}
 
-		openmittsu::protocol::ContactId KeyRegistry::getSelfContactId() const {
-			QMutexLocker mutexLock(&m_mutex);
-			if (!m_isCacheValid) {
-				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::getSelfContactId() called while the cache is invalid.";
+		void KeyRegistry::applyPendingContactChanges() {
+			QSet<openmittsu::protocol::ContactId> changedContacts;
+			{
+				QMutexLocker mutexLock(&m_pendingMutex);
+				changedContacts.swap(m_pendingContacts);
+			}
+
+			if (changedContacts.isEmpty()) {
+				return;
+			}
+
+			openmittsu::database::ContactToContactDataMap contactData;
+			try {
+				contactData = m_database.getContactDataSnapshot(changedContacts, false);
+			} catch (openmittsu::exceptions::InternalErrorExceptionImpl& iee) {
+				LOGGER()->warn("KeyRegistry could not fetch {} changed contacts: {}", changedContacts.size(), iee.what());
+				return;
+			}
+
+			std::shared_ptr<PublicKeyMap const> const current = getPublicKeySnapshot();
+			QHash<openmittsu::protocol::ContactId, openmittsu::crypto::PublicKey> updates;
+			QSet<openmittsu::protocol::ContactId> removals;
+			for (auto it = changedContacts.constBegin(), end = changedContacts.constEnd(); it != end; ++it) {
+				auto const dataIt = contactData.constFind(*it);
+				if (dataIt == contactData.constEnd()) {
+					if (current->contains(*it)) {
+						removals.insert(*it);
+					}
+				} else {
+					auto const currentIt = current->constFind(*it);
+					if ((currentIt == current->constEnd()) || (currentIt.value() != dataIt->publicKey)) {
+						updates.insert(*it, dataIt->publicKey);
+					}
+				}
+			}
+
+			// Most notifications concern nicknames or status, in which case the snapshot stays untouched.
+			if (updates.isEmpty() && removals.isEmpty()) {
+				return;
+			}
+
+			std::shared_ptr<PublicKeyMap> next = std::make_shared<PublicKeyMap>(*current);
+			for (auto it = updates.constBegin(), end = updates.constEnd(); it != end; ++it) {
+				next->insert(it.key(), it.value());
+			}
+			for (auto it = removals.constBegin(), end = removals.constEnd(); it != end; ++it) {
+				next->remove(*it);
 			}
 
+			std::atomic_store(&m_publicKeys, std::shared_ptr<PublicKeyMap const>(std::move(next)));
+			LOGGER_DEBUG("Applied {} new and {} removed keys to KeyRegistry.", updates.size(), removals.size());
+		}
+
+		std::shared_ptr<KeyRegistry::PublicKeyMap const> KeyRegistry::getPublicKeySnapshot() const {
+			return std::atomic_load(&m_publicKeys);
+		}
+
+		openmittsu::protocol::ContactId KeyRegistry::getSelfContactId() const {
 			return m_cachedSelfContactId;
 		}
 
 		bool KeyRegistry::hasIdentity(openmittsu::protocol::ContactId const& identity) const {
-			QMutexLocker mutexLock(&m_mutex);
-			if (!m_isCacheValid) {
-				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::hasIdentity(identity = " << identity.toString() << ") called while the cache is invalid.";
-			}
-
-			return m_cachedPublicKeys.contains(identity);
+			return getPublicKeySnapshot()->contains(identity);
 		}
 
 		openmittsu::crypto::PublicKey KeyRegistry::getPublicKeyForIdentity(openmittsu::protocol::ContactId const& identity) const {
-			QMutexLocker mutexLock(&m_mutex);
-			if (!m_isCacheValid) {
-				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::getPublicKeyForIdentity(identity = " << identity.toString() << ") called while the cache is invalid.";
-			} else if (!m_cachedPublicKeys.contains(identity)) {
+			std::shared_ptr<PublicKeyMap const> const snapshot = getPublicKeySnapshot();
+
+			auto const it = snapshot->constFind(identity);
+			if (it == snapshot->constEnd()) {
 				throw openmittsu::exceptions::IllegalArgumentException() << "KeyRegistry::getPublicKeyForIdentity(identity = " << identity.toString() << ") called with identity that does not exist.";
-			} else {
-				return m_cachedPublicKeys.value(identity).publicKey;
 			}
+
+			return it.value();
 		}
 
 		openmittsu::crypto::KeyPair const& KeyRegistry::getClientLongTermKeyPair() const {
-			QMutexLocker mutexLock(&m_mutex);
-			if (!m_isCacheValid) {
-				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::getClientLongTermKeyPair() called while the cache is not prepared.";
-			}
-
 			return m_cachedClientLongTermKeyPair;
 		}
 
@@ -86,23 +137,24 @@ namespace openmittsu {
 			return m_serverLongTermPublicKey;
 		}
 
-		void KeyRegistry::invalidateCache() {
-			this->m_isCacheValid = false;
-		}
-		
-		void KeyRegistry::updateCache() {
+		void KeyRegistry::loadFromDatabase() {
 			if (!m_database.hasDatabase()) {
-				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::updateCache() called while the database is unavailable.";
-			} else {
-				std::shared_ptr<openmittsu::backup::IdentityBackup> const backupData = m_database.getBackup();
+				throw openmittsu::exceptions::InternalErrorException() << "KeyRegistry::loadFromDatabase() called while the database is unavailable.";
+			}
 
-				m_cachedSelfContactId = backupData->getClientContactId();
-				m_cachedClientLongTermKeyPair = backupData->getClientLongTermKeyPair();
-				m_cachedPublicKeys = m_database.getContactDataAll(false);
+			std::shared_ptr<openmittsu::backup::IdentityBackup> const backupData = m_database.getBackup();
+			m_cachedSelfContactId = backupData->getClientContactId();
+			m_cachedClientLongTermKeyPair = backupData->getClientLongTermKeyPair();
 
-				this->m_isCacheValid = true;
-				LOGGER_DEBUG("Updated cache in KeyRegistry.");
+			openmittsu::database::ContactToContactDataMap const contactData = m_database.getContactDataAll(false);
+			std::shared_ptr<PublicKeyMap> publicKeys = std::make_shared<PublicKeyMap>();
+			publicKeys->reserve(contactData.size());
+			for (auto it = contactData.constBegin(), end = contactData.constEnd(); it != end; ++it) {
+				publicKeys->insert(it.key(), it->publicKey);
 			}
+
+			std::atomic_store(&m_publicKeys, std::shared_ptr<PublicKeyMap const>(std::move(publicKeys)));
+			LOGGER_DEBUG("Loaded {} keys into KeyRegistry.", contactData.size());
 		}
 	}
 }
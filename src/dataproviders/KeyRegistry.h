@@ -3,13 +3,13 @@
 
 #include "src/crypto/PublicKey.h"
 #include "src/crypto/KeyPair.h"
-#include "src/database/ContactData.h"
 #include "src/database/DatabaseWrapper.h"
 #include "src/protocol/ContactId.h"
 
 #include <QObject>
 #include <QMutex>
 #include <QHash>
+#include <QSet>
 
 #include <memory>
 
@@ -31,21 +31,29 @@ namespace openmittsu {
 
 			openmittsu::protocol::ContactId getSelfContactId() const;
 		private slots:
-			void onContactChanged();
+			void onContactChanged(openmittsu::protocol::ContactId const& identity);
+			void applyPendingContactChanges();
 		private:
+			typedef QHash<openmittsu::protocol::ContactId, openmittsu::crypto::PublicKey> PublicKeyMap;
+
 			KeyRegistry() = delete;
-			void invalidateCache();
-			void updateCache();
+			void loadFromDatabase();
+			std::shared_ptr<PublicKeyMap const> getPublicKeySnapshot() const;
+
+			/**
+			 * Readers take an immutable snapshot of the identity to public key map without locking.
+			 * Updates build a new map and swap the pointer, so lookups from the crypto path never wait on database round trips.
+			 */
+			std::shared_ptr<PublicKeyMap const> m_publicKeys;
 
-			mutable QMutex m_mutex;
-			bool m_isCacheValid;
+			// Guards the set of changed contacts, which is drained in one batch per event loop iteration.
+			mutable QMutex m_pendingMutex;
+			QSet<openmittsu::protocol::ContactId> m_pendingContacts;
 
 			openmittsu::protocol::ContactId m_cachedSelfContactId;
 			openmittsu::crypto::KeyPair m_cachedClientLongTermKeyPair;
 			openmittsu::crypto::PublicKey const m_serverLongTermPublicKey;
 
-			QHash<openmittsu::protocol::ContactId, openmittsu::database::ContactData> m_cachedPublicKeys;
-
 			openmittsu::database::DatabaseWrapper m_database;
 		};
 
@@ -1096,8 +1096,9 @@ namespace openmittsu {
 			sendGroupCreation(group, groupData.members, recipients, false);
 			sendGroupTitle(group, groupData.title, recipients, false);
 			if (groupData.hasImage) {
-				if (groupData.image.isAvailable()) {
-					sendGroupImage(group, groupData.image.getData(), recipients, false);
+				openmittsu::database::MediaFileItem const image = groupData.image.get();
+				if (image.isAvailable()) {
+					sendGroupImage(group, image.getData(), recipients, false);
 				}
 			}
 		}
@@ -6,6 +6,10 @@
 #include "src/dataproviders/messages/UserMessageState.h"
 #include "src/utility/Location.h"
 
+#include <QIODevice>
+
+#include <memory>
+
 namespace openmittsu {
 	namespace dataproviders {
 		namespace messages {
@@ -29,6 +33,9 @@ namespace openmittsu {
 				virtual openmittsu::utility::Location getContentAsLocation() const = 0;
 				virtual openmittsu::database::MediaFileItem getContentAsMediaFile() const = 0;
 
+				/** Opens the media content for streaming reads, or returns nullptr if it is not available. */
+				virtual std::unique_ptr<QIODevice> getContentAsMediaDevice() const = 0;
+
 				virtual QString const& getCaption() const = 0;
 			};
 
@@ -0,0 +1,123 @@
+#include "src/dialogs/MediaIntegrityDialog.h"
+#include "ui_MediaIntegrityDialog.h"
+
+#include "src/utility/MakeUnique.h"
+#include "src/utility/QObjectConnectionMacro.h"
+
+namespace openmittsu {
+	namespace dialogs {
+
+		MediaIntegrityDialog::MediaIntegrityDialog(openmittsu::database::DatabaseWrapper const& database, QWidget* parent) : QDialog(parent), m_ui(std::make_unique<Ui::MediaIntegrityDialog>()), m_database(database), m_updateTimer() {
+			m_ui->setupUi(this);
+
+			OPENMITTSU_CONNECT(m_ui->btnStart, clicked(), this, btnStartOnClick());
+			OPENMITTSU_CONNECT(m_ui->btnCancel, clicked(), this, btnCancelOnClick());
+			OPENMITTSU_CONNECT(&m_updateTimer, timeout(), this, updateTimerOnTimeout());
+
+			m_updateTimer.setInterval(500);
+			updateTimerOnTimeout();
+			updateDamagedItems();
+		}
+
+		MediaIntegrityDialog::~MediaIntegrityDialog() {
+			m_updateTimer.stop();
+		}
+
+		void MediaIntegrityDialog::btnStartOnClick() {
+			if (!m_database.hasDatabase()) {
+				return;
+			}
+
+			m_database.startMediaIntegrityScan(m_ui->chkRepair->isChecked());
+			updateTimerOnTimeout();
+		}
+
+		void MediaIntegrityDialog::btnCancelOnClick() {
+			if (!m_database.hasDatabase()) {
+				return;
+			}
+
+			m_database.cancelMediaIntegrityScan();
+			updateTimerOnTimeout();
+		}
+
+		void MediaIntegrityDialog::updateTimerOnTimeout() {
+			if (!m_database.hasDatabase()) {
+				m_updateTimer.stop();
+				m_ui->btnStart->setEnabled(false);
+				m_ui->btnCancel->setEnabled(false);
+				return;
+			}
+
+			bool const isRunning = m_database.isMediaIntegrityScanRunning();
+			updateReport(isRunning);
+
+			m_ui->btnStart->setEnabled(!isRunning);
+			m_ui->chkRepair->setEnabled(!isRunning);
+			m_ui->btnCancel->setEnabled(isRunning);
+
+			if (isRunning) {
+				if (!m_updateTimer.isActive()) {
+					m_updateTimer.start();
+				}
+			} else if (m_updateTimer.isActive()) {
+				// The scan finished or was cancelled since the last update, so repairs may have marked new items.
+				m_updateTimer.stop();
+				updateDamagedItems();
+			}
+		}
+
+		void MediaIntegrityDialog::updateReport(bool isRunning) {
+			openmittsu::database::MediaIntegrityReport const report = m_database.getMediaIntegrityScanReport();
+
+			if (isRunning) {
+				m_ui->lblStatus->setText(tr("Checking media files..."));
+			} else if (report.isComplete) {
+				m_ui->lblStatus->setText(tr("The last check is complete."));
+			} else if (report.checkedItems > 0) {
+				m_ui->lblStatus->setText(tr("The last check was cancelled."));
+			} else {
+				m_ui->lblStatus->setText(tr("No check was started yet."));
+			}
+
+			m_ui->edtCheckedItems->setText(QString::number(report.checkedItems));
+			m_ui->edtMissingItems->setText(QString::number(report.missingItems));
+			m_ui->edtCorruptedItems->setText(QString::number(report.corruptedItems));
+			m_ui->edtOrphanedFiles->setText(QString::number(report.orphanedFiles));
+			m_ui->edtMarkedItems->setText(QString::number(report.markedItems));
+			m_ui->edtRemovedFiles->setText(QString::number(report.removedFiles));
+		}
+
+		void MediaIntegrityDialog::updateDamagedItems() {
+			m_ui->listDamagedItems->clear();
+			if (!m_database.hasDatabase()) {
+				return;
+			}
+
+			openmittsu::database::DamagedMediaItemList const damagedItems = m_database.getDamagedMediaItems();
+			for (openmittsu::database::DamagedMediaItem const& item : damagedItems) {
+				m_ui->listDamagedItems->addItem(QString("%1 (%2): %3").arg(item.uuid).arg(openmittsu::database::MediaFileTypeHelper::toQString(item.fileType)).arg(statusToString(item.status)));
+			}
+		}
+
+		QString MediaIntegrityDialog::statusToString(openmittsu::database::MediaFileItem::ItemStatus const& status) {
+			switch (status) {
+				case openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE:
+					return tr("not listed in the database");
+				case openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EXTERNAL_FILE_DELETED:
+					return tr("file missing");
+				case openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_FILE_CORRUPTED:
+					return tr("file corrupted");
+				case openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_DECRYPTION_FAILED:
+					return tr("decryption failed");
+				case openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_CRYPTO_ERROR:
+					return tr("cryptographic error");
+				case openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED:
+					return tr("removed by the storage quota");
+				default:
+					return tr("unknown error");
+			}
+		}
+
+	}
+}
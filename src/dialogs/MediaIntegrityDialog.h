@@ -0,0 +1,44 @@
+#ifndef OPENMITTSU_DIALOGS_MEDIAINTEGRITYDIALOG_H_
+#define OPENMITTSU_DIALOGS_MEDIAINTEGRITYDIALOG_H_
+
+#include <QDialog>
+#include <QTimer>
+
+#include <memory>
+
+#include "src/database/DatabaseWrapper.h"
+
+namespace Ui {
+	class MediaIntegrityDialog;
+}
+
+namespace openmittsu {
+	namespace dialogs {
+
+		/**
+		 * Starts and cancels media integrity scans and shows their results. The scan itself runs on the database thread,
+		 * so closing the dialog does not stop it and opening the dialog again shows its progress.
+		 */
+		class MediaIntegrityDialog : public QDialog {
+			Q_OBJECT
+		public:
+			explicit MediaIntegrityDialog(openmittsu::database::DatabaseWrapper const& database, QWidget* parent = nullptr);
+			virtual ~MediaIntegrityDialog();
+		private slots:
+			void btnStartOnClick();
+			void btnCancelOnClick();
+			void updateTimerOnTimeout();
+		private:
+			std::unique_ptr<Ui::MediaIntegrityDialog> m_ui;
+			openmittsu::database::DatabaseWrapper m_database;
+			QTimer m_updateTimer;
+
+			void updateReport(bool isRunning);
+			void updateDamagedItems();
+			static QString statusToString(openmittsu::database::MediaFileItem::ItemStatus const& status);
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_DIALOGS_MEDIAINTEGRITYDIALOG_H_
@@ -5,6 +5,9 @@
 #include <QGroupBox>
 #include <QLineEdit>
 #include <QCheckBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QSpinBox>
 #include <QVBoxLayout>
 
 #include "src/exceptions/InternalErrorException.h"
@@ -79,6 +82,21 @@ namespace openmittsu {
 
 						optionToWidgetMap.insert(option, ow);
 						layout->addWidget(edt);
+					} else if (optionData.type == openmittsu::options::OptionTypes::TYPE_INTEGER) {
+						QSpinBox* spin = new QSpinBox();
+						spin->setRange(optionData.minimumValue, optionData.maximumValue);
+						spin->setValue(optionMaster->getOptionAsInt(option));
+
+						QHBoxLayout* rowLayout = new QHBoxLayout();
+						rowLayout->addWidget(new QLabel(optionData.description));
+						rowLayout->addWidget(spin);
+
+						OptionWidget ow;
+						ow.type = optionData.type;
+						ow.spinPtr = spin;
+
+						optionToWidgetMap.insert(option, ow);
+						layout->addLayout(rowLayout);
 					} else {
 						throw openmittsu::exceptions::InternalErrorException() << "Unknown option type!";
 					}
@@ -104,6 +122,9 @@ namespace openmittsu {
 				} else if (i.value().type == openmittsu::options::OptionTypes::TYPE_FILEPATH) {
 					QString const value = i.value().edtPtr->text();
 					m_optionMaster->setOption(i.key(), value);
+				} else if (i.value().type == openmittsu::options::OptionTypes::TYPE_INTEGER) {
+					int const value = i.value().spinPtr->value();
+					m_optionMaster->setOption(i.key(), value);
 				} else {
 					throw openmittsu::exceptions::InternalErrorException() << "Unknown option type!";
 				}
@@ -19,8 +19,11 @@ namespace openmittsu {
 			OptionTypes type;
 			OptionGroups group;
 			OptionStorage storage;
+			/** Range of values offered for integer options. */
+			int minimumValue;
+			int maximumValue;
 
-			OptionContainer(OptionGroups const& optionGroup, Options const& option, QString const& optionName, QString const& optionDescription, QVariant const& optionDefaultValue, OptionTypes const& optionType, OptionStorage const& optionStorage) : option(option), name(optionName), description(optionDescription), defaultValue(optionDefaultValue), type(optionType), group(optionGroup), storage(optionStorage) {}
+			OptionContainer(OptionGroups const& optionGroup, Options const& option, QString const& optionName, QString const& optionDescription, QVariant const& optionDefaultValue, OptionTypes const& optionType, OptionStorage const& optionStorage) : option(option), name(optionName), description(optionDescription), defaultValue(optionDefaultValue), type(optionType), group(optionGroup), storage(optionStorage), minimumValue(0), maximumValue(4096) {}
 			OptionContainer() = default;
 		};
 	}
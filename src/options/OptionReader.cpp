@@ -9,6 +9,8 @@
 #include <QByteArray>
 #include <QCoreApplication>
 
+#include <limits>
+
 namespace openmittsu {
 	namespace options {
 
@@ -78,6 +80,16 @@ namespace openmittsu {
 			target->registerOption(OptionGroups::GROUP_GENERAL, Options::BOOLEAN_RECONNECT_ON_CONNECTION_LOSS, QStringLiteral("options/reconnectOnConnectionLoss"), tr("Automatically attempt reconnect on a connection loss"), true, OptionTypes::TYPE_BOOL, OptionStorage::STORAGE_DATABASE);
 			target->registerOption(OptionGroups::GROUP_GENERAL, Options::BOOLEAN_TRUST_OTHERS, QStringLiteral("options/trustOthers"), tr("Accept messages from users whose group membership has not (yet) been confirmed"), false, OptionTypes::TYPE_BOOL, OptionStorage::STORAGE_DATABASE);
 			target->registerOption(OptionGroups::GROUP_GENERAL, Options::BOOLEAN_UPDATE_FEATURE_LEVEL, QStringLiteral("options/updateFeatureLevel"), tr("Increase identity feature level to software feature level if possible"), true, OptionTypes::TYPE_BOOL, OptionStorage::STORAGE_DATABASE);
+			target->registerOption(OptionGroups::GROUP_GENERAL, Options::INTEGER_MEDIA_CACHE_THUMBNAIL_BUDGET_MIB, QStringLiteral("options/mediaCache/thumbnailBudgetMiB"), tr("Memory for recently shown thumbnails (MiB)"), 8, OptionTypes::TYPE_INTEGER, OptionStorage::STORAGE_DATABASE);
+			target->registerOption(OptionGroups::GROUP_GENERAL, Options::INTEGER_MEDIA_CACHE_MEDIA_BUDGET_MIB, QStringLiteral("options/mediaCache/mediaBudgetMiB"), tr("Memory for recently shown images and media (MiB)"), 64, OptionTypes::TYPE_INTEGER, OptionStorage::STORAGE_DATABASE);
+			target->registerOption(OptionGroups::GROUP_GENERAL, Options::INTEGER_MEDIA_QUOTA_MEDIA_BUDGET_MIB, QStringLiteral("options/mediaQuota/mediaBudgetMiB"), tr("Disk space for received and sent media, older media is removed beyond it (MiB, 0 for unlimited)"), 0, OptionTypes::TYPE_INTEGER, OptionStorage::STORAGE_DATABASE);
+			target->registerOption(OptionGroups::GROUP_GENERAL, Options::INTEGER_MEDIA_QUOTA_MAX_AGE_DAYS, QStringLiteral("options/mediaQuota/maxAgeDays"), tr("Remove media older than this many days, thumbnails and messages are kept (0 to keep all)"), 0, OptionTypes::TYPE_INTEGER, OptionStorage::STORAGE_DATABASE);
+			// The disk space for media is not bounded by memory like the cache budgets, and the age limit may span decades.
+			target->setOptionRange(Options::INTEGER_MEDIA_QUOTA_MEDIA_BUDGET_MIB, 0, std::numeric_limits<int>::max());
+			target->setOptionRange(Options::INTEGER_MEDIA_QUOTA_MAX_AGE_DAYS, 0, 100 * 366);
+			target->registerOption(OptionGroups::GROUP_GENERAL, Options::BOOLEAN_MEDIA_QUOTA_EVICT_LARGEST_FIRST, QStringLiteral("options/mediaQuota/evictLargestFirst"), tr("Remove the largest instead of the oldest media first when the disk space for media is used up"), false, OptionTypes::TYPE_BOOL, OptionStorage::STORAGE_DATABASE);
+			target->registerOption(OptionGroups::GROUP_GENERAL, Options::INTEGER_MESSAGE_ARCHIVE_AGE_DAYS, QStringLiteral("options/messageArchive/ageDays"), tr("Move messages older than this many days into the archive database during maintenance (0 to keep all in the main database)"), 365, OptionTypes::TYPE_INTEGER, OptionStorage::STORAGE_DATABASE);
+			target->setOptionRange(Options::INTEGER_MESSAGE_ARCHIVE_AGE_DAYS, 0, 100 * 366);
 			target->registerOption(OptionGroups::GROUP_GENERAL, Options::FILEPATH_DATABASE, QStringLiteral("options/database/databaseFile"), tr("Main database file path"), "", OptionTypes::TYPE_FILEPATH, OptionStorage::STORAGE_SIMPLE);
 			target->registerOption(OptionGroups::GROUP_INTERNAL, Options::BINARY_MAINWINDOW_GEOMETRY, QStringLiteral("options/internal/clientMainWindowGeometry"), "", QByteArray(), OptionTypes::TYPE_BINARY, OptionStorage::STORAGE_SIMPLE);
 			target->registerOption(OptionGroups::GROUP_INTERNAL, Options::BINARY_MAINWINDOW_STATE, QStringLiteral("options/internal/clientMainWindowState"), "", QByteArray(), OptionTypes::TYPE_BINARY, OptionStorage::STORAGE_SIMPLE);
@@ -92,6 +104,8 @@ namespace openmittsu {
 				return QMetaType::Type::Bool;
 			} else if (type == OptionTypes::TYPE_FILEPATH) {
 				return QMetaType::Type::QString;
+			} else if (type == OptionTypes::TYPE_INTEGER) {
+				return QMetaType::Type::Int;
 			} else {
 				throw openmittsu::exceptions::InternalErrorException() << "Unknown OptionReader::OptionTypes Key with value " << static_cast<int>(type) << "!";
 			}
@@ -120,6 +134,17 @@ namespace openmittsu {
 			}
 		}
 
+		bool OptionReader::setOptionRange(Options const& option, int minimumValue, int maximumValue) {
+			auto it = m_optionToOptionContainerMap.find(option);
+			if ((it == m_optionToOptionContainerMap.end()) || (it->type != OptionTypes::TYPE_INTEGER) || (minimumValue > maximumValue)) {
+				return false;
+			}
+
+			it->minimumValue = minimumValue;
+			it->maximumValue = maximumValue;
+			return true;
+		}
+
 		QString OptionReader::getOptionKeyForOption(Options const& option) const {
 			if (m_optionToOptionContainerMap.contains(option)) {
 				return m_optionToOptionContainerMap.value(option).name;
@@ -143,6 +168,8 @@ namespace openmittsu {
 				return ((value.toBool()) ? QStringLiteral("1") : QStringLiteral("0"));
 			} else if (optionType == OptionTypes::TYPE_FILEPATH) {
 				return value.toString();
+			} else if (optionType == OptionTypes::TYPE_INTEGER) {
+				return QString::number(value.toInt());
 			} else {
 				throw openmittsu::exceptions::InternalErrorException() << "Unknown OptionReader::OptionTypes Key with value " << static_cast<int>(optionType) << " found!";
 			}
@@ -169,6 +196,8 @@ namespace openmittsu {
 							settings->setValue(i.value().name, i.value().defaultValue.toBool());
 						} else if (i.value().type == OptionTypes::TYPE_FILEPATH) {
 							settings->setValue(i.value().name, i.value().defaultValue.toString());
+						} else if (i.value().type == OptionTypes::TYPE_INTEGER) {
+							settings->setValue(i.value().name, i.value().defaultValue.toInt());
 						} else {
 							throw openmittsu::exceptions::InternalErrorException() << "Unknown OptionReader::OptionTypes Key with value " << static_cast<int>(i.value().type) << " found on Option " << static_cast<int>(i.key()) << " with name \"" << i.value().name.toStdString() << "\"!";
 						}
@@ -305,5 +334,48 @@ namespace openmittsu {
 				throw openmittsu::exceptions::InternalErrorException() << "Unknown OptionReader::OptionStorage Key with value " << static_cast<int>(optionStorage) << " found on Option " << static_cast<int>(option) << " with name \"" << optionName.toStdString() << "\"!";
 			}
 		}
+
+		int OptionReader::toIntRepresentation(QString const& value) {
+			bool ok = false;
+			int const result = value.toInt(&ok);
+			if (!ok) {
+				throw openmittsu::exceptions::InternalErrorException() << "Can not convert requested option to int, database cache has value \"" << value.toStdString() << "\"!";
+			}
+			return result;
+		}
+
+		int OptionReader::getOptionAsInt(Options const& option) const {
+			if (!m_optionToOptionContainerMap.contains(option)) {
+				throw openmittsu::exceptions::InternalErrorException() << "Requested option " << static_cast<int>(option) << " does not exist!";
+			}
+			QString const optionName = getOptionKeyForOption(option);
+			OptionStorage const optionStorage = m_optionToOptionContainerMap.constFind(option)->storage;
+
+			if (optionStorage == OptionStorage::STORAGE_DATABASE) {
+				if (!m_database.hasDatabase()) {
+					return m_optionToOptionContainerMap.constFind(option)->defaultValue.toInt();
+				}
+
+				if (m_databaseCache.contains(optionName)) {
+					return toIntRepresentation(m_databaseCache.value(optionName));
+				} else {
+					throw openmittsu::exceptions::InternalErrorException() << "Requested option " << static_cast<int>(option) << " does not exist in database!";
+				}
+			} else if (optionStorage == OptionStorage::STORAGE_SIMPLE) {
+				QSettings* settings = getSettings();
+				if (settings->contains(optionName)) {
+					QVariant const v = settings->value(optionName);
+					if (v.canConvert(QMetaType::Type::Int)) {
+						return v.toInt();
+					} else {
+						throw openmittsu::exceptions::InternalErrorException() << "Can not convert requested option " << static_cast<int>(option) << " to int!";
+					}
+				} else {
+					throw openmittsu::exceptions::InternalErrorException() << "Requested option " << static_cast<int>(option) << " does not exist in settings!";
+				}
+			} else {
+				throw openmittsu::exceptions::InternalErrorException() << "Unknown OptionReader::OptionStorage Key with value " << static_cast<int>(optionStorage) << " found on Option " << static_cast<int>(option) << " with name \"" << optionName.toStdString() << "\"!";
+			}
+		}
 	}
 }
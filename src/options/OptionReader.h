@@ -33,16 +33,19 @@ namespace openmittsu {
 			virtual bool getOptionAsBool(Options const& option) const;
 			virtual QString getOptionAsQString(Options const& option) const;
 			virtual QByteArray getOptionAsQByteArray(Options const& option) const;
+			virtual int getOptionAsInt(Options const& option) const;
 
 			void registerOptions();
 			static void registerOptions(OptionRegister* target, QHash<OptionGroups, QString>& groupsToName);
 		protected:
 			virtual bool registerOption(OptionGroups const& optionGroup, Options const& option, QString const& optionName, QString const& optionDescription, QVariant const& defaultValue, OptionTypes const& optionType, OptionStorage const& optionStorage) override;
+			virtual bool setOptionRange(Options const& option, int minimumValue, int maximumValue) override;
 			static QSettings* getSettings();
 			static QString toStringRepresentation(QVariant const& value, OptionTypes const& optionType);
 			static bool toBoolRepresentation(QString const& value);
 			static QString toQStringRepresentation(QString const& value);
 			static QByteArray toQByteArrayRepresentation(QString const& value);
+			static int toIntRepresentation(QString const& value);
 		private slots:
 			void onDatabaseOptionsChanged();
 			void onDatabaseUpdated();
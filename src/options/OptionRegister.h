@@ -20,6 +20,8 @@ namespace openmittsu {
 			friend class OptionReader;
 		protected:
 			virtual bool registerOption(OptionGroups const& optionGroup, Options const& option, QString const& optionName, QString const& optionDescription, QVariant const& defaultValue, OptionTypes const& optionType, OptionStorage const& optionStorage) = 0;
+			/** Integer options offer values from 0 to 4096 unless a different range is set after registering them. */
+			virtual bool setOptionRange(Options const& option, int minimumValue, int maximumValue) = 0;
 		};
 	}
 }
@@ -8,7 +8,8 @@ namespace openmittsu {
 		enum class OptionTypes {
 			TYPE_BOOL,
 			TYPE_FILEPATH,
-			TYPE_BINARY
+			TYPE_BINARY,
+			TYPE_INTEGER
 		};
 	}
 }
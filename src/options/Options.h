@@ -14,6 +14,12 @@ namespace openmittsu {
 			BOOLEAN_RECONNECT_ON_CONNECTION_LOSS,
 			BOOLEAN_UPDATE_FEATURE_LEVEL,
 			BOOLEAN_TRUST_OTHERS,
+			INTEGER_MEDIA_CACHE_THUMBNAIL_BUDGET_MIB,
+			INTEGER_MEDIA_CACHE_MEDIA_BUDGET_MIB,
+			INTEGER_MEDIA_QUOTA_MEDIA_BUDGET_MIB,
+			INTEGER_MEDIA_QUOTA_MAX_AGE_DAYS,
+			BOOLEAN_MEDIA_QUOTA_EVICT_LARGEST_FIRST,
+			INTEGER_MESSAGE_ARCHIVE_AGE_DAYS,
 			FILEPATH_DATABASE,
 			FILEPATH_LEGACY_CLIENT_CONFIGURATION,
 			FILEPATH_LEGACY_CONTACTS_DATABASE,
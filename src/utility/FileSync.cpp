@@ -0,0 +1,46 @@
+#include "src/utility/FileSync.h"
+
+#include "src/utility/OsDetection.h"
+
+#include <QFile>
+
+#if defined(WINDOWS)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace openmittsu {
+	namespace utility {
+
+		bool FileSync::syncFile(QFile& file) {
+			if (!file.isOpen() || !file.flush()) {
+				return false;
+			}
+
+#if defined(WINDOWS)
+			return _commit(file.handle()) == 0;
+#else
+			return ::fsync(file.handle()) == 0;
+#endif
+		}
+
+		bool FileSync::syncDirectory(QString const& path) {
+#if defined(WINDOWS)
+			// Directory entries can not be synced explicitly on Windows, NTFS journals them.
+			Q_UNUSED(path);
+			return true;
+#else
+			int const fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+			if (fd < 0) {
+				return false;
+			}
+			bool const result = (::fsync(fd) == 0);
+			::close(fd);
+			return result;
+#endif
+		}
+
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef OPENMITTSU_UTILITY_FILESYNC_H_
+#define OPENMITTSU_UTILITY_FILESYNC_H_
+
+#include <QFile>
+#include <QString>
+
+namespace openmittsu {
+	namespace utility {
+
+		/**
+		 * Forces written data to stable storage, so a file that was renamed into place survives a crash or power loss with its full content.
+		 */
+		class FileSync {
+		public:
+			/** Flushes and syncs an open file. Returns false if the data could not be synced. */
+			static bool syncFile(QFile& file);
+
+			/** Syncs a directory, making renames and new entries in it durable. Always succeeds on platforms without directory sync. */
+			static bool syncDirectory(QString const& path);
+		};
+
+	}
+}
+
+#endif // OPENMITTSU_UTILITY_FILESYNC_H_
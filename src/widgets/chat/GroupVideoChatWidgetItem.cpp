@@ -37,12 +37,15 @@ namespace openmittsu {
 		}
 
 		void GroupVideoChatWidgetItem::onMessageDataChanged() {
-			openmittsu::database::MediaFileItem const audio = m_groupMessage.getContentAsMediaFile();
-			if (audio.isAvailable()) {
-				m_player->play(audio.getData());
-			} else {
-				LOGGER()->error("Failed to load audio clip for ContactAudioMessage!");
-				m_lblCaption->setText("");
+			// Message data also changes when the message is marked as seen, which must not restart playback.
+			if (!m_player->hasMedia()) {
+				std::unique_ptr<QIODevice> audio = m_groupMessage.getContentAsMediaDevice();
+				if (audio != nullptr) {
+					m_player->play(std::move(audio));
+				} else {
+					LOGGER()->error("Failed to load audio clip for ContactAudioMessage!");
+					m_lblCaption->setText("");
+				}
 			}
 
 			GroupChatWidgetItem::onMessageDataChanged();
@@ -51,18 +51,16 @@
 #include "src/widgets/player/Player.h"
 
 #include "src/widgets/player/PlayerControls.h"
-#include "src/widgets/player/PlaylistModel.h"
 #include "src/widgets/player/VideoWidget.h"
 
 #include <QMediaService>
-#include <QMediaPlaylist>
 #include <QVideoProbe>
 #include <QAudioProbe>
 #include <QMediaMetaData>
-#include <QtWidgets>
-
 #include <QDir>
+#include <QtWidgets>
 
+#include "src/exceptions/InternalErrorException.h"
 #include "src/utility/Logging.h"
 #include "src/utility/MakeUnique.h"
 #include "src/utility/QObjectConnectionMacro.h"
@@ -72,7 +70,7 @@
 namespace openmittsu {
 	namespace widgets {
 
-		Player::Player(bool useVideoWidget, QWidget *parent) : QWidget(parent), m_ui(std::make_unique<Ui::Player>()), m_useVideoWidget(useVideoWidget), m_tempFile(QDir::tempPath().append(QStringLiteral("/openmittsu_player_temp_XXXXXX.mp4"))) {
+		Player::Player(bool useVideoWidget, QWidget *parent) : QWidget(parent), m_ui(std::make_unique<Ui::Player>()), m_useVideoWidget(useVideoWidget), m_mediaDevice(), m_isStreaming(false), m_tempFile(QDir::tempPath().append(QStringLiteral("/openmittsu_player_temp_XXXXXX.mp4"))) {
 			m_ui->setupUi(this);
 			m_player = new QMediaPlayer(this);
 #if defined(QT_VERSION) && (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
@@ -83,14 +81,9 @@ namespace openmittsu {
 			}
 #endif
 
-			// owned by PlaylistModel
-			m_playlist = new QMediaPlaylist();
-			m_player->setPlaylist(m_playlist);
-
 			OPENMITTSU_CONNECT(m_player, durationChanged(qint64), this, durationChanged(qint64));
 			OPENMITTSU_CONNECT(m_player, positionChanged(qint64), this, positionChanged(qint64));
 			OPENMITTSU_CONNECT(m_player, metaDataChanged(), this, metaDataChanged());
-			OPENMITTSU_CONNECT(m_playlist, currentIndexChanged(int), this, playlistPositionChanged(int));
 			OPENMITTSU_CONNECT(m_player, mediaStatusChanged(QMediaPlayer::MediaStatus), this, statusChanged(QMediaPlayer::MediaStatus));
 			OPENMITTSU_CONNECT(m_player, bufferStatusChanged(int), this, bufferingProgress(int));
 			OPENMITTSU_CONNECT(m_player, videoAvailableChanged(bool), this, videoAvailableChanged(bool));
@@ -102,9 +95,6 @@ namespace openmittsu {
 				m_player->setVideoOutput(m_videoWidget);
 			}
 
-			m_playlistModel = new PlaylistModel(this);
-			m_playlistModel->setPlaylist(m_playlist);
-
 			m_slider = m_ui->slider;
 			m_slider->setRange(0, m_player->duration() / 1000);
 
@@ -156,7 +146,9 @@ namespace openmittsu {
 										"Please check the media service plugins are installed."));
 
 				controls->setEnabled(false);
-				m_fullScreenButton->setEnabled(false);
+				if (m_fullScreenButton != nullptr) {
+					m_fullScreenButton->setEnabled(false);
+				}
 			}
 
 			metaDataChanged();
@@ -179,12 +171,6 @@ namespace openmittsu {
 			return m_player->isAvailable();
 		}
 
-		void Player::addToPlaylist(const QList<QUrl> &urls) {
-			for (auto &url : urls) {
-				m_playlist->addMedia(url);
-			}
-		}
-
 		void Player::setCustomAudioRole(const QString &role) {
 #if defined(QT_VERSION) && (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
 			m_player->setCustomAudioRole(role);
@@ -219,26 +205,6 @@ namespace openmittsu {
 			}
 		}
 
-		void Player::previousClicked() {
-			// Go to previous track if we are within the first 5 seconds of playback
-			// Otherwise, seek to the beginning.
-			if (m_player->position() <= 5000)
-				m_playlist->previous();
-			else
-				m_player->setPosition(0);
-		}
-
-		void Player::jump(const QModelIndex &index) {
-			if (index.isValid()) {
-				m_playlist->setCurrentIndex(index.row());
-				m_player->play();
-			}
-		}
-
-		void Player::playlistPositionChanged(int currentItem) {
-			//
-		}
-
 		void Player::seek(int seconds) {
 			m_player->setPosition(seconds * 1000);
 		}
@@ -279,26 +245,61 @@ namespace openmittsu {
 			//
 		}
 
-		void Player::play(QByteArray const& mp4Data) {
-			if (m_tempFile.open()) {
-				{
-					LOGGER_DEBUG("Player: Temporary filename for audio/video data is {}", m_tempFile.fileName().toStdString());
-					QFile file(m_tempFile.fileName());
-					if (!file.open(QFile::WriteOnly)) {
-						throw;
-					}
-					file.write(mp4Data);
-					file.close();
-				}
+		void Player::play(std::unique_ptr<QIODevice>&& mediaDevice) {
+			if (mediaDevice == nullptr) {
+				throw openmittsu::exceptions::InternalErrorException() << "Player can not play without a media device.";
+			}
 
-				QList<QUrl> urls;
-				QUrl url = QUrl::fromLocalFile(m_tempFile.fileName());
-				urls.append(url);
+			// The URL is never opened, it only tells the backend what kind of data the stream holds.
+			// The previous device is released only after the player switched to the new one, as it may still be reading from it.
+			m_isStreaming = true;
+			m_player->setMedia(QMediaContent(QUrl(QStringLiteral("openmittsu-media.mp4"))), mediaDevice.get());
+			m_mediaDevice = std::move(mediaDevice);
 
-				this->addToPlaylist(urls);
+			// Some backends reject streams right away, others only report it once they tried to load the media.
+			if ((m_player->error() != QMediaPlayer::NoError) || (m_player->mediaStatus() == QMediaPlayer::InvalidMedia)) {
+				fallBackIfStreamFailed();
 			}
 		}
 
+		bool Player::hasMedia() const {
+			return m_mediaDevice != nullptr;
+		}
+
+		bool Player::fallBackIfStreamFailed() {
+			if (!m_isStreaming || (m_mediaDevice == nullptr)) {
+				return false;
+			}
+
+			// Switching the media from within a signal of the player is not safe, so this is deferred.
+			m_isStreaming = false;
+			QMetaObject::invokeMethod(this, "playFromTemporaryFile", Qt::QueuedConnection);
+			return true;
+		}
+
+		void Player::playFromTemporaryFile() {
+			// Other media arrived in the meantime.
+			if (m_isStreaming || (m_mediaDevice == nullptr)) {
+				return;
+			}
+			LOGGER()->warn("The media backend can not play from a stream ({}), falling back to a temporary file.", m_player->errorString().toStdString());
+
+			if (!m_mediaDevice->seek(0)) {
+				LOGGER()->warn("Could not rewind the media device for playback from a temporary file.");
+				displayErrorMessage();
+				return;
+			}
+			QByteArray const mediaData = m_mediaDevice->readAll();
+
+			if (!m_tempFile.open() || !m_tempFile.resize(0) || (m_tempFile.write(mediaData) != mediaData.size()) || !m_tempFile.flush()) {
+				LOGGER()->warn("Could not write the media to temporary file {}.", m_tempFile.fileName().toStdString());
+				displayErrorMessage();
+				return;
+			}
+
+			m_player->setMedia(QUrl::fromLocalFile(m_tempFile.fileName()));
+		}
+
 		void Player::handleCursor(QMediaPlayer::MediaStatus status) {
 #ifndef QT_NO_CURSOR
 			if (status == QMediaPlayer::LoadingMedia ||
@@ -357,6 +358,9 @@ namespace openmittsu {
 		}
 
 		void Player::displayErrorMessage() {
+			if (fallBackIfStreamFailed()) {
+				return;
+			}
 			setStatusInfo(m_player->errorString());
 		}
 
@@ -53,18 +53,16 @@
 
 #include <QWidget>
 #include <QMediaPlayer>
-#include <QMediaPlaylist>
 
+#include <QIODevice>
 #include <QString>
 #include <QTemporaryFile>
 
 #include <memory>
 
 QT_BEGIN_NAMESPACE
-class QAbstractItemView;
 class QLabel;
 class QMediaPlayer;
-class QModelIndex;
 class QPushButton;
 class QSlider;
 class QVideoProbe;
@@ -79,8 +77,6 @@ namespace Ui {
 namespace openmittsu {
 	namespace widgets {
 
-		class PlaylistModel;
-
 		class Player : public QWidget {
 			Q_OBJECT
 		public:
@@ -89,8 +85,9 @@ namespace openmittsu {
 
 			bool isPlayerAvailable() const;
 
-			void play(QByteArray const& mp4Data);
-			void addToPlaylist(const QList<QUrl> &urls);
+			/** Plays MP4 data read from mediaDevice, which the player keeps until it gets other media. The data is only written to a temporary file if the media backend can not read from a stream. */
+			void play(std::unique_ptr<QIODevice>&& mediaDevice);
+			bool hasMedia() const;
 			void setCustomAudioRole(const QString &role);
 		signals:
 			void fullScreenChanged(bool fullScreen);
@@ -101,11 +98,7 @@ namespace openmittsu {
 			void positionChanged(qint64 progress);
 			void metaDataChanged();
 
-			void previousClicked();
-
 			void seek(int seconds);
-			void jump(const QModelIndex &index);
-			void playlistPositionChanged(int);
 
 			void statusChanged(QMediaPlayer::MediaStatus status);
 			void stateChanged(QMediaPlayer::State state);
@@ -113,7 +106,9 @@ namespace openmittsu {
 			void videoAvailableChanged(bool available);
 
 			void displayErrorMessage();
+			void playFromTemporaryFile();
 		private:
+			bool fallBackIfStreamFailed();
 			void setTrackInfo(const QString &info);
 			void setStatusInfo(const QString &info);
 			void handleCursor(QMediaPlayer::MediaStatus status);
@@ -123,18 +118,18 @@ namespace openmittsu {
 			bool m_useVideoWidget;
 
 			QMediaPlayer *m_player = nullptr;
-			QMediaPlaylist *m_playlist = nullptr;
 			QVideoWidget *m_videoWidget = nullptr;
 			QLabel *m_coverLabel = nullptr;
 			QSlider *m_slider = nullptr;
 			QLabel *m_labelDuration = nullptr;
 			QPushButton *m_fullScreenButton = nullptr;
 
-			PlaylistModel *m_playlistModel = nullptr;
 			QString m_trackInfo;
 			QString m_statusInfo;
 			qint64 m_duration;
 
+			std::unique_ptr<QIODevice> m_mediaDevice;
+			bool m_isStreaming;
 			QTemporaryFile m_tempFile;
 		};
 	}
@@ -1,101 +0,0 @@
-/****************************************************************************
-**
-** Copyright (C) 2017 The Qt Company Ltd.
-** Contact: https://www.qt.io/licensing/
-**
-** This file is part of the examples of the Qt Toolkit.
-**
-** $QT_BEGIN_LICENSE:BSD$
-** Commercial License Usage
-** Licensees holding valid commercial Qt licenses may use this file in
-** accordance with the commercial license agreement provided with the
-** Software or, alternatively, in accordance with the terms contained in
-** a written agreement between you and The Qt Company. For licensing terms
-** and conditions see https://www.qt.io/terms-conditions. For further
-** information use the contact form at https://www.qt.io/contact-us.
-**
-** BSD License Usage
-** Alternatively, you may use this file under the terms of the BSD license
-** as follows:
-**
-** "Redistribution and use in source and binary forms, with or without
-** modification, are permitted provided that the following conditions are
-** met:
-**   * Redistributions of source code must retain the above copyright
-**     notice, this list of conditions and the following disclaimer.
-**   * Redistributions in binary form must reproduce the above copyright
-**     notice, this list of conditions and the following disclaimer in
-**     the documentation and/or other materials provided with the
-**     distribution.
-**   * Neither the name of The Qt Company Ltd nor the names of its
-**     contributors may be used to endorse or promote products derived
-**     from this software without specific prior written permission.
-**
-**
-** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
-** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
-** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
-** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
-** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
-** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
-** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
-**
-** $QT_END_LICENSE$
-**
-****************************************************************************/
-
-#ifndef OPENMITTSU_WIDGETS_PLAYER_PLAYLISTMODEL_H_
-#define OPENMITTSU_WIDGETS_PLAYER_PLAYLISTMODEL_H_
-
-#include <QAbstractItemModel>
-#include <QScopedPointer>
-
-QT_BEGIN_NAMESPACE
-class QMediaPlaylist;
-QT_END_NAMESPACE
-
-namespace openmittsu {
-	namespace widgets {
-
-		class PlaylistModel : public QAbstractItemModel {
-			Q_OBJECT
-		public:
-			enum Column {
-				Title = 0,
-				ColumnCount
-			};
-
-			explicit PlaylistModel(QObject* parent = nullptr);
-			virtual ~PlaylistModel();
-
-			int rowCount(const QModelIndex &parent = QModelIndex()) const override;
-			int columnCount(const QModelIndex &parent = QModelIndex()) const override;
-
-			QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
-			QModelIndex parent(const QModelIndex &child) const override;
-
-			QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
-
-			QMediaPlaylist *playlist() const;
-			void setPlaylist(QMediaPlaylist *playlist);
-
-			bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::DisplayRole) override;
-		private slots:
-			void beginInsertItems(int start, int end);
-			void endInsertItems();
-			void beginRemoveItems(int start, int end);
-			void endRemoveItems();
-			void changeItems(int start, int end);
-
-		private:
-			QScopedPointer<QMediaPlaylist> m_playlist;
-			QMap<QModelIndex, QVariant> m_data;
-		};
-	}
-}
-
-#endif // OPENMITTSU_WIDGETS_PLAYER_PLAYLISTMODEL_H_
@@ -1,6 +1,10 @@
 #include "src/wizards/LoadBackupWizardPageSaveDatabase.h"
 #include "ui_LoadBackupWizardPageSaveDatabase.h"
 
+#include "src/backup/BackupReader.h"
+#include "src/backup/IdentityBackup.h"
+#include "src/backup/IdentityBackupObject.h"
+#include "src/database/SimpleDatabase.h"
 #include "src/exceptions/IllegalArgumentException.h"
 #include "src/exceptions/InternalErrorException.h"
 #include "src/utility/MakeUnique.h"
@@ -26,6 +30,7 @@ namespace openmittsu {
 
 			registerField("edtSaveDatabaseLocation*", m_ui->edtSaveDatabaseLocation);
 			registerField("edtSaveDatabasePassword*", m_ui->edtSaveDatabasePassword);
+			registerField("chkMergeIntoDatabase", m_ui->chkMergeIntoDatabase);
 		}
 
 		LoadBackupWizardPageSaveDatabase::~LoadBackupWizardPageSaveDatabase() {
@@ -42,12 +47,50 @@ namespace openmittsu {
 
 		void LoadBackupWizardPageSaveDatabase::initializePage() {
 			m_ui->edtSaveDatabaseLocation->setText("");
+
+			// Only the contents of a data backup can be merged into an existing database.
+			m_ui->chkMergeIntoDatabase->setChecked(false);
+			m_ui->chkMergeIntoDatabase->setVisible(isImportingDataBackup());
+		}
+
+		bool LoadBackupWizardPageSaveDatabase::isImportingDataBackup() const {
+			return nextId() == LoadBackupWizard::Pages::PAGE_DATABASE_SAVE_IN_PROGRESS;
 		}
 
 		bool LoadBackupWizardPageSaveDatabase::isComplete() const {
 			return !m_ui->edtSaveDatabaseLocation->text().isEmpty();
 		}
 
+		bool LoadBackupWizardPageSaveDatabase::validatePage() {
+			QDir const folder(m_ui->edtSaveDatabaseLocation->text());
+			QString const databaseFileName = folder.absoluteFilePath(openmittsu::database::SimpleDatabase::getDefaultDatabaseFileName());
+			if (!QFile::exists(databaseFileName)) {
+				return true;
+			} else if (!isImportingDataBackup()) {
+				QMessageBox::warning(this, tr("Invalid database storage location"), tr("The selected folder already contains a database. Please select an empty folder!"));
+				return false;
+			}
+
+			// The database is only read here, the import checks it again before writing to it.
+			QString problem;
+			try {
+				QDir const backupLocation(field("edtDataBackupLocation").toString());
+				QString const identityBackupString = openmittsu::backup::IdentityBackupObject::fromFile(backupLocation).getBackupString();
+				openmittsu::backup::IdentityBackup const identityBackup = openmittsu::backup::IdentityBackup::fromBackupString(identityBackupString, field("edtDataBackupPassword").toString());
+				problem = openmittsu::backup::BackupReader::checkExistingDatabase(databaseFileName, field("edtSaveDatabasePassword").toString(), backupLocation, identityBackup.getClientContactId(), field("chkMergeIntoDatabase").toBool());
+			} catch (openmittsu::exceptions::BaseException& be) {
+				problem = tr("The database in the selected folder could not be read. Is the password correct?\nProblem: %1").arg(be.what());
+			} catch (...) {
+				problem = tr("The database in the selected folder could not be read. Is the password correct?");
+			}
+
+			if (!problem.isEmpty()) {
+				QMessageBox::warning(this, tr("Invalid database storage location"), problem);
+				return false;
+			}
+			return true;
+		}
+
 		void LoadBackupWizardPageSaveDatabase::btnPickSaveOnClick() {
 			QString const folderName = QFileDialog::getExistingDirectory(this, tr("Database storage location"));
 			if (folderName.isEmpty() || folderName.isNull()) {
@@ -55,12 +98,15 @@ namespace openmittsu {
 			} else {
 				QDir folder(folderName);
 #if defined(QT_VERSION) && (QT_VERSION >= QT_VERSION_CHECK(5, 9, 0))
-				if (!folder.exists() || !folder.isEmpty()) {
+				bool const isEmpty = folder.isEmpty();
 #else
-				if (!folder.exists() || folder.entryList(QDir::NoDotAndDotDot).size() > 0) {
+				bool const isEmpty = folder.entryList(QDir::NoDotAndDotDot).size() == 0;
 #endif
+				// A folder holding a database is accepted to resume an interrupted import or to merge a newer data backup, validatePage() checks which applies.
+				bool const holdsDatabase = isImportingDataBackup() && folder.exists(openmittsu::database::SimpleDatabase::getDefaultDatabaseFileName());
+				if (!folder.exists() || (!isEmpty && !holdsDatabase)) {
 					m_ui->edtSaveDatabaseLocation->setText("");
-					QMessageBox::warning(this, tr("Invalid database storage location"), tr("Please select an existing and empty folder!"));
+					QMessageBox::warning(this, tr("Invalid database storage location"), tr("Please select an existing and empty folder, or the folder of an existing database!"));
 				} else {
 					m_ui->edtSaveDatabaseLocation->setText(folderName);
 
@@ -22,11 +22,14 @@ namespace openmittsu {
 
 			virtual void initializePage() override;
 			virtual bool isComplete() const override;
+			virtual bool validatePage() override;
 			virtual int nextId() const override;
 		public slots:
 			void btnPickSaveOnClick();
 		private:
 			std::unique_ptr<Ui::LoadBackupWizardPageSaveDatabase> const m_ui;
+			/** Only the import of a data backup can resume in or merge into an existing database. */
+			bool isImportingDataBackup() const;
 			LoadBackupWizard const& m_loadBackupWizard;
 
 			std::unique_ptr<QRegularExpressionValidator> m_fileNameValidator;
@@ -32,6 +32,7 @@ namespace openmittsu {
 		void LoadBackupWizardPageSaveDatabaseInProgress::initializePage() {
 			QString const databaseLocationString = field("edtSaveDatabaseLocation").toString();
 			QString const databasePassword = field("edtSaveDatabasePassword").toString();
+			bool const mergeIntoDatabase = field("chkMergeIntoDatabase").toBool();
 			QDir databaseLocation(databaseLocationString);
 
 			QString const backupLocationString = field("edtDataBackupLocation").toString();
@@ -44,7 +45,7 @@ namespace openmittsu {
 			}
 
 			m_databaseFileName = databaseLocation.absoluteFilePath(openmittsu::database::SimpleDatabase::getDefaultDatabaseFileName());
-			m_backupReader = std::make_unique<openmittsu::backup::BackupReader>(backupLocation, backupPassword, m_databaseFileName, databaseLocation, databasePassword);
+			m_backupReader = std::make_unique<openmittsu::backup::BackupReader>(backupLocation, backupPassword, m_databaseFileName, databaseLocation, databasePassword, mergeIntoDatabase);
 			OPENMITTSU_CONNECT_QUEUED(m_backupReader.get(), progressUpdated(int), this, onProgressUpdated(int));
 			OPENMITTSU_CONNECT_QUEUED(m_backupReader.get(), finished(bool, QString const&), this, onFinished(bool, QString const&));
 
@@ -0,0 +1,177 @@
+#include "DatabaseTestFramework.h"
+#include "SyntheticBackup.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <algorithm>
+
+#include "src/backup/BackupExporter.h"
+#include "src/backup/BackupImporter.h"
+#include "src/backup/ContactMediaItemBackupObject.h"
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/GroupMediaItemBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/backup/IdentityBackup.h"
+#include "src/backup/IdentityBackupObject.h"
+
+using openmittsu::test::SyntheticAccountGenerator;
+using openmittsu::test::dumpTable;
+using openmittsu::test::getSyntheticSettings;
+using openmittsu::test::readMediaItems;
+
+namespace {
+	QString const backupPassword = QStringLiteral("BackupPassword");
+
+	/** The names of all message and media files of a backup, sorted. */
+	QStringList listBackupFiles(QDir const& backupPath) {
+		QStringList result = openmittsu::backup::ContactMessageBackupObject::getContactMessageFiles(backupPath).values();
+		result.append(openmittsu::backup::GroupMessageBackupObject::getGroupMessageFiles(backupPath).values());
+		result.append(openmittsu::backup::ContactMediaItemBackupObject::getContactMediaFiles(backupPath).values());
+		result.append(openmittsu::backup::GroupMediaItemBackupObject::getGroupMediaFiles(backupPath).values());
+		result.sort();
+		return result;
+	}
+
+	QStringList dumpBackupTables(openmittsu::database::SimpleDatabase const& database) {
+		QStringList result;
+		result.append(dumpTable(database, QStringLiteral("contacts"), QStringLiteral("identity")));
+		result.append(dumpTable(database, QStringLiteral("groups"), QStringLiteral("id")));
+		result.append(dumpTable(database, QStringLiteral("contact_messages"), QStringLiteral("uid")));
+		result.append(dumpTable(database, QStringLiteral("group_messages"), QStringLiteral("uid")));
+		return result;
+	}
+}
+
+TEST_F(DatabaseTestFramework, backupExportRoundTrip) {
+	QTemporaryDir sourceDirectory;
+	ASSERT_TRUE(sourceDirectory.isValid());
+	QDir const sourcePath(sourceDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(3, 3, 500, 17, 3000), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(sourcePath, backupPassword));
+	SyntheticAccountGenerator::Statistics const& generated = generator.getStatistics();
+	QHash<QString, QByteArray> const mediaItems = readMediaItems(sourcePath);
+	{
+		openmittsu::backup::BackupImporter importer(*db, sourcePath);
+		ASSERT_NO_THROW(importer.run());
+	}
+	QStringList const expectedTables = dumpBackupTables(*db);
+	ASSERT_EQ(mediaItems.size(), db->getMediaItemCount());
+
+	// Small batches on three writers, so the files of the conversations are appended to many times.
+	QTemporaryDir exportDirectory;
+	ASSERT_TRUE(exportDirectory.isValid());
+	QDir const exportPath(exportDirectory.path());
+	openmittsu::backup::BackupExporter::Settings const settings = { 100, 64 * 1024, 1, 3 };
+	QList<int> progress;
+	{
+		openmittsu::backup::BackupExporter exporter(*db, exportPath, backupPassword, settings);
+		exporter.setProgressCallback([&progress](int percentComplete) {
+			progress.append(percentComplete);
+		});
+		ASSERT_NO_THROW(exporter.run());
+
+		openmittsu::backup::BackupExporter::Statistics const& statistics = exporter.getStatistics();
+		ASSERT_EQ(3, statistics.contacts);
+		ASSERT_EQ(3, statistics.groups);
+		ASSERT_EQ(3 * 500, statistics.contactMessages);
+		ASSERT_EQ(3 * 500, statistics.groupMessages);
+		ASSERT_EQ(generated.contactMediaItems, statistics.contactMediaItems);
+		ASSERT_EQ(generated.groupMediaItems, statistics.groupMediaItems);
+		ASSERT_EQ(17, statistics.contactMediaItems + statistics.groupMediaItems);
+		ASSERT_EQ(0, statistics.skippedMediaItems);
+	}
+	ASSERT_FALSE(progress.isEmpty());
+	ASSERT_TRUE(std::is_sorted(progress.constBegin(), progress.constEnd()));
+	ASSERT_EQ(100, progress.last());
+
+	ASSERT_EQ(listBackupFiles(sourcePath), listBackupFiles(exportPath));
+	openmittsu::backup::IdentityBackup const identityBackup = openmittsu::backup::IdentityBackup::fromBackupString(openmittsu::backup::IdentityBackupObject::fromFile(exportPath).getBackupString(), backupPassword);
+	ASSERT_EQ(selfContactId, identityBackup.getClientContactId());
+
+	// Importing the export into a fresh database has to yield the same rows.
+	db = nullptr;
+	ensureFileDoesNotExist(databaseFilename);
+	ASSERT_TRUE(tempMediaStorageLocation.removeRecursively());
+	ASSERT_TRUE(QDir::temp().mkpath(tempMediaStorageLocation.absolutePath()));
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, selfContactId, selfKeyPair, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	{
+		openmittsu::backup::BackupImporter importer(*db, exportPath);
+		ASSERT_NO_THROW(importer.run());
+	}
+
+	ASSERT_EQ(expectedTables, dumpBackupTables(*db));
+	ASSERT_EQ(mediaItems.size(), db->getMediaItemCount());
+	for (auto it = mediaItems.constBegin(); it != mediaItems.constEnd(); ++it) {
+		ASSERT_EQ(it.value(), db->getMediaItem(it.key(), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	}
+}
+
+TEST_F(DatabaseTestFramework, backupExportSkipsMissingMedia) {
+	QTemporaryDir sourceDirectory;
+	ASSERT_TRUE(sourceDirectory.isValid());
+	QDir const sourcePath(sourceDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(2, 0, 50, 6, 1000), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(sourcePath, backupPassword));
+	{
+		openmittsu::backup::BackupImporter importer(*db, sourcePath);
+		ASSERT_NO_THROW(importer.run());
+	}
+
+	// Media files lost from the storage are left out, the rest of the backup is still written.
+	for (QFileInfo const& fileInfo : findMediaFiles(QStringLiteral("encMedia_*"))) {
+		ASSERT_TRUE(QFile::remove(fileInfo.absoluteFilePath()));
+	}
+
+	QTemporaryDir exportDirectory;
+	ASSERT_TRUE(exportDirectory.isValid());
+	QDir const exportPath(exportDirectory.path());
+	openmittsu::backup::BackupExporter exporter(*db, exportPath, backupPassword);
+	ASSERT_NO_THROW(exporter.run());
+	ASSERT_EQ(2 * 50, exporter.getStatistics().contactMessages);
+	ASSERT_EQ(0, exporter.getStatistics().contactMediaItems);
+	ASSERT_EQ(6, exporter.getStatistics().skippedMediaItems);
+	ASSERT_TRUE(openmittsu::backup::ContactMediaItemBackupObject::getContactMediaFiles(exportPath).isEmpty());
+
+	// Files of an earlier backup would be mixed into a new one.
+	openmittsu::backup::BackupExporter secondExporter(*db, exportPath, backupPassword);
+	ASSERT_ANY_THROW(secondExporter.run());
+}
+
+TEST_F(DatabaseTestFramework, backupExportThroughDatabase) {
+	QTemporaryDir sourceDirectory;
+	ASSERT_TRUE(sourceDirectory.isValid());
+	QDir const sourcePath(sourceDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(2, 0, 50, 2, 1000), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(sourcePath, backupPassword));
+	{
+		openmittsu::backup::BackupImporter importer(*db, sourcePath);
+		ASSERT_NO_THROW(importer.run());
+	}
+
+	QList<int> progress;
+	QList<bool> results;
+	QObject::connect(db.get(), &openmittsu::database::Database::dataBackupExportProgressUpdated, [&progress](int percentComplete) {
+		progress.append(percentComplete);
+	});
+	QObject::connect(db.get(), &openmittsu::database::Database::dataBackupExportFinished, [&results](bool hadError, QString const&) {
+		results.append(hadError);
+	});
+
+	QTemporaryDir exportDirectory;
+	ASSERT_TRUE(exportDirectory.isValid());
+	QDir const exportPath(exportDirectory.path());
+	ASSERT_NO_THROW(db->exportDataBackup(exportPath.absolutePath(), backupPassword));
+	ASSERT_EQ(QList<bool>({ false }), results);
+	ASSERT_EQ(100, progress.last());
+	ASSERT_EQ(listBackupFiles(sourcePath), listBackupFiles(exportPath));
+
+	// Errors are reported by the signal, as they can not cross from the database thread to the caller.
+	ASSERT_NO_THROW(db->exportDataBackup(exportPath.absolutePath(), backupPassword));
+	ASSERT_EQ(QList<bool>({ false, true }), results);
+}
@@ -0,0 +1,445 @@
+#include "DatabaseTestFramework.h"
+#include "SyntheticBackup.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+#include "src/backup/BackupImporter.h"
+#include "src/backup/BackupReader.h"
+#include "src/backup/ContactBackupObject.h"
+#include "src/crypto/PublicKey.h"
+#include "src/exceptions/IllegalArgumentException.h"
+#include "src/protocol/ContactIdVerificationStatus.h"
+
+using openmittsu::test::SyntheticAccountGenerator;
+using openmittsu::test::appendContactMessages;
+using openmittsu::test::appendGroupMessages;
+using openmittsu::test::appendRecords;
+using openmittsu::test::createUuid;
+using openmittsu::test::dumpTable;
+using openmittsu::test::getSyntheticSettings;
+using openmittsu::test::getTotalSize;
+using openmittsu::test::readMediaItems;
+using openmittsu::test::writeMediaFile;
+
+namespace {
+	QString const backupPassword = QStringLiteral("BackupPassword");
+
+	void replaceInFile(QDir const& directory, QString const& fileName, QString const& before, QString const& after) {
+		QFile file(directory.filePath(fileName));
+		ASSERT_TRUE(file.open(QFile::ReadWrite));
+		QString content = QString::fromUtf8(file.readAll());
+		ASSERT_TRUE(content.contains(before));
+		content.replace(before, after);
+		ASSERT_TRUE(file.resize(0));
+		file.write(content.toUtf8());
+	}
+}
+
+TEST_F(DatabaseTestFramework, backupImportStreaming) {
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+
+	int const contactCount = 3;
+	int const messageCount = 4000;
+	int const mediaCount = 48;
+	int const mediaSize = 256 * 1024;
+	SyntheticAccountGenerator generator(getSyntheticSettings(contactCount, 0, messageCount, mediaCount, mediaSize), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+	QHash<QString, QByteArray> const mediaItems = readMediaItems(backupPath);
+	qint64 const mediaBytes = getTotalSize(mediaItems);
+
+	// The ceiling covers the batch being handed in, the queued batches and the batch being stored, each overshooting by at most one item of up to one and a half times the media size.
+	openmittsu::backup::BackupImporter::Settings const settings = { 1000, 1024 * 1024, 2, 4 };
+	qint64 const memoryCeiling = (settings.maxQueuedBatches + 2) * (settings.maxBatchBytes + mediaSize + mediaSize / 2);
+	ASSERT_LT(memoryCeiling, mediaBytes);
+
+	QList<int> progress;
+	openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+	importer.setProgressCallback([&progress](int percentComplete) {
+		progress.append(percentComplete);
+	});
+	ASSERT_NO_THROW(importer.run());
+
+	openmittsu::backup::BackupImporter::Statistics const& statistics = importer.getStatistics();
+	ASSERT_EQ(contactCount, statistics.contacts);
+	ASSERT_EQ(contactCount * messageCount, statistics.contactMessages);
+	ASSERT_EQ(mediaCount, statistics.contactMediaItems);
+	ASSERT_LT(mediaBytes, statistics.totalBytes);
+	ASSERT_LT(0, statistics.peakBatchBytes);
+	ASSERT_LE(statistics.peakBatchBytes, memoryCeiling);
+
+	ASSERT_EQ(contactCount * messageCount, db->getContactMessageCount());
+	ASSERT_EQ(mediaCount, db->getMediaItemCount());
+	for (auto it = mediaItems.constBegin(); it != mediaItems.constEnd(); ++it) {
+		ASSERT_EQ(it.value(), db->getMediaItem(it.key(), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	}
+
+	ASSERT_FALSE(progress.isEmpty());
+	ASSERT_TRUE(std::is_sorted(progress.constBegin(), progress.constEnd()));
+	ASSERT_EQ(100, progress.last());
+}
+
+TEST_F(DatabaseTestFramework, backupImportStreamingError) {
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(2, 0, 2000, 0, 1), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+
+	// A broken line fails the import once it is reached, without leaving the reader thread blocked on a full queue.
+	QFile file(backupPath.filePath(openmittsu::backup::ContactMessageBackupObject::getContactMessageFileName(generator.getContacts().at(1))));
+	ASSERT_TRUE(file.open(QFile::Append));
+	file.write("not a csv line\n");
+	file.close();
+
+	openmittsu::backup::BackupImporter::Settings const settings = { 100, 1024 * 1024, 1, 2 };
+	openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+	ASSERT_ANY_THROW(importer.run());
+}
+
+TEST_F(DatabaseTestFramework, backupImportParallelFiles) {
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(8, 0, 500, 0, 1), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+
+	// Small batches from eight files on four readers interleave, every message must still arrive exactly once.
+	openmittsu::backup::BackupImporter::Settings const settings = { 50, 1024 * 1024, 1, 4 };
+	openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+	ASSERT_NO_THROW(importer.run());
+	ASSERT_EQ(8 * 500, importer.getStatistics().contactMessages);
+	ASSERT_EQ(8 * 500, db->getContactMessageCount());
+
+	for (openmittsu::protocol::ContactId const& contact : generator.getContacts()) {
+		ASSERT_EQ(500, db->getContactData(contact, true).messageCount);
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests to compare one reader against one per core. OPENMITTSU_BENCHMARK_MESSAGE_COUNT overrides the default of 20000 messages per conversation.
+TEST_F(DatabaseTestFramework, DISABLED_backupImportScaling) {
+	int messageCount = 20000;
+	char const* const messageCountOverride = std::getenv("OPENMITTSU_BENCHMARK_MESSAGE_COUNT");
+	if (messageCountOverride != nullptr) {
+		messageCount = std::atoi(messageCountOverride);
+	}
+	ASSERT_LT(0, messageCount);
+
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+	int const contactCount = 2 * QThread::idealThreadCount();
+	SyntheticAccountGenerator generator(getSyntheticSettings(contactCount, 0, messageCount, 0, 1), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+
+	for (int maxParallelFiles : { 1, 0 }) {
+		db = nullptr;
+		ensureFileDoesNotExist(databaseFilename);
+		ASSERT_TRUE(tempMediaStorageLocation.removeRecursively());
+		ASSERT_TRUE(QDir::temp().mkpath(tempMediaStorageLocation.absolutePath()));
+		db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, selfContactId, selfKeyPair, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+
+		openmittsu::backup::BackupImporter::Settings settings = openmittsu::backup::BackupImporter::getDefaultSettings();
+		settings.maxParallelFiles = maxParallelFiles;
+		openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+
+		auto const start = std::chrono::steady_clock::now();
+		ASSERT_NO_THROW(importer.run());
+		std::chrono::duration<double> const time = std::chrono::steady_clock::now() - start;
+		ASSERT_EQ(contactCount * messageCount, importer.getStatistics().contactMessages);
+		std::cout << ((maxParallelFiles == 0) ? QThread::idealThreadCount() : maxParallelFiles) << " reader thread(s): " << time.count() << " s" << std::endl;
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests to measure the message insert rate. OPENMITTSU_BENCHMARK_MESSAGE_COUNT overrides the default of 5000000 messages in total.
+TEST_F(DatabaseTestFramework, DISABLED_backupImportBulkInsertThroughput) {
+	int messageCount = 5000000;
+	char const* const messageCountOverride = std::getenv("OPENMITTSU_BENCHMARK_MESSAGE_COUNT");
+	if (messageCountOverride != nullptr) {
+		messageCount = std::atoi(messageCountOverride);
+	}
+	ASSERT_LT(0, messageCount);
+
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+	int const contactCount = 50;
+	int const messagesPerContact = std::max(1, messageCount / contactCount);
+	SyntheticAccountGenerator generator(getSyntheticSettings(contactCount, 0, messagesPerContact, 0, 1), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+
+	// One reader, so the rate is that of the database thread storing the batches.
+	openmittsu::backup::BackupImporter::Settings settings = openmittsu::backup::BackupImporter::getDefaultSettings();
+	settings.maxParallelFiles = 1;
+	openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+
+	auto const start = std::chrono::steady_clock::now();
+	ASSERT_NO_THROW(importer.run());
+	std::chrono::duration<double> const time = std::chrono::steady_clock::now() - start;
+	ASSERT_EQ(contactCount * messagesPerContact, importer.getStatistics().contactMessages);
+	ASSERT_EQ(contactCount * messagesPerContact, db->getContactMessageCount());
+	std::cout << "Imported " << (contactCount * messagesPerContact) << " messages in " << time.count() << " s, " << ((contactCount * messagesPerContact) / time.count()) << " messages/s" << std::endl;
+}
+
+TEST_F(DatabaseTestFramework, backupImportManyMediaItems) {
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(1, 0, 1, 0, 1), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+
+	// Items of different sizes, every tenth one repeating the content of the one before, which has to end up in a single file.
+	int const mediaCount = 3000;
+	int distinctContents = 0;
+	QByteArray data;
+	for (int i = 0; i < mediaCount; ++i) {
+		if ((i % 10) != 9) {
+			data = QByteArray("Media item ").append(QByteArray::number(i)).append(QByteArray(100 + (i * 37) % 5000, static_cast<char>(i)));
+			++distinctContents;
+		}
+
+		QString const uuid = createUuid();
+		writeMediaFile(backupPath, openmittsu::backup::ContactMediaItemBackupObject::getContactMediaFileName(uuid), data);
+	}
+	QHash<QString, QByteArray> const mediaItems = readMediaItems(backupPath);
+	ASSERT_EQ(mediaCount, mediaItems.size());
+
+	openmittsu::backup::BackupImporter::Settings const settings = { 250, 1024 * 1024, 2, 0 };
+	openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+	ASSERT_NO_THROW(importer.run());
+	ASSERT_EQ(mediaCount, importer.getStatistics().contactMediaItems);
+	ASSERT_EQ(mediaCount, db->getMediaItemCount());
+
+	for (auto it = mediaItems.constBegin(); it != mediaItems.constEnd(); ++it) {
+		openmittsu::database::MediaFileItem const item = db->getMediaItem(it.key(), openmittsu::database::MediaFileType::TYPE_STANDARD);
+		ASSERT_TRUE(item.isAvailable());
+		ASSERT_EQ(it.value(), item.getData());
+	}
+
+	ASSERT_EQ(distinctContents, findMediaFiles(QStringLiteral("encMedia_3_*")).size());
+	ASSERT_TRUE(findMediaFiles(QStringLiteral("encMedia_tmp_*")).isEmpty());
+}
+
+TEST_F(DatabaseTestFramework, backupImportResumesAfterInterruption) {
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(4, 0, 1500, 30, 64 * 1024), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+	QHash<QString, QByteArray> const mediaItems = readMediaItems(backupPath);
+	openmittsu::backup::BackupImporter::Settings const settings = { 200, 512 * 1024, 1, 2 };
+
+	auto const reopenDatabase = [this](bool removeFiles) {
+		db = nullptr;
+		if (removeFiles) {
+			ensureFileDoesNotExist(databaseFilename);
+			ASSERT_TRUE(tempMediaStorageLocation.removeRecursively());
+			ASSERT_TRUE(QDir::temp().mkpath(tempMediaStorageLocation.absolutePath()));
+		}
+		db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, selfContactId, selfKeyPair, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	};
+
+	{
+		openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+		ASSERT_NO_THROW(importer.run());
+	}
+	QStringList const expectedContacts = dumpTable(*db, QStringLiteral("contacts"), QStringLiteral("identity"));
+	QStringList const expectedMessages = dumpTable(*db, QStringLiteral("contact_messages"), QStringLiteral("uid"));
+	ASSERT_EQ(4 * 1500, expectedMessages.size());
+	reopenDatabase(true);
+
+	// A kill is simulated by throwing from the progress callback, which runs right after a batch was committed. Every attempt dies at a random point until one gets through.
+	std::mt19937 random(4711);
+	std::uniform_int_distribution<int> crashPoints(1, 60);
+	int interruptions = 0;
+	bool isComplete = false;
+	for (int attempt = 0; (attempt < 25) && (!isComplete); ++attempt) {
+		int const crashPoint = crashPoints(random);
+		int calls = 0;
+		openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+		importer.setProgressCallback([&calls, crashPoint](int) {
+			if (++calls == crashPoint) {
+				throw std::runtime_error("Simulated crash");
+			}
+		});
+
+		try {
+			importer.run();
+			isComplete = true;
+		} catch (std::runtime_error&) {
+			++interruptions;
+			reopenDatabase(false);
+		}
+	}
+	if (!isComplete) {
+		openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+		ASSERT_NO_THROW(importer.run());
+	}
+	ASSERT_LT(0, interruptions);
+
+	ASSERT_EQ(expectedContacts, dumpTable(*db, QStringLiteral("contacts"), QStringLiteral("identity")));
+	ASSERT_EQ(expectedMessages, dumpTable(*db, QStringLiteral("contact_messages"), QStringLiteral("uid")));
+	ASSERT_TRUE(db->getBackupImportCheckpoints().isEmpty());
+
+	ASSERT_EQ(mediaItems.size(), db->getMediaItemCount());
+	for (auto it = mediaItems.constBegin(); it != mediaItems.constEnd(); ++it) {
+		ASSERT_EQ(it.value(), db->getMediaItem(it.key(), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	}
+}
+
+TEST_F(DatabaseTestFramework, backupImportResumesOnlyTheSameBackup) {
+	QTemporaryDir backupDirectory;
+	ASSERT_TRUE(backupDirectory.isValid());
+	QDir const backupPath(backupDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(2, 0, 100, 2, 1024), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(backupPath, backupPassword));
+	openmittsu::backup::BackupImporter::Settings const settings = { 50, 512 * 1024, 1, 1 };
+	QString const password(QStringLiteral("AAAAAAAA"));
+	openmittsu::protocol::ContactId const otherContactId(QStringLiteral("BBBBBBBB"));
+
+	// Without a journal, an existing database only takes a backup of its own identity to merge.
+	ASSERT_FALSE(openmittsu::backup::BackupReader::checkExistingDatabase(databaseFilename, password, backupPath, selfContactId, false).isEmpty());
+	ASSERT_TRUE(openmittsu::backup::BackupReader::checkExistingDatabase(databaseFilename, password, backupPath, selfContactId, true).isEmpty());
+	ASSERT_FALSE(openmittsu::backup::BackupReader::checkExistingDatabase(databaseFilename, password, backupPath, otherContactId, true).isEmpty());
+
+	// Interrupted right after the journal was started.
+	{
+		openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+		importer.setProgressCallback([](int) {
+			throw std::runtime_error("Simulated crash");
+		});
+		ASSERT_THROW(importer.run(), std::runtime_error);
+	}
+	ASSERT_FALSE(db->getBackupImportCheckpoints().isEmpty());
+
+	openmittsu::database::SimpleDatabase::BackupImportTarget const target = openmittsu::database::SimpleDatabase::probeBackupImportTarget(databaseFilename, password);
+	ASSERT_EQ(selfContactId, target.selfContact);
+	ASSERT_TRUE(target.hasPendingImport);
+	ASSERT_EQ(openmittsu::backup::BackupImporter::getFingerprint(backupPath, selfContactId), target.pendingImportFingerprint);
+	ASSERT_TRUE(openmittsu::backup::BackupReader::checkExistingDatabase(databaseFilename, password, backupPath, selfContactId, false).isEmpty());
+
+	// A changed backup does not continue the journal, neither does another identity.
+	appendContactMessages(backupPath, generator.getContacts().at(1), QStringLiteral("0000aaaa"), 1);
+	ASSERT_FALSE(openmittsu::backup::BackupReader::checkExistingDatabase(databaseFilename, password, backupPath, selfContactId, false).isEmpty());
+	ASSERT_FALSE(openmittsu::backup::BackupReader::checkExistingDatabase(databaseFilename, password, backupPath, selfContactId, true).isEmpty());
+	ASSERT_NE(openmittsu::backup::BackupImporter::getFingerprint(backupPath, selfContactId), openmittsu::backup::BackupImporter::getFingerprint(backupPath, otherContactId));
+	{
+		openmittsu::backup::BackupImporter importer(*db, backupPath, settings);
+		ASSERT_THROW(importer.run(), openmittsu::exceptions::IllegalArgumentException);
+	}
+	ASSERT_FALSE(db->getBackupImportCheckpoints().isEmpty());
+	ASSERT_EQ(1, db->getContactCount());
+}
+
+TEST_F(DatabaseTestFramework, backupMergeImportsOnlyNewData) {
+	QTemporaryDir olderDirectory;
+	QTemporaryDir newerDirectory;
+	ASSERT_TRUE(olderDirectory.isValid());
+	ASSERT_TRUE(newerDirectory.isValid());
+	QDir const olderPath(olderDirectory.path());
+	QDir const newerPath(newerDirectory.path());
+
+	SyntheticAccountGenerator generator(getSyntheticSettings(3, 2, 100, 6, 1024), selfContactId, selfKeyPair);
+	ASSERT_NO_THROW(generator.writeBackup(olderPath, backupPassword));
+	QList<openmittsu::protocol::ContactId> const& contacts = generator.getContacts();
+	QList<openmittsu::protocol::GroupId> const& groups = generator.getGroups();
+
+	// The newer backup repeats everything of the older one and adds to it.
+	for (QString const& fileName : olderPath.entryList(QDir::Files)) {
+		ASSERT_TRUE(QFile::copy(olderPath.filePath(fileName), newerPath.filePath(fileName)));
+	}
+	openmittsu::protocol::ContactId const newContact(QStringLiteral("NEWCONT1"));
+	appendContactMessages(newerPath, contacts.at(1), QStringLiteral("0000aaaa"), 25);
+	appendContactMessages(newerPath, newContact, QStringLiteral("0000bbbb"), 10);
+
+	// A message received by openMittsu itself is in the newer backup under another uuid, only its API id matches.
+	openmittsu::protocol::ContactId const localContact(contacts.at(2));
+	openmittsu::protocol::MessageId const localMessageId(QStringLiteral("0000cccc00000000"));
+	appendContactMessages(newerPath, localContact, QStringLiteral("0000cccc"), 1);
+
+	replaceInFile(newerPath, QStringLiteral("contacts.csv"), QStringLiteral("\"First1\""), QStringLiteral("\"Renamed\""));
+	openmittsu::backup::ContactBackupObject const newContactObject(newContact, openmittsu::crypto::PublicKey::fromHexString(QString(QByteArray(32, 4).toHex())), openmittsu::protocol::ContactIdVerificationStatus::VERIFICATION_STATUS_UNVERIFIED, QStringLiteral("New"), QStringLiteral("Contact"), QString(), 0);
+	appendRecords(newerPath, QStringLiteral("contacts.csv"), openmittsu::backup::ContactBackupObject::getBackupHeader(), { newContactObject.toBackupRecord() });
+
+	appendGroupMessages(newerPath, groups.at(0), contacts.at(1), QStringLiteral("0000dddd"), 5);
+	replaceInFile(newerPath, QStringLiteral("groups.csv"), QStringLiteral("\"Group 1\""), QStringLiteral("\"Renamed group\""));
+
+	writeMediaFile(newerPath, openmittsu::backup::ContactMediaItemBackupObject::getContactMediaFileName(createUuid()), QByteArray(2048, 'm'));
+
+	{
+		openmittsu::backup::BackupImporter importer(*db, olderPath);
+		ASSERT_NO_THROW(importer.run());
+	}
+	ASSERT_NO_THROW(db->storeSentContactMessageText(localContact, openmittsu::protocol::MessageTime::fromDatabase(1700000000000LL), false, QStringLiteral("Only stored locally")));
+	ASSERT_NO_THROW(db->storeReceivedContactMessageText(localContact, localMessageId, openmittsu::protocol::MessageTime::fromDatabase(1600000000000LL), openmittsu::protocol::MessageTime::fromDatabase(1600000000001LL), QStringLiteral("Received twice")));
+	ASSERT_EQ(3 * 100 + 2, db->getContactMessageCount());
+	ASSERT_EQ(2 * 100, db->getGroupMessageCount());
+
+	openmittsu::backup::BackupImporter::Settings settings = openmittsu::backup::BackupImporter::getDefaultSettings();
+	settings.maxBatchItems = 100;
+	settings.mergeIntoExisting = true;
+	{
+		openmittsu::backup::BackupImporter importer(*db, newerPath, settings);
+		ASSERT_NO_THROW(importer.run());
+
+		openmittsu::backup::BackupImporter::Statistics const& statistics = importer.getStatistics();
+		ASSERT_EQ(25 + 10, statistics.contactMessages);
+		ASSERT_EQ(5, statistics.groupMessages);
+		ASSERT_EQ(3 * 100 + 1 + 2 * 100, statistics.skippedMessages);
+		ASSERT_EQ(1, statistics.contactMediaItems);
+		ASSERT_EQ(0, statistics.groupMediaItems);
+		ASSERT_EQ(6, statistics.skippedMediaItems);
+		ASSERT_EQ(1, statistics.updatedContacts);
+		ASSERT_EQ(1, statistics.updatedGroups);
+	}
+
+	// Everything stored before is still there, including what only openMittsu knew.
+	ASSERT_EQ(3 * 100 + 2 + 25 + 10, db->getContactMessageCount());
+	ASSERT_EQ(2 * 100 + 5, db->getGroupMessageCount());
+	ASSERT_EQ(100 + 2, db->getContactData(localContact, true).messageCount);
+	ASSERT_EQ(100 + 25, db->getContactData(contacts.at(1), true).messageCount);
+	ASSERT_EQ(10, db->getContactData(newContact, true).messageCount);
+	ASSERT_EQ(QStringLiteral("Renamed"), db->getContactData(contacts.at(1), false).firstName);
+	ASSERT_EQ(QStringLiteral("Renamed group"), db->getGroupData(groups.at(1), false).title);
+
+	QHash<QString, QByteArray> const mediaItems = readMediaItems(newerPath);
+	ASSERT_EQ(6 + 1, mediaItems.size());
+	ASSERT_EQ(mediaItems.size(), db->getMediaItemCount());
+	for (auto it = mediaItems.constBegin(); it != mediaItems.constEnd(); ++it) {
+		ASSERT_EQ(it.value(), db->getMediaItem(it.key(), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	}
+
+	// Merging the same backup again finds nothing to do.
+	QStringList const expectedMessages = dumpTable(*db, QStringLiteral("contact_messages"), QStringLiteral("uid"));
+	QStringList const expectedGroupMessages = dumpTable(*db, QStringLiteral("group_messages"), QStringLiteral("uid"));
+	QStringList const expectedContacts = dumpTable(*db, QStringLiteral("contacts"), QStringLiteral("identity"));
+	{
+		openmittsu::backup::BackupImporter importer(*db, newerPath, settings);
+		ASSERT_NO_THROW(importer.run());
+
+		openmittsu::backup::BackupImporter::Statistics const& statistics = importer.getStatistics();
+		ASSERT_EQ(0, statistics.contactMessages + statistics.groupMessages + statistics.contactMediaItems + statistics.groupMediaItems);
+		ASSERT_EQ(0, statistics.updatedContacts + statistics.updatedGroups);
+		ASSERT_EQ(3 * 100 + 1 + 25 + 10 + 2 * 100 + 5, statistics.skippedMessages);
+	}
+	ASSERT_EQ(expectedMessages, dumpTable(*db, QStringLiteral("contact_messages"), QStringLiteral("uid")));
+	ASSERT_EQ(expectedGroupMessages, dumpTable(*db, QStringLiteral("group_messages"), QStringLiteral("uid")));
+	ASSERT_EQ(expectedContacts, dumpTable(*db, QStringLiteral("contacts"), QStringLiteral("identity")));
+}
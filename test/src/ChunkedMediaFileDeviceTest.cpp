@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QTemporaryDir>
+
+#include <memory>
+
+#include "src/database/internal/ChunkedMediaFileDevice.h"
+#include "src/database/internal/ChunkedMediaFileFormat.h"
+#include "src/database/internal/ChunkedMediaFileReader.h"
+#include "src/database/internal/ChunkedMediaFileWriter.h"
+#include "src/utility/MakeUnique.h"
+
+using openmittsu::database::internal::ChunkedMediaFileDevice;
+using openmittsu::database::internal::ChunkedMediaFileFormat;
+using openmittsu::database::internal::ChunkedMediaFileReader;
+using openmittsu::database::internal::ChunkedMediaFileWriter;
+
+namespace {
+	int const chunkSize = 1000;
+
+	QByteArray generateData(int size) {
+		QByteArray result(size, '\0');
+		for (int i = 0; i < size; ++i) {
+			result[i] = static_cast<char>((i * 31) % 251);
+		}
+		return result;
+	}
+
+	class ChunkedMediaFileDeviceTest : public ::testing::Test {
+	protected:
+		ChunkedMediaFileDeviceTest() : data(generateData(3500)), key(ChunkedMediaFileFormat::getKeySize(), 'k'), nonce(ChunkedMediaFileFormat::getNonceSize(), 'n') {
+			//
+		}
+
+		virtual void SetUp() override {
+			ASSERT_TRUE(tempDir.isValid());
+			fileName = tempDir.filePath(QStringLiteral("media"));
+
+			ChunkedMediaFileWriter writer(fileName, key, nonce, chunkSize);
+			writer.open();
+			writer.write(data);
+			writer.finish();
+		}
+
+		std::unique_ptr<ChunkedMediaFileDevice> openDevice() {
+			std::unique_ptr<ChunkedMediaFileReader> reader = std::make_unique<ChunkedMediaFileReader>(fileName, key, nonce);
+			if (!reader->open()) {
+				return nullptr;
+			}
+			return std::make_unique<ChunkedMediaFileDevice>(std::move(reader));
+		}
+
+		QTemporaryDir tempDir;
+		QString fileName;
+		QByteArray const data;
+		QByteArray const key;
+		QByteArray const nonce;
+	};
+}
+
+TEST_F(ChunkedMediaFileDeviceTest, SeekAcrossChunkBoundaries) {
+	std::unique_ptr<ChunkedMediaFileDevice> device = openDevice();
+	ASSERT_TRUE(device != nullptr);
+	ASSERT_TRUE(device->isOpen());
+	ASSERT_FALSE(device->isSequential());
+	ASSERT_EQ(data.size(), device->size());
+
+	// Reads spanning one and two chunk boundaries, then jumping backwards into an earlier chunk.
+	ASSERT_TRUE(device->seek(990));
+	ASSERT_EQ(data.mid(990, 20), device->read(20));
+	ASSERT_EQ(1010, device->pos());
+	ASSERT_TRUE(device->seek(1999));
+	ASSERT_EQ(data.mid(1999, 1002), device->read(1002));
+	ASSERT_TRUE(device->seek(5));
+	ASSERT_EQ(data.mid(5, 10), device->read(10));
+
+	// Reads stop at the end of the last, partial chunk.
+	ASSERT_TRUE(device->seek(3400));
+	ASSERT_EQ(data.mid(3400), device->read(1000));
+	ASSERT_TRUE(device->atEnd());
+	ASSERT_TRUE(device->read(10).isEmpty());
+
+	ASSERT_TRUE(device->seek(0));
+	ASSERT_EQ(data, device->readAll());
+
+	ASSERT_EQ(-1, device->write(QByteArray("x")));
+}
+
+TEST_F(ChunkedMediaFileDeviceTest, DamagedChunkFailsRead) {
+	{
+		QFile file(fileName);
+		ASSERT_TRUE(file.open(QFile::ReadWrite));
+		qint64 const secondChunkOffset = ChunkedMediaFileFormat::getHeaderSize() + chunkSize + ChunkedMediaFileFormat::getTagSize();
+		ASSERT_TRUE(file.seek(secondChunkOffset + 10));
+		char byte = 0;
+		ASSERT_TRUE(file.getChar(&byte));
+		ASSERT_TRUE(file.seek(secondChunkOffset + 10));
+		ASSERT_TRUE(file.putChar(byte ^ 0x01));
+	}
+
+	std::unique_ptr<ChunkedMediaFileDevice> device = openDevice();
+	ASSERT_TRUE(device != nullptr);
+
+	// Only the damaged chunk is affected, the ones around it still read fine.
+	ASSERT_TRUE(device->seek(100));
+	ASSERT_EQ(data.mid(100, 100), device->read(100));
+	ASSERT_TRUE(device->seek(990));
+	char buffer[20];
+	ASSERT_EQ(-1, device->read(buffer, sizeof(buffer)));
+	ASSERT_FALSE(device->errorString().isEmpty());
+	ASSERT_TRUE(device->seek(2500));
+	ASSERT_EQ(data.mid(2500, 100), device->read(100));
+}
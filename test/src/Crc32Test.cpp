@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+
+#include <QByteArray>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "src/crypto/Crc32.h"
+
+namespace {
+	std::vector<openmittsu::crypto::Crc32::Implementation> const allImplementations = { openmittsu::crypto::Crc32::Implementation::BYTEWISE, openmittsu::crypto::Crc32::Implementation::SLICING_BY_8, openmittsu::crypto::Crc32::Implementation::PCLMUL, openmittsu::crypto::Crc32::Implementation::ARMV8 };
+
+	uint32_t referenceCrc32(uint32_t crc, char const* data, size_t len) {
+		crc = ~crc;
+		for (size_t i = 0; i < len; ++i) {
+			crc ^= static_cast<unsigned char>(data[i]);
+			for (int bit = 0; bit < 8; ++bit) {
+				crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+			}
+		}
+		return ~crc;
+	}
+}
+
+TEST(Crc32Test, KnownValues) {
+	ASSERT_EQ(0u, openmittsu::crypto::Crc32::checksum(QByteArray()));
+	ASSERT_EQ(0xCBF43926u, openmittsu::crypto::Crc32::checksum(QByteArray("123456789")));
+	ASSERT_EQ(0x414FA339u, openmittsu::crypto::Crc32::checksum(QByteArray("The quick brown fox jumps over the lazy dog")));
+	ASSERT_TRUE(openmittsu::crypto::Crc32::isAvailable(openmittsu::crypto::Crc32::getSelectedImplementation()));
+}
+
+TEST(Crc32Test, ImplementationsAreEquivalent) {
+	std::mt19937 generator(0x4d3c2b1a);
+	std::vector<char> data(70000);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<char>(generator());
+	}
+
+	// Short inputs cover the tails, long ones the folding loops. Offsets make the start unaligned.
+	for (int round = 0; round < 2000; ++round) {
+		size_t const offset = generator() % 64;
+		size_t const length = generator() % ((round < 1000) ? 300 : (data.size() - 64));
+		uint32_t const initial = (round % 2 == 0) ? 0 : static_cast<uint32_t>(generator());
+		uint32_t const expected = referenceCrc32(initial, data.data() + offset, length);
+
+		for (auto it = allImplementations.cbegin(); it != allImplementations.cend(); ++it) {
+			if (!openmittsu::crypto::Crc32::isAvailable(*it)) {
+				continue;
+			}
+			ASSERT_EQ(expected, openmittsu::crypto::Crc32::update(*it, initial, data.data() + offset, length)) << "Implementation " << static_cast<int>(*it) << ", offset " << offset << ", length " << length;
+		}
+		ASSERT_EQ(expected, openmittsu::crypto::Crc32::update(initial, data.data() + offset, length));
+	}
+
+	// Chained updates equal a single pass.
+	uint32_t const whole = openmittsu::crypto::Crc32::update(0, data.data(), data.size());
+	uint32_t chained = openmittsu::crypto::Crc32::update(0, data.data(), 1000);
+	chained = openmittsu::crypto::Crc32::update(chained, data.data() + 1000, 33);
+	chained = openmittsu::crypto::Crc32::update(chained, data.data() + 1033, data.size() - 1033);
+	ASSERT_EQ(whole, chained);
+}
+
+// Run with --gtest_also_run_disabled_tests to print the throughput of each implementation.
+TEST(Crc32Test, DISABLED_Throughput) {
+	std::vector<char> data(64 * 1024 * 1024, 'a');
+	for (auto it = allImplementations.cbegin(); it != allImplementations.cend(); ++it) {
+		if (!openmittsu::crypto::Crc32::isAvailable(*it)) {
+			continue;
+		}
+
+		auto const start = std::chrono::steady_clock::now();
+		uint32_t const checksum = openmittsu::crypto::Crc32::update(*it, 0, data.data(), data.size());
+		std::chrono::duration<double> const seconds = std::chrono::steady_clock::now() - start;
+		std::cout << "CRC32 implementation " << static_cast<int>(*it) << ": " << (64.0 / seconds.count()) << " MiB/s (checksum " << checksum << ")" << std::endl;
+	}
+}
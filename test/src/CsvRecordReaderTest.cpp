@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QTextStream>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "src/backup/CsvRecordReader.h"
+#include "src/backup/SimpleCsvLineSplitter.h"
+#include "src/exceptions/InsufficientInputException.h"
+#include "src/exceptions/InvalidInputException.h"
+
+namespace {
+	QList<QStringList> readAllRecords(QByteArray const& input, int bufferSize) {
+		QBuffer buffer;
+		buffer.setData(input);
+		buffer.open(QIODevice::ReadOnly);
+
+		openmittsu::backup::CsvRecordReader reader(&buffer, bufferSize);
+		QList<QStringList> result;
+		while (reader.readRecord()) {
+			result.append(reader.getColumns());
+		}
+		return result;
+	}
+
+	QByteArray generateMessagesFile(int messageCount, int linesPerBody) {
+		QByteArray result("\"uid\",\"body\",\"caption\"\n");
+		for (int i = 0; i < messageCount; ++i) {
+			QByteArray body;
+			for (int j = 0; j < linesPerBody; ++j) {
+				body.append("Line ").append(QByteArray::number(j)).append(" of message with \"\"quoted\"\" text\n");
+			}
+			result.append("\"").append(QByteArray::number(i)).append("\",\"").append(body).append("\",\"\"\n");
+		}
+		return result;
+	}
+}
+
+TEST(CsvRecordReaderTest, QuotedFields) {
+	QByteArray const input("\"a\",\"b\",\"\"\n\"some \"\"quoted\"\" text\",\"multi\nline\r\nfield\",\"\xC3\xA4\"\n");
+
+	// Tiny buffers make every quote, escape and line break straddle a refill.
+	for (int bufferSize : { 1, 2, 3, 7, 64 * 1024 }) {
+		QList<QStringList> const records = readAllRecords(input, bufferSize);
+		ASSERT_EQ(2, records.size());
+		ASSERT_EQ(QStringList({ QStringLiteral("a"), QStringLiteral("b"), QString() }), records.at(0));
+		ASSERT_EQ(QStringList({ QStringLiteral("some \"quoted\" text"), QStringLiteral("multi\nline\r\nfield"), QString::fromUtf8("\xC3\xA4") }), records.at(1));
+	}
+}
+
+TEST(CsvRecordReaderTest, LineEndings) {
+	// CRLF, a missing final line break, blank lines and a byte order mark.
+	QList<QStringList> const records = readAllRecords(QByteArray("\xEF\xBB\xBF\"a\"\r\n\r\n\n\"b\",\"c\"\r\n\"d\""), 2);
+	ASSERT_EQ(3, records.size());
+	ASSERT_EQ(QStringList({ QStringLiteral("a") }), records.at(0));
+	ASSERT_EQ(QStringList({ QStringLiteral("b"), QStringLiteral("c") }), records.at(1));
+	ASSERT_EQ(QStringList({ QStringLiteral("d") }), records.at(2));
+
+	ASSERT_TRUE(readAllRecords(QByteArray(), 16).isEmpty());
+	ASSERT_EQ(1, readAllRecords(QByteArray("\"a\"\r"), 16).size());
+}
+
+TEST(CsvRecordReaderTest, MalformedInput) {
+	ASSERT_THROW(readAllRecords(QByteArray("a,b\n"), 16), openmittsu::exceptions::InvalidInputExceptionImpl);
+	ASSERT_THROW(readAllRecords(QByteArray("\"a\"b\n"), 16), openmittsu::exceptions::InvalidInputExceptionImpl);
+	ASSERT_THROW(readAllRecords(QByteArray("\"a\",\n"), 16), openmittsu::exceptions::InvalidInputExceptionImpl);
+	ASSERT_THROW(readAllRecords(QByteArray("\"a\",\"unterminated\n"), 16), openmittsu::exceptions::InsufficientInputExceptionImpl);
+	ASSERT_THROW(readAllRecords(QByteArray("\"a\","), 16), openmittsu::exceptions::InsufficientInputExceptionImpl);
+}
+
+TEST(CsvRecordReaderTest, ResumeAtRecordEnd) {
+	QByteArray const input = generateMessagesFile(50, 3);
+	QList<QStringList> const expected = readAllRecords(input, 64 * 1024);
+
+	// Offsets taken with a tiny buffer, whose unread bytes are not part of the offset, are used by a fresh reader.
+	for (int resumeAfter : { 0, 1, 17, 50 }) {
+		QBuffer buffer;
+		buffer.setData(input);
+		buffer.open(QIODevice::ReadOnly);
+		qint64 offset = 0;
+		{
+			openmittsu::backup::CsvRecordReader reader(&buffer, 5);
+			for (int i = 0; i <= resumeAfter; ++i) {
+				ASSERT_TRUE(reader.readRecord());
+			}
+			offset = reader.getRecordEndOffset();
+		}
+
+		openmittsu::backup::CsvRecordReader reader(&buffer, 7);
+		ASSERT_TRUE(reader.seek(offset));
+		for (int i = resumeAfter + 1; i < expected.size(); ++i) {
+			ASSERT_TRUE(reader.readRecord());
+			ASSERT_EQ(expected.at(i), reader.getColumns());
+		}
+		ASSERT_FALSE(reader.readRecord());
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests to compare against the line based reader. OPENMITTSU_BENCHMARK_MESSAGE_COUNT overrides the default of 20000 messages.
+TEST(CsvRecordReaderTest, DISABLED_Throughput) {
+	int messageCount = 20000;
+	char const* const messageCountOverride = std::getenv("OPENMITTSU_BENCHMARK_MESSAGE_COUNT");
+	if (messageCountOverride != nullptr) {
+		messageCount = std::atoi(messageCountOverride);
+	}
+	ASSERT_LT(0, messageCount);
+
+	QTemporaryFile file;
+	ASSERT_TRUE(file.open());
+	QByteArray const content = generateMessagesFile(messageCount, 20);
+	ASSERT_EQ(content.size(), file.write(content));
+	ASSERT_TRUE(file.flush());
+	double const megabytes = content.size() / (1024.0 * 1024.0);
+
+	// The line based reader as used before: append lines until the splitter stops running out of input.
+	{
+		ASSERT_TRUE(file.seek(0));
+		QTextStream stream(&file);
+		stream.setCodec("UTF-8");
+		stream.readLine();
+
+		int records = 0;
+		auto const start = std::chrono::steady_clock::now();
+		while (!stream.atEnd()) {
+			QString line;
+			while (true) {
+				line.append(stream.readLine());
+				try {
+					openmittsu::backup::SimpleCsvLineSplitter::split(3, line);
+					break;
+				} catch (openmittsu::exceptions::InsufficientInputExceptionImpl&) {
+					line.append(QChar('\n'));
+				}
+			}
+			++records;
+		}
+		std::chrono::duration<double> const time = std::chrono::steady_clock::now() - start;
+		ASSERT_EQ(messageCount, records);
+		std::cout << "Line based reader: " << (megabytes / time.count()) << " MiB/s" << std::endl;
+	}
+
+	{
+		ASSERT_TRUE(file.seek(0));
+		openmittsu::backup::CsvRecordReader reader(&file);
+		ASSERT_TRUE(reader.readRecord());
+
+		int records = 0;
+		auto const start = std::chrono::steady_clock::now();
+		while (reader.readRecord()) {
+			openmittsu::backup::SimpleCsvLineSplitter const columns(reader.getColumns());
+			ASSERT_EQ(3, columns.getNumberOfColumns());
+			++records;
+		}
+		std::chrono::duration<double> const time = std::chrono::steady_clock::now() - start;
+		ASSERT_EQ(messageCount, records);
+		std::cout << "Record reader: " << (megabytes / time.count()) << " MiB/s" << std::endl;
+	}
+}
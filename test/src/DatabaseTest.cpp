@@ -1,10 +1,18 @@
 #include "gtest/gtest.h"
 
+#include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QString>
 #include <QSet>
+#include <QSqlQuery>
 #include <QList>
 #include <QVariant>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+
 #include "exceptions/InternalErrorException.h"
 #include "crypto/Crc32.h"
 
@@ -407,38 +415,40 @@ TEST_F(DatabaseTestFramework, groups) {
 
 	ASSERT_THROW(db->getGroupData(nonExistantGroupId, false), openmittsu::exceptions::InternalErrorExceptionImpl);
 	dataGroupA = db->getGroupData(groupA, false);
-	ASSERT_FALSE(dataGroupA.hasImage || dataGroupA.image.isAvailable());
+	ASSERT_FALSE(dataGroupA.hasImage || dataGroupA.image.get().isAvailable());
 	dataGroupB = db->getGroupData(groupB, false);
-	ASSERT_FALSE(dataGroupB.hasImage || dataGroupB.image.isAvailable());
+	ASSERT_FALSE(dataGroupB.hasImage || dataGroupB.image.get().isAvailable());
 	dataGroupC = db->getGroupData(groupC, false);
-	ASSERT_FALSE(dataGroupC.hasImage || dataGroupC.image.isAvailable());
+	ASSERT_FALSE(dataGroupC.hasImage || dataGroupC.image.get().isAvailable());
 	ASSERT_EQ(0, db->getMediaItemCount());
 
 	QByteArray const testDataA(QStringLiteral("testDataA").toUtf8());
 	openmittsu::protocol::MessageId const messageC = this->getFreeMessageId();
 	ASSERT_THROW(db->storeReceivedGroupSetImage(nonExistantGroupId, nonExistantContactId, messageC, openmittsu::protocol::MessageTime::fromDatabase(123), openmittsu::protocol::MessageTime::fromDatabase(456), testDataA), openmittsu::exceptions::InternalErrorExceptionImpl);
 	ASSERT_NO_THROW(db->storeReceivedGroupSetImage(groupC, contactIdD, messageC, openmittsu::protocol::MessageTime::fromDatabase(123), openmittsu::protocol::MessageTime::fromDatabase(456), testDataA));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
 
 	dataGroupA = db->getGroupData(groupA, false);
-	ASSERT_FALSE(dataGroupA.hasImage || dataGroupA.image.isAvailable());
+	ASSERT_FALSE(dataGroupA.hasImage || dataGroupA.image.get().isAvailable());
 	dataGroupB = db->getGroupData(groupB, false);
-	ASSERT_FALSE(dataGroupB.hasImage || dataGroupB.image.isAvailable());
+	ASSERT_FALSE(dataGroupB.hasImage || dataGroupB.image.get().isAvailable());
 	dataGroupC = db->getGroupData(groupC, false);
-	ASSERT_TRUE(dataGroupC.hasImage && dataGroupC.image.isAvailable());
-	ASSERT_EQ(testDataA, dataGroupC.image.getData());
+	ASSERT_TRUE(dataGroupC.hasImage && dataGroupC.image.get().isAvailable());
+	ASSERT_EQ(testDataA, dataGroupC.image.get().getData());
 	ASSERT_EQ(2, db->getMediaItemCount());
 
 	QByteArray const testDataB(QStringLiteral("longerTestDataB").toUtf8());
 	openmittsu::protocol::MessageId const messageD = this->getFreeMessageId();
 	ASSERT_NO_THROW(db->storeReceivedGroupSetImage(groupC, contactIdD, messageD, openmittsu::protocol::MessageTime::fromDatabase(789), openmittsu::protocol::MessageTime::fromDatabase(1011), testDataB));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
 
 	dataGroupA = db->getGroupData(groupA, false);
-	ASSERT_FALSE(dataGroupA.hasImage || dataGroupA.image.isAvailable());
+	ASSERT_FALSE(dataGroupA.hasImage || dataGroupA.image.get().isAvailable());
 	dataGroupB = db->getGroupData(groupB, false);
-	ASSERT_FALSE(dataGroupB.hasImage || dataGroupB.image.isAvailable());
+	ASSERT_FALSE(dataGroupB.hasImage || dataGroupB.image.get().isAvailable());
 	dataGroupC = db->getGroupData(groupC, false);
-	ASSERT_TRUE(dataGroupC.hasImage && dataGroupC.image.isAvailable());
-	ASSERT_EQ(testDataB, dataGroupC.image.getData());
+	ASSERT_TRUE(dataGroupC.hasImage && dataGroupC.image.get().isAvailable());
+	ASSERT_EQ(testDataB, dataGroupC.image.get().getData());
 	ASSERT_EQ(3, db->getMediaItemCount());
 }
 
@@ -871,3 +881,837 @@ TEST_F(DatabaseTestFramework, settings) {
 	ASSERT_EQ(optionValueB, optionValueAfterSaveB);
 	ASSERT_EQ(optionValueC, optionValueAfterSaveC);
 }
+
+TEST_F(DatabaseTestFramework, messageIdAllocation) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	openmittsu::crypto::KeyPair contactIdBKeyPair(openmittsu::crypto::KeyPair::randomKey());
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, contactIdBKeyPair));
+
+	openmittsu::protocol::GroupId groupA(selfContactId, 1);
+	ASSERT_NO_THROW(db->storeNewGroup(groupA, { contactIdB, selfContactId }, false));
+
+	QSet<openmittsu::protocol::MessageId> messageIds;
+	int const messageCount = 500;
+	for (int i = 0; i < messageCount; ++i) {
+		openmittsu::protocol::MessageTime const messageTime(openmittsu::protocol::MessageTime::fromDatabase(i));
+		openmittsu::protocol::MessageId messageId(0);
+		ASSERT_NO_THROW(messageId = db->storeSentContactMessageText(contactIdB, messageTime, true, QStringLiteral("TestMessage")));
+		ASSERT_FALSE(messageIds.contains(messageId));
+		messageIds.insert(messageId);
+
+		ASSERT_NO_THROW(messageId = db->storeSentGroupMessageText(groupA, messageTime, true, QStringLiteral("TestMessage")));
+		ASSERT_FALSE(messageIds.contains(messageId));
+		messageIds.insert(messageId);
+	}
+
+	// Reopening the database reserves a new epoch, IDs must not repeat.
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	for (int i = 0; i < messageCount; ++i) {
+		openmittsu::protocol::MessageTime const messageTime(openmittsu::protocol::MessageTime::fromDatabase(messageCount + i));
+		openmittsu::protocol::MessageId messageId(0);
+		ASSERT_NO_THROW(messageId = db->storeSentContactMessageText(contactIdB, messageTime, true, QStringLiteral("TestMessage")));
+		ASSERT_FALSE(messageIds.contains(messageId));
+		messageIds.insert(messageId);
+	}
+
+	ASSERT_EQ(3 * messageCount, messageIds.size());
+	ASSERT_EQ(2 * messageCount, db->getContactMessageCount());
+}
+
+TEST_F(DatabaseTestFramework, contactAndGroupCache) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	openmittsu::crypto::KeyPair contactIdBKeyPair(openmittsu::crypto::KeyPair::randomKey());
+	openmittsu::protocol::ContactId contactIdC(QStringLiteral("CCCCCCCC"));
+	openmittsu::crypto::KeyPair contactIdCKeyPair(openmittsu::crypto::KeyPair::randomKey());
+	openmittsu::protocol::ContactId nonExistantContactId(QStringLiteral("DDDDDDDD"));
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, contactIdBKeyPair));
+	ASSERT_NO_THROW(db->storeNewContact(contactIdC, contactIdCKeyPair));
+
+	openmittsu::protocol::GroupId groupA(selfContactId, 1);
+	openmittsu::protocol::GroupId groupB(contactIdB, 2);
+	openmittsu::protocol::GroupId nonExistantGroup(contactIdC, 3);
+	ASSERT_NO_THROW(db->storeNewGroup(groupA, { contactIdB, selfContactId }, false));
+	ASSERT_NO_THROW(db->storeNewGroup(groupB, { contactIdB, contactIdC, selfContactId }, false));
+
+	QString const newNickname(QStringLiteral("testNickName"));
+	ASSERT_NO_THROW(db->setContactNickName(contactIdB, newNickname));
+	ASSERT_NO_THROW(db->setContactFeatureLevel(contactIdC, openmittsu::protocol::FeatureLevel::LEVEL_3));
+	ASSERT_NO_THROW(db->setContactAccountStatusBatch({ { contactIdB, openmittsu::protocol::AccountStatus::STATUS_ACTIVE }, { contactIdC, openmittsu::protocol::AccountStatus::STATUS_INACTIVE } }));
+	ASSERT_NO_THROW(db->storeSentGroupSetTitle(groupA, openmittsu::protocol::MessageTime::now(), true, QStringLiteral("Group A"), true));
+
+	auto checkState = [&]() {
+		openmittsu::database::ContactToContactDataMap const contacts = db->getContactDataSnapshot({ contactIdB, contactIdC, nonExistantContactId }, false);
+		ASSERT_EQ(2, contacts.size());
+		ASSERT_EQ(newNickname, contacts.value(contactIdB).nickName);
+		ASSERT_EQ(openmittsu::protocol::AccountStatus::STATUS_ACTIVE, contacts.value(contactIdB).accountStatus);
+		ASSERT_EQ(openmittsu::protocol::FeatureLevel::LEVEL_3, contacts.value(contactIdC).featureLevel);
+		ASSERT_EQ(openmittsu::protocol::AccountStatus::STATUS_INACTIVE, contacts.value(contactIdC).accountStatus);
+		ASSERT_EQ(openmittsu::crypto::PublicKey(contactIdCKeyPair), contacts.value(contactIdC).publicKey);
+		ASSERT_FALSE(db->getContactsRequiringAccountStatusCheck(3600).contains(contactIdB));
+		ASSERT_TRUE(db->getContactsRequiringFeatureLevelCheck(3600).contains(contactIdB));
+
+		openmittsu::database::GroupToGroupDataMap const groups = db->getGroupDataSnapshot({ groupA, groupB, nonExistantGroup }, true);
+		ASSERT_EQ(2, groups.size());
+		ASSERT_EQ(QStringLiteral("Group A"), groups.value(groupA).title);
+		ASSERT_TRUE(groups.value(groupA).description.contains(newNickname));
+		ASSERT_EQ(3, groups.value(groupB).members.size());
+		ASSERT_EQ(2, db->getKnownGroupsContainingMember(contactIdB).size());
+		ASSERT_EQ(1, db->getKnownGroupsContainingMember(contactIdC).size());
+	};
+
+	checkState();
+
+	// Leaving a group has to be visible through the cache right away.
+	ASSERT_NO_THROW(db->storeSentGroupLeave(groupB, openmittsu::protocol::MessageTime::now(), true, true));
+	ASSERT_FALSE(db->hasGroup(groupB));
+	ASSERT_EQ(openmittsu::protocol::GroupStatus::DELETED, db->getGroupStatus(groupB));
+	ASSERT_EQ(0, db->getKnownGroupsContainingMember(contactIdC).size());
+
+	// A fresh instance starts with an empty cache and must see the same data.
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	ASSERT_FALSE(db->hasGroup(groupB));
+	ASSERT_EQ(3, db->getContactCount());
+	ASSERT_EQ(2, db->getGroupCount());
+	ASSERT_EQ(newNickname, db->getContactData(contactIdB, false).nickName);
+	ASSERT_EQ(QStringLiteral("Group A"), db->getGroupData(groupA, false).title);
+}
+
+TEST_F(DatabaseTestFramework, maintenance) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	openmittsu::crypto::KeyPair contactIdBKeyPair(openmittsu::crypto::KeyPair::randomKey());
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, contactIdBKeyPair));
+
+	QByteArray const imageData(QByteArray::fromHex("00112233445566778899aabbccddeeff"));
+	ASSERT_NO_THROW(db->storeSentContactMessageImage(contactIdB, openmittsu::protocol::MessageTime::now(), true, imageData, QStringLiteral("An image Caption")));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("orphanedMediaItem"), imageData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	ASSERT_EQ(2, db->getMediaItemCount());
+
+	// A media file without a database entry, and a file the media storage does not own.
+	QFile strayMediaFile(tempMediaStorageLocation.filePath(QStringLiteral("encMedia_1_1_strayMediaFile")));
+	ASSERT_TRUE(strayMediaFile.open(QFile::WriteOnly));
+	strayMediaFile.write(imageData);
+	strayMediaFile.close();
+	QFile unrelatedFile(tempMediaStorageLocation.filePath(QStringLiteral("unrelatedFile")));
+	ASSERT_TRUE(unrelatedFile.open(QFile::WriteOnly));
+	unrelatedFile.write(imageData);
+	unrelatedFile.close();
+	// The orphaned item holds the same data as the image message and shares its file.
+	ASSERT_EQ(2, findMediaFiles(QStringLiteral("encMedia_*")).size());
+
+	ASSERT_EQ(0, db->getMaintenanceStatistics().runsCompleted);
+	ASSERT_TRUE(db->runMaintenance());
+
+	ASSERT_EQ(1, db->getMediaItemCount());
+	ASSERT_EQ(1, findMediaFiles(QStringLiteral("encMedia_*")).size());
+	ASSERT_FALSE(strayMediaFile.exists());
+	ASSERT_TRUE(unrelatedFile.exists());
+
+	openmittsu::database::MaintenanceStatistics statistics = db->getMaintenanceStatistics();
+	ASSERT_EQ(1, statistics.runsCompleted);
+	ASSERT_EQ(1, statistics.mediaRowsRemoved);
+	ASSERT_EQ(1, statistics.mediaFilesRemoved);
+	ASSERT_LT(0, statistics.lastCompletedAt);
+
+	// Statistics are kept in the settings and survive a restart, a second run must not remove referenced media.
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	ASSERT_EQ(1, db->getMaintenanceStatistics().runsCompleted);
+	ASSERT_TRUE(db->runMaintenance());
+	statistics = db->getMaintenanceStatistics();
+	ASSERT_EQ(2, statistics.runsCompleted);
+	ASSERT_EQ(1, statistics.mediaRowsRemoved);
+	ASSERT_EQ(1, db->getMediaItemCount());
+}
+
+TEST_F(DatabaseTestFramework, maintenanceNeverRunsFullVacuum) {
+	ASSERT_TRUE(db->isIncrementalVacuumEnabled());
+
+	// A database from before incremental vacuuming is not rewritten by scheduled runs, only on request.
+	{
+		QSqlQuery query(db->getQueryObject());
+		ASSERT_TRUE(query.exec(QStringLiteral("PRAGMA auto_vacuum = NONE;")));
+		ASSERT_TRUE(query.exec(QStringLiteral("VACUUM;")));
+	}
+	ASSERT_FALSE(db->isIncrementalVacuumEnabled());
+	ASSERT_TRUE(db->runMaintenance());
+	ASSERT_FALSE(db->isIncrementalVacuumEnabled());
+
+	ASSERT_TRUE(db->enableIncrementalVacuum());
+	ASSERT_TRUE(db->isIncrementalVacuumEnabled());
+	ASSERT_TRUE(db->runMaintenance());
+}
+
+TEST_F(DatabaseTestFramework, archive) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	openmittsu::crypto::KeyPair contactIdBKeyPair(openmittsu::crypto::KeyPair::randomKey());
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, contactIdBKeyPair));
+
+	openmittsu::protocol::MessageId const oldTextMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageText(contactIdB, oldTextMessage, openmittsu::protocol::MessageTime::fromDatabase(1000), openmittsu::protocol::MessageTime::fromDatabase(1000), QStringLiteral("OldMessage")));
+	QByteArray const imageData(QByteArray::fromHex("00112233445566778899aabbccddeeff"));
+	openmittsu::protocol::MessageId const oldImageMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageImage(contactIdB, oldImageMessage, openmittsu::protocol::MessageTime::fromDatabase(2000), openmittsu::protocol::MessageTime::fromDatabase(2000), imageData, QStringLiteral("An image Caption")));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	openmittsu::protocol::MessageId const unsentMessage = db->storeSentContactMessageText(contactIdB, openmittsu::protocol::MessageTime::fromDatabase(3000), true, QStringLiteral("UnsentMessage"));
+	this->addMessageId(unsentMessage);
+	openmittsu::protocol::MessageId const newMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageText(contactIdB, newMessage, openmittsu::protocol::MessageTime::now(), openmittsu::protocol::MessageTime::now(), QStringLiteral("NewMessage")));
+	ASSERT_EQ(4, db->getContactMessageCount());
+	ASSERT_EQ(1, db->getMediaItemCount());
+
+	// The age is a user option, zero keeps all messages in the main database.
+	db->setOptions({ { QStringLiteral("options/messageArchive/ageDays"), QStringLiteral("0") } });
+	ASSERT_TRUE(db->runMaintenance());
+	ASSERT_EQ(0, db->getMaintenanceStatistics().messagesArchived);
+	ASSERT_FALSE(QFile::exists(openmittsu::database::internal::DatabaseArchive::getArchiveFileName(databaseFilename)));
+
+	db->setOptions({ { QStringLiteral("options/messageArchive/ageDays"), QStringLiteral("1") } });
+	ASSERT_TRUE(db->runMaintenance());
+	ASSERT_EQ(2, db->getMaintenanceStatistics().messagesArchived);
+	ASSERT_TRUE(QFile::exists(openmittsu::database::internal::DatabaseArchive::getArchiveFileName(databaseFilename)));
+
+	// Counts, media and cursors cover both tiers, and unsent messages stay in the main database.
+	ASSERT_EQ(4, db->getContactMessageCount());
+	ASSERT_EQ(1, db->getMediaItemCount());
+	{
+		openmittsu::database::internal::DatabaseContactMessageCursor cursor = db->getMessageCursor(contactIdB);
+		ASSERT_TRUE(cursor.seekToLast());
+		ASSERT_EQ(newMessage, cursor.getMessageId());
+		ASSERT_TRUE(cursor.previous());
+		ASSERT_EQ(unsentMessage, cursor.getMessageId());
+		ASSERT_TRUE(cursor.previous());
+		ASSERT_EQ(oldImageMessage, cursor.getMessageId());
+		std::shared_ptr<openmittsu::dataproviders::messages::ContactMessage> imageMessage = cursor.getMessage();
+		ASSERT_TRUE(imageMessage->getContentAsMediaFile().isAvailable());
+		ASSERT_EQ(imageMessage->getContentAsMediaFile().getData(), imageData);
+		ASSERT_TRUE(cursor.previous());
+		ASSERT_EQ(oldTextMessage, cursor.getMessageId());
+		ASSERT_EQ(cursor.getMessage()->getContentAsText(), QStringLiteral("OldMessage"));
+		ASSERT_FALSE(cursor.previous());
+
+		ASSERT_TRUE(cursor.seekToFirst());
+		ASSERT_EQ(oldTextMessage, cursor.getMessageId());
+		ASSERT_TRUE(cursor.next());
+		ASSERT_EQ(oldImageMessage, cursor.getMessageId());
+		ASSERT_TRUE(cursor.next());
+		ASSERT_EQ(unsentMessage, cursor.getMessageId());
+	}
+
+	// The archive is attached again on the next start, and deletions reach into it.
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	ASSERT_EQ(4, db->getContactMessageCount());
+	{
+		openmittsu::database::internal::DatabaseContactMessageCursor cursor = db->getMessageCursor(contactIdB);
+		ASSERT_TRUE(cursor.seek(oldImageMessage));
+		ASSERT_EQ(cursor.getMessage()->getContentAsMediaFile().getData(), imageData);
+	}
+
+	db->deleteContactMessagesByAge(contactIdB, true, openmittsu::protocol::MessageTime::fromDatabase(1500));
+	ASSERT_EQ(3, db->getContactMessageCount());
+	{
+		openmittsu::database::internal::DatabaseContactMessageCursor cursor = db->getMessageCursor(contactIdB);
+		ASSERT_FALSE(cursor.seek(oldTextMessage));
+		ASSERT_TRUE(cursor.seekToFirst());
+		ASSERT_EQ(oldImageMessage, cursor.getMessageId());
+	}
+}
+
+TEST_F(DatabaseTestFramework, archiveSkipsUnsentMessagesWithCursor) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, openmittsu::crypto::KeyPair::randomKey()));
+
+	// More unsent messages than one maintenance step visits come before the messages that can be archived.
+	int const unsentMessageCount = 130;
+	for (int i = 0; i < unsentMessageCount; ++i) {
+		this->addMessageId(db->storeSentContactMessageText(contactIdB, openmittsu::protocol::MessageTime::fromDatabase(1000 + i), true, QStringLiteral("Unsent")));
+	}
+	openmittsu::protocol::MessageId const oldMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageText(contactIdB, oldMessage, openmittsu::protocol::MessageTime::fromDatabase(5000), openmittsu::protocol::MessageTime::fromDatabase(5000), QStringLiteral("Old")));
+	openmittsu::protocol::GroupId groupA(contactIdB, 1);
+	ASSERT_NO_THROW(db->storeNewGroup(groupA, { contactIdB, selfContactId }, false));
+	openmittsu::protocol::MessageId const oldGroupMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedGroupMessageText(groupA, contactIdB, oldGroupMessage, openmittsu::protocol::MessageTime::fromDatabase(6000), openmittsu::protocol::MessageTime::fromDatabase(6000), QStringLiteral("OldGroup")));
+
+	// The candidates are read from the (`sort_by`, `uid`) index, not by sorting the table.
+	{
+		QSqlQuery query(db->getQueryObject());
+		ASSERT_TRUE(query.exec(QStringLiteral("EXPLAIN QUERY PLAN SELECT `uid`, `sort_by`, `is_outbox`, `is_sent` FROM `main`.`contact_messages` WHERE `sort_by` < 7000 AND `sort_by` >= 1000 AND (`sort_by` > 1000 OR `uid` > 'a') ORDER BY `sort_by` ASC, `uid` ASC LIMIT 128;")));
+		QString plan;
+		while (query.next()) {
+			plan.append(query.value(3).toString());
+		}
+		ASSERT_TRUE(plan.contains(QStringLiteral("contact_messages_sort_by")));
+		ASSERT_FALSE(plan.contains(QStringLiteral("TEMP B-TREE")));
+	}
+
+	db->setOptions({ { QStringLiteral("options/messageArchive/ageDays"), QStringLiteral("1") } });
+	ASSERT_TRUE(db->runMaintenance());
+	ASSERT_EQ(2, db->getMaintenanceStatistics().messagesArchived);
+
+	QSqlQuery query(db->getQueryObject());
+	ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `main`.`contact_messages`;")));
+	ASSERT_TRUE(query.next());
+	ASSERT_EQ(unsentMessageCount, query.value(0).toInt());
+	ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `archive`.`contact_messages`;")));
+	ASSERT_TRUE(query.next());
+	ASSERT_EQ(1, query.value(0).toInt());
+	ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `archive`.`group_messages`;")));
+	ASSERT_TRUE(query.next());
+	ASSERT_EQ(1, query.value(0).toInt());
+}
+
+TEST_F(DatabaseTestFramework, archiveMoveIsAtomic) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, openmittsu::crypto::KeyPair::randomKey()));
+	db->setOptions({ { QStringLiteral("options/messageArchive/ageDays"), QStringLiteral("1") } });
+
+	openmittsu::protocol::MessageId const firstMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageText(contactIdB, firstMessage, openmittsu::protocol::MessageTime::fromDatabase(1000), openmittsu::protocol::MessageTime::fromDatabase(1000), QStringLiteral("First")));
+	ASSERT_TRUE(db->runMaintenance());
+	ASSERT_EQ(1, db->getMaintenanceStatistics().messagesArchived);
+
+	// The archive records the versions of its tables, which were updated to have the same indices as the main tables.
+	{
+		QSqlQuery query(db->getQueryObject());
+		ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `archive`.`table_versions` WHERE `version` = 2;")));
+		ASSERT_TRUE(query.next());
+		ASSERT_EQ(3, query.value(0).toInt());
+		ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `archive`.`sqlite_master` WHERE `type` = 'index' AND `name` IN ('contact_messages_sort_by', 'group_messages_sort_by', 'media_type_size');")));
+		ASSERT_TRUE(query.next());
+		ASSERT_EQ(3, query.value(0).toInt());
+	}
+
+	QByteArray const imageData(QByteArray::fromHex("00112233445566778899aabbccddeeff"));
+	openmittsu::protocol::MessageId const imageMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageImage(contactIdB, imageMessage, openmittsu::protocol::MessageTime::fromDatabase(2000), openmittsu::protocol::MessageTime::fromDatabase(2000), imageData, QString()));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	openmittsu::protocol::MessageId const textMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageText(contactIdB, textMessage, openmittsu::protocol::MessageTime::fromDatabase(3000), openmittsu::protocol::MessageTime::fromDatabase(3000), QStringLiteral("Third")));
+
+	// A row already in the archive makes the move of the second message fail, after the image message was moved in the same batch.
+	{
+		QSqlQuery query(db->getQueryObject());
+		query.prepare(QStringLiteral("INSERT INTO `archive`.`contact_messages` (`identity`, `apiid`, `uid`) SELECT `identity`, `apiid`, `uid` FROM `main`.`contact_messages` WHERE `apiid` = :apiid;"));
+		query.bindValue(QStringLiteral(":apiid"), QVariant(textMessage.toQString()));
+		ASSERT_TRUE(query.exec());
+	}
+	ASSERT_FALSE(db->runMaintenance());
+
+	QSqlQuery query(db->getQueryObject());
+	ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `main`.`contact_messages`;")));
+	ASSERT_TRUE(query.next());
+	ASSERT_EQ(2, query.value(0).toInt());
+	ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `main`.`media`;")));
+	ASSERT_TRUE(query.next());
+	ASSERT_EQ(1, query.value(0).toInt());
+	ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `archive`.`media`;")));
+	ASSERT_TRUE(query.next());
+	ASSERT_EQ(0, query.value(0).toInt());
+}
+
+TEST_F(DatabaseTestFramework, chunkedMediaFiles) {
+	QByteArray largeData;
+	for (int i = 0; i < 200000; ++i) {
+		largeData.append(static_cast<char>((i * 7) % 251));
+	}
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("largeItem"), largeData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("emptyItem"), QByteArray(), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	openmittsu::database::MediaFileItem const largeItem = db->getMediaItem(QStringLiteral("largeItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	ASSERT_TRUE(largeItem.isAvailable());
+	ASSERT_EQ(largeData, largeItem.getData());
+	openmittsu::database::MediaFileItem const emptyItem = db->getMediaItem(QStringLiteral("emptyItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	ASSERT_TRUE(emptyItem.isAvailable());
+	ASSERT_TRUE(emptyItem.getData().isEmpty());
+
+	// Random access only decrypts the touched chunks.
+	{
+		std::unique_ptr<openmittsu::database::internal::ChunkedMediaFileReader> reader = db->openMediaItem(QStringLiteral("largeItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+		ASSERT_TRUE(reader != nullptr);
+		ASSERT_EQ(largeData.size(), reader->getSize());
+		ASSERT_EQ(4, reader->getChunkCount());
+		ASSERT_EQ(largeData.mid(65000, 2000), reader->read(65000, 2000));
+		ASSERT_EQ(largeData.mid(199990), reader->read(199990, 100));
+		ASSERT_EQ(largeData.left(10), reader->read(0, 10));
+		ASSERT_TRUE(reader->read(largeData.size(), 10).isEmpty());
+	}
+	ASSERT_TRUE(db->openMediaItem(QStringLiteral("missingItem"), openmittsu::database::MediaFileType::TYPE_STANDARD) == nullptr);
+
+	// A modified chunk fails authentication.
+	QFileInfoList contentFiles = findMediaFiles(QStringLiteral("encMedia_3_*"));
+	ASSERT_EQ(2, contentFiles.size());
+	std::sort(contentFiles.begin(), contentFiles.end(), [](QFileInfo const& a, QFileInfo const& b) { return a.size() > b.size(); });
+	QFile file(contentFiles.first().absoluteFilePath());
+	ASSERT_TRUE(file.open(QFile::ReadWrite));
+	ASSERT_TRUE(file.seek(70000));
+	char byte = 0;
+	ASSERT_TRUE(file.getChar(&byte));
+	ASSERT_TRUE(file.seek(70000));
+	ASSERT_TRUE(file.putChar(byte ^ 0x01));
+	file.close();
+
+	// A fresh instance does not hold the decrypted item in its media cache.
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	ASSERT_FALSE(db->getMediaItem(QStringLiteral("largeItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).isAvailable());
+	{
+		std::unique_ptr<openmittsu::database::internal::ChunkedMediaFileReader> reader = db->openMediaItem(QStringLiteral("largeItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+		ASSERT_TRUE(reader != nullptr);
+		ASSERT_EQ(largeData.left(10), reader->read(0, 10));
+		ASSERT_THROW(reader->read(70000, 10), openmittsu::exceptions::InternalErrorExceptionImpl);
+	}
+
+	// A file that lost its last chunk is rejected.
+	ASSERT_TRUE(file.resize(12 + 3 * (65536 + 16)));
+	ASSERT_TRUE(db->openMediaItem(QStringLiteral("largeItem"), openmittsu::database::MediaFileType::TYPE_STANDARD) == nullptr);
+	ASSERT_FALSE(db->getMediaItem(QStringLiteral("largeItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).isAvailable());
+}
+
+TEST_F(DatabaseTestFramework, mediaDeduplication) {
+	QByteArray const sharedData(QByteArray::fromHex("00112233445566778899aabbccddeeff").repeated(100));
+	QByteArray const otherData(QByteArray::fromHex("ffeeddccbbaa99887766554433221100"));
+	QString const contentFilter(QStringLiteral("encMedia_3_*"));
+
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemA"), sharedData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemB"), sharedData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemC"), sharedData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemC"), sharedData, openmittsu::database::MediaFileType::TYPE_THUMBNAIL));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	ASSERT_EQ(4, db->getMediaItemCount());
+	ASSERT_EQ(1, findMediaFiles(contentFilter).size());
+	ASSERT_EQ(sharedData, db->getMediaItem(QStringLiteral("itemB"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	ASSERT_EQ(sharedData, db->getMediaItem(QStringLiteral("itemC"), openmittsu::database::MediaFileType::TYPE_THUMBNAIL).getData());
+
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemD"), otherData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	ASSERT_EQ(2, findMediaFiles(contentFilter).size());
+
+	// The shared file stays until its last reference is removed.
+	ASSERT_NO_THROW(db->removeMediaItem(QStringLiteral("itemA"), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->removeAllMediaItems(QStringLiteral("itemC")));
+	ASSERT_EQ(2, db->getMediaItemCount());
+	ASSERT_EQ(2, findMediaFiles(contentFilter).size());
+	ASSERT_EQ(sharedData, db->getMediaItem(QStringLiteral("itemB"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+
+	ASSERT_NO_THROW(db->removeMediaItem(QStringLiteral("itemB"), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_EQ(1, findMediaFiles(contentFilter).size());
+	ASSERT_EQ(otherData, db->getMediaItem(QStringLiteral("itemD"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+
+	// Content stored again after its file was dropped gets a new file.
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemE"), sharedData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	ASSERT_EQ(2, findMediaFiles(contentFilter).size());
+	ASSERT_EQ(sharedData, db->getMediaItem(QStringLiteral("itemE"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+}
+
+TEST_F(DatabaseTestFramework, mediaCache) {
+	QByteArray const imageData(QByteArray::fromHex("00112233445566778899aabbccddeeff").repeated(64));
+	QByteArray const thumbnailData(QByteArray::fromHex("ffeeddccbbaa99887766554433221100"));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("cachedItem"), imageData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("cachedItem"), thumbnailData, openmittsu::database::MediaFileType::TYPE_THUMBNAIL));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	openmittsu::database::MediaCacheStatistics statistics = db->getMediaCacheStatistics();
+	ASSERT_EQ(0u, statistics.hits);
+	ASSERT_EQ(0u, statistics.misses);
+
+	ASSERT_EQ(imageData, db->getMediaItem(QStringLiteral("cachedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	ASSERT_EQ(imageData, db->getMediaItem(QStringLiteral("cachedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	ASSERT_EQ(thumbnailData, db->getMediaItem(QStringLiteral("cachedItem"), openmittsu::database::MediaFileType::TYPE_THUMBNAIL).getData());
+	statistics = db->getMediaCacheStatistics();
+	ASSERT_EQ(1u, statistics.hits);
+	ASSERT_EQ(2u, statistics.misses);
+	ASSERT_EQ(imageData.size(), statistics.standardBytes);
+	ASSERT_EQ(thumbnailData.size(), statistics.thumbnailBytes);
+
+	// Removing an item drops it from the cache.
+	ASSERT_NO_THROW(db->removeMediaItem(QStringLiteral("cachedItem"), openmittsu::database::MediaFileType::TYPE_THUMBNAIL));
+	ASSERT_FALSE(db->getMediaItem(QStringLiteral("cachedItem"), openmittsu::database::MediaFileType::TYPE_THUMBNAIL).isAvailable());
+	ASSERT_EQ(0, db->getMediaCacheStatistics().thumbnailBytes);
+
+	// A budget of zero from the options disables caching for full media items.
+	openmittsu::database::OptionNameToValueMap options;
+	options.insert(QStringLiteral("options/mediaCache/mediaBudgetMiB"), QStringLiteral("0"));
+	ASSERT_NO_THROW(db->setOptions(options));
+	ASSERT_EQ(0, db->getMediaCacheStatistics().standardBytes);
+	ASSERT_EQ(imageData, db->getMediaItem(QStringLiteral("cachedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+	ASSERT_EQ(0, db->getMediaCacheStatistics().standardBytes);
+	ASSERT_EQ(1u, db->getMediaCacheStatistics().hits);
+}
+
+TEST_F(DatabaseTestFramework, mediaItemAsync) {
+	QByteArray const imageData(QByteArray::fromHex("0123456789abcdef").repeated(4096));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("asyncItem"), imageData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	std::shared_future<openmittsu::database::MediaFileItem> future = db->getMediaItemAsync(QStringLiteral("asyncItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	ASSERT_TRUE(future.get().isAvailable());
+	ASSERT_EQ(imageData, future.get().getData());
+	ASSERT_EQ(imageData.size(), db->getMediaCacheStatistics().standardBytes);
+
+	// A second request is served from the cache and ready right away.
+	future = db->getMediaItemAsync(QStringLiteral("asyncItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(0)));
+	ASSERT_EQ(imageData, future.get().getData());
+
+	// A load still running while the item is removed must not put it back into the cache.
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("removedItem"), imageData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	future = db->getMediaItemAsync(QStringLiteral("removedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	ASSERT_NO_THROW(db->removeMediaItem(QStringLiteral("removedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	future.wait();
+	ASSERT_EQ(imageData.size(), db->getMediaCacheStatistics().standardBytes);
+
+	future = db->getMediaItemAsync(QStringLiteral("missingItem"), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(0)));
+	ASSERT_FALSE(future.get().isAvailable());
+}
+
+TEST_F(DatabaseTestFramework, mediaWritesAreStoredAsynchronously) {
+	auto processEventsUntil = [](std::function<bool()> const& condition) -> bool {
+		QElapsedTimer timer;
+		timer.start();
+		while (!condition() && (timer.elapsed() < 10000)) {
+			QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+		}
+		return condition();
+	};
+
+	// A new item is served from its data until the pool wrote it and the database thread stored it.
+	QByteArray const imageData(QByteArray::fromHex("0123456789abcdef").repeated(4096));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("pendingItem"), imageData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_EQ(0, db->getMediaItemCount());
+	ASSERT_TRUE(db->hasMediaItem(QStringLiteral("pendingItem"), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_EQ(imageData, db->getMediaItem(QStringLiteral("pendingItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+
+	ASSERT_TRUE(processEventsUntil([&]() { return db->getMediaItemCount() == 1; }));
+	ASSERT_EQ(1, findMediaFiles(QStringLiteral("encMedia_3_*")).size());
+	ASSERT_EQ(imageData, db->getMediaItem(QStringLiteral("pendingItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+
+	// An item removed while its write is pending is never stored and leaves no file behind.
+	QByteArray const otherData(QByteArray::fromHex("fedcba9876543210").repeated(4096));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("removedItem"), otherData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->removeMediaItem(QStringLiteral("removedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_FALSE(db->hasMediaItem(QStringLiteral("removedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	ASSERT_EQ(1, db->getMediaItemCount());
+	ASSERT_EQ(1, findMediaFiles(QStringLiteral("encMedia_3_*")).size());
+	ASSERT_TRUE(findMediaFiles(QStringLiteral("encMedia_tmp_*")).isEmpty());
+}
+
+TEST_F(DatabaseTestFramework, mediaItemHandle) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	openmittsu::crypto::KeyPair contactIdBKeyPair(openmittsu::crypto::KeyPair::randomKey());
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, contactIdBKeyPair));
+
+	QByteArray const imageData(QByteArray::fromHex("0123456789abcdef").repeated(1024));
+	openmittsu::protocol::MessageId const imageMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageImage(contactIdB, imageMessage, openmittsu::protocol::MessageTime::now(), openmittsu::protocol::MessageTime::now(), imageData, QStringLiteral("An image Caption")));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	// Fetching a readonly message does not touch its media.
+	std::shared_ptr<openmittsu::database::DatabaseReadonlyContactMessage> message;
+	{
+		openmittsu::database::internal::DatabaseContactMessageCursor cursor = db->getMessageCursor(contactIdB);
+		ASSERT_TRUE(cursor.seek(imageMessage));
+		message = cursor.getReadonlyMessage();
+	}
+	ASSERT_EQ(QStringLiteral("An image Caption"), message->getCaption());
+	openmittsu::database::MediaCacheStatistics statistics = db->getMediaCacheStatistics();
+	ASSERT_EQ(0u, statistics.hits);
+	ASSERT_EQ(0u, statistics.misses);
+
+	ASSERT_EQ(imageData, message->getContentAsMediaFile().getData());
+	ASSERT_EQ(imageData, message->getContentAsMediaFile().getData());
+	statistics = db->getMediaCacheStatistics();
+	ASSERT_EQ(0u, statistics.hits);
+	ASSERT_EQ(1u, statistics.misses);
+
+	// Streaming decrypts from the file instead of going through the cache.
+	{
+		std::unique_ptr<QIODevice> device = message->getContentAsMediaDevice();
+		ASSERT_TRUE(device != nullptr);
+		ASSERT_FALSE(device->isSequential());
+		ASSERT_EQ(imageData.size(), device->size());
+		ASSERT_TRUE(device->seek(4000));
+		ASSERT_EQ(imageData.mid(4000, 100), device->read(100));
+		ASSERT_TRUE(device->seek(0));
+		ASSERT_EQ(imageData, device->readAll());
+	}
+	statistics = db->getMediaCacheStatistics();
+	ASSERT_EQ(0u, statistics.hits);
+	ASSERT_EQ(1u, statistics.misses);
+
+	// Handles stay usable after the database is closed.
+	openmittsu::database::MediaItemHandle handle = db->getMediaItemHandle(message->getUid(), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	openmittsu::database::MediaItemHandle const copy = handle;
+	ASSERT_FALSE(handle.isLoadStarted());
+	message = nullptr;
+	db = nullptr;
+	ASSERT_EQ(imageData, copy.get().getData());
+	ASSERT_TRUE(handle.isLoadStarted());
+	ASSERT_EQ(imageData, handle.openDevice()->readAll());
+
+	ASSERT_EQ(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_NOT_IN_DATABASE, openmittsu::database::MediaItemHandle().get().getStatus());
+	ASSERT_TRUE(openmittsu::database::MediaItemHandle().openDevice() == nullptr);
+}
+
+TEST_F(DatabaseTestFramework, mediaShardedLayout) {
+	QByteArray const imageData(QByteArray::fromHex("00112233445566778899aabbccddeeff").repeated(16));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("shardedItem"), imageData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	// Content files are stored two shard directories deep, named after the start of the content id.
+	QFileInfoList const contentFiles = findMediaFiles(QStringLiteral("encMedia_3_*"));
+	ASSERT_EQ(1, contentFiles.size());
+	QString const contentId = contentFiles.first().fileName().mid(11);
+	QString const shardedFileName = QStringLiteral("%1/%2").arg(openmittsu::database::internal::ExternalMediaFileStorage::getShardDirectoryName(contentId)).arg(contentFiles.first().fileName());
+	ASSERT_TRUE(tempMediaStorageLocation.exists(shardedFileName));
+	ASSERT_TRUE(tempMediaStorageLocation.entryList(QStringList({ QStringLiteral("encMedia_*") }), QDir::Files).isEmpty());
+
+	// Simulate a database whose content files were written flat by an older version.
+	ASSERT_TRUE(tempMediaStorageLocation.rename(shardedFileName, contentFiles.first().fileName()));
+	db->setInternalOptionValue(QStringLiteral("media_content_layout"), QStringLiteral("flat"));
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	ASSERT_EQ(imageData, db->getMediaItem(QStringLiteral("shardedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+
+	// A stray file in a shard directory is removed, while the flat file is moved into its shard by the maintenance.
+	QFile strayFile(tempMediaStorageLocation.filePath(QStringLiteral("00/00/encMedia_3_0000")));
+	ASSERT_TRUE(tempMediaStorageLocation.mkpath(QStringLiteral("00/00")));
+	ASSERT_TRUE(strayFile.open(QFile::WriteOnly));
+	strayFile.write(imageData);
+	strayFile.close();
+
+	ASSERT_TRUE(db->runMaintenance());
+	ASSERT_TRUE(tempMediaStorageLocation.exists(shardedFileName));
+	ASSERT_FALSE(tempMediaStorageLocation.exists(contentFiles.first().fileName()));
+	ASSERT_FALSE(strayFile.exists());
+	ASSERT_EQ(1, db->getMaintenanceStatistics().mediaFilesMigrated);
+	ASSERT_EQ(1, db->getMaintenanceStatistics().mediaFilesRemoved);
+	ASSERT_EQ(QStringLiteral("sharded"), db->getInternalOptionValue(QStringLiteral("media_content_layout")));
+
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	ASSERT_EQ(imageData, db->getMediaItem(QStringLiteral("shardedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).getData());
+}
+
+TEST_F(DatabaseTestFramework, mediaIntegrityScan) {
+	QByteArray const imageData(QByteArray::fromHex("00112233445566778899aabbccddeeff").repeated(16));
+	auto insertAndFindFile = [&](QString const& uuid, QByteArray const& data) -> QString {
+		QFileInfoList const filesBefore = findMediaFiles(QStringLiteral("encMedia_3_*"));
+		db->insertMediaItem(uuid, data, openmittsu::database::MediaFileType::TYPE_STANDARD);
+		db->waitForMediaWrites();
+		QFileInfoList const filesAfter = findMediaFiles(QStringLiteral("encMedia_3_*"));
+		for (QFileInfo const& file : filesAfter) {
+			if (!filesBefore.contains(file)) {
+				return file.absoluteFilePath();
+			}
+		}
+		return QString();
+	};
+
+	QString const corruptedFileName = insertAndFindFile(QStringLiteral("corruptedItem"), imageData);
+	QString const deletedFileName = insertAndFindFile(QStringLiteral("deletedItem"), imageData.toHex());
+	ASSERT_FALSE(insertAndFindFile(QStringLiteral("intactItem"), imageData.toBase64()).isEmpty());
+	ASSERT_FALSE(corruptedFileName.isEmpty());
+	ASSERT_FALSE(deletedFileName.isEmpty());
+
+	QFile corruptedFile(corruptedFileName);
+	ASSERT_TRUE(corruptedFile.open(QFile::ReadWrite));
+	ASSERT_TRUE(corruptedFile.seek(corruptedFile.size() - 1));
+	char lastByte = 0;
+	ASSERT_TRUE(corruptedFile.getChar(&lastByte));
+	ASSERT_TRUE(corruptedFile.seek(corruptedFile.size() - 1));
+	ASSERT_TRUE(corruptedFile.putChar(static_cast<char>(lastByte ^ 0x01)));
+	corruptedFile.close();
+	ASSERT_TRUE(QFile::remove(deletedFileName));
+
+	QFile strayFile(tempMediaStorageLocation.filePath(QStringLiteral("00/00/encMedia_3_0000")));
+	ASSERT_TRUE(tempMediaStorageLocation.mkpath(QStringLiteral("00/00")));
+	ASSERT_TRUE(strayFile.open(QFile::WriteOnly));
+	strayFile.write(imageData);
+	strayFile.close();
+
+	// Without repair, problems are only reported.
+	int progressReports = 0;
+	openmittsu::database::internal::MediaIntegrityScanner::Report report;
+	ASSERT_NO_THROW(report = db->runMediaIntegrityScan(false, [&progressReports](openmittsu::database::internal::MediaIntegrityScanner::Report const&) { ++progressReports; }));
+	ASSERT_TRUE(report.isComplete);
+	ASSERT_LT(0, progressReports);
+	ASSERT_EQ(3, report.checkedItems);
+	ASSERT_EQ(1, report.missingItems);
+	ASSERT_EQ(1, report.corruptedItems);
+	ASSERT_EQ(1, report.orphanedFiles);
+	ASSERT_EQ(0, report.markedItems);
+	ASSERT_EQ(0, report.removedFiles);
+	ASSERT_TRUE(strayFile.exists());
+	ASSERT_TRUE(db->getDamagedMediaItems().isEmpty());
+
+	// Repairing marks the broken items and removes the stray file.
+	ASSERT_NO_THROW(report = db->runMediaIntegrityScan(true));
+	ASSERT_TRUE(report.isComplete);
+	ASSERT_EQ(2, report.markedItems);
+	ASSERT_EQ(1, report.removedFiles);
+	ASSERT_FALSE(strayFile.exists());
+
+	QList<openmittsu::database::internal::ExternalMediaFileStorage::DamagedMediaItem> damagedItems = db->getDamagedMediaItems();
+	ASSERT_EQ(2, damagedItems.size());
+	ASSERT_EQ(QStringLiteral("corruptedItem"), damagedItems.at(0).uuid);
+	ASSERT_EQ(QStringLiteral("deletedItem"), damagedItems.at(1).uuid);
+	ASSERT_EQ(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EXTERNAL_FILE_DELETED, damagedItems.at(1).status);
+
+	// Storing new data for an item clears its mark.
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("deletedItem"), imageData.toHex().toUpper(), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	damagedItems = db->getDamagedMediaItems();
+	ASSERT_EQ(1, damagedItems.size());
+	ASSERT_EQ(QStringLiteral("corruptedItem"), damagedItems.at(0).uuid);
+}
+
+TEST_F(DatabaseTestFramework, mediaUsageTotals) {
+	QByteArray const sharedData(QByteArray::fromHex("00112233445566778899aabbccddeeff").repeated(32));
+	QByteArray const thumbnailData(QByteArray::fromHex("ffeeddccbbaa99887766554433221100"));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemA"), sharedData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemB"), sharedData, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("itemB"), thumbnailData, openmittsu::database::MediaFileType::TYPE_THUMBNAIL));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	openmittsu::database::internal::MediaFileStorage::MediaUsage usage = db->getMediaUsage();
+	ASSERT_EQ(2 * sharedData.size(), usage.standardBytes);
+	ASSERT_EQ(thumbnailData.size(), usage.thumbnailBytes);
+
+	ASSERT_NO_THROW(db->removeMediaItem(QStringLiteral("itemB"), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_EQ(sharedData.size(), db->getMediaUsage().standardBytes);
+
+	// The totals are read as stored, only a repairing scan computes them from all entries again.
+	QSqlQuery query(db->getQueryObject());
+	ASSERT_TRUE(query.exec(QStringLiteral("UPDATE `media_usage` SET `bytes` = 0;")));
+	ASSERT_EQ(0, db->getMediaUsage().standardBytes);
+	ASSERT_NO_THROW(db->runMediaIntegrityScan(true));
+	usage = db->getMediaUsage();
+	ASSERT_EQ(sharedData.size(), usage.standardBytes);
+	ASSERT_EQ(thumbnailData.size(), usage.thumbnailBytes);
+}
+
+TEST_F(DatabaseTestFramework, mediaQuota) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	openmittsu::crypto::KeyPair contactIdBKeyPair(openmittsu::crypto::KeyPair::randomKey());
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, contactIdBKeyPair));
+
+	QByteArray const oldImage(QByteArray::fromHex("00112233445566778899aabbccddeeff").repeated(64));
+	QByteArray const largeImage(QByteArray::fromHex("ffeeddccbbaa99887766554433221100").repeated(256));
+	QByteArray const newImage(QByteArray::fromHex("0123456789abcdef0123456789abcdef").repeated(16));
+	openmittsu::protocol::MessageId const oldImageMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageImage(contactIdB, oldImageMessage, openmittsu::protocol::MessageTime::fromDatabase(1000), openmittsu::protocol::MessageTime::fromDatabase(1000), oldImage, QStringLiteral("Old")));
+	openmittsu::protocol::MessageId const largeImageMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageImage(contactIdB, largeImageMessage, openmittsu::protocol::MessageTime::fromDatabase(2000), openmittsu::protocol::MessageTime::fromDatabase(2000), largeImage, QStringLiteral("Large")));
+	openmittsu::protocol::MessageId const newImageMessage = this->getFreeMessageId();
+	ASSERT_NO_THROW(db->storeReceivedContactMessageImage(contactIdB, newImageMessage, openmittsu::protocol::MessageTime::now(), openmittsu::protocol::MessageTime::now(), newImage, QStringLiteral("New")));
+	// Media without a message, like group images, never counts against the quota.
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("unrelatedItem"), largeImage.toHex(), openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->insertMediaItem(QStringLiteral("unrelatedItem"), newImage, openmittsu::database::MediaFileType::TYPE_THUMBNAIL));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	openmittsu::database::internal::MediaFileStorage::MediaUsage usage = db->getMediaUsage();
+	qint64 const messageBytes = oldImage.size() + largeImage.size() + newImage.size();
+	ASSERT_EQ(messageBytes + largeImage.toHex().size(), usage.standardBytes);
+	ASSERT_EQ(newImage.size(), usage.thumbnailBytes);
+	ASSERT_EQ(0, usage.evictedBytes);
+	ASSERT_EQ(messageBytes, db->getConversationMediaUsage().contactBytes.value(contactIdB));
+
+	auto getMessageMedia = [&](openmittsu::protocol::MessageId const& messageId) -> openmittsu::database::MediaFileItem {
+		return db->getMediaItem(openmittsu::database::internal::DatabaseContactMessage(db.get(), contactIdB, messageId).getUid(), openmittsu::database::MediaFileType::TYPE_STANDARD);
+	};
+
+	// Without limits, nothing is evicted.
+	ASSERT_FALSE(db->getMediaQuotaSettings().budgetInBytes > 0);
+	ASSERT_EQ(0, db->enforceMediaQuota());
+
+	// Exceeding the budget by one byte evicts the oldest item.
+	db->setMediaQuotaSettings({ usage.standardBytes - 1, 0, openmittsu::database::internal::MediaFileStorage::EvictionOrder::OLDEST_FIRST });
+	ASSERT_EQ(1, db->enforceMediaQuota());
+	ASSERT_EQ(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED, getMessageMedia(oldImageMessage).getStatus());
+	ASSERT_TRUE(getMessageMedia(largeImageMessage).isAvailable());
+	ASSERT_EQ(oldImage.size(), db->getMediaUsage().evictedBytes);
+	ASSERT_EQ(0, db->enforceMediaQuota());
+
+	// Evicting the largest item first spares the newer, smaller one.
+	usage = db->getMediaUsage();
+	db->setMediaQuotaSettings({ usage.standardBytes - 1, 0, openmittsu::database::internal::MediaFileStorage::EvictionOrder::LARGEST_FIRST });
+	ASSERT_EQ(1, db->enforceMediaQuota());
+	ASSERT_EQ(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED, getMessageMedia(largeImageMessage).getStatus());
+	ASSERT_TRUE(getMessageMedia(newImageMessage).isAvailable());
+	ASSERT_EQ(newImage.size(), db->getConversationMediaUsage().contactBytes.value(contactIdB));
+	ASSERT_TRUE(db->getMediaItem(QStringLiteral("unrelatedItem"), openmittsu::database::MediaFileType::TYPE_THUMBNAIL).isAvailable());
+	ASSERT_TRUE(db->getMediaItem(QStringLiteral("unrelatedItem"), openmittsu::database::MediaFileType::TYPE_STANDARD).isAvailable());
+
+	// Items stay evicted across restarts, until their data is stored again.
+	db = nullptr;
+	db = std::make_shared<openmittsu::database::SimpleDatabase>(databaseFilename, QStringLiteral("AAAAAAAA"), tempMediaStorageLocation);
+	ASSERT_EQ(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED, getMessageMedia(oldImageMessage).getStatus());
+	ASSERT_NO_THROW(db->insertMediaItem(openmittsu::database::internal::DatabaseContactMessage(db.get(), contactIdB, oldImageMessage).getUid(), oldImage, openmittsu::database::MediaFileType::TYPE_STANDARD));
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+	ASSERT_EQ(oldImage, getMessageMedia(oldImageMessage).getData());
+
+	// The age limit evicts the old items, and the maintenance counts them.
+	db->setMediaQuotaSettings({ 0, 1, openmittsu::database::internal::MediaFileStorage::EvictionOrder::OLDEST_FIRST });
+	ASSERT_TRUE(db->runMaintenance());
+	ASSERT_EQ(1, db->getMaintenanceStatistics().mediaItemsEvicted);
+	ASSERT_EQ(openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED, getMessageMedia(oldImageMessage).getStatus());
+	ASSERT_TRUE(getMessageMedia(newImageMessage).isAvailable());
+}
+
+TEST_F(DatabaseTestFramework, mediaQuotaPassesOverManyItems) {
+	openmittsu::protocol::ContactId contactIdB(QStringLiteral("BBBBBBBB"));
+	ASSERT_NO_THROW(db->storeNewContact(contactIdB, openmittsu::crypto::KeyPair::randomKey()));
+
+	// Candidates are read from indices, in batches continuing after the last visited item.
+	{
+		QSqlQuery query(db->getQueryObject());
+		ASSERT_TRUE(query.exec(QStringLiteral("SELECT COUNT(*) FROM `main`.`sqlite_master` WHERE `type` = 'index' AND `name` IN ('contact_messages_sort_by', 'group_messages_sort_by', 'media_type_size');")));
+		ASSERT_TRUE(query.next());
+		ASSERT_EQ(3, query.value(0).toInt());
+	}
+
+	// More items than fit into one batch, with equal sort keys and sizes, so batches have to continue by uuid.
+	int const itemCount = 40;
+	QByteArray const imageData(QByteArray::fromHex("00112233445566778899aabbccddeeff").repeated(4));
+	QList<openmittsu::protocol::MessageId> messages;
+	for (int i = 0; i < itemCount; ++i) {
+		openmittsu::protocol::MessageId const messageId = this->getFreeMessageId();
+		ASSERT_NO_THROW(db->storeReceivedContactMessageImage(contactIdB, messageId, openmittsu::protocol::MessageTime::fromDatabase(1000 + (i / 8)), openmittsu::protocol::MessageTime::fromDatabase(1000 + (i / 8)), imageData, QString()));
+		messages.append(messageId);
+	}
+	ASSERT_NO_THROW(db->waitForMediaWrites());
+
+	auto countEvictedItems = [&]() -> int {
+		int result = 0;
+		for (openmittsu::protocol::MessageId const& messageId : messages) {
+			openmittsu::database::MediaFileItem const item = db->getMediaItem(openmittsu::database::internal::DatabaseContactMessage(db.get(), contactIdB, messageId).getUid(), openmittsu::database::MediaFileType::TYPE_STANDARD);
+			if (item.getStatus() == openmittsu::database::MediaFileItem::ItemStatus::UNAVAILABLE_EVICTED) {
+				++result;
+			}
+		}
+		return result;
+	};
+
+	// Largest first with equal sizes visits every item once, and stops as soon as the budget is met.
+	qint64 const budget = imageData.size() * 10;
+	db->setMediaQuotaSettings({ budget, 0, openmittsu::database::internal::MediaFileStorage::EvictionOrder::LARGEST_FIRST });
+	ASSERT_EQ(itemCount - 10, db->enforceMediaQuota());
+	ASSERT_EQ(itemCount - 10, countEvictedItems());
+	ASSERT_EQ(budget, db->getMediaUsage().standardBytes);
+
+	// The age limit walks all remaining items in message order.
+	db->setMediaQuotaSettings({ 0, 1, openmittsu::database::internal::MediaFileStorage::EvictionOrder::OLDEST_FIRST });
+	ASSERT_EQ(10, db->enforceMediaQuota());
+	ASSERT_EQ(itemCount, countEvictedItems());
+	ASSERT_EQ(0, db->getMediaUsage().standardBytes);
+	ASSERT_EQ(0, db->enforceMediaQuota());
+}
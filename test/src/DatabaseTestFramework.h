@@ -4,7 +4,9 @@
 #include "gtest/gtest.h"
 
 #include <QDir>
+#include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
 #include <QHash>
 #include <QSet>
 #include <QString>
@@ -60,6 +62,7 @@ protected:
 		//std::cout << "per-test setup" << std::endl;
 		db = nullptr;
 		ensureFileDoesNotExist(databaseFilename);
+		ensureFileDoesNotExist(openmittsu::database::internal::DatabaseArchive::getArchiveFileName(databaseFilename));
 		tempMediaStorageLocation = QDir::temp();
 		tempMediaStorageLocation.mkdir(QStringLiteral("openMittsuTests-tmpdir"));
 		ASSERT_TRUE(tempMediaStorageLocation.cd(QStringLiteral("openMittsuTests-tmpdir")));
@@ -72,9 +75,21 @@ protected:
 		//std::cout << "per-test teardown" << std::endl;
 		db = nullptr;
 		ensureFileDoesNotExist(databaseFilename);
+		ensureFileDoesNotExist(openmittsu::database::internal::DatabaseArchive::getArchiveFileName(databaseFilename));
 		ASSERT_TRUE(tempMediaStorageLocation.removeRecursively());
 	}
 
+	// Media files are spread over shard directories, so this searches the whole media storage.
+	QFileInfoList findMediaFiles(QString const& nameFilter) {
+		QFileInfoList result;
+		QDirIterator it(tempMediaStorageLocation.absolutePath(), QStringList({ nameFilter }), QDir::Files, QDirIterator::Subdirectories);
+		while (it.hasNext()) {
+			it.next();
+			result.append(it.fileInfo());
+		}
+		return result;
+	}
+
 	void ensureFileDoesNotExist(QString const& filename) {
 		if (QFile::exists(filename)) {
 			ASSERT_TRUE(QFile::remove(filename));
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "src/database/internal/ExternalMediaFileStorage.h"
+
+namespace {
+	QStringList generateContentIds(int count) {
+		std::mt19937_64 generator(0x5eed);
+		QStringList result;
+		result.reserve(count);
+		for (int i = 0; i < count; ++i) {
+			quint64 const high = generator();
+			quint64 const low = generator();
+			result.append(QStringLiteral("%1%2").arg(high, 16, 16, QChar('0')).arg(low, 16, 16, QChar('0')));
+		}
+		return result;
+	}
+
+	QString getRelativeFileName(QString const& contentId, bool isSharded) {
+		QString const fileName = QStringLiteral("encMedia_3_").append(contentId);
+		if (!isSharded) {
+			return fileName;
+		}
+		return QStringLiteral("%1/%2").arg(openmittsu::database::internal::ExternalMediaFileStorage::getShardDirectoryName(contentId)).arg(fileName);
+	}
+
+	void runLayoutBenchmark(QDir const& directory, QStringList const& contentIds, bool isSharded) {
+		auto const createStart = std::chrono::steady_clock::now();
+		for (QString const& contentId : contentIds) {
+			if (isSharded) {
+				ASSERT_TRUE(directory.mkpath(openmittsu::database::internal::ExternalMediaFileStorage::getShardDirectoryName(contentId)));
+			}
+			QFile file(directory.filePath(getRelativeFileName(contentId, isSharded)));
+			ASSERT_TRUE(file.open(QFile::WriteOnly));
+			file.close();
+		}
+		std::chrono::duration<double, std::micro> const createTime = std::chrono::steady_clock::now() - createStart;
+
+		// Opens files in random order, as the message view does when scrolling through old conversations.
+		std::mt19937 generator(0x0be4);
+		int const openCount = 10000;
+		auto const openStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < openCount; ++i) {
+			QFile file(directory.filePath(getRelativeFileName(contentIds.at(static_cast<int>(generator() % contentIds.size())), isSharded)));
+			ASSERT_TRUE(file.open(QFile::ReadOnly));
+			file.close();
+		}
+		std::chrono::duration<double, std::micro> const openTime = std::chrono::steady_clock::now() - openStart;
+
+		std::cout << (isSharded ? "Sharded" : "Flat") << " layout with " << contentIds.size() << " files: create " << (createTime.count() / contentIds.size()) << " us/file, open " << (openTime.count() / openCount) << " us/file" << std::endl;
+	}
+}
+
+TEST(MediaStorageLayoutTest, ShardDirectoryName) {
+	ASSERT_EQ(QStringLiteral("3f/a2"), openmittsu::database::internal::ExternalMediaFileStorage::getShardDirectoryName(QStringLiteral("3fa2b4c6d8")));
+	ASSERT_EQ(QStringLiteral("00/ff"), openmittsu::database::internal::ExternalMediaFileStorage::getShardDirectoryName(QStringLiteral("00ff")));
+}
+
+// Run with --gtest_also_run_disabled_tests to compare both layouts. OPENMITTSU_BENCHMARK_FILE_COUNT overrides the default of one million files per layout.
+TEST(MediaStorageLayoutTest, DISABLED_OpenCreateLatency) {
+	int fileCount = 1000000;
+	char const* const fileCountOverride = std::getenv("OPENMITTSU_BENCHMARK_FILE_COUNT");
+	if (fileCountOverride != nullptr) {
+		fileCount = std::atoi(fileCountOverride);
+	}
+	ASSERT_LT(0, fileCount);
+
+	QStringList const contentIds = generateContentIds(fileCount);
+	{
+		QTemporaryDir flatDirectory;
+		ASSERT_TRUE(flatDirectory.isValid());
+		runLayoutBenchmark(QDir(flatDirectory.path()), contentIds, false);
+	}
+	{
+		QTemporaryDir shardedDirectory;
+		ASSERT_TRUE(shardedDirectory.isValid());
+		runLayoutBenchmark(QDir(shardedDirectory.path()), contentIds, true);
+	}
+}
@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "src/crypto/pbkdf2-sha256.h"
+#include "src/protocol/ProtocolSpecs.h"
+
+namespace {
+	QByteArray pbkdf2(QByteArray const& password, QByteArray const& salt, unsigned long iterations, int keyLength) {
+		QByteArray result(keyLength, '\0');
+		openmittsu_PKCS5_PBKDF2_HMAC(reinterpret_cast<unsigned char const*>(password.constData()), password.size(), reinterpret_cast<unsigned char const*>(salt.constData()), salt.size(), iterations, keyLength, reinterpret_cast<unsigned char*>(result.data()));
+		return result;
+	}
+
+	/** PBKDF2 straight from RFC 8018, with a complete HMAC per iteration. */
+	QByteArray referencePbkdf2(QByteArray const& password, QByteArray const& salt, unsigned long iterations, int keyLength) {
+		QByteArray result;
+		for (quint32 counter = 1; result.size() < keyLength; ++counter) {
+			QByteArray input(salt);
+			input.append(static_cast<char>(counter >> 24)).append(static_cast<char>(counter >> 16)).append(static_cast<char>(counter >> 8)).append(static_cast<char>(counter));
+
+			unsigned char u[32];
+			unsigned char t[32];
+			openmittsu_sha2_hmac(reinterpret_cast<unsigned char const*>(password.constData()), password.size(), reinterpret_cast<unsigned char const*>(input.constData()), input.size(), u, 0);
+			std::copy(u, u + 32, t);
+			for (unsigned long i = 1; i < iterations; ++i) {
+				openmittsu_sha2_hmac(reinterpret_cast<unsigned char const*>(password.constData()), password.size(), u, sizeof(u), u, 0);
+				for (int j = 0; j < 32; ++j) {
+					t[j] ^= u[j];
+				}
+			}
+			result.append(reinterpret_cast<char const*>(t), 32);
+		}
+		return result.left(keyLength);
+	}
+}
+
+TEST(Pbkdf2Sha256Test, KnownValues) {
+	// RFC 7914, section 11.
+	ASSERT_EQ(QByteArray::fromHex("55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783"), pbkdf2(QByteArray("passwd"), QByteArray("salt"), 1, 64));
+	ASSERT_EQ(QByteArray::fromHex("4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d"), pbkdf2(QByteArray("Password"), QByteArray("NaCl"), 80000, 64));
+
+	// The RFC 6070 inputs with SHA-256, covering a truncated last block and embedded zero bytes.
+	ASSERT_EQ(QByteArray::fromHex("120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b"), pbkdf2(QByteArray("password"), QByteArray("salt"), 1, 32));
+	ASSERT_EQ(QByteArray::fromHex("ae4d0c95af6b46d32d0adff928f06dd02a303f8ef3c251dfd6e2d85a95474c43"), pbkdf2(QByteArray("password"), QByteArray("salt"), 2, 32));
+	ASSERT_EQ(QByteArray::fromHex("c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a"), pbkdf2(QByteArray("password"), QByteArray("salt"), 4096, 32));
+	ASSERT_EQ(QByteArray::fromHex("348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9"), pbkdf2(QByteArray("passwordPASSWORDpassword"), QByteArray("saltSALTsaltSALTsaltSALTsaltSALTsalt"), 4096, 40));
+	ASSERT_EQ(QByteArray::fromHex("89b69d0516f829893c696226650a8687"), pbkdf2(QByteArray("pass\0word", 9), QByteArray("sa\0lt", 5), 4096, 16));
+}
+
+TEST(Pbkdf2Sha256Test, MatchesReference) {
+	std::mt19937 generator(0x5eed);
+	for (int round = 0; round < 200; ++round) {
+		// Passwords longer than a block are hashed first, so lengths go past 64.
+		QByteArray password(static_cast<int>(generator() % 150), '\0');
+		QByteArray salt(static_cast<int>(generator() % 80), '\0');
+		std::generate(password.begin(), password.end(), [&generator]() { return static_cast<char>(generator()); });
+		std::generate(salt.begin(), salt.end(), [&generator]() { return static_cast<char>(generator()); });
+		unsigned long const iterations = 1 + (generator() % 40);
+		int const keyLength = 1 + static_cast<int>(generator() % 100);
+
+		ASSERT_EQ(referencePbkdf2(password, salt, iterations, keyLength), pbkdf2(password, salt, iterations, keyLength)) << "Round " << round;
+	}
+}
+
+TEST(Pbkdf2Sha256Test, ConcurrentCalls) {
+	QByteArray const expected = pbkdf2(QByteArray("concurrent"), QByteArray("saltsalt"), 5000, 32);
+
+	std::vector<QByteArray> results(4);
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		threads.emplace_back([&results, i]() {
+			results[i] = pbkdf2(QByteArray("concurrent"), QByteArray("saltsalt"), 5000, 32);
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	for (QByteArray const& result : results) {
+		ASSERT_EQ(expected, result);
+	}
+}
+
+// Run with --gtest_also_run_disabled_tests to compare the time of one identity backup key derivation against the generic HMAC loop.
+TEST(Pbkdf2Sha256Test, DISABLED_Throughput) {
+	QByteArray const password("correct horse battery staple");
+	QByteArray const salt(BACKUP_SALT_BYTES, 's');
+
+	auto start = std::chrono::steady_clock::now();
+	QByteArray const reference = referencePbkdf2(password, salt, BACKUP_KEY_PBKDF_ITERATIONS, BACKUP_ENCRYPTION_KEY_BYTES);
+	std::chrono::duration<double> const referenceSeconds = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	QByteArray const result = pbkdf2(password, salt, BACKUP_KEY_PBKDF_ITERATIONS, BACKUP_ENCRYPTION_KEY_BYTES);
+	std::chrono::duration<double> const seconds = std::chrono::steady_clock::now() - start;
+
+	ASSERT_EQ(reference, result);
+	std::cout << "Generic HMAC loop: " << (referenceSeconds.count() * 1000.0) << " ms, precomputed pad states: " << (seconds.count() * 1000.0) << " ms" << std::endl;
+}
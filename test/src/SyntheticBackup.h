@@ -0,0 +1,135 @@
+#ifndef OPENMITTSU_TEST_SYNTHETICBACKUP_H_
+#define OPENMITTSU_TEST_SYNTHETICBACKUP_H_
+
+#include "gtest/gtest.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QString>
+#include <QStringList>
+#include <QUuid>
+
+#include "buildTools/benchmark/SyntheticAccountGenerator.h"
+#include "src/backup/ContactMediaItemBackupObject.h"
+#include "src/backup/ContactMessageBackupObject.h"
+#include "src/backup/CsvRecordWriter.h"
+#include "src/backup/GroupMediaItemBackupObject.h"
+#include "src/backup/GroupMessageBackupObject.h"
+#include "src/database/SimpleDatabase.h"
+
+namespace openmittsu {
+	namespace test {
+
+		using openmittsu::benchmark::SyntheticAccountGenerator;
+
+		/** Settings for an account in which every contact and group has exactly messagesPerConversation messages. */
+		inline SyntheticAccountGenerator::Settings getSyntheticSettings(int contactCount, int groupCount, int messagesPerConversation, int mediaCount, int mediaSize) {
+			SyntheticAccountGenerator::Settings settings = SyntheticAccountGenerator::getDefaultSettings();
+			settings.contactCount = contactCount;
+			settings.groupCount = groupCount;
+			settings.messageCount = static_cast<qint64>(contactCount + groupCount) * messagesPerConversation;
+			settings.distribution = SyntheticAccountGenerator::Distribution::UNIFORM;
+			settings.mediaCount = mediaCount;
+			settings.mediaSize = mediaSize;
+			return settings;
+		}
+
+		/** All rows of table ordered by orderBy, one string per row. */
+		inline QStringList dumpTable(openmittsu::database::SimpleDatabase const& database, QString const& table, QString const& orderBy) {
+			QStringList result;
+			QSqlQuery query(database.getQueryObject());
+			if (!query.exec(QStringLiteral("SELECT * FROM `%1` ORDER BY `%2` ASC;").arg(table).arg(orderBy))) {
+				result.append(QStringLiteral("Query failed"));
+				return result;
+			}
+			while (query.next()) {
+				QSqlRecord const record = query.record();
+				QStringList columns;
+				for (int i = 0; i < record.count(); ++i) {
+					columns.append(record.value(i).toString());
+				}
+				result.append(columns.join(QChar('|')));
+			}
+			return result;
+		}
+
+		/** The contents of all contact and group media files of a backup by their uuid. */
+		inline QHash<QString, QByteArray> readMediaItems(QDir const& directory) {
+			QHash<QString, QByteArray> result;
+			QHash<QString, QString> const contactMediaFiles = openmittsu::backup::ContactMediaItemBackupObject::getContactMediaFiles(directory);
+			for (auto it = contactMediaFiles.constBegin(); it != contactMediaFiles.constEnd(); ++it) {
+				result.insert(it.key(), openmittsu::backup::ContactMediaItemBackupObject::fromFile(directory, it.value()).getData());
+			}
+			QHash<QString, QString> const groupMediaFiles = openmittsu::backup::GroupMediaItemBackupObject::getGroupMediaFiles(directory);
+			for (auto it = groupMediaFiles.constBegin(); it != groupMediaFiles.constEnd(); ++it) {
+				result.insert(it.key(), openmittsu::backup::GroupMediaItemBackupObject::fromFile(directory, it.value()).getData());
+			}
+			return result;
+		}
+
+		inline qint64 getTotalSize(QHash<QString, QByteArray> const& mediaItems) {
+			qint64 result = 0;
+			for (QByteArray const& data : mediaItems) {
+				result += data.size();
+			}
+			return result;
+		}
+
+		inline QString createUuid() {
+			return QUuid::createUuid().toString().mid(1, 36);
+		}
+
+		inline void writeMediaFile(QDir const& directory, QString const& fileName, QByteArray const& data) {
+			QFile file(directory.filePath(fileName));
+			ASSERT_TRUE(file.open(QFile::WriteOnly));
+			ASSERT_EQ(data.size(), file.write(data));
+		}
+
+		/** Appends records to a backup file, writing header first if the file does not exist yet. */
+		inline void appendRecords(QDir const& directory, QString const& fileName, QStringList const& header, QList<QStringList> const& records) {
+			QFile file(directory.filePath(fileName));
+			bool const isNew = !file.exists();
+			ASSERT_TRUE(file.open(QFile::Append));
+			openmittsu::backup::CsvRecordWriter writer(&file);
+			if (isNew) {
+				writer.writeRecord(header);
+			}
+			for (QStringList const& record : records) {
+				writer.writeRecord(record);
+			}
+			writer.flush();
+		}
+
+		/** count received text messages from contact, their API ids start with the eight hex digits of apiIdPrefix. */
+		inline void appendContactMessages(QDir const& directory, openmittsu::protocol::ContactId const& contact, QString const& apiIdPrefix, int count) {
+			QList<QStringList> records;
+			for (int i = 0; i < count; ++i) {
+				openmittsu::protocol::MessageTime const time = openmittsu::protocol::MessageTime::fromDatabase(1600000000000LL + i);
+				openmittsu::protocol::MessageId const apiId(QStringLiteral("%1%2").arg(apiIdPrefix).arg(i, 8, 16, QChar('0')));
+				records.append(openmittsu::backup::ContactMessageBackupObject(contact, apiId, createUuid(), false, true, false, openmittsu::dataproviders::messages::UserMessageState::READ, time, time, time, time,
+					openmittsu::dataproviders::messages::ContactMessageType::TEXT, QStringLiteral("Newer message %1").arg(i), false, false, QString()).toBackupRecord());
+			}
+			appendRecords(directory, openmittsu::backup::ContactMessageBackupObject::getContactMessageFileName(contact), openmittsu::backup::ContactMessageBackupObject::getBackupHeader(), records);
+		}
+
+		/** count text messages sent by sender to group, their API ids start with the eight hex digits of apiIdPrefix. */
+		inline void appendGroupMessages(QDir const& directory, openmittsu::protocol::GroupId const& group, openmittsu::protocol::ContactId const& sender, QString const& apiIdPrefix, int count) {
+			QList<QStringList> records;
+			for (int i = 0; i < count; ++i) {
+				openmittsu::protocol::MessageTime const time = openmittsu::protocol::MessageTime::fromDatabase(1600000000000LL + i);
+				openmittsu::protocol::MessageId const apiId(QStringLiteral("%1%2").arg(apiIdPrefix).arg(i, 8, 16, QChar('0')));
+				records.append(openmittsu::backup::GroupMessageBackupObject(group, sender, apiId, createUuid(), false, true, false, openmittsu::dataproviders::messages::UserMessageState::READ, time, time, time, time,
+					openmittsu::dataproviders::messages::GroupMessageType::TEXT, QStringLiteral("Newer group message %1").arg(i), false, false, QString()).toBackupRecord());
+			}
+			appendRecords(directory, openmittsu::backup::GroupMessageBackupObject::getGroupMessageFileName(group), openmittsu::backup::GroupMessageBackupObject::getBackupHeader(), records);
+		}
+
+	}
+}
+
+#endif // OPENMITTSU_TEST_SYNTHETICBACKUP_H_